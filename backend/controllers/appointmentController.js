@@ -9,9 +9,13 @@ const User = require('../models/User');
 const notificationFacade = require('../services/notificationFacade');
 const { asyncHandler } = require('../middleware/errorHandler');
 const websocketService = require('../services/websocketService');
+const waitlistBackfill = require('../services/waitlistBackfillService');
+const slotHolds = require('../services/slotHoldService');
 const { getTodayRange, getDayRange } = require('../utils/dateUtils');
 const { sanitizeForAssign } = require('../utils/sanitize');
 const { success, error, notFound, paginated } = require('../utils/apiResponse');
+const { sendSerialized } = require('../utils/jsonSerializer');
+const { serializers } = require('../utils/responseSchemas');
 const { findPatientByIdOrCode } = require('../utils/patientLookup');
 const { appointment: appointmentLogger } = require('../utils/structuredLogger');
 const { APPOINTMENT, CANCELLATION, PAGINATION } = require('../config/constants');
@@ -87,14 +91,14 @@ exports.getAppointments = asyncHandler(async (req, res, next) => {
 
   const count = await Appointment.countDocuments(query);
 
-  res.status(200).json({
+  return sendSerialized(res, serializers.appointmentPage, {
     success: true,
     count: appointments.length,
     total: count,
     pages: Math.ceil(count / limit),
     currentPage: parseInt(page),
     data: appointments
-  });
+  }, 200);
 });
 
 // @desc    Get single appointment
@@ -135,6 +139,16 @@ exports.createAppointment = asyncHandler(async (req, res, next) => {
   // Generate a unique slot identifier for this provider/date/time combination
   const slotKey = `${req.body.provider}_${req.body.date}_${req.body.startTime}`;
 
+  // Lock the slot's cells: excludes portal holds and concurrent staff bookings
+  const slotLock = await slotHolds.lock(req.body, req.user.id);
+  if (slotLock.status === 'taken') {
+    return res.status(409).json({
+      success: false,
+      error: 'Ce créneau est en cours de réservation (portail patient ou autre poste). Veuillez réessayer.',
+      code: 'SLOT_HELD'
+    });
+  }
+
   let appointment;
   try {
     // Try to create with optimistic concurrency
@@ -179,6 +193,8 @@ exports.createAppointment = asyncHandler(async (req, res, next) => {
       });
     }
     throw err;
+  } finally {
+    await slotHolds.unlock(slotLock, req.user.id);
   }
 
   // Update patient's next appointment
@@ -369,6 +385,9 @@ exports.cancelAppointment = asyncHandler(async (req, res, next) => {
     appointment: appointment
   });
 
+  // Offer the freed slot to the waiting list (runs in the background)
+  waitlistBackfill.slotFreed(appointment, 'cancelled');
+
   return success(res, { data: appointment, message: 'Appointment cancelled successfully' });
 });
 
@@ -799,11 +818,11 @@ exports.getTodaysAppointments = asyncHandler(async (req, res, next) => {
     noShow: appointments.filter(a => a.status === 'no-show').length
   };
 
-  res.status(200).json({
+  return sendSerialized(res, serializers.appointmentDay, {
     success: true,
     stats,
     data: appointments
-  });
+  }, 200);
 });
 
 // @desc    Reschedule appointment
@@ -821,6 +840,7 @@ exports.rescheduleAppointment = asyncHandler(async (req, res, next) => {
   // Store old date/time for rescheduling record
   const oldDate = appointment.date;
   const oldTime = appointment.startTime;
+  const oldEndTime = appointment.endTime;
 
   // Update appointment
   appointment.date = date;
@@ -847,6 +867,11 @@ exports.rescheduleAppointment = asyncHandler(async (req, res, next) => {
 
   await appointment.save();
 
+  // The previous slot is free now: offer it to the waiting list
+  if (oldTime !== appointment.startTime || new Date(oldDate).getTime() !== new Date(appointment.date).getTime()) {
+    waitlistBackfill.slotFreed(appointment, 'rescheduled', { date: oldDate, startTime: oldTime, endTime: oldEndTime });
+  }
+
   return success(res, { data: appointment, message: 'Appointment rescheduled successfully' });
 });
 
@@ -1379,6 +1404,34 @@ exports.removeFromWaitingList = asyncHandler(async (req, res, next) => {
   return success(res, { data: null, message: 'Removed from waiting list' });
 });
 
+// @desc    Record a patient's answer to a freed-slot offer
+// @route   POST /api/appointments/waiting-list/:id/offers/:offerId/respond
+// @access  Private
+exports.respondToWaitingListOffer = asyncHandler(async (req, res, next) => {
+  if (typeof req.body.accept !== 'boolean') {
+    return error(res, { statusCode: 400, error: 'accept (boolean) is required', code: 'BAD_REQUEST' });
+  }
+
+  const result = await waitlistBackfill.respond(req.params.id, req.params.offerId, req.body.accept);
+
+  switch (result.status) {
+    case 'booked':
+      return success(res, { data: result.appointment, message: 'Slot booked from waiting list' });
+    case 'declined':
+      return success(res, { data: null, message: 'Offer declined, patient stays on the waiting list' });
+    case 'not-found':
+      return notFound(res, 'Waiting list offer');
+    case 'taken':
+      return error(res, { statusCode: 409, error: 'Slot already taken by another patient', code: 'SLOT_TAKEN' });
+    case 'expired':
+      return error(res, { statusCode: 409, error: 'Offer has expired', code: 'OFFER_EXPIRED' });
+    case 'already-responded':
+      return error(res, { statusCode: 409, error: `Offer already answered (${result.response || 'responded'})`, code: 'OFFER_ANSWERED' });
+    default:
+      return error(res, { statusCode: 409, error: 'Slot is no longer available', code: 'SLOT_UNAVAILABLE' });
+  }
+});
+
 // @desc    Get appointment types
 // @route   GET /api/appointments/types
 // @access  Private
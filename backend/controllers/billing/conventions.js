@@ -1,8 +1,8 @@
 const Invoice = require('../../models/Invoice');
 const Company = require('../../models/Company');
-const ConventionFeeSchedule = require('../../models/ConventionFeeSchedule');
 const Approval = require('../../models/Approval');
 const currencyService = require('../../services/currencyService');
+const priceBookService = require('../../services/priceBookService');
 const { asyncHandler } = require('../../middleware/errorHandler');
 
 const { createContextLogger } = require('../../utils/structuredLogger');
@@ -358,7 +358,7 @@ exports.getConventionPrice = asyncHandler(async (req, res) => {
     });
   }
 
-  const priceInfo = await ConventionFeeSchedule.getPriceForCompanyAndCode(companyId, code);
+  const priceInfo = await priceBookService.getCompanyPrice(companyId, code);
 
   // Get exchange rate for USD display
   let priceUSD = null;
@@ -4,10 +4,14 @@ const paymentGateway = require('../../services/paymentGateway');
 const currencyService = require('../../services/currencyService');
 const { asyncHandler } = require('../../middleware/errorHandler');
 const { atomicMultiInvoicePayment, atomicRefund } = require('../../utils/transactions');
+const bulkInvoiceService = require('../../services/bulkInvoiceService');
 const {
   validateAmount,
   roundToDecimals
 } = require('../../utils/financialValidation');
+const { createContextLogger } = require('../../utils/structuredLogger');
+
+const log = createContextLogger('Payments');
 
 // =====================
 // PAYMENT ADJUSTMENTS
@@ -1186,147 +1190,12 @@ exports.bulkGenerateInvoices = asyncHandler(async (req, res) => {
     });
   }
 
-  const results = {
-    success: [],
-    failed: [],
-    skipped: []
-  };
-
-  // Process visits
-  if (visitIds && visitIds.length > 0) {
-    const Visit = require('../../models/Visit');
-
-    for (const visitId of visitIds) {
-      try {
-        const visit = await Visit.findById(visitId).populate('patient');
-
-        if (!visit) {
-          results.failed.push({ id: visitId, type: 'visit', error: 'Visit not found' });
-          continue;
-        }
-
-        // Check if invoice already exists for this visit
-        const existingInvoice = await Invoice.findOne({ visit: visitId });
-        if (existingInvoice && !options.allowDuplicates) {
-          results.skipped.push({
-            id: visitId,
-            type: 'visit',
-            reason: 'Invoice already exists',
-            invoiceId: existingInvoice.invoiceId
-          });
-          continue;
-        }
-
-        // Generate invoice from visit
-        const invoiceData = {
-          patient: visit.patient._id,
-          visit: visit._id,
-          items: visit.services?.map(service => ({
-            code: service.code || 'SERVICE',
-            description: service.name || service.description,
-            quantity: service.quantity || 1,
-            unitPrice: service.price || 0,
-            total: (service.quantity || 1) * (service.price || 0)
-          })) || [],
-          createdBy: req.user.id,
-          dateIssued: new Date(),
-          dueDate: new Date(Date.now() + 30 * 24 * 60 * 60 * 1000),
-          status: options.status || 'draft'
-        };
-
-        // Calculate summary
-        const subtotal = invoiceData.items.reduce((sum, item) => sum + item.total, 0);
-        invoiceData.summary = {
-          subtotal,
-          discount: 0,
-          tax: 0,
-          total: subtotal,
-          amountPaid: 0,
-          amountDue: subtotal
-        };
-
-        const invoice = await Invoice.create(invoiceData);
-        results.success.push({
-          id: visitId,
-          type: 'visit',
-          invoiceId: invoice.invoiceId,
-          invoice: invoice._id
-        });
-
-      } catch (error) {
-        results.failed.push({ id: visitId, type: 'visit', error: error.message });
-      }
-    }
-  }
-
-  // Process appointments
-  if (appointmentIds && appointmentIds.length > 0) {
-    const Appointment = require('../../models/Appointment');
-
-const { createContextLogger } = require('../../utils/structuredLogger');
-const log = createContextLogger('Payments');
-
-    for (const appointmentId of appointmentIds) {
-      try {
-        const appointment = await Appointment.findById(appointmentId).populate('patient');
-
-        if (!appointment) {
-          results.failed.push({ id: appointmentId, type: 'appointment', error: 'Appointment not found' });
-          continue;
-        }
-
-        // Check if invoice already exists for this appointment
-        const existingInvoice = await Invoice.findOne({ appointment: appointmentId });
-        if (existingInvoice && !options.allowDuplicates) {
-          results.skipped.push({
-            id: appointmentId,
-            type: 'appointment',
-            reason: 'Invoice already exists',
-            invoiceId: existingInvoice.invoiceId
-          });
-          continue;
-        }
-
-        // Generate invoice from appointment
-        const invoiceData = {
-          patient: appointment.patient._id,
-          appointment: appointment._id,
-          items: [{
-            code: 'CONSULT',
-            description: appointment.type || 'Consultation',
-            quantity: 1,
-            unitPrice: appointment.fee || 0,
-            total: appointment.fee || 0
-          }],
-          createdBy: req.user.id,
-          dateIssued: new Date(),
-          dueDate: new Date(Date.now() + 30 * 24 * 60 * 60 * 1000),
-          status: options.status || 'draft'
-        };
-
-        const subtotal = invoiceData.items.reduce((sum, item) => sum + item.total, 0);
-        invoiceData.summary = {
-          subtotal,
-          discount: 0,
-          tax: 0,
-          total: subtotal,
-          amountPaid: 0,
-          amountDue: subtotal
-        };
-
-        const invoice = await Invoice.create(invoiceData);
-        results.success.push({
-          id: appointmentId,
-          type: 'appointment',
-          invoiceId: invoice.invoiceId,
-          invoice: invoice._id
-        });
+  // Set-based by default; options.mode === 'sequential' keeps the per-record path
+  const generate = options.mode === 'sequential'
+    ? bulkInvoiceService.generateSequential
+    : bulkInvoiceService.generateInvoices;
 
-      } catch (error) {
-        results.failed.push({ id: appointmentId, type: 'appointment', error: error.message });
-      }
-    }
-  }
+  const results = await generate({ visitIds, appointmentIds }, req.user.id, options);
 
   res.status(200).json({
     success: true,
@@ -1,119 +1,34 @@
+const mongoose = require('mongoose');
 const DocumentTemplate = require('../models/DocumentTemplate');
 const Patient = require('../models/Patient');
 const Visit = require('../models/Visit');
-const User = require('../models/User');
 const { asyncHandler } = require('../middleware/errorHandler');
-
-// Helper function to calculate age from date of birth
-const calculateAge = (dateOfBirth) => {
-  const today = new Date();
-  const birthDate = new Date(dateOfBirth);
-  let age = today.getFullYear() - birthDate.getFullYear();
-  const monthDiff = today.getMonth() - birthDate.getMonth();
-  if (monthDiff < 0 || (monthDiff === 0 && today.getDate() < birthDate.getDate())) {
-    age--;
-  }
-  return age;
-};
-
-// Helper function to format date in French format (DD/MM/YYYY)
-const formatDateFR = (date) => {
-  if (!date) return '';
-  const d = new Date(date);
-  const day = String(d.getDate()).padStart(2, '0');
-  const month = String(d.getMonth() + 1).padStart(2, '0');
-  const year = d.getFullYear();
-  return `${day}/${month}/${year}`;
-};
-
-// Helper function to auto-fill template with patient/visit data
-const autoFillTemplateData = async (template, patientId, visitId = null, userId = null, customData = {}) => {
-  const data = { ...customData };
-
-  // Fetch patient data if patientId provided
-  if (patientId) {
-    const patient = await Patient.findById(patientId);
-    if (patient) {
-      data.patientName = `${patient.firstName} ${patient.lastName}`;
-      data.patientFirstName = patient.firstName;
-      data.patientLastName = patient.lastName;
-      data.patientTitle = patient.gender === 'male' ? 'Monsieur' : 'Madame';
-      data.dateOfBirth = patient.dateOfBirth ? formatDateFR(patient.dateOfBirth) : '';
-      data.patientAge = patient.dateOfBirth ? calculateAge(patient.dateOfBirth) : '';
-      data.patientPhone = patient.phoneNumber || '';
-      data.patientEmail = patient.email || '';
-    }
+const templateEngine = require('../services/documentTemplateEngine');
+
+// Upper bound for one batch-generate request
+const MAX_BATCH_VISITS = 200;
+
+// Builds a generated-document entry for Visit.documents
+const toVisitDocument = (template, content, userId) => ({
+  name: template.name,
+  type: 'generated_document',
+  category: template.category,
+  content,
+  templateId: template.templateId,
+  generatedBy: userId,
+  generatedAt: new Date(),
+  metadata: {
+    templateName: template.name,
+    category: template.category,
+    subCategory: template.subCategory
   }
+});
 
-  // Fetch visit data if visitId provided
-  if (visitId) {
-    const visit = await Visit.findById(visitId)
-      .populate('patient')
-      .populate('primaryProvider')
-      .populate('examinations.refraction');
-
-    if (visit) {
-      // Visit basic info
-      data.visitDate = formatDateFR(visit.visitDate);
-      data.consultationDate = formatDateFR(visit.visitDate);
-
-      // Diagnoses
-      if (visit.diagnoses && visit.diagnoses.length > 0) {
-        data.diagnosis = visit.diagnoses[0].diagnosis || '';
-      }
-
-      // Refraction data if available
-      if (visit.examinations?.refraction) {
-        const refraction = visit.examinations.refraction;
-        data.vaOD = refraction.visualAcuity?.withoutCorrection?.right?.decimal || '0';
-        data.vaOG = refraction.visualAcuity?.withoutCorrection?.left?.decimal || '0';
-        data.vaODCorrected = refraction.visualAcuity?.withCorrection?.right?.decimal || '0';
-        data.vaOGCorrected = refraction.visualAcuity?.withCorrection?.left?.decimal || '0';
-      }
-
-      // IOP (intraocular pressure)
-      if (visit.vitalSigns?.iop) {
-        data.iopOD = visit.vitalSigns.iop.right || '0';
-        data.iopOG = visit.vitalSigns.iop.left || '0';
-      }
-    }
-  }
-
-  // Fetch user (doctor) data if userId provided
-  if (userId) {
-    const user = await User.findById(userId);
-    if (user) {
-      const title = user.gender === 'male' ? 'Mr' : 'Dr';
-      data.doctorName = `${title} ${user.firstName} ${user.lastName}`;
-      data.doctorFirstName = user.firstName;
-      data.doctorLastName = user.lastName;
-      data.doctorSpecialty = user.specialization || '';
-    }
-  }
-
-  // Add current date if not provided
-  if (!data.consultationDate) {
-    data.consultationDate = formatDateFR(new Date());
-  }
-
-  return data;
-};
-
-// Helper function to replace template variables
-const fillTemplate = (templateContent, data) => {
-  let filledContent = templateContent;
-
-  // Replace all {{variableName}} with actual values
-  Object.keys(data).forEach(key => {
-    const regex = new RegExp(`{{${key}}}`, 'g');
-    filledContent = filledContent.replace(regex, data[key] || '');
-  });
-
-  // Remove any remaining unfilled variables
-  filledContent = filledContent.replace(/{{.*?}}/g, '___________');
-
-  return filledContent;
-};
+// Usage counters for many templates in one write
+const recordUsage = (templates) => DocumentTemplate.updateMany(
+  { _id: { $in: templates.map(t => t._id) } },
+  { $inc: { usageCount: 1 }, $set: { lastUsed: new Date() } }
+);
 
 // @desc    Get all document templates
 // @route   GET /api/document-generation/templates
@@ -213,17 +128,13 @@ exports.previewTemplate = asyncHandler(async (req, res, _next) => {
 
   const { patientId, visitId, customData } = req.body;
 
-  // Auto-fill data from patient/visit
-  const autoFilledData = await autoFillTemplateData(
-    template,
-    patientId,
-    visitId,
-    req.user.id,
+  // Auto-fill data from patient/visit (only what the template uses)
+  const autoFilledData = await templateEngine.autoFill(
+    { patientId, visitId, userId: req.user.id, templates: [template] },
     customData || {}
   );
 
-  // Fill template
-  const filledContent = fillTemplate(template.content, autoFilledData);
+  const filledContent = templateEngine.render(template, autoFilledData);
 
   res.status(200).json({
     success: true,
@@ -267,17 +178,13 @@ exports.generateDocument = asyncHandler(async (req, res, _next) => {
     });
   }
 
-  // Auto-fill data
-  const autoFilledData = await autoFillTemplateData(
-    template,
-    patientId,
-    visitId,
-    req.user.id,
+  // Auto-fill data (only what the template uses)
+  const autoFilledData = await templateEngine.autoFill(
+    { patientId, visitId, userId: req.user.id, templates: [template] },
     customData || {}
   );
 
-  // Fill template
-  const filledContent = fillTemplate(template.content, autoFilledData);
+  const filledContent = templateEngine.render(template, autoFilledData);
 
   // Update template usage
   await template.recordUsage();
@@ -286,22 +193,7 @@ exports.generateDocument = asyncHandler(async (req, res, _next) => {
   if (saveToVisit && visitId) {
     const visit = await Visit.findById(visitId);
     if (visit) {
-      const document = {
-        name: template.name,
-        type: 'generated_document',
-        category: template.category,
-        content: filledContent,
-        templateId: template.templateId,
-        generatedBy: req.user.id,
-        generatedAt: new Date(),
-        metadata: {
-          templateName: template.name,
-          category: template.category,
-          subCategory: template.subCategory
-        }
-      };
-
-      visit.documents.push(document);
+      visit.documents.push(toVisitDocument(template, filledContent, req.user.id));
       await visit.save();
     }
   }
@@ -467,7 +359,7 @@ exports.bulkGenerateDocuments = asyncHandler(async (req, res, _next) => {
     });
   }
 
-  const visit = await Visit.findById(visitId).populate('patient');
+  const visit = await Visit.findById(visitId);
   if (!visit) {
     return res.status(404).json({
       success: false,
@@ -475,55 +367,37 @@ exports.bulkGenerateDocuments = asyncHandler(async (req, res, _next) => {
     });
   }
 
+  // All templates in one query; context loaded once for the whole pack
+  const validIds = templateIds.filter(id => mongoose.isValidObjectId(id));
+  const templates = await DocumentTemplate.find({ _id: { $in: validIds } });
+  const byId = new Map(templates.map(t => [String(t._id), t]));
+
+  const context = await templateEngine.loadContext(
+    { patientIds: [visit.patient], visitIds: [visitId], userId: req.user.id },
+    templateEngine.sourcesFor(templates)
+  );
+  const data = templateEngine.buildData(context, { patientId: visit.patient, visitId }, customData || {});
+
   const generatedDocuments = [];
   const errors = [];
+  const used = [];
 
-  // Generate each template
   for (const templateId of templateIds) {
-    try {
-      const template = await DocumentTemplate.findById(templateId);
-      if (!template) {
-        errors.push({ templateId, error: 'Template not found' });
-        continue;
-      }
-
-      // Auto-fill data
-      const autoFilledData = await autoFillTemplateData(
-        template,
-        visit.patient._id,
-        visitId,
-        req.user.id,
-        customData || {}
-      );
-
-      // Fill template
-      const filledContent = fillTemplate(template.content, autoFilledData);
-
-      // Add to visit
-      const document = {
-        name: template.name,
-        type: 'generated_document',
-        category: template.category,
-        content: filledContent,
-        templateId: template.templateId,
-        generatedBy: req.user.id,
-        generatedAt: new Date(),
-        metadata: {
-          templateName: template.name,
-          category: template.category,
-          subCategory: template.subCategory
-        }
-      };
+    const template = byId.get(String(templateId));
+    if (!template) {
+      errors.push({ templateId, error: 'Template not found' });
+      continue;
+    }
 
-      visit.documents.push(document);
+    try {
+      const filledContent = templateEngine.render(template, data);
+      visit.documents.push(toVisitDocument(template, filledContent, req.user.id));
       generatedDocuments.push({
         templateId: template.templateId,
         templateName: template.name,
         success: true
       });
-
-      // Update template usage
-      await template.recordUsage();
+      used.push(template);
     } catch (error) {
       errors.push({ templateId, error: error.message });
     }
@@ -531,6 +405,7 @@ exports.bulkGenerateDocuments = asyncHandler(async (req, res, _next) => {
 
   // Save visit with all generated documents
   await visit.save();
+  if (used.length > 0) await recordUsage(used);
 
   res.status(200).json({
     success: true,
@@ -543,6 +418,90 @@ exports.bulkGenerateDocuments = asyncHandler(async (req, res, _next) => {
   });
 });
 
+// @desc    Generate documents for many visits (e.g. a day's letters)
+// @route   POST /api/document-generation/batch-generate
+// @access  Private
+exports.batchGenerateDocuments = asyncHandler(async (req, res, _next) => {
+  const { visitIds, templateIds, customData, saveToVisit } = req.body;
+
+  if (!Array.isArray(visitIds) || visitIds.length === 0 ||
+      !Array.isArray(templateIds) || templateIds.length === 0) {
+    return res.status(400).json({
+      success: false,
+      error: 'Visit IDs and template IDs arrays are required'
+    });
+  }
+
+  if (visitIds.length > MAX_BATCH_VISITS) {
+    return res.status(400).json({
+      success: false,
+      error: `At most ${MAX_BATCH_VISITS} visits per batch`
+    });
+  }
+
+  const templates = await DocumentTemplate.find({
+    _id: { $in: templateIds.filter(id => mongoose.isValidObjectId(id)) }
+  });
+  if (templates.length === 0) {
+    return res.status(404).json({
+      success: false,
+      error: 'Template not found'
+    });
+  }
+
+  // One query per collection for every visit, patient and the doctor
+  const context = await templateEngine.loadContext(
+    { visitIds, userId: req.user.id },
+    templateEngine.sourcesFor(templates)
+  );
+
+  const results = [];
+  const updates = [];
+  for (const visitId of visitIds) {
+    const visit = context.visits.get(String(visitId));
+    if (!visit) {
+      results.push({ visitId, error: 'Visit not found' });
+      continue;
+    }
+
+    const data = templateEngine.buildData(context, { visitId }, customData || {});
+    const documents = templates.map(template => ({
+      template,
+      content: templateEngine.render(template, data)
+    }));
+
+    results.push({
+      visitId,
+      patientId: visit.patient,
+      documents: documents.map(({ template, content }) => ({
+        templateId: template.templateId,
+        templateName: template.name,
+        category: template.category,
+        content
+      }))
+    });
+
+    if (saveToVisit) {
+      updates.push({
+        updateOne: {
+          filter: { _id: visit._id },
+          update: { $push: { documents: { $each: documents.map(d => toVisitDocument(d.template, d.content, req.user.id)) } } }
+        }
+      });
+    }
+  }
+
+  if (updates.length > 0) await Visit.bulkWrite(updates, { ordered: false });
+  await recordUsage(templates);
+
+  res.status(200).json({
+    success: true,
+    message: `Generated documents for ${results.filter(r => !r.error).length} visits`,
+    count: results.length,
+    data: results
+  });
+});
+
 // ============================================================
 // SURGERY REPORT PDF GENERATION
 // ============================================================
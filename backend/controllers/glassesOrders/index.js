@@ -70,5 +70,11 @@ module.exports = {
   getExportData: qcLabController.getExportData,
   updateLabStatus: qcLabController.updateLabStatus,
   getPendingExport: qcLabController.getPendingExport,
-  getAwaitingFromLab: qcLabController.getAwaitingFromLab
+  getAwaitingFromLab: qcLabController.getAwaitingFromLab,
+
+  // Optical Lab Link (VCA)
+  transmitLabBatch: qcLabController.transmitLabBatch,
+  pollLabStatus: qcLabController.pollLabStatus,
+  getLabLinkStatus: qcLabController.getLabLinkStatus,
+  getLabTurnaround: qcLabController.getLabTurnaround
 };
@@ -19,6 +19,7 @@ const {
   notificationFacade,
   log
 } = require('./shared');
+const opticalLabLinkService = require('../../services/opticalLabLinkService');
 
 // ============================================
 // STATUS WORKFLOW (includes inventory management)
@@ -1228,6 +1229,105 @@ const getAwaitingFromLab = asyncHandler(async (req, res) => {
   });
 });
 
+// ============================================
+// OPTICAL LAB LINK (VCA, batched)
+// ============================================
+
+/**
+ * @desc    Transmit all pending orders to the lab in one VCA session
+ * @route   POST /api/glasses-orders/lab-link/transmit
+ * @access  Private
+ */
+const transmitLabBatch = asyncHandler(async (req, res) => {
+  if (!opticalLabLinkService.isConfigured()) {
+    return res.status(400).json({
+      success: false,
+      error: 'Optical lab link is not configured'
+    });
+  }
+
+  const { orderIds } = req.body;
+  const summary = await opticalLabLinkService.transmitPending({
+    orderIds: Array.isArray(orderIds) ? orderIds : undefined,
+    clinicId: req.clinicId,
+    userId: req.user._id || req.user.id
+  });
+
+  res.status(200).json({
+    success: true,
+    message: `${summary.sent} order(s) transmitted to lab`,
+    data: summary
+  });
+});
+
+/**
+ * @desc    Fetch lab status and job-completion messages and update orders
+ * @route   POST /api/glasses-orders/lab-link/poll
+ * @access  Private
+ */
+const pollLabStatus = asyncHandler(async (req, res) => {
+  if (!opticalLabLinkService.isConfigured()) {
+    return res.status(400).json({
+      success: false,
+      error: 'Optical lab link is not configured'
+    });
+  }
+
+  const summary = await opticalLabLinkService.pollStatus();
+
+  res.status(200).json({
+    success: true,
+    message: `${summary.updated} order(s) updated from lab status`,
+    data: summary
+  });
+});
+
+/**
+ * @desc    Get lab link configuration and last run results
+ * @route   GET /api/glasses-orders/lab-link/status
+ * @access  Private
+ */
+const getLabLinkStatus = asyncHandler(async (req, res) => {
+  const pendingCount = await GlassesOrder.countDocuments({
+    status: 'confirmed',
+    orderType: { $in: ['glasses', 'both'] },
+    'externalLab.exported': { $ne: true }
+  });
+
+  res.status(200).json({
+    success: true,
+    data: {
+      ...opticalLabLinkService.getStatus(),
+      pendingCount
+    }
+  });
+});
+
+/**
+ * @desc    Get lab turnaround statistics
+ * @route   GET /api/glasses-orders/lab-link/turnaround
+ * @access  Private
+ */
+const getLabTurnaround = asyncHandler(async (req, res) => {
+  const days = Math.min(parseInt(req.query.days, 10) || 90, 365);
+  const clinicId = req.clinicId ? new mongoose.Types.ObjectId(String(req.clinicId)) : undefined;
+  const stats = await opticalLabLinkService.getTurnaroundStats({ days, clinicId });
+
+  res.status(200).json({
+    success: true,
+    data: {
+      days,
+      labs: stats.map(s => ({
+        labName: s._id || 'External Lab',
+        jobs: s.jobs,
+        avgHours: Math.round(s.avgHours * 10) / 10,
+        minHours: s.minHours,
+        maxHours: s.maxHours
+      }))
+    }
+  });
+});
+
 // ============================================
 // HELPER FUNCTIONS FOR EXPORT FORMATS
 // ============================================
@@ -1410,5 +1510,11 @@ module.exports = {
   getExportData,
   updateLabStatus,
   getPendingExport,
-  getAwaitingFromLab
+  getAwaitingFromLab,
+
+  // Optical Lab Link
+  transmitLabBatch,
+  pollLabStatus,
+  getLabLinkStatus,
+  getLabTurnaround
 };
@@ -8,6 +8,7 @@ const {
   ReagentInventory
 } = require('../models/Inventory');
 const Clinic = require('../models/Clinic');
+const transferExecution = require('../services/transferExecutionService');
 const { asyncHandler } = require('../middleware/errorHandler');
 const { createContextLogger } = require('../utils/structuredLogger');
 const logger = createContextLogger('InventoryTransfer');
@@ -205,18 +206,19 @@ exports.createTransfer = asyncHandler(async (req, res) => {
     });
   }
 
-  // Validate and enrich items
+  const invalidType = items.find(item => !INVENTORY_MODELS[item.inventoryType]);
+  if (invalidType) {
+    return res.status(400).json({
+      success: false,
+      error: `Invalid inventory type: ${invalidType.inventoryType}`
+    });
+  }
+
+  // Validate and enrich items (all lines resolved in one query)
+  const resolved = await transferExecution.resolveLines(items);
   const enrichedItems = [];
   for (const item of items) {
-    const Model = INVENTORY_MODELS[item.inventoryType];
-    if (!Model) {
-      return res.status(400).json({
-        success: false,
-        error: `Invalid inventory type: ${item.inventoryType}`
-      });
-    }
-
-    const inventoryItem = await Model.findById(item.inventoryId);
+    const inventoryItem = resolved.get(String(item.inventoryId));
     if (!inventoryItem) {
       return res.status(400).json({
         success: false,
@@ -228,7 +230,8 @@ exports.createTransfer = asyncHandler(async (req, res) => {
     let productName, productSku, productDetails;
     switch (item.inventoryType) {
       case 'pharmacy':
-        productName = inventoryItem.medication?.genericName || inventoryItem.medication?.brandName;
+        productName = inventoryItem.medication?.genericName || inventoryItem.medication?.brandName ||
+          inventoryItem.genericName || inventoryItem.name;
         productDetails = `${inventoryItem.medication?.brandName || ''} ${inventoryItem.medication?.strength || ''}`.trim();
         break;
       case 'frame':
@@ -420,70 +423,22 @@ exports.shipTransfer = asyncHandler(async (req, res) => {
     });
   }
 
-  await transfer.ship(req.user.id, {
-    method,
-    trackingNumber,
-    carrier,
-    expectedDelivery,
-    notes
-  });
-
-  // Deduct stock from source inventory
-  const session = await mongoose.startSession();
+  // Deduct stock from source inventory with the status change, atomically
   try {
-    session.startTransaction();
-
-    for (const item of transfer.items) {
-      if (item.status !== 'approved' && item.status !== 'shipped') continue;
-
-      const Model = INVENTORY_MODELS[item.inventoryType];
-      if (!Model) continue;
-
-      const inventoryItem = await Model.findById(item.inventoryId).session(session);
-      if (!inventoryItem) continue;
-
-      const quantityToDeduct = item.approvedQuantity || item.requestedQuantity;
-
-      // Deduct from current stock
-      if (inventoryItem.inventory) {
-        inventoryItem.inventory.currentStock = Math.max(0,
-          (inventoryItem.inventory.currentStock || 0) - quantityToDeduct
-        );
-
-        // Update stock status
-        if (inventoryItem.inventory.currentStock <= 0) {
-          inventoryItem.inventory.status = 'out-of-stock';
-        } else if (inventoryItem.inventory.currentStock <= (inventoryItem.inventory.minimumStock || 0)) {
-          inventoryItem.inventory.status = 'low-stock';
-        }
-
-        // Add to transaction history
-        if (!inventoryItem.transactions) inventoryItem.transactions = [];
-        inventoryItem.transactions.push({
-          type: 'transfer-out',
-          quantity: quantityToDeduct,
-          date: new Date(),
-          performedBy: req.user.id,
-          reference: `Transfer ${transfer.transferNumber}`,
-          transferId: transfer._id,
-          notes: `Shipped to ${transfer.destination.name}`
-        });
-
-        await inventoryItem.save({ session });
-      }
-
-      // Update item status
-      item.status = 'shipped';
-    }
-
-    await transfer.save({ session });
-    await session.commitTransaction();
+    await transferExecution.ship(transfer, req.user.id, {
+      method,
+      trackingNumber,
+      carrier,
+      expectedDelivery,
+      notes
+    });
   } catch (error) {
-    await session.abortTransaction();
-    logger.error('Error deducting stock during ship', { error: error.message, transferId: transfer._id });
-    // Transfer is already marked as shipped, log error but don't fail
-  } finally {
-    session.endSession();
+    if (!error.shortages) throw error;
+    return res.status(409).json({
+      success: false,
+      error: error.message,
+      data: error.shortages
+    });
   }
 
   res.status(200).json({
@@ -522,111 +477,10 @@ exports.receiveTransfer = asyncHandler(async (req, res) => {
     }
   }
 
-  await transfer.receive(req.user.id, receivedItems);
-
-  if (notes) {
-    transfer.notes = notes;
-    await transfer.save();
-  }
-
-  // Add stock to destination inventory
-  const session = await mongoose.startSession();
-  try {
-    session.startTransaction();
-    const destinationClinicId = transfer.destination.clinic;
-
-    for (const item of transfer.items) {
-      // Only process items that were actually received
-      if (item.status !== 'received' && item.status !== 'partial') continue;
-
-      const receivedQty = item.receivedQuantity || item.approvedQuantity || item.requestedQuantity;
-      if (!receivedQty || receivedQty <= 0) continue;
-
-      const Model = INVENTORY_MODELS[item.inventoryType];
-      if (!Model) continue;
-
-      // Find or create inventory item at destination clinic
-      let destInventoryItem;
+  if (notes) transfer.notes = notes;
 
-      // Try to find existing inventory at destination by matching product
-      const sourceItem = await Model.findById(item.inventoryId).lean();
-      if (!sourceItem) continue;
-
-      // Build query to find matching item at destination
-      const matchQuery = { clinic: destinationClinicId };
-
-      switch (item.inventoryType) {
-        case 'pharmacy':
-          if (sourceItem.drug) {
-            matchQuery.drug = sourceItem.drug;
-          } else if (sourceItem.medication?.genericName) {
-            matchQuery['medication.genericName'] = sourceItem.medication.genericName;
-          }
-          break;
-        case 'frame':
-          matchQuery.sku = sourceItem.sku;
-          break;
-        case 'contactLens':
-          matchQuery.sku = sourceItem.sku;
-          break;
-        default:
-          matchQuery.sku = sourceItem.sku || sourceItem.name;
-      }
-
-      destInventoryItem = await Model.findOne(matchQuery).session(session);
-
-      if (destInventoryItem) {
-        // Add to existing inventory
-        destInventoryItem.inventory.currentStock =
-          (destInventoryItem.inventory.currentStock || 0) + receivedQty;
-
-        // Update stock status
-        if (destInventoryItem.inventory.currentStock > (destInventoryItem.inventory.minimumStock || 0)) {
-          destInventoryItem.inventory.status = 'in-stock';
-        }
-      } else {
-        // Create new inventory item at destination (copy from source)
-        const newItemData = { ...sourceItem };
-        delete newItemData._id;
-        delete newItemData.createdAt;
-        delete newItemData.updatedAt;
-
-        newItemData.clinic = destinationClinicId;
-        newItemData.inventory = {
-          currentStock: receivedQty,
-          minimumStock: sourceItem.inventory?.minimumStock || 5,
-          optimalStock: sourceItem.inventory?.optimalStock || 20,
-          status: 'in-stock',
-          lastRestocked: new Date()
-        };
-        newItemData.transactions = [];
-
-        destInventoryItem = new Model(newItemData);
-      }
-
-      // Add transaction history
-      if (!destInventoryItem.transactions) destInventoryItem.transactions = [];
-      destInventoryItem.transactions.push({
-        type: 'transfer-in',
-        quantity: receivedQty,
-        date: new Date(),
-        performedBy: req.user.id,
-        reference: `Transfer ${transfer.transferNumber}`,
-        transferId: transfer._id,
-        notes: `Received from ${transfer.source.name}`
-      });
-
-      await destInventoryItem.save({ session });
-    }
-
-    await session.commitTransaction();
-  } catch (error) {
-    await session.abortTransaction();
-    logger.error('Error adding stock during receive', { error: error.message, transferId: transfer._id });
-    // Transfer already marked as received, log error but don't fail
-  } finally {
-    session.endSession();
-  }
+  // Add stock to destination inventory with the status change, atomically
+  await transferExecution.receive(transfer, req.user.id, receivedItems);
 
   res.status(200).json({
     success: true,
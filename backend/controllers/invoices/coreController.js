@@ -14,7 +14,6 @@ const {
   Invoice,
   Patient,
   Visit,
-  FeeSchedule,
   Company,
   mongoose,
   asyncHandler,
@@ -31,6 +30,7 @@ const {
 
 // SECURITY: Clinic verification for multi-tenant data isolation
 const { verifyClinicOwnership } = require('../../middleware/clinicVerification');
+const priceBookService = require('../../services/priceBookService');
 
 // =====================================================
 // HELPER FUNCTIONS
@@ -70,6 +70,10 @@ async function validateItemsAgainstFeeSchedule(items, options = {}) {
   let hasWarnings = false;
   let hasErrors = false;
 
+  // Whole invoice priced against one compiled price book (no per-line query)
+  const priceBook = await priceBookService.getBook();
+  const now = new Date();
+
   for (const item of items) {
     const result = {
       description: item.description,
@@ -83,16 +87,7 @@ async function validateItemsAgainstFeeSchedule(items, options = {}) {
 
     // Try to find matching fee schedule item
     if (item.code) {
-      const feeItem = await FeeSchedule.findOne({
-        code: item.code.toUpperCase(),
-        active: true,
-        $or: [
-          { effectiveTo: { $exists: false } },
-          { effectiveTo: null },
-          { effectiveTo: { $gte: new Date() } }
-        ],
-        effectiveFrom: { $lte: new Date() }
-      });
+      const feeItem = priceBook.currentFee(item.code, now);
 
       if (feeItem) {
         result.feeSchedulePrice = feeItem.price;
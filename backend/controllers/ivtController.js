@@ -3,7 +3,7 @@ const Patient = require('../models/Patient');
 const Visit = require('../models/Visit');
 const Appointment = require('../models/Appointment');
 const Invoice = require('../models/Invoice');
-const FeeSchedule = require('../models/FeeSchedule');
+const priceBookService = require('../services/priceBookService');
 const { Inventory, PharmacyInventory } = require('../models/Inventory');
 const { logActionDirect: logAction, logCriticalOperationDirect: logCriticalOperation } = require('../middleware/auditLogger');
 const { asyncHandler } = require('../middleware/errorHandler');
@@ -80,22 +80,15 @@ exports.createIVTInjection = async (req, res) => {
     const medicationName = injectionData.medication?.name || 'Anti-VEGF';
 
     if (autoGenerateInvoice) {
-      procedureFeeSchedule = await FeeSchedule.findOne({
-        $or: [
-          { code: 'IVT' },
-          { aliases: 'IVT' },
-          { name: { $regex: /IVT|injection.*intravitréenne/i } }
-        ],
-        isActive: true
-      });
+      // Both prices from the compiled price book (no fee schedule queries)
+      const priceBook = await priceBookService.getBook();
+      const now = new Date();
+      const medicationPattern = new RegExp(medicationName.replace(/[.*+?^${}()|[\]\\]/g, '\\$&'), 'i');
 
-      medicationFeeSchedule = await FeeSchedule.findOne({
-        $or: [
-          { name: { $regex: new RegExp(medicationName.replace(/[.*+?^${}()|[\]\\]/g, '\\$&'), 'i') } },
-          { aliases: { $regex: new RegExp(medicationName.replace(/[.*+?^${}()|[\]\\]/g, '\\$&'), 'i') } }
-        ],
-        isActive: true
-      });
+      procedureFeeSchedule = priceBook.currentFee('IVT', now) ||
+        priceBook.findFee(fee => /IVT|injection.*intravitréenne/i.test(fee.name), now);
+
+      medicationFeeSchedule = priceBook.findFee(fee => medicationPattern.test(fee.name), now);
     }
 
     let inventoryItemId = null;
@@ -0,0 +1,115 @@
+const LabOrder = require('../models/LabOrder');
+const PurchaseOrder = require('../models/PurchaseOrder');
+const { Inventory } = require('../models/Inventory');
+const { asyncHandler } = require('../middleware/errorHandler');
+const labelPrintSpooler = require('../services/labelPrintSpooler');
+const {
+  generateLabOrderTubeLabels,
+  generateShelfLabel,
+  LABEL_TEMPLATES
+} = require('../services/labelPrintingService');
+const { success, error, notFound } = require('../utils/apiResponse');
+
+function submit(res, labels, options) {
+  if (!labelPrintSpooler.resolvePrinter(options.printer, options.kind)) {
+    return error(res, { statusCode: 503, error: 'No label printer configured (LABEL_PRINTERS)', code: 'NO_PRINTER' });
+  }
+  if (labels.length === 0) {
+    return error(res, { statusCode: 400, error: 'No labels to print', code: 'BAD_REQUEST' });
+  }
+  const job = labelPrintSpooler.submit(labels, options);
+  return success(res, { statusCode: 202, data: job, message: `${job.labelCount} label(s) queued on ${job.printer}` });
+}
+
+// @desc    Get label printers and their queues
+// @route   GET /api/labels/printers
+// @access  Private
+exports.getPrinters = asyncHandler(async (req, res) => {
+  return success(res, { data: labelPrintSpooler.getStatus() });
+});
+
+// @desc    Print the tube labels of a lab order as one job
+// @route   POST /api/labels/lab-orders/:id
+// @access  Private (Lab)
+exports.printLabOrderLabels = asyncHandler(async (req, res) => {
+  const order = await LabOrder.findById(req.params.id)
+    .populate('patient', 'firstName lastName dateOfBirth patientId');
+
+  if (!order || !order.patient) {
+    return notFound(res, 'Lab order');
+  }
+
+  const labels = generateLabOrderTubeLabels(order, order.patient);
+  return submit(res, labels, { printer: req.body.printer, kind: 'lab', reference: order.orderId });
+});
+
+// @desc    Print shelf labels for inventory items or a stock receipt
+// @route   POST /api/labels/shelf
+// @access  Private (Inventory)
+exports.printShelfLabels = asyncHandler(async (req, res) => {
+  const { itemIds, purchaseOrderId, printer } = req.body;
+  let ids = itemIds;
+  let reference = null;
+
+  if (purchaseOrderId) {
+    const purchaseOrder = await PurchaseOrder.findById(purchaseOrderId).select('poNumber items').lean();
+    if (!purchaseOrder) {
+      return notFound(res, 'Purchase order');
+    }
+    // One label per received line: the shelf each item went to
+    ids = purchaseOrder.items
+      .filter(item => item.inventoryItemId && item.quantityReceived > 0)
+      .map(item => item.inventoryItemId);
+    reference = purchaseOrder.poNumber;
+  }
+
+  if (!Array.isArray(ids) || ids.length === 0) {
+    return error(res, { statusCode: 400, error: 'itemIds or a received purchaseOrderId is required', code: 'BAD_REQUEST' });
+  }
+
+  const items = await Inventory.find({ _id: { $in: ids } })
+    .select('name sku barcode location')
+    .lean();
+
+  return submit(res, items.map(generateShelfLabel), { printer, kind: 'stock', reference });
+});
+
+// @desc    Print labels built by the client (templateId + data)
+// @route   POST /api/labels
+// @access  Private
+exports.printLabels = asyncHandler(async (req, res) => {
+  const { labels, printer, kind, reference } = req.body;
+
+  if (!Array.isArray(labels) || labels.some(label => !LABEL_TEMPLATES[label?.templateId] || typeof label.data !== 'object')) {
+    return error(res, { statusCode: 400, error: 'labels must be a list of { templateId, data, copies }', code: 'BAD_REQUEST' });
+  }
+
+  const copies = labels.map(label => ({ ...label, copies: Math.min(Math.max(parseInt(label.copies, 10) || 1, 1), 100) }));
+  return submit(res, copies, { printer, kind, reference });
+});
+
+// @desc    Get a print job
+// @route   GET /api/labels/jobs/:jobId
+// @access  Private
+exports.getJob = asyncHandler(async (req, res) => {
+  const job = labelPrintSpooler.getJob(req.params.jobId);
+  if (!job) {
+    return notFound(res, 'Print job');
+  }
+  return success(res, { data: job });
+});
+
+// @desc    Cancel a queued print job
+// @route   DELETE /api/labels/jobs/:jobId
+// @access  Private
+exports.cancelJob = asyncHandler(async (req, res) => {
+  const result = labelPrintSpooler.cancel(req.params.jobId);
+
+  if (result.cancelled) {
+    return success(res, { data: labelPrintSpooler.getJob(req.params.jobId), message: 'Print job cancelled' });
+  }
+  if (result.reason === 'not-found') {
+    return notFound(res, 'Print job');
+  }
+  return error(res, { statusCode: 409, error: `Print job is ${result.reason}`, code: 'JOB_NOT_CANCELLABLE' });
+});
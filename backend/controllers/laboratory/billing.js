@@ -1,7 +1,7 @@
 const { asyncHandler } = require('../../middleware/errorHandler');
 const Visit = require('../../models/Visit');
 const Invoice = require('../../models/Invoice');
-const FeeSchedule = require('../../models/FeeSchedule');
+const priceBookService = require('../../services/priceBookService');
 const LaboratoryTemplate = require('../../models/LaboratoryTemplate');
 const AuditLog = require('../../models/AuditLog');
 const mongoose = require('mongoose');
@@ -98,20 +98,15 @@ exports.generateLabInvoice = asyncHandler(async (req, res) => {
     });
   }
 
-  // Get pricing from FeeSchedule for each test
+  // Get pricing from FeeSchedule for each test (compiled price book, no per-test query)
+  const priceBook = await priceBookService.getBook();
+  const now = new Date();
   const invoiceItems = [];
   for (const test of testsToBill) {
     // Try to find fee schedule by test code
     let price = 0;
     if (test.testCode) {
-      const feeSchedule = await FeeSchedule.findOne({
-        code: test.testCode,
-        active: true,
-        $or: [
-          { effectiveTo: null },
-          { effectiveTo: { $gte: new Date() } }
-        ]
-      }).sort({ effectiveFrom: -1 });
+      const feeSchedule = priceBook.latestFee({ code: test.testCode }, now);
 
       if (feeSchedule) {
         price = feeSchedule.price;
@@ -120,15 +115,7 @@ exports.generateLabInvoice = asyncHandler(async (req, res) => {
 
     // If no fee schedule found by code, try by name
     if (price === 0 && test.testName) {
-      const feeSchedule = await FeeSchedule.findOne({
-        name: new RegExp(`^${test.testName}$`, 'i'),
-        category: 'laboratory',
-        active: true,
-        $or: [
-          { effectiveTo: null },
-          { effectiveTo: { $gte: new Date() } }
-        ]
-      }).sort({ effectiveFrom: -1 });
+      const feeSchedule = priceBook.latestFee({ name: test.testName, category: 'laboratory' }, now);
 
       if (feeSchedule) {
         price = feeSchedule.price;
@@ -281,6 +268,8 @@ exports.getUnbilledTests = asyncHandler(async (req, res) => {
     .select('laboratoryOrders visitDate')
     .lean();
 
+  const priceBook = await priceBookService.getBook();
+  const now = new Date();
   const unbilledTests = [];
   for (const visit of visits) {
     if (visit.laboratoryOrders) {
@@ -289,14 +278,7 @@ exports.getUnbilledTests = asyncHandler(async (req, res) => {
         // Get price from FeeSchedule
         let price = 0;
         if (test.testCode) {
-          const feeSchedule = await FeeSchedule.findOne({
-            code: test.testCode,
-            active: true,
-            $or: [
-              { effectiveTo: null },
-              { effectiveTo: { $gte: new Date() } }
-            ]
-          }).sort({ effectiveFrom: -1 });
+          const feeSchedule = priceBook.latestFee({ code: test.testCode }, now);
 
           if (feeSchedule) {
             price = feeSchedule.price;
@@ -304,15 +286,7 @@ exports.getUnbilledTests = asyncHandler(async (req, res) => {
         }
 
         if (price === 0 && test.testName) {
-          const feeSchedule = await FeeSchedule.findOne({
-            name: new RegExp(`^${test.testName}$`, 'i'),
-            category: 'laboratory',
-            active: true,
-            $or: [
-              { effectiveTo: null },
-              { effectiveTo: { $gte: new Date() } }
-            ]
-          }).sort({ effectiveFrom: -1 });
+          const feeSchedule = priceBook.latestFee({ name: test.testName, category: 'laboratory' }, now);
 
           if (feeSchedule) {
             price = feeSchedule.price;
@@ -5,7 +5,7 @@ const LaboratoryTemplate = require('../../models/LaboratoryTemplate');
 const Notification = require('../../models/Notification');
 const Visit = require('../../models/Visit');
 const Invoice = require('../../models/Invoice');
-const FeeSchedule = require('../../models/FeeSchedule');
+const priceBookService = require('../../services/priceBookService');
 const { generateUniqueBarcode } = require('./utils/barcodeGenerator');
 
 // ============================================
@@ -135,21 +135,17 @@ exports.createOrder = asyncHandler(async (req, res) => {
       // Build invoice items from tests
       const invoiceItems = [];
       let totalAmount = 0;
+      const priceBook = await priceBookService.getBook();
+      const now = new Date();
 
       for (const test of processedTests) {
-        // Try to find fee schedule for the test
+        // Try to find fee schedule for the test (by code, then exact lab test name)
         let price = test.price || 0;
         let serviceId = null;
 
         if (test.testCode) {
-          const feeSchedule = await FeeSchedule.findOne({
-            $or: [
-              { code: test.testCode },
-              { aliases: test.testCode },
-              { name: { $regex: new RegExp(test.testName, 'i') } }
-            ],
-            isActive: true
-          });
+          const feeSchedule = priceBook.latestFee({ code: test.testCode }, now) ||
+            priceBook.latestFee({ name: test.testName, category: 'laboratory' }, now);
 
           if (feeSchedule) {
             price = feeSchedule.price || 0;
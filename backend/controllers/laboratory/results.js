@@ -6,6 +6,7 @@ const LaboratoryTemplate = require('../../models/LaboratoryTemplate');
 const Notification = require('../../models/Notification');
 const AuditLog = require('../../models/AuditLog');
 const websocketService = require('../../services/websocketService');
+const labHistoryService = require('../../services/labHistoryService');
 
 const { createContextLogger } = require('../../utils/structuredLogger');
 const log = createContextLogger('Results');
@@ -844,15 +845,17 @@ exports.getPatientResults = asyncHandler(async (req, res) => {
   const query = { patient: req.params.patientId };
   if (req.query.status) query.status = req.query.status;
 
-  const total = await LabResult.countDocuments(query);
-  const results = await LabResult.find(query)
-    .populate('labOrder', 'orderId')
-    .populate('test.template')
-    .populate('verifiedBy', 'firstName lastName')
-    .sort({ performedAt: -1 })
-    .limit(limit * 1)
-    .skip((page - 1) * limit)
-    .lean();
+  const [total, results] = await Promise.all([
+    LabResult.countDocuments(query),
+    LabResult.find(query)
+      .populate('labOrder', 'orderId')
+      .populate('test.template')
+      .populate('verifiedBy', 'firstName lastName')
+      .sort({ performedAt: -1 })
+      .limit(limit * 1)
+      .skip((page - 1) * limit)
+      .lean()
+  ]);
 
   res.status(200).json({
     success: true,
@@ -876,18 +879,20 @@ exports.getPatientTrends = asyncHandler(async (req, res) => {
   const { patientId, testCode } = req.params;
   const { limit = 10, componentName } = req.query;
 
-  // Get historical results for this test
-  const results = await LabResult.find({
-    patient: patientId,
-    'test.testCode': testCode,
-    status: { $in: ['final', 'corrected', 'amended'] }
-  })
-    .select('resultId results performedAt test.testName')
-    .sort({ performedAt: -1 })
-    .limit(parseInt(limit))
-    .lean();
+  // Analyte history: one document instead of scanning every past result
+  const series = await labHistoryService.getAnalyteSeries(patientId, testCode, componentName);
+
+  const trendData = (series?.points || [])
+    .filter(point => point.value !== null && point.value !== undefined)
+    .slice(-parseInt(limit))
+    .map(point => ({
+      resultId: point.resultId,
+      date: point.at,
+      value: point.value,
+      flag: point.flag || 'normal'
+    }));
 
-  if (results.length === 0) {
+  if (trendData.length === 0) {
     return res.status(200).json({
       success: true,
       data: {
@@ -899,32 +904,6 @@ exports.getPatientTrends = asyncHandler(async (req, res) => {
     });
   }
 
-  // Extract trend data for charting
-  const trendData = results.reverse().map(result => {
-    let value = null;
-    let flag = 'normal';
-
-    // Handle component results or single result
-    if (componentName && result.results) {
-      const component = result.results.find(r => r.parameter === componentName);
-      if (component) {
-        value = component.numericValue || parseFloat(component.value);
-        flag = component.flag;
-      }
-    } else if (result.results && result.results.length > 0) {
-      const primary = result.results[0];
-      value = primary.numericValue || parseFloat(primary.value);
-      flag = primary.flag;
-    }
-
-    return {
-      resultId: result.resultId,
-      date: result.performedAt,
-      value,
-      flag
-    };
-  }).filter(d => d.value !== null);
-
   // Calculate delta from most recent to previous
   const deltas = [];
   for (let i = 1; i < trendData.length; i++) {
@@ -957,7 +936,7 @@ exports.getPatientTrends = asyncHandler(async (req, res) => {
     success: true,
     data: {
       testCode,
-      testName: results[0]?.test?.testName,
+      testName: series.testName,
       history: trendData,
       deltas,
       overallTrend,
@@ -969,90 +948,122 @@ exports.getPatientTrends = asyncHandler(async (req, res) => {
 
 /**
  * @desc    Calculate and attach delta to new result entry
+ *          Body: { patientId, testCode, currentValue, componentName }
+ *          or    { patientId, testCode, components: [{ parameter, value, unit }] } for a whole panel
  * @route   POST /api/laboratory/calculate-delta
  * @access  Private (Lab Tech)
  */
 exports.calculateDelta = asyncHandler(async (req, res) => {
-  const { patientId, testCode, currentValue, componentName } = req.body;
+  const { patientId, testCode, currentValue, componentName, components } = req.body;
 
-  if (!patientId || !testCode || currentValue === undefined) {
+  if (!patientId || !testCode || (currentValue === undefined && !Array.isArray(components))) {
     return res.status(400).json({
       success: false,
       error: 'Missing required: patientId, testCode, currentValue'
     });
   }
 
-  // Get most recent previous result
-  const previousResult = await LabResult.findOne({
-    patient: patientId,
-    'test.testCode': testCode,
-    status: { $in: ['final', 'corrected', 'amended'] }
-  })
-    .sort({ performedAt: -1 })
-    .lean();
-
-  if (!previousResult) {
-    return res.status(200).json({
-      success: true,
-      data: {
-        hasPrevious: false,
-        message: 'No previous result found for comparison'
-      }
+  // Whole panel: every component evaluated against one history read
+  if (Array.isArray(components)) {
+    const panel = await labHistoryService.getPanelDeltas({
+      patient: patientId,
+      test: { testCode },
+      results: components,
+      performedAt: new Date()
     });
+    return res.status(200).json({ success: true, data: panel });
   }
 
-  // Find previous value
-  let previousValue = null;
-  if (componentName && previousResult.results) {
-    const component = previousResult.results.find(r => r.parameter === componentName);
-    previousValue = component?.numericValue || parseFloat(component?.value);
-  } else if (previousResult.results && previousResult.results.length > 0) {
-    previousValue = previousResult.results[0].numericValue || parseFloat(previousResult.results[0].value);
-  }
+  const series = await labHistoryService.getAnalyteSeries(patientId, testCode, componentName);
+  const evaluation = labHistoryService.evaluateComponent({
+    parameter: componentName || series?.parameter,
+    testCode,
+    value: parseFloat(currentValue),
+    at: new Date()
+  }, series);
 
-  if (previousValue === null || isNaN(previousValue)) {
+  if (!evaluation.hasPrevious) {
     return res.status(200).json({
       success: true,
       data: {
         hasPrevious: false,
-        message: 'Previous result not numeric'
+        message: evaluation.reason
       }
     });
   }
 
-  const numericCurrent = parseFloat(currentValue);
-  const change = numericCurrent - previousValue;
-  const changePercent = ((change / previousValue) * 100).toFixed(1);
-
-  let trend = 'stable';
-  if (change > 0) trend = 'increasing';
-  else if (change < 0) trend = 'decreasing';
-
-  // Flag significant changes (>20% change)
-  const isSignificant = Math.abs(parseFloat(changePercent)) > 20;
+  const { previousValue, change, changePercent, trend } = evaluation;
 
   res.status(200).json({
     success: true,
     data: {
       hasPrevious: true,
       previousValue,
-      previousDate: previousResult.performedAt,
-      previousResultId: previousResult.resultId,
-      currentValue: numericCurrent,
+      previousDate: evaluation.previousAt,
+      previousResultId: evaluation.previousResultId,
+      currentValue: evaluation.value,
       change: change.toFixed(2),
-      changePercent: parseFloat(changePercent),
+      changePercent,
       trend,
-      isSignificant,
+      isSignificant: evaluation.isSignificant,
+      deltaFlag: !!evaluation.deltaFlag,
+      rateFlag: !!evaluation.rateFlag,
       delta: {
         previousValue,
-        change: parseFloat(change.toFixed(2)),
-        changePercent: parseFloat(changePercent),
+        change,
+        changePercent,
         trend
       }
     }
   });
 });
 
+/**
+ * @desc    Delta / rate-of-change checks for every component of a result
+ * @route   GET /api/laboratory/results/:id/delta-checks
+ * @access  Private
+ */
+exports.getResultDeltaChecks = asyncHandler(async (req, res) => {
+  const result = await LabResult.findById(req.params.id)
+    .select('resultId patient test results performedAt status')
+    .lean();
+
+  if (!result) {
+    return res.status(404).json({
+      success: false,
+      error: 'Lab result not found'
+    });
+  }
+
+  const panel = await labHistoryService.getPanelDeltas(result);
+
+  res.status(200).json({
+    success: true,
+    data: panel
+  });
+});
+
+/**
+ * @desc    Cumulative lab report (all tests, all dates) for a patient
+ * @route   GET /api/laboratory/cumulative/:patientId?testCodes=GLU,HBA1C&from=&to=
+ * @access  Private
+ */
+exports.getCumulativeReport = asyncHandler(async (req, res) => {
+  const { testCodes, from, to } = req.query;
+
+  const tests = await labHistoryService.getCumulativeReport(req.params.patientId, {
+    testCodes: testCodes ? String(testCodes).split(',').map(code => code.trim()).filter(Boolean) : undefined,
+    from,
+    to
+  });
+
+  res.status(200).json({
+    success: true,
+    count: tests.length,
+    data: tests
+  });
+});
+
 // ============================================
 // COMPLETED TESTS (Visit-embedded + Standalone)
 // ============================================
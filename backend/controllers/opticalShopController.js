@@ -5,8 +5,7 @@ const Prescription = require('../models/Prescription');
 const { Inventory, FrameInventory, OpticalLensInventory, ContactLensInventory } = require('../models/Inventory');
 const User = require('../models/User');
 const Company = require('../models/Company');
-const ConventionFeeSchedule = require('../models/ConventionFeeSchedule');
-const FeeSchedule = require('../models/FeeSchedule');
+const priceBookService = require('../services/priceBookService');
 const Invoice = require('../models/Invoice');
 const AuditLog = require('../models/AuditLog');
 const Clinic = require('../models/Clinic');
@@ -1598,7 +1597,7 @@ async function calculatePricing(order) {
 
   // Check convention fee schedule first
   if (conventionInfo.hasConvention && conventionInfo.opticalCovered) {
-    const conventionPrice = await ConventionFeeSchedule.getPriceForCompanyAndCode(
+    const conventionPrice = await priceBookService.getCompanyPrice(
       conventionInfo.company.id,
       lensCode
     );
@@ -1610,7 +1609,7 @@ async function calculatePricing(order) {
 
   // Fall back to standard prices if no convention price
   if (lensPrice === 0) {
-    const standardPrice = await FeeSchedule.getEffectivePriceForDate(lensCode, new Date());
+    const standardPrice = await priceBookService.getEffectivePrice(lensCode, new Date());
     if (standardPrice.found) {
       lensPrice = standardPrice.price * 2;
     } else {
@@ -1,6 +1,7 @@
 const { Inventory, PharmacyInventory } = require('../models/Inventory');
 const { escapeRegex } = require('../utils/sanitize');
 const { success, error: errorResponse, notFound, paginated, serverError } = require('../utils/apiResponse');
+const { serializers } = require('../utils/responseSchemas');
 const { findPatientByIdOrCode } = require('../utils/patientLookup');
 const { pharmacy: pharmacyLogger } = require('../utils/structuredLogger');
 const { INVENTORY, PAGINATION } = require('../config/constants');
@@ -88,7 +89,8 @@ exports.getInventory = async (req, res) => {
       return paginated(res, medications, {
         total,
         page: parseInt(page),
-        limit: parseInt(limit)
+        limit: parseInt(limit),
+        serializer: serializers.inventoryPage
       });
     }
 
@@ -195,7 +197,8 @@ exports.getInventory = async (req, res) => {
       total,
       page: parseInt(page),
       limit: parseInt(limit),
-      aggregated: true // Flag to indicate this is aggregated data
+      aggregated: true, // Flag to indicate this is aggregated data
+      serializer: serializers.inventoryPage
     });
   } catch (error) {
     pharmacyLogger.error('Error getting inventory', { error: error.message, stack: error.stack });
@@ -762,7 +765,7 @@ exports.searchMedications = async (req, res) => {
       ? results.filter(r => r.inStock)
       : results;
 
-    return success(res, { data: filteredResults });
+    return success(res, { data: filteredResults, serializer: serializers.medicationSearch });
   } catch (error) {
     pharmacyLogger.error('Error searching medications', { query: req.query.q, error: error.message, stack: error.stack });
     return serverError(res, 'Erreur lors de la recherche de médicaments');
@@ -3,7 +3,10 @@ const Appointment = require('../models/Appointment');
 const Prescription = require('../models/Prescription');
 const Invoice = require('../models/Invoice');
 const Visit = require('../models/Visit');
+const User = require('../models/User');
 const { asyncHandler } = require('../middleware/errorHandler');
+const slotHolds = require('../services/slotHoldService');
+const { toMinutes, toTime } = slotHolds;
 
 // Helper to get patient from user
 const getPatientFromUser = async (userId) => {
@@ -171,7 +174,107 @@ exports.getMyAppointments = asyncHandler(async (req, res) => {
   });
 });
 
-// @desc    Request a new appointment
+// Portal slots: provider, day and start time from the request, fixed length
+const slotFromRequest = ({ providerId, date, time }) => ({
+  provider: providerId,
+  date: date ? new Date(date) : null,
+  startTime: time,
+  endTime: toMinutes(time) === null ? null : toTime(toMinutes(time) + slotHolds.settings.gridMinutes)
+});
+
+// Hold a slot for the patient; without a provider (older clients), the first
+// active provider of the requested department at the patient's clinic who is
+// free at that time. 'unavailable' when that clinic has no such provider.
+const holdForPatient = async ({ providerId, department, date, time }, patient) => {
+  if (providerId) {
+    return slotHolds.hold(slotFromRequest({ providerId, date, time }), patient._id);
+  }
+  if (!date || toMinutes(time) === null) return { status: 'invalid' };
+  if (!patient.homeClinic) return { status: 'unavailable' };
+
+  const providers = await User.find({
+    role: { $in: ['doctor', 'ophthalmologist'] },
+    department: department || 'general',
+    clinics: patient.homeClinic,
+    isActive: true
+  })
+    .select('_id')
+    .sort('firstName lastName')
+    .lean();
+  if (providers.length === 0) return { status: 'unavailable' };
+
+  let result;
+  for (const provider of providers) {
+    result = await slotHolds.hold(slotFromRequest({ providerId: provider._id, date, time }), patient._id);
+    if (result.status !== 'taken') return result;
+  }
+  return result;
+};
+
+// @desc    Hold a slot while the patient completes the booking
+// @route   POST /api/portal/slot-holds
+// @access  Private (Patient)
+exports.holdSlot = asyncHandler(async (req, res) => {
+  const patient = await getPatientFromUser(req.user.id);
+
+  if (!patient) {
+    return res.status(400).json({
+      success: false,
+      error: 'No patient profile found for this user'
+    });
+  }
+
+  const result = await holdForPatient(req.body, patient);
+
+  if (result.status === 'invalid') {
+    return res.status(400).json({
+      success: false,
+      error: 'date and time are required'
+    });
+  }
+  if (result.status === 'unavailable') {
+    return res.status(409).json({
+      success: false,
+      error: 'No provider of this department is available at your clinic.',
+      code: 'NO_PROVIDER_AVAILABLE'
+    });
+  }
+  if (result.status === 'taken') {
+    return res.status(409).json({
+      success: false,
+      error: 'This slot has just been taken. Please choose another time.',
+      code: 'SLOT_TAKEN'
+    });
+  }
+
+  res.status(201).json({
+    success: true,
+    data: result.hold
+  });
+});
+
+// @desc    Release a held slot
+// @route   DELETE /api/portal/slot-holds/:holdId
+// @access  Private (Patient)
+exports.releaseSlotHold = asyncHandler(async (req, res) => {
+  const patient = await getPatientFromUser(req.user.id);
+
+  if (!patient) {
+    return res.status(400).json({
+      success: false,
+      error: 'No patient profile found for this user'
+    });
+  }
+
+  const released = await slotHolds.release(req.params.holdId, patient._id);
+
+  res.status(200).json({
+    success: true,
+    data: { released }
+  });
+});
+
+// @desc    Book an appointment (confirmed at once)
 // @route   POST /api/portal/appointments
 // @access  Private (Patient)
 exports.requestAppointment = asyncHandler(async (req, res) => {
@@ -184,48 +287,64 @@ exports.requestAppointment = asyncHandler(async (req, res) => {
     });
   }
 
-  const { date, time, type, reason, preferredProvider, department } = req.body;
-
-  // Generate appointment ID
-  const appointmentDate = new Date(date);
-  const year = appointmentDate.getFullYear();
-  const month = String(appointmentDate.getMonth() + 1).padStart(2, '0');
-  const day = String(appointmentDate.getDate()).padStart(2, '0');
-  const aptCount = await Appointment.countDocuments({
-    date: {
-      $gte: new Date(appointmentDate.setHours(0, 0, 0, 0)),
-      $lt: new Date(appointmentDate.setHours(23, 59, 59, 999))
+  const { holdId, date, time, type, reason, preferredProvider, department } = req.body;
+
+  // Booking without a prior hold (older clients): hold and convert in one go
+  let hold = holdId;
+  if (!hold) {
+    const result = await holdForPatient({ providerId: preferredProvider, department, date, time }, patient);
+    if (result.status === 'invalid') {
+      return res.status(400).json({
+        success: false,
+        error: 'holdId, or date and time, are required'
+      });
     }
-  });
-  const appointmentId = `APT${year}${month}${day}${String(aptCount + 1).padStart(4, '0')}`;
-
-  // Calculate end time (30 minutes after start)
-  const [hours, minutes] = time.split(':').map(Number);
-  const endHours = Math.floor((hours * 60 + minutes + 30) / 60);
-  const endMinutes = (hours * 60 + minutes + 30) % 60;
-  const endTime = `${String(endHours).padStart(2, '0')}:${String(endMinutes).padStart(2, '0')}`;
+    if (result.status === 'unavailable') {
+      return res.status(409).json({
+        success: false,
+        error: 'No provider of this department is available at your clinic.',
+        code: 'NO_PROVIDER_AVAILABLE'
+      });
+    }
+    if (result.status === 'taken') {
+      return res.status(409).json({
+        success: false,
+        error: 'This slot has just been taken. Please choose another time.',
+        code: 'SLOT_TAKEN'
+      });
+    }
+    hold = result.hold.holdId;
+  }
 
-  const appointment = await Appointment.create({
-    appointmentId,
-    patient: patient._id,
-    date: new Date(date),
-    startTime: time,
-    endTime,
+  const result = await slotHolds.convert(hold, patient._id, {
     type: type || 'consultation',
     reason: reason || 'Appointment request',
-    provider: preferredProvider || req.user.id, // Use requester if no provider specified
     department: department || 'general',
-    status: 'pending', // Needs staff confirmation
+    clinic: patient.homeClinic,
     priority: 'normal',
-    source: 'patient-portal',
-    notes: `Requested via patient portal: ${reason || ''}`,
+    notes: `Booked via patient portal: ${reason || ''}`,
     createdBy: req.user.id
   });
 
+  if (result.status === 'expired') {
+    return res.status(409).json({
+      success: false,
+      error: 'Your hold on this slot has expired. Please choose a time again.',
+      code: 'HOLD_EXPIRED'
+    });
+  }
+  if (result.status === 'taken') {
+    return res.status(409).json({
+      success: false,
+      error: 'This slot has just been taken. Please choose another time.',
+      code: 'SLOT_TAKEN'
+    });
+  }
+
   res.status(201).json({
     success: true,
-    message: 'Appointment request submitted successfully',
-    data: appointment
+    message: 'Appointment confirmed',
+    data: result.appointment
   });
 });
 
@@ -462,6 +581,13 @@ exports.getAvailableSlots = asyncHandler(async (req, res) => {
   const existingAppointments = await Appointment.find(query)
     .select('startTime endTime');
 
+  // Slots other patients (or reception, while saving) are holding
+  let heldTimes = new Set();
+  if (providerId) {
+    const patient = await getPatientFromUser(req.user.id);
+    heldTimes = await slotHolds.heldTimes(providerId, selectedDate, patient?._id);
+  }
+
   // Generate available slots (8am to 6pm, 30 min slots)
   const slots = [];
   const bookedTimes = existingAppointments.map(apt => apt.startTime);
@@ -469,7 +595,7 @@ exports.getAvailableSlots = asyncHandler(async (req, res) => {
   for (let hour = 8; hour < 18; hour++) {
     for (let min = 0; min < 60; min += 30) {
       const timeStr = `${hour.toString().padStart(2, '0')}:${min.toString().padStart(2, '0')}`;
-      if (!bookedTimes.includes(timeStr)) {
+      if (!bookedTimes.includes(timeStr) && !heldTimes.has(timeStr)) {
         slots.push({
           time: timeStr,
           available: true
@@ -29,6 +29,7 @@ const { findPatientByIdOrCode } = require('../../utils/patientLookup');
 const { createContextLogger } = require('../../utils/structuredLogger');
 const { PRESCRIPTION, PAGINATION } = require('../../config/constants');
 const websocketService = require('../../services/websocketService');
+const documentSigningService = require('../../services/documentSigningService');
 
 const log = createContextLogger('PrescriptionCore');
 
@@ -664,20 +665,11 @@ exports.signPrescription = asyncHandler(async (req, res) => {
     return error(res, 'Prescription is already signed');
   }
 
-  const updatedPrescription = await Prescription.findByIdAndUpdate(
-    req.params.id,
-    {
-      $set: {
-        'signature.prescriber.signed': true,
-        'signature.prescriber.signedAt': new Date(),
-        'signature.prescriber.signedBy': userId,
-        ...(prescription.status === 'pending' || prescription.status === 'draft'
-          ? { status: 'active' }
-          : {})
-      }
-    },
-    { new: true, runValidators: true }
-  ).populate('prescriber', 'firstName lastName specialization')
+  // A batch of one: same Merkle/Ed25519 format as the session signing endpoint
+  await documentSigningService.signPrescriptions(userId, [prescription]);
+
+  const updatedPrescription = await Prescription.findById(req.params.id)
+    .populate('prescriber', 'firstName lastName specialization')
     .populate('patient', 'firstName lastName dateOfBirth');
 
   log.info('Prescription signed', { prescriptionId: updatedPrescription.prescriptionId, status: updatedPrescription.status });
@@ -685,6 +677,63 @@ exports.signPrescription = asyncHandler(async (req, res) => {
   return success(res, { data: updatedPrescription, message: 'Prescription signed successfully' });
 });
 
+// @desc    Sign all selected documents with one signing operation
+// @route   POST /api/prescriptions/sign-batch
+// @access  Private (Doctor, Ophthalmologist, Admin)
+exports.signPrescriptionBatch = asyncHandler(async (req, res) => {
+  const { prescriptionIds = [], surgeryReportIds = [] } = req.body;
+  const userId = req.user._id || req.user.id;
+  const isAdmin = req.user.role === 'admin';
+
+  if (!Array.isArray(prescriptionIds) || !Array.isArray(surgeryReportIds)) {
+    return error(res, 'prescriptionIds and surgeryReportIds must be arrays');
+  }
+  if (prescriptionIds.length + surgeryReportIds.length === 0) {
+    return error(res, 'No documents selected for signing');
+  }
+
+  const SurgeryReport = require('../../models/SurgeryReport');
+  const [prescriptions, reports] = await Promise.all([
+    prescriptionIds.length
+      ? Prescription.find({ _id: { $in: prescriptionIds }, 'signature.prescriber.signed': { $ne: true } })
+      : [],
+    surgeryReportIds.length
+      ? SurgeryReport.find({
+        _id: { $in: surgeryReportIds },
+        status: 'finalized',
+        'digitalSignature.signature': { $exists: false }
+      })
+      : []
+  ]);
+
+  const ownPrescriptions = prescriptions.filter(rx => isAdmin || rx.prescriber.toString() === userId.toString());
+  const ownReports = reports.filter(report => isAdmin || report.surgeon?.toString() === userId.toString());
+
+  if (ownPrescriptions.length + ownReports.length === 0) {
+    return error(res, 'None of the selected documents can be signed by this user');
+  }
+
+  const { batch, results } = await documentSigningService.signBatch(userId, {
+    prescriptions: ownPrescriptions,
+    surgeryReports: ownReports
+  });
+
+  log.info('Signature batch applied', {
+    batchId: batch.batchId,
+    prescriptions: ownPrescriptions.length,
+    surgeryReports: ownReports.length
+  });
+
+  return success(res, {
+    data: {
+      batch,
+      signed: results.map(({ kind, ref }) => ({ kind, id: ref })),
+      skipped: prescriptionIds.length + surgeryReportIds.length - results.length
+    },
+    message: `${results.length} document(s) signed`
+  });
+});
+
 // @desc    Verify prescription
 // @route   POST /api/prescriptions/:id/verify
 // @access  Private
@@ -710,6 +759,13 @@ exports.verifyPrescription = asyncHandler(async (req, res) => {
     verificationResult.checks.refillsAvailable = prescription.medications[0].refills.remaining > 0;
   }
 
+  // Digitally signed prescriptions must still match what was signed
+  if (prescription.signature?.prescriber?.digital?.signature) {
+    const digital = await documentSigningService.verifyStoredSignature('prescription', prescription);
+    verificationResult.checks.digitalSignatureValid = digital.valid;
+    if (!digital.valid) verificationResult.digitalSignatureFailure = digital.reason;
+  }
+
   verificationResult.valid = Object.values(verificationResult.checks).every(check => check === true);
 
   prescription.verification = {
@@ -1672,22 +1728,51 @@ exports.generateQRCode = asyncHandler(async (req, res) => {
     verificationUrl: `${process.env.APP_URL || 'https://medflow.app'}/verify/${prescription._id}`
   };
 
+  // Signed prescriptions carry the claims, Merkle proof and batch signature
+  // so pharmacies can verify offline; unsigned ones keep the lookup URL
+  const signedPayload = documentSigningService.qrPayloadFor('prescription', prescription);
+  const qrText = signedPayload || JSON.stringify(qrData);
+  const verification = signedPayload ? 'offline-signature' : 'online-lookup';
+
   try {
     const QRCode = require('qrcode');
-    const qrCodeDataUrl = await QRCode.toDataURL(JSON.stringify(qrData));
+    const qrCodeDataUrl = await QRCode.toDataURL(qrText, signedPayload ? { errorCorrectionLevel: 'L' } : undefined);
 
     res.json({
       success: true,
-      data: { qrCode: qrCodeDataUrl, prescriptionData: qrData }
+      data: { qrCode: qrCodeDataUrl, prescriptionData: qrData, qrText, verification }
     });
   } catch (err) {
     res.json({
       success: true,
-      data: { qrCode: null, prescriptionData: qrData, message: 'QR code generation requires qrcode package' }
+      data: { qrCode: null, prescriptionData: qrData, qrText, verification, message: 'QR code generation requires qrcode package' }
     });
   }
 });
 
+// @desc    Public signing keys for offline QR verification
+// @route   GET /api/prescriptions/signing-keys
+// @access  Private
+exports.getSigningKeys = asyncHandler(async (req, res) => {
+  const trustList = await documentSigningService.getTrustList();
+  return success(res, { data: trustList });
+});
+
+// @desc    Verify a scanned prescription / surgery report QR code
+// @route   POST /api/prescriptions/verify-qr
+// @access  Private
+exports.verifyQrCode = asyncHandler(async (req, res) => {
+  const { qrText } = req.body;
+  if (!qrText) {
+    return error(res, 'qrText is required');
+  }
+
+  const trustList = await documentSigningService.getTrustList();
+  const result = documentSigningService.verifyQr(qrText, trustList.keys);
+
+  return success(res, { data: result });
+});
+
 // @desc    Send prescription to patient
 // @route   POST /api/prescriptions/:id/send-to-patient
 // @access  Private
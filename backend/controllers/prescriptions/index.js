@@ -32,6 +32,9 @@ module.exports = {
   // Signature & Verification
   signPrescription: coreController.signPrescription,
   verifyPrescription: coreController.verifyPrescription,
+  signPrescriptionBatch: coreController.signPrescriptionBatch,
+  getSigningKeys: coreController.getSigningKeys,
+  verifyQrCode: coreController.verifyQrCode,
 
   // Invoice
   createInvoiceForPrescription: coreController.createInvoiceForPrescription,
@@ -7,8 +7,10 @@ const mongoose = require('mongoose');
 const { asyncHandler } = require('../middleware/errorHandler');
 const websocketService = require('../services/websocketService');
 const notificationFacade = require('../services/notificationFacade');
+const patientFlow = require('../services/patientFlowService');
 const { getTodayRange, getDayRange } = require('../utils/dateUtils');
 const { success, error, notFound, paginated } = require('../utils/apiResponse');
+const { serializers } = require('../utils/responseSchemas');
 const { findPatientByIdOrCode } = require('../utils/patientLookup');
 const { queue: queueLogger } = require('../utils/structuredLogger');
 const { QUEUE, PAGINATION } = require('../config/constants');
@@ -162,7 +164,7 @@ exports.getCurrentQueue = asyncHandler(async (req, res, next) => {
     timestamp: new Date()
   };
 
-  return success(res, { data: responseData });
+  return success(res, { data: responseData, serializer: serializers.queueList });
 });
 
 // @desc    Add patient to queue
@@ -411,6 +413,11 @@ exports.addToQueue = asyncHandler(async (req, res, next) => {
     priority: appointment.priority
   });
 
+  // Free examination stations may take the new patient right away
+  if (appointment.department === 'ophthalmology') {
+    patientFlow.dispatchInBackground(appointment.clinic);
+  }
+
   return success(res, {
     data: {
       queueNumber: appointment.queueNumber,
@@ -1276,6 +1283,112 @@ exports.callPatient = asyncHandler(async (req, res) => {
   });
 });
 
+// @desc    Get examination station flow: stations, waiting patients, next assignments
+// @route   GET /api/queue/flow
+// @access  Private
+exports.getPatientFlow = asyncHandler(async (req, res) => {
+  if (!req.clinicId) {
+    return error(res, { statusCode: 400, error: 'Clinic context required. Please select a clinic.', code: 'CLINIC_REQUIRED' });
+  }
+
+  const overview = await patientFlow.getFlowOverview(req.clinicId);
+  return success(res, { data: overview });
+});
+
+// @desc    Reserve free stations for the recommended patients and call them
+// @route   POST /api/queue/flow/dispatch
+// @access  Private (Nurse, Technician)
+exports.dispatchPatientFlow = asyncHandler(async (req, res) => {
+  if (!req.clinicId) {
+    return error(res, { statusCode: 400, error: 'Clinic context required. Please select a clinic.', code: 'CLINIC_REQUIRED' });
+  }
+
+  const dispatched = await patientFlow.dispatch(req.clinicId);
+  return success(res, { data: dispatched, message: `${dispatched.length} patient(s) called to a station` });
+});
+
+// @desc    Patient arrived at a station
+// @route   POST /api/queue/flow/:id/start
+// @access  Private (Nurse, Technician, Doctor)
+exports.startFlowStation = asyncHandler(async (req, res) => {
+  const { roomId } = req.body;
+  if (!roomId) {
+    return error(res, { statusCode: 400, error: 'roomId is required', code: 'BAD_REQUEST' });
+  }
+
+  const result = await patientFlow.startStation(req.params.id, roomId, req.user.id);
+
+  switch (result.status) {
+    case 'started':
+      return success(res, { data: { station: result.station, flow: result.appointment.flow }, message: 'Station started' });
+    case 'not-found':
+      return notFound(res, 'Appointment');
+    case 'room-not-found':
+      return notFound(res, 'Room');
+    case 'room-busy':
+      return error(res, { statusCode: 409, error: 'Room is occupied by another patient', code: 'ROOM_BUSY' });
+    default:
+      return error(res, { statusCode: 409, error: 'Patient needs no station this room serves', code: 'NO_STATION' });
+  }
+});
+
+// @desc    Patient done at their station: free the room and call the next patients
+// @route   POST /api/queue/flow/:id/complete
+// @access  Private (Nurse, Technician, Doctor)
+exports.completeFlowStation = asyncHandler(async (req, res) => {
+  const result = await patientFlow.completeStation(req.params.id);
+
+  if (result.status === 'not-found') {
+    return notFound(res, 'Appointment');
+  }
+  if (result.status === 'not-at-station') {
+    return error(res, { statusCode: 409, error: 'Patient is not at a station', code: 'NOT_AT_STATION' });
+  }
+  return success(res, {
+    data: { station: result.station, remaining: result.remaining, dispatched: result.dispatched },
+    message: 'Station completed'
+  });
+});
+
+// @desc    Set the stations a visit still needs
+// @route   PUT /api/queue/flow/:id/stations
+// @access  Private (Doctor, Nurse)
+exports.updateFlowStations = asyncHandler(async (req, res) => {
+  const result = await patientFlow.updateStations(req.params.id, req.body.stations);
+
+  if (result.status === 'invalid') {
+    return error(res, {
+      statusCode: 400,
+      error: `stations must be a list of: ${Object.keys(patientFlow.STATIONS).join(', ')}`,
+      code: 'BAD_REQUEST',
+      details: result.invalid
+    });
+  }
+  if (result.status === 'not-found') {
+    return notFound(res, 'Appointment');
+  }
+  return success(res, { data: result.stations, message: 'Stations updated' });
+});
+
+// @desc    Replay a past day under the linear queues and the flow router
+// @route   GET /api/queue/flow/replay?date=YYYY-MM-DD
+// @access  Private (Reports)
+exports.replayPatientFlow = asyncHandler(async (req, res) => {
+  if (!req.clinicId) {
+    return error(res, { statusCode: 400, error: 'Clinic context required. Please select a clinic.', code: 'CLINIC_REQUIRED' });
+  }
+  const date = new Date(req.query.date);
+  if (!req.query.date || Number.isNaN(date.getTime())) {
+    return error(res, { statusCode: 400, error: 'date (YYYY-MM-DD) is required', code: 'BAD_REQUEST' });
+  }
+
+  const replay = await patientFlow.replayHistoricalDay(req.clinicId, date);
+  if (!replay) {
+    return notFound(res, 'Station flow history for this day');
+  }
+  return success(res, { data: replay });
+});
+
 // @desc    Get display board data
 // @route   GET /api/queue/display-board
 // @access  Public (for display screens)
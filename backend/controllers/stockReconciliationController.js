@@ -1,8 +1,32 @@
+const crypto = require('crypto');
 const StockReconciliation = require('../models/StockReconciliation');
+const stocktakeService = require('../services/stocktakeService');
 const { escapeRegex } = require('../utils/sanitize');
 const { createContextLogger } = require('../utils/structuredLogger');
 const log = createContextLogger('StockReconciliationController');
 
+const isStreamMode = reconciliation => reconciliation.countMode === 'stream';
+
+// Map a count from a handheld or count sheet to a stream scan; counts are additive
+const toScan = count => ({
+  itemId: count.itemId,
+  barcode: count.barcode,
+  quantity: count.quantity ?? count.physicalCount,
+  lotNumber: count.lotNumber || count.batchNumber,
+  location: count.location,
+  countedBy: count.countedBy,
+  deviceId: count.deviceId,
+  scannedAt: count.scannedAt,
+  // Clients send a stable scanId so queued re-sends are deduplicated; older
+  // clients without one are never treated as duplicates
+  scanId: count.scanId || crypto.randomUUID()
+});
+
+const sendServiceError = (res, error, message) => {
+  log.error(message, { error: error.message, stack: error.stack });
+  res.status(error.statusCode || 500).json({ success: false, error: error.message });
+};
+
 // Get all reconciliations with filtering
 exports.getReconciliations = async (req, res) => {
   try {
@@ -84,6 +108,7 @@ exports.createReconciliation = async (req, res) => {
   try {
     const reconciliation = new StockReconciliation({
       ...req.body,
+      countMode: req.body.countMode === 'items' ? 'items' : 'stream',
       initiatedBy: req.user._id,
       clinic: req.clinicId || req.body.clinic
     });
@@ -106,24 +131,42 @@ exports.startReconciliation = async (req, res) => {
       return res.status(404).json({ success: false, error: 'Reconciliation not found' });
     }
 
-    await reconciliation.start();
+    await reconciliation.start(req.user._id);
+
+    if (isStreamMode(reconciliation)) {
+      const snapshot = await stocktakeService.takeSnapshot(reconciliation);
+      return res.json({
+        success: true,
+        data: reconciliation,
+        snapshot: { takenAt: snapshot.takenAt, items: snapshot.items.length }
+      });
+    }
 
     res.json({ success: true, data: reconciliation });
   } catch (error) {
-    log.error('Error starting reconciliation', { error: error.message, stack: error.stack });
-    res.status(500).json({ success: false, error: error.message });
+    sendServiceError(res, error, 'Error starting reconciliation');
   }
 };
 
 // Add count for an item
 exports.addCount = async (req, res) => {
   try {
-    const reconciliation = await StockReconciliation.findById(req.params.id);
+    const mode = await StockReconciliation.findById(req.params.id).select('countMode').lean();
 
-    if (!reconciliation) {
+    if (!mode) {
       return res.status(404).json({ success: false, error: 'Reconciliation not found' });
     }
 
+    // Stream mode: append the scan; the reconciliation document is not loaded or saved
+    if (isStreamMode(mode)) {
+      const result = await stocktakeService.recordScans(req.params.id, [toScan(req.body)], {
+        userId: req.user._id,
+        deviceId: req.body.deviceId
+      });
+      return res.json({ success: true, data: result });
+    }
+
+    const reconciliation = await StockReconciliation.findById(req.params.id);
     const { itemId, physicalCount, countedBy, notes, location, batchNumber } = req.body;
 
     await reconciliation.addCount(
@@ -137,26 +180,36 @@ exports.addCount = async (req, res) => {
 
     res.json({ success: true, data: reconciliation });
   } catch (error) {
-    log.error('Error adding count', { error: error.message, stack: error.stack });
-    res.status(500).json({ success: false, error: error.message });
+    sendServiceError(res, error, 'Error adding count');
   }
 };
 
-// Bulk add counts
+// Bulk add counts (handheld sync / count sheet upload)
 exports.bulkAddCounts = async (req, res) => {
   try {
-    const reconciliation = await StockReconciliation.findById(req.params.id);
+    const mode = await StockReconciliation.findById(req.params.id).select('countMode').lean();
 
-    if (!reconciliation) {
+    if (!mode) {
       return res.status(404).json({ success: false, error: 'Reconciliation not found' });
     }
 
-    const { counts } = req.body;
+    const { counts, deviceId } = req.body;
 
     if (!counts || !Array.isArray(counts)) {
       return res.status(400).json({ success: false, error: 'Counts array is required' });
     }
 
+    // Stream mode: one insertMany for the whole upload; re-sent offline scans are ignored by scanId
+    if (isStreamMode(mode)) {
+      const result = await stocktakeService.recordScans(req.params.id, counts.map(toScan), {
+        userId: req.user._id,
+        deviceId
+      });
+      return res.json({ success: true, data: result });
+    }
+
+    const reconciliation = await StockReconciliation.findById(req.params.id);
+
     for (const count of counts) {
       await reconciliation.addCount(
         count.itemId,
@@ -170,8 +223,21 @@ exports.bulkAddCounts = async (req, res) => {
 
     res.json({ success: true, data: reconciliation });
   } catch (error) {
-    log.error('Error bulk adding counts', { error: error.message, stack: error.stack });
-    res.status(500).json({ success: false, error: error.message });
+    sendServiceError(res, error, 'Error bulk adding counts');
+  }
+};
+
+// Live variance from the count stream (stream mode)
+exports.getLiveVariance = async (req, res) => {
+  try {
+    const data = await stocktakeService.getLiveVariance(req.params.id, {
+      includeMatching: req.query.includeMatching === 'true',
+      refresh: req.query.refresh === 'true'
+    });
+
+    res.json({ success: true, data });
+  } catch (error) {
+    sendServiceError(res, error, 'Error fetching live variance');
   }
 };
 
@@ -184,12 +250,19 @@ exports.submitForReview = async (req, res) => {
       return res.status(404).json({ success: false, error: 'Reconciliation not found' });
     }
 
-    await reconciliation.submitForReview();
+    // Counting closes first: scans arriving from now on are refused, and
+    // the items reviewed are the counts applied later
+    await reconciliation.submitForReview(req.user._id);
+
+    if (isStreamMode(reconciliation)) {
+      await stocktakeService.materializeItems(reconciliation);
+      await reconciliation.save();
+      stocktakeService.closeSession(reconciliation._id);
+    }
 
     res.json({ success: true, data: reconciliation });
   } catch (error) {
-    log.error('Error submitting for review', { error: error.message, stack: error.stack });
-    res.status(500).json({ success: false, error: error.message });
+    sendServiceError(res, error, 'Error submitting for review');
   }
 };
 
@@ -202,7 +275,22 @@ exports.applyAdjustments = async (req, res) => {
       return res.status(404).json({ success: false, error: 'Reconciliation not found' });
     }
 
-    const { approvedBy, adjustmentNotes } = req.body;
+    const { approvedBy, adjustmentNotes, zeroUncounted } = req.body;
+
+    // Stream mode: every counted delta in one version-guarded Inventory.bulkWrite
+    if (isStreamMode(reconciliation)) {
+      const result = await stocktakeService.applyAdjustments(req.params.id, {
+        userId: approvedBy || req.user._id,
+        notes: adjustmentNotes,
+        zeroUncounted: zeroUncounted === true
+      });
+      return res.json({
+        success: true,
+        data: result.reconciliation,
+        adjusted: result.adjusted.length,
+        skipped: result.skipped
+      });
+    }
 
     await reconciliation.applyAdjustments(
       approvedBy || req.user._id,
@@ -211,8 +299,7 @@ exports.applyAdjustments = async (req, res) => {
 
     res.json({ success: true, data: reconciliation });
   } catch (error) {
-    log.error('Error applying adjustments', { error: error.message, stack: error.stack });
-    res.status(500).json({ success: false, error: error.message });
+    sendServiceError(res, error, 'Error applying adjustments');
   }
 };
 
@@ -226,6 +313,7 @@ exports.completeReconciliation = async (req, res) => {
     }
 
     await reconciliation.complete(req.user._id);
+    stocktakeService.closeSession(reconciliation._id);
 
     res.json({ success: true, data: reconciliation });
   } catch (error) {
@@ -246,6 +334,7 @@ exports.cancelReconciliation = async (req, res) => {
     reconciliation.status = 'cancelled';
     reconciliation.cancellationReason = req.body.reason;
     await reconciliation.save();
+    stocktakeService.closeSession(reconciliation._id);
 
     res.json({ success: true, data: reconciliation });
   } catch (error) {
@@ -8,6 +8,8 @@ const Prescription = require('../models/Prescription');
 const Document = require('../models/Document');
 const Room = require('../models/Room');
 const { Inventory, PharmacyInventory, SurgicalSupplyInventory } = require('../models/Inventory');
+const orSchedulingService = require('../services/orSchedulingService');
+const documentSigningService = require('../services/documentSigningService');
 const { withTransaction } = require('../utils/transactions');
 const { success, error, notFound, paginated } = require('../utils/apiResponse');
 const { findPatientByIdOrCode } = require('../utils/patientLookup');
@@ -267,7 +269,19 @@ exports.cancelCase = async (req, res) => {
     surgeryCase.updateStatus('cancelled', req.user._id, notes);
     await surgeryCase.save();
 
-    return success(res, { data: surgeryCase, message: 'Chirurgie annulée' });
+    // Propose waiting cases for the freed OR time (staff confirms via /optimizer/apply)
+    let backfill = null;
+    try {
+      backfill = await orSchedulingService.proposeBackfill(surgeryCase);
+    } catch (backfillErr) {
+      surgeryLogger.warn('OR backfill proposal failed', { error: backfillErr.message, caseId: id });
+    }
+
+    return success(res, {
+      data: surgeryCase,
+      message: 'Chirurgie annulée',
+      ...(backfill && { meta: { backfill } })
+    });
   } catch (err) {
     surgeryLogger.error('Error cancelling case', { error: err.message, stack: err.stack, caseId: req.params.id });
     return error(res, err.message);
@@ -789,6 +803,14 @@ exports.finalizeReport = async (req, res) => {
     report.finalize(req.user._id);
     await report.save();
 
+    // Digital signature for offline QR verification; finalization stands
+    // even if signing fails (the report can be signed later via sign-batch)
+    try {
+      await documentSigningService.signSurgeryReports(req.user._id, [report]);
+    } catch (signError) {
+      surgeryLogger.error('Surgery report digital signing failed', { reportId, error: signError.message });
+    }
+
     // AUTO-CREATE FOLLOW-UP APPOINTMENT if followUpDate is set
     let followUpAppointment = null;
     if (report.followUpDate) {
@@ -1439,6 +1461,80 @@ exports.getRoomSchedule = async (req, res) => {
   }
 };
 
+/**
+ * Propose a packed multi-day OR schedule for the awaiting-scheduling queue
+ */
+exports.optimizeSchedule = async (req, res) => {
+  try {
+    const { startDate, days, roomIds, caseIds, turnoverMinutes, includeWeekends } = req.body;
+    const clinicId = req.body.clinic || req.query.clinic || req.user.clinic;
+
+    const horizonDays = Math.min(Math.max(parseInt(days) || 5, 1), 30);
+    const plan = await orSchedulingService.planSchedule({
+      clinicId,
+      startDate: startDate ? new Date(startDate) : undefined,
+      days: horizonDays,
+      roomIds,
+      caseIds,
+      options: {
+        ...(turnoverMinutes !== undefined && { turnoverMinutes: parseInt(turnoverMinutes) }),
+        includeWeekends: includeWeekends === true
+      }
+    });
+
+    return success(res, { data: plan });
+  } catch (err) {
+    surgeryLogger.error('Error optimizing OR schedule', { error: err.message, stack: err.stack });
+    return error(res, err.message);
+  }
+};
+
+/**
+ * Apply accepted optimizer assignments (each slot is re-validated)
+ */
+exports.applyOptimizedSchedule = async (req, res) => {
+  try {
+    const { assignments } = req.body;
+
+    if (!Array.isArray(assignments) || assignments.length === 0) {
+      return error(res, 'Aucune affectation à appliquer');
+    }
+
+    const result = await orSchedulingService.applySchedule(assignments, req.user._id);
+
+    return success(res, {
+      data: result,
+      message: `${result.scheduled.length} chirurgie(s) programmée(s)`
+    });
+  } catch (err) {
+    surgeryLogger.error('Error applying OR schedule', { error: err.message, stack: err.stack });
+    return error(res, err.message);
+  }
+};
+
+/**
+ * Get backfill proposals for the OR time freed by a cancelled case
+ */
+exports.getBackfillProposals = async (req, res) => {
+  try {
+    const surgeryCase = await SurgeryCase.findById(req.params.id);
+    if (!surgeryCase) {
+      return notFound(res, 'Surgery');
+    }
+
+    if (surgeryCase.status !== 'cancelled') {
+      return error(res, 'Seuls les cas annulés libèrent un créneau');
+    }
+
+    const backfill = await orSchedulingService.proposeBackfill(surgeryCase);
+
+    return success(res, { data: backfill || { assignments: [], filledMinutes: 0 } });
+  } catch (err) {
+    surgeryLogger.error('Error getting backfill proposals', { error: err.message, stack: err.stack, caseId: req.params.id });
+    return error(res, err.message);
+  }
+};
+
 /**
  * Get all OR rooms for the clinic
  */
@@ -11,6 +11,7 @@ const TextSnippet = require('../models/TextSnippet');
 const { PharmacyInventory } = require('../models/Inventory');
 const { createContextLogger } = require('../utils/structuredLogger');
 const { serverError } = require('../utils/apiResponse');
+const catalogSnapshotService = require('../services/catalogSnapshotService');
 
 const logger = createContextLogger('TemplateCatalog');
 
@@ -1182,6 +1183,64 @@ exports.getTemplateCatalogStats = async (req, res) => {
   }
 };
 
+// ===== VERSIONED SNAPSHOT =====
+
+// @desc    Get the full reference-data snapshot (gzip, cached per version)
+// @route   GET /api/template-catalog/snapshot
+// @access  Private
+exports.getCatalogSnapshot = async (req, res) => {
+  try {
+    const { version, buffer } = await catalogSnapshotService.getCompressedSnapshot();
+    const etag = `"catalog-v${version}"`;
+
+    res.set('ETag', etag);
+    res.set('Cache-Control', 'private, no-cache');
+    res.set('Vary', 'Accept-Encoding');
+    res.set('X-Catalog-Version', String(version));
+
+    if (req.headers['if-none-match'] === etag) {
+      return res.status(304).end();
+    }
+
+    if (/\bgzip\b/.test(req.headers['accept-encoding'] || '')) {
+      res.set('Content-Encoding', 'gzip');
+      res.type('application/json');
+      return res.send(buffer);
+    }
+
+    return res.json(await catalogSnapshotService.getSnapshot());
+  } catch (error) {
+    logger.error('Error building catalog snapshot', { error: error.message });
+    return serverError(res, 'Erreur lors de la génération du catalogue');
+  }
+};
+
+// @desc    Get catalog changes since a client version
+// @route   GET /api/template-catalog/snapshot/delta?since=<version>
+// @access  Private
+exports.getCatalogDelta = async (req, res) => {
+  try {
+    const delta = await catalogSnapshotService.getDelta(req.query.since);
+    res.set('X-Catalog-Version', String(delta.version));
+    res.json({ success: true, data: delta });
+  } catch (error) {
+    logger.error('Error computing catalog delta', { error: error.message });
+    return serverError(res, 'Erreur lors de la synchronisation du catalogue');
+  }
+};
+
+// @desc    Get current catalog version and item counts
+// @route   GET /api/template-catalog/snapshot/version
+// @access  Private
+exports.getCatalogVersion = async (req, res) => {
+  try {
+    res.json({ success: true, data: await catalogSnapshotService.getStatus() });
+  } catch (error) {
+    logger.error('Error fetching catalog version', { error: error.message });
+    return serverError(res, 'Erreur lors de la synchronisation du catalogue');
+  }
+};
+
 // ===== TEXT SNIPPETS (Click-to-Build) =====
 
 // @desc    Get text snippets by category
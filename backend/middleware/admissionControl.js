@@ -0,0 +1,340 @@
+/**
+ * Admission Control Middleware
+ *
+ * Protects clinical latency in the single backend process by admitting work
+ * according to event-loop delay and in-flight requests, per request class:
+ * - critical: queue calls, check-ins, device/analyzer result ingestion -
+ *   always admitted
+ * - interactive (default): everyday screens - capped and queued only when
+ *   the process is overloaded
+ * - background: reports, exports, bulk documents, backups - limited
+ *   concurrency, queued when the loop is slowing down, shed when overloaded
+ *
+ * Requests that cannot be admitted wait in a bounded queue (per class, with
+ * a timeout); past that they get 503 with Retry-After. Event-loop delay is
+ * the p99 of perf_hooks.monitorEventLoopDelay over each sample interval.
+ *
+ * express-rate-limit (rateLimiter.js) still limits each client's request
+ * rate; this limits what the whole process takes on at once.
+ */
+
+const { monitorEventLoopDelay } = require('perf_hooks');
+
+const memoryWatchdog = require('../services/memoryWatchdog');
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('AdmissionControl');
+
+const REQUEST_CLASSES = ['critical', 'interactive', 'background'];
+
+const PRESSURE_LEVELS = ['normal', 'elevated', 'overloaded'];
+
+/**
+ * Path rules, first match wins (paths relative to /api; rules with methods
+ * only apply to those methods). Anything unmatched is interactive.
+ */
+const CLASS_RULES = [
+  // Clinical flow and device ingestion
+  { pattern: /^\/queue(\/|$)(?!analytics)/, requestClass: 'critical' },
+  { pattern: /^\/appointments\/[^/]+\/(check-in|checkin|start|complete)/, requestClass: 'critical' },
+  { pattern: /^\/(device-data|devices|lis|dicom|device-import)(\/|$)/, requestClass: 'critical' },
+  { pattern: /^\/lab-results(\/|$)/, requestClass: 'critical' },
+  { pattern: /^\/(rooms|clinical-alerts)(\/|$)/, requestClass: 'critical' },
+
+  // Reporting, exports and bulk work (report writes such as surgery reports stay interactive)
+  { pattern: /\/(reports?|statistics|analytics|aging-report|profit-margins)(\/|$)/, methods: ['GET'], requestClass: 'background' },
+  { pattern: /\/(export|pending-export)(\/|$)/, methods: ['GET'], requestClass: 'background' },
+  { pattern: /\/pdf(\/|$)/, methods: ['GET'], requestClass: 'background' },
+  { pattern: /^\/(document-generation|backups|migration|carevision|medicare|central)(\/|$)/, requestClass: 'background' },
+  { pattern: /^\/dashboard\/stats/, requestClass: 'background' }
+];
+
+// Seconds a shed client should wait before retrying
+const RETRY_AFTER_SECONDS = {
+  interactive: 5,
+  background: 30
+};
+
+// ============================================
+// CONFIGURATION
+// ============================================
+
+function loadSettings(env = process.env) {
+  return {
+    enabled: env.ADMISSION_CONTROL_ENABLED !== 'false',
+    elevatedLagMs: parseFloat(env.ADMISSION_LAG_ELEVATED_MS) || 50,
+    overloadedLagMs: parseFloat(env.ADMISSION_LAG_OVERLOADED_MS) || 200,
+    // In-flight requests (all classes) that count as overload by themselves
+    overloadedInFlight: parseInt(env.ADMISSION_OVERLOADED_IN_FLIGHT, 10) || 200,
+    backgroundConcurrency: parseInt(env.ADMISSION_BACKGROUND_CONCURRENCY, 10) || 2,
+    interactiveConcurrency: parseInt(env.ADMISSION_INTERACTIVE_CONCURRENCY, 10) || 32,
+    queueLimit: parseInt(env.ADMISSION_QUEUE_LIMIT, 10) || 50,
+    queueTimeoutMs: parseInt(env.ADMISSION_QUEUE_TIMEOUT_MS, 10) || 10000,
+    sampleIntervalMs: parseInt(env.ADMISSION_SAMPLE_INTERVAL_MS, 10) || 500
+  };
+}
+
+// ============================================
+// PURE HELPERS (exported for tests)
+// ============================================
+
+/**
+ * Request class of a request under /api
+ * @param {string} method - HTTP method
+ * @param {string} path - e.g. '/billing/reports/revenue'
+ * @param {Array} rules
+ * @returns {string}
+ */
+function classifyRequest(method, path, rules = CLASS_RULES) {
+  const verb = method === 'HEAD' ? 'GET' : method;
+  const rule = rules.find(candidate =>
+    (!candidate.methods || candidate.methods.includes(verb)) && candidate.pattern.test(path));
+  return rule ? rule.requestClass : 'interactive';
+}
+
+/**
+ * Pressure level from event-loop delay and in-flight requests
+ * @param {number} lagMs - Event-loop delay p99 of the last sample
+ * @param {number} inFlight - Requests currently executing
+ * @param {Object} settings
+ * @returns {string} normal | elevated | overloaded
+ */
+function pressureLevel(lagMs, inFlight, settings) {
+  if (lagMs >= settings.overloadedLagMs || inFlight >= settings.overloadedInFlight) return 'overloaded';
+  if (lagMs >= settings.elevatedLagMs) return 'elevated';
+  return 'normal';
+}
+
+/**
+ * Whether a request of a class may start now
+ * @param {string} requestClass
+ * @param {string} level - From pressureLevel()
+ * @param {Object} inFlight - Executing requests per class
+ * @param {Object} settings
+ * @returns {string} admit | wait | shed
+ */
+function admissionDecision(requestClass, level, inFlight, settings) {
+  if (requestClass === 'critical') return 'admit';
+
+  if (requestClass === 'interactive') {
+    if (level !== 'overloaded') return 'admit';
+    return inFlight.interactive < settings.interactiveConcurrency ? 'admit' : 'wait';
+  }
+
+  // Background
+  if (level === 'overloaded') return 'shed';
+  const limit = level === 'elevated' ? 1 : settings.backgroundConcurrency;
+  return inFlight.background < limit ? 'admit' : 'wait';
+}
+
+// ============================================
+// CONTROLLER
+// ============================================
+
+class AdmissionController {
+  constructor(settings = loadSettings()) {
+    this.settings = settings;
+    this.lagMs = 0;
+    this.level = 'normal';
+    this.inFlight = { critical: 0, interactive: 0, background: 0 };
+    // Waiting requests per class, oldest first
+    this.queues = { interactive: [], background: [] };
+    this.counters = {
+      admitted: { critical: 0, interactive: 0, background: 0 },
+      queued: { interactive: 0, background: 0 },
+      shed: { interactive: 0, background: 0 },
+      timedOut: { interactive: 0, background: 0 }
+    };
+    this.histogram = null;
+    this.sampleTimer = null;
+  }
+
+  /**
+   * Start sampling event-loop delay
+   */
+  start() {
+    if (this.sampleTimer || !this.settings.enabled) return;
+    this.histogram = monitorEventLoopDelay({ resolution: 10 });
+    this.histogram.enable();
+    this.sampleTimer = setInterval(() => this.sample(), this.settings.sampleIntervalMs);
+    this.sampleTimer.unref?.();
+    log.info('Admission control started', {
+      elevatedLagMs: this.settings.elevatedLagMs,
+      overloadedLagMs: this.settings.overloadedLagMs
+    });
+  }
+
+  stop() {
+    if (this.sampleTimer) {
+      clearInterval(this.sampleTimer);
+      this.sampleTimer = null;
+    }
+    if (this.histogram) {
+      this.histogram.disable();
+      this.histogram = null;
+    }
+  }
+
+  /**
+   * Read the event-loop delay of the last interval and re-evaluate waiters
+   */
+  sample() {
+    if (this.histogram) {
+      this.lagMs = this.histogram.percentile(99) / 1e6;
+      this.histogram.reset();
+    }
+    this.updateLevel();
+    this.drain();
+  }
+
+  totalInFlight() {
+    return this.inFlight.critical + this.inFlight.interactive + this.inFlight.background;
+  }
+
+  updateLevel() {
+    const level = pressureLevel(this.lagMs, this.totalInFlight(), this.settings);
+    if (level !== this.level) {
+      log[level === 'normal' ? 'info' : 'warn']('Admission pressure changed', {
+        from: this.level,
+        to: level,
+        lagMs: Math.round(this.lagMs),
+        inFlight: { ...this.inFlight },
+        waiting: this.queues.interactive.length + this.queues.background.length
+      });
+      this.level = level;
+    }
+    return level;
+  }
+
+  /**
+   * Express middleware, mounted on /api
+   */
+  middleware() {
+    return (req, res, next) => {
+      if (!this.settings.enabled) return next();
+
+      const requestClass = classifyRequest(req.method, req.path);
+      req.requestClass = requestClass;
+
+      const decision = admissionDecision(requestClass, this.updateLevel(), this.inFlight, this.settings);
+      if (decision === 'admit') return this.admit(requestClass, res, next);
+      if (decision === 'shed') return this.shed(requestClass, res, 'shed');
+      return this.enqueue(requestClass, req, res, next);
+    };
+  }
+
+  admit(requestClass, res, next) {
+    this.inFlight[requestClass]++;
+    this.counters.admitted[requestClass]++;
+
+    let released = false;
+    const release = () => {
+      if (released) return;
+      released = true;
+      this.inFlight[requestClass]--;
+      this.drain();
+    };
+    res.once('finish', release);
+    res.once('close', release);
+
+    next();
+  }
+
+  enqueue(requestClass, req, res, next) {
+    const queue = this.queues[requestClass];
+    if (queue.length >= this.settings.queueLimit) {
+      return this.shed(requestClass, res, 'shed');
+    }
+
+    const waiter = { requestClass, res, next };
+    waiter.timer = setTimeout(() => {
+      this.removeWaiter(waiter);
+      this.shed(requestClass, res, 'timedOut');
+    }, this.settings.queueTimeoutMs);
+
+    // Client gave up while waiting
+    waiter.onClose = () => {
+      clearTimeout(waiter.timer);
+      this.removeWaiter(waiter);
+    };
+    req.once('close', waiter.onClose);
+    waiter.req = req;
+
+    queue.push(waiter);
+    this.counters.queued[requestClass]++;
+  }
+
+  removeWaiter(waiter) {
+    const queue = this.queues[waiter.requestClass];
+    const index = queue.indexOf(waiter);
+    if (index !== -1) queue.splice(index, 1);
+  }
+
+  /**
+   * Admit waiting requests that now fit, interactive before background
+   */
+  drain() {
+    for (const requestClass of ['interactive', 'background']) {
+      const queue = this.queues[requestClass];
+      while (queue.length > 0) {
+        const decision = admissionDecision(requestClass, this.level, this.inFlight, this.settings);
+        if (decision === 'wait') break;
+
+        const waiter = queue.shift();
+        clearTimeout(waiter.timer);
+        waiter.req.off('close', waiter.onClose);
+        if (decision === 'shed') {
+          this.shed(requestClass, waiter.res, 'shed');
+        } else {
+          this.admit(requestClass, waiter.res, waiter.next);
+        }
+      }
+    }
+  }
+
+  shed(requestClass, res, reason) {
+    this.counters[reason][requestClass]++;
+    if (res.headersSent || res.writableEnded) return;
+
+    res.set('Retry-After', String(RETRY_AFTER_SECONDS[requestClass]));
+    res.status(503).json({
+      success: false,
+      error: requestClass === 'background'
+        ? 'Server busy with clinical activity. Please retry this report in a moment.'
+        : 'Server busy. Please try again in a few seconds.'
+    });
+  }
+
+  getStatus() {
+    return {
+      enabled: this.settings.enabled,
+      level: this.level,
+      eventLoopDelayP99Ms: Math.round(this.lagMs * 10) / 10,
+      inFlight: { ...this.inFlight },
+      waiting: {
+        interactive: this.queues.interactive.length,
+        background: this.queues.background.length
+      },
+      counters: JSON.parse(JSON.stringify(this.counters)),
+      thresholds: {
+        elevatedLagMs: this.settings.elevatedLagMs,
+        overloadedLagMs: this.settings.overloadedLagMs,
+        backgroundConcurrency: this.settings.backgroundConcurrency,
+        interactiveConcurrency: this.settings.interactiveConcurrency
+      }
+    };
+  }
+}
+
+const admissionControl = new AdmissionController();
+memoryWatchdog.register('admission:waiting', () =>
+  admissionControl.queues.interactive.length + admissionControl.queues.background.length);
+
+module.exports = admissionControl;
+module.exports.AdmissionController = AdmissionController;
+module.exports.REQUEST_CLASSES = REQUEST_CLASSES;
+module.exports.PRESSURE_LEVELS = PRESSURE_LEVELS;
+module.exports.CLASS_RULES = CLASS_RULES;
+module.exports.loadSettings = loadSettings;
+module.exports.classifyRequest = classifyRequest;
+module.exports.pressureLevel = pressureLevel;
+module.exports.admissionDecision = admissionDecision;
@@ -0,0 +1,179 @@
+/**
+ * Conditional GET Middleware
+ *
+ * Answers If-None-Match from a cheap version token declared by the route,
+ * before the controller runs. Express only computes its ETag from the
+ * finished body - after every query, populate, PHI decryption and
+ * serialization - so an unchanged client copy still costs the full request.
+ *
+ * Version sources (any value; arrays are joined):
+ * - a document's updatedAt/__v (documentVersion)
+ * - the count and latest updatedAt of a collection slice (sliceVersion)
+ * - the documents a response populates, by id (referencedVersion)
+ * - a change counter such as the catalog snapshot version
+ *
+ * The ETag hashes the version with the user, clinic and URL, so a tag issued
+ * to one user never validates another user's request. Place the middleware
+ * after authentication, permission checks and access logging: a 304 skips
+ * only the controller. A version function returning null (not found, wrong
+ * clinic) or throwing falls through to the controller unchanged.
+ *
+ * @example
+ * router.get('/:id', protect, logPatientDataAccess,
+ *   conditionalGet(req => documentVersion(Patient, { _id: req.params.id }), { name: 'patient' }),
+ *   getPatient);
+ */
+
+const crypto = require('crypto');
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('ConditionalGet');
+
+const CACHE_CONTROL = 'private, no-cache';
+
+// ============================================
+// PURE HELPERS (exported for tests)
+// ============================================
+
+/**
+ * Flatten a version value to a string token
+ * @param {*} value - Date, number, string, array of those, or null
+ * @returns {string|null} null when the route has no version for this request
+ */
+function versionToken(value) {
+  if (value === null || value === undefined) return null;
+  if (Array.isArray(value)) return value.map(part => versionToken(part) ?? '-').join(':');
+  if (value instanceof Date) return String(value.getTime());
+  if (typeof value === 'object') return JSON.stringify(value);
+  return String(value);
+}
+
+/**
+ * Weak ETag bound to the requester and the exact URL
+ * @param {string} name - Route name (readable prefix)
+ * @param {string} token - From versionToken()
+ * @param {Object} req - Express request
+ * @returns {string}
+ */
+function buildETag(name, token, req) {
+  const hash = crypto.createHash('sha1')
+    .update([
+      token,
+      req.user?._id?.toString() || '',
+      req.clinicId?.toString() || '',
+      req.originalUrl || req.url
+    ].join('\n'))
+    .digest('base64url')
+    .slice(0, 22);
+  return `W/"${name}-${hash}"`;
+}
+
+/**
+ * If-None-Match comparison (weak, per RFC 9110)
+ * @param {string} header - If-None-Match request header
+ * @param {string} etag
+ * @returns {boolean}
+ */
+function matchesETag(header, etag) {
+  if (!header) return false;
+  if (header.trim() === '*') return true;
+  const opaque = tag => tag.trim().replace(/^W\//, '');
+  const target = opaque(etag);
+  return header.split(',').some(tag => opaque(tag) === target);
+}
+
+// ============================================
+// VERSION SOURCES
+// ============================================
+
+/**
+ * Version of one document: updatedAt and __v
+ * @param {Model} Model - Mongoose model
+ * @param {Object} filter
+ * @param {string} [select] - Extra fields the caller needs (e.g. clinic for ownership)
+ * @returns {Promise<Object|null>} { version, doc } or null when not found
+ */
+async function documentVersion(Model, filter, select = '') {
+  const doc = await Model.findOne(filter).select(`updatedAt __v ${select}`.trim()).lean();
+  if (!doc) return null;
+  return { version: [doc.updatedAt, doc.__v ?? 0], doc };
+}
+
+/**
+ * Version of a collection slice: document count and latest updatedAt
+ * (the count catches deletions that leave the latest update unchanged)
+ * @param {Model} Model - Mongoose model
+ * @param {Object} filter
+ * @returns {Promise<Array>} [count, latestUpdatedAt]
+ */
+async function sliceVersion(Model, filter) {
+  const [count, latest] = await Promise.all([
+    Model.countDocuments(filter),
+    Model.findOne(filter).sort({ updatedAt: -1 }).select('updatedAt').lean()
+  ]);
+  return [count, latest?.updatedAt ? new Date(latest.updatedAt).getTime() : 0];
+}
+
+/**
+ * Version of the documents a response populates (users, companies, ...):
+ * a name changed on a referenced document changes the body too
+ * @param {Model} Model - Mongoose model
+ * @param {Array} ids - Referenced ids (empty values ignored)
+ * @returns {Promise<Array>} [count, latestUpdatedAt]
+ */
+async function referencedVersion(Model, ids) {
+  const unique = [...new Set(ids.filter(Boolean).map(String))];
+  if (unique.length === 0) return [0, 0];
+  return sliceVersion(Model, { _id: { $in: unique } });
+}
+
+// ============================================
+// MIDDLEWARE
+// ============================================
+
+/**
+ * Conditional GET for a read route
+ * @param {Function} getVersion - async (req) => version value, or null to skip
+ * @param {Object} options
+ * @param {string} options.name - ETag prefix, also used in logs
+ * @returns {Function} Express middleware
+ */
+function conditionalGet(getVersion, { name = 'v' } = {}) {
+  return async (req, res, next) => {
+    if (req.method !== 'GET' && req.method !== 'HEAD') return next();
+
+    let token;
+    try {
+      token = versionToken(await getVersion(req));
+    } catch (err) {
+      log.warn('Version lookup failed, serving full response', { route: name, error: err.message });
+      return next();
+    }
+    if (token === null) return next();
+
+    const etag = buildETag(name, token, req);
+    res.set('ETag', etag);
+    if (!res.get('Cache-Control')) res.set('Cache-Control', CACHE_CONTROL);
+
+    if (matchesETag(req.headers['if-none-match'], etag)) {
+      return res.status(304).end();
+    }
+
+    // Errors (403/404/500) must not carry the resource's tag
+    const writeHead = res.writeHead;
+    res.writeHead = function (statusCode, ...rest) {
+      if (statusCode >= 300 && statusCode !== 304) this.removeHeader('ETag');
+      return writeHead.call(this, statusCode, ...rest);
+    };
+
+    next();
+  };
+}
+
+module.exports = conditionalGet;
+module.exports.conditionalGet = conditionalGet;
+module.exports.documentVersion = documentVersion;
+module.exports.sliceVersion = sliceVersion;
+module.exports.referencedVersion = referencedVersion;
+module.exports.versionToken = versionToken;
+module.exports.buildETag = buildETag;
+module.exports.matchesETag = matchesETag;
@@ -313,7 +313,7 @@ const appointmentSchema = new mongoose.Schema({
   externalId: String, // ID from external system
   source: {
     type: String,
-    enum: ['web', 'mobile', 'phone', 'walk-in', 'referral', 'recurring'],
+    enum: ['web', 'mobile', 'phone', 'walk-in', 'referral', 'recurring', 'waitlist'],
     default: 'web'
   },
 
@@ -356,6 +356,57 @@ const appointmentSchema = new mongoose.Schema({
     index: true
   },
 
+  // Waiting-list backfill of this appointment's freed slot (waitlistBackfillService).
+  // status is claimed with conditional updates: the first acceptance books the slot.
+  backfill: {
+    status: {
+      type: String,
+      enum: ['offering', 'filled', 'exhausted']
+    },
+    slotKey: String,
+    startedAt: Date,
+    filledBy: {
+      type: mongoose.Schema.ObjectId,
+      ref: 'WaitingList'
+    },
+    filledAt: Date,
+    replacementAppointment: {
+      type: mongoose.Schema.ObjectId,
+      ref: 'Appointment'
+    }
+  },
+
+  // Examination-station flow (patientFlowService): stations the visit needs,
+  // pre-tests in any order and the doctor last. Empty until the first
+  // assignment; the appointment type's default route applies until then.
+  flow: {
+    stations: [{
+      _id: false,
+      station: {
+        type: String,
+        enum: ['autorefraction', 'tonometry', 'visual_field', 'oct', 'doctor']
+      },
+      status: {
+        type: String,
+        enum: ['pending', 'assigned', 'in_progress', 'done', 'skipped'],
+        default: 'pending'
+      },
+      room: {
+        type: mongoose.Schema.ObjectId,
+        ref: 'Room'
+      },
+      assignedAt: Date,
+      startedAt: Date,
+      completedAt: Date
+    }],
+    // Room reserved for the patient until they arrive
+    assignedRoom: {
+      type: mongoose.Schema.ObjectId,
+      ref: 'Room'
+    },
+    assignedAt: Date
+  },
+
   // Optimistic locking - prevents lost updates from concurrent modifications
   version: {
     type: Number,
@@ -400,6 +451,7 @@ appointmentSchema.index({ clinic: 1, patient: 1 }); // Clinic-scoped patient his
 // Additional compound indexes for common query patterns
 appointmentSchema.index({ clinic: 1, date: 1, status: 1 }); // Clinic appointments filtered by date then status
 appointmentSchema.index({ provider: 1, date: 1 }); // Provider schedule without status filter
+appointmentSchema.index({ clinic: 1, 'flow.stations.completedAt': 1 }); // Station duration history (patient flow)
 
 // Virtual for isToday
 appointmentSchema.virtual('isToday').get(function() {
@@ -1,4 +1,5 @@
 const mongoose = require('mongoose');
+const { catalogChangePlugin } = require('../utils/catalogChangeTracker');
 
 const clinicalTemplateSchema = new mongoose.Schema({
   category: {
@@ -50,4 +51,6 @@ const clinicalTemplateSchema = new mongoose.Schema({
 clinicalTemplateSchema.index({ category: 1, name: 1 });
 clinicalTemplateSchema.index({ name: 'text', value: 'text' });
 
+clinicalTemplateSchema.plugin(catalogChangePlugin, { catalog: 'clinical' });
+
 module.exports = mongoose.model('ClinicalTemplate', clinicalTemplateSchema);
@@ -1,4 +1,5 @@
 const mongoose = require('mongoose');
+const { catalogChangePlugin } = require('../utils/catalogChangeTracker');
 
 const commentTemplateSchema = new mongoose.Schema({
   category: {
@@ -72,4 +73,6 @@ commentTemplateSchema.statics.getMostUsed = async function(limit = 10) {
     .select('title text category usageCount');
 };
 
+commentTemplateSchema.plugin(catalogChangePlugin, { catalog: 'comments' });
+
 module.exports = mongoose.model('CommentTemplate', commentTemplateSchema);
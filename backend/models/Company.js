@@ -408,9 +408,18 @@ companySchema.pre('save', async function(next) {
     this.contract.status = 'expired';
   }
 
+  // Convention inheritance is compiled into the price book
+  this.$locals.parentConventionChanged = this.isModified('parentConvention');
+
   next();
 });
 
+companySchema.post('save', function() {
+  if (this.$locals.parentConventionChanged) {
+    require('../services/priceBookService').invalidate();
+  }
+});
+
 // Virtual for contract status display
 companySchema.virtual('contractStatusDisplay').get(function() {
   const statusMap = {
@@ -355,9 +355,22 @@ conventionFeeScheduleSchema.statics.bulkImportPrices = async function(companyId,
   schedule.updatedBy = userId;
   await schedule.save();
 
+  // Whole import lands in one compiled price book
+  invalidatePriceBook();
+
   return schedule;
 };
 
+// Compiled price book (lazy: priceBookService requires this model)
+function invalidatePriceBook() {
+  require('../services/priceBookService').invalidate();
+}
+
+conventionFeeScheduleSchema.post(
+  ['save', 'findOneAndUpdate', 'findOneAndDelete', 'updateOne', 'updateMany', 'deleteOne', 'deleteMany', 'insertMany'],
+  invalidatePriceBook
+);
+
 // Ensure virtuals are included
 conventionFeeScheduleSchema.set('toJSON', { virtuals: true });
 conventionFeeScheduleSchema.set('toObject', { virtuals: true });
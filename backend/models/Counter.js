@@ -55,6 +55,29 @@ counterSchema.statics.getNextSequence = async function(name) {
   return counter.sequence;
 };
 
+/**
+ * Reserve a contiguous block of sequence numbers atomically
+ * @param {String} name - Counter name/identifier
+ * @param {Number} count - Number of sequence numbers to reserve
+ * @returns {Number} - First sequence number of the block
+ */
+counterSchema.statics.reserveSequenceBlock = async function(name, count) {
+  const counter = await this.findByIdAndUpdate(
+    name,
+    {
+      $inc: { sequence: count },
+      $set: { lastUsed: new Date() }
+    },
+    {
+      new: true,
+      upsert: true,
+      setDefaultsOnInsert: true
+    }
+  );
+
+  return counter.sequence - count + 1;
+};
+
 /**
  * Get current sequence without incrementing
  * @param {String} name - Counter name/identifier
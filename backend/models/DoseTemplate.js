@@ -1,5 +1,6 @@
 const mongoose = require('mongoose');
 const Counter = require('./Counter');
+const { catalogChangePlugin } = require('../utils/catalogChangeTracker');
 
 const optionSchema = new mongoose.Schema({
   value: {
@@ -99,4 +100,6 @@ doseTemplateSchema.statics.getByForm = async function(form) {
   return await this.findOne({ medicationForm: form, isActive: true });
 };
 
+doseTemplateSchema.plugin(catalogChangePlugin, { catalog: 'doses' });
+
 module.exports = mongoose.model('DoseTemplate', doseTemplateSchema);
@@ -1,4 +1,5 @@
 const mongoose = require('mongoose');
+const { catalogChangePlugin } = require('../utils/catalogChangeTracker');
 
 // Based on equipment PDF - complete device catalog
 const equipmentCatalogSchema = new mongoose.Schema({
@@ -146,4 +147,6 @@ const equipmentCatalogSchema = new mongoose.Schema({
 equipmentCatalogSchema.index({ site: 1, category: 1 });
 equipmentCatalogSchema.index({ connectionStatus: 1 });
 
+equipmentCatalogSchema.plugin(catalogChangePlugin, { catalog: 'equipment' });
+
 module.exports = mongoose.model('EquipmentCatalog', equipmentCatalogSchema);
@@ -1,4 +1,5 @@
 const mongoose = require('mongoose');
+const { catalogChangePlugin } = require('../utils/catalogChangeTracker');
 
 const examinationTemplateSchema = new mongoose.Schema({
   category: {
@@ -73,4 +74,6 @@ examinationTemplateSchema.index({ name: 'text', description: 'text' });
 examinationTemplateSchema.index({ category: 1, name: 1 });
 examinationTemplateSchema.index({ code: 1 });
 
+examinationTemplateSchema.plugin(catalogChangePlugin, { catalog: 'examinations' });
+
 module.exports = mongoose.model('ExaminationTemplate', examinationTemplateSchema);
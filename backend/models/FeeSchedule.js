@@ -374,6 +374,9 @@ feeItemSchema.statics.createNewVersion = async function(code, newData, userId) {
 
   await newItem.save();
 
+  // Both versions are saved: next price lookup compiles a book with the new version
+  invalidatePriceBook();
+
   return newItem;
 };
 
@@ -624,8 +627,14 @@ feeItemSchema.statics.getPriceForClinic = async function(code, clinicId) {
 
 const cacheService = require('../services/cacheService');
 
+// Compiled price book (lazy: priceBookService requires this model)
+function invalidatePriceBook() {
+  require('../services/priceBookService').invalidate();
+}
+
 // Invalidate cache after save
 feeItemSchema.post('save', async (doc) => {
+  invalidatePriceBook();
   try {
     await cacheService.feeSchedule.invalidate(doc._id.toString());
   } catch (error) {
@@ -635,6 +644,7 @@ feeItemSchema.post('save', async (doc) => {
 
 // Invalidate cache after update
 feeItemSchema.post('findOneAndUpdate', async (doc) => {
+  invalidatePriceBook();
   try {
     if (doc) {
       await cacheService.feeSchedule.invalidate(doc._id.toString());
@@ -646,6 +656,7 @@ feeItemSchema.post('findOneAndUpdate', async (doc) => {
 
 // Invalidate cache after delete
 feeItemSchema.post('findOneAndDelete', async (doc) => {
+  invalidatePriceBook();
   try {
     if (doc) {
       await cacheService.feeSchedule.invalidate(doc._id.toString());
@@ -655,4 +666,7 @@ feeItemSchema.post('findOneAndDelete', async (doc) => {
   }
 });
 
+// Bulk writes (copyToClinic, imports) only need the price book rebuilt
+feeItemSchema.post(['updateOne', 'updateMany', 'deleteOne', 'deleteMany', 'insertMany'], invalidatePriceBook);
+
 module.exports = mongoose.model('FeeSchedule', feeItemSchema);
@@ -132,7 +132,19 @@ const glassesOrderSchema = new mongoose.Schema({
       sku: String,
       reservationId: String,
       costPrice: Number, // Captured at order time for margin tracking
-      sellingPrice: Number
+      sellingPrice: Number,
+      // Boxing measurements (mm) and tracer shape sent to the lab
+      tracing: {
+        hbox: Number,
+        vbox: Number,
+        dbl: Number,
+        fed: Number,
+        circumference: Number,
+        // Equally spaced radii (1/100 mm) of the right lens, counter-clockwise from 0°
+        radii: [Number],
+        tracedAt: Date,
+        tracer: String
+      }
     }
   },
 
@@ -292,7 +304,7 @@ const glassesOrderSchema = new mongoose.Schema({
     },
     exportFormat: {
       type: String,
-      enum: ['json', 'edi', 'xml', 'pdf', 'csv'],
+      enum: ['json', 'edi', 'xml', 'pdf', 'csv', 'vca'],
       default: 'json'
     },
 
@@ -302,6 +314,12 @@ const glassesOrderSchema = new mongoose.Schema({
     labEmail: String,
     labPhone: String,
 
+    // Lab link batch (VCA session or file drop) that transmitted the order
+    batchId: String,
+    // Batch currently transmitting the order (claimed before sending)
+    claimBatchId: String,
+    claimedAt: Date,
+
     // Tracking
     labOrderNumber: String,
     trackingNumber: String,
@@ -325,6 +343,10 @@ const glassesOrderSchema = new mongoose.Schema({
     estimatedArrival: Date,
     actualArrival: Date,
 
+    // Job completion reported by the lab (turnaround = completedAt - exportedAt)
+    completedAt: Date,
+    turnaroundHours: Number,
+
     // Export data snapshot (for audit)
     exportData: mongoose.Schema.Types.Mixed,
 
@@ -1033,6 +1055,7 @@ glassesOrderSchema.index({ exam: 1 });
 glassesOrderSchema.index({ status: 1 });
 glassesOrderSchema.index({ orderNumber: 1 });
 glassesOrderSchema.index({ 'frameTryOnPhotos.frameId': 1 });
+glassesOrderSchema.index({ 'externalLab.claimBatchId': 1 }, { sparse: true }); // Lab link batch claims
 
 // =====================================================
 // SOFT DELETE MIDDLEWARE
@@ -420,26 +420,26 @@ BaseInventorySchema.methods.releaseReservation = async function(quantity, refere
  * Update inventory status based on current stock levels
  */
 BaseInventorySchema.methods.updateInventoryStatus = function() {
-  const stock = this.inventory.currentStock || 0;
-  const min = this.inventory.minimumStock || 0;
-  const max = this.inventory.maximumStock || 1000;
-  const reorder = this.inventory.reorderPoint || 0;
-
-  if (this.discontinued) {
-    this.inventory.status = 'discontinued';
-  } else if (stock === 0) {
-    this.inventory.status = 'out_of_stock';
-  } else if (stock <= min || stock <= reorder) {
-    this.inventory.status = 'low_stock';
-  } else if (stock > max) {
-    this.inventory.status = 'overstocked';
-  } else {
-    this.inventory.status = 'in_stock';
-  }
-
+  this.inventory.status = this.constructor.computeInventoryStatus(this.inventory, this.discontinued);
   return this.inventory.status;
 };
 
+/**
+ * Stock status for given levels; shared with bulk writes that bypass save hooks
+ */
+BaseInventorySchema.statics.computeInventoryStatus = function(inventory = {}, discontinued = false) {
+  const stock = inventory.currentStock || 0;
+  const min = inventory.minimumStock || 0;
+  const max = inventory.maximumStock || 1000;
+  const reorder = inventory.reorderPoint || 0;
+
+  if (discontinued) return 'discontinued';
+  if (stock === 0) return 'out_of_stock';
+  if (stock <= min || stock <= reorder) return 'low_stock';
+  if (stock > max) return 'overstocked';
+  return 'in_stock';
+};
+
 /**
  * Add a new batch
  */
@@ -92,6 +92,14 @@ const inventoryTransferSchema = new mongoose.Schema({
     lotNumber: String,
     expirationDate: Date,
 
+    // Lots drawn at the source when shipped (recreated at the destination)
+    shippedBatches: [{
+      _id: false,
+      lotNumber: String,
+      expirationDate: Date,
+      quantity: Number
+    }],
+
     // Item-level status
     status: {
       type: String,
@@ -404,67 +412,19 @@ inventoryTransferSchema.methods.approve = async function(userId, approvedItems =
   return this.save();
 };
 
-// Method: Mark as shipped
-// CRITICAL FIX: Now actually deducts stock from source inventory
-inventoryTransferSchema.methods.ship = async function(userId, shippingInfo = {}) {
+// Method: Mark as shipped (in memory)
+// Stock is deducted by services/transferExecutionService in the same
+// transaction as the save; allocations are the lots drawn per line
+inventoryTransferSchema.methods.markShipped = function(userId, shippingInfo = {}, allocations = new Map()) {
   if (!['approved', 'partially-approved'].includes(this.status)) {
     throw new Error('Transfer must be approved before shipping');
   }
 
-  // Get inventory models from unified Inventory (using discriminators)
-  const {
-    PharmacyInventory,
-    FrameInventory,
-    ContactLensInventory,
-    LabConsumableInventory,
-    ReagentInventory
-  } = require('./Inventory');
-
-  const inventoryModels = {
-    PharmacyInventory,
-    FrameInventory,
-    ContactLensInventory,
-    LabConsumableInventory,
-    ReagentInventory
-  };
-
-  // Update shipped quantities and DEDUCT from source inventory
   for (const item of this.items) {
-    if (item.status === 'approved') {
-      item.shippedQuantity = item.approvedQuantity;
-      item.status = 'shipped';
-
-      // CRITICAL FIX: Actually deduct from source inventory
-      try {
-        const Model = inventoryModels[item.inventoryModel];
-        if (Model) {
-          const inventoryItem = await Model.findById(item.inventoryId);
-          if (inventoryItem) {
-            // Deduct from current stock
-            if (inventoryItem.inventory) {
-              inventoryItem.inventory.currentStock = Math.max(0,
-                (inventoryItem.inventory.currentStock || 0) - item.shippedQuantity
-              );
-            }
-            // Add transaction record if method exists
-            if (typeof inventoryItem.addTransaction === 'function') {
-              await inventoryItem.addTransaction({
-                type: 'transfer_out',
-                quantity: -item.shippedQuantity,
-                reference: this.transferNumber,
-                notes: `Transferred to ${this.destination.name || 'destination clinic'}`,
-                performedBy: userId
-              });
-            }
-            await inventoryItem.save();
-            console.log(`[TRANSFER] Deducted ${item.shippedQuantity} of ${item.productName} from source`);
-          }
-        }
-      } catch (invError) {
-        console.error('[TRANSFER] Error deducting from source inventory:', invError);
-        // Continue - don't fail the entire shipment
-      }
-    }
+    if (item.status !== 'approved') continue;
+    item.shippedQuantity = item.approvedQuantity ?? item.requestedQuantity;
+    item.shippedBatches = allocations.get(item._id.toString()) || [];
+    item.status = 'shipped';
   }
 
   this.status = 'in-transit';
@@ -484,33 +444,22 @@ inventoryTransferSchema.methods.ship = async function(userId, shippingInfo = {})
     notes: shippingInfo.notes
   });
 
-  return this.save();
+  return this;
 };
 
-// Method: Receive items
-// CRITICAL FIX: Now actually adds stock to destination inventory
-inventoryTransferSchema.methods.receive = async function(userId, receivedItems) {
+// Method: Mark as shipped
+inventoryTransferSchema.methods.ship = function(userId, shippingInfo = {}) {
+  return this.markShipped(userId, shippingInfo).save();
+};
+
+// Method: Record received items (in memory)
+// Stock is added by services/transferExecutionService in the same
+// transaction as the save
+inventoryTransferSchema.methods.markReceived = function(userId, receivedItems = []) {
   if (this.status !== 'in-transit') {
     throw new Error('Transfer must be in-transit to receive');
   }
 
-  // Get inventory models from unified Inventory (using discriminators)
-  const {
-    PharmacyInventory,
-    FrameInventory,
-    ContactLensInventory,
-    LabConsumableInventory,
-    ReagentInventory
-  } = require('./Inventory');
-
-  const inventoryModels = {
-    PharmacyInventory,
-    FrameInventory,
-    ContactLensInventory,
-    LabConsumableInventory,
-    ReagentInventory
-  };
-
   let allReceived = true;
 
   for (const item of this.items) {
@@ -523,62 +472,6 @@ inventoryTransferSchema.methods.receive = async function(userId, receivedItems)
       if (received.notes) item.notes = received.notes;
 
       if (item.status === 'partial') allReceived = false;
-
-      // CRITICAL FIX: Actually add to destination inventory
-      if (received.quantity > 0) {
-        try {
-          const Model = inventoryModels[item.inventoryModel];
-          if (Model) {
-            // Find or create inventory item at destination clinic
-            const destInventory = await Model.findOne({
-              clinic: this.destination.clinic,
-              $or: [
-                { 'product.sku': item.productSku },
-                { 'medication.name': item.productName },
-                { 'frame.sku': item.productSku },
-                { 'lens.sku': item.productSku },
-                { name: item.productName }
-              ]
-            });
-
-            if (destInventory) {
-              // Add to existing inventory
-              if (destInventory.inventory) {
-                destInventory.inventory.currentStock =
-                  (destInventory.inventory.currentStock || 0) + received.quantity;
-              }
-              // Add batch if lot number provided
-              if (item.lotNumber && typeof destInventory.addBatch === 'function') {
-                await destInventory.addBatch({
-                  lotNumber: item.lotNumber,
-                  quantity: received.quantity,
-                  expirationDate: item.expirationDate,
-                  source: 'transfer',
-                  transferNumber: this.transferNumber
-                }, userId);
-              }
-              // Add transaction record if method exists
-              if (typeof destInventory.addTransaction === 'function') {
-                await destInventory.addTransaction({
-                  type: 'transfer_in',
-                  quantity: received.quantity,
-                  reference: this.transferNumber,
-                  notes: `Received from ${this.source.name || 'source clinic'}`,
-                  performedBy: userId
-                });
-              }
-              await destInventory.save();
-              console.log(`[TRANSFER] Added ${received.quantity} of ${item.productName} to destination`);
-            } else {
-              // Log warning - destination inventory item doesn't exist
-              console.warn(`[TRANSFER] Destination inventory item not found for ${item.productName} at clinic ${this.destination.clinic}. Manual creation required.`);
-            }
-          }
-        } catch (invError) {
-          console.error('[TRANSFER] Error adding to destination inventory:', invError);
-          // Continue - don't fail the entire receipt
-        }
-      }
     } else {
       allReceived = false;
     }
@@ -596,7 +489,12 @@ inventoryTransferSchema.methods.receive = async function(userId, receivedItems)
     newStatus: this.status
   });
 
-  return this.save();
+  return this;
+};
+
+// Method: Receive items
+inventoryTransferSchema.methods.receive = function(userId, receivedItems) {
+  return this.markReceived(userId, receivedItems).save();
 };
 
 // Method: Cancel transfer
@@ -56,6 +56,13 @@ const invoiceSchema = new mongoose.Schema({
     sparse: true
   },
 
+  // Direct link to appointment (bulk generation from appointments)
+  appointment: {
+    type: mongoose.Schema.Types.ObjectId,
+    ref: 'Appointment',
+    sparse: true
+  },
+
   // Multi-Clinic: Which clinic issued this invoice
   clinic: {
     type: mongoose.Schema.Types.ObjectId,
@@ -922,6 +929,7 @@ invoiceSchema.index({ status: 1, dateIssued: -1 }); // Invoice aging reports
 invoiceSchema.index({ status: 1, 'summary.amountDue': 1 }); // Outstanding balance queries
 invoiceSchema.index({ 'insurance.claimStatus': 1, createdAt: -1 }); // Claim tracking
 invoiceSchema.index({ visit: 1 }); // Visit-to-invoice lookups
+invoiceSchema.index({ appointment: 1 }, { sparse: true }); // Appointment-to-invoice lookups
 
 // Company/Convention billing indexes
 invoiceSchema.index({ 'companyBilling.company': 1, dateIssued: -1 }); // Company invoice reports
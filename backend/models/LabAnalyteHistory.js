@@ -0,0 +1,73 @@
+const mongoose = require('mongoose');
+
+/**
+ * Lab Analyte History Model
+ * Compact per-patient, per-analyte series of verified values.
+ *
+ * One document per (patient, testCode, parameter), maintained by
+ * labHistoryService when results are verified, corrected or cancelled.
+ * Delta checks and cumulative reports read these instead of scanning LabResult.
+ */
+const pointSchema = new mongoose.Schema({
+  result: {
+    type: mongoose.Schema.ObjectId,
+    ref: 'LabResult',
+    required: true
+  },
+  resultId: String,
+  at: {
+    type: Date,
+    required: true
+  },
+  value: Number,
+  textValue: String,
+  unit: String,
+  referenceRange: {
+    low: Number,
+    high: Number,
+    text: String
+  },
+  flag: String,
+  status: String
+}, { _id: false });
+
+const labAnalyteHistorySchema = new mongoose.Schema({
+  patient: {
+    type: mongoose.Schema.ObjectId,
+    ref: 'Patient',
+    required: true
+  },
+
+  // `${testCode}:${parameter}` normalized (see labHistoryService.analyteKey)
+  analyteKey: {
+    type: String,
+    required: true
+  },
+  // Normalized parameter name, for callers that only know the analyte (e.g. 'glucose')
+  parameterKey: String,
+
+  // Trimmed, upper-cased (see labHistoryService.normalizeTestCode)
+  testCode: String,
+  testName: String,
+  category: String,
+  parameter: String,
+  // Position of the component in its panel (0 = primary result)
+  componentIndex: {
+    type: Number,
+    default: 0
+  },
+  unit: String,
+
+  // Sorted by `at`, capped to the most recent values
+  points: [pointSchema],
+
+  lastAt: Date
+}, {
+  timestamps: true
+});
+
+labAnalyteHistorySchema.index({ patient: 1, analyteKey: 1 }, { unique: true });
+labAnalyteHistorySchema.index({ patient: 1, testCode: 1 });
+labAnalyteHistorySchema.index({ patient: 1, parameterKey: 1 });
+
+module.exports = mongoose.model('LabAnalyteHistory', labAnalyteHistorySchema);
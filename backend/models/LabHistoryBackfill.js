@@ -0,0 +1,32 @@
+const mongoose = require('mongoose');
+
+/**
+ * Lab History Backfill Model
+ * One marker per patient whose LabResult history has been backfilled into
+ * LabAnalyteHistory (see labHistoryService.ensureHistory).
+ *
+ * Kept out of Patient and LabAnalyteHistory: it is job state, not patient
+ * data, and history queries read every analyte document of a patient.
+ */
+const labHistoryBackfillSchema = new mongoose.Schema({
+  patient: {
+    type: mongoose.Schema.ObjectId,
+    ref: 'Patient',
+    required: true
+  },
+
+  // Lab results before this date were backfilled
+  backfilledAt: {
+    type: Date,
+    required: true
+  },
+
+  results: Number,
+  analytes: Number
+}, {
+  timestamps: true
+});
+
+labHistoryBackfillSchema.index({ patient: 1 }, { unique: true });
+
+module.exports = mongoose.model('LabHistoryBackfill', labHistoryBackfillSchema);
@@ -345,6 +345,12 @@ labResultSchema.pre('save', async function(next) {
     }
   }
 
+  // Analyte history follows status, values and soft-delete (see post-save below)
+  this.$locals.historyChanged = this.isNew
+    ? ['final', 'corrected', 'amended'].includes(this.status)
+    : this.isModified('status') || this.isModified('results') ||
+      this.isModified('performedAt') || this.isModified('isDeleted');
+
   next();
 });
 
@@ -386,6 +392,17 @@ labResultSchema.post('save', async function() {
   }
 });
 
+// Post save - keep per-analyte history in step for delta checks / cumulative reports
+labResultSchema.post('save', async function() {
+  if (!this.$locals.historyChanged) return;
+  try {
+    const labHistoryService = require('../services/labHistoryService');
+    await labHistoryService.recordResult(this);
+  } catch (error) {
+    console.error('Error updating lab analyte history after result save:', error);
+  }
+});
+
 // Static method to get patient's result history for a specific test
 labResultSchema.statics.getTestHistory = async function(patientId, testCode, options = {}) {
   const query = {
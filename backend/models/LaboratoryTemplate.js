@@ -1,4 +1,5 @@
 const mongoose = require('mongoose');
+const { catalogChangePlugin } = require('../utils/catalogChangeTracker');
 
 // Component schema for individual test components
 const componentSchema = new mongoose.Schema({
@@ -575,4 +576,6 @@ laboratoryTemplateSchema.index({ isProfile: 1 });
 laboratoryTemplateSchema.index({ 'analyzerConfigs.analyzer': 1 });
 laboratoryTemplateSchema.index({ defaultAnalyzer: 1 });
 
+laboratoryTemplateSchema.plugin(catalogChangePlugin, { catalog: 'laboratories' });
+
 module.exports = mongoose.model('LaboratoryTemplate', laboratoryTemplateSchema);
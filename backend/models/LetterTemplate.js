@@ -1,4 +1,5 @@
 const mongoose = require('mongoose');
+const { catalogChangePlugin } = require('../utils/catalogChangeTracker');
 
 const letterTemplateSchema = new mongoose.Schema({
   // Template Information
@@ -84,6 +85,8 @@ const letterTemplateSchema = new mongoose.Schema({
 letterTemplateSchema.index({ name: 1 });
 letterTemplateSchema.index({ category: 1, active: 1 });
 
+letterTemplateSchema.plugin(catalogChangePlugin, { catalog: 'letters' });
+
 const LetterTemplate = mongoose.model('LetterTemplate', letterTemplateSchema);
 
 module.exports = LetterTemplate;
@@ -1,4 +1,5 @@
 const mongoose = require('mongoose');
+const { catalogChangePlugin } = require('../utils/catalogChangeTracker');
 
 const medicationTemplateSchema = new mongoose.Schema({
   category: {
@@ -99,4 +100,6 @@ medicationTemplateSchema.index({ name: 'text', description: 'text', searchTerms:
 medicationTemplateSchema.index({ category: 1, name: 1 });
 medicationTemplateSchema.index({ isActive: 1 });
 
+medicationTemplateSchema.plugin(catalogChangePlugin, { catalog: 'medications' });
+
 module.exports = mongoose.model('MedicationTemplate', medicationTemplateSchema);
@@ -1,4 +1,5 @@
 const mongoose = require('mongoose');
+const { catalogChangePlugin } = require('../utils/catalogChangeTracker');
 
 const pathologyTemplateSchema = new mongoose.Schema({
   category: {
@@ -96,4 +97,6 @@ pathologyTemplateSchema.index({ category: 1, subcategory: 1, type: 1 });
 pathologyTemplateSchema.index({ name: 'text', value: 'text' });
 pathologyTemplateSchema.index({ isActive: 1 });
 
+pathologyTemplateSchema.plugin(catalogChangePlugin, { catalog: 'pathologies' });
+
 module.exports = mongoose.model('PathologyTemplate', pathologyTemplateSchema);
@@ -1893,17 +1893,9 @@ patientSchema.pre('save', async function(next) {
   }
 });
 
-// Method to recalculate and update account balance
-patientSchema.methods.updateAccountBalance = async function() {
-  const Invoice = require('./Invoice');
-
-  // Get all non-cancelled invoices for this patient
-  const invoices = await Invoice.find({
-    patient: this._id,
-    status: { $nin: ['cancelled', 'voided'] }
-  });
-
-  const now = new Date();
+// Compute an account balance from a patient's non-cancelled invoices
+// Shared by updateAccountBalance and set-based invoice generation
+patientSchema.statics.computeAccountBalance = function(invoices, credit = 0, now = new Date()) {
   let totalBilled = 0;
   let totalPaid = 0;
   let overdueCount = 0;
@@ -1939,14 +1931,13 @@ patientSchema.methods.updateAccountBalance = async function() {
     }
   }
 
-  // Update account balance
-  this.accountBalance = {
+  return {
     totalBilled,
     totalPaid,
     outstanding: totalBilled - totalPaid,
     overdueCount,
     overdueAmount,
-    credit: this.accountBalance?.credit || 0, // Preserve existing credit
+    credit, // Preserve existing credit
     lastUpdated: now,
     paymentHistory: {
       lastPaymentDate,
@@ -1954,6 +1945,20 @@ patientSchema.methods.updateAccountBalance = async function() {
       paymentCount
     }
   };
+};
+
+// Method to recalculate and update account balance
+patientSchema.methods.updateAccountBalance = async function() {
+  const Invoice = require('./Invoice');
+
+  // Get all non-cancelled invoices for this patient
+  const invoices = await Invoice.find({
+    patient: this._id,
+    status: { $nin: ['cancelled', 'voided'] }
+  });
+
+  // Update account balance
+  this.accountBalance = this.constructor.computeAccountBalance(invoices, this.accountBalance?.credit || 0);
 
   await this.save({ validateBeforeSave: false });
 
@@ -764,7 +764,19 @@ const prescriptionSchema = new mongoose.Schema({
         default: false
       },
       signedAt: Date,
-      signatureData: String // Base64 encoded signature image
+      signatureData: String, // Base64 encoded signature image
+      // Ed25519 batch signature (see services/documentSigningService)
+      digital: {
+        batch: String,
+        keyId: String,
+        algorithm: String,
+        digest: String,
+        root: String,
+        index: Number,
+        proof: [String],
+        signature: String,
+        signedAt: Date
+      }
     },
     patient: {
       signed: Boolean,
@@ -0,0 +1,66 @@
+const mongoose = require('mongoose');
+
+/**
+ * Signature Batch Model
+ * One Ed25519 signature over the Merkle root of every document signed in a
+ * session. Each document keeps its own inclusion proof; this record is the
+ * audit trail tying the documents to the single signing operation.
+ */
+const signatureBatchSchema = new mongoose.Schema({
+  batchId: {
+    type: String,
+    required: true,
+    unique: true
+  },
+
+  signer: {
+    type: mongoose.Schema.Types.ObjectId,
+    ref: 'User',
+    required: true
+  },
+
+  keyId: {
+    type: String,
+    required: true
+  },
+
+  algorithm: {
+    type: String,
+    default: 'Ed25519'
+  },
+
+  // Merkle root and signature, base64url
+  root: {
+    type: String,
+    required: true
+  },
+  signature: {
+    type: String,
+    required: true
+  },
+
+  signedAt: {
+    type: Date,
+    required: true
+  },
+
+  leafCount: Number,
+
+  documents: [{
+    _id: false,
+    kind: {
+      type: String,
+      enum: ['prescription', 'surgeryReport']
+    },
+    ref: mongoose.Schema.Types.ObjectId,
+    digest: String,
+    index: Number
+  }]
+}, {
+  timestamps: true
+});
+
+signatureBatchSchema.index({ signer: 1, signedAt: -1 });
+signatureBatchSchema.index({ 'documents.ref': 1 });
+
+module.exports = mongoose.model('SignatureBatch', signatureBatchSchema);
@@ -0,0 +1,61 @@
+const mongoose = require('mongoose');
+
+/**
+ * Signing Key Model
+ * Ed25519 keys used to sign prescription / surgery report batches.
+ * Public keys are distributed to pharmacies and insurers for offline QR
+ * verification; the private key is either PHI-encrypted at rest here or
+ * held by the HSM key store (encryptedPrivateKey is then empty).
+ */
+const signingKeySchema = new mongoose.Schema({
+  keyId: {
+    type: String,
+    required: true,
+    unique: true
+  },
+
+  owner: {
+    type: mongoose.Schema.Types.ObjectId,
+    ref: 'User',
+    required: true
+  },
+
+  algorithm: {
+    type: String,
+    enum: ['Ed25519'],
+    default: 'Ed25519'
+  },
+
+  // Raw 32-byte public key, base64url
+  publicKey: {
+    type: String,
+    required: true
+  },
+
+  // PKCS#8 DER, base64, encrypted with phiEncryption
+  encryptedPrivateKey: {
+    type: String,
+    select: false
+  },
+
+  storage: {
+    type: String,
+    enum: ['database', 'hsm'],
+    default: 'database'
+  },
+
+  status: {
+    type: String,
+    enum: ['active', 'revoked'],
+    default: 'active'
+  },
+
+  revokedAt: Date,
+  revocationReason: String
+}, {
+  timestamps: true
+});
+
+signingKeySchema.index({ owner: 1, status: 1 });
+
+module.exports = mongoose.model('SigningKey', signingKeySchema);
@@ -0,0 +1,63 @@
+const mongoose = require('mongoose');
+
+/**
+ * Short-lived reservation of a provider's time, one document per grid cell
+ * (e.g. 09:00-09:30). The unique key makes taking a cell atomic: a patient
+ * holding a slot on the portal, and staff while they save a booking,
+ * exclude each other. Cells of the same hold share a holdId.
+ */
+const slotHoldSchema = new mongoose.Schema({
+  // provider:YYYY-MM-DD:HH:MM of the cell
+  key: {
+    type: String,
+    required: true,
+    unique: true
+  },
+  holdId: {
+    type: String,
+    required: true,
+    index: true
+  },
+  // patient:<id> for portal holds, staff:<userId> for booking locks
+  holder: {
+    type: String,
+    required: true,
+    index: true
+  },
+  purpose: {
+    type: String,
+    enum: ['hold', 'booking'],
+    default: 'hold'
+  },
+
+  provider: {
+    type: mongoose.Schema.ObjectId,
+    ref: 'User',
+    required: true
+  },
+  patient: {
+    type: mongoose.Schema.ObjectId,
+    ref: 'Patient'
+  },
+  date: {
+    type: Date,
+    required: true
+  },
+  // Slot requested (the cell is within it)
+  startTime: String,
+  endTime: String,
+  cellTime: String,
+
+  expiresAt: {
+    type: Date,
+    required: true
+  }
+}, {
+  timestamps: true
+});
+
+slotHoldSchema.index({ provider: 1, date: 1 });
+// Expired holds are taken over on conflict; the TTL monitor cleans up the rest
+slotHoldSchema.index({ expiresAt: 1 }, { expireAfterSeconds: 0 });
+
+module.exports = mongoose.model('SlotHold', slotHoldSchema);
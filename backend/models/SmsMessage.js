@@ -0,0 +1,48 @@
+const mongoose = require('mongoose');
+
+/**
+ * SMS delivery record for messages sent over SMPP: written when the SMSC
+ * accepts the submission, updated by its delivery receipt.
+ */
+const smsMessageSchema = new mongoose.Schema({
+  // Id assigned by the SMSC in submit_sm_resp
+  messageId: {
+    type: String,
+    required: true,
+    unique: true
+  },
+  provider: {
+    type: String,
+    enum: ['smpp'],
+    default: 'smpp'
+  },
+  to: String,
+
+  // Bulk campaign (reminders, recall, closure notice...) and caller reference
+  campaign: {
+    type: String,
+    index: true
+  },
+  reference: String,
+
+  status: {
+    type: String,
+    enum: ['submitted', 'enroute', 'accepted', 'delivered', 'expired', 'deleted', 'undelivered', 'rejected', 'unknown'],
+    default: 'submitted',
+    index: true
+  },
+  // Raw receipt stat and error code from the operator
+  stat: String,
+  errorCode: String,
+
+  submittedAt: Date,
+  doneAt: Date
+}, {
+  timestamps: true
+});
+
+smsMessageSchema.index({ campaign: 1, status: 1 });
+// Delivery records are operational data: keep 90 days
+smsMessageSchema.index({ createdAt: 1 }, { expireAfterSeconds: 90 * 24 * 60 * 60 });
+
+module.exports = mongoose.model('SmsMessage', smsMessageSchema);
@@ -8,7 +8,11 @@ const mongoose = require('mongoose');
 const ReconciliationItemSchema = new mongoose.Schema({
   inventoryType: {
     type: String,
-    enum: ['pharmacy', 'frame', 'contactLens', 'opticalLens', 'reagent', 'labConsumable', 'surgicalSupply'],
+    enum: [
+      'pharmacy', 'frame', 'contactLens', 'opticalLens', 'reagent', 'labConsumable', 'surgicalSupply',
+      // Inventory discriminator keys (stream-mode counts)
+      'contact_lens', 'optical_lens', 'lab_consumable', 'surgical_supply'
+    ],
     required: true
   },
   inventoryItemId: {
@@ -119,6 +123,33 @@ const StockReconciliationSchema = new mongoose.Schema({
   startedAt: { type: Date },
   completedAt: { type: Date },
 
+  // Counting mode:
+  // - stream: scans appended to StocktakeCount, variance aggregated live by
+  //   services/stocktakeService, items materialized on submit
+  // - items: legacy per-count push into the items array
+  // No schema default: set to 'stream' on create, so reconciliations started
+  // before stream mode (no value, no snapshot) keep the legacy path
+  countMode: {
+    type: String,
+    enum: ['stream', 'items']
+  },
+
+  // System quantities frozen when counting starts (stream mode); variance is
+  // measured against this so movements during the count are preserved
+  countSnapshot: {
+    type: {
+      takenAt: Date,
+      items: [{
+        _id: false,
+        item: mongoose.Schema.Types.ObjectId,
+        inventoryType: String,
+        systemQuantity: Number,
+        lots: [{ _id: false, lotNumber: String, quantity: Number }]
+      }]
+    },
+    select: false
+  },
+
   // Items
   items: [ReconciliationItemSchema],
 
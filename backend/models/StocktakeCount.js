@@ -0,0 +1,41 @@
+/**
+ * Stocktake Count Model
+ * Append-only stream of barcode scans for a stream-mode stock reconciliation.
+ * One small document per scan instead of rewriting the reconciliation's
+ * embedded items array, so concurrent counters never contend on one document.
+ * Corrections are recorded as negative quantities, never as updates.
+ */
+
+const mongoose = require('mongoose');
+
+const StocktakeCountSchema = new mongoose.Schema({
+  reconciliation: {
+    type: mongoose.Schema.Types.ObjectId,
+    ref: 'StockReconciliation',
+    required: true
+  },
+  inventoryItem: {
+    type: mongoose.Schema.Types.ObjectId,
+    ref: 'Inventory',
+    required: true
+  },
+  barcode: { type: String },
+  lotNumber: { type: String },
+  location: { type: String },
+  quantity: { type: Number, required: true },
+
+  countedBy: { type: mongoose.Schema.Types.ObjectId, ref: 'User', required: true },
+  deviceId: { type: String },
+
+  // Client-generated id; a handheld re-sending its offline queue is deduplicated on it
+  scanId: { type: String, required: true },
+  scannedAt: { type: Date, required: true },
+  receivedAt: { type: Date, default: Date.now }
+}, {
+  versionKey: false
+});
+
+StocktakeCountSchema.index({ reconciliation: 1, scanId: 1 }, { unique: true });
+StocktakeCountSchema.index({ reconciliation: 1, inventoryItem: 1, lotNumber: 1 });
+
+module.exports = mongoose.model('StocktakeCount', StocktakeCountSchema);
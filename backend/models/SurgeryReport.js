@@ -250,6 +250,19 @@ const SurgeryReportSchema = new Schema({
 
   signedAt: Date,
 
+  // Ed25519 batch signature (see services/documentSigningService)
+  digitalSignature: {
+    batch: String,
+    keyId: String,
+    algorithm: String,
+    digest: String,
+    root: String,
+    index: Number,
+    proof: [String],
+    signature: String,
+    signedAt: Date
+  },
+
   // Draft or finalized
   status: {
     type: String,
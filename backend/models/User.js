@@ -1,10 +1,13 @@
 const mongoose = require('mongoose');
-const bcrypt = require('bcryptjs');
+const passwordHashService = require('../services/passwordHashService');
 const jwt = require('jsonwebtoken');
 const crypto = require('crypto');
 const { validatePassword } = require('../utils/passwordValidator');
 const CONSTANTS = require('../config/constants');
 const { encrypt, decrypt, isEncrypted } = require('../utils/phiEncryption');
+const { createContextLogger } = require('../utils/structuredLogger');
+
+const log = createContextLogger('User');
 
 const userSchema = new mongoose.Schema({
   // Basic Information
@@ -397,8 +400,8 @@ userSchema.pre('save', async function(next) {
     return next();
   }
 
-  const salt = await bcrypt.genSalt(10);
-  this.password = await bcrypt.hash(this.password, salt);
+  // Hashed on a worker thread (scrypt); see services/passwordHashService
+  this.password = await passwordHashService.hash(this.password);
 
   // Add to password history
   if (!this.passwordHistory) {
@@ -419,17 +422,41 @@ userSchema.pre('save', async function(next) {
 });
 
 // Match user password
+// On success, legacy bcrypt (or outdated scrypt) hashes are upgraded in the
+// background; the pending upgrade is exposed as $locals.passwordRehash
 userSchema.methods.matchPassword = async function(enteredPassword) {
-  return await bcrypt.compare(enteredPassword, this.password);
+  const isMatch = await passwordHashService.verify(enteredPassword, this.password);
+
+  if (isMatch && passwordHashService.needsRehash(this.password)) {
+    this.$locals.passwordRehash = this.rehashPassword(enteredPassword);
+  }
+
+  return isMatch;
 };
 
-// Check if password was used before
-userSchema.methods.isPasswordUsedBefore = async function(password) {
-  for (const oldPassword of this.passwordHistory || []) {
-    const match = await bcrypt.compare(password, oldPassword.password);
-    if (match) return true;
+// Replace the stored hash with one using the current algorithm
+// Conditional on the hash being unchanged so a concurrent password change wins
+userSchema.methods.rehashPassword = async function(plainPassword) {
+  const previousHash = this.password;
+  try {
+    const newHash = await passwordHashService.hash(plainPassword);
+    const result = await this.constructor.updateOne(
+      { _id: this._id, password: previousHash },
+      { $set: { password: newHash } }
+    );
+    return result.modifiedCount > 0;
+  } catch (error) {
+    log.warn('Password rehash failed', { userId: this._id, error: error.message });
+    return false;
   }
-  return false;
+};
+
+// Check if password was used before (history entries verified in parallel)
+userSchema.methods.isPasswordUsedBefore = async function(password) {
+  return passwordHashService.verifyAny(
+    password,
+    (this.passwordHistory || []).map(entry => entry.password)
+  );
 };
 
 // Sign JWT (short-lived access token)
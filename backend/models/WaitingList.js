@@ -126,10 +126,18 @@ const waitingListSchema = new mongoose.Schema({
     },
     response: {
       type: String,
-      enum: ['pending', 'accepted', 'declined', 'expired']
+      // superseded: someone else accepted the slot first
+      enum: ['pending', 'accepted', 'declined', 'expired', 'superseded']
     },
     respondedAt: Date,
-    expiresAt: Date
+    expiresAt: Date,
+    // Automatic backfill offers (waitlistBackfillService)
+    wave: Number,
+    slotKey: String,
+    sourceAppointment: {
+      type: mongoose.Schema.ObjectId,
+      ref: 'Appointment'
+    }
   }],
 
   // If scheduled, link to appointment
@@ -179,6 +187,7 @@ waitingListSchema.index({ department: 1, status: 1, priority: -1, createdAt: 1 }
 waitingListSchema.index({ requestedProvider: 1, status: 1 });
 waitingListSchema.index({ expiresAt: 1 });
 waitingListSchema.index({ status: 1, priority: -1, position: 1 });
+waitingListSchema.index({ 'notifications.slotKey': 1, 'notifications.response': 1 });
 
 // Virtual for days waiting
 waitingListSchema.virtual('daysWaiting').get(function() {
@@ -204,61 +213,6 @@ waitingListSchema.pre('save', async function(next) {
   next();
 });
 
-// Method to notify patient of available slot
-waitingListSchema.methods.notifySlotAvailable = async function(slot, notificationType = 'email') {
-  const notification = {
-    type: notificationType,
-    sentAt: new Date(),
-    slotOffered: {
-      date: slot.date,
-      startTime: slot.startTime,
-      endTime: slot.endTime,
-      provider: slot.provider
-    },
-    response: 'pending',
-    expiresAt: new Date(Date.now() + 24 * 60 * 60 * 1000) // 24 hours to respond
-  };
-
-  this.notifications.push(notification);
-  this.status = 'notified';
-  await this.save();
-
-  // Actual notification sending would be done here via email/SMS service
-  return notification;
-};
-
-// Method to respond to slot offer
-waitingListSchema.methods.respondToOffer = async function(notificationId, accept) {
-  const notification = this.notifications.id(notificationId);
-
-  if (!notification) {
-    throw new Error('Notification not found');
-  }
-
-  if (notification.response !== 'pending') {
-    throw new Error('Already responded to this offer');
-  }
-
-  if (new Date() > notification.expiresAt) {
-    notification.response = 'expired';
-    await this.save();
-    throw new Error('Offer has expired');
-  }
-
-  notification.response = accept ? 'accepted' : 'declined';
-  notification.respondedAt = new Date();
-
-  if (accept) {
-    this.status = 'scheduled';
-  } else {
-    // If declined, put back in waiting status
-    this.status = 'waiting';
-  }
-
-  await this.save();
-  return notification;
-};
-
 // Static method to get next in queue
 waitingListSchema.statics.getNextInQueue = async function(department, provider = null) {
   const query = {
@@ -278,55 +232,4 @@ waitingListSchema.statics.getNextInQueue = async function(department, provider =
     .populate('patient', 'firstName lastName patientId phoneNumber email');
 };
 
-// Static method to check for matches when a slot becomes available
-waitingListSchema.statics.findMatchingPatients = async function(slot) {
-  const dayOfWeek = new Date(slot.date).getDay();
-  const hour = parseInt(slot.startTime.split(':')[0]);
-  let timeSlot;
-
-  if (hour < 12) timeSlot = 'morning';
-  else if (hour < 17) timeSlot = 'afternoon';
-  else timeSlot = 'evening';
-
-  const query = {
-    department: slot.department,
-    status: 'waiting',
-    $or: [
-      { requestedProvider: slot.provider },
-      { 'preferences.flexibleProvider': true }
-    ],
-    $and: [
-      {
-        $or: [
-          { 'preferences.preferredDays': { $size: 0 } },
-          { 'preferences.preferredDays': dayOfWeek }
-        ]
-      },
-      {
-        $or: [
-          { 'preferences.preferredTimeSlots': { $size: 0 } },
-          { 'preferences.preferredTimeSlots': timeSlot }
-        ]
-      },
-      {
-        $or: [
-          { 'preferences.earliestDate': { $exists: false } },
-          { 'preferences.earliestDate': { $lte: new Date(slot.date) } }
-        ]
-      },
-      {
-        $or: [
-          { 'preferences.latestDate': { $exists: false } },
-          { 'preferences.latestDate': { $gte: new Date(slot.date) } }
-        ]
-      }
-    ]
-  };
-
-  return this.find(query)
-    .sort({ priority: -1, position: 1 })
-    .limit(5)
-    .populate('patient', 'firstName lastName patientId phoneNumber email');
-};
-
 module.exports = mongoose.model('WaitingList', waitingListSchema);
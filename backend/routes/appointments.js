@@ -24,6 +24,7 @@ const {
   getWaitingList,
   addToWaitingList,
   removeFromWaitingList,
+  respondToWaitingListOffer,
   getAppointmentTypes,
   checkConflicts,
   bulkUpdate,
@@ -112,6 +113,14 @@ router.delete(
   removeFromWaitingList
 );
 
+// Patient's answer to a freed-slot offer (taken by phone/SMS at the desk)
+router.post(
+  '/waiting-list/:id/offers/:offerId/respond',
+  requirePermission('manage_appointments'),
+  logAction('WAITING_LIST_OFFER_RESPONSE'),
+  respondToWaitingListOffer
+);
+
 // Check conflicts
 router.post('/check-conflicts', requirePermission('view_appointments'), checkConflicts);
 
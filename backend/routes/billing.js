@@ -104,15 +104,19 @@ router.post('/webhook/:provider', express.raw({ type: 'application/json' }), han
 
 // Protect all other routes and add clinic context
 const { optionalClinic } = require('../middleware/clinicAuth');
+const readRouting = require('../services/readRoutingService');
 router.use(protect);
 router.use(optionalClinic);
 
+// Statistics and reports tolerate replication lag: served by analytics members
+const analyticsReads = readRouting.readClass('analytics');
+
 // Statistics and reports
-router.get('/statistics', requirePermission('manage_billing'), getBillingStatistics);
-router.get('/reports/revenue', requirePermission('manage_billing'), getRevenueReport);
-router.get('/reports/aging', requirePermission('manage_billing'), getAgingReport);
-router.get('/reports/aging/by-patient', requirePermission('manage_billing'), getAgingReportByPatient);
-router.get('/reports/aging/trend', requirePermission('manage_billing'), getAgingTrendReport);
+router.get('/statistics', requirePermission('manage_billing'), analyticsReads, getBillingStatistics);
+router.get('/reports/revenue', requirePermission('manage_billing'), analyticsReads, getRevenueReport);
+router.get('/reports/aging', requirePermission('manage_billing'), analyticsReads, getAgingReport);
+router.get('/reports/aging/by-patient', requirePermission('manage_billing'), analyticsReads, getAgingReportByPatient);
+router.get('/reports/aging/trend', requirePermission('manage_billing'), analyticsReads, getAgingTrendReport);
 router.get('/reports/daily-reconciliation', requirePermission('manage_billing'), getDailyReconciliation);
 router.get('/reports/processing-fees', requirePermission('manage_billing'), getProcessingFeesReport);
 
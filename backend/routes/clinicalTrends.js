@@ -10,10 +10,13 @@ const router = express.Router();
 const clinicalTrendController = require('../controllers/clinicalTrendController');
 const { protect, authorize } = require('../middleware/auth');
 const { logPatientDataAccess } = require('../middleware/auditLogger');
+const readRouting = require('../services/readRoutingService');
 
 // Protect all routes
 router.use(protect);
 router.use(authorize('doctor', 'ophthalmologist', 'nurse', 'admin'));
+// Trends may be read from secondaries, always including the clinician's own last exam
+router.use(readRouting.readClass('causal'));
 
 // ============ IOP Trends ============
 
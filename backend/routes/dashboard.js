@@ -3,6 +3,7 @@ const router = express.Router();
 const { protect } = require('../middleware/auth');
 const { asyncHandler } = require('../middleware/errorHandler');
 const { optionalClinic } = require('../middleware/clinicAuth');
+const readRouting = require('../services/readRoutingService');
 const Appointment = require('../models/Appointment');
 const Visit = require('../models/Visit');
 const Prescription = require('../models/Prescription');
@@ -15,7 +16,7 @@ router.use(optionalClinic);
 // @desc    Get dashboard statistics
 // @route   GET /api/dashboard/stats
 // @access  Private
-router.get('/stats', asyncHandler(async (req, res) => {
+router.get('/stats', readRouting.readClass('analytics'), asyncHandler(async (req, res) => {
   const today = new Date();
   today.setHours(0, 0, 0, 0);
   const tomorrow = new Date(today);
@@ -9,7 +9,8 @@ const {
   getVisitDocuments,
   getPatientDocuments,
   getCategories,
-  bulkGenerateDocuments
+  bulkGenerateDocuments,
+  batchGenerateDocuments
 } = require('../controllers/documentGenerationController');
 
 const { protect, authorize } = require('../middleware/auth');
@@ -26,6 +27,7 @@ router.get('/categories', getCategories);
 // Document generation routes
 router.post('/templates/:id/preview', previewTemplate);
 router.post('/generate', authorize('admin', 'doctor', 'ophthalmologist', 'nurse', 'orthoptist'), generateDocument);
+router.post('/batch-generate', authorize('admin', 'doctor', 'ophthalmologist'), batchGenerateDocuments);
 
 // Visit document routes
 router.get('/visit/:visitId/documents', getVisitDocuments);
@@ -34,7 +34,12 @@ const {
   getExportData,
   updateLabStatus,
   getPendingExport,
-  getAwaitingFromLab
+  getAwaitingFromLab,
+  // Optical Lab Link
+  transmitLabBatch,
+  pollLabStatus,
+  getLabLinkStatus,
+  getLabTurnaround
 } = require('../controllers/glassesOrders');
 const { protect, authorize } = require('../middleware/auth');
 const { logAction, logCriticalOperation, logPatientDataAccess } = require('../middleware/auditLogger');
@@ -56,6 +61,12 @@ router.get('/ready-for-pickup', authorize('admin', 'optometrist', 'receptionist'
 router.get('/pending-export', authorize('admin', 'optometrist', 'receptionist'), logAction('GLASSES_ORDER_PENDING_EXPORT_VIEW'), getPendingExport);
 router.get('/awaiting-lab', authorize('admin', 'optometrist', 'receptionist'), logAction('GLASSES_ORDER_AWAITING_LAB_VIEW'), getAwaitingFromLab);
 
+// Optical lab link - batched VCA transmission (must be before :id routes)
+router.get('/lab-link/status', authorize('admin', 'optometrist', 'receptionist'), logAction('GLASSES_ORDER_LAB_LINK_VIEW'), getLabLinkStatus);
+router.get('/lab-link/turnaround', authorize('admin', 'optometrist'), logAction('GLASSES_ORDER_LAB_TURNAROUND_VIEW'), getLabTurnaround);
+router.post('/lab-link/transmit', authorize('admin', 'optometrist', 'receptionist'), logCriticalOperation('GLASSES_ORDER_LAB_BATCH_TRANSMIT'), transmitLabBatch);
+router.post('/lab-link/poll', authorize('admin', 'optometrist', 'receptionist'), logAction('GLASSES_ORDER_LAB_STATUS_POLL'), pollLabStatus);
+
 // Inventory search routes (must be before :id routes)
 router.get('/search-frames', authorize('admin', 'doctor', 'optometrist', 'receptionist'), logAction('GLASSES_ORDER_FRAME_SEARCH'), searchFrames);
 router.get('/search-contact-lenses', authorize('admin', 'doctor', 'optometrist', 'receptionist'), logAction('GLASSES_ORDER_CONTACT_LENS_SEARCH'), searchContactLenses);
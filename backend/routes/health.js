@@ -3,6 +3,11 @@ const mongoose = require('mongoose');
 const redis = require('../config/redis');
 const logger = require('../config/logger');
 const { healthAuth } = require('../middleware/healthAuth');
+const indexAdvisorService = require('../services/indexAdvisorService');
+const readRoutingService = require('../services/readRoutingService');
+const dbCostTracer = require('../services/dbCostTracer');
+const admissionControl = require('../middleware/admissionControl');
+const memoryWatchdog = require('../services/memoryWatchdog');
 
 /**
  * Health Check Endpoints
@@ -12,6 +17,11 @@ const { healthAuth } = require('../middleware/healthAuth');
  * - /health/detailed - Detailed system health with dependencies
  * - /health/ready - Kubernetes readiness probe
  * - /health/live - Kubernetes liveness probe
+ * - /health/index-advice - Missing / redundant / unused index report
+ * - /health/read-routing - Replica set lag and causal/analytics read routes
+ * - /health/db-cost - Database commands, writes, documents and bytes per route/job
+ * - /health/admission - Event-loop delay, pressure level and shed/queued requests per class
+ * - /health/memory - Memory trend, registered cache/buffer sizes and the last growth report
  */
 
 /**
@@ -278,4 +288,144 @@ router.get('/startup', async (req, res) => {
   }
 });
 
+/**
+ * @swagger
+ * /health/index-advice:
+ *   get:
+ *     summary: Index advisor report
+ *     description: Missing, redundant and unused indexes from observed query shapes and $indexStats
+ *     tags: [Health]
+ *     parameters:
+ *       - in: query
+ *         name: collections
+ *         schema:
+ *           type: string
+ *         description: Comma-separated collection names (default all models)
+ *       - in: query
+ *         name: slowMs
+ *         schema:
+ *           type: integer
+ *     responses:
+ *       200:
+ *         description: Index advice
+ */
+router.get('/index-advice', healthAuth, async (req, res) => {
+  try {
+    const report = await indexAdvisorService.getReport({
+      collections: req.query.collections ? String(req.query.collections).split(',').map(c => c.trim()) : undefined,
+      slowMs: req.query.slowMs !== undefined ? parseInt(req.query.slowMs) : undefined,
+      minObservationMs: req.query.minObservationDays !== undefined
+        ? parseFloat(req.query.minObservationDays) * 24 * 60 * 60 * 1000
+        : undefined
+    });
+    res.json(report);
+  } catch (error) {
+    logger.error('Index advice failed', { error: error.message });
+    res.status(503).json({ error: error.message });
+  }
+});
+
+/**
+ * @swagger
+ * /health/index-advice/reset:
+ *   post:
+ *     summary: Reset recorded query shapes
+ *     tags: [Health]
+ *     responses:
+ *       200:
+ *         description: Recorder reset
+ */
+router.post('/index-advice/reset', healthAuth, (req, res) => {
+  indexAdvisorService.reset();
+  res.json(indexAdvisorService.getStatus());
+});
+
+/**
+ * @swagger
+ * /health/read-routing:
+ *   get:
+ *     summary: Read routing status
+ *     description: Sampled replication lag and where causal/analytics reads currently go
+ *     tags: [Health]
+ *     responses:
+ *       200:
+ *         description: Read routing status
+ */
+router.get('/read-routing', healthAuth, (req, res) => {
+  res.json(readRoutingService.getStatus());
+});
+
+/**
+ * @swagger
+ * /health/db-cost:
+ *   get:
+ *     summary: Database cost per route and job
+ *     description: Commands (including those issued from model hooks), writes, documents and bytes per operation
+ *     tags: [Health]
+ *     parameters:
+ *       - in: query
+ *         name: sort
+ *         schema:
+ *           type: string
+ *         description: commands | writes | docsReturned | docsWritten | bytesIn | bytesOut | dbTimeMs
+ *       - in: query
+ *         name: limit
+ *         schema:
+ *           type: integer
+ *     responses:
+ *       200:
+ *         description: Cost report
+ */
+router.get('/db-cost', healthAuth, (req, res) => {
+  res.json(dbCostTracer.getReport({
+    sort: req.query.sort ? String(req.query.sort) : undefined,
+    limit: req.query.limit !== undefined ? parseInt(req.query.limit) : undefined
+  }));
+});
+
+/**
+ * @swagger
+ * /health/db-cost/reset:
+ *   post:
+ *     summary: Reset database cost statistics
+ *     tags: [Health]
+ *     responses:
+ *       200:
+ *         description: Statistics reset
+ */
+router.post('/db-cost/reset', healthAuth, (req, res) => {
+  dbCostTracer.reset();
+  res.json(dbCostTracer.getReport());
+});
+
+/**
+ * @swagger
+ * /health/admission:
+ *   get:
+ *     summary: Admission control status
+ *     description: Event-loop delay, pressure level, in-flight and waiting requests, and admitted/queued/shed counts per request class
+ *     tags: [Health]
+ *     responses:
+ *       200:
+ *         description: Admission control status
+ */
+router.get('/admission', healthAuth, (req, res) => {
+  res.json(admissionControl.getStatus());
+});
+
+/**
+ * @swagger
+ * /health/memory:
+ *   get:
+ *     summary: Memory watchdog status
+ *     description: RSS/heap/external memory against the restart limit, growth rate, sizes of registered caches and buffers, and the last heap profile report
+ *     tags: [Health]
+ *     responses:
+ *       200:
+ *         description: Memory watchdog status
+ */
+router.get('/memory', healthAuth, (req, res) => {
+  res.json(memoryWatchdog.getStatus());
+});
+
 module.exports = router;
@@ -0,0 +1,22 @@
+const express = require('express');
+const router = express.Router();
+const labelController = require('../controllers/labelController');
+const { protect, requirePermission } = require('../middleware/auth');
+const { logAction } = require('../middleware/auditLogger');
+const { optionalClinic } = require('../middleware/clinicAuth');
+
+// Protect all routes
+router.use(protect);
+router.use(optionalClinic);
+
+// Printers and jobs
+router.get('/printers', labelController.getPrinters);
+router.get('/jobs/:jobId', labelController.getJob);
+router.delete('/jobs/:jobId', logAction('LABEL_JOB_CANCEL'), labelController.cancelJob);
+
+// Batch print jobs
+router.post('/', logAction('LABEL_PRINT'), labelController.printLabels);
+router.post('/lab-orders/:id', requirePermission('view_laboratory', 'manage_laboratory'), logAction('LAB_LABEL_PRINT'), labelController.printLabOrderLabels);
+router.post('/shelf', requirePermission('view_inventory', 'manage_inventory'), logAction('SHELF_LABEL_PRINT'), labelController.printShelfLabels);
+
+module.exports = router;
@@ -94,6 +94,8 @@ router.get('/qc/history', requirePermission('enter_results'), laboratoryControll
 // ============================================
 router.get('/trends/:patientId/:testCode', requirePermission('view_lab_orders'), laboratoryController.getPatientTrends);
 router.post('/calculate-delta', requirePermission('enter_results'), laboratoryController.calculateDelta);
+router.get('/cumulative/:patientId', requirePermission('view_lab_orders'), laboratoryController.getCumulativeReport);
+router.get('/results/:id/delta-checks', requirePermission('view_lab_orders'), laboratoryController.getResultDeltaChecks);
 
 // ============================================
 // TUBE CONSUMPTION ROUTES
@@ -1,4 +1,5 @@
 const express = require('express');
+const mongoose = require('mongoose');
 const router = express.Router();
 const {
   getPatients,
@@ -63,6 +64,64 @@ const { protect, authorize, requirePermission } = require('../middleware/auth');
 const { logPatientDataAccess, logAction } = require('../middleware/auditLogger');
 const { validatePatientCreate, validatePatientUpdate, validatePagination, validateObjectIdParam } = require('../middleware/validation');
 const { optionalClinic } = require('../middleware/clinicAuth');
+const { verifyClinicOwnership } = require('../middleware/clinicVerification');
+const { conditionalGet, documentVersion, sliceVersion, referencedVersion } = require('../middleware/conditionalGet');
+const Patient = require('../models/Patient');
+const Appointment = require('../models/Appointment');
+const Prescription = require('../models/Prescription');
+const Visit = require('../models/Visit');
+const User = require('../models/User');
+const Company = require('../models/Company');
+
+/**
+ * Patient document version, or null for patient codes and cross-clinic
+ * requests (they fall through to the controller)
+ */
+async function patientVersion(req, select = '') {
+  if (!mongoose.Types.ObjectId.isValid(req.params.id)) return null;
+  const found = await documentVersion(Patient, { _id: req.params.id }, `homeClinic ${select}`.trim());
+  if (!found) return null;
+  if (!req.accessAllClinics && req.clinicId && !verifyClinicOwnership(found.doc, req.clinicId, 'homeClinic')) {
+    return null;
+  }
+  return found;
+}
+
+const relatedSlices = (related) => Promise.all([
+  sliceVersion(Appointment, related),
+  sliceVersion(Prescription, related),
+  sliceVersion(Visit, related)
+]);
+
+// Chart version: the patient document, the appointments, prescriptions and
+// visits the chart embeds, and the users and convention company it populates
+const patientChartVersion = conditionalGet(async (req) => {
+  const found = await patientVersion(req, 'createdBy updatedBy convention.company');
+  if (!found) return null;
+  const { doc } = found;
+  const [slices, users, company] = await Promise.all([
+    relatedSlices({ patient: doc._id }),
+    referencedVersion(User, [doc.createdBy, doc.updatedBy]),
+    referencedVersion(Company, [doc.convention?.company])
+  ]);
+  return [found.version, ...slices, users, company];
+}, { name: 'patient' });
+
+// Complete profile version: as above, with the providers and prescribers
+// populated on the recent visits, appointments and prescriptions
+const patientProfileVersion = conditionalGet(async (req) => {
+  const found = await patientVersion(req);
+  if (!found) return null;
+  const related = { patient: found.doc._id };
+  const [slices, providers, prescribers, doctors] = await Promise.all([
+    relatedSlices(related),
+    Appointment.distinct('provider', related),
+    Prescription.distinct('prescriber', related),
+    Visit.distinct('primaryProvider', related)
+  ]);
+  const users = await referencedVersion(User, [...providers, ...prescribers, ...doctors]);
+  return [found.version, ...slices, users];
+}, { name: 'patient-profile' });
 
 // Protect all routes
 router.use(protect);
@@ -127,7 +186,7 @@ router.put('/:id/restore', requirePermission('manage_patients'), logAction('PATI
 
 router
   .route('/:id')
-  .get(validateObjectIdParam, logPatientDataAccess, getPatient)
+  .get(validateObjectIdParam, logPatientDataAccess, patientChartVersion, getPatient)
   .put(validatePatientUpdate, requirePermission('manage_patients'), logAction('PATIENT_UPDATE'), updatePatient)
   .delete(validateObjectIdParam, requirePermission('delete_patients'), logAction('PATIENT_DELETE'), deletePatient);
 
@@ -136,7 +195,7 @@ router.get('/:id/appointments', logPatientDataAccess, getPatientAppointments);
 router.get('/:id/prescriptions', logPatientDataAccess, getPatientPrescriptions);
 router.get('/:id/visits', logPatientDataAccess, getPatientVisits);
 router.get('/:id/billing', logPatientDataAccess, getPatientBilling);
-router.get('/:id/complete-profile', logPatientDataAccess, getCompleteProfile);
+router.get('/:id/complete-profile', logPatientDataAccess, patientProfileVersion, getCompleteProfile);
 router.get('/:id/statistics', logPatientDataAccess, getPatientStatistics);
 router.get('/:id/providers', logPatientDataAccess, getPatientProviders);
 router.get('/:id/audit', requirePermission('view_audit'), getPatientAudit);
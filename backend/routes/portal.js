@@ -10,15 +10,21 @@ const {
   getMyProfile,
   updateMyProfile,
   getMyResults,
-  getAvailableSlots
+  getAvailableSlots,
+  holdSlot,
+  releaseSlotHold
 } = require('../controllers/portalController');
 
 const { protect } = require('../middleware/auth');
 const { logPatientDataAccess } = require('../middleware/auditLogger');
+const readRouting = require('../services/readRoutingService');
 
 // Protect all routes - any authenticated user can access their own data
 router.use(protect);
 
+// Portal views read from secondaries but always show the patient's own changes
+router.use(readRouting.readClass('causal'));
+
 // Dashboard
 router.get('/dashboard', getDashboard);
 
@@ -27,6 +33,8 @@ router.get('/appointments', getMyAppointments);
 router.post('/appointments', requestAppointment);
 router.put('/appointments/:id/cancel', cancelMyAppointment);
 router.get('/available-slots', getAvailableSlots);
+router.post('/slot-holds', holdSlot);
+router.delete('/slot-holds/:holdId', releaseSlotHold);
 
 // Prescriptions
 router.get('/prescriptions', getMyPrescriptions);
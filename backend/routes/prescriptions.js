@@ -50,6 +50,29 @@ router.get(
   prescriptionController.getDrugSafetyStatus
 );
 
+// ============================================
+// DIGITAL SIGNATURE ROUTES - Must be before /:id routes
+// ============================================
+
+// Sign a session's prescriptions / surgery reports with one signature
+router.post(
+  '/sign-batch',
+  authorize('doctor', 'ophthalmologist', 'admin'),
+  logPrescriptionActivity,
+  prescriptionController.signPrescriptionBatch
+);
+
+// Public key list for offline QR verifiers
+router.get(
+  '/signing-keys',
+  prescriptionController.getSigningKeys
+);
+
+router.post(
+  '/verify-qr',
+  prescriptionController.verifyQrCode
+);
+
 // ============================================
 // TEMPLATE ROUTES
 // ============================================
@@ -10,12 +10,33 @@ const {
   getQueueStats,
   getQueueAnalytics,
   callPatient,
-  getDisplayBoardData
+  getDisplayBoardData,
+  getPatientFlow,
+  dispatchPatientFlow,
+  startFlowStation,
+  completeFlowStation,
+  updateFlowStations,
+  replayPatientFlow
 } = require('../controllers/queueController');
 
 const { protect, authorize, requirePermission } = require('../middleware/auth');
 const { logAction, logCriticalOperation } = require('../middleware/auditLogger');
 const { optionalClinic } = require('../middleware/clinicAuth');
+const { conditionalGet, sliceVersion } = require('../middleware/conditionalGet');
+const Appointment = require('../models/Appointment');
+const { getTodayRange } = require('../utils/dateUtils');
+
+// Queue screens poll every few seconds: answer 304 until today's appointments
+// change. Wait times are computed from the clock, so the version also rolls
+// over every minute.
+const WAIT_TIME_RESOLUTION_MS = 60 * 1000;
+const queueVersion = conditionalGet(async (req) => {
+  if (!req.clinicId && !req.accessAllClinics) return null;
+  const { start, end } = getTodayRange();
+  const filter = { date: { $gte: start, $lte: end } };
+  if (req.clinicId) filter.clinic = req.clinicId;
+  return [await sliceVersion(Appointment, filter), Math.floor(Date.now() / WAIT_TIME_RESOLUTION_MS)];
+}, { name: 'queue' });
 
 // Rate limiter for public display board endpoint
 // More restrictive since it's unauthenticated
@@ -36,10 +57,18 @@ router.use(protect);
 router.use(optionalClinic);
 
 // Routes
-router.get('/', logAction('QUEUE_VIEW'), getCurrentQueue);
+router.get('/', logAction('QUEUE_VIEW'), queueVersion, getCurrentQueue);
 router.post('/', requirePermission('manage_queue'), logAction('QUEUE_ADD'), addToQueue);
-router.get('/stats', logAction('QUEUE_STATS_VIEW'), getQueueStats);
+router.get('/stats', logAction('QUEUE_STATS_VIEW'), queueVersion, getQueueStats);
 router.get('/analytics', requirePermission('view_reports'), logAction('QUEUE_ANALYTICS_VIEW'), getQueueAnalytics);
+
+// Examination station flow (before /:id routes)
+router.get('/flow', logAction('PATIENT_FLOW_VIEW'), getPatientFlow);
+router.get('/flow/replay', requirePermission('view_reports'), logAction('PATIENT_FLOW_REPLAY'), replayPatientFlow);
+router.post('/flow/dispatch', requirePermission('manage_queue'), logAction('PATIENT_FLOW_DISPATCH'), dispatchPatientFlow);
+router.post('/flow/:id/start', requirePermission('manage_queue'), logAction('PATIENT_FLOW_STATION_START'), startFlowStation);
+router.post('/flow/:id/complete', requirePermission('manage_queue'), logAction('PATIENT_FLOW_STATION_COMPLETE'), completeFlowStation);
+router.put('/flow/:id/stations', requirePermission('manage_queue'), logAction('PATIENT_FLOW_STATIONS_UPDATE'), updateFlowStations);
 router.put('/:id', requirePermission('manage_queue'), logAction('QUEUE_UPDATE'), updateQueueStatus);
 router.delete('/:id', requirePermission('manage_queue'), logAction('QUEUE_REMOVE'), removeFromQueue);
 router.post('/next', requirePermission('manage_queue'), logAction('QUEUE_CALL_NEXT'), callNext);
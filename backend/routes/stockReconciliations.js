@@ -21,6 +21,7 @@ router.get('/:id', requirePermission('view_inventory', 'manage_inventory'), logA
 router.post('/:id/start', requirePermission('manage_inventory'), logAction('RECON_START'), stockReconciliationController.startReconciliation);
 router.post('/:id/count', requirePermission('manage_inventory'), logAction('RECON_COUNT'), stockReconciliationController.addCount);
 router.post('/:id/bulk-count', requirePermission('manage_inventory'), logAction('RECON_BULK_COUNT'), stockReconciliationController.bulkAddCounts);
+router.get('/:id/live-variance', requirePermission('view_inventory', 'manage_inventory'), stockReconciliationController.getLiveVariance);
 router.post('/:id/submit', requirePermission('manage_inventory'), logAction('RECON_SUBMIT'), stockReconciliationController.submitForReview);
 router.post('/:id/apply', requirePermission('manage_inventory'), logCriticalOperation('RECON_APPLY'), stockReconciliationController.applyAdjustments);
 router.post('/:id/complete', requirePermission('manage_inventory'), logCriticalOperation('RECON_COMPLETE'), stockReconciliationController.completeReconciliation);
@@ -69,6 +69,15 @@ router.get('/rooms/:roomId/schedule', logAction('SURGERY_ROOM_SCHEDULE_VIEW'), s
 // GET /api/surgery/rooms/schedule - Get schedule for all OR rooms
 router.get('/rooms/schedule', logAction('SURGERY_ROOM_SCHEDULE_VIEW'), surgeryController.getRoomSchedule);
 
+// POST /api/surgery/optimizer/plan - Propose a packed multi-day OR schedule
+router.post('/optimizer/plan', logAction('SURGERY_OR_OPTIMIZER_PLAN'), surgeryController.optimizeSchedule);
+
+// POST /api/surgery/optimizer/apply - Apply accepted optimizer assignments
+router.post('/optimizer/apply', requirePermission('manage_surgery'), logCriticalOperation('SURGERY_OR_OPTIMIZER_APPLY'), surgeryController.applyOptimizedSchedule);
+
+// GET /api/surgery/:id/backfill - Backfill proposals for a cancelled case's slot
+router.get('/:id/backfill', validateObjectIdParam, logAction('SURGERY_OR_BACKFILL_VIEW'), surgeryController.getBackfillProposals);
+
 // ============================================
 // SCHEDULING & AGENDA
 // ============================================
@@ -2,6 +2,8 @@ const express = require('express');
 const router = express.Router();
 const { protect } = require('../middleware/auth');
 const logger = require('../config/logger');
+const { sendSerialized } = require('../utils/jsonSerializer');
+const { serializers } = require('../utils/responseSchemas');
 
 // Models
 const Patient = require('../models/Patient');
@@ -129,7 +131,8 @@ router.post('/pull', protect, async (req, res) => {
       }
     }
 
-    res.json({
+    // Compiled serializer: large payloads, and user records must not carry secrets
+    sendSerialized(res, serializers.syncPull, {
       success: true,
       changes,
       serverTime: new Date().toISOString()
@@ -550,7 +553,7 @@ router.post('/bulk', protect, async (req, res) => {
       }
     }
 
-    res.json({
+    sendSerialized(res, serializers.syncBulk, {
       success: true,
       push: {
         results: pushResults,
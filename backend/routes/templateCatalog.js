@@ -27,53 +27,70 @@ const {
   getEquipmentCategories,
   getEquipmentSites,
   getEquipmentById,
-  getTemplateCatalogStats
+  getTemplateCatalogStats,
+  getCatalogSnapshot,
+  getCatalogDelta,
+  getCatalogVersion
 } = require('../controllers/templateCatalogController');
+const { conditionalGet } = require('../middleware/conditionalGet');
+const catalogSnapshotService = require('../services/catalogSnapshotService');
+
+// Catalog reads are versioned by the snapshot version, which moves on every
+// catalog write (debounced) and on the periodic fingerprint check
+const catalogVersion = conditionalGet(
+  () => (catalogSnapshotService.builtAt ? catalogSnapshotService.version : null),
+  { name: 'catalog' }
+);
 
 // ===== MEDICATION TEMPLATE ROUTES =====
-router.get('/medications', protect, getMedicationTemplates);
-router.get('/medications/categories', protect, getMedicationCategories);
-router.get('/medications/search', protect, searchMedications);
+router.get('/medications', protect, catalogVersion, getMedicationTemplates);
+router.get('/medications/categories', protect, catalogVersion, getMedicationCategories);
+router.get('/medications/search', protect, catalogVersion, searchMedications);
 
 // ===== EXAMINATION TEMPLATE ROUTES =====
-router.get('/examinations', protect, getExaminationTemplates);
-router.get('/examinations/categories', protect, getExaminationCategories);
+router.get('/examinations', protect, catalogVersion, getExaminationTemplates);
+router.get('/examinations/categories', protect, catalogVersion, getExaminationCategories);
 
 // ===== PATHOLOGY TEMPLATE ROUTES =====
-router.get('/pathologies', protect, getPathologyTemplates);
-router.get('/pathologies/categories', protect, getPathologyCategories);
-router.get('/pathologies/subcategories', protect, getPathologySubcategories);
+router.get('/pathologies', protect, catalogVersion, getPathologyTemplates);
+router.get('/pathologies/categories', protect, catalogVersion, getPathologyCategories);
+router.get('/pathologies/subcategories', protect, catalogVersion, getPathologySubcategories);
 
 // ===== LABORATORY TEMPLATE ROUTES =====
-router.get('/laboratories', protect, getLaboratoryTemplates);
-router.get('/laboratories/categories', protect, getLaboratoryCategories);
-router.get('/laboratories/profiles', protect, getLaboratoryProfiles);
+router.get('/laboratories', protect, catalogVersion, getLaboratoryTemplates);
+router.get('/laboratories/categories', protect, catalogVersion, getLaboratoryCategories);
+router.get('/laboratories/profiles', protect, catalogVersion, getLaboratoryProfiles);
 
 // ===== CLINICAL TEMPLATE ROUTES =====
-router.get('/clinical', protect, getClinicalTemplates);
-router.get('/clinical/categories', protect, getClinicalCategories);
+router.get('/clinical', protect, catalogVersion, getClinicalTemplates);
+router.get('/clinical/categories', protect, catalogVersion, getClinicalCategories);
 
 // ===== COMMENT TEMPLATE ROUTES =====
-router.get('/comments', protect, getCommentTemplates);
-router.get('/comments/categories', protect, getCommentCategories);
+router.get('/comments', protect, catalogVersion, getCommentTemplates);
+router.get('/comments/categories', protect, catalogVersion, getCommentCategories);
 
 // ===== DOSE TEMPLATE ROUTES =====
-router.get('/doses', protect, getDoseTemplates);
-router.get('/doses/forms', protect, getDoseForms);
-router.get('/doses/by-form/:form', protect, getDoseByForm);
+router.get('/doses', protect, catalogVersion, getDoseTemplates);
+router.get('/doses/forms', protect, catalogVersion, getDoseForms);
+router.get('/doses/by-form/:form', protect, catalogVersion, getDoseByForm);
 
 // ===== LETTER TEMPLATE ROUTES =====
-router.get('/letters', protect, getLetterTemplates);
-router.get('/letters/categories', protect, getLetterCategories);
-router.get('/letters/:id', protect, getLetterTemplateById);
+router.get('/letters', protect, catalogVersion, getLetterTemplates);
+router.get('/letters/categories', protect, catalogVersion, getLetterCategories);
+router.get('/letters/:id', protect, catalogVersion, getLetterTemplateById);
 
 // ===== EQUIPMENT CATALOG ROUTES =====
-router.get('/equipment', protect, getEquipmentCatalog);
-router.get('/equipment/categories', protect, getEquipmentCategories);
-router.get('/equipment/sites', protect, getEquipmentSites);
-router.get('/equipment/:id', protect, getEquipmentById);
+router.get('/equipment', protect, catalogVersion, getEquipmentCatalog);
+router.get('/equipment/categories', protect, catalogVersion, getEquipmentCategories);
+router.get('/equipment/sites', protect, catalogVersion, getEquipmentSites);
+router.get('/equipment/:id', protect, catalogVersion, getEquipmentById);
 
 // ===== STATS =====
-router.get('/stats', protect, getTemplateCatalogStats);
+router.get('/stats', protect, catalogVersion, getTemplateCatalogStats);
+
+// ===== VERSIONED SNAPSHOT (offline reference data) =====
+router.get('/snapshot', protect, getCatalogSnapshot);
+router.get('/snapshot/delta', protect, getCatalogDelta);
+router.get('/snapshot/version', protect, getCatalogVersion);
 
 module.exports = router;
@@ -1,5 +1,5 @@
 const mongoose = require('mongoose');
-const bcrypt = require('bcryptjs');
+const { verifyPasswordSync } = require('../utils/passwordHash');
 require('dotenv').config();
 
 const { requireNonProduction } = require('./_guards');
@@ -42,7 +42,7 @@ async function fixAdmin() {
 
     // Reload and verify password
     const reloaded = await User.findOne({ email: 'admin@medflow.com' }).select('+password');
-    const verify = await bcrypt.compare(testPassword, reloaded.password);
+    const verify = verifyPasswordSync(testPassword, reloaded.password);
     console.log('✓ Password verification:', verify ? 'PASS' : 'FAIL');
   }
 
@@ -3,7 +3,7 @@ const { requireNonProduction } = require('./_guards');
 requireNonProduction('verifyAdminPassword.js');
 
 const mongoose = require('mongoose');
-const bcrypt = require('bcryptjs');
+const { verifyPasswordSync } = require('../utils/passwordHash');
 const User = require('../models/User');
 
 async function verifyAdmin() {
@@ -28,7 +28,7 @@ async function verifyAdmin() {
       // Test password verification
       if (admin.password) {
         const testPassword = 'admin123';
-        const isMatch = await bcrypt.compare(testPassword, admin.password);
+        const isMatch = verifyPasswordSync(testPassword, admin.password);
         console.log('\n🔑 Password test (admin123):', isMatch ? '✅ CORRECT' : '❌ INCORRECT');
       }
     }
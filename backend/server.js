@@ -10,6 +10,12 @@ const fs = require('fs');
 const path = require('path');
 require('dotenv').config();
 
+// Query-shape recording for the index advisor: must be registered before any model is compiled
+require('./services/indexAdvisorService').install();
+// Read-class routing to replica set secondaries: same constraint
+const readRouting = require('./services/readRoutingService');
+readRouting.install();
+
 // Redis and rate limiting
 const { initializeRedis, closeConnection: closeRedis } = require('./config/redis');
 const {
@@ -21,6 +27,11 @@ const {
   searchLimiter,
   passwordResetLimiter
 } = require('./middleware/rateLimiter');
+const admissionControl = require('./middleware/admissionControl');
+const memoryWatchdog = require('./services/memoryWatchdog');
+const waitlistBackfill = require('./services/waitlistBackfillService');
+const smppService = require('./services/smppService');
+const labelPrintSpooler = require('./services/labelPrintSpooler');
 const { checkTransactionSupport } = require('./utils/transactions');
 
 // =====================================================
@@ -125,6 +136,9 @@ const invoiceReminderScheduler = require('./services/invoiceReminderScheduler');
 const paymentPlanAutoChargeService = require('./services/paymentPlanAutoChargeService');
 const calendarSyncScheduler = require('./services/calendarSyncScheduler');
 const visitCleanupScheduler = require('./services/visitCleanupScheduler');
+const catalogSnapshotService = require('./services/catalogSnapshotService');
+const opticalLabLinkService = require('./services/opticalLabLinkService');
+const passwordHashService = require('./services/passwordHashService');
 const emailQueueService = require('./services/emailQueueService');
 const websocketService = require('./services/websocketService');
 const folderSyncService = require('./services/folderSyncService');
@@ -233,6 +247,18 @@ app.use(morgan('combined', { stream: logger.stream }));
 // Prometheus metrics collection
 app.use(metricsMiddleware);
 
+// Admission control - queue/shed reporting and bulk work when the event loop lags,
+// so queue calls, check-ins and device ingestion keep their latency
+app.use('/api', admissionControl.middleware());
+admissionControl.start();
+
+// Request context for read-class routing (tracks each user's last write)
+app.use('/api', readRouting.middleware());
+
+// Per-route database cost (commands, writes, documents, bytes) incl. hook fan-out
+const dbCostTracer = require('./services/dbCostTracer');
+app.use('/api', dbCostTracer.middleware());
+
 // Body parsing with size limits
 // Default limit for most API endpoints (1MB)
 app.use(express.json({ limit: '1mb' }));
@@ -358,6 +384,7 @@ app.use('/api/dicom', require('./routes/dicom')); // DICOM Bridge integration
 app.use('/api/device-data', require('./routes/deviceData')); // Non-DICOM device data integration (TOPCON, Solix, Tomey)
 app.use('/api/device-import/tomey', require('./routes/tomeyImport')); // Tomey auto-import service
 app.use('/api/lab-orders', labOrderRoutes);
+app.use('/api/labels', require('./routes/labels')); // Networked ZPL label printers
 app.use('/api/lab-results', labResultRoutes);
 app.use('/api/lab-analyzers', require('./routes/labAnalyzers'));
 app.use('/api/reagent-lots', require('./routes/reagentLots'));
@@ -473,7 +500,10 @@ const mongoOptions = {
 
   // Auto-reconnection
   retryWrites: true,
-  retryReads: true
+  retryReads: true,
+
+  // Command monitoring events feed the database cost tracer
+  monitorCommands: process.env.DB_COST_TRACING !== 'false'
 };
 
 // Retry options for initial connection
@@ -486,6 +516,7 @@ const retryOptions = {
 connectWithRetry(mongoUri, mongoOptions, retryOptions)
   .then(async () => {
     console.log('✅ Connected to MongoDB');
+    dbCostTracer.attach(mongoose.connection);
 
     // Initialize Redis for rate limiting and sessions
     try {
@@ -510,6 +541,9 @@ connectWithRetry(mongoUri, mongoOptions, retryOptions)
       console.log('✅ MongoDB transactions supported');
     }
 
+    // Sample replication lag for causal/analytics read routing
+    readRouting.start(mongoose.connection);
+
     // Start schedulers (skip in test mode)
     if (process.env.DISABLE_SCHEDULERS !== 'true') {
       alertScheduler.start();
@@ -526,6 +560,30 @@ connectWithRetry(mongoUri, mongoOptions, retryOptions)
     // Start additional schedulers (skip in test mode)
     if (process.env.DISABLE_SCHEDULERS !== 'true') {
       visitCleanupScheduler.start();
+      catalogSnapshotService.start();
+      opticalLabLinkService.start();
+
+      // Memory watchdog: profile sustained heap growth and restart cleanly
+      // (drain in-flight requests) before PM2's max_memory_restart kills the process
+      memoryWatchdog.start({
+        onRestart: () => new Promise((resolve) => {
+          const drained = setTimeout(resolve, memoryWatchdog.DRAIN_TIMEOUT_MS);
+          server.close(() => {
+            clearTimeout(drained);
+            resolve();
+          });
+          server.closeIdleConnections?.();
+        }).then(() => gracefulShutdown('MEMORY_WATCHDOG'))
+      });
+
+      // Freed-slot backfill: expire offers left open by the previous process
+      waitlistBackfill.start();
+
+      // Operator SMPP binds for SMS (no-op without SMPP_HOST)
+      smppService.start();
+
+      // Label printer queues and status poll (no-op without LABEL_PRINTERS)
+      labelPrintSpooler.start();
 
       if (process.env.BACKUP_ENABLED !== 'false') {
         backupScheduler.start();
@@ -693,6 +751,11 @@ const gracefulShutdown = async (signal) => {
   console.log(`\n🛑 Received ${signal}, shutting down gracefully...`);
 
   // Stop all schedulers
+  admissionControl.stop();
+  memoryWatchdog.stop();
+  waitlistBackfill.stop();
+  await smppService.stop();
+  labelPrintSpooler.stop();
   alertScheduler.stop();
   deviceSyncScheduler.stop();
   reservationCleanupScheduler.stop();
@@ -701,8 +764,11 @@ const gracefulShutdown = async (signal) => {
   paymentPlanAutoChargeService.stopScheduler();
   calendarSyncScheduler.stop();
   backupScheduler.stop();
+  catalogSnapshotService.stop();
+  opticalLabLinkService.stop();
   emailQueueService.stop();
   await folderSyncService.shutdown();
+  await passwordHashService.shutdown();
 
   // Stop data sync service
   if (global.dataSyncService) {
@@ -16,6 +16,7 @@ const SpecularMicroscopeAdapter = require('./SpecularMicroscopeAdapter');
 const BiometerAdapter = require('./BiometerAdapter');
 const NidekAdapter = require('./NidekAdapter');
 const VisualFieldAdapter = require('./VisualFieldAdapter');
+const deviceParsers = require('../deviceParsers');
 
 const { createContextLogger } = require('../../utils/structuredLogger');
 const log = createContextLogger('AdapterFactory');
@@ -121,6 +122,8 @@ class AdapterFactory {
       constructor(device) {
         super(device);
         this.measurementType = device.type.toUpperCase();
+        // Pass-through transform, so any mapping matching the model will do
+        this.exportFormat = deviceParsers.resolveFormat(device);
       }
 
       async validate(data) {
@@ -22,6 +22,7 @@ class AutorefractorAdapter extends BaseAdapter {
   constructor(device) {
     super(device);
     this.measurementType = 'AUTO_REFRACTION';
+    this.exportFormat = 'autorefractor';
   }
 
   /**
@@ -330,113 +331,6 @@ class AutorefractorAdapter extends BaseAdapter {
 
     return Math.max(0, Math.min(100, score));
   }
-
-  /**
-   * Parse CSV format (common for autorefractor exports)
-   */
-  parseCSV(content) {
-    const rows = super.parseCSV(content);
-
-    // Transform CSV rows to autorefractor data format
-    return rows.map(row => {
-      const data = {
-        measurementDate: new Date(row.Date || row.date || row.Timestamp),
-        source: 'folder-sync'
-      };
-
-      // Parse OD data
-      if (row['OD SPH'] !== undefined || row.OD_SPH !== undefined) {
-        data.OD = {
-          sphere: parseFloat(row['OD SPH'] || row.OD_SPH || row.SPH_OD),
-          cylinder: parseFloat(row['OD CYL'] || row.OD_CYL || row.CYL_OD || 0),
-          axis: parseInt(row['OD AXIS'] || row.OD_AXIS || row.AXIS_OD || 0),
-          pupilSize: parseFloat(row['OD PD'] || row.OD_PD || row.PD_OD),
-          confidence: parseFloat(row['OD CONF'] || row.OD_Confidence || 100),
-          k1: parseFloat(row['OD K1'] || row.OD_K1),
-          k2: parseFloat(row['OD K2'] || row.OD_K2),
-          k1Axis: parseInt(row['OD K1 AXIS'] || row.OD_K1_Axis),
-          k2Axis: parseInt(row['OD K2 AXIS'] || row.OD_K2_Axis)
-        };
-      }
-
-      // Parse OS data
-      if (row['OS SPH'] !== undefined || row.OS_SPH !== undefined) {
-        data.OS = {
-          sphere: parseFloat(row['OS SPH'] || row.OS_SPH || row.SPH_OS),
-          cylinder: parseFloat(row['OS CYL'] || row.OS_CYL || row.CYL_OS || 0),
-          axis: parseInt(row['OS AXIS'] || row.OS_AXIS || row.AXIS_OS || 0),
-          pupilSize: parseFloat(row['OS PD'] || row.OS_PD || row.PD_OS),
-          confidence: parseFloat(row['OS CONF'] || row.OS_Confidence || 100),
-          k1: parseFloat(row['OS K1'] || row.OS_K1),
-          k2: parseFloat(row['OS K2'] || row.OS_K2),
-          k1Axis: parseInt(row['OS K1 AXIS'] || row.OS_K1_Axis),
-          k2Axis: parseInt(row['OS K2 AXIS'] || row.OS_K2_Axis)
-        };
-      }
-
-      return data;
-    });
-  }
-
-  /**
-   * Parse TXT format (some autorefractors export to text)
-   */
-  parseTXT(content) {
-    if (Buffer.isBuffer(content)) {
-      content = content.toString('utf-8');
-    }
-
-    const lines = content.split('\n').filter(line => line.trim());
-    const data = {
-      source: 'folder-sync',
-      OD: {},
-      OS: {}
-    };
-
-    let currentEye = null;
-
-    for (const line of lines) {
-      const trimmed = line.trim();
-
-      // Detect which eye
-      if (trimmed.includes('OD') || trimmed.includes('Right')) {
-        currentEye = 'OD';
-      } else if (trimmed.includes('OS') || trimmed.includes('Left')) {
-        currentEye = 'OS';
-      }
-
-      // Parse refraction values
-      const sphMatch = trimmed.match(/SPH[:\s]+(-?\d+\.?\d*)/i);
-      const cylMatch = trimmed.match(/CYL[:\s]+(-?\d+\.?\d*)/i);
-      const axisMatch = trimmed.match(/AXIS[:\s]+(\d+)/i);
-      const k1Match = trimmed.match(/K1[:\s]+(\d+\.?\d*)/i);
-      const k2Match = trimmed.match(/K2[:\s]+(\d+\.?\d*)/i);
-
-      if (currentEye && sphMatch) {
-        data[currentEye].sphere = parseFloat(sphMatch[1]);
-      }
-      if (currentEye && cylMatch) {
-        data[currentEye].cylinder = parseFloat(cylMatch[1]);
-      }
-      if (currentEye && axisMatch) {
-        data[currentEye].axis = parseInt(axisMatch[1]);
-      }
-      if (currentEye && k1Match) {
-        data[currentEye].k1 = parseFloat(k1Match[1]);
-      }
-      if (currentEye && k2Match) {
-        data[currentEye].k2 = parseFloat(k2Match[1]);
-      }
-
-      // Parse date
-      const dateMatch = trimmed.match(/Date[:\s]+(\d{4}-\d{2}-\d{2}|\d{2}\/\d{2}\/\d{4})/i);
-      if (dateMatch) {
-        data.measurementDate = new Date(dateMatch[1]);
-      }
-    }
-
-    return [data];
-  }
 }
 
 module.exports = AutorefractorAdapter;
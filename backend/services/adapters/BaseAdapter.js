@@ -15,6 +15,7 @@ const DeviceMeasurement = require('../../models/DeviceMeasurement');
 const DeviceImage = require('../../models/DeviceImage');
 const DeviceIntegrationLog = require('../../models/DeviceIntegrationLog');
 const OphthalmologyExam = require('../../models/OphthalmologyExam');
+const deviceParsers = require('../deviceParsers');
 
 class BaseAdapter {
   /**
@@ -29,6 +30,10 @@ class BaseAdapter {
     this.device = device;
     this.deviceType = device.type;
     this.deviceId = device._id;
+
+    // Declarative export mapping id (services/deviceParsers/formats);
+    // subclasses set the mapping whose output their transform() expects
+    this.exportFormat = null;
   }
 
   /**
@@ -137,9 +142,13 @@ class BaseAdapter {
 
   /**
    * Parse CSV content
-   * Can be overridden by subclasses for device-specific CSV format
+   * Uses the export mapping when one exists, otherwise returns raw row objects
    */
   parseCSV(content) {
+    if (deviceParsers.supports(this.exportFormat, 'csv')) {
+      return this.parseExport(content, 'csv');
+    }
+
     try {
       if (Buffer.isBuffer(content)) {
         content = content.toString('utf-8');
@@ -171,19 +180,30 @@ class BaseAdapter {
   }
 
   /**
-   * Parse XML content
-   * Should be overridden by subclasses if XML support is needed
+   * Parse XML content through the export mapping
    */
   parseXML(content) {
-    throw new Error('XML parsing must be implemented by subclass');
+    if (!deviceParsers.supports(this.exportFormat, 'xml')) {
+      throw new Error('XML parsing must be implemented by subclass');
+    }
+    return this.parseExport(content, 'xml');
   }
 
   /**
-   * Parse TXT content
-   * Should be overridden by subclasses for device-specific text format
+   * Parse TXT content through the export mapping
    */
   parseTXT(content) {
-    throw new Error('TXT parsing must be implemented by subclass');
+    if (!deviceParsers.supports(this.exportFormat, 'txt')) {
+      throw new Error('TXT parsing must be implemented by subclass');
+    }
+    return this.parseExport(content, 'txt');
+  }
+
+  /**
+   * Parse content with this adapter's compiled export mapping
+   */
+  parseExport(content, fileFormat) {
+    return deviceParsers.parseExport(content, { format: this.exportFormat, fileFormat });
   }
 
   /**
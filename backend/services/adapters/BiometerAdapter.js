@@ -23,6 +23,7 @@ class BiometerAdapter extends BaseAdapter {
   constructor(device) {
     super(device);
     this.measurementType = 'biometry';
+    this.exportFormat = 'biometer';
   }
 
   /**
@@ -422,59 +423,6 @@ class BiometerAdapter extends BaseAdapter {
 
     return findings;
   }
-
-  /**
-   * Parse CSV format from biometry device export
-   */
-  parseCSV(content) {
-    const rows = super.parseCSV(content);
-
-    return rows.map(row => ({
-      eye: row.Eye || row.eye || row.EYE || (row.OD ? 'OD' : 'OS'),
-      capturedAt: new Date(row.Date || row.date || row.ExamDate),
-      axialLength: parseFloat(row.AL || row.AxialLength || row['Axial Length']),
-      k1: parseFloat(row.K1 || row['K1(D)'] || row.FlatK),
-      k2: parseFloat(row.K2 || row['K2(D)'] || row.SteepK),
-      axis1: parseFloat(row.Axis1 || row.K1Axis),
-      axis2: parseFloat(row.Axis2 || row.K2Axis),
-      acd: parseFloat(row.ACD || row['ACD(mm)'] || row.AnteriorChamber),
-      lensThickness: parseFloat(row.LT || row.LensThickness || row['Lens(mm)']),
-      wtw: parseFloat(row.WTW || row.WhiteToWhite || row['WTW(mm)']),
-      pupilSize: parseFloat(row.Pupil || row.PupilSize),
-      snr: parseFloat(row.SNR || row.SignalRatio),
-      iolPower: parseFloat(row.IOL || row.IOLPower)
-    }));
-  }
-
-  /**
-   * Parse XML format (common for IOL Master export)
-   */
-  parseXML(content) {
-    // Basic XML parsing - in production would use xml2js or similar
-    if (Buffer.isBuffer(content)) {
-      content = content.toString('utf-8');
-    }
-
-    const data = {};
-
-    // Extract common XML tags
-    const extractValue = (tag) => {
-      const regex = new RegExp(`<${tag}[^>]*>([^<]+)</${tag}>`, 'i');
-      const match = content.match(regex);
-      return match ? match[1].trim() : null;
-    };
-
-    data.eye = extractValue('Eye') || extractValue('Laterality');
-    data.axialLength = parseFloat(extractValue('AxialLength') || extractValue('AL'));
-    data.k1 = parseFloat(extractValue('K1') || extractValue('FlatK'));
-    data.k2 = parseFloat(extractValue('K2') || extractValue('SteepK'));
-    data.acd = parseFloat(extractValue('ACD') || extractValue('AnteriorChamberDepth'));
-    data.lensThickness = parseFloat(extractValue('LensThickness') || extractValue('LT'));
-    data.wtw = parseFloat(extractValue('WTW') || extractValue('WhiteToWhite'));
-    data.capturedAt = extractValue('ExamDate') || extractValue('Date');
-
-    return data;
-  }
 }
 
 module.exports = BiometerAdapter;
@@ -16,12 +16,20 @@
  */
 
 const BaseAdapter = require('./BaseAdapter');
-const xml2js = require('xml2js');
+
+// Export mapping (services/deviceParsers/formats) per measurement type
+const EXPORT_FORMATS = {
+  'auto-refraction': 'nidek-ark',
+  biometry: 'nidek-alscan',
+  tonometry: 'nidek-nt',
+  'specular-microscopy': 'nidek-cem'
+};
 
 class NidekAdapter extends BaseAdapter {
   constructor(device) {
     super(device);
     this.measurementType = this.detectMeasurementType(device);
+    this.exportFormat = EXPORT_FORMATS[this.measurementType] || 'nidek';
   }
 
   /**
@@ -260,249 +268,6 @@ class NidekAdapter extends BaseAdapter {
     return transformed;
   }
 
-  /**
-   * Parse NIDEK XML format
-   */
-  async parseXML(content) {
-    if (Buffer.isBuffer(content)) {
-      content = content.toString('utf-8');
-    }
-
-    try {
-      // Use xml2js for proper XML parsing
-      const parser = new xml2js.Parser({
-        explicitArray: false,
-        ignoreAttrs: false,
-        mergeAttrs: true
-      });
-
-      const result = await parser.parseStringPromise(content);
-
-      // Handle different NIDEK XML structures
-      return this.normalizeNidekXML(result);
-    } catch (error) {
-      // Fallback to regex-based parsing
-      return this.parseXMLFallback(content);
-    }
-  }
-
-  /**
-   * Normalize NIDEK XML structure to standard format
-   */
-  normalizeNidekXML(xmlData) {
-    const data = {};
-
-    // Try to find common NIDEK XML structures
-    const root = xmlData.NIDEK || xmlData.Export || xmlData.Data || xmlData;
-
-    // Patient info
-    if (root.Patient) {
-      data.patientName = root.Patient.Name || root.Patient.PatientName;
-      data.patientId = root.Patient.ID || root.Patient.PatientID;
-      data.dateOfBirth = root.Patient.DOB || root.Patient.BirthDate;
-    }
-
-    // Exam info
-    const exam = root.Exam || root.Measurement || root.Result || root;
-
-    // Eye
-    data.eye = exam.Eye || exam.Laterality || this.extractEye(exam);
-
-    // Date
-    data.capturedAt = exam.Date || exam.ExamDate || exam.DateTime;
-    if (data.capturedAt) {
-      data.capturedAt = new Date(data.capturedAt);
-    }
-
-    // Measurement data based on type
-    if (this.measurementType === 'auto-refraction') {
-      // Refraction data
-      const ref = exam.Refraction || exam.AR || exam;
-      data.sphere = parseFloat(ref.Sphere || ref.SPH || ref.S);
-      data.cylinder = parseFloat(ref.Cylinder || ref.CYL || ref.C);
-      data.axis = parseFloat(ref.Axis || ref.AX || ref.A);
-      data.va = ref.VA || ref.VisualAcuity;
-      data.pupilSize = parseFloat(ref.PupilSize || ref.Pupil || ref.PD);
-
-      // Keratometry data
-      const kerat = exam.Keratometry || exam.K || exam;
-      data.k1 = parseFloat(kerat.K1 || kerat.FlatK);
-      data.k2 = parseFloat(kerat.K2 || kerat.SteepK);
-      data.k1Axis = parseFloat(kerat.K1Axis || kerat.FlatAxis);
-      data.k2Axis = parseFloat(kerat.K2Axis || kerat.SteepAxis);
-    }
-
-    if (this.measurementType === 'biometry') {
-      const bio = exam.Biometry || exam.ALScan || exam;
-      data.axialLength = parseFloat(bio.AxialLength || bio.AL);
-      data.k1 = parseFloat(bio.K1 || bio.FlatK);
-      data.k2 = parseFloat(bio.K2 || bio.SteepK);
-      data.acd = parseFloat(bio.ACD || bio.AnteriorChamber);
-      data.lensThickness = parseFloat(bio.LT || bio.LensThickness);
-      data.wtw = parseFloat(bio.WTW || bio.WhiteToWhite);
-    }
-
-    if (this.measurementType === 'tonometry') {
-      const ton = exam.Tonometry || exam.IOP || exam;
-      data.iop = parseFloat(ton.IOP || ton.Pressure);
-      data.readings = [];
-      if (ton.Reading1) data.readings.push(parseFloat(ton.Reading1));
-      if (ton.Reading2) data.readings.push(parseFloat(ton.Reading2));
-      if (ton.Reading3) data.readings.push(parseFloat(ton.Reading3));
-    }
-
-    return data;
-  }
-
-  /**
-   * Fallback XML parsing using regex
-   */
-  parseXMLFallback(content) {
-    const data = {};
-
-    const extractValue = (tag) => {
-      const regex = new RegExp(`<${tag}[^>]*>([^<]+)</${tag}>`, 'i');
-      const match = content.match(regex);
-      return match ? match[1].trim() : null;
-    };
-
-    // Extract common fields
-    data.eye = extractValue('Eye') || extractValue('Laterality');
-    data.capturedAt = extractValue('Date') || extractValue('ExamDate');
-
-    // Refraction
-    data.sphere = parseFloat(extractValue('Sphere') || extractValue('SPH'));
-    data.cylinder = parseFloat(extractValue('Cylinder') || extractValue('CYL'));
-    data.axis = parseFloat(extractValue('Axis') || extractValue('AX'));
-
-    // Keratometry
-    data.k1 = parseFloat(extractValue('K1') || extractValue('FlatK'));
-    data.k2 = parseFloat(extractValue('K2') || extractValue('SteepK'));
-
-    // Biometry
-    data.axialLength = parseFloat(extractValue('AxialLength') || extractValue('AL'));
-    data.acd = parseFloat(extractValue('ACD'));
-
-    // Tonometry
-    data.iop = parseFloat(extractValue('IOP') || extractValue('Pressure'));
-
-    return data;
-  }
-
-  /**
-   * Extract eye from various field names
-   */
-  extractEye(data) {
-    // Check for OD/OS specific data
-    if (data.OD || data.od || data.Right || data.right) return 'OD';
-    if (data.OS || data.os || data.Left || data.left) return 'OS';
-    if (data.OU || data.ou || data.Both || data.both) return 'OU';
-    return 'OD'; // Default
-  }
-
-  /**
-   * Parse CSV format
-   */
-  parseCSV(content) {
-    const rows = super.parseCSV(content);
-
-    return rows.map(row => {
-      const data = {
-        eye: row.Eye || row.eye || row.EYE,
-        capturedAt: new Date(row.Date || row.date || row.ExamDate)
-      };
-
-      // Map based on measurement type
-      switch (this.measurementType) {
-        case 'auto-refraction':
-          data.sphere = parseFloat(row.SPH || row.Sphere || row.S);
-          data.cylinder = parseFloat(row.CYL || row.Cylinder || row.C);
-          data.axis = parseFloat(row.AX || row.Axis || row.A);
-          data.k1 = parseFloat(row.K1 || row.FlatK);
-          data.k2 = parseFloat(row.K2 || row.SteepK);
-          break;
-
-        case 'biometry':
-          data.axialLength = parseFloat(row.AL || row.AxialLength);
-          data.k1 = parseFloat(row.K1);
-          data.k2 = parseFloat(row.K2);
-          data.acd = parseFloat(row.ACD);
-          data.lensThickness = parseFloat(row.LT);
-          data.wtw = parseFloat(row.WTW);
-          break;
-
-        case 'tonometry':
-          data.iop = parseFloat(row.IOP || row.Pressure);
-          break;
-
-        case 'specular-microscopy':
-          data.ecd = parseFloat(row.ECD || row.CD);
-          data.cv = parseFloat(row.CV);
-          data.hexagonality = parseFloat(row.HEX);
-          data.cct = parseFloat(row.CCT);
-          break;
-      }
-
-      return data;
-    });
-  }
-
-  /**
-   * Parse proprietary TXT format
-   */
-  parseTXT(content) {
-    if (Buffer.isBuffer(content)) {
-      content = content.toString('utf-8');
-    }
-
-    const lines = content.split('\n');
-    const data = {};
-
-    for (const line of lines) {
-      const trimmed = line.trim();
-      if (!trimmed || trimmed.startsWith('#') || trimmed.startsWith(';')) continue;
-
-      // Handle various NIDEK text formats
-      let key, value;
-
-      if (trimmed.includes(':')) {
-        [key, value] = trimmed.split(':').map(s => s.trim());
-      } else if (trimmed.includes('=')) {
-        [key, value] = trimmed.split('=').map(s => s.trim());
-      } else if (trimmed.includes('\t')) {
-        [key, value] = trimmed.split('\t').map(s => s.trim());
-      }
-
-      if (key && value) {
-        const normalizedKey = this.normalizeFieldName(key);
-        data[normalizedKey] = isNaN(value) ? value : parseFloat(value);
-      }
-    }
-
-    return data;
-  }
-
-  /**
-   * Normalize field name to standard format
-   */
-  normalizeFieldName(name) {
-    const fieldMap = {
-      'Sphere': 'sphere', 'SPH': 'sphere', 'S': 'sphere',
-      'Cylinder': 'cylinder', 'CYL': 'cylinder', 'C': 'cylinder',
-      'Axis': 'axis', 'AX': 'axis', 'A': 'axis',
-      'K1': 'k1', 'Flat K': 'k1', 'FlatK': 'k1',
-      'K2': 'k2', 'Steep K': 'k2', 'SteepK': 'k2',
-      'Axial Length': 'axialLength', 'AL': 'axialLength',
-      'ACD': 'acd', 'Anterior Chamber': 'acd',
-      'IOP': 'iop', 'Pressure': 'iop',
-      'ECD': 'ecd', 'Cell Density': 'ecd',
-      'Eye': 'eye', 'Laterality': 'eye',
-      'Date': 'capturedAt', 'Exam Date': 'capturedAt'
-    };
-
-    return fieldMap[name] || name.toLowerCase().replace(/\s+/g, '');
-  }
-
   /**
    * Calculate quality score
    */
@@ -28,6 +28,7 @@ class OctAdapter extends BaseAdapter {
   constructor(device) {
     super(device);
     this.measurementType = 'OCT';
+    this.exportFormat = 'oct';
   }
 
   /**
@@ -393,33 +394,6 @@ class OctAdapter extends BaseAdapter {
     const random = Math.floor(Math.random() * 1000000);
     return `1.2.840.10008.${timestamp}.${random}`;
   }
-
-  /**
-   * Parse CSV format (for some OCT devices that export to CSV)
-   */
-  parseCSV(content) {
-    const rows = super.parseCSV(content);
-
-    // Transform CSV rows to OCT data format
-    return rows.map(row => ({
-      eye: row.Eye || row.eye,
-      capturedAt: new Date(row.Date || row.date),
-      retinalThickness: parseFloat(row['Central Thickness'] || row.centralThickness),
-      signalStrength: parseFloat(row['Signal Strength'] || row.signalStrength),
-      qualityScore: parseFloat(row['Quality'] || row.quality || 100),
-      rnfl: {
-        average: parseFloat(row['RNFL Average'] || row.rnflAverage),
-        superior: parseFloat(row['RNFL Superior'] || row.rnflSuperior),
-        inferior: parseFloat(row['RNFL Inferior'] || row.rnflInferior),
-        nasal: parseFloat(row['RNFL Nasal'] || row.rnflNasal),
-        temporal: parseFloat(row['RNFL Temporal'] || row.rnflTemporal)
-      },
-      macula: {
-        centralThickness: parseFloat(row['Central Thickness'] || row.centralThickness),
-        volume: parseFloat(row['Macular Volume'] || row.macularVolume)
-      }
-    }));
-  }
 }
 
 module.exports = OctAdapter;
@@ -25,6 +25,7 @@ class SpecularMicroscopeAdapter extends BaseAdapter {
   constructor(device) {
     super(device);
     this.measurementType = 'specular-microscopy';
+    this.exportFormat = 'specular-microscope';
   }
 
   /**
@@ -398,75 +399,6 @@ class SpecularMicroscopeAdapter extends BaseAdapter {
       throw new Error(`Specular image processing failed: ${error.message}`);
     }
   }
-
-  /**
-   * Parse CSV format from specular microscope export
-   */
-  parseCSV(content) {
-    const rows = super.parseCSV(content);
-
-    return rows.map(row => ({
-      eye: row.Eye || row.eye || row.EYE,
-      capturedAt: new Date(row.Date || row.date || row.ExamDate),
-      ecd: parseFloat(row.ECD || row.CD || row['Cell Density'] || row.cellDensity),
-      cv: parseFloat(row.CV || row['CV%'] || row.CoeffVar),
-      hexagonality: parseFloat(row.HEX || row['HEX%'] || row.Hexagonality || row['6A']),
-      cct: parseFloat(row.CCT || row.Pachymetry || row.Thickness),
-      avgCellArea: parseFloat(row.AVG || row['Avg Area'] || row.avgCellArea),
-      cellCount: parseInt(row.NUM || row['Cell Count'] || row.Count || row.N),
-      imageQuality: parseFloat(row.Quality || row.IQ)
-    }));
-  }
-
-  /**
-   * Parse TXT format (some devices export in proprietary text format)
-   */
-  parseTXT(content) {
-    if (Buffer.isBuffer(content)) {
-      content = content.toString('utf-8');
-    }
-
-    const lines = content.split('\n');
-    const data = {};
-
-    // Parse key-value pairs
-    for (const line of lines) {
-      const trimmed = line.trim();
-      if (!trimmed || trimmed.startsWith('#')) continue;
-
-      // Try different delimiters
-      let key, value;
-      if (trimmed.includes(':')) {
-        [key, value] = trimmed.split(':').map(s => s.trim());
-      } else if (trimmed.includes('=')) {
-        [key, value] = trimmed.split('=').map(s => s.trim());
-      } else if (trimmed.includes('\t')) {
-        [key, value] = trimmed.split('\t').map(s => s.trim());
-      }
-
-      if (key && value) {
-        // Map common keys
-        const keyMap = {
-          'Cell Density': 'ecd',
-          'CD': 'ecd',
-          'ECD': 'ecd',
-          'CV': 'cv',
-          'Coefficient of Variation': 'cv',
-          'HEX': 'hexagonality',
-          'Hexagonality': 'hexagonality',
-          'CCT': 'cct',
-          'Pachymetry': 'cct',
-          'Eye': 'eye',
-          'Date': 'capturedAt'
-        };
-
-        const mappedKey = keyMap[key] || key.toLowerCase().replace(/\s+/g, '');
-        data[mappedKey] = isNaN(value) ? value : parseFloat(value);
-      }
-    }
-
-    return data;
-  }
 }
 
 module.exports = SpecularMicroscopeAdapter;
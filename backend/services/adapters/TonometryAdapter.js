@@ -21,6 +21,7 @@ class TonometryAdapter extends BaseAdapter {
   constructor(device) {
     super(device);
     this.measurementType = 'IOP';
+    this.exportFormat = 'tonometer';
   }
 
   /**
@@ -335,107 +336,6 @@ class TonometryAdapter extends BaseAdapter {
 
     return Math.max(0, Math.min(100, score));
   }
-
-  /**
-   * Parse CSV format (common for tonometer exports)
-   */
-  parseCSV(content) {
-    const rows = super.parseCSV(content);
-
-    // Transform CSV rows to tonometry data format
-    return rows.map(row => {
-      const data = {
-        measurementDate: new Date(row.Date || row.date || row.Time || row.time),
-        method: (row.Method || row.method || 'unknown').toLowerCase(),
-        source: 'folder-sync'
-      };
-
-      // Parse OD data
-      if (row['OD IOP'] || row.OD_IOP || row.IOP_OD) {
-        data.OD = {
-          iop: parseFloat(row['OD IOP'] || row.OD_IOP || row.IOP_OD),
-          method: data.method,
-          time: row.Time || row.time || new Date().toISOString()
-        };
-
-        if (row['OD Pachymetry'] || row.OD_Pachymetry) {
-          data.OD.pachymetry = parseFloat(row['OD Pachymetry'] || row.OD_Pachymetry);
-        }
-
-        // Parse multiple readings if available
-        const readings = [];
-        for (let i = 1; i <= 3; i++) {
-          const reading = row[`OD Reading ${i}`] || row[`OD_R${i}`];
-          if (reading) readings.push(parseFloat(reading));
-        }
-        if (readings.length > 0) {
-          data.OD.readings = readings;
-        }
-      }
-
-      // Parse OS data
-      if (row['OS IOP'] || row.OS_IOP || row.IOP_OS) {
-        data.OS = {
-          iop: parseFloat(row['OS IOP'] || row.OS_IOP || row.IOP_OS),
-          method: data.method,
-          time: row.Time || row.time || new Date().toISOString()
-        };
-
-        if (row['OS Pachymetry'] || row.OS_Pachymetry) {
-          data.OS.pachymetry = parseFloat(row['OS Pachymetry'] || row.OS_Pachymetry);
-        }
-
-        // Parse multiple readings if available
-        const readings = [];
-        for (let i = 1; i <= 3; i++) {
-          const reading = row[`OS Reading ${i}`] || row[`OS_R${i}`];
-          if (reading) readings.push(parseFloat(reading));
-        }
-        if (readings.length > 0) {
-          data.OS.readings = readings;
-        }
-      }
-
-      return data;
-    });
-  }
-
-  /**
-   * Parse TXT format (some tonometers export to text files)
-   */
-  parseTXT(content) {
-    if (Buffer.isBuffer(content)) {
-      content = content.toString('utf-8');
-    }
-
-    const lines = content.split('\n').filter(line => line.trim());
-    const data = {
-      source: 'folder-sync'
-    };
-
-    // Simple parser for key-value pairs
-    for (const line of lines) {
-      const [key, value] = line.split(':').map(s => s.trim());
-
-      if (key.includes('Date') || key.includes('Time')) {
-        data.measurementDate = new Date(value);
-      } else if (key.includes('Method')) {
-        data.method = value.toLowerCase();
-      } else if (key.includes('OD IOP') || key.includes('Right IOP')) {
-        data.OD = { iop: parseFloat(value), method: data.method };
-      } else if (key.includes('OS IOP') || key.includes('Left IOP')) {
-        data.OS = { iop: parseFloat(value), method: data.method };
-      } else if (key.includes('OD Pachy') || key.includes('Right CCT')) {
-        if (!data.OD) data.OD = {};
-        data.OD.pachymetry = parseFloat(value);
-      } else if (key.includes('OS Pachy') || key.includes('Left CCT')) {
-        if (!data.OS) data.OS = {};
-        data.OS.pachymetry = parseFloat(value);
-      }
-    }
-
-    return [data]; // Return array for consistency with CSV parser
-  }
 }
 
 module.exports = TonometryAdapter;
@@ -30,6 +30,7 @@ class VisualFieldAdapter extends BaseAdapter {
   constructor(device) {
     super(device);
     this.measurementType = 'visual_field';
+    this.exportFormat = 'visual-field';
 
     // Standard test patterns with expected point counts
     this.TEST_PATTERNS = {
@@ -651,167 +652,6 @@ class VisualFieldAdapter extends BaseAdapter {
     const reliability = this.calculateReliability(data);
     return reliability.score;
   }
-
-  /**
-   * Parse CSV format from Humphrey HFA export
-   */
-  parseCSV(content) {
-    const rows = super.parseCSV(content);
-
-    return rows.map(row => ({
-      eye: row.Eye || row.eye || row.Laterality || (row.OD ? 'OD' : 'OS'),
-      capturedAt: new Date(row.Date || row.ExamDate || row['Exam Date']),
-      testPattern: row.Pattern || row.TestPattern || row['Test Pattern'] || '24-2',
-      strategy: row.Strategy || row.TestStrategy || 'SITA-Standard',
-      meanDeviation: parseFloat(row.MD || row.MeanDeviation || row['Mean Deviation']),
-      patternStandardDeviation: parseFloat(row.PSD || row.PatternSD || row['Pattern Standard Deviation']),
-      vfi: parseFloat(row.VFI || row.VisualFieldIndex),
-      fovealThreshold: parseFloat(row.Fovea || row.Foveal || row['Foveal Threshold']),
-      fixationLosses: row.FL || row.FixationLosses || row['Fixation Losses'],
-      falsePositives: parseFloat(row.FP || row.FalsePos || row['False Positives']),
-      falseNegatives: parseFloat(row.FN || row.FalseNeg || row['False Negatives']),
-      ghtResult: row.GHT || row.GlaucomaHemifield,
-      testDuration: parseFloat(row.Duration || row.TestDuration || row['Test Duration (min)']),
-      sensitivities: row.Sensitivities || row.Thresholds,
-      totalDeviation: row.TD || row.TotalDeviation,
-      patternDeviation: row.PD || row.PatternDeviation
-    }));
-  }
-
-  /**
-   * Parse XML format (Humphrey HFA XML export)
-   */
-  parseXML(content) {
-    if (Buffer.isBuffer(content)) {
-      content = content.toString('utf-8');
-    }
-
-    const data = {};
-
-    // Helper to extract XML values
-    const extractValue = (tag, defaultValue = null) => {
-      const regex = new RegExp(`<${tag}[^>]*>([^<]*)</${tag}>`, 'gi');
-      const match = content.match(regex);
-      if (match && match.length > 0) {
-        const innerMatch = match[0].match(/>([^<]*)</);
-        return innerMatch ? innerMatch[1].trim() : defaultValue;
-      }
-      return defaultValue;
-    };
-
-    // Extract array values (for sensitivity data)
-    const extractArray = (tag) => {
-      const regex = new RegExp(`<${tag}[^>]*>([^<]*)</${tag}>`, 'gi');
-      const matches = content.match(regex);
-      if (matches) {
-        return matches.map(m => {
-          const inner = m.match(/>([^<]*)</);
-          return inner ? parseFloat(inner[1]) : null;
-        }).filter(v => v !== null);
-      }
-      return null;
-    };
-
-    // Patient/exam info
-    data.eye = extractValue('Laterality') || extractValue('Eye') || extractValue('EyeTested');
-    data.capturedAt = extractValue('ExamDate') || extractValue('Date') || extractValue('TestDate');
-    data.testPattern = extractValue('TestPattern') || extractValue('Pattern') || '24-2';
-    data.strategy = extractValue('Strategy') || extractValue('TestStrategy') || 'SITA-Standard';
-
-    // Global indices
-    data.meanDeviation = parseFloat(extractValue('MD') || extractValue('MeanDeviation'));
-    data.patternStandardDeviation = parseFloat(extractValue('PSD') || extractValue('PatternStandardDeviation'));
-    data.vfi = parseFloat(extractValue('VFI') || extractValue('VisualFieldIndex'));
-    data.fovealThreshold = parseFloat(extractValue('FovealThreshold') || extractValue('Fovea'));
-
-    // Reliability
-    data.fixationLosses = extractValue('FixationLosses') || extractValue('FL');
-    data.falsePositives = parseFloat(extractValue('FalsePositives') || extractValue('FP'));
-    data.falseNegatives = parseFloat(extractValue('FalseNegatives') || extractValue('FN'));
-
-    // GHT
-    data.ghtResult = extractValue('GHT') || extractValue('GlaucomaHemifieldTest');
-
-    // Test info
-    data.testDuration = parseFloat(extractValue('TestDuration') || extractValue('Duration'));
-
-    // Sensitivity data (may be in various formats)
-    data.sensitivities = extractArray('Threshold') || extractArray('Sensitivity');
-    data.totalDeviation = extractArray('TotalDeviation') || extractArray('TD');
-    data.patternDeviation = extractArray('PatternDeviation') || extractArray('PD');
-
-    return data;
-  }
-
-  /**
-   * Parse TXT format (simple text export)
-   */
-  parseTXT(content) {
-    if (Buffer.isBuffer(content)) {
-      content = content.toString('utf-8');
-    }
-
-    const data = {};
-    const lines = content.split('\n');
-
-    // Look for key-value pairs
-    for (const line of lines) {
-      const trimmed = line.trim();
-      if (!trimmed) continue;
-
-      // Try common patterns
-      const colonMatch = trimmed.match(/^([^:]+):\s*(.+)$/);
-      if (colonMatch) {
-        const key = colonMatch[1].trim().toLowerCase().replace(/\s+/g, '_');
-        const value = colonMatch[2].trim();
-
-        switch (key) {
-          case 'eye':
-          case 'laterality':
-            data.eye = value.includes('R') || value.includes('OD') ? 'OD' : 'OS';
-            break;
-          case 'md':
-          case 'mean_deviation':
-            data.meanDeviation = parseFloat(value);
-            break;
-          case 'psd':
-          case 'pattern_standard_deviation':
-            data.patternStandardDeviation = parseFloat(value);
-            break;
-          case 'vfi':
-          case 'visual_field_index':
-            data.vfi = parseFloat(value);
-            break;
-          case 'fovea':
-          case 'foveal':
-            data.fovealThreshold = parseFloat(value);
-            break;
-          case 'fl':
-          case 'fixation_losses':
-            data.fixationLosses = value;
-            break;
-          case 'fp':
-          case 'false_positives':
-            data.falsePositives = parseFloat(value);
-            break;
-          case 'fn':
-          case 'false_negatives':
-            data.falseNegatives = parseFloat(value);
-            break;
-          case 'ght':
-          case 'glaucoma_hemifield_test':
-            data.ghtResult = value;
-            break;
-          case 'pattern':
-          case 'test_pattern':
-            data.testPattern = value;
-            break;
-        }
-      }
-    }
-
-    return data;
-  }
 }
 
 module.exports = VisualFieldAdapter;
@@ -1,5 +1,6 @@
 const cron = require('node-cron');
 const Alert = require('../models/Alert');
+const dbCostTracer = require('./dbCostTracer');
 
 const { createContextLogger } = require('../utils/structuredLogger');
 const log = createContextLogger('AlertScheduler');
@@ -27,19 +28,19 @@ class AlertScheduler {
     log.info('🔔 Starting alert scheduler...');
 
     // Job 1: Check for alerts ready to deliver (every 1 minute)
-    const deliveryJob = cron.schedule('* * * * *', async () => {
+    const deliveryJob = cron.schedule('* * * * *', dbCostTracer.wrapJob('job:alert-delivery', async () => {
       await this.deliverScheduledAlerts();
-    });
+    }));
 
     // Job 2: Process recurring alerts (every 5 minutes)
-    const recurringJob = cron.schedule('*/5 * * * *', async () => {
+    const recurringJob = cron.schedule('*/5 * * * *', dbCostTracer.wrapJob('job:alert-recurring', async () => {
       await this.processRecurringAlerts();
-    });
+    }));
 
     // Job 3: Clean up expired alerts (every hour)
-    const cleanupJob = cron.schedule('0 * * * *', async () => {
+    const cleanupJob = cron.schedule('0 * * * *', dbCostTracer.wrapJob('job:alert-cleanup', async () => {
       await this.cleanupExpiredAlerts();
-    });
+    }));
 
     this.jobs = [deliveryJob, recurringJob, cleanupJob];
     this.isRunning = true;
@@ -0,0 +1,472 @@
+/**
+ * Bulk Invoice Service
+ *
+ * Set-based invoice generation for month-end and convention batch billing:
+ * - Loads all visits/appointments and their patients in batched queries
+ * - Dedupes against existing invoices with one $in lookup per source type
+ * - Prices every line from the compiled price book
+ * - Allocates invoice numbers as one counter block and inserts with insertMany
+ * - Applies patient links, account balances and encounter back-links in aggregate
+ *
+ * generateSequential keeps the record-by-record path (Invoice.create with all
+ * save hooks) for small batches and as the reference the set-based path must match.
+ */
+
+const mongoose = require('mongoose');
+const Invoice = require('../models/Invoice');
+const Patient = require('../models/Patient');
+const Visit = require('../models/Visit');
+const Appointment = require('../models/Appointment');
+const Counter = require('../models/Counter');
+const priceBookService = require('./priceBookService');
+const { roundToDecimals } = require('../utils/financialValidation');
+const { createContextLogger } = require('../utils/structuredLogger');
+
+const log = createContextLogger('BulkInvoice');
+
+// ============================================
+// CONSTANTS
+// ============================================
+
+const DUE_DAYS = 30;
+const DAY_MS = 24 * 60 * 60 * 1000;
+const INSERT_BATCH_SIZE = 500;
+const BALANCE_EXCLUDED_STATUSES = ['cancelled', 'voided'];
+
+// ============================================
+// LINE BUILDERS (pure)
+// ============================================
+
+function lineItem({ code, description, category, quantity = 1, unitPrice = 0, reference }) {
+  const total = quantity * unitPrice;
+  const item = {
+    code,
+    description,
+    category,
+    quantity,
+    unitPrice,
+    discount: 0,
+    subtotal: total,
+    tax: 0,
+    total
+  };
+  if (reference) item.reference = reference;
+  return item;
+}
+
+/**
+ * Completed clinical acts, at the price captured at service time or,
+ * when none was captured, the fee effective on the visit date
+ */
+function buildVisitItems(visit, priceBook) {
+  return (visit.clinicalActs || [])
+    .filter(act => act.status === 'completed')
+    .map(act => {
+      const captured = act.price > 0 ? act.price : null;
+      const fee = captured === null && act.actCode && priceBook
+        ? priceBook.currentFee(act.actCode, visit.visitDate || new Date())
+        : null;
+
+      return lineItem({
+        code: act.actCode || 'SERVICE',
+        description: act.actName || act.actType,
+        category: act.actType || 'procedure',
+        unitPrice: captured ?? fee?.price ?? 0,
+        reference: act.actId ? `ClinicalAct:${act.actId}` : undefined
+      });
+    });
+}
+
+/**
+ * Appointment billing services when recorded, otherwise a single
+ * consultation line at the booked amount or the CONSULT fee
+ */
+function buildAppointmentItems(appointment, priceBook) {
+  const description = appointment.type || 'Consultation';
+  const services = appointment.billing?.services || [];
+
+  if (services.length > 0) {
+    return services.map(service => lineItem({
+      code: 'SERVICE',
+      description,
+      category: 'consultation',
+      quantity: service.quantity || 1,
+      unitPrice: service.price || 0,
+      reference: service.service ? `Service:${service.service}` : undefined
+    }));
+  }
+
+  const fee = priceBook ? priceBook.currentFee('CONSULT', appointment.date || new Date()) : null;
+  return [lineItem({
+    code: 'CONSULT',
+    description,
+    category: 'consultation',
+    unitPrice: appointment.billing?.totalAmount ?? fee?.price ?? 0
+  })];
+}
+
+/**
+ * Same totals the Invoice pre-save hook computes for an unpaid invoice
+ */
+function computeSummary(items) {
+  const sum = key => roundToDecimals(
+    items.reduce((total, item) => total + (parseFloat(item[key]) || 0), 0),
+    0 // CDF has no decimals
+  );
+  const total = sum('total');
+
+  return {
+    subtotal: sum('subtotal'),
+    discountTotal: sum('discount'),
+    taxTotal: sum('tax'),
+    total,
+    amountPaid: 0,
+    amountDue: Math.max(0, total)
+  };
+}
+
+const SOURCES = {
+  visit: {
+    label: 'Visit',
+    field: 'visit',
+    model: () => Visit,
+    select: 'patient clinic visitId visitDate clinicalActs',
+    buildItems: buildVisitItems,
+    backLink: invoice => ({ 'billing.invoice': invoice._id, 'billing.totalCharges': invoice.summary.total })
+  },
+  appointment: {
+    label: 'Appointment',
+    field: 'appointment',
+    model: () => Appointment,
+    select: 'patient clinic date type billing',
+    buildItems: buildAppointmentItems,
+    backLink: invoice => ({ 'billing.invoice': invoice._id })
+  }
+};
+
+function buildInvoiceData(type, source, items, userId, options, now) {
+  return {
+    patient: source.patient?._id || source.patient,
+    [SOURCES[type].field]: source._id,
+    clinic: source.clinic,
+    items,
+    createdBy: userId,
+    dateIssued: now,
+    dueDate: new Date(now.getTime() + DUE_DAYS * DAY_MS),
+    status: options.status || 'draft',
+    summary: computeSummary(items)
+  };
+}
+
+/**
+ * Invoice numbering period, same format as the Invoice pre-save hook
+ */
+function invoicePeriod(now) {
+  return `${now.getFullYear()}${String(now.getMonth() + 1).padStart(2, '0')}`;
+}
+
+function formatInvoiceId(period, sequence) {
+  return `INV${period}${String(sequence).padStart(6, '0')}`;
+}
+
+function toResults(outcomes) {
+  const results = { success: [], failed: [], skipped: [] };
+  for (const outcome of outcomes) {
+    results[outcome.status].push(outcome.entry);
+  }
+  return results;
+}
+
+// ============================================
+// SEQUENTIAL PATH
+// ============================================
+
+/**
+ * Record-by-record generation: one load, one duplicate check and one
+ * Invoice.create (with every save hook) per visit or appointment
+ */
+async function generateSequential({ visitIds = [], appointmentIds = [] }, userId, options = {}) {
+  const results = { success: [], failed: [], skipped: [] };
+  const priceBook = await priceBookService.getBook();
+
+  for (const [type, ids] of [['visit', visitIds], ['appointment', appointmentIds]]) {
+    const { label, field, model, buildItems, backLink } = SOURCES[type];
+
+    for (const id of ids || []) {
+      try {
+        const source = await model().findById(id).populate('patient');
+
+        if (!source) {
+          results.failed.push({ id, type, error: `${label} not found` });
+          continue;
+        }
+        if (!source.patient) {
+          results.failed.push({ id, type, error: 'Patient not found' });
+          continue;
+        }
+
+        const existingInvoice = await Invoice.findOne({ [field]: id });
+        if (existingInvoice && !options.allowDuplicates) {
+          results.skipped.push({ id, type, reason: 'Invoice already exists', invoiceId: existingInvoice.invoiceId });
+          continue;
+        }
+
+        const items = buildItems(source, priceBook);
+        if (items.length === 0) {
+          results.skipped.push({ id, type, reason: 'No billable items' });
+          continue;
+        }
+
+        const invoice = await Invoice.create(buildInvoiceData(type, source, items, userId, options, new Date()));
+        await model().updateOne({ _id: source._id }, { $set: backLink(invoice) });
+
+        results.success.push({ id, type, invoiceId: invoice.invoiceId, invoice: invoice._id });
+      } catch (error) {
+        results.failed.push({ id, type, error: error.message });
+      }
+    }
+  }
+
+  return results;
+}
+
+// ============================================
+// SET-BASED PATH
+// ============================================
+
+/**
+ * Load sources and existing invoices for every requested ID in one
+ * query each per source type, then the referenced patients in one query
+ */
+async function loadCandidates(requests, options) {
+  const sources = new Map();
+  const existing = new Map();
+
+  await Promise.all(Object.entries(SOURCES).map(async ([type, { field, model, select }]) => {
+    const ids = [...new Set(requests.filter(r => r.type === type && r.valid).map(r => String(r.id)))];
+    if (ids.length === 0) return;
+
+    const [docs, invoices] = await Promise.all([
+      model().find({ _id: { $in: ids } }).select(select).lean(),
+      options.allowDuplicates
+        ? []
+        : Invoice.find({ [field]: { $in: ids } }).select(`${field} invoiceId`).sort({ createdAt: 1 }).lean()
+    ]);
+
+    for (const doc of docs) sources.set(`${type}:${doc._id}`, doc);
+    for (const invoice of invoices) {
+      const key = `${type}:${invoice[field]}`;
+      if (!existing.has(key)) existing.set(key, invoice.invoiceId);
+    }
+  }));
+
+  const patientIds = [...new Set([...sources.values()].map(s => String(s.patient)))];
+  const patients = patientIds.length > 0
+    ? await Patient.find({ _id: { $in: patientIds } }).select('_id accountBalance.credit').lean()
+    : [];
+
+  return { sources, existing, patients: new Map(patients.map(p => [String(p._id), p])) };
+}
+
+/**
+ * Validate in memory, then insert in unordered batches so one bad
+ * document does not block the rest
+ */
+async function insertInvoices(pending) {
+  const inserted = [];
+  const docs = pending.map(p => new Invoice(p.data));
+  const valid = [];
+
+  docs.forEach((doc, i) => {
+    const error = doc.validateSync();
+    if (error) pending[i].error = error.message;
+    else valid.push(i);
+  });
+
+  for (let start = 0; start < valid.length; start += INSERT_BATCH_SIZE) {
+    const batch = valid.slice(start, start + INSERT_BATCH_SIZE);
+    try {
+      await Invoice.insertMany(batch.map(i => docs[i]), { ordered: false });
+      batch.forEach(i => inserted.push({ ...pending[i], invoice: docs[i] }));
+    } catch (error) {
+      if (!error.writeErrors) {
+        batch.forEach(i => { pending[i].error = error.message; });
+        continue;
+      }
+      const writeErrors = new Map(error.writeErrors.map(e => [e.index, e.errmsg || e.message]));
+      batch.forEach((i, position) => {
+        if (writeErrors.has(position)) pending[i].error = writeErrors.get(position);
+        else inserted.push({ ...pending[i], invoice: docs[i] });
+      });
+    }
+  }
+
+  return inserted;
+}
+
+/**
+ * Derived effects of the inserted invoices, applied once per patient and
+ * per source collection instead of once per invoice:
+ * - Patient.invoices links and recomputed account balances
+ * - Visit / Appointment billing.invoice back-links
+ * Inserts are picked up by the sync change streams like any other write.
+ */
+async function applySideEffects(inserted, patients, now) {
+  const byPatient = new Map();
+  for (const { invoice } of inserted) {
+    const key = String(invoice.patient);
+    if (!byPatient.has(key)) byPatient.set(key, []);
+    byPatient.get(key).push(invoice._id);
+  }
+
+  const balanceInvoices = await Invoice.find({
+    patient: { $in: [...byPatient.keys()] },
+    status: { $nin: BALANCE_EXCLUDED_STATUSES }
+  }).select('patient summary dueDate status payments.date payments.amount').lean();
+
+  const invoicesByPatient = new Map();
+  for (const invoice of balanceInvoices) {
+    const key = String(invoice.patient);
+    if (!invoicesByPatient.has(key)) invoicesByPatient.set(key, []);
+    invoicesByPatient.get(key).push(invoice);
+  }
+
+  const patientOps = [...byPatient.entries()].map(([patientId, invoiceIds]) => ({
+    updateOne: {
+      filter: { _id: patientId },
+      update: {
+        $addToSet: { invoices: { $each: invoiceIds } },
+        $set: {
+          accountBalance: Patient.computeAccountBalance(
+            invoicesByPatient.get(patientId) || [],
+            patients.get(patientId)?.accountBalance?.credit || 0,
+            now
+          )
+        }
+      }
+    }
+  }));
+
+  const sourceOps = Object.entries(SOURCES).map(([type, { model, backLink }]) => {
+    const ops = inserted
+      .filter(entry => entry.type === type)
+      .map(({ source, invoice }) => ({
+        updateOne: { filter: { _id: source._id }, update: { $set: backLink(invoice) } }
+      }));
+    return ops.length > 0 ? model().bulkWrite(ops, { ordered: false }) : null;
+  });
+
+  await Promise.all([
+    patientOps.length > 0 ? Patient.bulkWrite(patientOps, { ordered: false }) : null,
+    ...sourceOps
+  ]);
+}
+
+/**
+ * Set-based generation. Same per-invoice output and result shape as
+ * generateSequential, in a fixed number of round trips.
+ */
+async function generateInvoices({ visitIds = [], appointmentIds = [] }, userId, options = {}) {
+  const startedAt = Date.now();
+  const now = new Date();
+  const priceBook = await priceBookService.getBook();
+
+  const requests = [
+    ...(visitIds || []).map(id => ({ type: 'visit', id })),
+    ...(appointmentIds || []).map(id => ({ type: 'appointment', id }))
+  ].map(r => ({ ...r, valid: mongoose.isValidObjectId(r.id) }));
+
+  const { sources, existing, patients } = await loadCandidates(requests, options);
+
+  const outcomes = new Array(requests.length);
+  const pending = [];
+  const claimed = new Map();
+
+  requests.forEach(({ type, id, valid }, index) => {
+    const { label, buildItems } = SOURCES[type];
+    const key = `${type}:${id}`;
+    const source = valid ? sources.get(key) : null;
+
+    if (!valid) {
+      outcomes[index] = { status: 'failed', entry: { id, type, error: `Invalid ${type} ID` } };
+      return;
+    }
+    if (!source) {
+      outcomes[index] = { status: 'failed', entry: { id, type, error: `${label} not found` } };
+      return;
+    }
+    if (!patients.has(String(source.patient))) {
+      outcomes[index] = { status: 'failed', entry: { id, type, error: 'Patient not found' } };
+      return;
+    }
+    if (!options.allowDuplicates && existing.has(key)) {
+      outcomes[index] = { status: 'skipped', entry: { id, type, reason: 'Invoice already exists', invoiceId: existing.get(key) } };
+      return;
+    }
+    if (!options.allowDuplicates && claimed.has(key)) {
+      // Same ID twice in one request: the first occurrence's invoice wins
+      outcomes[index] = { status: 'skipped', entry: { id, type, reason: 'Invoice already exists' }, duplicateOf: claimed.get(key) };
+      return;
+    }
+
+    const items = buildItems(source, priceBook);
+    if (items.length === 0) {
+      outcomes[index] = { status: 'skipped', entry: { id, type, reason: 'No billable items' } };
+      return;
+    }
+
+    claimed.set(key, pending.length);
+    pending.push({ index, id, type, source, data: buildInvoiceData(type, source, items, userId, options, now) });
+  });
+
+  if (pending.length > 0) {
+    const period = invoicePeriod(now);
+    const first = await Counter.reserveSequenceBlock(`invoice-${period}`, pending.length);
+    pending.forEach((p, i) => { p.data.invoiceId = formatInvoiceId(period, first + i); });
+
+    const inserted = await insertInvoices(pending);
+    const insertedByIndex = new Map(inserted.map(entry => [entry.index, entry.invoice]));
+
+    for (const p of pending) {
+      outcomes[p.index] = p.error
+        ? { status: 'failed', entry: { id: p.id, type: p.type, error: p.error } }
+        : { status: 'success', entry: { id: p.id, type: p.type, invoiceId: p.data.invoiceId, invoice: insertedByIndex.get(p.index)._id } };
+    }
+
+    if (inserted.length > 0) {
+      try {
+        await applySideEffects(inserted, patients, now);
+      } catch (error) {
+        // Invoices are committed; balances are recomputed on the next invoice change
+        log.error('Error applying bulk invoice side effects', { error: error.message, count: inserted.length });
+      }
+    }
+  }
+
+  for (const outcome of outcomes) {
+    if (outcome.duplicateOf !== undefined) {
+      const first = pending[outcome.duplicateOf];
+      if (!first.error) outcome.entry.invoiceId = first.data.invoiceId;
+    }
+  }
+
+  const results = toResults(outcomes);
+  log.info('Bulk invoice generation complete', {
+    generated: results.success.length,
+    failed: results.failed.length,
+    skipped: results.skipped.length,
+    durationMs: Date.now() - startedAt
+  });
+
+  return results;
+}
+
+module.exports = {
+  generateInvoices,
+  generateSequential,
+  buildVisitItems,
+  buildAppointmentItems,
+  computeSummary,
+  formatInvoiceId,
+  invoicePeriod
+};
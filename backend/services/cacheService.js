@@ -21,12 +21,14 @@
 
 const { cache, isRedisConnected } = require('../config/redis');
 const CONSTANTS = require('../config/constants');
+const memoryWatchdog = require('./memoryWatchdog');
 
 const { createContextLogger } = require('../utils/structuredLogger');
 const log = createContextLogger('Cache');
 
 // In-memory fallback cache when Redis is unavailable
 const memoryCache = new Map();
+memoryWatchdog.register('cache:memory', () => memoryCache.size);
 
 // Cache statistics
 const stats = {
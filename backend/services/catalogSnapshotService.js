@@ -0,0 +1,399 @@
+/**
+ * Catalog Snapshot Service
+ *
+ * Serves reference data (medication, examination, pathology, laboratory, clinical,
+ * comment, dose, letter templates and the equipment catalog) as one versioned,
+ * gzip-compressed bundle so clients can keep a local copy and stop querying
+ * catalog endpoints on every consultation screen.
+ *
+ * - Version is a persisted Counter sequence, so it only ever increases
+ * - Writes are detected through catalogChangePlugin (debounced) plus a periodic
+ *   fingerprint check that catches seed scripts and direct DB edits
+ * - Clients call /snapshot once, then /snapshot/delta?since=<version>
+ * - 'catalog:changed' is broadcast over WebSocket whenever the version moves
+ */
+
+const crypto = require('crypto');
+const zlib = require('zlib');
+
+const MedicationTemplate = require('../models/MedicationTemplate');
+const ExaminationTemplate = require('../models/ExaminationTemplate');
+const PathologyTemplate = require('../models/PathologyTemplate');
+const LaboratoryTemplate = require('../models/LaboratoryTemplate');
+const ClinicalTemplate = require('../models/ClinicalTemplate');
+const CommentTemplate = require('../models/CommentTemplate');
+const DoseTemplate = require('../models/DoseTemplate');
+const LetterTemplate = require('../models/LetterTemplate');
+const EquipmentCatalog = require('../models/EquipmentCatalog');
+const Counter = require('../models/Counter');
+
+const { catalogChanges } = require('../utils/catalogChangeTracker');
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('CatalogSnapshot');
+
+const VERSION_COUNTER = 'catalogSnapshotVersion';
+const REBUILD_DEBOUNCE_MS = 500;
+const FINGERPRINT_INTERVAL_MS = 5 * 60 * 1000;
+const JOURNAL_MAX_VERSIONS = 200;
+
+/**
+ * Catalog registry. Filters mirror the active-record filters used by
+ * templateCatalogController so the snapshot holds what the endpoints return.
+ */
+const CATALOGS = {
+  medications: { model: MedicationTemplate, filter: { isActive: true } },
+  examinations: { model: ExaminationTemplate, filter: { isActive: true } },
+  pathologies: { model: PathologyTemplate, filter: { isActive: true } },
+  laboratories: { model: LaboratoryTemplate, filter: { isActive: true } },
+  clinical: { model: ClinicalTemplate, filter: { isActive: true } },
+  comments: { model: CommentTemplate, filter: { isActive: true } },
+  doses: { model: DoseTemplate, filter: { isActive: true } },
+  letters: { model: LetterTemplate, filter: { active: true } },
+  equipment: { model: EquipmentCatalog, filter: { isActive: true } }
+};
+
+const CATALOG_NAMES = Object.keys(CATALOGS);
+
+// ============================================
+// PURE HELPERS (exported for tests)
+// ============================================
+
+function hashDocument(doc) {
+  return crypto.createHash('sha1').update(JSON.stringify(doc)).digest('base64');
+}
+
+/**
+ * Diff a catalog's previous items against freshly loaded documents
+ * @param {Map} previous - id -> { hash, doc }
+ * @param {Array} docs - Fresh lean documents
+ * @returns {Object} { items: Map, upserts: [ids], deletes: [ids] }
+ */
+function diffCatalog(previous, docs) {
+  const items = new Map();
+  const upserts = [];
+
+  for (const doc of docs) {
+    const id = doc._id.toString();
+    const hash = hashDocument(doc);
+    items.set(id, { hash, doc });
+    if (previous.get(id)?.hash !== hash) upserts.push(id);
+  }
+
+  const deletes = [];
+  for (const id of previous.keys()) {
+    if (!items.has(id)) deletes.push(id);
+  }
+
+  return { items, upserts, deletes };
+}
+
+/**
+ * Merge journal entries newer than `since` into one delta per catalog.
+ * Later entries win: an id deleted after an upsert ends up deleted and vice versa.
+ * @returns {Object|null} { catalogName: { upserts: Set, deletes: Set } } or null if
+ *   `since` is older than the journal (client needs a full snapshot)
+ */
+function mergeJournal(journal, since, floorVersion) {
+  if (since < floorVersion) return null;
+
+  const merged = {};
+  for (const entry of journal) {
+    if (entry.version <= since) continue;
+    for (const [catalog, change] of Object.entries(entry.changes)) {
+      if (!merged[catalog]) merged[catalog] = { upserts: new Set(), deletes: new Set() };
+      change.upserts.forEach(id => {
+        merged[catalog].upserts.add(id);
+        merged[catalog].deletes.delete(id);
+      });
+      change.deletes.forEach(id => {
+        merged[catalog].deletes.add(id);
+        merged[catalog].upserts.delete(id);
+      });
+    }
+  }
+  return merged;
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+class CatalogSnapshotService {
+  constructor() {
+    this.version = 0;
+    // Oldest version a delta can be computed from
+    this.floorVersion = 0;
+    this.catalogs = new Map(CATALOG_NAMES.map(name => [name, { items: new Map(), fingerprint: null }]));
+    this.journal = [];
+    this.builtAt = null;
+
+    this._bundle = null;
+    this._bundleVersion = -1;
+    this._ready = null;
+    this._dirty = new Set();
+    this._debounceTimer = null;
+    this._fingerprintInterval = null;
+    this._rebuilding = Promise.resolve();
+    this._onChange = ({ catalog }) => this.markDirty(catalog);
+  }
+
+  /**
+   * Build the initial snapshot (idempotent; concurrent callers share one build)
+   */
+  ensureReady() {
+    if (!this._ready) {
+      this._ready = this._initialize().catch(err => {
+        this._ready = null;
+        throw err;
+      });
+    }
+    return this._ready;
+  }
+
+  async _initialize() {
+    const started = Date.now();
+    for (const name of CATALOG_NAMES) {
+      const docs = await this._load(name);
+      const { items } = diffCatalog(new Map(), docs);
+      const state = this.catalogs.get(name);
+      state.items = items;
+      state.fingerprint = await this._fingerprint(name);
+    }
+
+    this.version = await this._nextVersion();
+    this.floorVersion = this.version;
+    this.builtAt = new Date();
+
+    log.info('Catalog snapshot built', {
+      version: this.version,
+      items: this.itemCount(),
+      durationMs: Date.now() - started
+    });
+  }
+
+  /**
+   * Start listening for catalog writes and the periodic fingerprint check
+   */
+  start() {
+    catalogChanges.on('change', this._onChange);
+    if (!this._fingerprintInterval) {
+      this._fingerprintInterval = setInterval(() => {
+        this.checkFingerprints().catch(err =>
+          log.error('Catalog fingerprint check failed', { error: err.message }));
+      }, FINGERPRINT_INTERVAL_MS);
+      this._fingerprintInterval.unref?.();
+    }
+    this.ensureReady().catch(err => log.error('Catalog snapshot build failed', { error: err.message }));
+    log.info('Catalog snapshot service started');
+  }
+
+  stop() {
+    catalogChanges.off('change', this._onChange);
+    if (this._fingerprintInterval) {
+      clearInterval(this._fingerprintInterval);
+      this._fingerprintInterval = null;
+    }
+    if (this._debounceTimer) {
+      clearTimeout(this._debounceTimer);
+      this._debounceTimer = null;
+    }
+  }
+
+  /**
+   * Schedule a (debounced) rebuild of a catalog after a write
+   */
+  markDirty(catalog) {
+    if (!this.catalogs.has(catalog)) return;
+    this._dirty.add(catalog);
+    if (this._debounceTimer) return;
+    this._debounceTimer = setTimeout(() => {
+      this._debounceTimer = null;
+      const names = [...this._dirty];
+      this._dirty.clear();
+      this.refresh(names).catch(err =>
+        log.error('Catalog snapshot refresh failed', { error: err.message, catalogs: names }));
+    }, REBUILD_DEBOUNCE_MS);
+  }
+
+  /**
+   * Reload catalogs whose count / last update changed since the previous check
+   */
+  async checkFingerprints() {
+    if (!this._ready) return;
+    await this._ready;
+
+    const changed = [];
+    for (const name of CATALOG_NAMES) {
+      const fingerprint = await this._fingerprint(name);
+      if (fingerprint !== this.catalogs.get(name).fingerprint) changed.push(name);
+    }
+    if (changed.length) await this.refresh(changed);
+  }
+
+  /**
+   * Reload catalogs, record a new version if anything changed and notify clients.
+   * Refreshes are serialized so versions are journaled in order.
+   */
+  refresh(names = CATALOG_NAMES) {
+    this._rebuilding = this._rebuilding
+      .catch(() => {})
+      .then(() => this._refresh(names));
+    return this._rebuilding;
+  }
+
+  async _refresh(names) {
+    await this.ensureReady();
+
+    const changes = {};
+    const updated = new Map();
+    for (const name of names) {
+      const state = this.catalogs.get(name);
+      if (!state) continue;
+      const docs = await this._load(name);
+      const { items, upserts, deletes } = diffCatalog(state.items, docs);
+      updated.set(name, { items, fingerprint: await this._fingerprint(name) });
+      if (upserts.length || deletes.length) changes[name] = { upserts, deletes };
+    }
+
+    // Swap in fresh items even when unchanged so fingerprints stay current
+    for (const [name, next] of updated) this.catalogs.set(name, next);
+
+    if (Object.keys(changes).length === 0) return { version: this.version, changed: [] };
+
+    this.version = await this._nextVersion();
+    this.builtAt = new Date();
+    this.journal.push({ version: this.version, changes });
+    if (this.journal.length > JOURNAL_MAX_VERSIONS) {
+      const dropped = this.journal.shift();
+      this.floorVersion = dropped.version;
+    }
+
+    const changed = Object.keys(changes);
+    log.info('Catalog snapshot version bumped', { version: this.version, catalogs: changed });
+    this._notify(changed);
+
+    return { version: this.version, changed };
+  }
+
+  _notify(catalogs) {
+    try {
+      const websocketService = require('./websocketService');
+      // Reference data is clinic-independent and contains no PHI
+      websocketService.broadcastGlobal({
+        type: 'catalog:changed',
+        version: this.version,
+        catalogs
+      });
+    } catch (err) {
+      log.warn('Could not broadcast catalog change', { error: err.message });
+    }
+  }
+
+  _nextVersion() {
+    return Counter.getNextSequence(VERSION_COUNTER);
+  }
+
+  async _load(name) {
+    const { model, filter } = CATALOGS[name];
+    return model.find({ ...filter, isDeleted: { $ne: true } })
+      .select('-__v')
+      .sort({ _id: 1 })
+      .lean();
+  }
+
+  async _fingerprint(name) {
+    const { model, filter } = CATALOGS[name];
+    const [count, latest] = await Promise.all([
+      model.countDocuments(filter),
+      model.findOne(filter).sort({ updatedAt: -1 }).select('updatedAt').lean()
+    ]);
+    return `${count}:${latest?.updatedAt ? new Date(latest.updatedAt).getTime() : 0}`;
+  }
+
+  itemCount() {
+    let total = 0;
+    for (const state of this.catalogs.values()) total += state.items.size;
+    return total;
+  }
+
+  /**
+   * Full snapshot as a plain object
+   */
+  async getSnapshot() {
+    await this.ensureReady();
+    const catalogs = {};
+    for (const [name, state] of this.catalogs) {
+      catalogs[name] = Array.from(state.items.values(), item => item.doc);
+    }
+    return { version: this.version, builtAt: this.builtAt, full: true, catalogs };
+  }
+
+  /**
+   * Gzip-compressed JSON of the full snapshot, cached per version
+   * @returns {Object} { version, buffer }
+   */
+  async getCompressedSnapshot() {
+    await this.ensureReady();
+    if (this._bundleVersion !== this.version || !this._bundle) {
+      const version = this.version;
+      const snapshot = await this.getSnapshot();
+      const buffer = await new Promise((resolve, reject) => {
+        zlib.gzip(JSON.stringify(snapshot), { level: zlib.constants.Z_BEST_COMPRESSION }, (err, out) =>
+          (err ? reject(err) : resolve(out)));
+      });
+      this._bundle = buffer;
+      this._bundleVersion = version;
+    }
+    return { version: this._bundleVersion, buffer: this._bundle };
+  }
+
+  /**
+   * Changes since a client's version. Falls back to a full snapshot when the
+   * client is older than the journal or ahead of this server (e.g. DB restore).
+   */
+  async getDelta(since) {
+    await this.ensureReady();
+    const clientVersion = Number(since);
+
+    if (!Number.isFinite(clientVersion) || clientVersion > this.version) {
+      return this.getSnapshot();
+    }
+    if (clientVersion === this.version) {
+      return { version: this.version, full: false, changes: {} };
+    }
+
+    const merged = mergeJournal(this.journal, clientVersion, this.floorVersion);
+    if (!merged) return this.getSnapshot();
+
+    const changes = {};
+    for (const [name, { upserts, deletes }] of Object.entries(merged)) {
+      const items = this.catalogs.get(name).items;
+      changes[name] = {
+        upserts: [...upserts].map(id => items.get(id)?.doc).filter(Boolean),
+        deletes: [...deletes]
+      };
+    }
+
+    return { version: this.version, full: false, changes };
+  }
+
+  async getStatus() {
+    await this.ensureReady();
+    const counts = {};
+    for (const [name, state] of this.catalogs) counts[name] = state.items.size;
+    return {
+      version: this.version,
+      floorVersion: this.floorVersion,
+      builtAt: this.builtAt,
+      counts
+    };
+  }
+}
+
+const catalogSnapshotService = new CatalogSnapshotService();
+
+module.exports = catalogSnapshotService;
+module.exports.CatalogSnapshotService = CatalogSnapshotService;
+module.exports.CATALOG_NAMES = CATALOG_NAMES;
+module.exports._diffCatalog = diffCatalog;
+module.exports._mergeJournal = mergeJournal;
@@ -0,0 +1,425 @@
+/**
+ * Database Cost Tracer
+ *
+ * Attributes every driver command - including those issued from Mongoose
+ * hooks (counters, cascades, denormalized updates) - to the HTTP route or
+ * job that started the logical operation, through AsyncLocalStorage:
+ * - Commands, writes, documents returned/written and bytes sent/received
+ *   per request, aggregated per route pattern and job name
+ * - Breakdown by collection.command, so hook write amplification is visible
+ *   (one appointment save -> counters, patients, visits, prescriptions)
+ * - Budgets per route: requests over budget are logged with their breakdown
+ * - trace()/capture()/assertBudget() for tests asserting per-endpoint budgets
+ *
+ * Commands come from the driver's command monitoring events, so the client
+ * must be created with monitorCommands: true (server.js, tests/setup.js).
+ * Serializing commands and replies to measure bytes costs as much as the
+ * accounting itself, so bytes are only measured on a sample of requests and
+ * jobs (DB_COST_BYTES_SAMPLE_RATE) and always under trace().
+ * The server does not report documents examined per command; the tracer
+ * reports documents returned and written, which bound it for indexed reads
+ * (use /health/index-advice for unindexed shapes).
+ */
+
+const { AsyncLocalStorage } = require('async_hooks');
+const mongoose = require('mongoose');
+
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('DbCostTracer');
+
+// Handshake, auth and session housekeeping are not part of an operation's cost
+const IGNORED_COMMANDS = new Set([
+  'hello', 'ismaster', 'isMaster', 'ping', 'buildInfo', 'buildinfo', 'getLastError',
+  'saslStart', 'saslContinue', 'authenticate', 'endSessions', 'killCursors', 'getnonce'
+]);
+const WRITE_COMMANDS = new Set(['insert', 'update', 'delete', 'findAndModify']);
+
+// Routes/jobs kept in the report; further names are counted, not stored
+const MAX_NAMES = 500;
+// In-flight commands kept while waiting for their reply
+const MAX_PENDING = 10000;
+// Command keys kept per route (most frequent first in the report)
+const MAX_COMMAND_KEYS = 50;
+// Same route is reported over budget at most this often
+const BUDGET_WARNING_INTERVAL_MS = 5 * 60 * 1000;
+
+// ============================================
+// COMMAND ACCOUNTING (pure)
+// ============================================
+
+function newCost() {
+  return {
+    commands: 0,
+    writes: 0,
+    docsReturned: 0,
+    docsWritten: 0,
+    bytesOut: 0,
+    bytesIn: 0,
+    dbTimeMs: 0,
+    errors: 0,
+    byCommand: {}
+  };
+}
+
+function bsonSize(value) {
+  try {
+    return mongoose.mongo.BSON.calculateObjectSize(value);
+  } catch (error) {
+    return 0;
+  }
+}
+
+/**
+ * Collection.command key of a command (e.g. "patients.findAndModify")
+ */
+function commandKey(commandName, command) {
+  const target = command && command[commandName];
+  if (commandName === 'getMore') return `${command.collection || '?'}.getMore`;
+  return typeof target === 'string' ? `${target}.${commandName}` : commandName;
+}
+
+/**
+ * Documents returned and written according to a command reply
+ */
+function replyDocuments(commandName, reply = {}) {
+  const cursor = reply.cursor;
+  const returned = cursor
+    ? (cursor.firstBatch || cursor.nextBatch || []).length
+    : commandName === 'findAndModify'
+      ? (reply.value ? 1 : 0)
+      : Array.isArray(reply.values) ? reply.values.length : 0;
+
+  let written = 0;
+  if (commandName === 'insert' || commandName === 'delete') written = reply.n || 0;
+  if (commandName === 'update') written = (reply.nModified || 0) + (reply.upserted ? reply.upserted.length : 0);
+  if (commandName === 'findAndModify') written = reply.lastErrorObject?.n || 0;
+
+  return { returned, written };
+}
+
+/**
+ * Add one completed command to a cost record
+ */
+function addCommand(cost, { key, commandName, bytesOut = 0, bytesIn = 0, durationMs = 0, returned = 0, written = 0, failed = false }) {
+  cost.commands++;
+  if (WRITE_COMMANDS.has(commandName)) cost.writes++;
+  cost.docsReturned += returned;
+  cost.docsWritten += written;
+  cost.bytesOut += bytesOut;
+  cost.bytesIn += bytesIn;
+  cost.dbTimeMs += durationMs;
+  if (failed) cost.errors++;
+  cost.byCommand[key] = (cost.byCommand[key] || 0) + 1;
+}
+
+/**
+ * Budget violations of a cost record
+ * @param {Object} cost
+ * @param {Object} budget - { commands, writes, docsReturned, bytesIn } (any subset)
+ * @returns {Array} [{ metric, limit, actual }]
+ */
+function budgetViolations(cost, budget = {}) {
+  return Object.entries(budget)
+    .filter(([metric, limit]) => typeof limit === 'number' && cost[metric] > limit)
+    .map(([metric, limit]) => ({ metric, limit, actual: cost[metric] }));
+}
+
+function formatBreakdown(byCommand) {
+  return Object.entries(byCommand)
+    .sort((a, b) => b[1] - a[1])
+    .map(([key, count]) => `${key} x${count}`)
+    .join(', ');
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+class DbCostTracer {
+  constructor() {
+    this.storage = new AsyncLocalStorage();
+    this.pending = new Map(); // driver requestId -> in-flight command
+    this.routes = new Map(); // route/job name -> aggregate
+    this.budgets = new Map(); // route/job name -> budget
+    this.listeners = new Set();
+    this.lastWarned = new Map();
+    this.droppedNames = 0;
+    this.since = new Date();
+    this.attachedClients = new WeakSet();
+    this.enabled = process.env.DB_COST_TRACING !== 'false';
+    const sampleRate = parseFloat(process.env.DB_COST_BYTES_SAMPLE_RATE);
+    this.bytesSampleRate = Number.isFinite(sampleRate) ? Math.min(Math.max(sampleRate, 0), 1) : 0.1;
+    this.defaultBudget = {
+      commands: parseInt(process.env.DB_COST_MAX_COMMANDS) || 100,
+      writes: parseInt(process.env.DB_COST_MAX_WRITES) || 30
+    };
+  }
+
+  /**
+   * Listen to command monitoring events of a connection's client
+   */
+  attach(connection = mongoose.connection) {
+    if (!this.enabled) return;
+    const client = connection.getClient();
+    if (!client || this.attachedClients.has(client)) return;
+    if (!client.options?.monitorCommands && !client.monitorCommands) {
+      log.warn('MongoClient created without monitorCommands: database cost tracing disabled');
+      return;
+    }
+
+    client.on('commandStarted', event => this.onStarted(event));
+    client.on('commandSucceeded', event => this.onFinished(event, false));
+    client.on('commandFailed', event => this.onFinished(event, true));
+    this.attachedClients.add(client);
+  }
+
+  onStarted(event) {
+    if (!this.enabled) return;
+    const trace = this.storage.getStore();
+    if (!trace || IGNORED_COMMANDS.has(event.commandName)) return;
+
+    if (this.pending.size >= MAX_PENDING) {
+      this.pending.delete(this.pending.keys().next().value);
+    }
+    this.pending.set(event.requestId, {
+      trace,
+      commandName: event.commandName,
+      key: commandKey(event.commandName, event.command),
+      bytesOut: trace.measureBytes ? bsonSize(event.command) : 0,
+      measureBytes: trace.measureBytes
+    });
+  }
+
+  onFinished(event, failed) {
+    const started = this.pending.get(event.requestId);
+    if (!started) return;
+    this.pending.delete(event.requestId);
+
+    const { returned, written } = failed ? { returned: 0, written: 0 } : replyDocuments(started.commandName, event.reply);
+    const command = {
+      key: started.key,
+      commandName: started.commandName,
+      bytesOut: started.bytesOut,
+      bytesIn: failed || !started.measureBytes ? 0 : bsonSize(event.reply),
+      durationMs: event.duration || 0,
+      returned,
+      written,
+      failed
+    };
+
+    // Nested operations (a job step inside a job) also count for their parents
+    for (let trace = started.trace; trace; trace = trace.parent) {
+      addCommand(trace.cost, command);
+    }
+  }
+
+  // ============================================
+  // OPERATION CONTEXT
+  // ============================================
+
+  /**
+   * @param {boolean} [measureBytes] - Default: inherited from the parent, else sampled
+   */
+  newTrace(name, parent = null, measureBytes = parent ? parent.measureBytes : Math.random() < this.bytesSampleRate) {
+    return { name, parent, startedAt: Date.now(), measureBytes, cost: newCost() };
+  }
+
+  /**
+   * Express middleware: one trace per request, named after the matched route
+   */
+  middleware() {
+    return (req, res, next) => {
+      if (!this.enabled) return next();
+      const trace = this.newTrace(`${req.method} ${req.originalUrl.split('?')[0]}`);
+      res.once('finish', () => {
+        trace.name = req.route
+          ? `${req.method} ${req.baseUrl}${req.route.path}`
+          : `${req.method} (unmatched)`;
+        trace.status = res.statusCode;
+        this.finish(trace);
+      });
+      this.storage.run(trace, next);
+    };
+  }
+
+  /**
+   * Run a job (or any logical operation) under its own trace
+   * @returns {Promise<*>} fn's result
+   */
+  async run(name, fn) {
+    if (!this.enabled) return fn();
+    const trace = this.newTrace(name, this.storage.getStore() || null);
+    try {
+      return await this.storage.run(trace, fn);
+    } finally {
+      this.finish(trace);
+    }
+  }
+
+  /**
+   * Wrap a job function so each run is traced under a fixed name
+   */
+  wrapJob(name, fn) {
+    const tracer = this;
+    return function tracedJob(...args) {
+      return tracer.run(name, () => fn.apply(this, args));
+    };
+  }
+
+  /**
+   * Trace one operation and return its cost (tests, diagnostics)
+   * @returns {Promise<Object>} { result, cost }
+   */
+  async trace(name, fn) {
+    const trace = this.newTrace(name, null, true);
+    const result = await this.storage.run(trace, fn);
+    this.finish(trace);
+    return { result, cost: trace.cost };
+  }
+
+  /**
+   * Collect the traces finished while fn runs (e.g. requests made through
+   * supertest, which run in the server's own context)
+   * @returns {Promise<Object>} { result, traces }
+   */
+  async capture(fn) {
+    const traces = [];
+    const listener = trace => traces.push({ name: trace.name, status: trace.status, cost: trace.cost });
+    this.listeners.add(listener);
+    try {
+      const result = await fn();
+      return { result, traces };
+    } finally {
+      this.listeners.delete(listener);
+    }
+  }
+
+  current() {
+    return this.storage.getStore()?.cost || null;
+  }
+
+  // ============================================
+  // AGGREGATION & BUDGETS
+  // ============================================
+
+  setBudget(name, budget) {
+    this.budgets.set(name, budget);
+  }
+
+  /**
+   * Throw when a cost exceeds a budget, listing the command breakdown
+   */
+  assertBudget(cost, budget, name = 'operation') {
+    const violations = budgetViolations(cost, budget);
+    if (violations.length === 0) return;
+    const summary = violations.map(v => `${v.metric} ${v.actual} > ${v.limit}`).join(', ');
+    throw new Error(`${name} over database budget (${summary}): ${formatBreakdown(cost.byCommand)}`);
+  }
+
+  finish(trace) {
+    trace.durationMs = Date.now() - trace.startedAt;
+    for (const listener of this.listeners) listener(trace);
+    if (trace.cost.commands === 0) return;
+
+    this.record(trace);
+
+    const budget = this.budgets.get(trace.name) || this.defaultBudget;
+    const violations = budgetViolations(trace.cost, budget);
+    if (violations.length > 0) {
+      const lastWarned = this.lastWarned.get(trace.name) || 0;
+      if (Date.now() - lastWarned > BUDGET_WARNING_INTERVAL_MS) {
+        this.lastWarned.set(trace.name, Date.now());
+        log.warn('Operation over database budget', {
+          operation: trace.name,
+          violations,
+          breakdown: formatBreakdown(trace.cost.byCommand)
+        });
+      }
+    }
+  }
+
+  record(trace) {
+    let route = this.routes.get(trace.name);
+    if (!route) {
+      if (this.routes.size >= MAX_NAMES) {
+        this.droppedNames++;
+        return;
+      }
+      route = { count: 0, bytesMeasured: 0, total: newCost(), max: { commands: 0, writes: 0, bytesIn: 0 } };
+      this.routes.set(trace.name, route);
+    }
+
+    const { cost } = trace;
+    route.count++;
+    if (trace.measureBytes) route.bytesMeasured++;
+    for (const metric of ['commands', 'writes', 'docsReturned', 'docsWritten', 'bytesOut', 'bytesIn', 'dbTimeMs', 'errors']) {
+      route.total[metric] += cost[metric];
+    }
+    for (const metric of Object.keys(route.max)) {
+      route.max[metric] = Math.max(route.max[metric], cost[metric]);
+    }
+    for (const [key, count] of Object.entries(cost.byCommand)) {
+      if (route.total.byCommand[key] !== undefined || Object.keys(route.total.byCommand).length < MAX_COMMAND_KEYS) {
+        route.total.byCommand[key] = (route.total.byCommand[key] || 0) + count;
+      }
+    }
+  }
+
+  /**
+   * Per-route cost report, most expensive first
+   * @param {Object} options - { sort: metric averaged per operation, limit }
+   */
+  getReport({ sort = 'commands', limit = 50 } = {}) {
+    const per = (route, metric) => Math.round((route.total[metric] / route.count) * 10) / 10;
+    // Bytes are averaged over the sampled operations only
+    const perMeasured = (route, metric) => (route.bytesMeasured
+      ? Math.round((route.total[metric] / route.bytesMeasured) * 10) / 10
+      : null);
+    const operations = [...this.routes.entries()].map(([name, route]) => ({
+      name,
+      count: route.count,
+      perOperation: {
+        commands: per(route, 'commands'),
+        writes: per(route, 'writes'),
+        docsReturned: per(route, 'docsReturned'),
+        docsWritten: per(route, 'docsWritten'),
+        bytesOut: perMeasured(route, 'bytesOut'),
+        bytesIn: perMeasured(route, 'bytesIn'),
+        dbTimeMs: per(route, 'dbTimeMs')
+      },
+      max: route.max,
+      errors: route.total.errors,
+      commandsPerOperation: Object.fromEntries(
+        Object.entries(route.total.byCommand)
+          .sort((a, b) => b[1] - a[1])
+          .map(([key, count]) => [key, Math.round((count / route.count) * 10) / 10])
+      ),
+      budget: this.budgets.get(name) || this.defaultBudget
+    }));
+
+    operations.sort((a, b) => (b.perOperation[sort] || 0) - (a.perOperation[sort] || 0));
+
+    return {
+      since: this.since,
+      enabled: this.enabled,
+      bytesSampleRate: this.bytesSampleRate,
+      tracked: this.routes.size,
+      droppedNames: this.droppedNames,
+      operations: operations.slice(0, limit)
+    };
+  }
+
+  reset() {
+    this.routes.clear();
+    this.lastWarned.clear();
+    this.droppedNames = 0;
+    this.since = new Date();
+  }
+}
+
+module.exports = new DbCostTracer();
+module.exports.DbCostTracer = DbCostTracer;
+module.exports.commandKey = commandKey;
+module.exports.replyDocuments = replyDocuments;
+module.exports.budgetViolations = budgetViolations;
+module.exports.newCost = newCost;
@@ -0,0 +1,751 @@
+/**
+ * Device Export Format Compiler
+ *
+ * Turns a declarative export mapping (see ./formats) into an extractor.
+ * Source kinds:
+ * - csv: header aliases resolved to column indexes once per file
+ * - fixedWidth: column ranges sliced from each line
+ * - keyValue: "Key: value" reports, one record per file
+ * - lines: regex patterns with OD/OS sections (printer-style exports)
+ * - xml: single-pass tag scanner that keeps only mapped elements
+ *
+ * Record templates map output keys to typed fields:
+ *   sphere: { from: ['{eye} SPH', '{eye}_SPH'], type: 'number', unit: 'D' }
+ * A group with `laterality: true` expands to OD and OS, with {eye}, {side}
+ * and {initial} substituted in every alias.
+ *
+ * Each template is compiled to a record builder function. For CSV the
+ * builder is generated per header, so absent aliases cost nothing per row.
+ * Generated code only contains numeric slot/column indexes and
+ * JSON-quoted output keys from the mapping modules, never file content.
+ *
+ * Every extractor is incremental (feed chunks, then end) so bulk
+ * back-imports can stream files instead of materializing line arrays.
+ */
+
+const { StringDecoder } = require('string_decoder');
+
+// ============================================
+// CONSTANTS
+// ============================================
+
+const LATERALITY = {
+  OD: { eye: 'OD', side: 'Right', initial: 'R' },
+  OS: { eye: 'OS', side: 'Left', initial: 'L' }
+};
+
+// Conversion of a raw string held in `t`
+const CONVERSIONS = {
+  number: 'parseFloat(t)',
+  int: 'parseInt(t, 10)',
+  date: 'new Date(t)',
+  string: 't',
+  // Numeric when the whole value is numeric, otherwise the raw string
+  auto: '(isNaN(t) ? t : parseFloat(t))',
+  laterality: '(t.includes(\'R\') || t.includes(\'OD\') ? \'OD\' : \'OS\')'
+};
+
+// Value of a non-optional field with no source value, as parseFloat/new Date
+// of a missing cell would give
+const MISSING = {
+  number: 'NaN',
+  int: 'NaN',
+  date: 'new Date(NaN)'
+};
+
+const DEFAULT_RESULT = {
+  csv: 'each',
+  fixedWidth: 'each',
+  keyValue: 'single',
+  lines: 'single',
+  xml: 'single'
+};
+
+const HEADER_CACHE_SIZE = 32;
+const XML_NAME_CACHE_SIZE = 4096;
+
+const XML_ENTITIES = { amp: '&', lt: '<', gt: '>', quot: '"', apos: '\'' };
+
+// ============================================
+// RECORD TEMPLATE
+// ============================================
+
+function substitute(alias, eye) {
+  if (!eye) return alias;
+  return alias.replace(/\{(eye|side|initial)\}/g, (_, key) => LATERALITY[eye][key]);
+}
+
+/**
+ * Compile a record template into a node tree. Aliases become slot indexes
+ * shared by every field naming them; `slots` lists their source names.
+ */
+function compileTemplate(template, kind, name) {
+  const slots = [];
+  const slotIndex = new Map();
+
+  const slotFor = (alias) => {
+    const source = kind === 'xml' ? alias.toLowerCase() : alias;
+    if (!slotIndex.has(source)) {
+      slotIndex.set(source, slots.length);
+      slots.push(source);
+    }
+    return slotIndex.get(source);
+  };
+  const slotsFor = (aliases, eye) => [].concat(aliases || []).map(a => slotFor(substitute(a, eye)));
+
+  const compileNodes = (fields, eye, prefix) => {
+    const nodes = [];
+
+    for (const [key, def] of Object.entries(fields)) {
+      if (def.laterality) {
+        for (const side of Object.keys(LATERALITY)) {
+          nodes.push(compileGroup(side, def, side, prefix));
+        }
+      } else if (def.fields) {
+        nodes.push(compileGroup(key, def, eye, prefix));
+      } else if ('value' in def) {
+        nodes.push({ kind: 'const', key, value: def.value });
+      } else if (def.ref) {
+        nodes.push({ kind: 'ref', key, ref: def.ref });
+      } else {
+        const type = def.type || (def.items ? 'number' : 'string');
+        if (!CONVERSIONS[type]) {
+          throw new Error(`Unknown field type "${type}" for ${prefix}${key} in ${name}`);
+        }
+        nodes.push({
+          kind: def.items ? 'list' : 'field',
+          key,
+          path: prefix + key,
+          type,
+          unit: def.unit,
+          slots: def.items ? null : slotsFor(def.from, eye),
+          items: def.items ? def.items.map(aliases => slotsFor(aliases, eye)) : null,
+          lower: def.case === 'lower',
+          many: Boolean(def.many),
+          optional: Boolean(def.optional),
+          hasDefault: 'default' in def,
+          default: def.default,
+          defaultNow: Boolean(def.defaultNow),
+          flags: def.flags
+            ? Object.entries(def.flags).map(([alias, value]) => [slotFor(substitute(alias, eye)), value])
+            : null,
+          // Missing strings read as null from XML (as a failed tag lookup did)
+          missing: MISSING[type] || (kind === 'xml' && type === 'string' ? 'null' : null)
+        });
+      }
+    }
+
+    return nodes;
+  };
+
+  const compileGroup = (key, def, eye, prefix) => ({
+    kind: 'group',
+    key,
+    when: def.when ? slotsFor(def.when, eye) : null,
+    nodes: compileNodes(def.fields, eye, `${prefix}${key}.`)
+  });
+
+  return { nodes: compileNodes(template, null, ''), slots, slotIndex };
+}
+
+/**
+ * Generate the record builder for a node tree.
+ *
+ * @param {Array} nodes - Compiled template
+ * @param {Function} source - slot -> JS expression reading the raw value
+ *   (null when the slot can never have a value, e.g. column not in header)
+ * @returns {Function} build(c, lists, present) -> record
+ */
+function generateBuilder(nodes, source) {
+  const constants = [];
+  const constant = (value) => {
+    constants.push(value);
+    return `k[${constants.length - 1}]`;
+  };
+  const code = [];
+  let groups = 0;
+
+  const hasValue = expr => `((x = ${expr}) !== undefined && x !== '')`;
+
+  // Sets t to the first non-empty alias value, or undefined
+  const pick = (slots) => {
+    const reads = slots.map(source).filter(Boolean);
+    if (!reads.length) return 't = undefined;';
+    return `t = undefined; ${reads.map(r => `if (${hasValue(r)}) t = x;`).join(' else ')}`;
+  };
+
+  const convert = node => (node.lower ? `${CONVERSIONS[node.type]}.toLowerCase()` : CONVERSIONS[node.type]);
+
+  const emit = (list, target) => {
+    for (const node of list) {
+      const key = JSON.stringify(node.key);
+
+      if (node.kind === 'const') {
+        code.push(`${target}[${key}] = ${constant(node.value)};`);
+      } else if (node.kind === 'ref') {
+        code.push(`${target}[${key}] = o[${JSON.stringify(node.ref)}];`);
+      } else if (node.kind === 'group') {
+        let condition = 'true';
+        if (node.when) {
+          const reads = node.when.map(source).filter(Boolean);
+          if (!reads.length) continue;
+          condition = reads.map(hasValue).join(' || ');
+        }
+        const group = `g${groups++}`;
+        code.push(`if (${condition}) {`, `const ${group} = {};`);
+        emit(node.nodes, group);
+        code.push(`${target}[${key}] = ${group};`, '}');
+      } else if (node.kind === 'list') {
+        code.push('l = [];');
+        for (const item of node.items) {
+          code.push(pick(item), `if (t !== undefined) l.push(${convert(node)});`);
+        }
+        code.push(`if (l.length) ${target}[${key}] = l;`);
+      } else if (node.many) {
+        code.push(`${target}[${key}] = many(ls, ${JSON.stringify(node.slots)}, t => ${convert(node)});`);
+      } else {
+        code.push(pick(node.slots), `if (t !== undefined) ${target}[${key}] = ${convert(node)};`);
+        for (const [slot, flagged] of node.flags || []) {
+          const read = source(slot);
+          const test = [read && hasValue(read), `(p !== undefined && p[${slot}] === true)`].filter(Boolean).join(' || ');
+          code.push(`else if (${test}) ${target}[${key}] = ${constant(flagged)};`);
+        }
+        if (node.hasDefault) {
+          const fallback = node.lower ? String(node.default).toLowerCase() : node.default;
+          code.push(`else ${target}[${key}] = ${constant(fallback)};`);
+        } else if (node.defaultNow) {
+          code.push(`else ${target}[${key}] = new Date().toISOString();`);
+        } else if (!node.optional && node.missing) {
+          code.push(`else ${target}[${key}] = ${node.missing};`);
+        }
+      }
+    }
+  };
+
+  emit(nodes, 'o');
+
+  const body = `return function build(c, ls, p) {\nlet t, x, l;\nconst o = {};\n${code.join('\n')}\nreturn o;\n};`;
+  // eslint-disable-next-line no-new-func
+  return new Function('k', 'many', body)(constants, many);
+}
+
+function many(lists, slots, convert) {
+  for (const slot of slots) {
+    const list = lists[slot];
+    if (list && list.length) return list.map(convert);
+  }
+  return null;
+}
+
+function describeNodes(nodes, out = []) {
+  for (const node of nodes) {
+    if (node.kind === 'group') {
+      describeNodes(node.nodes, out);
+    } else if (node.kind === 'field' || node.kind === 'list') {
+      out.push({ path: node.path, type: node.type, unit: node.unit || null, list: node.kind === 'list' || node.many });
+    }
+  }
+  return out;
+}
+
+// ============================================
+// SOURCE READERS
+// ============================================
+
+function lineSplitter(onLine) {
+  let rest = '';
+  return {
+    feed(chunk) {
+      const text = rest + chunk;
+      let start = 0;
+      let nl;
+      while ((nl = text.indexOf('\n', start)) !== -1) {
+        onLine(text.charCodeAt(nl - 1) === 13 ? text.slice(start, nl - 1) : text.slice(start, nl));
+        start = nl + 1;
+      }
+      rest = text.slice(start);
+    },
+    end() {
+      if (rest) onLine(rest);
+      rest = '';
+    }
+  };
+}
+
+function splitCsvLine(line, delimiter) {
+  if (line.indexOf('"') === -1) {
+    const cells = line.split(delimiter);
+    for (let i = 0; i < cells.length; i++) cells[i] = cells[i].trim();
+    return cells;
+  }
+
+  const cells = [];
+  let cell = '';
+  let quoted = false;
+  for (let i = 0; i < line.length; i++) {
+    const ch = line[i];
+    if (quoted) {
+      if (ch === '"' && line[i + 1] === '"') {
+        cell += '"';
+        i++;
+      } else if (ch === '"') {
+        quoted = false;
+      } else {
+        cell += ch;
+      }
+    } else if (ch === '"') {
+      quoted = true;
+    } else if (ch === delimiter) {
+      cells.push(cell.trim());
+      cell = '';
+    } else {
+      cell += ch;
+    }
+  }
+  cells.push(cell.trim());
+  return cells;
+}
+
+/*
+ * Readers are prepared once per mapping (regexes, lookups, bindings) and
+ * return a factory of per-file parsers: emit => { feed(chunk), end() }.
+ */
+
+function csvReader(spec, compiled) {
+  const delimiter = spec.delimiter || ',';
+
+  return (emit) => {
+    let build = null;
+    const lines = lineSplitter((line) => {
+      if (!line.trim()) return;
+      const cells = splitCsvLine(line, delimiter);
+      if (build) {
+        emit(build(cells));
+      } else {
+        build = compiled.forHeader(cells);
+      }
+    });
+
+    return {
+      feed: lines.feed,
+      end() {
+        lines.end();
+        if (!build) throw new Error('CSV parse error: Empty CSV file');
+      }
+    };
+  };
+}
+
+function fixedWidthReader(spec, compiled) {
+  const skip = spec.skipLines || 0;
+  const ranges = compiled.slots.map(name => spec.columns[name] || null);
+
+  return (emit) => {
+    let seen = 0;
+    return lineSplitter((line) => {
+      if (seen++ < skip || !line.trim()) return;
+      const values = new Array(ranges.length);
+      for (let s = 0; s < ranges.length; s++) {
+        const range = ranges[s];
+        if (range) values[s] = line.slice(range[0], range[1]).trim();
+      }
+      emit(compiled.build(values));
+    });
+  };
+}
+
+function keyValueReader(spec, compiled) {
+  const separators = spec.separators || [':'];
+  const comments = spec.comments || [];
+  const lookup = {
+    exact: key => compiled.slotIndex.get(key),
+    snake: key => compiled.slotIndex.get(key.toLowerCase().replace(/\s+/g, '_')),
+    // First alias (in template order) contained in the key
+    contains: (key) => {
+      const slot = compiled.slots.findIndex(alias => key.includes(alias));
+      return slot === -1 ? undefined : slot;
+    }
+  }[spec.keyMatch || 'exact'];
+
+  return (emit) => {
+    const values = new Array(compiled.slots.length);
+    const extra = {};
+
+    const lines = lineSplitter((line) => {
+      const trimmed = line.trim();
+      if (!trimmed || comments.some(c => trimmed.startsWith(c))) return;
+
+      const separator = separators.find(s => trimmed.includes(s));
+      if (!separator) return;
+
+      const at = trimmed.indexOf(separator);
+      const key = trimmed.slice(0, at).trim();
+      const value = trimmed.slice(at + separator.length).trim();
+      if (!key || !value) return;
+
+      const slot = lookup(key);
+      if (slot !== undefined) {
+        values[slot] = value;
+      } else if (spec.passthrough) {
+        extra[key.toLowerCase().replace(/\s+/g, '')] = isNaN(value) ? value : parseFloat(value);
+      }
+    });
+
+    return {
+      feed: lines.feed,
+      end() {
+        lines.end();
+        const record = compiled.build(values);
+        for (const [key, value] of Object.entries(extra)) {
+          if (!(key in record)) record[key] = value;
+        }
+        emit(record);
+      }
+    };
+  };
+}
+
+function patternReader(spec, compiled) {
+  const sections = Object.entries(spec.sections || {});
+  const patterns = spec.patterns.map(p => ({
+    match: new RegExp(p.match.source, p.match.flags.replace('g', '')),
+    slot: p.perEye ? undefined : compiled.slotIndex.get(p.name),
+    eyeSlots: p.perEye
+      ? Object.fromEntries(sections.map(([eye]) => [eye, compiled.slotIndex.get(`${eye} ${p.name}`)]))
+      : null
+  })).filter(p => p.slot !== undefined || p.eyeSlots);
+
+  return (emit) => {
+    const values = new Array(compiled.slots.length);
+    let eye = null;
+
+    const lines = lineSplitter((line) => {
+      const trimmed = line.trim();
+      if (!trimmed) return;
+
+      for (const [side, tokens] of sections) {
+        if (tokens.some(t => trimmed.includes(t))) {
+          eye = side;
+          break;
+        }
+      }
+
+      for (const pattern of patterns) {
+        const slot = pattern.eyeSlots ? (eye ? pattern.eyeSlots[eye] : undefined) : pattern.slot;
+        if (slot === undefined) continue;
+        const m = pattern.match.exec(trimmed);
+        if (m) values[slot] = m[1];
+      }
+    });
+
+    return {
+      feed: lines.feed,
+      end() {
+        lines.end();
+        emit(compiled.build(values));
+      }
+    };
+  };
+}
+
+function decodeXmlText(text) {
+  if (text.indexOf('&') === -1) return text;
+  return text.replace(/&(#x[0-9a-f]+|#\d+|[a-z]+);/gi, (entity, code) => {
+    if (code[0] === '#') {
+      const n = code[1] === 'x' || code[1] === 'X' ? parseInt(code.slice(2), 16) : parseInt(code.slice(1), 10);
+      return String.fromCodePoint(n);
+    }
+    return XML_ENTITIES[code.toLowerCase()] ?? entity;
+  });
+}
+
+const isNameEnd = ch => ch === 32 || ch === 62 || ch === 47 || ch === 9 || ch === 10 || ch === 13;
+
+/**
+ * XML extractor: a streaming tag scanner. Aliases are element (or attribute)
+ * names matched at any depth, or slash paths matched against the end of the
+ * element stack ('Patient/ID'). Only leaf text of mapped elements is kept.
+ */
+function xmlReader(spec, compiled) {
+  const slotCount = compiled.slots.length;
+
+  // local name -> [{ slot, path }]
+  const bindings = new Map();
+  compiled.slots.forEach((alias, slot) => {
+    const path = alias.split('/');
+    const leaf = path[path.length - 1];
+    if (!bindings.has(leaf)) bindings.set(leaf, []);
+    bindings.get(leaf).push({ slot, path: path.length > 1 ? path : null });
+  });
+
+  // raw tag name -> lowercased local name, shared by every file
+  const names = new Map();
+  const localName = (raw) => {
+    let name = names.get(raw);
+    if (name === undefined) {
+      const colon = raw.indexOf(':');
+      name = (colon === -1 ? raw : raw.slice(colon + 1)).toLowerCase();
+      if (names.size >= XML_NAME_CACHE_SIZE) names.clear();
+      names.set(raw, name);
+    }
+    return name;
+  };
+
+  const ATTRIBUTE = /([\w:.-]+)\s*=\s*(?:"([^"]*)"|'([^']*)')/g;
+
+  return (emit) => {
+    const values = new Array(slotCount);
+    const lists = new Array(slotCount);
+    const present = new Array(slotCount);
+
+    // Element stack as parallel arrays; text of a mapped leaf is kept as an
+    // offset into buf (textStart) plus whatever earlier chunks held (textHead)
+    const stackName = [];
+    const stackBinds = [];
+    const hasChild = [];
+    const textStart = [];
+    const textHead = [];
+    let depth = 0;
+    let buf = '';
+
+    const matchesPath = (path, at) => {
+      if (path.length > at + 1) return false;
+      for (let i = 0; i < path.length; i++) {
+        if (stackName[at - i] !== path[path.length - 1 - i]) return false;
+      }
+      return true;
+    };
+
+    const record = (binds, text, at) => {
+      for (const { slot, path } of binds) {
+        if (path && !matchesPath(path, at)) continue;
+        present[slot] = true;
+        if (!text) continue;
+        if (lists[slot] === undefined) lists[slot] = [];
+        lists[slot].push(text);
+        if (values[slot] === undefined) values[slot] = text;
+      }
+    };
+
+    // Move pending leaf text before `to` out of buf (comments, CDATA, chunk ends)
+    const flushText = (to, resumeAt) => {
+      const top = depth - 1;
+      if (top >= 0 && stackBinds[top] && !hasChild[top]) {
+        textHead[top] += buf.slice(textStart[top], to);
+        textStart[top] = resumeAt;
+      }
+    };
+
+    const open = (name, lt, nameEnd, gt) => {
+      if (depth > 0) hasChild[depth - 1] = true;
+      const binds = bindings.get(name);
+      stackName[depth] = name;
+      stackBinds[depth] = binds;
+      hasChild[depth] = false;
+      textStart[depth] = gt + 1;
+      textHead[depth] = '';
+      depth++;
+
+      const attributes = gt - nameEnd > 1 ? buf.slice(nameEnd, gt) : '';
+      if (attributes.indexOf('=') !== -1) {
+        ATTRIBUTE.lastIndex = 0;
+        let m;
+        while ((m = ATTRIBUTE.exec(attributes)) !== null) {
+          const attributeBinds = bindings.get(localName(m[1]));
+          if (attributeBinds) record(attributeBinds, decodeXmlText((m[2] ?? m[3]).trim()), depth - 1);
+        }
+      }
+
+      if (buf.charCodeAt(gt - 1) === 47 /* / */) close(name, gt);
+    };
+
+    const close = (name, lt) => {
+      // Tolerate unbalanced markup by unwinding to the matching element
+      let at = depth - 1;
+      while (at >= 0 && stackName[at] !== name) at--;
+      if (at < 0) return;
+
+      const binds = stackBinds[at];
+      if (binds) {
+        const text = hasChild[at] || at !== depth - 1
+          ? ''
+          : decodeXmlText((textHead[at] + buf.slice(textStart[at], lt)).trim());
+        record(binds, text, at);
+      }
+      depth = at;
+    };
+
+    const scan = () => {
+      let pos = 0;
+      for (;;) {
+        const lt = buf.indexOf('<', pos);
+        if (lt === -1) break;
+        const next = buf.charCodeAt(lt + 1);
+
+        if (next === 33 /* ! */ || next === 63 /* ? */) {
+          let end;
+          if (buf.startsWith('<!--', lt)) {
+            end = buf.indexOf('-->', lt + 4);
+            if (end === -1) break;
+            flushText(lt, end + 3);
+            pos = end + 3;
+          } else if (buf.startsWith('<![CDATA[', lt)) {
+            end = buf.indexOf(']]>', lt + 9);
+            if (end === -1) break;
+            flushText(lt, end + 3);
+            const top = depth - 1;
+            if (top >= 0 && stackBinds[top] && !hasChild[top]) textHead[top] += buf.slice(lt + 9, end);
+            pos = end + 3;
+          } else {
+            end = buf.indexOf('>', lt);
+            if (end === -1) break;
+            pos = end + 1;
+          }
+          continue;
+        }
+
+        const gt = buf.indexOf('>', lt);
+        if (gt === -1) break;
+
+        if (next === 47 /* / */) {
+          close(localName(buf.slice(lt + 2, gt).trim()), lt);
+        } else {
+          let nameEnd = lt + 1;
+          while (nameEnd < gt && !isNameEnd(buf.charCodeAt(nameEnd))) nameEnd++;
+          if (nameEnd > lt + 1) open(localName(buf.slice(lt + 1, nameEnd)), lt, nameEnd, gt);
+        }
+        pos = gt + 1;
+      }
+
+      if (pos > 0) {
+        // Keep leaf text started in this chunk before dropping consumed input
+        for (let at = 0; at < depth; at++) {
+          if (stackBinds[at] && !hasChild[at]) {
+            textHead[at] += buf.slice(textStart[at], pos);
+            textStart[at] = 0;
+          }
+        }
+        buf = buf.slice(pos);
+      }
+    };
+
+    return {
+      feed(chunk) {
+        buf += chunk;
+        scan();
+      },
+      end() {
+        scan();
+        emit(compiled.build(values, lists, present));
+      }
+    };
+  };
+}
+
+const READERS = {
+  csv: csvReader,
+  fixedWidth: fixedWidthReader,
+  keyValue: keyValueReader,
+  lines: patternReader,
+  xml: xmlReader
+};
+
+// ============================================
+// COMPILER
+// ============================================
+
+/**
+ * Compile one file mapping.
+ *
+ * @param {Object} spec - { kind, record, result?, ...kind options }
+ * @param {String} [name] - Used in error messages
+ * @returns {Object} extractor with parse, parseStream, records and fields
+ */
+function compileFormat(spec, name = 'format') {
+  const reader = READERS[spec.kind];
+  if (!reader) {
+    throw new Error(`Unknown export kind "${spec.kind}" in ${name}`);
+  }
+  if (!spec.record) {
+    throw new Error(`Export mapping ${name} has no record template`);
+  }
+
+  const { nodes, slots, slotIndex } = compileTemplate(spec.record, spec.kind, name);
+  const result = spec.result || DEFAULT_RESULT[spec.kind];
+
+  const compiled = { slots, slotIndex };
+  if (spec.kind === 'csv') {
+    // One builder per distinct header; later duplicate headers win
+    const byHeader = new Map();
+    compiled.forHeader = (header) => {
+      const key = header.join('\u0000');
+      let build = byHeader.get(key);
+      if (!build) {
+        const columns = slots.map(alias => header.lastIndexOf(alias));
+        build = generateBuilder(nodes, slot => (columns[slot] === -1 ? null : `c[${columns[slot]}]`));
+        if (byHeader.size >= HEADER_CACHE_SIZE) byHeader.clear();
+        byHeader.set(key, build);
+      }
+      return build;
+    };
+  } else {
+    compiled.build = generateBuilder(nodes, slot => `c[${slot}]`);
+  }
+
+  const createParser = reader(spec, compiled);
+
+  const shape = (records) => {
+    if (result === 'each') return records;
+    if (result === 'wrapped') return records.slice(0, 1);
+    return records[0];
+  };
+
+  return {
+    name,
+    kind: spec.kind,
+    fields: describeNodes(nodes),
+
+    /**
+     * Parse a whole export held in memory
+     */
+    parse(content) {
+      const records = [];
+      const parser = createParser(r => records.push(r));
+      parser.feed(Buffer.isBuffer(content) ? content.toString('utf-8') : String(content));
+      parser.end();
+      return shape(records);
+    },
+
+    /**
+     * Iterate records from a readable stream without buffering the file
+     */
+    async * records(readable) {
+      const decoder = new StringDecoder('utf8');
+      const pending = [];
+      const parser = createParser(r => pending.push(r));
+
+      for await (const chunk of readable) {
+        parser.feed(typeof chunk === 'string' ? chunk : decoder.write(chunk));
+        yield * pending.splice(0);
+      }
+      parser.feed(decoder.end());
+      parser.end();
+      yield * pending.splice(0);
+    },
+
+    /**
+     * Parse a readable stream into the same result as parse()
+     */
+    async parseStream(readable) {
+      const records = [];
+      for await (const record of this.records(readable)) records.push(record);
+      return shape(records);
+    }
+  };
+}
+
+module.exports = {
+  compileFormat,
+  splitCsvLine,
+  LATERALITY
+};
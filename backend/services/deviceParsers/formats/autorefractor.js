@@ -0,0 +1,62 @@
+/**
+ * Auto-refractor / keratometer exports (generic column and printout layouts)
+ */
+
+const eyeColumns = name => [`{eye} ${name}`, `{eye}_${name}`, `${name}_{eye}`];
+
+module.exports = {
+  id: 'autorefractor',
+  description: 'Auto-refractor / keratometer',
+  files: {
+    csv: {
+      kind: 'csv',
+      record: {
+        measurementDate: { from: ['Date', 'date', 'Timestamp'], type: 'date' },
+        source: { value: 'folder-sync' },
+        '{eye}': {
+          laterality: true,
+          when: ['{eye} SPH', '{eye}_SPH'],
+          fields: {
+            sphere: { from: eyeColumns('SPH'), type: 'number', unit: 'D' },
+            cylinder: { from: eyeColumns('CYL'), type: 'number', unit: 'D', default: 0 },
+            axis: { from: eyeColumns('AXIS'), type: 'int', unit: 'deg', default: 0 },
+            pupilSize: { from: eyeColumns('PD'), type: 'number', unit: 'mm' },
+            confidence: { from: ['{eye} CONF', '{eye}_Confidence'], type: 'number', unit: '%', default: 100 },
+            k1: { from: ['{eye} K1', '{eye}_K1'], type: 'number', unit: 'D' },
+            k2: { from: ['{eye} K2', '{eye}_K2'], type: 'number', unit: 'D' },
+            k1Axis: { from: ['{eye} K1 AXIS', '{eye}_K1_Axis'], type: 'int', unit: 'deg' },
+            k2Axis: { from: ['{eye} K2 AXIS', '{eye}_K2_Axis'], type: 'int', unit: 'deg' }
+          }
+        }
+      }
+    },
+
+    txt: {
+      kind: 'lines',
+      result: 'wrapped',
+      sections: { OD: ['OD', 'Right'], OS: ['OS', 'Left'] },
+      patterns: [
+        { name: 'SPH', match: /SPH[:\s]+(-?\d+\.?\d*)/i, perEye: true },
+        { name: 'CYL', match: /CYL[:\s]+(-?\d+\.?\d*)/i, perEye: true },
+        { name: 'AXIS', match: /AXIS[:\s]+(\d+)/i, perEye: true },
+        { name: 'K1', match: /K1[:\s]+(\d+\.?\d*)/i, perEye: true },
+        { name: 'K2', match: /K2[:\s]+(\d+\.?\d*)/i, perEye: true },
+        { name: 'Date', match: /Date[:\s]+(\d{4}-\d{2}-\d{2}|\d{2}\/\d{2}\/\d{4})/i }
+      ],
+      record: {
+        source: { value: 'folder-sync' },
+        '{eye}': {
+          laterality: true,
+          fields: {
+            sphere: { from: ['{eye} SPH'], type: 'number', unit: 'D', optional: true },
+            cylinder: { from: ['{eye} CYL'], type: 'number', unit: 'D', optional: true },
+            axis: { from: ['{eye} AXIS'], type: 'int', unit: 'deg', optional: true },
+            k1: { from: ['{eye} K1'], type: 'number', unit: 'D', optional: true },
+            k2: { from: ['{eye} K2'], type: 'number', unit: 'D', optional: true }
+          }
+        },
+        measurementDate: { from: ['Date'], type: 'date', optional: true }
+      }
+    }
+  }
+};
@@ -0,0 +1,42 @@
+/**
+ * Optical biometer exports (IOLMaster, Lenstar)
+ */
+
+module.exports = {
+  id: 'biometer',
+  description: 'Optical biometer',
+  files: {
+    csv: {
+      kind: 'csv',
+      record: {
+        eye: { from: ['Eye', 'eye', 'EYE'], flags: { OD: 'OD' }, default: 'OS' },
+        capturedAt: { from: ['Date', 'date', 'ExamDate'], type: 'date' },
+        axialLength: { from: ['AL', 'AxialLength', 'Axial Length'], type: 'number', unit: 'mm' },
+        k1: { from: ['K1', 'K1(D)', 'FlatK'], type: 'number', unit: 'D' },
+        k2: { from: ['K2', 'K2(D)', 'SteepK'], type: 'number', unit: 'D' },
+        axis1: { from: ['Axis1', 'K1Axis'], type: 'number', unit: 'deg' },
+        axis2: { from: ['Axis2', 'K2Axis'], type: 'number', unit: 'deg' },
+        acd: { from: ['ACD', 'ACD(mm)', 'AnteriorChamber'], type: 'number', unit: 'mm' },
+        lensThickness: { from: ['LT', 'LensThickness', 'Lens(mm)'], type: 'number', unit: 'mm' },
+        wtw: { from: ['WTW', 'WhiteToWhite', 'WTW(mm)'], type: 'number', unit: 'mm' },
+        pupilSize: { from: ['Pupil', 'PupilSize'], type: 'number', unit: 'mm' },
+        snr: { from: ['SNR', 'SignalRatio'], type: 'number' },
+        iolPower: { from: ['IOL', 'IOLPower'], type: 'number', unit: 'D' }
+      }
+    },
+
+    xml: {
+      kind: 'xml',
+      record: {
+        eye: { from: ['Eye', 'Laterality'] },
+        axialLength: { from: ['AxialLength', 'AL'], type: 'number', unit: 'mm' },
+        k1: { from: ['K1', 'FlatK'], type: 'number', unit: 'D' },
+        k2: { from: ['K2', 'SteepK'], type: 'number', unit: 'D' },
+        acd: { from: ['ACD', 'AnteriorChamberDepth'], type: 'number', unit: 'mm' },
+        lensThickness: { from: ['LensThickness', 'LT'], type: 'number', unit: 'mm' },
+        wtw: { from: ['WTW', 'WhiteToWhite'], type: 'number', unit: 'mm' },
+        capturedAt: { from: ['ExamDate', 'Date'] }
+      }
+    }
+  }
+};
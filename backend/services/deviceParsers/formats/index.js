@@ -0,0 +1,21 @@
+/**
+ * Device export formats
+ *
+ * One module per device model (or per device family for the generic
+ * adapters). Supporting a new model means adding a mapping here; models
+ * listed first win when several `devices` rules match.
+ */
+
+module.exports = [
+  require('./nidekArk'),
+  require('./nidekAlScan'),
+  require('./nidekNt'),
+  require('./nidekCem'),
+  require('./nidek'),
+  require('./autorefractor'),
+  require('./tonometer'),
+  require('./specularMicroscope'),
+  require('./visualField'),
+  require('./biometer'),
+  require('./oct')
+];
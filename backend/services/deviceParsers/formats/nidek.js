@@ -0,0 +1,65 @@
+/**
+ * NIDEK exports - fields shared by every model, and the generic mapping used
+ * for models without their own file (OPD-Scan, RS-3000)
+ */
+
+const csvRecord = {
+  eye: { from: ['Eye', 'eye', 'EYE'] },
+  capturedAt: { from: ['Date', 'date', 'ExamDate'], type: 'date' }
+};
+
+const xmlRecord = {
+  patientName: { from: ['Patient/Name', 'Patient/PatientName'], optional: true },
+  patientId: { from: ['Patient/ID', 'Patient/PatientID'], optional: true },
+  dateOfBirth: { from: ['Patient/DOB', 'Patient/BirthDate'], optional: true },
+  eye: {
+    from: ['Eye', 'Laterality'],
+    flags: { OD: 'OD', Right: 'OD', OS: 'OS', Left: 'OS', OU: 'OU', Both: 'OU' },
+    default: 'OD'
+  },
+  capturedAt: { from: ['Date', 'ExamDate', 'DateTime'], type: 'date', optional: true }
+};
+
+// Proprietary "KEY=value" / "Key: value" text; unmapped keys are kept compacted
+const txt = {
+  kind: 'keyValue',
+  separators: [':', '=', '\t'],
+  comments: ['#', ';'],
+  passthrough: true,
+  record: {
+    sphere: { from: ['Sphere', 'SPH', 'S'], type: 'auto', unit: 'D', optional: true },
+    cylinder: { from: ['Cylinder', 'CYL', 'C'], type: 'auto', unit: 'D', optional: true },
+    axis: { from: ['Axis', 'AX', 'A'], type: 'auto', unit: 'deg', optional: true },
+    k1: { from: ['K1', 'Flat K', 'FlatK'], type: 'auto', unit: 'D', optional: true },
+    k2: { from: ['K2', 'Steep K', 'SteepK'], type: 'auto', unit: 'D', optional: true },
+    axialLength: { from: ['Axial Length', 'AL'], type: 'auto', unit: 'mm', optional: true },
+    acd: { from: ['ACD', 'Anterior Chamber'], type: 'auto', unit: 'mm', optional: true },
+    iop: { from: ['IOP', 'Pressure'], type: 'auto', unit: 'mmHg', optional: true },
+    ecd: { from: ['ECD', 'Cell Density'], type: 'auto', unit: 'cells/mm²', optional: true },
+    eye: { from: ['Eye', 'Laterality'], type: 'auto', optional: true },
+    capturedAt: { from: ['Date', 'Exam Date'], type: 'auto', optional: true }
+  }
+};
+
+/**
+ * Build a NIDEK model mapping from its CSV and XML measurement fields
+ */
+function nidekModel({ id, description, devices, csv = {}, xml = {} }) {
+  return {
+    id,
+    description,
+    devices,
+    files: {
+      csv: { kind: 'csv', record: { ...csvRecord, ...csv } },
+      xml: { kind: 'xml', record: { ...xmlRecord, ...xml } },
+      txt
+    }
+  };
+}
+
+module.exports = nidekModel({
+  id: 'nidek',
+  description: 'NIDEK (generic)',
+  devices: [{ manufacturer: /nidek/i }]
+});
+module.exports.nidekModel = nidekModel;
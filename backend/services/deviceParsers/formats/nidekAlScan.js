@@ -0,0 +1,27 @@
+/**
+ * NIDEK AL-Scan optical biometer
+ */
+
+const { nidekModel } = require('./nidek');
+
+module.exports = nidekModel({
+  id: 'nidek-alscan',
+  description: 'NIDEK AL-Scan biometer',
+  devices: [{ manufacturer: /nidek/i, model: /al-scan|biometer/i }],
+  csv: {
+    axialLength: { from: ['AL', 'AxialLength'], type: 'number', unit: 'mm' },
+    k1: { from: ['K1'], type: 'number', unit: 'D' },
+    k2: { from: ['K2'], type: 'number', unit: 'D' },
+    acd: { from: ['ACD'], type: 'number', unit: 'mm' },
+    lensThickness: { from: ['LT'], type: 'number', unit: 'mm' },
+    wtw: { from: ['WTW'], type: 'number', unit: 'mm' }
+  },
+  xml: {
+    axialLength: { from: ['AxialLength', 'AL'], type: 'number', unit: 'mm' },
+    k1: { from: ['K1', 'FlatK'], type: 'number', unit: 'D' },
+    k2: { from: ['K2', 'SteepK'], type: 'number', unit: 'D' },
+    acd: { from: ['ACD', 'AnteriorChamber'], type: 'number', unit: 'mm' },
+    lensThickness: { from: ['LT', 'LensThickness'], type: 'number', unit: 'mm' },
+    wtw: { from: ['WTW', 'WhiteToWhite'], type: 'number', unit: 'mm' }
+  }
+});
@@ -0,0 +1,29 @@
+/**
+ * NIDEK ARK series auto refractor / keratometer
+ */
+
+const { nidekModel } = require('./nidek');
+
+module.exports = nidekModel({
+  id: 'nidek-ark',
+  description: 'NIDEK ARK auto ref/keratometer',
+  devices: [{ manufacturer: /nidek/i, model: /ark|ref/i }],
+  csv: {
+    sphere: { from: ['SPH', 'Sphere', 'S'], type: 'number', unit: 'D' },
+    cylinder: { from: ['CYL', 'Cylinder', 'C'], type: 'number', unit: 'D' },
+    axis: { from: ['AX', 'Axis', 'A'], type: 'number', unit: 'deg' },
+    k1: { from: ['K1', 'FlatK'], type: 'number', unit: 'D' },
+    k2: { from: ['K2', 'SteepK'], type: 'number', unit: 'D' }
+  },
+  xml: {
+    sphere: { from: ['Sphere', 'SPH', 'S'], type: 'number', unit: 'D' },
+    cylinder: { from: ['Cylinder', 'CYL', 'C'], type: 'number', unit: 'D' },
+    axis: { from: ['Axis', 'AX', 'A'], type: 'number', unit: 'deg' },
+    va: { from: ['VA', 'VisualAcuity'], optional: true },
+    pupilSize: { from: ['PupilSize', 'Pupil', 'PD'], type: 'number', unit: 'mm' },
+    k1: { from: ['K1', 'FlatK'], type: 'number', unit: 'D' },
+    k2: { from: ['K2', 'SteepK'], type: 'number', unit: 'D' },
+    k1Axis: { from: ['K1Axis', 'FlatAxis'], type: 'number', unit: 'deg' },
+    k2Axis: { from: ['K2Axis', 'SteepAxis'], type: 'number', unit: 'deg' }
+  }
+});
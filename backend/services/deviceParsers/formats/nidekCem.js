@@ -0,0 +1,20 @@
+/**
+ * NIDEK CEM-530 specular microscope
+ */
+
+const { nidekModel } = require('./nidek');
+
+const endothelium = {
+  ecd: { from: ['ECD', 'CD'], type: 'number', unit: 'cells/mm²' },
+  cv: { from: ['CV'], type: 'number', unit: '%' },
+  hexagonality: { from: ['HEX'], type: 'number', unit: '%' },
+  cct: { from: ['CCT'], type: 'number', unit: 'µm' }
+};
+
+module.exports = nidekModel({
+  id: 'nidek-cem',
+  description: 'NIDEK CEM specular microscope',
+  devices: [{ manufacturer: /nidek/i, model: /cem|specular/i }],
+  csv: endothelium,
+  xml: endothelium
+});
@@ -0,0 +1,18 @@
+/**
+ * NIDEK NT series non-contact tonometer
+ */
+
+const { nidekModel } = require('./nidek');
+
+module.exports = nidekModel({
+  id: 'nidek-nt',
+  description: 'NIDEK NT tonometer',
+  devices: [{ manufacturer: /nidek/i, model: /nt-|tonometer/i }],
+  csv: {
+    iop: { from: ['IOP', 'Pressure'], type: 'number', unit: 'mmHg' }
+  },
+  xml: {
+    iop: { from: ['IOP', 'Pressure'], type: 'number', unit: 'mmHg' },
+    readings: { items: [['Reading1'], ['Reading2'], ['Reading3']], type: 'number', unit: 'mmHg' }
+  }
+});
@@ -0,0 +1,35 @@
+/**
+ * OCT summary exports (devices that export thickness tables to CSV)
+ */
+
+module.exports = {
+  id: 'oct',
+  description: 'Optical coherence tomography',
+  files: {
+    csv: {
+      kind: 'csv',
+      record: {
+        eye: { from: ['Eye', 'eye'] },
+        capturedAt: { from: ['Date', 'date'], type: 'date' },
+        retinalThickness: { from: ['Central Thickness', 'centralThickness'], type: 'number', unit: 'µm' },
+        signalStrength: { from: ['Signal Strength', 'signalStrength'], type: 'number' },
+        qualityScore: { from: ['Quality', 'quality'], type: 'number', default: 100 },
+        rnfl: {
+          fields: {
+            average: { from: ['RNFL Average', 'rnflAverage'], type: 'number', unit: 'µm' },
+            superior: { from: ['RNFL Superior', 'rnflSuperior'], type: 'number', unit: 'µm' },
+            inferior: { from: ['RNFL Inferior', 'rnflInferior'], type: 'number', unit: 'µm' },
+            nasal: { from: ['RNFL Nasal', 'rnflNasal'], type: 'number', unit: 'µm' },
+            temporal: { from: ['RNFL Temporal', 'rnflTemporal'], type: 'number', unit: 'µm' }
+          }
+        },
+        macula: {
+          fields: {
+            centralThickness: { from: ['Central Thickness', 'centralThickness'], type: 'number', unit: 'µm' },
+            volume: { from: ['Macular Volume', 'macularVolume'], type: 'number', unit: 'mm³' }
+          }
+        }
+      }
+    }
+  }
+};
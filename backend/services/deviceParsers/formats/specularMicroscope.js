@@ -0,0 +1,39 @@
+/**
+ * Specular microscope exports (endothelial cell analysis)
+ */
+
+module.exports = {
+  id: 'specular-microscope',
+  description: 'Specular microscope',
+  files: {
+    csv: {
+      kind: 'csv',
+      record: {
+        eye: { from: ['Eye', 'eye', 'EYE'] },
+        capturedAt: { from: ['Date', 'date', 'ExamDate'], type: 'date' },
+        ecd: { from: ['ECD', 'CD', 'Cell Density', 'cellDensity'], type: 'number', unit: 'cells/mm²' },
+        cv: { from: ['CV', 'CV%', 'CoeffVar'], type: 'number', unit: '%' },
+        hexagonality: { from: ['HEX', 'HEX%', 'Hexagonality', '6A'], type: 'number', unit: '%' },
+        cct: { from: ['CCT', 'Pachymetry', 'Thickness'], type: 'number', unit: 'µm' },
+        avgCellArea: { from: ['AVG', 'Avg Area', 'avgCellArea'], type: 'number', unit: 'µm²' },
+        cellCount: { from: ['NUM', 'Cell Count', 'Count', 'N'], type: 'int' },
+        imageQuality: { from: ['Quality', 'IQ'], type: 'number' }
+      }
+    },
+
+    txt: {
+      kind: 'keyValue',
+      separators: [':', '=', '\t'],
+      comments: ['#'],
+      passthrough: true,
+      record: {
+        ecd: { from: ['Cell Density', 'CD', 'ECD'], type: 'auto', unit: 'cells/mm²', optional: true },
+        cv: { from: ['CV', 'Coefficient of Variation'], type: 'auto', unit: '%', optional: true },
+        hexagonality: { from: ['HEX', 'Hexagonality'], type: 'auto', unit: '%', optional: true },
+        cct: { from: ['CCT', 'Pachymetry'], type: 'auto', unit: 'µm', optional: true },
+        eye: { from: ['Eye'], type: 'auto', optional: true },
+        capturedAt: { from: ['Date'], type: 'auto', optional: true }
+      }
+    }
+  }
+};
@@ -0,0 +1,53 @@
+/**
+ * Tonometer exports (NCT, Goldmann, rebound)
+ */
+
+module.exports = {
+  id: 'tonometer',
+  description: 'Tonometer',
+  files: {
+    csv: {
+      kind: 'csv',
+      record: {
+        measurementDate: { from: ['Date', 'date', 'Time', 'time'], type: 'date' },
+        method: { from: ['Method', 'method'], case: 'lower', default: 'unknown' },
+        source: { value: 'folder-sync' },
+        '{eye}': {
+          laterality: true,
+          when: ['{eye} IOP', '{eye}_IOP', 'IOP_{eye}'],
+          fields: {
+            iop: { from: ['{eye} IOP', '{eye}_IOP', 'IOP_{eye}'], type: 'number', unit: 'mmHg' },
+            method: { ref: 'method' },
+            time: { from: ['Time', 'time'], defaultNow: true },
+            pachymetry: { from: ['{eye} Pachymetry', '{eye}_Pachymetry'], type: 'number', unit: 'µm', optional: true },
+            readings: {
+              items: [1, 2, 3].map(i => [`{eye} Reading ${i}`, `{eye}_R${i}`]),
+              type: 'number',
+              unit: 'mmHg'
+            }
+          }
+        }
+      }
+    },
+
+    txt: {
+      kind: 'keyValue',
+      keyMatch: 'contains',
+      result: 'wrapped',
+      record: {
+        source: { value: 'folder-sync' },
+        measurementDate: { from: ['Date', 'Time'], type: 'date', optional: true },
+        method: { from: ['Method'], case: 'lower', optional: true },
+        '{eye}': {
+          laterality: true,
+          when: ['{eye} IOP', '{side} IOP', '{eye} Pachy', '{side} CCT'],
+          fields: {
+            iop: { from: ['{eye} IOP', '{side} IOP'], type: 'number', unit: 'mmHg', optional: true },
+            method: { ref: 'method' },
+            pachymetry: { from: ['{eye} Pachy', '{side} CCT'], type: 'number', unit: 'µm', optional: true }
+          }
+        }
+      }
+    }
+  }
+};
@@ -0,0 +1,70 @@
+/**
+ * Perimeter exports (Humphrey HFA CSV/XML, summary printouts)
+ */
+
+module.exports = {
+  id: 'visual-field',
+  description: 'Visual field analyzer',
+  files: {
+    csv: {
+      kind: 'csv',
+      record: {
+        eye: { from: ['Eye', 'eye', 'Laterality'], flags: { OD: 'OD' }, default: 'OS' },
+        capturedAt: { from: ['Date', 'ExamDate', 'Exam Date'], type: 'date' },
+        testPattern: { from: ['Pattern', 'TestPattern', 'Test Pattern'], default: '24-2' },
+        strategy: { from: ['Strategy', 'TestStrategy'], default: 'SITA-Standard' },
+        meanDeviation: { from: ['MD', 'MeanDeviation', 'Mean Deviation'], type: 'number', unit: 'dB' },
+        patternStandardDeviation: { from: ['PSD', 'PatternSD', 'Pattern Standard Deviation'], type: 'number', unit: 'dB' },
+        vfi: { from: ['VFI', 'VisualFieldIndex'], type: 'number', unit: '%' },
+        fovealThreshold: { from: ['Fovea', 'Foveal', 'Foveal Threshold'], type: 'number', unit: 'dB' },
+        fixationLosses: { from: ['FL', 'FixationLosses', 'Fixation Losses'] },
+        falsePositives: { from: ['FP', 'FalsePos', 'False Positives'], type: 'number', unit: '%' },
+        falseNegatives: { from: ['FN', 'FalseNeg', 'False Negatives'], type: 'number', unit: '%' },
+        ghtResult: { from: ['GHT', 'GlaucomaHemifield'] },
+        testDuration: { from: ['Duration', 'TestDuration', 'Test Duration (min)'], type: 'number', unit: 'min' },
+        sensitivities: { from: ['Sensitivities', 'Thresholds'] },
+        totalDeviation: { from: ['TD', 'TotalDeviation'] },
+        patternDeviation: { from: ['PD', 'PatternDeviation'] }
+      }
+    },
+
+    xml: {
+      kind: 'xml',
+      record: {
+        eye: { from: ['Laterality', 'Eye', 'EyeTested'] },
+        capturedAt: { from: ['ExamDate', 'Date', 'TestDate'] },
+        testPattern: { from: ['TestPattern', 'Pattern'], default: '24-2' },
+        strategy: { from: ['Strategy', 'TestStrategy'], default: 'SITA-Standard' },
+        meanDeviation: { from: ['MD', 'MeanDeviation'], type: 'number', unit: 'dB' },
+        patternStandardDeviation: { from: ['PSD', 'PatternStandardDeviation'], type: 'number', unit: 'dB' },
+        vfi: { from: ['VFI', 'VisualFieldIndex'], type: 'number', unit: '%' },
+        fovealThreshold: { from: ['FovealThreshold', 'Fovea'], type: 'number', unit: 'dB' },
+        fixationLosses: { from: ['FixationLosses', 'FL'] },
+        falsePositives: { from: ['FalsePositives', 'FP'], type: 'number', unit: '%' },
+        falseNegatives: { from: ['FalseNegatives', 'FN'], type: 'number', unit: '%' },
+        ghtResult: { from: ['GHT', 'GlaucomaHemifieldTest'] },
+        testDuration: { from: ['TestDuration', 'Duration'], type: 'number', unit: 'min' },
+        sensitivities: { from: ['Threshold', 'Sensitivity'], type: 'number', unit: 'dB', many: true },
+        totalDeviation: { from: ['TotalDeviation', 'TD'], type: 'number', unit: 'dB', many: true },
+        patternDeviation: { from: ['PatternDeviation', 'PD'], type: 'number', unit: 'dB', many: true }
+      }
+    },
+
+    txt: {
+      kind: 'keyValue',
+      keyMatch: 'snake',
+      record: {
+        eye: { from: ['eye', 'laterality'], type: 'laterality', optional: true },
+        meanDeviation: { from: ['md', 'mean_deviation'], type: 'number', unit: 'dB', optional: true },
+        patternStandardDeviation: { from: ['psd', 'pattern_standard_deviation'], type: 'number', unit: 'dB', optional: true },
+        vfi: { from: ['vfi', 'visual_field_index'], type: 'number', unit: '%', optional: true },
+        fovealThreshold: { from: ['fovea', 'foveal'], type: 'number', unit: 'dB', optional: true },
+        fixationLosses: { from: ['fl', 'fixation_losses'], optional: true },
+        falsePositives: { from: ['fp', 'false_positives'], type: 'number', unit: '%', optional: true },
+        falseNegatives: { from: ['fn', 'false_negatives'], type: 'number', unit: '%', optional: true },
+        ghtResult: { from: ['ght', 'glaucoma_hemifield_test'], optional: true },
+        testPattern: { from: ['pattern', 'test_pattern'], optional: true }
+      }
+    }
+  }
+};
@@ -0,0 +1,124 @@
+/**
+ * Device Export Parsers
+ *
+ * Registry of the declarative export mappings in ./formats, compiled once
+ * at load by ./formatCompiler. Adapters name the mapping they emit
+ * (AutorefractorAdapter -> 'autorefractor'); the generic adapter resolves
+ * one from the device's manufacturer and model.
+ *
+ * Features:
+ * - parseExport / parseExportStream for in-memory and streamed files
+ * - resolveFormat(device) so a new device model is a data change
+ * - describeFormat for the typed field list (paths, types, units)
+ */
+
+const { compileFormat } = require('./formatCompiler');
+const formats = require('./formats');
+
+// ============================================
+// REGISTRY
+// ============================================
+
+const FORMATS = new Map();
+const EXTRACTORS = new Map();
+
+for (const format of formats) {
+  if (FORMATS.has(format.id)) {
+    throw new Error(`Duplicate device export format: ${format.id}`);
+  }
+  FORMATS.set(format.id, format);
+  for (const [fileFormat, spec] of Object.entries(format.files)) {
+    EXTRACTORS.set(`${format.id}.${fileFormat}`, compileFormat(spec, `${format.id}.${fileFormat}`));
+  }
+}
+
+const keyFor = (format, fileFormat) => `${format}.${String(fileFormat).toLowerCase()}`;
+
+/**
+ * Whether a mapping exists for this format and file type
+ */
+function supports(format, fileFormat) {
+  return Boolean(format) && EXTRACTORS.has(keyFor(format, fileFormat));
+}
+
+function getExtractor(format, fileFormat) {
+  const extractor = EXTRACTORS.get(keyFor(format, fileFormat));
+  if (!extractor) {
+    throw new Error(`No ${fileFormat} mapping for device export format: ${format}`);
+  }
+  return extractor;
+}
+
+/**
+ * Parse an export held in memory
+ *
+ * @param {String|Buffer} content - File content
+ * @param {Object} options - { format, fileFormat }
+ * @returns {Object|Array} - Record, or records for tabular files
+ */
+function parseExport(content, { format, fileFormat }) {
+  return getExtractor(format, fileFormat).parse(content);
+}
+
+/**
+ * Parse an export from a readable stream (bulk back-imports)
+ */
+function parseExportStream(readable, { format, fileFormat }) {
+  return getExtractor(format, fileFormat).parseStream(readable);
+}
+
+/**
+ * Iterate the records of a tabular export one at a time
+ */
+function exportRecords(readable, { format, fileFormat }) {
+  return getExtractor(format, fileFormat).records(readable);
+}
+
+/**
+ * Find the mapping for a device from its manufacturer and model
+ *
+ * @param {Object} device - { manufacturer, model }
+ * @returns {String|null} - Format id
+ */
+function resolveFormat(device) {
+  if (!device) return null;
+  const manufacturer = device.manufacturer || '';
+  const model = device.model || '';
+
+  for (const format of FORMATS.values()) {
+    const matched = (format.devices || []).some(rule =>
+      (!rule.manufacturer || rule.manufacturer.test(manufacturer)) &&
+      (!rule.model || rule.model.test(model))
+    );
+    if (matched) return format.id;
+  }
+  return null;
+}
+
+/**
+ * Typed field list of a mapping, per file type
+ */
+function describeFormat(format) {
+  const definition = FORMATS.get(format);
+  if (!definition) return null;
+
+  const files = {};
+  for (const fileFormat of Object.keys(definition.files)) {
+    files[fileFormat] = getExtractor(format, fileFormat).fields;
+  }
+  return { id: definition.id, description: definition.description, files };
+}
+
+function listFormats() {
+  return Array.from(FORMATS.keys());
+}
+
+module.exports = {
+  supports,
+  parseExport,
+  parseExportStream,
+  exportRecords,
+  resolveFormat,
+  describeFormat,
+  listFormats
+};
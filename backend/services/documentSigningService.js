@@ -0,0 +1,417 @@
+/**
+ * Document Signing Service
+ *
+ * Batch cryptographic signing of prescriptions and surgery reports:
+ * - One Ed25519 signature per signing session over a Merkle root of
+ *   the session's documents (utils/documentSignature)
+ * - Per-document inclusion proof stored on the document and embedded
+ *   in its QR code for offline verification
+ * - Pluggable key store: PHI-encrypted keys in MongoDB (default) or a
+ *   file-backed HSM emulator (SIGNING_KEYSTORE=hsm, SIGNING_HSM_DIR)
+ * - Public trust list for pharmacies / insurers, including revocations
+ */
+
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+const SigningKey = require('../models/SigningKey');
+const SignatureBatch = require('../models/SignatureBatch');
+const signature = require('../utils/documentSignature');
+const phiEncryption = require('../utils/phiEncryption');
+const { createContextLogger } = require('../utils/structuredLogger');
+
+const log = createContextLogger('DocumentSigning');
+
+// ============================================
+// CONSTANTS
+// ============================================
+
+const MAX_BATCH_SIZE = 500;
+const DEFAULT_HSM_DIR = path.join(__dirname, '..', 'keys', 'signing');
+
+const idOf = value => (value?._id ? String(value._id) : value ? String(value) : undefined);
+const isoDay = value => (value ? new Date(value).toISOString().slice(0, 10) : undefined);
+
+// ============================================
+// KEY STORES
+// ============================================
+
+function generateKeyPair() {
+  const { publicKey, privateKey } = crypto.generateKeyPairSync('ed25519');
+  const raw = signature.rawPublicKey(publicKey);
+  return {
+    keyId: signature.keyIdFor(raw),
+    publicKey: signature.toB64url(raw),
+    privateKey
+  };
+}
+
+/**
+ * Private keys stored in the SigningKey collection, PHI-encrypted at rest
+ */
+class DatabaseKeyStore {
+  constructor() {
+    this.storage = 'database';
+    this.privateKeys = new Map(); // keyId -> KeyObject
+  }
+
+  async getSigningKey(signerId) {
+    const existing = await SigningKey.findOne({ owner: signerId, status: 'active' })
+      .select('+encryptedPrivateKey')
+      .sort({ createdAt: -1 });
+    if (existing && existing.storage === this.storage) {
+      return { keyId: existing.keyId, publicKey: existing.publicKey, record: existing };
+    }
+
+    const pair = generateKeyPair();
+    const der = pair.privateKey.export({ format: 'der', type: 'pkcs8' }).toString('base64');
+    await this._persist(signerId, pair, { encryptedPrivateKey: phiEncryption.encrypt(der) });
+    this.privateKeys.set(pair.keyId, pair.privateKey);
+    return { keyId: pair.keyId, publicKey: pair.publicKey };
+  }
+
+  async _persist(signerId, pair, extra) {
+    // A signer has one active key; an older key from another store retires
+    await SigningKey.updateMany(
+      { owner: signerId, status: 'active' },
+      { $set: { status: 'revoked', revokedAt: new Date(), revocationReason: 'superseded' } }
+    );
+    await SigningKey.create({
+      keyId: pair.keyId,
+      owner: signerId,
+      publicKey: pair.publicKey,
+      storage: this.storage,
+      ...extra
+    });
+    log.info('Signing key created', { keyId: pair.keyId, storage: this.storage });
+  }
+
+  async _privateKey(keyId) {
+    if (!this.privateKeys.has(keyId)) {
+      const record = await SigningKey.findOne({ keyId, status: 'active' }).select('+encryptedPrivateKey');
+      if (!record?.encryptedPrivateKey) throw new Error(`Signing key ${keyId} is not available`);
+      const der = Buffer.from(phiEncryption.decrypt(record.encryptedPrivateKey), 'base64');
+      this.privateKeys.set(keyId, crypto.createPrivateKey({ key: der, format: 'der', type: 'pkcs8' }));
+    }
+    return this.privateKeys.get(keyId);
+  }
+
+  async sign(keyId, message) {
+    return crypto.sign(null, message, await this._privateKey(keyId));
+  }
+}
+
+/**
+ * HSM emulator: private keys never enter MongoDB; they live as 0600 PEM
+ * files in SIGNING_HSM_DIR and only the sign operation is exposed
+ */
+class HsmEmulatorKeyStore extends DatabaseKeyStore {
+  constructor(dir = process.env.SIGNING_HSM_DIR || DEFAULT_HSM_DIR) {
+    super();
+    this.storage = 'hsm';
+    this.dir = dir;
+  }
+
+  async getSigningKey(signerId) {
+    const existing = await SigningKey.findOne({ owner: signerId, status: 'active' }).sort({ createdAt: -1 });
+    if (existing && existing.storage === this.storage && fs.existsSync(this._keyPath(existing.keyId))) {
+      return { keyId: existing.keyId, publicKey: existing.publicKey, record: existing };
+    }
+
+    const pair = generateKeyPair();
+    await fs.promises.mkdir(this.dir, { recursive: true, mode: 0o700 });
+    await fs.promises.writeFile(
+      this._keyPath(pair.keyId),
+      pair.privateKey.export({ format: 'pem', type: 'pkcs8' }),
+      { mode: 0o600 }
+    );
+    await this._persist(signerId, pair, {});
+    this.privateKeys.set(pair.keyId, pair.privateKey);
+    return { keyId: pair.keyId, publicKey: pair.publicKey };
+  }
+
+  _keyPath(keyId) {
+    return path.join(this.dir, `${keyId}.pem`);
+  }
+
+  async _privateKey(keyId) {
+    if (!this.privateKeys.has(keyId)) {
+      const pem = await fs.promises.readFile(this._keyPath(keyId), 'utf8');
+      this.privateKeys.set(keyId, crypto.createPrivateKey(pem));
+    }
+    return this.privateKeys.get(keyId);
+  }
+}
+
+function createKeyStore(kind = process.env.SIGNING_KEYSTORE) {
+  return kind === 'hsm' ? new HsmEmulatorKeyStore() : new DatabaseKeyStore();
+}
+
+// ============================================
+// CLAIMS
+// ============================================
+
+/**
+ * Signed, QR-embedded content of a prescription. Kept compact: what a
+ * pharmacist must check against the paper copy, nothing more.
+ */
+function prescriptionClaims(rx) {
+  const claims = {
+    k: 'rx',
+    id: rx.prescriptionId || idOf(rx._id),
+    p: idOf(rx.patient),
+    by: idOf(rx.prescriber),
+    t: rx.type,
+    d: isoDay(rx.dateIssued),
+    v: isoDay(rx.validUntil)
+  };
+
+  if (rx.medications?.length) {
+    claims.m = rx.medications.map(med => [
+      med.name || med.genericName || null,
+      med.strength || null,
+      med.form || null,
+      med.dosage?.amount ?? null,
+      med.dosage?.unit || null,
+      med.dosage?.frequency?.times ?? null,
+      med.dosage?.frequency?.period || null,
+      med.dosage?.duration?.value ?? null,
+      med.dosage?.duration?.unit || null,
+      med.quantity ?? null,
+      med.refills?.allowed ?? 0
+    ]);
+  }
+
+  if (rx.optical?.OD || rx.optical?.OS) {
+    const eye = e => (e ? [e.sphere ?? null, e.cylinder ?? null, e.axis ?? null, e.add ?? null] : null);
+    claims.o = {
+      t: rx.optical.prescriptionType,
+      od: eye(rx.optical.OD),
+      os: eye(rx.optical.OS),
+      pd: rx.optical.pd?.binocular ?? undefined
+    };
+  }
+
+  return claims;
+}
+
+function surgeryReportClaims(report) {
+  return {
+    k: 'op',
+    id: idOf(report._id),
+    p: idOf(report.patient),
+    by: idOf(report.surgeon),
+    d: isoDay(report.surgeryDate),
+    e: report.eye,
+    pr: report.procedurePerformed,
+    dx: report.postOpDiagnosis || undefined
+  };
+}
+
+const CLAIM_BUILDERS = {
+  prescription: prescriptionClaims,
+  surgeryReport: surgeryReportClaims
+};
+
+// ============================================
+// SERVICE
+// ============================================
+
+class DocumentSigningService {
+  constructor(keyStore = createKeyStore()) {
+    this.keyStore = keyStore;
+  }
+
+  /**
+   * Sign a set of documents with a single signing operation
+   * @param {ObjectId} signerId - Signing user
+   * @param {Array} docs - [{ kind: 'prescription'|'surgeryReport', doc }]
+   * @returns {Promise<Object>} - { batch, results: [{ kind, ref, digital }] }
+   */
+  async signDocuments(signerId, docs) {
+    if (!docs?.length) throw new Error('No documents to sign');
+    if (docs.length > MAX_BATCH_SIZE) {
+      throw new Error(`Cannot sign more than ${MAX_BATCH_SIZE} documents in one batch`);
+    }
+
+    const leaves = docs.map(({ kind, doc }) => {
+      const claims = CLAIM_BUILDERS[kind](doc);
+      return { kind, ref: doc._id, claims, digest: signature.documentDigest(claims) };
+    });
+
+    const levels = signature.buildMerkleTree(leaves.map(leaf => leaf.digest));
+    const root = signature.merkleRoot(levels);
+    const { keyId } = await this.keyStore.getSigningKey(signerId);
+    const batchId = crypto.randomUUID();
+    const signedAt = new Date();
+
+    const sig = await this.keyStore.sign(keyId, signature.batchMessage({ keyId, batchId, signedAt, root }));
+
+    const rootB64 = signature.toB64url(root);
+    const sigB64 = signature.toB64url(sig);
+
+    await SignatureBatch.create({
+      batchId,
+      signer: signerId,
+      keyId,
+      algorithm: signature.ALGORITHM,
+      root: rootB64,
+      signature: sigB64,
+      signedAt,
+      leafCount: leaves.length,
+      documents: leaves.map((leaf, index) => ({
+        kind: leaf.kind,
+        ref: leaf.ref,
+        digest: signature.toB64url(leaf.digest),
+        index
+      }))
+    });
+
+    const results = leaves.map((leaf, index) => ({
+      kind: leaf.kind,
+      ref: leaf.ref,
+      digital: {
+        batch: batchId,
+        keyId,
+        algorithm: signature.ALGORITHM,
+        digest: signature.toB64url(leaf.digest),
+        root: rootB64,
+        index,
+        proof: signature.inclusionProof(levels, index),
+        signature: sigB64,
+        signedAt
+      }
+    }));
+
+    log.info('Signature batch created', { batchId, keyId, documents: leaves.length });
+    return { batch: { batchId, keyId, root: rootB64, signedAt, leafCount: leaves.length }, results };
+  }
+
+  /**
+   * Sign prescriptions and surgery reports in one batch and persist the
+   * signatures with one bulkWrite per collection
+   * @param {ObjectId} signerId
+   * @param {Object} documents - { prescriptions: [], surgeryReports: [] }
+   */
+  async signBatch(signerId, { prescriptions = [], surgeryReports = [] }) {
+    const Prescription = require('../models/Prescription');
+    const SurgeryReport = require('../models/SurgeryReport');
+
+    const signed = await this.signDocuments(signerId, [
+      ...prescriptions.map(doc => ({ kind: 'prescription', doc })),
+      ...surgeryReports.map(doc => ({ kind: 'surgeryReport', doc }))
+    ]);
+
+    const prescriptionOps = [];
+    const reportOps = [];
+    for (const { kind, ref, digital } of signed.results) {
+      if (kind === 'prescription') {
+        prescriptionOps.push({
+          updateOne: {
+            filter: { _id: ref, 'signature.prescriber.signed': { $ne: true } },
+            update: {
+              $set: {
+                'signature.prescriber.signed': true,
+                'signature.prescriber.signedAt': digital.signedAt,
+                'signature.prescriber.digital': digital
+              }
+            }
+          }
+        });
+      } else {
+        reportOps.push({ updateOne: { filter: { _id: ref }, update: { $set: { digitalSignature: digital } } } });
+      }
+    }
+
+    await Promise.all([
+      prescriptionOps.length ? Prescription.bulkWrite(prescriptionOps, { ordered: false }) : null,
+      reportOps.length ? SurgeryReport.bulkWrite(reportOps, { ordered: false }) : null
+    ]);
+
+    return signed;
+  }
+
+  signPrescriptions(signerId, prescriptions) {
+    return this.signBatch(signerId, { prescriptions });
+  }
+
+  signSurgeryReports(signerId, surgeryReports) {
+    return this.signBatch(signerId, { surgeryReports });
+  }
+
+  /**
+   * QR text for a signed document, or null when it carries no digital signature
+   */
+  qrPayloadFor(kind, doc) {
+    const digital = kind === 'prescription' ? doc.signature?.prescriber?.digital : doc.digitalSignature;
+    if (!digital?.signature) return null;
+
+    return signature.encodeQrPayload({
+      claims: CLAIM_BUILDERS[kind](doc),
+      keyId: digital.keyId,
+      batchId: digital.batch,
+      signedAt: digital.signedAt,
+      root: digital.root,
+      signature: digital.signature,
+      proof: [...(digital.proof || [])]
+    });
+  }
+
+  /**
+   * Check a stored document against its signature: the current content is
+   * re-hashed, so any edit after signing is reported as tampering
+   * @returns {Promise<Object>} - { signed, valid, reason? }
+   */
+  async verifyStoredSignature(kind, doc) {
+    const payload = this.qrPayloadFor(kind, doc);
+    if (!payload) return { signed: false, valid: false, reason: 'unsigned' };
+
+    const trust = await this.getTrustList();
+    const result = signature.verifyQrPayload(payload, trust.keys);
+    return { signed: true, valid: result.valid, reason: result.reason };
+  }
+
+  /**
+   * Public keys (with revocation dates) for offline verifiers
+   * @returns {Promise<Object>} - { algorithm, keys: { keyId: { publicKey, owner, revokedAt } } }
+   */
+  async getTrustList() {
+    const records = await SigningKey.find({}).select('keyId publicKey owner status revokedAt revocationReason createdAt').lean();
+    const keys = {};
+    for (const record of records) {
+      keys[record.keyId] = {
+        publicKey: record.publicKey,
+        owner: idOf(record.owner),
+        status: record.status,
+        createdAt: record.createdAt,
+        // Superseded keys stay valid for documents signed before rotation
+        revokedAt: record.status === 'revoked' && record.revocationReason !== 'superseded'
+          ? record.revokedAt
+          : undefined
+      };
+    }
+    return { algorithm: signature.ALGORITHM, keys };
+  }
+
+  verifyQr(text, trustedKeys) {
+    return signature.verifyQrPayload(text, trustedKeys);
+  }
+
+  /**
+   * Revoke a key: documents signed at or after revokedAt stop verifying
+   */
+  async revokeKey(keyId, reason = 'compromised', revokedAt = new Date()) {
+    return SigningKey.findOneAndUpdate(
+      { keyId },
+      { $set: { status: 'revoked', revokedAt, revocationReason: reason } },
+      { new: true }
+    );
+  }
+}
+
+module.exports = new DocumentSigningService();
+module.exports.DocumentSigningService = DocumentSigningService;
+module.exports.DatabaseKeyStore = DatabaseKeyStore;
+module.exports.HsmEmulatorKeyStore = HsmEmulatorKeyStore;
+module.exports.prescriptionClaims = prescriptionClaims;
+module.exports.surgeryReportClaims = surgeryReportClaims;
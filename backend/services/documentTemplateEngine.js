@@ -0,0 +1,290 @@
+/**
+ * Document Template Engine
+ *
+ * Renders DocumentTemplate content ({{variable}} placeholders):
+ * - Each template compiled once into a render function, cached per
+ *   template _id and invalidated when its version or updatedAt changes
+ * - Compiled templates declare the data fields they use, so only the
+ *   patient, visit, refraction and doctor data they need is loaded
+ * - Context loaded set-wise: one query per collection for any number of
+ *   patients/visits, then reused for every template rendered against it
+ *
+ * Rendering keeps the controller's historical semantics: known fields are
+ * replaced with their value (falsy values render empty) and unknown
+ * placeholders render as a blank line to fill in by hand.
+ */
+
+const mongoose = require('mongoose');
+const Patient = require('../models/Patient');
+const Visit = require('../models/Visit');
+const User = require('../models/User');
+
+// ============================================
+// CONSTANTS
+// ============================================
+
+const PLACEHOLDER = /{{(.*?)}}/g;
+const BLANK = '___________';
+const COMPILED_CACHE_SIZE = 500;
+
+// Auto-filled field -> context it is read from
+const FIELD_SOURCES = {
+  patientName: 'patient',
+  patientFirstName: 'patient',
+  patientLastName: 'patient',
+  patientTitle: 'patient',
+  dateOfBirth: 'patient',
+  patientAge: 'patient',
+  patientPhone: 'patient',
+  patientEmail: 'patient',
+  visitDate: 'visit',
+  consultationDate: 'visit',
+  diagnosis: 'visit',
+  iopOD: 'visit',
+  iopOG: 'visit',
+  vaOD: 'refraction',
+  vaOG: 'refraction',
+  vaODCorrected: 'refraction',
+  vaOGCorrected: 'refraction',
+  doctorName: 'user',
+  doctorFirstName: 'user',
+  doctorLastName: 'user',
+  doctorSpecialty: 'user'
+};
+
+const ALL_SOURCES = new Set(Object.values(FIELD_SOURCES));
+
+const PATIENT_FIELDS = 'firstName lastName gender dateOfBirth phoneNumber email';
+const VISIT_FIELDS = 'patient visitDate diagnoses vitalSigns examinations.refraction';
+const USER_FIELDS = 'firstName lastName gender specialization';
+
+// ============================================
+// FORMATTERS
+// ============================================
+
+const calculateAge = (dateOfBirth, today = new Date()) => {
+  const birthDate = new Date(dateOfBirth);
+  let age = today.getFullYear() - birthDate.getFullYear();
+  const monthDiff = today.getMonth() - birthDate.getMonth();
+  if (monthDiff < 0 || (monthDiff === 0 && today.getDate() < birthDate.getDate())) {
+    age--;
+  }
+  return age;
+};
+
+// French format (DD/MM/YYYY)
+const formatDateFR = (date) => {
+  if (!date) return '';
+  const d = new Date(date);
+  const day = String(d.getDate()).padStart(2, '0');
+  const month = String(d.getMonth() + 1).padStart(2, '0');
+  return `${day}/${month}/${d.getFullYear()}`;
+};
+
+// ============================================
+// COMPILATION
+// ============================================
+
+/**
+ * Compile template content into a render function
+ * @param {String} content - Template content with {{field}} placeholders
+ * @returns {Object} { render(data) -> String, fields: [String], sources: Set }
+ */
+function compileTemplate(content = '') {
+  const text = String(content);
+  const literals = [];
+  const keys = [];
+
+  let last = 0;
+  for (const match of text.matchAll(PLACEHOLDER)) {
+    literals.push(text.slice(last, match.index));
+    keys.push(match[1]);
+    last = match.index + match[0].length;
+  }
+  literals.push(text.slice(last));
+
+  const fields = [...new Set(keys)];
+  const sources = new Set(fields.map(field => FIELD_SOURCES[field]).filter(Boolean));
+  if (sources.has('refraction')) sources.add('visit');
+
+  const render = (data) => {
+    let out = literals[0];
+    for (let i = 0; i < keys.length; i++) {
+      const key = keys[i];
+      out += (Object.prototype.hasOwnProperty.call(data, key) ? (data[key] || '') : BLANK) + literals[i + 1];
+    }
+    return out;
+  };
+
+  return { render, fields, sources };
+}
+
+// ============================================
+// ENGINE
+// ============================================
+
+class DocumentTemplateEngine {
+  constructor() {
+    this.compiled = new Map(); // template _id -> { key, compiled }
+  }
+
+  /**
+   * Compiled form of a template, reused until the template changes
+   * @param {Object} template - DocumentTemplate document or lean object
+   */
+  getCompiled(template) {
+    if (!template._id) return compileTemplate(template.content);
+
+    const id = String(template._id);
+    const key = `${template.version || 0}:${template.updatedAt ? new Date(template.updatedAt).getTime() : 0}`;
+    const cached = this.compiled.get(id);
+    if (cached && cached.key === key) {
+      // Refresh recency for the size cap
+      this.compiled.delete(id);
+      this.compiled.set(id, cached);
+      return cached.compiled;
+    }
+
+    const compiled = compileTemplate(template.content);
+    this.compiled.delete(id);
+    if (this.compiled.size >= COMPILED_CACHE_SIZE) {
+      this.compiled.delete(this.compiled.keys().next().value);
+    }
+    this.compiled.set(id, { key, compiled });
+    return compiled;
+  }
+
+  /**
+   * Data sources needed by a set of templates
+   */
+  sourcesFor(templates) {
+    const sources = new Set();
+    for (const template of templates) {
+      for (const source of this.getCompiled(template).sources) sources.add(source);
+    }
+    return sources;
+  }
+
+  /**
+   * Load patients, visits and the doctor once for a batch of documents
+   *
+   * @param {Object} ids - { patientIds, visitIds, userId }
+   * @param {Set} [sources] - From sourcesFor(); everything when omitted
+   * @returns {Promise<Object>} { patients: Map, visits: Map, user }
+   */
+  async loadContext({ patientIds = [], visitIds = [], userId = null }, sources = ALL_SOURCES) {
+    const validIds = ids => [...new Set(ids.filter(Boolean).map(String))].filter(id => mongoose.isValidObjectId(id));
+
+    let visits = [];
+    const visitIdList = validIds(visitIds);
+    if (visitIdList.length > 0) {
+      // Visit patients are always needed to resolve the patient of each visit
+      const query = Visit.find({ _id: { $in: visitIdList } }).select(VISIT_FIELDS);
+      if (sources.has('refraction')) query.populate('examinations.refraction');
+      visits = await query.lean();
+    }
+
+    const patientIdList = sources.has('patient')
+      ? validIds([...patientIds, ...visits.map(visit => visit.patient)])
+      : [];
+    const userIdList = sources.has('user') ? validIds([userId]) : [];
+
+    const [patients, users] = await Promise.all([
+      patientIdList.length ? Patient.find({ _id: { $in: patientIdList } }).select(PATIENT_FIELDS).lean() : [],
+      userIdList.length ? User.find({ _id: { $in: userIdList } }).select(USER_FIELDS).lean() : []
+    ]);
+
+    return {
+      patients: new Map(patients.map(patient => [String(patient._id), patient])),
+      visits: new Map(visits.map(visit => [String(visit._id), visit])),
+      user: users[0] || null
+    };
+  }
+
+  /**
+   * Auto-filled data for one patient/visit from a loaded context
+   *
+   * @param {Object} context - From loadContext()
+   * @param {Object} target - { patientId, visitId }
+   * @param {Object} [customData] - Caller-supplied values (auto-filled fields win)
+   */
+  buildData(context, { patientId = null, visitId = null } = {}, customData = {}) {
+    const data = { ...customData };
+    const visit = visitId ? context.visits.get(String(visitId)) : null;
+    const patient = context.patients.get(String(patientId || visit?.patient || ''));
+
+    if (patient) {
+      data.patientName = `${patient.firstName} ${patient.lastName}`;
+      data.patientFirstName = patient.firstName;
+      data.patientLastName = patient.lastName;
+      data.patientTitle = patient.gender === 'male' ? 'Monsieur' : 'Madame';
+      data.dateOfBirth = patient.dateOfBirth ? formatDateFR(patient.dateOfBirth) : '';
+      data.patientAge = patient.dateOfBirth ? calculateAge(patient.dateOfBirth) : '';
+      data.patientPhone = patient.phoneNumber || '';
+      data.patientEmail = patient.email || '';
+    }
+
+    if (visit) {
+      data.visitDate = formatDateFR(visit.visitDate);
+      data.consultationDate = formatDateFR(visit.visitDate);
+
+      if (visit.diagnoses && visit.diagnoses.length > 0) {
+        data.diagnosis = visit.diagnoses[0].diagnosis || '';
+      }
+
+      const refraction = visit.examinations?.refraction;
+      if (refraction && typeof refraction === 'object' && !(refraction instanceof mongoose.Types.ObjectId)) {
+        data.vaOD = refraction.visualAcuity?.withoutCorrection?.right?.decimal || '0';
+        data.vaOG = refraction.visualAcuity?.withoutCorrection?.left?.decimal || '0';
+        data.vaODCorrected = refraction.visualAcuity?.withCorrection?.right?.decimal || '0';
+        data.vaOGCorrected = refraction.visualAcuity?.withCorrection?.left?.decimal || '0';
+      }
+
+      if (visit.vitalSigns?.iop) {
+        data.iopOD = visit.vitalSigns.iop.right || '0';
+        data.iopOG = visit.vitalSigns.iop.left || '0';
+      }
+    }
+
+    const user = context.user;
+    if (user) {
+      const title = user.gender === 'male' ? 'Mr' : 'Dr';
+      data.doctorName = `${title} ${user.firstName} ${user.lastName}`;
+      data.doctorFirstName = user.firstName;
+      data.doctorLastName = user.lastName;
+      data.doctorSpecialty = user.specialization || '';
+    }
+
+    if (!data.consultationDate) {
+      data.consultationDate = formatDateFR(new Date());
+    }
+
+    return data;
+  }
+
+  /**
+   * Render a template against auto-filled data
+   */
+  render(template, data) {
+    return this.getCompiled(template).render(data);
+  }
+
+  /**
+   * Load context for one document and return its data
+   */
+  async autoFill({ patientId, visitId, userId, templates = null }, customData = {}) {
+    const sources = templates ? this.sourcesFor(templates) : ALL_SOURCES;
+    const context = await this.loadContext({ patientIds: [patientId], visitIds: [visitId], userId }, sources);
+    return this.buildData(context, { patientId, visitId }, customData);
+  }
+
+  clearCache() {
+    this.compiled.clear();
+  }
+}
+
+module.exports = new DocumentTemplateEngine();
+module.exports.DocumentTemplateEngine = DocumentTemplateEngine;
+module.exports.compileTemplate = compileTemplate;
+module.exports.formatDateFR = formatDateFR;
+module.exports.calculateAge = calculateAge;
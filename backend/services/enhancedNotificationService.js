@@ -6,7 +6,7 @@
  *   const notificationFacade = require('./notificationFacade');
  *
  * Provides robust multi-channel notifications with:
- * - SMS (Twilio, Africa's Talking)
+ * - SMS (operator SMPP bind, Twilio, Africa's Talking)
  * - Email
  * - In-app notifications
  * - Retry logic
@@ -17,6 +17,7 @@
 
 const sendEmail = require('../utils/sendEmail');
 const CONSTANTS = require('../config/constants');
+const smppService = require('./smppService');
 
 const { createContextLogger } = require('../utils/structuredLogger');
 const log = createContextLogger('EnhancedNotification');
@@ -197,6 +198,23 @@ class NotificationService {
 
         let result;
 
+        // Direct operator bind first; HTTP provider if it is down
+        if (smppService.isBound()) {
+          const smppResult = await smppService.send(formattedPhone, truncatedMessage);
+          if (smppResult.success) {
+            this.smsCount++;
+            this.stats.totalSMSSent++;
+            log.info(`✅ SMS sent over SMPP to ***${formattedPhone.slice(-4)}`);
+            return smppResult;
+          }
+          // Rejected by the operator (e.g. invalid destination): retrying elsewhere won't help
+          if (!smppResult.retryable) {
+            this.stats.totalSMSFailed++;
+            return smppResult;
+          }
+          log.warn('⚠️  SMPP send failed, using HTTP provider:', smppResult.error);
+        }
+
         if (this.smsProviderType === 'africastalking') {
           result = await this.sendViAfricasTalking(formattedPhone, truncatedMessage);
         } else if (this.smsProviderType === 'twilio') {
@@ -341,8 +359,42 @@ class NotificationService {
     const { batchSize = CONSTANTS.NOTIFICATION.MAX_SMS_BATCH_SIZE } = options;
 
     const results = [];
-    for (let i = 0; i < recipients.length; i += batchSize) {
-      const batch = recipients.slice(i, i + batchSize);
+    let remaining = recipients;
+
+    // Operator bind: pipelined at the negotiated rate, which replaces the
+    // hourly cap; recipients it could not take go through the HTTP provider
+    if (smppService.isBound()) {
+      const truncatedMessage = message.length > CONSTANTS.NOTIFICATION.MAX_SMS_LENGTH
+        ? `${message.substring(0, CONSTANTS.NOTIFICATION.MAX_SMS_LENGTH - 3)}...`
+        : message;
+      const valid = recipients.filter(recipient => this.formatPhoneNumber(recipient.phoneNumber));
+      const smppResults = await smppService.sendBulk(
+        valid.map(recipient => ({
+          to: this.formatPhoneNumber(recipient.phoneNumber),
+          text: truncatedMessage,
+          reference: recipient.reference
+        })),
+        { campaign: options.campaign }
+      );
+
+      remaining = recipients.filter(recipient => !valid.includes(recipient));
+      smppResults.forEach((result, index) => {
+        if (!result.success && result.retryable) {
+          remaining.push(valid[index]);
+          return;
+        }
+        if (result.success) {
+          this.smsCount++;
+          this.stats.totalSMSSent++;
+        } else {
+          this.stats.totalSMSFailed++;
+        }
+        results.push(result);
+      });
+    }
+
+    for (let i = 0; i < remaining.length; i += batchSize) {
+      const batch = remaining.slice(i, i + batchSize);
 
       const batchResults = await Promise.all(
         batch.map(recipient =>
@@ -354,7 +406,7 @@ class NotificationService {
       results.push(...batchResults);
 
       // Delay between batches to respect rate limits
-      if (i + batchSize < recipients.length) {
+      if (i + batchSize < remaining.length) {
         await new Promise(resolve => setTimeout(resolve, 1000));
       }
     }
@@ -442,7 +494,8 @@ class NotificationService {
         limit: CONSTANTS.NOTIFICATION.EMAIL_PER_HOUR_LIMIT,
         resetIn: this.emailResetTime - Date.now()
       },
-      provider: this.smsProviderType
+      provider: smppService.isBound() ? 'smpp' : this.smsProviderType,
+      smpp: smppService.settings.enabled ? smppService.getStatus() : undefined
     };
   }
 
@@ -0,0 +1,670 @@
+/**
+ * Index Advisor Service
+ *
+ * Records the shape of every Mongoose query (filter fields, sort, projection,
+ * skip - never values) and compares the observed workload with the indexes
+ * that actually exist and their $indexStats usage counters.
+ *
+ * Report:
+ * - Missing indexes: slow or skip-heavy shapes no index fully serves, with an
+ *   Equality-Sort-Range recommendation
+ * - Redundant indexes: duplicates and indexes that are a prefix of another
+ * - Unused indexes: zero accesses since the server started tracking them
+ *   (unique and TTL indexes are never reported, they enforce behaviour)
+ *
+ * The query plugin is registered globally by install(), which must run before
+ * any model is compiled (top of server.js).
+ */
+
+const mongoose = require('mongoose');
+const CONSTANTS = require('../config/constants');
+
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('IndexAdvisor');
+
+const QUERY_OPS = [
+  'find', 'findOne', 'countDocuments',
+  'findOneAndUpdate', 'findOneAndDelete', 'findOneAndReplace',
+  'updateOne', 'updateMany', 'replaceOne', 'deleteOne', 'deleteMany'
+];
+const WRITE_OPS = new Set([
+  'findOneAndUpdate', 'findOneAndDelete', 'findOneAndReplace',
+  'updateOne', 'updateMany', 'replaceOne', 'deleteOne', 'deleteMany'
+]);
+
+// Distinct shapes kept in memory; new shapes beyond this are counted, not stored
+const MAX_SHAPES = 2000;
+
+// Offset pagination past this many documents is reported even when indexed
+const SKIP_WARNING = 1000;
+
+// Unused-index report needs this much observation time since the stats reset
+const DEFAULT_MIN_OBSERVATION_MS = 7 * 24 * 60 * 60 * 1000;
+
+// ============================================
+// SHAPE NORMALIZATION (pure)
+// ============================================
+
+function isPlainObject(value) {
+  return value !== null && typeof value === 'object' && !Array.isArray(value) &&
+    !(value instanceof Date) && !(value instanceof RegExp) && !value._bsontype &&
+    !Buffer.isBuffer(value);
+}
+
+function isOperatorObject(value) {
+  if (!isPlainObject(value)) return false;
+  const keys = Object.keys(value);
+  return keys.length > 0 && keys.every(k => k.startsWith('$'));
+}
+
+function regexInfo(field, source, flags = '') {
+  return {
+    field,
+    // Only a case-sensitive ^prefix gives tight index bounds
+    anchored: String(source).startsWith('^') && !String(flags).includes('i')
+  };
+}
+
+function emptyShape() {
+  return { eq: new Set(), range: new Set(), regex: [], or: [], text: false, unsupported: new Set() };
+}
+
+function classifyField(shape, field, value) {
+  if (value instanceof RegExp) {
+    shape.regex.push(regexInfo(field, value.source, value.flags));
+    return;
+  }
+  if (!isOperatorObject(value)) {
+    shape.eq.add(field);
+    return;
+  }
+
+  for (const [op, operand] of Object.entries(value)) {
+    switch (op) {
+      case '$eq':
+      case '$in':
+      case '$elemMatch':
+      case '$all':
+        shape.eq.add(field);
+        break;
+      case '$regex':
+        shape.regex.push(operand instanceof RegExp
+          ? regexInfo(field, operand.source, operand.flags + (value.$options || ''))
+          : regexInfo(field, operand, value.$options));
+        break;
+      case '$options':
+        break;
+      case '$gt':
+      case '$gte':
+      case '$lt':
+      case '$lte':
+      case '$ne':
+      case '$nin':
+      case '$exists':
+      case '$type':
+      case '$size':
+      case '$not':
+        shape.range.add(field);
+        break;
+      default:
+        shape.unsupported.add(op);
+    }
+  }
+}
+
+function collectFilter(shape, filter, prefix = '') {
+  for (const [key, value] of Object.entries(filter || {})) {
+    if (key === '$and' && Array.isArray(value)) {
+      value.forEach(part => collectFilter(shape, part, prefix));
+    } else if ((key === '$or' || key === '$nor') && Array.isArray(value)) {
+      shape.or.push(value.map(branch => finalizeShape(collectFilter(emptyShape(), branch))));
+    } else if (key === '$text') {
+      shape.text = true;
+    } else if (key.startsWith('$')) {
+      shape.unsupported.add(key);
+    } else {
+      classifyField(shape, prefix + key, value);
+    }
+  }
+  return shape;
+}
+
+function finalizeShape(shape) {
+  const regex = shape.regex
+    .sort((a, b) => a.field.localeCompare(b.field) || Number(a.anchored) - Number(b.anchored));
+  return {
+    eq: [...shape.eq].sort(),
+    range: [...shape.range].filter(f => !shape.eq.has(f)).sort(),
+    regex,
+    or: shape.or,
+    text: shape.text,
+    unsupported: [...shape.unsupported].sort()
+  };
+}
+
+function normalizeSort(sort) {
+  if (!sort) return [];
+  if (typeof sort === 'string') {
+    return sort.split(/\s+/).filter(Boolean).map(f => f.startsWith('-') ? [f.slice(1), -1] : [f, 1]);
+  }
+  const entries = sort instanceof Map ? [...sort.entries()] : Object.entries(sort);
+  return entries
+    .filter(([, dir]) => typeof dir !== 'object')
+    .map(([field, dir]) => [field, (dir === -1 || dir === 'desc' || dir === 'descending' || dir === '-1') ? -1 : 1]);
+}
+
+function normalizeProjection(projection) {
+  if (!projection) return [];
+  if (typeof projection === 'string') {
+    return projection.split(/\s+/).filter(Boolean).map(f => f.replace(/^[-+]/, '')).sort();
+  }
+  return Object.keys(projection).sort();
+}
+
+/**
+ * Normalize one query into a value-free shape
+ * @param {Object} query - { filter, sort, projection, skip }
+ */
+function describeQuery({ filter, sort, projection, skip } = {}) {
+  return {
+    ...finalizeShape(collectFilter(emptyShape(), filter)),
+    sort: normalizeSort(sort),
+    projection: normalizeProjection(projection),
+    skip: Number(skip) || 0
+  };
+}
+
+/**
+ * Shape of an aggregation: the leading $match (and $sort right after it)
+ * is the only part an index can serve.
+ */
+function describePipeline(pipeline = []) {
+  const first = pipeline[0] || {};
+  const filter = first.$match || {};
+  const sortStage = first.$match ? pipeline[1] : first;
+  return describeQuery({ filter, sort: sortStage?.$sort });
+}
+
+function shapeKey(op, shape) {
+  const regex = shape.regex.map(r => `${r.field}${r.anchored ? '^' : '~'}`);
+  const or = shape.or.map(branch => shapeKey('', { ...branch, sort: [], projection: [] }));
+  return [
+    op,
+    `eq:${shape.eq.join(',')}`,
+    `rng:${shape.range.join(',')}`,
+    `re:${regex.join(',')}`,
+    `or:[${or.join('|')}]`,
+    shape.text ? 'text' : '',
+    `sort:${shape.sort.map(([f, d]) => `${f}:${d}`).join(',')}`,
+    `proj:${shape.projection.join(',')}`
+  ].filter(Boolean).join(' ');
+}
+
+// ============================================
+// ADVICE (pure)
+// ============================================
+
+function keyEntries(key) {
+  return key instanceof Map ? [...key.entries()] : Object.entries(key || {});
+}
+
+function formatKey(entries) {
+  return `{ ${entries.map(([f, d]) => `${f}: ${typeof d === 'string' ? `'${d}'` : d}`).join(', ')} }`;
+}
+
+/**
+ * Equality fields first, then sort keys, then range / prefix-regex fields
+ */
+function recommendIndex(shape) {
+  const entries = shape.eq.map(f => [f, 1]);
+  const used = new Set(shape.eq);
+  for (const [field, dir] of shape.sort) {
+    if (!used.has(field)) {
+      entries.push([field, dir]);
+      used.add(field);
+    }
+  }
+  const rangeFields = [...shape.range, ...shape.regex.filter(r => r.anchored).map(r => r.field)];
+  for (const field of rangeFields.sort()) {
+    if (!used.has(field)) {
+      entries.push([field, 1]);
+      used.add(field);
+    }
+  }
+  return entries;
+}
+
+/**
+ * How well one index serves a (branch-free) shape: 'full' | 'partial' | 'none'
+ */
+function indexCoverage(shape, indexKey) {
+  const key = keyEntries(indexKey);
+  const eq = new Set(shape.eq);
+  let i = 0;
+
+  while (i < key.length && eq.has(key[i][0])) i++;
+  const eqMatched = i;
+
+  let sortServed = shape.sort.length === 0;
+  if (shape.sort.length > 0) {
+    let sign = null;
+    let ok = true;
+    for (let j = 0; j < shape.sort.length; j++) {
+      const [field, dir] = shape.sort[j];
+      const entry = key[i + j];
+      if (!entry || entry[0] !== field || typeof entry[1] !== 'number') {
+        ok = false;
+        break;
+      }
+      const s = Math.sign(dir * entry[1]);
+      if (sign === null) sign = s;
+      else if (s !== sign) {
+        ok = false;
+        break;
+      }
+    }
+    if (ok) {
+      sortServed = true;
+      i += shape.sort.length;
+    }
+  }
+
+  const rangeFields = new Set([...shape.range, ...shape.regex.filter(r => r.anchored).map(r => r.field)]);
+  const rangeMatched = i < key.length && rangeFields.has(key[i][0]);
+  const leadingRange = eqMatched === 0 && key.length > 0 && rangeFields.has(key[0][0]);
+
+  const hasPredicate = eq.size > 0 || rangeFields.size > 0 || shape.sort.length > 0;
+  if (!hasPredicate) return 'none';
+
+  if (eqMatched === eq.size && sortServed && (rangeFields.size === 0 || rangeMatched || leadingRange)) {
+    return 'full';
+  }
+  if (eqMatched > 0 || leadingRange || (shape.sort.length > 0 && sortServed)) return 'partial';
+  return 'none';
+}
+
+function bestCoverage(shape, indexes) {
+  if (shape.text) {
+    return indexes.some(idx => keyEntries(idx.key).some(([, d]) => d === 'text')) ? 'full' : 'none';
+  }
+  if (shape.or.length > 0) {
+    // Every branch needs its own index or the whole $or becomes a collection scan
+    const ranks = { none: 0, partial: 1, full: 2 };
+    const branchCoverage = shape.or[0].map(branch => bestCoverage({
+      ...branch,
+      eq: [...new Set([...shape.eq, ...branch.eq])],
+      range: [...new Set([...shape.range, ...branch.range])],
+      sort: shape.sort,
+      or: []
+    }, indexes));
+    return branchCoverage.reduce((worst, c) => (ranks[c] < ranks[worst] ? c : worst), 'full');
+  }
+
+  let best = 'none';
+  for (const index of indexes) {
+    const coverage = indexCoverage(shape, index.key);
+    if (coverage === 'full') return 'full';
+    if (coverage === 'partial') best = 'partial';
+  }
+  return best;
+}
+
+function shapeNotes(shape) {
+  const notes = [];
+  const unanchored = shape.regex.filter(r => !r.anchored).map(r => r.field);
+  if (unanchored.length) {
+    notes.push(`Unanchored or case-insensitive $regex on ${unanchored.join(', ')} scans every index key; ` +
+      'use a ^prefix on a normalized field or a text index');
+  }
+  if (shape.maxSkip >= SKIP_WARNING) {
+    notes.push(`skip() up to ${shape.maxSkip}: use range pagination on the sort key instead of offsets`);
+  }
+  if (shape.unsupported.length) {
+    notes.push(`Operators ${shape.unsupported.join(', ')} cannot use an index`);
+  }
+  return notes;
+}
+
+/**
+ * Indexes that are duplicates of, or a key prefix of, another index
+ */
+function findRedundantIndexes(indexes) {
+  const redundant = [];
+  const candidates = indexes.filter(idx => idx.name !== '_id_');
+
+  for (const a of candidates) {
+    if (a.unique || a.expireAfterSeconds !== undefined || a.partialFilterExpression || a.sparse) continue;
+    const aKey = keyEntries(a.key);
+    if (aKey.some(([, d]) => typeof d !== 'number')) continue;
+
+    for (const b of candidates) {
+      if (a === b || b.partialFilterExpression || b.sparse) continue;
+      const bKey = keyEntries(b.key);
+      if (bKey.length < aKey.length) continue;
+
+      let sign = null;
+      const prefix = aKey.every(([field, dir], i) => {
+        if (bKey[i][0] !== field || typeof bKey[i][1] !== 'number') return false;
+        const s = Math.sign(dir * bKey[i][1]);
+        if (sign === null) sign = s;
+        return s === sign;
+      });
+      if (!prefix) continue;
+
+      const duplicate = bKey.length === aKey.length;
+      // Of two identical indexes keep the one that sorts first by name
+      if (duplicate && !b.unique && a.name < b.name) continue;
+
+      redundant.push({
+        index: a.name,
+        key: a.key,
+        coveredBy: b.name,
+        reason: duplicate ? `duplicates ${b.name}` : `prefix of ${b.name}`
+      });
+      break;
+    }
+  }
+  return redundant;
+}
+
+/**
+ * Indexes with zero recorded accesses over a long enough window
+ */
+function findUnusedIndexes(indexes, stats, { now = new Date(), minObservationMs = DEFAULT_MIN_OBSERVATION_MS } = {}) {
+  const byName = new Map(indexes.map(idx => [idx.name, idx]));
+  const unused = [];
+
+  for (const stat of stats) {
+    const index = byName.get(stat.name);
+    if (!index || stat.name === '_id_') continue;
+    if (index.unique || index.expireAfterSeconds !== undefined) continue;
+
+    const ops = Number(stat.accesses?.ops || 0);
+    const since = stat.accesses?.since ? new Date(stat.accesses.since) : null;
+    if (ops > 0) continue;
+    if (since && minObservationMs > 0 && now.getTime() - since.getTime() < minObservationMs) continue;
+
+    unused.push({ index: stat.name, key: index.key, since });
+  }
+  return unused;
+}
+
+/**
+ * Build the full report from recorded shapes and collection index metadata
+ * @param {Object[]} shapes - recorded shape entries
+ * @param {Object} collections - name -> { indexes, stats, indexSizes }
+ */
+function buildAdvice(shapes, collections, { now = new Date(), slowMs, minObservationMs, writesByCollection = {} } = {}) {
+  const slowThreshold = slowMs ?? CONSTANTS.DATABASE.SLOW_QUERY_THRESHOLD_MS;
+  const missing = [];
+
+  for (const entry of shapes) {
+    const info = collections[entry.collection];
+    if (!info) continue;
+
+    const shape = { ...entry.shape, maxSkip: entry.maxSkip };
+    const coverage = bestCoverage(shape, info.indexes);
+    const slow = entry.maxMs >= slowThreshold;
+    const notes = shapeNotes(shape);
+    const skipHeavy = entry.maxSkip >= SKIP_WARNING;
+
+    if (!(slow && coverage !== 'full') && !skipHeavy && !(slow && notes.length)) continue;
+
+    let recommendedIndex = null;
+    if (coverage !== 'full' && !shape.text && shape.or.length === 0) {
+      const keys = recommendIndex(shape);
+      if (keys.length) recommendedIndex = keys;
+    }
+    if (coverage !== 'full' && shape.or.length) {
+      notes.push('Each $or branch needs its own index: ' + shape.or[0]
+        .map(branch => formatKey(recommendIndex({ ...branch, sort: shape.sort })))
+        .join(' ; '));
+    }
+
+    missing.push({
+      collection: entry.collection,
+      model: entry.model,
+      op: entry.op,
+      shape: entry.key,
+      count: entry.count,
+      avgMs: Math.round(entry.totalMs / entry.count),
+      maxMs: entry.maxMs,
+      coverage,
+      recommendedIndex: recommendedIndex && Object.fromEntries(recommendedIndex),
+      createIndex: recommendedIndex && `db.${entry.collection}.createIndex(${formatKey(recommendedIndex)})`,
+      notes
+    });
+  }
+
+  missing.sort((a, b) => (b.maxMs * b.count) - (a.maxMs * a.count));
+
+  const redundant = [];
+  const unused = [];
+  for (const [collection, info] of Object.entries(collections)) {
+    for (const item of findRedundantIndexes(info.indexes)) {
+      redundant.push({ collection, ...item, sizeBytes: info.indexSizes?.[item.index] });
+    }
+    for (const item of findUnusedIndexes(info.indexes, info.stats || [], { now, minObservationMs })) {
+      unused.push({
+        collection,
+        ...item,
+        sizeBytes: info.indexSizes?.[item.index],
+        writesObserved: writesByCollection[collection] || 0
+      });
+    }
+  }
+  unused.sort((a, b) => b.writesObserved - a.writesObserved);
+
+  return { missing, redundant, unused };
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+class IndexAdvisorService {
+  constructor() {
+    this.shapes = new Map();
+    this.writes = new Map();
+    this.droppedShapes = 0;
+    this.queries = 0;
+    this.since = new Date();
+    this.installed = false;
+    this.enabled = process.env.INDEX_ADVISOR_ENABLED !== 'false';
+    this.sampleRate = parseFloat(process.env.INDEX_ADVISOR_SAMPLE_RATE || '1');
+  }
+
+  /**
+   * Register the query-shape plugin on every schema compiled afterwards
+   */
+  install(mongooseInstance = mongoose) {
+    if (this.installed || !this.enabled) return;
+    mongooseInstance.plugin(schema => this.plugin(schema));
+    this.installed = true;
+  }
+
+  /**
+   * Query / aggregate / write hooks for one schema
+   */
+  plugin(schema) {
+    const advisor = this;
+
+    schema.pre(QUERY_OPS, function() {
+      if (Math.random() < advisor.sampleRate) this._advisorStart = Date.now();
+    });
+    schema.post(QUERY_OPS, function() {
+      if (this._advisorStart === undefined) return;
+      const options = this.getOptions();
+      advisor.record({
+        model: this.model?.modelName,
+        collection: this.model?.collection?.collectionName,
+        op: this.op,
+        shape: describeQuery({
+          filter: this.getFilter(),
+          sort: options.sort,
+          projection: this.projection(),
+          skip: options.skip
+        }),
+        durationMs: Date.now() - this._advisorStart,
+        write: WRITE_OPS.has(this.op)
+      });
+    });
+
+    schema.pre('aggregate', function() {
+      if (Math.random() < advisor.sampleRate) this._advisorStart = Date.now();
+    });
+    schema.post('aggregate', function() {
+      if (this._advisorStart === undefined) return;
+      advisor.record({
+        model: this._model?.modelName,
+        collection: this._model?.collection?.collectionName,
+        op: 'aggregate',
+        shape: describePipeline(this.pipeline()),
+        durationMs: Date.now() - this._advisorStart
+      });
+    });
+
+    schema.post('save', function() {
+      if (this.$isSubdocument) return;
+      advisor.countWrite(this.constructor?.collection?.collectionName, 1);
+    });
+    schema.post('insertMany', function(docs) {
+      advisor.countWrite(this.collection?.collectionName, Array.isArray(docs) ? docs.length : 1);
+    });
+  }
+
+  countWrite(collection, n) {
+    if (!collection) return;
+    this.writes.set(collection, (this.writes.get(collection) || 0) + n);
+  }
+
+  record({ model, collection, op, shape, durationMs, write }) {
+    if (!collection) return;
+    this.queries++;
+    if (write) this.countWrite(collection, 1);
+
+    const key = `${collection} ${shapeKey(op, shape)}`;
+    let entry = this.shapes.get(key);
+    if (!entry) {
+      if (this.shapes.size >= MAX_SHAPES) {
+        this.droppedShapes++;
+        return;
+      }
+      entry = {
+        key: shapeKey(op, shape),
+        model,
+        collection,
+        op,
+        shape,
+        count: 0,
+        totalMs: 0,
+        maxMs: 0,
+        maxSkip: 0,
+        firstSeen: new Date()
+      };
+      this.shapes.set(key, entry);
+    }
+
+    entry.count++;
+    entry.totalMs += durationMs;
+    entry.maxMs = Math.max(entry.maxMs, durationMs);
+    entry.maxSkip = Math.max(entry.maxSkip, shape.skip || 0);
+    entry.lastSeen = new Date();
+  }
+
+  /**
+   * Index definitions, $indexStats and index sizes for a collection
+   */
+  async _collectionInfo(db, name) {
+    const collection = db.collection(name);
+    const [indexes, stats, storage] = await Promise.all([
+      collection.indexes(),
+      collection.aggregate([{ $indexStats: {} }]).toArray(),
+      collection.aggregate([{ $collStats: { storageStats: {} } }]).toArray().catch(() => [])
+    ]);
+    return { indexes, stats, indexSizes: storage[0]?.storageStats?.indexSizes };
+  }
+
+  /**
+   * Full advice report
+   * @param {Object} options - { collections, slowMs, minObservationMs, top }
+   */
+  async getReport(options = {}) {
+    const db = options.db || mongoose.connection.db;
+    if (!db) throw new Error('Database not connected');
+
+    const names = options.collections || [...new Set(
+      mongoose.modelNames().map(name => mongoose.model(name).collection.collectionName)
+    )];
+
+    const collections = {};
+    for (const name of names) {
+      try {
+        collections[name] = await this._collectionInfo(db, name);
+      } catch (error) {
+        // Collection not created yet (no documents, no indexes)
+        if (error.codeName !== 'NamespaceNotFound') {
+          log.warn('Index info unavailable', { collection: name, error: error.message });
+        }
+      }
+    }
+
+    const shapes = [...this.shapes.values()];
+    const advice = buildAdvice(shapes, collections, {
+      now: new Date(),
+      slowMs: options.slowMs,
+      minObservationMs: options.minObservationMs,
+      writesByCollection: Object.fromEntries(this.writes)
+    });
+
+    return {
+      generatedAt: new Date(),
+      observingSince: this.since,
+      totals: {
+        queries: this.queries,
+        shapes: this.shapes.size,
+        droppedShapes: this.droppedShapes,
+        collections: Object.keys(collections).length
+      },
+      ...advice,
+      topShapes: shapes
+        .sort((a, b) => b.totalMs - a.totalMs)
+        .slice(0, options.top || 20)
+        .map(({ collection, op, key, count, totalMs, maxMs }) => ({
+          collection, op, shape: key, count, avgMs: Math.round(totalMs / count), maxMs
+        }))
+    };
+  }
+
+  getStatus() {
+    return {
+      enabled: this.enabled,
+      installed: this.installed,
+      sampleRate: this.sampleRate,
+      observingSince: this.since,
+      queries: this.queries,
+      shapes: this.shapes.size,
+      droppedShapes: this.droppedShapes
+    };
+  }
+
+  reset() {
+    this.shapes.clear();
+    this.writes.clear();
+    this.droppedShapes = 0;
+    this.queries = 0;
+    this.since = new Date();
+  }
+}
+
+module.exports = new IndexAdvisorService();
+module.exports.IndexAdvisorService = IndexAdvisorService;
+module.exports.describeQuery = describeQuery;
+module.exports.describePipeline = describePipeline;
+module.exports.shapeKey = shapeKey;
+module.exports.recommendIndex = recommendIndex;
+module.exports.indexCoverage = indexCoverage;
+module.exports.bestCoverage = bestCoverage;
+module.exports.findRedundantIndexes = findRedundantIndexes;
+module.exports.findUnusedIndexes = findUnusedIndexes;
+module.exports.buildAdvice = buildAdvice;
@@ -374,19 +374,10 @@ function evaluateAutoVerification(testCode, value, previousResult = null, patien
  */
 async function getPreviousResult(patientId, testCode, daysBack = 7) {
   try {
-    const cutoffDate = new Date();
-    cutoffDate.setDate(cutoffDate.getDate() - daysBack);
-
-    const previousResult = await LabResult.findOne({
-      patient: patientId,
-      testCode: testCode,
-      collectionDate: { $gte: cutoffDate },
-      status: { $in: ['verified', 'auto_verified'] }
-    })
-      .sort({ collectionDate: -1 })
-      .lean();
-
-    return previousResult;
+    // Lazy require: labHistoryService reads AUTO_VERIFY_RULES from this module
+    const labHistoryService = require('./labHistoryService');
+    const previous = await labHistoryService.getPreviousValues(patientId, [testCode], { withinDays: daysBack });
+    return previous.get(testCode) || null;
   } catch (error) {
     log.error('Error getting previous result:', { error: error });
     return null;
@@ -402,9 +393,20 @@ async function getPreviousResult(patientId, testCode, daysBack = 7) {
 async function processAutoVerification(labResult, patientContext = {}) {
   try {
     const results = [];
+    const tests = labResult.tests || [labResult];
+
+    // Previous values for every test in one history lookup
+    let previousValues = new Map();
+    try {
+      const labHistoryService = require('./labHistoryService');
+      const codes = tests.map(test => test.testCode || test.code).filter(Boolean);
+      previousValues = await labHistoryService.getPreviousValues(labResult.patient, codes, { withinDays: 7 });
+    } catch (error) {
+      log.error('Error getting previous results:', { error: error });
+    }
 
     // Process each test in the result
-    for (const test of labResult.tests || [labResult]) {
+    for (const test of tests) {
       const testCode = test.testCode || test.code;
       const value = parseFloat(test.value);
 
@@ -417,12 +419,8 @@ async function processAutoVerification(labResult, patientContext = {}) {
         continue;
       }
 
-      // Get previous result for delta check
-      const previousResult = await getPreviousResult(
-        labResult.patient,
-        testCode,
-        7
-      );
+      // Previous result for delta check
+      const previousResult = previousValues.get(testCode) || null;
 
       // Evaluate auto-verification
       const evaluation = evaluateAutoVerification(
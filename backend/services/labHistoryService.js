@@ -0,0 +1,545 @@
+/**
+ * Lab History Service
+ * Per-patient, per-analyte result history for delta checks and cumulative reports.
+ *
+ * Features:
+ * - Compact analyte series (LabAnalyteHistory) updated when results are
+ *   verified, corrected or cancelled (LabResult post-save hook)
+ * - Delta check, rate-of-change and trend for every component of a panel in one pass
+ * - Cumulative report (all tests, all dates) from a single query
+ * - Lazy backfill from LabResult for patients without history yet
+ */
+
+const LabAnalyteHistory = require('../models/LabAnalyteHistory');
+const LabResult = require('../models/LabResult');
+const LabHistoryBackfill = require('../models/LabHistoryBackfill');
+const { AUTO_VERIFY_RULES } = require('./labAutoVerificationService');
+
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('LabHistory');
+
+// Result statuses that count as reportable history
+const HISTORY_STATUSES = ['final', 'corrected', 'amended'];
+
+// Values kept per analyte (years of routine monitoring)
+const MAX_POINTS = 250;
+
+// Delta check only compares against a previous value this recent
+const DELTA_WINDOW_DAYS = 7;
+
+// Rate of change: regression over this window, needs at least RATE_MIN_POINTS values
+const RATE_WINDOW_DAYS = 90;
+const RATE_MIN_POINTS = 3;
+
+// Same threshold calculateDelta has always used for "significant" changes
+const DEFAULT_DELTA_LIMIT = { percent: 20, absoluteChange: null };
+
+const DAY_MS = 24 * 60 * 60 * 1000;
+
+// ============================================
+// KEYS & POINTS
+// ============================================
+
+function normalize(value) {
+  return String(value || '').trim().toLowerCase().replace(/\s+/g, '_');
+}
+
+// Test codes are stored and grouped upper-cased: 'bmp ' and 'BMP' are one test
+function normalizeTestCode(testCode) {
+  return String(testCode || '').trim().toUpperCase();
+}
+
+function analyteKey(testCode, parameter) {
+  return `${normalize(testCode)}:${normalize(parameter)}`;
+}
+
+function numericOf(component) {
+  if (component.numericValue !== undefined && component.numericValue !== null) {
+    return component.numericValue;
+  }
+  const parsed = parseFloat(component.value);
+  return Number.isNaN(parsed) ? null : parsed;
+}
+
+function round(value, decimals = 2) {
+  const factor = 10 ** decimals;
+  return Math.round(value * factor) / factor;
+}
+
+/**
+ * Look up the delta-check limits for an analyte (by parameter, then test code)
+ */
+function deltaLimitFor(parameter, testCode) {
+  const rule = AUTO_VERIFY_RULES[normalize(parameter).replace(/_/g, '')] ||
+    AUTO_VERIFY_RULES[normalize(parameter)] ||
+    AUTO_VERIFY_RULES[normalize(testCode)];
+  return rule?.deltaCheck || DEFAULT_DELTA_LIMIT;
+}
+
+/**
+ * Extract history points from a lab result, one per component
+ */
+function buildPoints(labResult) {
+  const testCode = normalizeTestCode(labResult.test?.testCode || labResult.test?.testName);
+  const at = labResult.performedAt || labResult.verifiedAt || labResult.createdAt || new Date();
+
+  return (labResult.results || []).map((component, index) => ({
+    analyteKey: analyteKey(testCode, component.parameter),
+    parameterKey: normalize(component.parameter),
+    testCode,
+    testName: labResult.test?.testName,
+    category: labResult.test?.category,
+    parameter: component.parameter,
+    componentIndex: index,
+    unit: component.unit,
+    point: {
+      result: labResult._id,
+      resultId: labResult.resultId,
+      at: new Date(at),
+      value: numericOf(component),
+      textValue: component.textValue || (numericOf(component) === null && component.value !== undefined
+        ? String(component.value)
+        : undefined),
+      unit: component.unit,
+      referenceRange: component.referenceRange
+        ? { low: component.referenceRange.low, high: component.referenceRange.high, text: component.referenceRange.text }
+        : undefined,
+      flag: component.flag,
+      status: labResult.status
+    }
+  }));
+}
+
+/**
+ * Build history documents for a patient from their results (backfill)
+ */
+function buildHistoryDocuments(patientId, results) {
+  const docs = new Map();
+
+  for (const result of results) {
+    if (!HISTORY_STATUSES.includes(result.status)) continue;
+    for (const entry of buildPoints(result)) {
+      let doc = docs.get(entry.analyteKey);
+      if (!doc) {
+        doc = {
+          patient: patientId,
+          analyteKey: entry.analyteKey,
+          parameterKey: entry.parameterKey,
+          testCode: entry.testCode,
+          testName: entry.testName,
+          category: entry.category,
+          parameter: entry.parameter,
+          componentIndex: entry.componentIndex,
+          unit: entry.unit,
+          points: []
+        };
+        docs.set(entry.analyteKey, doc);
+      }
+      doc.points.push(entry.point);
+    }
+  }
+
+  for (const doc of docs.values()) {
+    doc.points.sort((a, b) => a.at - b.at);
+    doc.points = doc.points.slice(-MAX_POINTS);
+    const last = doc.points[doc.points.length - 1];
+    doc.lastAt = last?.at;
+    if (last?.unit) doc.unit = last.unit;
+  }
+
+  return [...docs.values()];
+}
+
+// ============================================
+// DELTA / RATE EVALUATION (pure)
+// ============================================
+
+/**
+ * Least-squares slope of value over time, in units per day
+ */
+function slopePerDay(points) {
+  const t0 = points[0].at.getTime();
+  const xs = points.map(p => (p.at.getTime() - t0) / DAY_MS);
+  const ys = points.map(p => p.value);
+  const n = points.length;
+  const meanX = xs.reduce((a, b) => a + b, 0) / n;
+  const meanY = ys.reduce((a, b) => a + b, 0) / n;
+
+  let num = 0;
+  let den = 0;
+  for (let i = 0; i < n; i++) {
+    num += (xs[i] - meanX) * (ys[i] - meanY);
+    den += (xs[i] - meanX) ** 2;
+  }
+  return { slope: den === 0 ? 0 : num / den, mean: meanY };
+}
+
+/**
+ * Evaluate one component against its history
+ * @param {Object} current - { parameter, testCode, value, unit, at, resultId }
+ * @param {Object|null} history - LabAnalyteHistory (lean)
+ */
+function evaluateComponent(current, history) {
+  const evaluation = {
+    parameter: current.parameter,
+    analyteKey: analyteKey(current.testCode, current.parameter),
+    value: current.value,
+    unit: current.unit,
+    hasPrevious: false,
+    flags: []
+  };
+
+  if (current.value === null || current.value === undefined || Number.isNaN(current.value)) {
+    evaluation.reason = 'Current result not numeric';
+    return evaluation;
+  }
+
+  const at = current.at ? new Date(current.at) : new Date();
+  const currentId = current.result ? String(current.result) : null;
+  const prior = (history?.points || [])
+    .filter(p => p.value !== null && p.value !== undefined &&
+      new Date(p.at) <= at && (!currentId || String(p.result) !== currentId))
+    .map(p => ({ ...p, at: new Date(p.at) }));
+
+  const previous = prior[prior.length - 1];
+  if (!previous) {
+    evaluation.reason = 'No previous result found for comparison';
+    return evaluation;
+  }
+
+  if (previous.unit && current.unit && normalize(previous.unit) !== normalize(current.unit)) {
+    evaluation.unitChanged = true;
+    evaluation.flags.push('UNIT_CHANGED');
+    evaluation.reason = `Unit changed (${previous.unit} → ${current.unit})`;
+    return evaluation;
+  }
+
+  const limit = deltaLimitFor(current.parameter, current.testCode);
+  const change = current.value - previous.value;
+  const changePercent = previous.value !== 0 ? (change / previous.value) * 100 : (change !== 0 ? 100 : 0);
+  const hoursSince = (at.getTime() - previous.at.getTime()) / (60 * 60 * 1000);
+
+  Object.assign(evaluation, {
+    hasPrevious: true,
+    previousValue: previous.value,
+    previousAt: previous.at,
+    previousResultId: previous.resultId,
+    previousFlag: previous.flag,
+    change: round(change),
+    changePercent: round(changePercent, 1),
+    hoursSince: round(hoursSince, 1),
+    trend: change > 0 ? 'increasing' : change < 0 ? 'decreasing' : 'stable',
+    limit,
+    isSignificant: Math.abs(changePercent) > limit.percent
+  });
+
+  // Delta check: recent previous value, change beyond the analyte's limits
+  if (hoursSince <= DELTA_WINDOW_DAYS * 24) {
+    const exceedsAbsolute = limit.absoluteChange !== null && limit.absoluteChange !== undefined &&
+      Math.abs(change) > limit.absoluteChange;
+    if (exceedsAbsolute || Math.abs(changePercent) > limit.percent) {
+      evaluation.deltaFlag = true;
+      evaluation.flags.push('DELTA_CHECK_FAILED');
+    }
+  }
+
+  // Rate of change: sustained slope over the window, as % of mean per 30 days
+  const windowStart = at.getTime() - RATE_WINDOW_DAYS * DAY_MS;
+  const series = prior.filter(p => p.at.getTime() >= windowStart)
+    .concat([{ at, value: current.value }]);
+  if (series.length >= RATE_MIN_POINTS && series[series.length - 1].at > series[0].at) {
+    const { slope, mean } = slopePerDay(series);
+    evaluation.ratePerDay = round(slope, 4);
+    if (mean !== 0) {
+      evaluation.ratePercentPer30Days = round((slope * 30 / Math.abs(mean)) * 100, 1);
+      if (Math.abs(evaluation.ratePercentPer30Days) > limit.percent) {
+        evaluation.rateFlag = true;
+        evaluation.flags.push('RATE_OF_CHANGE');
+      }
+    }
+  }
+
+  return evaluation;
+}
+
+/**
+ * Evaluate every numeric component of a panel in one pass
+ * @param {Object} labResult - LabResult-shaped object (test, results, performedAt)
+ * @param {Map} historiesByKey - analyteKey -> LabAnalyteHistory
+ */
+function evaluatePanel(labResult, historiesByKey) {
+  const testCode = normalizeTestCode(labResult.test?.testCode || labResult.test?.testName);
+  const at = labResult.performedAt || new Date();
+
+  const components = (labResult.results || []).map(component => evaluateComponent({
+    parameter: component.parameter,
+    testCode,
+    value: numericOf(component),
+    unit: component.unit,
+    at,
+    result: labResult._id
+  }, historiesByKey.get(analyteKey(testCode, component.parameter))));
+
+  return {
+    resultId: labResult.resultId,
+    testCode,
+    components,
+    deltaFlags: components.filter(c => c.deltaFlag).map(c => c.parameter),
+    rateFlags: components.filter(c => c.rateFlag).map(c => c.parameter),
+    requiresReview: components.some(c => c.deltaFlag || c.rateFlag || c.unitChanged)
+  };
+}
+
+/**
+ * Cumulative report: per test, one column per result date and one row per analyte
+ */
+function buildCumulativeReport(histories, { from, to } = {}) {
+  const fromTime = from ? new Date(from).getTime() : -Infinity;
+  const toTime = to ? new Date(to).getTime() : Infinity;
+  const tests = new Map();
+
+  for (const history of histories) {
+    const testKey = normalizeTestCode(history.testCode);
+    if (!tests.has(testKey)) {
+      tests.set(testKey, { testCode: testKey, testName: history.testName, category: history.category, analytes: [] });
+    }
+    tests.get(testKey).analytes.push(history);
+  }
+
+  const report = [];
+  for (const test of tests.values()) {
+    const columnsById = new Map();
+    for (const history of test.analytes) {
+      for (const point of history.points || []) {
+        const time = new Date(point.at).getTime();
+        if (time < fromTime || time > toTime) continue;
+        const id = String(point.result);
+        if (!columnsById.has(id)) columnsById.set(id, { result: point.result, resultId: point.resultId, at: new Date(point.at) });
+      }
+    }
+    const columns = [...columnsById.values()].sort((a, b) => a.at - b.at);
+    if (columns.length === 0) continue;
+    const indexById = new Map(columns.map((c, i) => [String(c.result), i]));
+
+    const rows = test.analytes
+      .sort((a, b) => (a.componentIndex || 0) - (b.componentIndex || 0))
+      .map(history => {
+        const cells = new Array(columns.length).fill(null);
+        let latestRange = null;
+        for (const point of history.points || []) {
+          const index = indexById.get(String(point.result));
+          if (index === undefined) continue;
+          cells[index] = { value: point.value ?? point.textValue, flag: point.flag };
+          if (point.referenceRange) latestRange = point.referenceRange;
+        }
+        return { parameter: history.parameter, unit: history.unit, referenceRange: latestRange, cells };
+      });
+
+    report.push({
+      testCode: test.testCode,
+      testName: test.testName,
+      category: test.category,
+      columns,
+      rows
+    });
+  }
+
+  return report.sort((a, b) => String(a.category || '').localeCompare(String(b.category || '')) ||
+    String(a.testName || '').localeCompare(String(b.testName || '')));
+}
+
+// ============================================
+// PERSISTENCE
+// ============================================
+
+/**
+ * Apply a result's current state to the history (verify, correct, amend, cancel)
+ */
+async function recordResult(labResult) {
+  const patientId = labResult.patient?._id || labResult.patient;
+  const pull = {
+    updateMany: {
+      filter: { patient: patientId, 'points.result': labResult._id },
+      update: { $pull: { points: { result: labResult._id } } }
+    }
+  };
+
+  if (!HISTORY_STATUSES.includes(labResult.status) || labResult.isDeleted) {
+    await LabAnalyteHistory.bulkWrite([pull]);
+    return { removed: true };
+  }
+
+  const operations = [pull];
+  for (const entry of buildPoints(labResult)) {
+    operations.push({
+      updateOne: {
+        filter: { patient: patientId, analyteKey: entry.analyteKey },
+        update: {
+          $set: {
+            parameterKey: entry.parameterKey,
+            testCode: entry.testCode,
+            testName: entry.testName,
+            category: entry.category,
+            parameter: entry.parameter,
+            componentIndex: entry.componentIndex,
+            ...(entry.unit && { unit: entry.unit })
+          },
+          $push: { points: { $each: [entry.point], $sort: { at: 1 }, $slice: -MAX_POINTS } },
+          $max: { lastAt: entry.point.at }
+        },
+        upsert: true
+      }
+    });
+  }
+
+  // Ordered: the pull must land before the re-push of a corrected result
+  await LabAnalyteHistory.bulkWrite(operations, { ordered: true });
+  return { components: operations.length - 1 };
+}
+
+/**
+ * Rebuild a patient's history from LabResult (backfill / repair)
+ */
+async function rebuildPatientHistory(patientId) {
+  const results = await LabResult.find({
+    patient: patientId,
+    status: { $in: HISTORY_STATUSES }
+  })
+    .select('resultId test results performedAt verifiedAt createdAt status')
+    .lean();
+
+  const docs = buildHistoryDocuments(patientId, results);
+  // Upserts, not delete + insert: concurrent rebuilds converge on the same
+  // documents and readers never see the patient without history
+  if (docs.length) {
+    await LabAnalyteHistory.bulkWrite(docs.map(doc => ({
+      replaceOne: {
+        filter: { patient: patientId, analyteKey: doc.analyteKey },
+        replacement: doc,
+        upsert: true
+      }
+    })), { ordered: false });
+  }
+  await LabAnalyteHistory.deleteMany({ patient: patientId, analyteKey: { $nin: docs.map(doc => doc.analyteKey) } });
+
+  log.info('Lab history rebuilt', { patientId: String(patientId), results: results.length, analytes: docs.length });
+  return { results: results.length, analytes: docs.length };
+}
+
+/**
+ * Backfill on first use for patients whose results predate the history.
+ * Keyed on a per-patient marker (LabHistoryBackfill): the first result verified
+ * after deploy already creates history documents, which says nothing about older results.
+ */
+async function ensureHistory(patientId) {
+  if (await LabHistoryBackfill.exists({ patient: patientId })) return;
+
+  const backfilledAt = new Date();
+  let rebuilt = { results: 0, analytes: 0 };
+  if (await LabResult.exists({ patient: patientId, status: { $in: HISTORY_STATUSES } })) {
+    rebuilt = await rebuildPatientHistory(patientId);
+  }
+  // $setOnInsert: a concurrent backfill of the same patient keeps the first marker
+  await LabHistoryBackfill.updateOne(
+    { patient: patientId },
+    { $setOnInsert: { backfilledAt, ...rebuilt } },
+    { upsert: true }
+  );
+}
+
+async function loadHistories(patientId, { testCodes, analyteKeys, parameterKeys } = {}) {
+  await ensureHistory(patientId);
+
+  const query = { patient: patientId };
+  const or = [];
+  if (testCodes?.length) or.push({ testCode: { $in: testCodes.map(normalizeTestCode) } });
+  if (analyteKeys?.length) or.push({ analyteKey: { $in: analyteKeys } });
+  if (parameterKeys?.length) or.push({ parameterKey: { $in: parameterKeys } });
+  if (or.length) query.$or = or;
+
+  return LabAnalyteHistory.find(query).lean();
+}
+
+/**
+ * Delta / rate-of-change evaluation for every component of a result
+ */
+async function getPanelDeltas(labResult) {
+  const testCode = normalizeTestCode(labResult.test?.testCode || labResult.test?.testName);
+  const keys = (labResult.results || []).map(c => analyteKey(testCode, c.parameter));
+  const histories = await loadHistories(labResult.patient?._id || labResult.patient, { analyteKeys: keys });
+  return evaluatePanel(labResult, new Map(histories.map(h => [h.analyteKey, h])));
+}
+
+/**
+ * Most recent value per analyte name within a window, for auto-verification
+ * @param {String} patientId
+ * @param {String[]} codes - Analyte names or test codes (e.g. 'glucose')
+ * @returns {Map} code (as given) -> { value, at, unit, resultId }
+ */
+async function getPreviousValues(patientId, codes, { withinDays = DELTA_WINDOW_DAYS, before = new Date() } = {}) {
+  const codesByKey = new Map(codes.map(code => [normalize(code), code]));
+  const keys = [...codesByKey.keys()];
+  const histories = await loadHistories(patientId, { parameterKeys: keys, testCodes: codes });
+  const cutoff = before.getTime() - withinDays * DAY_MS;
+
+  const latest = new Map();
+  for (const history of histories) {
+    for (const key of [history.parameterKey, normalize(history.testCode)]) {
+      if (!codesByKey.has(key)) continue;
+      const code = codesByKey.get(key);
+      for (const point of history.points || []) {
+        const time = new Date(point.at).getTime();
+        if (point.value === null || point.value === undefined || time < cutoff || time > before.getTime()) continue;
+        if (!latest.has(code) || latest.get(code).at < new Date(point.at)) {
+          latest.set(code, { value: point.value, at: new Date(point.at), unit: point.unit, resultId: point.resultId });
+        }
+      }
+    }
+  }
+  return latest;
+}
+
+async function getCumulativeReport(patientId, { testCodes, from, to } = {}) {
+  const histories = await loadHistories(patientId, { testCodes });
+  return buildCumulativeReport(histories, { from, to });
+}
+
+/**
+ * History of one analyte (primary component of the test when no parameter given)
+ */
+async function getAnalyteSeries(patientId, testCode, parameter) {
+  await ensureHistory(patientId);
+  if (parameter) {
+    return LabAnalyteHistory.findOne({ patient: patientId, analyteKey: analyteKey(testCode, parameter) }).lean();
+  }
+  return LabAnalyteHistory.findOne({ patient: patientId, testCode: normalizeTestCode(testCode) })
+    .sort({ componentIndex: 1 })
+    .lean();
+}
+
+module.exports = {
+  // Persistence
+  recordResult,
+  rebuildPatientHistory,
+  ensureHistory,
+  loadHistories,
+
+  // Queries
+  getPanelDeltas,
+  getPreviousValues,
+  getCumulativeReport,
+  getAnalyteSeries,
+
+  // Pure helpers
+  analyteKey,
+  normalizeTestCode,
+  buildPoints,
+  buildHistoryDocuments,
+  evaluateComponent,
+  evaluatePanel,
+  buildCumulativeReport,
+
+  HISTORY_STATUSES,
+  MAX_POINTS,
+  DELTA_WINDOW_DAYS
+};
@@ -0,0 +1,421 @@
+/**
+ * Label Print Spooler
+ * Sends ZPL from labelPrintingService to networked Zebra-compatible
+ * printers over raw TCP (port 9100), so lab tubes and shelf labels come
+ * out of the printer next to the bench instead of going through the
+ * browser print dialog one label at a time.
+ *
+ * Features:
+ * - One queue per printer: a jam at the pharmacy does not hold the lab
+ * - Batch jobs: every label of a lab order or stock receipt is one ZPL
+ *   stream on one connection, copies via ^PQ
+ * - ~HS host status before printing: paper out, paused, head open or
+ *   ribbon out hold the job instead of sending into a printer that drops it
+ * - Offline printers: the job stays at the head of its queue and is
+ *   retried with backoff; a status poll releases it as soon as the printer
+ *   answers again; jobs older than LABEL_JOB_TTL_MINUTES fail
+ *
+ * Queues are in memory: jobs still queued at shutdown are logged and lost.
+ *
+ * Configuration (environment):
+ * - LABEL_PRINTERS: name=host[:port] list, e.g. "lab=10.0.0.21,stock=10.0.0.22:9100"
+ *   (a job goes to the printer named after its kind, else "default", else the first)
+ * - LABEL_PRINTER_TIMEOUT_MS: connect / write timeout (default 5000)
+ * - LABEL_PRINTER_RETRY_SECONDS: first retry delay, doubled up to 60 s (default 5)
+ * - LABEL_PRINTER_POLL_SECONDS: status poll interval (default 60, 0 disables)
+ * - LABEL_PRINTER_STATUS_QUERY: set to false for printers without ~HS
+ * - LABEL_JOB_TTL_MINUTES: give up on a job after this long (default 30)
+ */
+
+const net = require('net');
+const crypto = require('crypto');
+const EventEmitter = require('events');
+
+const { generateBatchZPL } = require('./labelPrintingService');
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('LabelSpooler');
+
+// ============================================
+// CONFIGURATION
+// ============================================
+
+const DEFAULT_PORT = 9100;
+
+function parsePrinters(value = '') {
+  const printers = [];
+  for (const entry of value.split(',').map(part => part.trim()).filter(Boolean)) {
+    const [name, address] = entry.includes('=') ? entry.split('=') : ['default', entry];
+    const [host, port] = address.trim().split(':');
+    if (!host) continue;
+    printers.push({ name: name.trim(), host, port: parseInt(port, 10) || DEFAULT_PORT });
+  }
+  return printers;
+}
+
+function loadSettings(env = process.env) {
+  const number = (value, fallback) => {
+    const parsed = parseFloat(value);
+    return Number.isFinite(parsed) && parsed >= 0 ? parsed : fallback;
+  };
+  return {
+    printers: parsePrinters(env.LABEL_PRINTERS),
+    timeoutMs: number(env.LABEL_PRINTER_TIMEOUT_MS, 5000),
+    // ~HS answer is immediate on a ready printer; do not wait the full timeout
+    statusTimeoutMs: 1500,
+    statusQuery: env.LABEL_PRINTER_STATUS_QUERY !== 'false',
+    retryMinMs: number(env.LABEL_PRINTER_RETRY_SECONDS, 5) * 1000,
+    retryMaxMs: 60 * 1000,
+    pollIntervalMs: number(env.LABEL_PRINTER_POLL_SECONDS, 60) * 1000,
+    jobTtlMs: number(env.LABEL_JOB_TTL_MINUTES, 30) * 60 * 1000,
+    // Finished jobs kept for GET /api/labels/jobs/:id
+    historySize: 500
+  };
+}
+
+// ============================================
+// HOST STATUS (exported for tests)
+// ============================================
+
+/**
+ * Parse the ~HS answer: three <STX>...<ETX><CR><LF> strings of
+ * comma-separated fields. Only the fields that stop a print are read.
+ * @param {String} text - Raw answer
+ * @returns {Object|null} Status, null when incomplete
+ */
+function parseHostStatus(text) {
+  const strings = [...text.matchAll(/\x02([^\x03]*)\x03/g)].map(match => match[1].split(','));
+  if (strings.length < 2) return null;
+
+  const [first, second] = strings;
+  const flag = (value) => value === '1';
+  const status = {
+    paperOut: flag(first[1]),
+    paused: flag(first[2]),
+    formatsInBuffer: parseInt(first[4], 10) || 0,
+    bufferFull: flag(first[5]),
+    headUp: flag(second[2]),
+    ribbonOut: flag(second[3]),
+    labelsRemaining: parseInt(second[8], 10) || 0
+  };
+  status.problems = ['paperOut', 'paused', 'headUp', 'ribbonOut', 'bufferFull'].filter(key => status[key]);
+  status.ready = status.problems.length === 0;
+  return status;
+}
+
+function notReadyError(status) {
+  const error = new Error(`Printer not ready: ${status.problems.join(', ')}`);
+  error.notReady = true;
+  return error;
+}
+
+// ============================================
+// SPOOLER
+// ============================================
+
+class LabelPrintSpooler extends EventEmitter {
+  constructor(settings = loadSettings()) {
+    super();
+    this.settings = settings;
+    this.queues = new Map();
+    for (const printer of settings.printers) {
+      this.queues.set(printer.name, {
+        ...printer,
+        jobs: [],
+        busy: false,
+        state: 'unknown',
+        lastStatus: null,
+        lastError: null,
+        retryDelayMs: settings.retryMinMs,
+        retryTimer: null,
+        retryAt: null
+      });
+    }
+    this.jobs = new Map();
+    this.history = [];
+    this.pollTimer = null;
+    this.counters = { jobs: 0, printed: 0, labels: 0, failed: 0, cancelled: 0, retries: 0, held: 0 };
+  }
+
+  get enabled() {
+    return this.queues.size > 0;
+  }
+
+  start() {
+    if (!this.enabled || this.pollTimer) return;
+    if (this.settings.pollIntervalMs > 0) {
+      this.pollTimer = setInterval(() => this.pollStatus(), this.settings.pollIntervalMs);
+      this.pollTimer.unref();
+    }
+    log.info('Label print spooler started', {
+      printers: [...this.queues.values()].map(queue => `${queue.name}=${queue.host}:${queue.port}`)
+    });
+  }
+
+  stop() {
+    clearInterval(this.pollTimer);
+    this.pollTimer = null;
+    let pending = 0;
+    for (const queue of this.queues.values()) {
+      clearTimeout(queue.retryTimer);
+      queue.retryTimer = null;
+      pending += queue.jobs.length;
+    }
+    if (pending > 0) log.warn('Label jobs still queued at shutdown', { pending });
+  }
+
+  /**
+   * Printer for a job: the one asked for, else the one named after the
+   * job kind, else "default", else the first configured.
+   */
+  resolvePrinter(name, kind) {
+    return this.queues.get(name) || this.queues.get(kind) || this.queues.get('default') ||
+      this.queues.values().next().value || null;
+  }
+
+  /**
+   * Queue labels as one job
+   * @param {Array} labels - Label data from labelPrintingService
+   * @param {Object} options - printer, kind (lab, stock...), reference (order number...)
+   * @returns {Object} Job
+   */
+  submit(labels, { printer, kind = 'labels', reference = null } = {}) {
+    const queue = this.resolvePrinter(printer, kind);
+    if (!queue) throw new Error('No label printer configured');
+    if (!labels.length) throw new Error('No labels to print');
+
+    const job = {
+      id: crypto.randomUUID(),
+      printer: queue.name,
+      kind,
+      reference,
+      labelCount: labels.reduce((sum, label) => sum + (label.copies || 1), 0),
+      zpl: generateBatchZPL(labels),
+      status: 'queued',
+      attempts: 0,
+      lastError: null,
+      createdAt: new Date(),
+      printedAt: null
+    };
+    queue.jobs.push(job);
+    this.jobs.set(job.id, job);
+    this.counters.jobs++;
+    this.pump(queue);
+    return publicJob(job);
+  }
+
+  getJob(id) {
+    const job = this.jobs.get(id);
+    return job ? publicJob(job) : null;
+  }
+
+  /**
+   * Cancel a queued job (one already being sent cannot be recalled)
+   * @returns {Object} { cancelled, reason }
+   */
+  cancel(id) {
+    const job = this.jobs.get(id);
+    if (!job) return { cancelled: false, reason: 'not-found' };
+    if (job.status === 'printing') return { cancelled: false, reason: 'printing' };
+    if (job.status !== 'queued') return { cancelled: false, reason: job.status };
+
+    const queue = this.queues.get(job.printer);
+    queue.jobs.splice(queue.jobs.indexOf(job), 1);
+    this.finish(job, 'cancelled');
+    return { cancelled: true };
+  }
+
+  finish(job, status, error = null) {
+    job.status = status;
+    if (error) job.lastError = error;
+    if (status === 'printed') {
+      job.printedAt = new Date();
+      this.counters.labels += job.labelCount;
+    }
+    this.counters[status === 'printed' ? 'printed' : status]++;
+    // Keep the outcome, not the payload
+    job.zpl = null;
+    this.history.push(job.id);
+    while (this.history.length > this.settings.historySize) this.jobs.delete(this.history.shift());
+    this.emit(status, publicJob(job));
+  }
+
+  async pump(queue) {
+    if (queue.busy || queue.retryTimer || queue.jobs.length === 0) return;
+    queue.busy = true;
+
+    try {
+      while (queue.jobs.length > 0) {
+        const job = queue.jobs[0];
+        if (Date.now() - job.createdAt.getTime() > this.settings.jobTtlMs) {
+          queue.jobs.shift();
+          log.warn('Label job expired', { jobId: job.id, printer: queue.name, reference: job.reference, lastError: job.lastError });
+          this.finish(job, 'failed', job.lastError || 'Expired in queue');
+          continue;
+        }
+
+        job.status = 'printing';
+        job.attempts++;
+        try {
+          queue.lastStatus = await this.transmit(queue, job.zpl) || queue.lastStatus;
+        } catch (err) {
+          job.status = 'queued';
+          job.lastError = err.message;
+          this.onPrinterError(queue, err);
+          return;
+        }
+
+        queue.jobs.shift();
+        queue.state = 'ready';
+        queue.lastError = null;
+        queue.retryDelayMs = this.settings.retryMinMs;
+        this.finish(job, 'printed');
+        log.debug('Label job printed', { jobId: job.id, printer: queue.name, labels: job.labelCount, attempts: job.attempts });
+      }
+    } finally {
+      queue.busy = false;
+    }
+  }
+
+  onPrinterError(queue, err) {
+    const wasDown = queue.state === 'offline' || queue.state === 'not_ready';
+    queue.state = err.notReady ? 'not_ready' : 'offline';
+    queue.lastError = err.message;
+    this.counters[err.notReady ? 'held' : 'retries']++;
+    if (!wasDown) {
+      log.warn('Label printer unavailable, holding jobs', { printer: queue.name, error: err.message, queued: queue.jobs.length });
+    }
+
+    const delay = queue.retryDelayMs;
+    queue.retryDelayMs = Math.min(delay * 2, this.settings.retryMaxMs);
+    queue.retryAt = Date.now() + delay;
+    queue.retryTimer = setTimeout(() => {
+      queue.retryTimer = null;
+      queue.retryAt = null;
+      this.pump(queue);
+    }, delay);
+    queue.retryTimer.unref();
+  }
+
+  /**
+   * One connection: ~HS, then the ZPL if the printer can print it.
+   * With `zpl` null only the status is read.
+   * @returns {Promise<Object|null>} Host status (null when not answered)
+   */
+  transmit(queue, zpl) {
+    const { timeoutMs, statusTimeoutMs, statusQuery } = this.settings;
+
+    return new Promise((resolve, reject) => {
+      const socket = net.createConnection({ host: queue.host, port: queue.port });
+      let settled = false;
+      let reading = false;
+      let response = '';
+      let statusTimer = null;
+
+      const done = (err, status) => {
+        if (settled) return;
+        settled = true;
+        clearTimeout(statusTimer);
+        if (err) {
+          socket.destroy();
+          reject(err);
+        } else {
+          resolve(status);
+        }
+      };
+
+      const print = (status) => {
+        reading = false;
+        clearTimeout(statusTimer);
+        if (status && !status.ready) {
+          socket.end();
+          return done(notReadyError(status));
+        }
+        if (zpl === null) {
+          socket.end();
+          return done(null, status);
+        }
+        socket.end(zpl, 'latin1', () => done(null, status));
+      };
+
+      socket.setTimeout(timeoutMs, () => {
+        done(new Error(`Printer ${queue.host}:${queue.port} timed out`));
+        socket.destroy();
+      });
+      socket.on('error', err => done(err));
+      socket.on('close', () => done(new Error('Connection closed by printer')));
+      socket.on('data', chunk => {
+        if (!reading) return;
+        response += chunk.toString('latin1');
+        if ((response.match(/\x03/g) || []).length >= 3) print(parseHostStatus(response));
+      });
+
+      socket.on('connect', () => {
+        if (!statusQuery) return print(null);
+        reading = true;
+        socket.write('~HS');
+        // No answer: not every print server relays ~HS, print anyway
+        statusTimer = setTimeout(() => print(parseHostStatus(response)), statusTimeoutMs);
+      });
+    });
+  }
+
+  /**
+   * Refresh printer states; a printer holding jobs that answers ready
+   * again is retried now instead of at the end of its backoff
+   */
+  async pollStatus() {
+    await Promise.all([...this.queues.values()].filter(queue => !queue.busy).map(async (queue) => {
+      try {
+        const status = await this.transmit(queue, null);
+        queue.lastStatus = status || queue.lastStatus;
+        if (status && !status.ready) {
+          queue.state = 'not_ready';
+          queue.lastError = notReadyError(status).message;
+          return;
+        }
+        queue.state = 'ready';
+        queue.lastError = null;
+        if (queue.retryTimer && queue.jobs.length > 0) {
+          clearTimeout(queue.retryTimer);
+          queue.retryTimer = null;
+          queue.retryAt = null;
+          queue.retryDelayMs = this.settings.retryMinMs;
+          this.pump(queue);
+        }
+      } catch (err) {
+        queue.state = 'offline';
+        queue.lastError = err.message;
+      }
+    }));
+  }
+
+  getStatus() {
+    return {
+      enabled: this.enabled,
+      printers: [...this.queues.values()].map(queue => ({
+        name: queue.name,
+        host: queue.host,
+        port: queue.port,
+        state: queue.state,
+        queued: queue.jobs.length,
+        lastStatus: queue.lastStatus,
+        lastError: queue.lastError,
+        retryInMs: queue.retryAt ? Math.max(0, queue.retryAt - Date.now()) : null
+      })),
+      counters: { ...this.counters }
+    };
+  }
+}
+
+function publicJob(job) {
+  const { zpl, ...rest } = job;
+  return rest;
+}
+
+const labelPrintSpooler = new LabelPrintSpooler();
+
+module.exports = labelPrintSpooler;
+module.exports.LabelPrintSpooler = LabelPrintSpooler;
+module.exports.loadSettings = loadSettings;
+module.exports.parsePrinters = parsePrinters;
+module.exports.parseHostStatus = parseHostStatus;
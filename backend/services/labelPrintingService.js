@@ -1,6 +1,7 @@
 /**
  * Label Printing Service
  * Generates labels for pharmacy, laboratory, optical shop, and patient identification
+ * (sent to networked printers by labelPrintSpooler)
  */
 
 /**
@@ -208,6 +209,33 @@ function generateSpecimenLabel(specimen, patient) {
   };
 }
 
+/**
+ * Generate one specimen label per tube of a lab order: tests sharing a
+ * specimen type share a tube. All tubes carry the order's specimen barcode.
+ * @param {Object} order - Lab order (tests, specimen, orderId)
+ * @param {Object} patient - Patient info
+ * @returns {Array} Label data
+ */
+function generateLabOrderTubeLabels(order, patient) {
+  const tubes = new Map();
+  for (const test of order.tests || []) {
+    if (test.status === 'cancelled') continue;
+    const specimenType = test.specimen || order.specimen?.specimenType || 'Sang';
+    if (!tubes.has(specimenType)) tubes.set(specimenType, []);
+    tubes.get(specimenType).push(test.testCode || test.testName);
+  }
+
+  return [...tubes.entries()].map(([specimenType, tests]) => generateSpecimenLabel({
+    accessionNumber: order.specimen?.barcode || order.orderId,
+    specimenType: `${specimenType} - ${tests.join(', ')}`,
+    collectionTime: order.specimen?.collectedAt,
+    tubeCount: 1
+  }, {
+    ...patient,
+    medicalRecordNumber: patient.medicalRecordNumber || patient.patientId
+  }));
+}
+
 /**
  * Generate label data for glasses order
  * @param {Object} order - Glasses order data
@@ -298,13 +326,21 @@ function generateShelfLabel(item) {
     data: {
       itemName: item.name,
       sku: item.sku || item.itemCode,
-      location: item.location || item.binLocation,
+      location: formatLocation(item.location) || item.binLocation,
       barcode: item.sku || item.itemCode
     },
     copies: 1
   };
 }
 
+/**
+ * Inventory location: zone / shelf / bin object or free text
+ */
+function formatLocation(location) {
+  if (!location || typeof location === 'string') return location;
+  return [location.zone, location.shelf, location.bin].filter(Boolean).join('-') || undefined;
+}
+
 /**
  * Generate frame price tag
  * @param {Object} frame - Frame inventory item
@@ -337,6 +373,12 @@ function generateZPL(labelData) {
     throw new Error(`Unknown label template: ${labelData.templateId}`);
   }
 
+  // ^ and ~ start ZPL commands: keep them out of field data
+  const data = {};
+  for (const [key, value] of Object.entries(labelData.data || {})) {
+    data[key] = typeof value === 'string' ? value.replace(/[\^~]/g, ' ') : value;
+  }
+
   let zpl = '^XA\n'; // Start ZPL
 
   // Set label size (assuming 203 DPI)
@@ -348,22 +390,36 @@ function generateZPL(labelData) {
   // Generate content based on template format
   switch (template.format) {
     case 'prescription_standard':
-      zpl += generatePrescriptionZPL(labelData.data, template);
+      zpl += generatePrescriptionZPL(data, template);
       break;
     case 'specimen_standard':
-      zpl += generateSpecimenZPL(labelData.data, template);
+      zpl += generateSpecimenZPL(data, template);
       break;
     case 'wristband_standard':
-      zpl += generateWristbandZPL(labelData.data, template);
+      zpl += generateWristbandZPL(data, template);
       break;
     default:
-      zpl += generateGenericZPL(labelData.data, template);
+      zpl += generateGenericZPL(data, template);
+  }
+
+  // Copies are printed by the printer, not sent N times
+  if (labelData.copies > 1) {
+    zpl += `^PQ${Math.floor(labelData.copies)}\n`;
   }
 
   zpl += '^XZ\n'; // End ZPL
   return zpl;
 }
 
+/**
+ * Generate one ZPL job for many labels (one format per label)
+ * @param {Array} labels - Label data
+ * @returns {String} ZPL code
+ */
+function generateBatchZPL(labels) {
+  return labels.map(generateZPL).join('');
+}
+
 /**
  * Generate prescription ZPL
  */
@@ -518,7 +574,9 @@ module.exports = {
   generateContactLensLabel,
   generateShelfLabel,
   generateFramePriceTag,
+  generateLabOrderTubeLabels,
   generateZPL,
+  generateBatchZPL,
   getLabelTemplates,
   getWarningLabels,
   LABEL_TEMPLATES,
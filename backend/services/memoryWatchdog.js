@@ -0,0 +1,396 @@
+/**
+ * Memory Watchdog
+ *
+ * PM2 restarts the backend at max_memory_restart (500M) and whatever grew is
+ * lost with the process. The watchdog samples process memory and, on
+ * sustained growth toward the limit:
+ * - profile fraction: records a sampling heap profile (V8 HeapProfiler via
+ *   inspector, low overhead) and dumps the sizes of registered caches,
+ *   buffers and queues to MEMORY_DUMP_DIR
+ * - restart fraction: once several consecutive samples are past it, or it is
+ *   reached by sustained growth, writes the same report (plus an optional
+ *   heap snapshot, rate limited across restarts), then drains and restarts
+ *   the process itself before PM2 kills it. A single spike (large upload,
+ *   report export) does not restart.
+ *
+ * RSS is compared with the limit because that is what PM2 measures; heap
+ * used and external/array buffer memory are recorded alongside so a report
+ * shows whether JS objects or Buffers grew.
+ *
+ * Modules holding long-lived structures register a size function:
+ *   memoryWatchdog.register('cache:memory', () => memoryCache.size);
+ * A size function returns an entry count, or { entries, bytes }.
+ *
+ * .heapprofile files open in Chrome DevTools (Memory tab).
+ */
+
+const fs = require('fs').promises;
+const path = require('path');
+const v8 = require('v8');
+const inspector = require('inspector');
+
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('MemoryWatchdog');
+
+const MB = 1024 * 1024;
+
+// Bytes between heap profiler samples (V8 default is 32KB)
+const PROFILE_SAMPLING_INTERVAL = 32 * 1024;
+// Allocation sites listed in reports and logs
+const TOP_SITES = 15;
+// Time allowed for in-flight requests before restarting anyway
+const DRAIN_TIMEOUT_MS = 15000;
+
+// ============================================
+// CONFIGURATION
+// ============================================
+
+function loadSettings(env = process.env) {
+  return {
+    enabled: env.MEMORY_WATCHDOG_ENABLED !== 'false',
+    // Keep in sync with max_memory_restart in ecosystem.config.js
+    limitBytes: (parseFloat(env.MEMORY_LIMIT_MB) || 500) * MB,
+    profileFraction: parseFloat(env.MEMORY_PROFILE_FRACTION) || 0.75,
+    restartFraction: parseFloat(env.MEMORY_RESTART_FRACTION) || 0.9,
+    // Consecutive samples past the restart fraction that restart without a trend
+    restartSamples: parseInt(env.MEMORY_RESTART_SAMPLES, 10) || 3,
+    sampleIntervalMs: parseInt(env.MEMORY_SAMPLE_INTERVAL_MS, 10) || 15000,
+    // Samples a growth trend is judged over
+    windowSize: parseInt(env.MEMORY_GROWTH_WINDOW, 10) || 8,
+    profileDurationMs: parseInt(env.MEMORY_PROFILE_DURATION_MS, 10) || 20000,
+    // Profile length when growth jumps straight to the restart fraction
+    restartProfileMs: parseInt(env.MEMORY_RESTART_PROFILE_MS, 10) || 5000,
+    profileCooldownMs: (parseFloat(env.MEMORY_PROFILE_COOLDOWN_MINUTES) || 30) * 60 * 1000,
+    heapSnapshot: env.MEMORY_HEAP_SNAPSHOT === 'true',
+    snapshotMinIntervalMs: (parseFloat(env.MEMORY_SNAPSHOT_MIN_INTERVAL_HOURS) || 6) * 60 * 60 * 1000,
+    autoRestart: env.MEMORY_AUTO_RESTART !== 'false',
+    dumpDir: env.MEMORY_DUMP_DIR || path.join(__dirname, '../logs/memory')
+  };
+}
+
+// ============================================
+// PURE HELPERS (exported for tests)
+// ============================================
+
+/**
+ * Least-squares slope of RSS in bytes per minute
+ * @param {Array} samples - [{ at, rss }]
+ * @returns {number}
+ */
+function growthRate(samples) {
+  if (samples.length < 2) return 0;
+  const t0 = samples[0].at;
+  const xs = samples.map(s => (s.at - t0) / 60000);
+  const ys = samples.map(s => s.rss);
+  const meanX = xs.reduce((a, b) => a + b, 0) / xs.length;
+  const meanY = ys.reduce((a, b) => a + b, 0) / ys.length;
+  let num = 0;
+  let den = 0;
+  for (let i = 0; i < xs.length; i++) {
+    num += (xs[i] - meanX) * (ys[i] - meanY);
+    den += (xs[i] - meanX) ** 2;
+  }
+  return den === 0 ? 0 : num / den;
+}
+
+/**
+ * Growth that is a trend rather than a spike: a full window, a positive
+ * slope and at least two thirds of the steps going up
+ * @param {Array} samples
+ * @param {number} windowSize
+ * @returns {boolean}
+ */
+function isSustainedGrowth(samples, windowSize) {
+  if (samples.length < windowSize) return false;
+  const window = samples.slice(-windowSize);
+  let rising = 0;
+  for (let i = 1; i < window.length; i++) {
+    if (window[i].rss > window[i - 1].rss) rising++;
+  }
+  return growthRate(window) > 0 && rising >= (window.length - 1) * 2 / 3;
+}
+
+/**
+ * What the watchdog should do for the current samples
+ * @param {Array} samples
+ * @param {Object} settings
+ * @returns {string} ok | profile | restart
+ */
+function assessMemory(samples, settings) {
+  const latest = samples[samples.length - 1];
+  if (!latest) return 'ok';
+  const used = latest.rss / settings.limitBytes;
+  if (used >= settings.restartFraction) {
+    // Still there after a few samples, or climbing into it: PM2 is close
+    const recent = samples.slice(-settings.restartSamples);
+    const held = recent.length >= settings.restartSamples &&
+      recent.every(sample => sample.rss / settings.limitBytes >= settings.restartFraction);
+    if (held || isSustainedGrowth(samples, settings.windowSize)) return 'restart';
+  }
+  if (used >= settings.profileFraction && isSustainedGrowth(samples, settings.windowSize)) return 'profile';
+  return 'ok';
+}
+
+/**
+ * Allocation sites of a sampling heap profile, largest retained first
+ * @param {Object} profile - HeapProfiler.stopSampling() profile
+ * @param {number} top
+ * @returns {Array} [{ site, functionName, url, line, bytes }]
+ */
+function summarizeProfile(profile, top = TOP_SITES) {
+  const sites = new Map();
+  const stack = profile?.head ? [profile.head] : [];
+  while (stack.length > 0) {
+    const node = stack.pop();
+    const { functionName, url, lineNumber } = node.callFrame;
+    if (node.selfSize > 0) {
+      const name = functionName || '(anonymous)';
+      const file = url ? url.replace(/^file:\/\//, '') : '';
+      const site = file ? `${name} ${file}:${lineNumber + 1}` : name;
+      const entry = sites.get(site) || { site, functionName: name, url: file, line: lineNumber + 1, bytes: 0 };
+      entry.bytes += node.selfSize;
+      sites.set(site, entry);
+    }
+    for (const child of node.children || []) stack.push(child);
+  }
+  return [...sites.values()].sort((a, b) => b.bytes - a.bytes).slice(0, top);
+}
+
+const toMB = bytes => Math.round(bytes / MB * 10) / 10;
+
+// ============================================
+// WATCHDOG
+// ============================================
+
+class MemoryWatchdog {
+  constructor(settings = loadSettings(), { readMemory = () => process.memoryUsage() } = {}) {
+    this.settings = settings;
+    this.readMemory = readMemory;
+    this.samples = [];
+    this.registry = new Map();
+    this.timer = null;
+    this.onRestart = null;
+    this.busy = false;
+    this.restarting = false;
+    this.lastProfileAt = 0;
+    this.lastReport = null;
+  }
+
+  /**
+   * Register a cache, buffer or queue whose size goes into reports
+   * @param {string} name - e.g. 'cache:memory'
+   * @param {Function} sizeFn - () => number | { entries, bytes }
+   */
+  register(name, sizeFn) {
+    this.registry.set(name, sizeFn);
+  }
+
+  unregister(name) {
+    this.registry.delete(name);
+  }
+
+  /**
+   * Start sampling
+   * @param {Object} options
+   * @param {Function} options.onRestart - async () => void; drains and exits the process
+   */
+  start({ onRestart } = {}) {
+    if (this.timer || !this.settings.enabled) return;
+    this.onRestart = onRestart || null;
+    this.timer = setInterval(() => {
+      this.sample().catch(err => log.error('Memory watchdog sample failed', { error: err.message }));
+    }, this.settings.sampleIntervalMs);
+    this.timer.unref?.();
+    log.info('Memory watchdog started', {
+      limitMB: toMB(this.settings.limitBytes),
+      profileAtMB: toMB(this.settings.limitBytes * this.settings.profileFraction),
+      restartAtMB: toMB(this.settings.limitBytes * this.settings.restartFraction)
+    });
+  }
+
+  stop() {
+    if (this.timer) {
+      clearInterval(this.timer);
+      this.timer = null;
+    }
+  }
+
+  /**
+   * Record current memory and act on the trend
+   */
+  async sample() {
+    const { rss, heapUsed, heapTotal, external, arrayBuffers } = this.readMemory();
+    this.samples.push({ at: Date.now(), rss, heapUsed, heapTotal, external, arrayBuffers });
+    if (this.samples.length > this.settings.windowSize * 2) this.samples.shift();
+
+    if (this.busy || this.restarting) return 'busy';
+    const action = assessMemory(this.samples, this.settings);
+
+    if (action === 'profile' && Date.now() - this.lastProfileAt >= this.settings.profileCooldownMs) {
+      await this.investigate('sustained-growth', this.settings.profileDurationMs);
+    } else if (action === 'restart') {
+      await this.restart('restart-threshold');
+    }
+    return action;
+  }
+
+  /**
+   * Sizes of registered structures
+   */
+  collectSizes() {
+    const sizes = {};
+    for (const [name, sizeFn] of this.registry) {
+      try {
+        const size = sizeFn();
+        sizes[name] = typeof size === 'number' ? { entries: size } : size;
+      } catch (err) {
+        sizes[name] = { error: err.message };
+      }
+    }
+    return sizes;
+  }
+
+  /**
+   * Record a sampling heap profile for a while
+   * @param {number} durationMs
+   * @returns {Promise<Object>} V8 sampling heap profile
+   */
+  async captureProfile(durationMs) {
+    const session = new inspector.Session();
+    session.connect();
+    const post = (method, params = {}) => new Promise((resolve, reject) => {
+      session.post(method, params, (err, result) => (err ? reject(err) : resolve(result)));
+    });
+
+    try {
+      await post('HeapProfiler.enable');
+      await post('HeapProfiler.startSampling', { samplingInterval: PROFILE_SAMPLING_INTERVAL });
+      await new Promise(resolve => setTimeout(resolve, durationMs));
+      const { profile } = await post('HeapProfiler.stopSampling');
+      return profile;
+    } finally {
+      await post('HeapProfiler.disable').catch(() => {});
+      session.disconnect();
+    }
+  }
+
+  /**
+   * Heap snapshot, at most once per snapshotMinIntervalMs (checked against
+   * files in the dump directory, so the limit survives restarts)
+   * @returns {Promise<string|null>} Snapshot path, or null when rate limited
+   */
+  async writeHeapSnapshot(stamp) {
+    const files = await fs.readdir(this.settings.dumpDir).catch(() => []);
+    for (const file of files.filter(name => name.endsWith('.heapsnapshot'))) {
+      const { mtimeMs } = await fs.stat(path.join(this.settings.dumpDir, file));
+      if (Date.now() - mtimeMs < this.settings.snapshotMinIntervalMs) return null;
+    }
+    return v8.writeHeapSnapshot(path.join(this.settings.dumpDir, `${stamp}.heapsnapshot`));
+  }
+
+  /**
+   * Profile allocations and write a report (memory trend, registered sizes,
+   * top allocation sites, .heapprofile)
+   * @param {string} reason
+   * @param {number} durationMs - Profile length
+   * @param {Object} options
+   * @param {boolean} options.snapshot - Also write a heap snapshot (rate limited)
+   * @returns {Promise<Object>} Report
+   */
+  async investigate(reason, durationMs, { snapshot = false } = {}) {
+    this.busy = true;
+    try {
+      await fs.mkdir(this.settings.dumpDir, { recursive: true });
+      const stamp = `${new Date().toISOString().replace(/[:.]/g, '-')}-${reason}`;
+
+      const profile = await this.captureProfile(durationMs);
+      this.lastProfileAt = Date.now();
+      const profilePath = path.join(this.settings.dumpDir, `${stamp}.heapprofile`);
+      await fs.writeFile(profilePath, JSON.stringify(profile));
+
+      const snapshotPath = snapshot ? await this.writeHeapSnapshot(stamp) : null;
+
+      const report = {
+        reason,
+        at: new Date(),
+        pid: process.pid,
+        limitMB: toMB(this.settings.limitBytes),
+        growthMBPerMinute: toMB(growthRate(this.samples)),
+        memory: this.samples.map(s => ({
+          at: new Date(s.at),
+          rssMB: toMB(s.rss),
+          heapUsedMB: toMB(s.heapUsed),
+          externalMB: toMB(s.external),
+          arrayBuffersMB: toMB(s.arrayBuffers || 0)
+        })),
+        sizes: this.collectSizes(),
+        topAllocations: summarizeProfile(profile).map(site => ({ ...site, mb: toMB(site.bytes) })),
+        files: { profile: profilePath, snapshot: snapshotPath }
+      };
+      await fs.writeFile(path.join(this.settings.dumpDir, `${stamp}.json`), JSON.stringify(report, null, 2));
+      this.lastReport = report;
+
+      log.warn('Memory growth report written', {
+        reason,
+        rssMB: report.memory[report.memory.length - 1]?.rssMB,
+        growthMBPerMinute: report.growthMBPerMinute,
+        sizes: report.sizes,
+        topAllocations: report.topAllocations.slice(0, 5).map(site => `${site.site} (${site.mb}MB)`)
+      });
+      return report;
+    } finally {
+      this.busy = false;
+    }
+  }
+
+  /**
+   * Write a final report, then drain and restart before PM2 kills the process
+   */
+  async restart(reason) {
+    if (this.restarting) return;
+    this.restarting = true;
+    this.stop();
+
+    try {
+      await this.investigate(reason, this.settings.restartProfileMs, { snapshot: this.settings.heapSnapshot });
+    } catch (err) {
+      log.error('Memory report before restart failed', { error: err.message });
+    }
+
+    if (!this.settings.autoRestart || !this.onRestart) {
+      log.error('Memory limit approaching; automatic restart disabled', { reason });
+      return;
+    }
+    log.error('Memory limit approaching, draining and restarting', { reason });
+    await this.onRestart();
+  }
+
+  getStatus() {
+    const latest = this.samples[this.samples.length - 1];
+    return {
+      enabled: this.settings.enabled,
+      limitMB: toMB(this.settings.limitBytes),
+      rssMB: latest ? toMB(latest.rss) : null,
+      heapUsedMB: latest ? toMB(latest.heapUsed) : null,
+      externalMB: latest ? toMB(latest.external) : null,
+      growthMBPerMinute: toMB(growthRate(this.samples.slice(-this.settings.windowSize))),
+      assessment: assessMemory(this.samples, this.settings),
+      restarting: this.restarting,
+      sizes: this.collectSizes(),
+      lastReport: this.lastReport
+        ? { reason: this.lastReport.reason, at: this.lastReport.at, files: this.lastReport.files }
+        : null
+    };
+  }
+}
+
+const memoryWatchdog = new MemoryWatchdog();
+
+module.exports = memoryWatchdog;
+module.exports.MemoryWatchdog = MemoryWatchdog;
+module.exports.DRAIN_TIMEOUT_MS = DRAIN_TIMEOUT_MS;
+module.exports.loadSettings = loadSettings;
+module.exports.growthRate = growthRate;
+module.exports.isSustainedGrowth = isSustainedGrowth;
+module.exports.assessMemory = assessMemory;
+module.exports.summarizeProfile = summarizeProfile;
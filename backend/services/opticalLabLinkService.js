@@ -0,0 +1,912 @@
+/**
+ * Optical Lab Link Service
+ * Batched glasses order transmission to an external lens lab using
+ * VCA Data Communication Standard records.
+ *
+ * Features:
+ * - VCA order records (Rx, lens, frame boxing data and TRCFMT/R= tracer radii)
+ * - One session per batch: all pending orders are sent over a single TCP
+ *   connection (FS ... GS framing, ACK/NAK per record) or a single file drop
+ * - Status / job-completion records from the lab (REQ=STS) applied in bulk
+ * - Lab turnaround tracking (exportedAt → completedAt)
+ *
+ * Configuration (environment):
+ * - LAB_LINK_MODE: 'tcp' or 'file'
+ * - LAB_LINK_HOST / LAB_LINK_PORT: lab host for TCP mode
+ * - LAB_LINK_DROP_DIR: shared folder for file mode (outbox/ and inbox/)
+ * - LAB_LINK_LAB_ID / LAB_LINK_LAB_NAME: lab identification stored on orders
+ * - LAB_LINK_SYNC_MINUTES: automatic transmit + poll interval (0 = manual only)
+ */
+
+const net = require('net');
+const fs = require('fs').promises;
+const path = require('path');
+const crypto = require('crypto');
+
+const GlassesOrder = require('../models/GlassesOrder');
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('OpticalLabLink');
+
+// VCA control characters
+const FS = '\x1c'; // start of record
+const GS = '\x1d'; // end of record
+const ACK = '\x06';
+const NAK = '\x15';
+const CRLF = '\r\n';
+
+const DEFAULT_TIMEOUT_MS = 15000;
+const DEFAULT_BATCH_SIZE = 500;
+const MAX_NAK_RETRIES = 1;
+// A batch claim older than this was left by a crashed run: orders are sendable again
+const CLAIM_STALE_MS = 15 * 60 * 1000;
+// Replans of status updates lost to concurrent order changes, per poll
+const MAX_STATUS_ATTEMPTS = 3;
+const RADII_PER_LINE = 10;
+
+const LENS_TYPE_CODES = {
+  'single-vision-distance': 'SV',
+  'single-vision-near': 'SV',
+  'two-pairs': 'SV',
+  bifocal: 'BI',
+  progressive: 'PR',
+  varifocal: 'PR'
+};
+
+const MATERIAL_INDEX = {
+  cr39: 1.5,
+  polycarbonate: 1.59,
+  trivex: 1.53,
+  'hi-index-1.60': 1.6,
+  'hi-index-1.67': 1.67,
+  'hi-index-1.74': 1.74
+};
+
+// VCA FTYP: 1 = plastic, 2 = metal, 3 = rimless, 4 = optyl
+const FRAME_TYPE_CODES = {
+  metal: 2,
+  titanium: 2,
+  rimless: 3,
+  optyl: 4
+};
+
+// Prism base direction → base angle (degrees) per eye
+const PRISM_BASE_ANGLE = {
+  R: { in: 0, up: 90, out: 180, down: 270 },
+  L: { out: 0, up: 90, in: 180, down: 270 }
+};
+
+/**
+ * Lab status codes → externalLab.labStatus
+ * COMPL is the job-completion message (lens finished and dispatched).
+ */
+const LAB_STATUS_CODES = {
+  ACK: 'acknowledged',
+  RECV: 'acknowledged',
+  PROD: 'in-production',
+  INPROD: 'in-production',
+  HOLD: 'on-hold',
+  COMPL: 'shipped',
+  SHIP: 'shipped',
+  DELIV: 'delivered',
+  CANCEL: 'cancelled'
+};
+
+const COMPLETION_CODES = new Set(['COMPL', 'SHIP']);
+
+// ============================================
+// VCA RECORD CODEC
+// ============================================
+
+function fmt(value, decimals) {
+  if (value === undefined || value === null || value === '' || Number.isNaN(Number(value))) return '';
+  return Number(value).toFixed(decimals);
+}
+
+function pair(right, left) {
+  return `${right};${left}`;
+}
+
+/**
+ * Mirror right-eye radii for the left eye (same shape, flipped about the vertical axis)
+ */
+function mirrorRadii(radii) {
+  const n = radii.length;
+  return radii.map((_, i) => radii[(n - i) % n]);
+}
+
+function traceLines(side, radii) {
+  const lines = [`TRCFMT=1;${radii.length};E;${side};F`];
+  for (let i = 0; i < radii.length; i += RADII_PER_LINE) {
+    lines.push(`R=${radii.slice(i, i + RADII_PER_LINE).map(r => Math.round(r)).join(';')}`);
+  }
+  return lines;
+}
+
+/**
+ * Build the VCA record (label=value lines) for a glasses order
+ * @param {Object} order - Lean order with populated patient
+ * @returns {string[]} Record lines
+ */
+function buildOrderRecord(order) {
+  const od = order.prescriptionData?.od || {};
+  const os = order.prescriptionData?.os || {};
+  const pd = order.prescriptionData?.pd || {};
+  const glasses = order.glasses || {};
+  const frame = glasses.frame || {};
+  const tracing = frame.tracing || {};
+
+  const lines = [`JOB=${order.orderNumber}`, 'DO=B'];
+
+  if (order.patient) {
+    lines.push(`CLIENT=${[order.patient.lastName, order.patient.firstName].filter(Boolean).join(', ')}`);
+  }
+
+  lines.push(`SPH=${pair(fmt(od.sphere, 2), fmt(os.sphere, 2))}`);
+  lines.push(`CYL=${pair(fmt(od.cylinder, 2), fmt(os.cylinder, 2))}`);
+  lines.push(`AX=${pair(fmt(od.axis, 0), fmt(os.axis, 0))}`);
+  if (od.add || os.add) {
+    lines.push(`ADD=${pair(fmt(od.add, 2), fmt(os.add, 2))}`);
+  }
+  if (od.prism || os.prism) {
+    lines.push(`PRVM=${pair(fmt(od.prism, 2), fmt(os.prism, 2))}`);
+    lines.push(`PRVA=${pair(
+      fmt(PRISM_BASE_ANGLE.R[od.prismBase?.toLowerCase()], 0),
+      fmt(PRISM_BASE_ANGLE.L[os.prismBase?.toLowerCase()], 0)
+    )}`);
+  }
+
+  const ipdRight = pd.monocularOd ?? (pd.binocular ? pd.binocular / 2 : undefined);
+  const ipdLeft = pd.monocularOs ?? (pd.binocular ? pd.binocular / 2 : undefined);
+  lines.push(`IPD=${pair(fmt(ipdRight, 1), fmt(ipdLeft, 1))}`);
+
+  if (glasses.lensType) lines.push(`LTYP=${pair(LENS_TYPE_CODES[glasses.lensType] || 'SV', LENS_TYPE_CODES[glasses.lensType] || 'SV')}`);
+  if (glasses.lensMaterial) {
+    const index = fmt(MATERIAL_INDEX[glasses.lensMaterial], 2);
+    lines.push(`LIND=${pair(index, index)}`);
+    lines.push(`_LMAT=${glasses.lensMaterial}`);
+  }
+  if (glasses.lens?.productLine) lines.push(`LNAM=${pair(glasses.lens.productLine, glasses.lens.productLine)}`);
+  if (glasses.coatings?.includes('anti-reflective')) lines.push('ACOAT=AR;AR');
+  if (glasses.coatings?.length) lines.push(`_COAT=${glasses.coatings.join(',')}`);
+  if (glasses.tint && glasses.tint !== 'clear') {
+    lines.push(`TINT=${pair(glasses.tint, glasses.tint)}`);
+    if (glasses.tintColor) lines.push(`_TINTCOL=${glasses.tintColor}`);
+  }
+
+  if (frame.brand) lines.push(`FMFR=${frame.brand}`);
+  if (frame.model) lines.push(`FRAM=${frame.model}`);
+  if (frame.color) lines.push(`FCOL=${frame.color}`);
+  if (frame.material) lines.push(`FTYP=${FRAME_TYPE_CODES[frame.material.toLowerCase()] || 1}`);
+
+  if (tracing.hbox) lines.push(`HBOX=${pair(fmt(tracing.hbox, 2), fmt(tracing.hbox, 2))}`);
+  if (tracing.vbox) lines.push(`VBOX=${pair(fmt(tracing.vbox, 2), fmt(tracing.vbox, 2))}`);
+  if (tracing.dbl) lines.push(`DBL=${fmt(tracing.dbl, 2)}`);
+  if (tracing.fed) lines.push(`FED=${pair(fmt(tracing.fed, 2), fmt(tracing.fed, 2))}`);
+  if (tracing.circumference) lines.push(`CIRC=${pair(fmt(tracing.circumference, 2), fmt(tracing.circumference, 2))}`);
+  if (tracing.radii?.length) {
+    lines.push(...traceLines('R', tracing.radii));
+    lines.push(...traceLines('L', mirrorRadii(tracing.radii)));
+  }
+
+  if (order.priority && order.priority !== 'normal') lines.push(`_PRIO=${order.priority.toUpperCase()}`);
+  if (order.notes?.production) lines.push(`_NOTE=${String(order.notes.production).replace(/[\r\n]+/g, ' ')}`);
+
+  return lines;
+}
+
+function frameRecord(lines) {
+  return `${FS}${lines.join(CRLF)}${CRLF}${GS}`;
+}
+
+/**
+ * Parse record text into { LABEL: [[values], ...] } (labels such as R= repeat)
+ */
+function parseRecord(text) {
+  const record = {};
+  text.split(/\r?\n/).forEach(line => {
+    const eq = line.indexOf('=');
+    if (eq <= 0) return;
+    const label = line.slice(0, eq).trim().toUpperCase();
+    const values = line.slice(eq + 1).split(';').map(v => v.trim());
+    (record[label] = record[label] || []).push(values);
+  });
+  return record;
+}
+
+function firstValue(record, label) {
+  return record[label]?.[0]?.[0] || undefined;
+}
+
+/**
+ * Split a byte stream into ACK / NAK tokens and framed records
+ * @returns {Object} { tokens: [{ type, text? }], rest }
+ */
+function parseStream(buffer) {
+  const tokens = [];
+  let rest = buffer;
+
+  while (rest.length) {
+    const ch = rest[0];
+    if (ch === ACK || ch === NAK) {
+      tokens.push({ type: ch === ACK ? 'ack' : 'nak' });
+      rest = rest.slice(1);
+    } else if (ch === FS) {
+      const end = rest.indexOf(GS);
+      if (end === -1) break;
+      tokens.push({ type: 'record', text: rest.slice(1, end) });
+      rest = rest.slice(end + 1);
+    } else {
+      // Line noise between records
+      rest = rest.slice(1);
+    }
+  }
+
+  return { tokens, rest };
+}
+
+function parseDate(value) {
+  if (!value) return undefined;
+  const date = new Date(value);
+  return Number.isNaN(date.getTime()) ? undefined : date;
+}
+
+/**
+ * Interpret a lab status record
+ * @returns {Object|null} Status message or null when the record is not a job status
+ */
+function parseStatusMessage(record) {
+  const job = firstValue(record, 'JOB');
+  const code = firstValue(record, 'STATUS')?.toUpperCase();
+  if (!job || !code || !LAB_STATUS_CODES[code]) return null;
+
+  return {
+    job,
+    code,
+    labStatus: LAB_STATUS_CODES[code],
+    completed: COMPLETION_CODES.has(code),
+    labOrderNumber: firstValue(record, '_LABJOB'),
+    trackingNumber: firstValue(record, 'TRACK'),
+    shippingMethod: firstValue(record, 'SHIPVIA'),
+    estimatedArrival: parseDate(firstValue(record, 'ETA')),
+    at: parseDate(firstValue(record, 'DATE')),
+    notes: firstValue(record, '_NOTE')
+  };
+}
+
+/**
+ * Fold status messages into one bulk update per order.
+ * Messages are applied in arrival order against an in-memory copy of each
+ * order, so a PROD followed by COMPL in the same batch yields the final state.
+ *
+ * @param {Array} orders - Lean orders (orderNumber, status, externalLab)
+ * @param {Array} messages - Parsed status messages
+ * @param {Date} now
+ * @returns {Object} { operations, matched, unmatched: [job], ignored }
+ */
+function planStatusUpdates(orders, messages, now = new Date()) {
+  const byNumber = new Map(orders.map(order => [order.orderNumber, {
+    order,
+    status: order.status,
+    labStatus: order.externalLab?.labStatus,
+    completedAt: order.externalLab?.completedAt,
+    set: {},
+    history: []
+  }]));
+
+  const unmatched = [];
+  let ignored = 0;
+
+  for (const message of messages) {
+    const state = byNumber.get(message.job);
+    if (!state) {
+      unmatched.push(message.job);
+      continue;
+    }
+
+    const at = message.at || now;
+    const hasNewDetails = message.labOrderNumber || message.trackingNumber || message.shippingMethod || message.estimatedArrival;
+    if (message.labStatus === state.labStatus && !hasNewDetails && !(message.completed && !state.completedAt)) {
+      // Re-delivered message
+      ignored++;
+      continue;
+    }
+
+    state.labStatus = message.labStatus;
+    state.set['externalLab.labStatus'] = message.labStatus;
+    state.set['externalLab.lastStatusUpdate'] = now;
+    if (message.labOrderNumber) state.set['externalLab.labOrderNumber'] = message.labOrderNumber;
+    if (message.trackingNumber) state.set['externalLab.trackingNumber'] = message.trackingNumber;
+    if (message.shippingMethod) state.set['externalLab.shippingMethod'] = message.shippingMethod;
+    if (message.estimatedArrival) state.set['externalLab.estimatedArrival'] = message.estimatedArrival;
+
+    if (message.completed && !state.completedAt) {
+      state.completedAt = at;
+      state.set['externalLab.completedAt'] = at;
+      state.set['externalLab.shippedAt'] = at;
+      const exportedAt = state.order.externalLab?.exportedAt;
+      if (exportedAt) {
+        state.set['externalLab.turnaroundHours'] =
+          Math.round((at.getTime() - new Date(exportedAt).getTime()) / 360000) / 10;
+      }
+    }
+    if (message.labStatus === 'delivered') {
+      state.set['externalLab.actualArrival'] = at;
+    }
+
+    // Same transition as a manual lab status update
+    if (['in-production', 'shipped'].includes(message.labStatus) && state.status === 'sent-to-lab') {
+      state.status = 'in-production';
+      state.set.status = 'in-production';
+      state.set['timeline.productionStartedAt'] = now;
+    }
+
+    state.history.push({
+      status: message.labStatus,
+      timestamp: at,
+      notes: message.notes || `Lab status ${message.code} (VCA)`
+    });
+  }
+
+  const operations = [];
+  for (const state of byNumber.values()) {
+    if (state.history.length === 0) continue;
+    operations.push({
+      updateOne: {
+        // Guard on the status we planned from; a concurrent manual change wins
+        filter: { _id: state.order._id, status: state.order.status },
+        update: {
+          $set: state.set,
+          $push: { 'externalLab.statusHistory': { $each: state.history } }
+        }
+      }
+    });
+  }
+
+  return { operations, matched: operations.length, unmatched, ignored };
+}
+
+// ============================================
+// TRANSPORTS
+// ============================================
+
+/**
+ * One VCA TCP session: records framed with FS/GS, each acknowledged with ACK/NAK
+ */
+class VcaTcpSession {
+  constructor(socket, timeoutMs) {
+    this.socket = socket;
+    this.timeoutMs = timeoutMs;
+    this.buffer = '';
+    this.tokens = [];
+    this.waiter = null;
+    this.error = null;
+
+    socket.setEncoding('latin1');
+    socket.on('data', chunk => {
+      this.buffer += chunk;
+      const { tokens, rest } = parseStream(this.buffer);
+      this.buffer = rest;
+      this.tokens.push(...tokens);
+      this._wake();
+    });
+    socket.on('error', err => {
+      this.error = err;
+      this._wake();
+    });
+    socket.on('close', () => {
+      this.error = this.error || new Error('Lab closed the connection');
+      this._wake();
+    });
+  }
+
+  static connect({ host, port, timeoutMs }) {
+    return new Promise((resolve, reject) => {
+      const socket = net.connect({ host, port });
+      const timer = setTimeout(() => {
+        socket.destroy();
+        reject(new Error('Connection timeout'));
+      }, timeoutMs);
+
+      socket.once('connect', () => {
+        clearTimeout(timer);
+        resolve(new VcaTcpSession(socket, timeoutMs));
+      });
+      socket.once('error', err => {
+        clearTimeout(timer);
+        reject(new Error(`Connection failed: ${err.message}`));
+      });
+    });
+  }
+
+  _wake() {
+    if (!this.waiter) return;
+    const { resolve, reject, timer } = this.waiter;
+    if (this.tokens.length) {
+      clearTimeout(timer);
+      this.waiter = null;
+      resolve(this.tokens.shift());
+    } else if (this.error) {
+      clearTimeout(timer);
+      this.waiter = null;
+      reject(this.error);
+    }
+  }
+
+  next() {
+    if (this.tokens.length) return Promise.resolve(this.tokens.shift());
+    if (this.error) return Promise.reject(this.error);
+    return new Promise((resolve, reject) => {
+      const timer = setTimeout(() => {
+        this.waiter = null;
+        reject(new Error('Lab response timeout'));
+      }, this.timeoutMs);
+      this.waiter = { resolve, reject, timer };
+    });
+  }
+
+  /**
+   * Send one record and wait for ACK, retrying on NAK
+   * @returns {Promise<boolean>} true when acknowledged
+   */
+  async sendRecord(lines) {
+    for (let attempt = 0; attempt <= MAX_NAK_RETRIES; attempt++) {
+      this.socket.write(frameRecord(lines), 'latin1');
+      const token = await this.next();
+      if (token.type === 'ack') return true;
+      if (token.type !== 'nak') throw new Error('Unexpected record while waiting for ACK');
+    }
+    return false;
+  }
+
+  async sendOrders(records) {
+    // Kept on the session so acknowledged jobs survive a mid-batch failure
+    this.partialResults = [];
+    for (const { job, lines } of records) {
+      this.partialResults.push({ job, accepted: await this.sendRecord(lines) });
+    }
+    return this.partialResults;
+  }
+
+  /**
+   * Ask the lab for pending status records (REQ=STS … REQ=END). They are
+   * acknowledged by acknowledgeStatus() once applied; the lab resends
+   * unacknowledged records on the next request.
+   */
+  async fetchStatus() {
+    this.socket.write(frameRecord(['REQ=STS']), 'latin1');
+    const records = [];
+    for (;;) {
+      const token = await this.next();
+      if (token.type !== 'record') continue;
+      const record = parseRecord(token.text);
+      if (firstValue(record, 'REQ') === 'END') break;
+      records.push(record);
+    }
+    this.unacknowledged = records.length;
+    return records;
+  }
+
+  async acknowledgeStatus() {
+    if (this.unacknowledged) this.socket.write(ACK.repeat(this.unacknowledged), 'latin1');
+    this.unacknowledged = 0;
+  }
+
+  async close() {
+    this.socket.end();
+  }
+}
+
+/**
+ * File drop: one .vca file per batch in outbox/, lab status files read from inbox/
+ */
+class VcaFileSession {
+  constructor(dropDir) {
+    this.outbox = path.join(dropDir, 'outbox');
+    this.inbox = path.join(dropDir, 'inbox');
+    this.processed = path.join(dropDir, 'inbox', 'processed');
+  }
+
+  async sendOrders(records, batchId) {
+    if (records.length === 0) return [];
+    await fs.mkdir(this.outbox, { recursive: true });
+    const target = path.join(this.outbox, `${batchId}.vca`);
+    const tmp = `${target}.tmp`;
+    await fs.writeFile(tmp, records.map(r => frameRecord(r.lines)).join(CRLF), 'latin1');
+    // Rename so the lab never picks up a partially written batch
+    await fs.rename(tmp, target);
+    return records.map(({ job }) => ({ job, accepted: true }));
+  }
+
+  async fetchStatus() {
+    let files;
+    try {
+      files = await fs.readdir(this.inbox);
+    } catch (err) {
+      if (err.code === 'ENOENT') return [];
+      throw err;
+    }
+
+    const records = [];
+    this.statusFiles = files.filter(f => /\.(vca|sts|txt)$/i.test(f)).sort();
+
+    for (const file of this.statusFiles) {
+      const content = await fs.readFile(path.join(this.inbox, file), 'latin1');
+      parseStream(content).tokens
+        .filter(token => token.type === 'record')
+        .forEach(token => records.push(parseRecord(token.text)));
+    }
+    return records;
+  }
+
+  /**
+   * Move the status files read by fetchStatus() to processed/ (once applied)
+   */
+  async acknowledgeStatus() {
+    if (!this.statusFiles?.length) return;
+    await fs.mkdir(this.processed, { recursive: true });
+    for (const file of this.statusFiles) {
+      await fs.rename(path.join(this.inbox, file), path.join(this.processed, file));
+    }
+    this.statusFiles = [];
+  }
+
+  async close() {}
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+function loadConfig() {
+  return {
+    mode: process.env.LAB_LINK_MODE || 'tcp',
+    host: process.env.LAB_LINK_HOST,
+    port: parseInt(process.env.LAB_LINK_PORT || '0', 10),
+    dropDir: process.env.LAB_LINK_DROP_DIR,
+    labId: process.env.LAB_LINK_LAB_ID,
+    labName: process.env.LAB_LINK_LAB_NAME || 'External Lab',
+    timeoutMs: parseInt(process.env.LAB_LINK_TIMEOUT_MS || String(DEFAULT_TIMEOUT_MS), 10),
+    batchSize: parseInt(process.env.LAB_LINK_BATCH_SIZE || String(DEFAULT_BATCH_SIZE), 10),
+    syncMinutes: parseInt(process.env.LAB_LINK_SYNC_MINUTES || '0', 10)
+  };
+}
+
+function createBatchId(now = new Date()) {
+  const stamp = now.toISOString().replace(/[-:T]/g, '').slice(0, 14);
+  return `VCA-${stamp}-${crypto.randomBytes(2).toString('hex').toUpperCase()}`;
+}
+
+class OpticalLabLinkService {
+  constructor() {
+    this.config = loadConfig();
+    this.syncInterval = null;
+    this.running = null;
+    this.lastTransmit = null;
+    this.lastPoll = null;
+  }
+
+  configure(overrides = {}) {
+    this.config = { ...this.config, ...overrides };
+    return this.config;
+  }
+
+  isConfigured() {
+    const { mode, host, port, dropDir } = this.config;
+    return mode === 'file' ? Boolean(dropDir) : Boolean(host && port);
+  }
+
+  async _openSession() {
+    if (!this.isConfigured()) {
+      throw new Error('Optical lab link is not configured');
+    }
+    if (this.config.mode === 'file') {
+      return new VcaFileSession(this.config.dropDir);
+    }
+    return VcaTcpSession.connect(this.config);
+  }
+
+  async _withSession(fn) {
+    const session = await this._openSession();
+    try {
+      return await fn(session);
+    } finally {
+      await session.close().catch(() => {});
+    }
+  }
+
+  /**
+   * Send every pending order in one session
+   * @param {Object} options - { orderIds, clinicId, userId }
+   */
+  transmitPending(options = {}) {
+    return this._withSession(session => this._transmit(session, options));
+  }
+
+  /**
+   * Fetch lab status / completion records and apply them in bulk
+   */
+  pollStatus() {
+    return this._withSession(session => this._poll(session));
+  }
+
+  /**
+   * Transmit then poll over the same session (scheduled run)
+   */
+  sync(options = {}) {
+    if (!this.running) {
+      this.running = this._withSession(async session => ({
+        transmit: await this._transmit(session, options),
+        poll: await this._poll(session)
+      })).finally(() => {
+        this.running = null;
+      });
+    }
+    return this.running;
+  }
+
+  /**
+   * Claim pending orders for a batch: a manual send overlapping the
+   * scheduled sync must not transmit the same orders twice
+   */
+  async _claim(batchId, now, { orderIds, clinicId } = {}) {
+    const query = {
+      status: 'confirmed',
+      orderType: { $in: ['glasses', 'both'] },
+      'externalLab.exported': { $ne: true },
+      $or: [
+        { 'externalLab.claimBatchId': null },
+        { 'externalLab.claimedAt': { $lt: new Date(now.getTime() - CLAIM_STALE_MS) } }
+      ]
+    };
+    if (clinicId) query.clinic = clinicId;
+    if (orderIds?.length) query._id = { $in: orderIds };
+
+    const candidates = await GlassesOrder.find(query)
+      .select('_id')
+      .sort({ createdAt: 1 })
+      .limit(this.config.batchSize)
+      .lean();
+    if (candidates.length === 0) return [];
+
+    // Conditional: orders claimed by a concurrent batch since the find are skipped
+    await GlassesOrder.updateMany(
+      { ...query, _id: { $in: candidates.map(order => order._id) } },
+      { $set: { 'externalLab.claimBatchId': batchId, 'externalLab.claimedAt': now } }
+    );
+
+    return GlassesOrder.find({ 'externalLab.claimBatchId': batchId })
+      .select('orderNumber priority patient prescriptionData glasses notes')
+      .populate('patient', 'firstName lastName')
+      .sort({ createdAt: 1 })
+      .lean();
+  }
+
+  async _transmit(session, { orderIds, clinicId, userId } = {}) {
+    const now = new Date();
+    const batchId = createBatchId(now);
+    const orders = await this._claim(batchId, now, { orderIds, clinicId });
+    const records = orders.map(order => ({ job: order.orderNumber, order, lines: buildOrderRecord(order) }));
+
+    let results = [];
+    let sessionError = null;
+    try {
+      results = await session.sendOrders(records, batchId);
+    } catch (err) {
+      // Keep what the lab acknowledged before the failure
+      sessionError = err;
+      results = session.partialResults || [];
+    }
+
+    const resultByJob = new Map(results.map(r => [r.job, r]));
+    const operations = [];
+    const accepted = [];
+    const rejected = [];
+
+    for (const { job, order, lines } of records) {
+      const result = resultByJob.get(job);
+      if (result?.accepted) {
+        accepted.push(job);
+        operations.push({
+          updateOne: {
+            filter: { _id: order._id, status: 'confirmed' },
+            update: {
+              $unset: { 'externalLab.claimBatchId': 1, 'externalLab.claimedAt': 1 },
+              $set: {
+                status: 'sent-to-lab',
+                'timeline.sentToLabAt': now,
+                'externalLab.exported': true,
+                'externalLab.exportedAt': now,
+                'externalLab.exportedBy': userId,
+                'externalLab.exportFormat': 'vca',
+                'externalLab.labId': this.config.labId,
+                'externalLab.labName': this.config.labName,
+                'externalLab.labStatus': 'pending',
+                'externalLab.batchId': batchId,
+                'externalLab.exportData': { format: 'vca', batchId, record: lines.join(CRLF) },
+                'externalLab.exportError': null
+              },
+              $push: {
+                'externalLab.statusHistory': {
+                  status: 'exported',
+                  timestamp: now,
+                  notes: `Transmitted in VCA batch ${batchId} to ${this.config.labName}`
+                }
+              }
+            }
+          }
+        });
+      } else if (result) {
+        rejected.push(job);
+        operations.push({
+          updateOne: {
+            filter: { _id: order._id },
+            update: {
+              $set: { 'externalLab.exportError': 'Rejected by lab (NAK)' },
+              $unset: { 'externalLab.claimBatchId': 1, 'externalLab.claimedAt': 1 },
+              $inc: { 'externalLab.retryCount': 1 }
+            }
+          }
+        });
+      }
+    }
+
+    if (operations.length) {
+      await GlassesOrder.bulkWrite(operations, { ordered: false });
+    }
+    // Orders never reached (session failed first) go back to the pending pool
+    await GlassesOrder.updateMany(
+      { 'externalLab.claimBatchId': batchId },
+      { $unset: { 'externalLab.claimBatchId': 1, 'externalLab.claimedAt': 1 } }
+    );
+
+    const summary = {
+      batchId,
+      pending: orders.length,
+      sent: accepted.length,
+      rejected,
+      notSent: records.length - accepted.length - rejected.length,
+      error: sessionError?.message,
+      at: now
+    };
+    this.lastTransmit = summary;
+    log.info('Lab batch transmitted', { ...summary, rejected: rejected.length });
+
+    if (sessionError && accepted.length === 0) throw sessionError;
+    return summary;
+  }
+
+  async _poll(session) {
+    const now = new Date();
+    const records = await session.fetchStatus();
+    const messages = records.map(parseStatusMessage).filter(Boolean);
+
+    let updated = 0;
+    let ignored = 0;
+    let unmatched = [];
+    let notApplied = [];
+    let pending = messages;
+    for (let attempt = 1; pending.length; attempt++) {
+      const orders = await GlassesOrder.find({
+        orderNumber: { $in: [...new Set(pending.map(m => m.job))] },
+        'externalLab.exported': true
+      })
+        .select('orderNumber status externalLab.exportedAt externalLab.labStatus externalLab.completedAt')
+        .lean();
+
+      const plan = planStatusUpdates(orders, pending, now);
+      ignored += plan.ignored;
+      unmatched = unmatched.concat(plan.unmatched);
+      if (plan.operations.length === 0) break;
+
+      const result = await GlassesOrder.bulkWrite(plan.operations, { ordered: false });
+      updated += result.matchedCount;
+      if (result.matchedCount === plan.operations.length) break;
+
+      // Status guard missed (order changed meanwhile): every applied update
+      // stamped lastStatusUpdate with this poll's time, the others replan
+      // from the order's current state
+      const missed = await GlassesOrder.find({
+        _id: { $in: plan.operations.map(op => op.updateOne.filter._id) },
+        'externalLab.lastStatusUpdate': { $ne: now }
+      }).select('orderNumber').lean();
+      const missedJobs = new Set(missed.map(order => order.orderNumber));
+      pending = pending.filter(message => missedJobs.has(message.job));
+      if (attempt === MAX_STATUS_ATTEMPTS) {
+        notApplied = [...missedJobs];
+        break;
+      }
+    }
+
+    // Only now, and only when all applied: the lab resends unacknowledged
+    // records on the next poll
+    if (notApplied.length) {
+      log.warn('Lab status not applied, left with the lab', { jobs: notApplied });
+    } else {
+      await session.acknowledgeStatus();
+    }
+
+    const summary = {
+      received: records.length,
+      statusMessages: messages.length,
+      updated,
+      ignored,
+      unmatched,
+      notApplied,
+      at: now
+    };
+    this.lastPoll = summary;
+    if (unmatched.length) {
+      log.warn('Lab status for unknown jobs', { jobs: unmatched });
+    }
+    log.info('Lab status polled', { ...summary, unmatched: unmatched.length, notApplied: notApplied.length });
+    return summary;
+  }
+
+  /**
+   * Average lab turnaround per lab over a period
+   */
+  async getTurnaroundStats({ days = 90, clinicId } = {}) {
+    const match = {
+      'externalLab.completedAt': { $gte: new Date(Date.now() - days * 24 * 60 * 60 * 1000) },
+      'externalLab.turnaroundHours': { $ne: null },
+      isDeleted: { $ne: true }
+    };
+    if (clinicId) match.clinic = clinicId;
+
+    return GlassesOrder.aggregate([
+      { $match: match },
+      {
+        $group: {
+          _id: '$externalLab.labName',
+          jobs: { $sum: 1 },
+          avgHours: { $avg: '$externalLab.turnaroundHours' },
+          maxHours: { $max: '$externalLab.turnaroundHours' },
+          minHours: { $min: '$externalLab.turnaroundHours' }
+        }
+      },
+      { $sort: { jobs: -1 } }
+    ]);
+  }
+
+  getStatus() {
+    return {
+      configured: this.isConfigured(),
+      mode: this.config.mode,
+      labId: this.config.labId,
+      labName: this.config.labName,
+      syncMinutes: this.config.syncMinutes,
+      scheduled: Boolean(this.syncInterval),
+      lastTransmit: this.lastTransmit,
+      lastPoll: this.lastPoll
+    };
+  }
+
+  start() {
+    if (this.syncInterval || !this.isConfigured() || !(this.config.syncMinutes > 0)) return;
+    this.syncInterval = setInterval(() => {
+      this.sync().catch(err => log.error('Scheduled lab sync failed', { error: err.message }));
+    }, this.config.syncMinutes * 60 * 1000);
+    this.syncInterval.unref?.();
+    log.info('Optical lab link scheduler started', { mode: this.config.mode, everyMinutes: this.config.syncMinutes });
+  }
+
+  stop() {
+    if (this.syncInterval) {
+      clearInterval(this.syncInterval);
+      this.syncInterval = null;
+    }
+  }
+}
+
+module.exports = new OpticalLabLinkService();
+module.exports.OpticalLabLinkService = OpticalLabLinkService;
+module.exports.VcaTcpSession = VcaTcpSession;
+module.exports.VcaFileSession = VcaFileSession;
+module.exports.buildOrderRecord = buildOrderRecord;
+module.exports.frameRecord = frameRecord;
+module.exports.parseRecord = parseRecord;
+module.exports.parseStream = parseStream;
+module.exports.parseStatusMessage = parseStatusMessage;
+module.exports.planStatusUpdates = planStatusUpdates;
+module.exports.mirrorRadii = mirrorRadii;
+module.exports.LAB_STATUS_CODES = LAB_STATUS_CODES;
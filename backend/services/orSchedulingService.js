@@ -0,0 +1,934 @@
+/**
+ * OR Scheduling Service
+ * Packs the awaiting-scheduling surgery queue into a multi-day operating room plan.
+ *
+ * - Predicts case durations from historical SurgeryCase actual times
+ *   (surgeon + procedure, then procedure, then ClinicalAct default)
+ * - Respects OR operating hours, surgeon availability and required equipment
+ * - Orders placement by priority and waiting time so overdue cases go first
+ * - Best-fit room selection to keep OR days tightly packed
+ * - Incremental backfill of the gap left by a cancelled case
+ *
+ * The planner itself (buildSchedule / fillGap) is pure and works on plain objects;
+ * the async wrappers load data and persist an accepted plan.
+ */
+
+const mongoose = require('mongoose');
+const SurgeryCase = require('../models/SurgeryCase');
+const Room = require('../models/Room');
+const ProviderAvailability = require('../models/ProviderAvailability');
+
+const { createContextLogger } = require('../utils/structuredLogger');
+const { withTransactionRetry } = require('../utils/transactions');
+const log = createContextLogger('ORScheduling');
+
+const ACTIVE_STATUSES = ['scheduled', 'checked_in', 'in_surgery'];
+
+const PRIORITY_WEIGHT = {
+  emergency: 10000,
+  urgent: 1000,
+  routine: 0
+};
+
+// Extra weight for cases past the overdue threshold (see SurgeryCase.findOverdue)
+const OVERDUE_BONUS = 500;
+const DEFAULT_OVERDUE_DAYS = 30;
+
+const DEFAULT_OR_HOURS = { open: '08:00', close: '17:00' };
+const DEFAULT_TURNOVER_MINUTES = 15;
+const SLOT_GRANULARITY_MINUTES = 5;
+const DEFAULT_DURATION_MINUTES = 60;
+
+// Duration model
+const HISTORY_LOOKBACK_DAYS = 365;
+const MIN_HISTORY_SAMPLES = 3;
+const PLANNING_PERCENTILE = 0.75; // Plan on p75 so days rarely overrun
+const MIN_PLAUSIBLE_MINUTES = 5;
+const MAX_PLAUSIBLE_MINUTES = 600;
+
+const DAY_NAMES = ['sunday', 'monday', 'tuesday', 'wednesday', 'thursday', 'friday', 'saturday'];
+
+// ============================================
+// HELPERS
+// ============================================
+
+function timeToMinutes(time) {
+  const [hours, minutes] = String(time).split(':').map(Number);
+  return hours * 60 + (minutes || 0);
+}
+
+function minutesOfDay(date) {
+  return date.getHours() * 60 + date.getMinutes();
+}
+
+function startOfDay(date) {
+  const d = new Date(date);
+  d.setHours(0, 0, 0, 0);
+  return d;
+}
+
+function dayKey(date) {
+  const d = startOfDay(date);
+  return `${d.getFullYear()}-${String(d.getMonth() + 1).padStart(2, '0')}-${String(d.getDate()).padStart(2, '0')}`;
+}
+
+function atMinutes(day, minutes) {
+  const d = startOfDay(day);
+  d.setMinutes(minutes);
+  return d;
+}
+
+function roundUp(minutes, step = SLOT_GRANULARITY_MINUTES) {
+  return Math.ceil(minutes / step) * step;
+}
+
+function idOf(value) {
+  if (!value) return null;
+  return (value._id || value).toString();
+}
+
+function percentile(sorted, p) {
+  if (sorted.length === 0) return null;
+  const idx = Math.min(sorted.length - 1, Math.max(0, Math.ceil(p * sorted.length) - 1));
+  return sorted[idx];
+}
+
+/**
+ * Insert [start, end) into a sorted interval list
+ */
+function addInterval(list, start, end) {
+  let i = 0;
+  while (i < list.length && list[i][0] < start) i++;
+  list.splice(i, 0, [start, end]);
+}
+
+function overlapsAny(list, start, end) {
+  return list.some(([s, e]) => start < e && end > s);
+}
+
+/**
+ * Earliest start >= from such that [start, start + length) fits in one of the
+ * windows and does not overlap any busy interval.
+ */
+function earliestFit(windows, busy, length, from = 0) {
+  for (const [wStart, wEnd] of windows) {
+    let start = roundUp(Math.max(wStart, from));
+    while (start + length <= wEnd) {
+      const clash = busy.find(([s, e]) => start < e && start + length > s);
+      if (!clash) return start;
+      start = roundUp(clash[1]);
+    }
+  }
+  return null;
+}
+
+/**
+ * Subtract break intervals from shift windows
+ */
+function subtractBreaks(shifts, breaks) {
+  let windows = shifts.map(s => [timeToMinutes(s.startTime), timeToMinutes(s.endTime)]);
+  for (const brk of breaks || []) {
+    if (!brk.startTime || !brk.endTime) continue;
+    const bStart = timeToMinutes(brk.startTime);
+    const bEnd = timeToMinutes(brk.endTime);
+    windows = windows.flatMap(([s, e]) => {
+      if (bEnd <= s || bStart >= e) return [[s, e]];
+      const parts = [];
+      if (bStart > s) parts.push([s, bStart]);
+      if (bEnd < e) parts.push([bEnd, e]);
+      return parts;
+    });
+  }
+  return windows;
+}
+
+// ============================================
+// DURATION MODEL
+// ============================================
+
+function summarize(minutes) {
+  const sorted = [...minutes].sort((a, b) => a - b);
+  return {
+    count: sorted.length,
+    median: percentile(sorted, 0.5),
+    planned: roundUp(percentile(sorted, PLANNING_PERCENTILE))
+  };
+}
+
+/**
+ * Build a duration model from historical samples
+ * @param {Array} samples - [{ surgeon, surgeryType, minutes }]
+ * @returns {Object} { bySurgeonType: Map, byType: Map }
+ */
+function buildDurationModel(samples = []) {
+  const surgeonType = new Map();
+  const type = new Map();
+
+  for (const sample of samples) {
+    const minutes = Number(sample.minutes);
+    if (!Number.isFinite(minutes) ||
+        minutes < MIN_PLAUSIBLE_MINUTES || minutes > MAX_PLAUSIBLE_MINUTES) {
+      continue;
+    }
+    const typeId = idOf(sample.surgeryType);
+    if (!typeId) continue;
+
+    if (!type.has(typeId)) type.set(typeId, []);
+    type.get(typeId).push(minutes);
+
+    const surgeonId = idOf(sample.surgeon);
+    if (surgeonId) {
+      const key = `${surgeonId}:${typeId}`;
+      if (!surgeonType.has(key)) surgeonType.set(key, []);
+      surgeonType.get(key).push(minutes);
+    }
+  }
+
+  const bySurgeonType = new Map();
+  for (const [key, values] of surgeonType) bySurgeonType.set(key, summarize(values));
+  const byType = new Map();
+  for (const [key, values] of type) byType.set(key, summarize(values));
+
+  return { bySurgeonType, byType };
+}
+
+/**
+ * Predict the planned duration of a case
+ * @returns {Object} { minutes, source }
+ */
+function predictDuration(model, surgeryCase) {
+  const typeId = idOf(surgeryCase.surgeryType);
+  const surgeonId = idOf(surgeryCase.surgeon);
+
+  if (model && typeId) {
+    const own = surgeonId && model.bySurgeonType.get(`${surgeonId}:${typeId}`);
+    if (own && own.count >= MIN_HISTORY_SAMPLES) {
+      return { minutes: own.planned, source: 'surgeon_history' };
+    }
+    const general = model.byType.get(typeId);
+    if (general && general.count >= MIN_HISTORY_SAMPLES) {
+      return { minutes: general.planned, source: 'procedure_history' };
+    }
+  }
+
+  const actDuration = surgeryCase.surgeryType?.duration;
+  if (actDuration) {
+    return { minutes: roundUp(actDuration), source: 'clinical_act' };
+  }
+
+  return {
+    minutes: roundUp(surgeryCase.estimatedDuration || DEFAULT_DURATION_MINUTES),
+    source: 'estimate'
+  };
+}
+
+// ============================================
+// RANKING
+// ============================================
+
+/**
+ * Placement score: priority first, then how long the patient has waited
+ */
+function scoreCase(surgeryCase, now = new Date(), overdueDays = DEFAULT_OVERDUE_DAYS) {
+  const paid = surgeryCase.paymentDate ? new Date(surgeryCase.paymentDate) : now;
+  const daysWaiting = Math.max(0, Math.floor((now - paid) / (24 * 60 * 60 * 1000)));
+  const overdue = daysWaiting >= overdueDays;
+  return {
+    score: (PRIORITY_WEIGHT[surgeryCase.priority] || 0) + daysWaiting + (overdue ? OVERDUE_BONUS : 0),
+    daysWaiting,
+    overdue
+  };
+}
+
+function rankCases(cases, durations, now, overdueDays) {
+  return cases
+    .map(c => ({ surgeryCase: c, ...scoreCase(c, now, overdueDays), duration: durations.get(idOf(c)) }))
+    // Highest score first; longest first among equals (LPT packs tighter)
+    .sort((a, b) => (b.score - a.score) || (b.duration.minutes - a.duration.minutes));
+}
+
+// ============================================
+// CAPACITY MODEL
+// ============================================
+
+function roomWindow(room, day) {
+  const hours = room.operatingHours?.[DAY_NAMES[day.getDay()]];
+  if (hours && hours.open && hours.close) {
+    return [timeToMinutes(hours.open), timeToMinutes(hours.close)];
+  }
+  // Rooms with any configured hours are closed on days without hours
+  const configured = room.operatingHours && Object.values(room.operatingHours).some(h => h && h.open);
+  if (configured) return null;
+  return [timeToMinutes(DEFAULT_OR_HOURS.open), timeToMinutes(DEFAULT_OR_HOURS.close)];
+}
+
+function roomHasEquipment(room, required = []) {
+  if (!required || required.length === 0) return true;
+  const available = new Set([
+    ...(room.equipment || [])
+      .filter(e => (e.status || 'working') === 'working')
+      .flatMap(e => [e.name, e.type])
+      .filter(Boolean)
+      .map(v => v.toLowerCase()),
+    ...(room.features || []).map(f => f.toLowerCase())
+  ]);
+  return required.every(item => available.has(String(item).toLowerCase()));
+}
+
+/**
+ * Surgeon working windows for a day, or null when the surgeon has no
+ * availability record (unconstrained)
+ */
+function surgeonWindows(availabilityBySurgeon, surgeonId, day) {
+  const availability = availabilityBySurgeon?.get(surgeonId);
+  if (!availability) return null;
+
+  const hours = availability.getWorkingHoursForDate(day);
+  if (!hours || !hours.isWorkingDay) return [];
+  return subtractBreaks(hours.shifts || [], hours.breaks || []);
+}
+
+function intersectWindows(a, b) {
+  const result = [];
+  for (const [aS, aE] of a) {
+    for (const [bS, bE] of b) {
+      const s = Math.max(aS, bS);
+      const e = Math.min(aE, bE);
+      if (e > s) result.push([s, e]);
+    }
+  }
+  return result.sort((x, y) => x[0] - y[0]);
+}
+
+/**
+ * Mutable timeline of room and surgeon occupancy across the planning horizon
+ */
+class Timeline {
+  constructor({ rooms, days, bookings = [], availabilityBySurgeon, turnover }) {
+    this.rooms = rooms;
+    this.days = days;
+    this.turnover = turnover;
+    this.availabilityBySurgeon = availabilityBySurgeon;
+    this.roomBusy = new Map();
+    this.surgeonBusy = new Map();
+    this.windows = new Map();
+
+    for (const day of days) {
+      for (const room of rooms) {
+        const window = roomWindow(room, day);
+        this.windows.set(`${idOf(room)}|${dayKey(day)}`, window);
+      }
+    }
+
+    for (const booking of bookings) {
+      this.reserve(idOf(booking.operatingRoom), idOf(booking.surgeon),
+        new Date(booking.scheduledDate), new Date(booking.scheduledEndTime));
+    }
+  }
+
+  _list(map, key) {
+    if (!map.has(key)) map.set(key, []);
+    return map.get(key);
+  }
+
+  reserve(roomId, surgeonId, start, end) {
+    const key = dayKey(start);
+    const s = minutesOfDay(start);
+    const e = minutesOfDay(end) || 24 * 60;
+    if (roomId) addInterval(this._list(this.roomBusy, `${roomId}|${key}`), s, e + this.turnover);
+    if (surgeonId) addInterval(this._list(this.surgeonBusy, `${surgeonId}|${key}`), s, e);
+  }
+
+  /**
+   * Earliest feasible start for a case in a room on a day
+   */
+  findStart(room, day, minutes, surgeonId, earliest = 0) {
+    const key = dayKey(day);
+    const window = this.windows.get(`${idOf(room)}|${key}`);
+    if (!window) return null;
+
+    let windows = [[Math.max(window[0], earliest), window[1]]];
+    if (surgeonId) {
+      const available = surgeonWindows(this.availabilityBySurgeon, surgeonId, day);
+      if (available) windows = intersectWindows(windows, available);
+    }
+
+    const roomBusy = this.roomBusy.get(`${idOf(room)}|${key}`) || [];
+    const surgeonBusy = surgeonId ? (this.surgeonBusy.get(`${surgeonId}|${key}`) || []) : [];
+    const busy = [...roomBusy, ...surgeonBusy].sort((a, b) => a[0] - b[0]);
+
+    // Turnover is needed after the case before any later booking of the room,
+    // even one past closing time (overruns, backfilled gaps)
+    for (let start = earliestFit(windows, busy, minutes); start !== null;
+      start = earliestFit(windows, busy, minutes, start + SLOT_GRANULARITY_MINUTES)) {
+      const end = start + minutes;
+      if (!overlapsAny(roomBusy, end, end + this.turnover)) {
+        return start;
+      }
+    }
+    return null;
+  }
+
+  /**
+   * Free minutes left after placing [start, start+minutes) before the next booking or close
+   */
+  slack(room, day, start, minutes) {
+    const key = dayKey(day);
+    const window = this.windows.get(`${idOf(room)}|${key}`);
+    const busy = this.roomBusy.get(`${idOf(room)}|${key}`) || [];
+    const next = busy.find(([s]) => s >= start + minutes);
+    return (next ? next[0] : window[1]) - (start + minutes);
+  }
+
+  utilization() {
+    const result = [];
+    let booked = 0;
+    let open = 0;
+    for (const day of this.days) {
+      const key = dayKey(day);
+      for (const room of this.rooms) {
+        const window = this.windows.get(`${idOf(room)}|${key}`);
+        if (!window) continue;
+        const openMinutes = window[1] - window[0];
+        const bookedMinutes = (this.roomBusy.get(`${idOf(room)}|${key}`) || [])
+          .reduce((sum, [s, e]) => sum + Math.max(0, Math.min(e, window[1]) - Math.max(s, window[0])), 0);
+        booked += bookedMinutes;
+        open += openMinutes;
+        result.push({
+          roomId: idOf(room),
+          date: key,
+          openMinutes,
+          bookedMinutes,
+          utilization: openMinutes ? Math.round((bookedMinutes / openMinutes) * 1000) / 10 : 0
+        });
+      }
+    }
+    return {
+      byRoomDay: result,
+      overall: open ? Math.round((booked / open) * 1000) / 10 : 0
+    };
+  }
+}
+
+// ============================================
+// PLANNER
+// ============================================
+
+function buildDays(startDate, dayCount, includeWeekends) {
+  const days = [];
+  const cursor = startOfDay(startDate);
+  while (days.length < dayCount) {
+    const dow = cursor.getDay();
+    if (includeWeekends || (dow !== 0 && dow !== 6)) days.push(new Date(cursor));
+    cursor.setDate(cursor.getDate() + 1);
+  }
+  return days;
+}
+
+function requiredEquipment(surgeryCase) {
+  return surgeryCase.requiredEquipment || surgeryCase.surgeryType?.requiredEquipment || [];
+}
+
+/**
+ * Place ranked cases into the timeline.
+ * Earliest feasible day first (so priority order maps to calendar order),
+ * then the room that leaves the least slack (best fit).
+ */
+function placeCases(timeline, ranked, { now } = {}) {
+  const assignments = [];
+  const unscheduled = [];
+
+  for (const entry of ranked) {
+    const { surgeryCase, duration } = entry;
+    const surgeonId = idOf(surgeryCase.surgeon);
+    const equipment = requiredEquipment(surgeryCase);
+    const rooms = timeline.rooms.filter(room => roomHasEquipment(room, equipment));
+
+    if (rooms.length === 0) {
+      unscheduled.push({ caseId: idOf(surgeryCase), reason: 'no_room_with_equipment', requiredEquipment: equipment });
+      continue;
+    }
+
+    let best = null;
+    for (const day of timeline.days) {
+      const key = dayKey(day);
+      const earliest = now && dayKey(now) === key ? roundUp(minutesOfDay(now)) : 0;
+
+      for (const room of rooms) {
+        const start = timeline.findStart(room, day, duration.minutes, surgeonId, earliest);
+        if (start === null) continue;
+        const slack = timeline.slack(room, day, start, duration.minutes);
+        // Earliest start wins; among equal starts take the tightest fit
+        if (!best || start < best.start || (start === best.start && slack < best.slack)) {
+          best = { room, day, start, slack };
+        }
+      }
+      if (best) break;
+    }
+
+    if (!best) {
+      unscheduled.push({ caseId: idOf(surgeryCase), reason: 'no_capacity_in_horizon' });
+      continue;
+    }
+
+    const start = atMinutes(best.day, best.start);
+    const end = atMinutes(best.day, best.start + duration.minutes);
+    timeline.reserve(idOf(best.room), surgeonId, start, end);
+
+    assignments.push({
+      caseId: idOf(surgeryCase),
+      roomId: idOf(best.room),
+      surgeonId,
+      scheduledDate: start,
+      scheduledEndTime: end,
+      estimatedDuration: duration.minutes,
+      durationSource: duration.source,
+      priority: surgeryCase.priority || 'routine',
+      daysWaiting: entry.daysWaiting,
+      overdue: entry.overdue
+    });
+  }
+
+  return { assignments, unscheduled };
+}
+
+/**
+ * Build a packed multi-day OR schedule (pure)
+ *
+ * @param {Object} input
+ * @param {Array} input.cases - Awaiting cases (surgeryType populated with duration/requiredEquipment)
+ * @param {Array} input.rooms - OR rooms
+ * @param {Array} [input.bookings] - Already scheduled cases occupying rooms/surgeons
+ * @param {Map} [input.availabilityBySurgeon] - surgeonId -> ProviderAvailability
+ * @param {Object} [input.durationModel] - From buildDurationModel
+ * @param {Date} input.startDate - First planning day
+ * @param {number} [input.days=5] - Number of OR days in the horizon
+ * @param {Object} [input.options] - { turnoverMinutes, overdueDays, includeWeekends, now }
+ * @returns {Object} { assignments, unscheduled, utilization }
+ */
+function buildSchedule(input) {
+  const {
+    cases = [],
+    rooms = [],
+    bookings = [],
+    availabilityBySurgeon = new Map(),
+    durationModel = null,
+    startDate = new Date(),
+    days: dayCount = 5,
+    options = {}
+  } = input;
+  const now = options.now || new Date();
+
+  const days = buildDays(startDate, dayCount, options.includeWeekends);
+  const timeline = new Timeline({
+    rooms,
+    days,
+    bookings,
+    availabilityBySurgeon,
+    turnover: options.turnoverMinutes ?? DEFAULT_TURNOVER_MINUTES
+  });
+
+  const durations = new Map(cases.map(c => [idOf(c), predictDuration(durationModel, c)]));
+  const ranked = rankCases(cases, durations, now, options.overdueDays ?? DEFAULT_OVERDUE_DAYS);
+  const { assignments, unscheduled } = placeCases(timeline, ranked, { now });
+
+  return {
+    horizon: { from: days[0], to: days[days.length - 1], days: days.map(dayKey) },
+    assignments,
+    unscheduled,
+    utilization: timeline.utilization()
+  };
+}
+
+/**
+ * Fill a freed room window with the best-ranked waiting cases (pure).
+ * Bookings outside the gap are left untouched.
+ *
+ * @param {Object} input
+ * @param {Object} input.room - Room whose slot was freed
+ * @param {Date} input.gapStart - Earliest start (turnover after the previous case included)
+ * @param {Date} input.gapEnd - Latest end (turnover before the next case included)
+ * @param {Array} input.cases - Candidate awaiting cases
+ * @param {Array} [input.bookings] - Other bookings that day (for surgeon conflicts)
+ */
+function fillGap(input) {
+  const {
+    room,
+    gapStart,
+    gapEnd,
+    cases = [],
+    bookings = [],
+    availabilityBySurgeon = new Map(),
+    durationModel = null,
+    options = {}
+  } = input;
+  const now = options.now || new Date();
+  const day = startOfDay(gapStart);
+
+  const gapRoom = {
+    ...(room.toObject ? room.toObject() : room),
+    operatingHours: {
+      [DAY_NAMES[day.getDay()]]: {
+        open: `${String(gapStart.getHours()).padStart(2, '0')}:${String(gapStart.getMinutes()).padStart(2, '0')}`,
+        close: `${String(gapEnd.getHours()).padStart(2, '0')}:${String(gapEnd.getMinutes()).padStart(2, '0')}`
+      }
+    }
+  };
+
+  const timeline = new Timeline({
+    rooms: [gapRoom],
+    days: [day],
+    // Only surgeon commitments matter inside the gap; the room itself is free
+    bookings: bookings.map(b => ({ ...b, operatingRoom: null })),
+    availabilityBySurgeon,
+    turnover: options.turnoverMinutes ?? DEFAULT_TURNOVER_MINUTES
+  });
+
+  const durations = new Map(cases.map(c => [idOf(c), predictDuration(durationModel, c)]));
+  const ranked = rankCases(cases, durations, now, options.overdueDays ?? DEFAULT_OVERDUE_DAYS);
+  const { assignments } = placeCases(timeline, ranked, { now });
+
+  return {
+    gap: { roomId: idOf(room), start: gapStart, end: gapEnd },
+    assignments,
+    filledMinutes: assignments.reduce((sum, a) => sum + a.estimatedDuration, 0)
+  };
+}
+
+// ============================================
+// DATA LOADING
+// ============================================
+
+/**
+ * Load historical actual durations and compile the duration model
+ */
+async function loadDurationModel(clinicId) {
+  const since = new Date();
+  since.setDate(since.getDate() - HISTORY_LOOKBACK_DAYS);
+
+  const match = {
+    status: 'completed',
+    surgeryType: { $exists: true, $ne: null },
+    surgeryStartTime: { $gte: since },
+    surgeryEndTime: { $exists: true },
+    isDeleted: { $ne: true }
+  };
+  if (clinicId) match.clinic = new mongoose.Types.ObjectId(String(clinicId));
+
+  const samples = await SurgeryCase.aggregate([
+    { $match: match },
+    {
+      $project: {
+        surgeon: 1,
+        surgeryType: 1,
+        minutes: { $divide: [{ $subtract: ['$surgeryEndTime', '$surgeryStartTime'] }, 60000] }
+      }
+    }
+  ]);
+
+  return buildDurationModel(samples);
+}
+
+async function loadAvailability(clinicId, surgeonIds) {
+  const map = new Map();
+  if (!clinicId || surgeonIds.length === 0) return map;
+
+  const records = await ProviderAvailability.find({
+    clinic: clinicId,
+    provider: { $in: surgeonIds },
+    isActive: true
+  });
+  for (const record of records) map.set(idOf(record.provider), record);
+  return map;
+}
+
+async function loadRooms(clinicId, roomIds) {
+  const query = { type: 'surgery', isActive: true };
+  if (clinicId) query.clinic = clinicId;
+  if (roomIds?.length) query._id = { $in: roomIds };
+  return Room.find(query).select('_id name roomNumber equipment features operatingHours').lean();
+}
+
+async function loadBookings(roomIds, surgeonIds, from, to) {
+  const or = [{ operatingRoom: { $in: roomIds } }];
+  if (surgeonIds.length) or.push({ surgeon: { $in: surgeonIds } });
+  return SurgeryCase.find({
+    status: { $in: ACTIVE_STATUSES },
+    scheduledDate: { $gte: from, $lte: to },
+    scheduledEndTime: { $exists: true },
+    $or: or
+  }).select('operatingRoom surgeon scheduledDate scheduledEndTime').lean();
+}
+
+/**
+ * Propose a packed schedule for the clinic's awaiting-scheduling queue
+ *
+ * @param {Object} params
+ * @param {String} params.clinicId
+ * @param {Date} [params.startDate] - Defaults to tomorrow
+ * @param {number} [params.days=5]
+ * @param {Array} [params.roomIds] - Restrict to these OR rooms
+ * @param {Array} [params.caseIds] - Restrict to these cases
+ * @param {Object} [params.options]
+ */
+async function planSchedule(params = {}) {
+  const { clinicId, roomIds, caseIds, days = 5, options = {} } = params;
+  let { startDate } = params;
+  if (!startDate) {
+    startDate = new Date();
+    startDate.setDate(startDate.getDate() + 1);
+  }
+  startDate = startOfDay(startDate);
+
+  const caseQuery = { status: 'awaiting_scheduling', 'externalSurgery.isExternal': { $ne: true } };
+  if (clinicId) caseQuery.clinic = clinicId;
+  if (caseIds?.length) caseQuery._id = { $in: caseIds };
+
+  const [cases, rooms, durationModel] = await Promise.all([
+    SurgeryCase.find(caseQuery)
+      .select('patient surgeryType surgeon priority paymentDate estimatedDuration eye')
+      .populate('surgeryType', 'name code duration requiredEquipment')
+      .lean(),
+    loadRooms(clinicId, roomIds),
+    loadDurationModel(clinicId)
+  ]);
+
+  if (rooms.length === 0) {
+    return {
+      horizon: null,
+      assignments: [],
+      unscheduled: cases.map(c => ({ caseId: idOf(c), reason: 'no_or_rooms' })),
+      utilization: { byRoomDay: [], overall: 0 }
+    };
+  }
+
+  const surgeonIds = [...new Set(cases.map(c => idOf(c.surgeon)).filter(Boolean))];
+  const horizonEnd = new Date(startDate);
+  horizonEnd.setDate(horizonEnd.getDate() + days * 2 + 2); // Covers skipped weekends
+
+  const [bookings, availabilityBySurgeon] = await Promise.all([
+    loadBookings(rooms.map(r => r._id), surgeonIds, startDate, horizonEnd),
+    loadAvailability(clinicId, surgeonIds)
+  ]);
+
+  const plan = buildSchedule({
+    cases,
+    rooms,
+    bookings,
+    availabilityBySurgeon,
+    durationModel,
+    startDate,
+    days,
+    options
+  });
+
+  log.info('OR schedule planned', {
+    clinicId,
+    cases: cases.length,
+    scheduled: plan.assignments.length,
+    unscheduled: plan.unscheduled.length,
+    utilization: plan.utilization.overall
+  });
+
+  return plan;
+}
+
+/**
+ * Persist accepted assignments. Every slot is re-validated against current
+ * bookings, turnover included, so a stale plan can't double-book a room or
+ * surgeon. Runs in one transaction that first writes the rooms involved:
+ * concurrent applies on a room conflict, and the retry sees the other's cases.
+ *
+ * @param {Array} assignments - [{ caseId, roomId, scheduledDate, scheduledEndTime, estimatedDuration }]
+ * @param {String} userId
+ * @param {Object} [options] - { turnoverMinutes }
+ * @returns {Object} { scheduled: [], rejected: [] }
+ */
+async function applySchedule(assignments, userId, options = {}) {
+  if (!assignments?.length) return { scheduled: [], rejected: [] };
+
+  const turnoverMs = (options.turnoverMinutes ?? DEFAULT_TURNOVER_MINUTES) * 60000;
+  const caseIds = assignments.map(a => a.caseId);
+  const roomIds = [...new Set(assignments.map(a => String(a.roomId)))];
+  const from = new Date(Math.min(...assignments.map(a => new Date(a.scheduledDate).getTime())) - turnoverMs);
+  const to = new Date(Math.max(...assignments.map(a => new Date(a.scheduledEndTime).getTime())) + turnoverMs);
+
+  const result = await withTransactionRetry(async (session) => {
+    const scheduled = [];
+    const rejected = [];
+
+    await Room.updateMany({ _id: { $in: roomIds } }, { $set: { updatedAt: new Date() } }, { session });
+
+    const [cases, existing] = await Promise.all([
+      SurgeryCase.find({ _id: { $in: caseIds } }).select('status surgeon').session(session).lean(),
+      SurgeryCase.find({
+        _id: { $nin: caseIds },
+        status: { $in: ACTIVE_STATUSES },
+        scheduledDate: { $lt: to },
+        scheduledEndTime: { $gt: from },
+        $or: [{ operatingRoom: { $in: roomIds } }, { surgeon: { $exists: true, $ne: null } }]
+      }).select('operatingRoom surgeon scheduledDate scheduledEndTime').session(session).lean()
+    ]);
+    const caseById = new Map(cases.map(c => [idOf(c), c]));
+    const taken = existing.map(b => ({
+      roomId: idOf(b.operatingRoom),
+      surgeonId: idOf(b.surgeon),
+      start: new Date(b.scheduledDate),
+      end: new Date(b.scheduledEndTime)
+    }));
+
+    for (const assignment of assignments) {
+      const surgeryCase = caseById.get(String(assignment.caseId));
+      if (!surgeryCase || surgeryCase.status !== 'awaiting_scheduling') {
+        rejected.push({ caseId: assignment.caseId, reason: 'not_awaiting_scheduling' });
+        continue;
+      }
+
+      const start = new Date(assignment.scheduledDate);
+      const end = new Date(assignment.scheduledEndTime);
+      const roomId = String(assignment.roomId);
+      const surgeonId = idOf(surgeryCase.surgeon);
+      // The room needs turnover between cases; the surgeon only must not overlap
+      const clash = taken.find(t =>
+        (t.roomId === roomId && start.getTime() < t.end.getTime() + turnoverMs && end.getTime() + turnoverMs > t.start.getTime()) ||
+        (surgeonId && t.surgeonId === surgeonId && start < t.end && end > t.start));
+      if (clash) {
+        rejected.push({ caseId: assignment.caseId, reason: 'slot_conflict' });
+        continue;
+      }
+
+      // Only while still waiting: another apply may have scheduled it meanwhile
+      const update = await SurgeryCase.updateOne(
+        { _id: surgeryCase._id, status: 'awaiting_scheduling' },
+        {
+          $set: {
+            operatingRoom: assignment.roomId,
+            scheduledDate: start,
+            scheduledEndTime: end,
+            estimatedDuration: assignment.estimatedDuration || Math.round((end - start) / 60000),
+            status: 'scheduled',
+            updatedBy: userId
+          },
+          $push: {
+            statusHistory: { status: 'scheduled', changedAt: new Date(), changedBy: userId, notes: 'Programmé par l\'optimiseur de bloc' }
+          }
+        },
+        { session }
+      );
+      if (update.modifiedCount !== 1) {
+        rejected.push({ caseId: assignment.caseId, reason: 'not_awaiting_scheduling' });
+        continue;
+      }
+
+      taken.push({ roomId, surgeonId, start, end });
+      scheduled.push({ caseId: idOf(surgeryCase), roomId, scheduledDate: start, scheduledEndTime: end });
+    }
+
+    return { scheduled, rejected };
+  });
+
+  log.info('OR schedule applied', { scheduled: result.scheduled.length, rejected: result.rejected.length, userId });
+  return result;
+}
+
+/**
+ * Propose backfill for the room time freed by a cancelled case.
+ * The gap spans from the previous booking's end to the next booking's start,
+ * less turnover on both sides.
+ *
+ * @param {Object} cancelledCase - SurgeryCase that was just cancelled
+ * @returns {Object|null} fillGap result, or null if nothing was freed
+ */
+async function proposeBackfill(cancelledCase, options = {}) {
+  if (!cancelledCase?.operatingRoom || !cancelledCase.scheduledDate || !cancelledCase.scheduledEndTime) {
+    return null;
+  }
+
+  const now = options.now || new Date();
+  if (new Date(cancelledCase.scheduledEndTime) <= now) return null;
+
+  const room = await Room.findById(cancelledCase.operatingRoom)
+    .select('_id name roomNumber equipment features operatingHours clinic').lean();
+  if (!room) return null;
+
+  const day = startOfDay(cancelledCase.scheduledDate);
+  const window = roomWindow(room, day);
+  if (!window) return null;
+  const dayEnd = new Date(day);
+  dayEnd.setHours(23, 59, 59, 999);
+
+  const clinicId = cancelledCase.clinic || room.clinic;
+  const [dayBookings, candidates, durationModel] = await Promise.all([
+    SurgeryCase.find({
+      _id: { $ne: cancelledCase._id },
+      status: { $in: ACTIVE_STATUSES },
+      scheduledDate: { $gte: day, $lte: dayEnd },
+      scheduledEndTime: { $exists: true }
+    }).select('operatingRoom surgeon scheduledDate scheduledEndTime').lean(),
+    SurgeryCase.find({
+      status: 'awaiting_scheduling',
+      'externalSurgery.isExternal': { $ne: true },
+      ...(clinicId && { clinic: clinicId })
+    })
+      .select('patient surgeryType surgeon priority paymentDate estimatedDuration eye')
+      .populate('surgeryType', 'name code duration requiredEquipment')
+      .lean(),
+    loadDurationModel(clinicId)
+  ]);
+
+  if (candidates.length === 0) return null;
+
+  const roomId = idOf(room);
+  const turnover = options.turnoverMinutes ?? DEFAULT_TURNOVER_MINUTES;
+  const sameRoom = dayBookings.filter(b => idOf(b.operatingRoom) === roomId);
+  const cancelledStart = new Date(cancelledCase.scheduledDate);
+
+  const previous = sameRoom
+    .filter(b => new Date(b.scheduledEndTime) <= cancelledStart)
+    .reduce((latest, b) => Math.max(latest, minutesOfDay(new Date(b.scheduledEndTime)) + turnover), window[0]);
+  // A backfilled case must end a turnover before the next case starts
+  const next = sameRoom
+    .filter(b => new Date(b.scheduledDate) >= cancelledStart)
+    .reduce((earliest, b) => Math.min(earliest, minutesOfDay(new Date(b.scheduledDate)) - turnover), window[1]);
+
+  let gapStartMinutes = previous;
+  if (dayKey(now) === dayKey(day)) gapStartMinutes = Math.max(gapStartMinutes, roundUp(minutesOfDay(now)));
+  if (next - gapStartMinutes < SLOT_GRANULARITY_MINUTES) return null;
+
+  const surgeonIds = [...new Set(candidates.map(c => idOf(c.surgeon)).filter(Boolean))];
+  const availabilityBySurgeon = await loadAvailability(clinicId, surgeonIds);
+
+  const result = fillGap({
+    room,
+    gapStart: atMinutes(day, gapStartMinutes),
+    gapEnd: atMinutes(day, next),
+    cases: candidates,
+    bookings: dayBookings.filter(b => idOf(b.operatingRoom) !== roomId),
+    availabilityBySurgeon,
+    durationModel,
+    options: { ...options, now }
+  });
+
+  log.info('OR backfill proposed', {
+    cancelledCaseId: idOf(cancelledCase),
+    roomId,
+    proposals: result.assignments.length,
+    filledMinutes: result.filledMinutes
+  });
+
+  return result;
+}
+
+module.exports = {
+  planSchedule,
+  applySchedule,
+  proposeBackfill,
+  loadDurationModel,
+  // Pure planner (exported for tests and simulations)
+  buildSchedule,
+  fillGap,
+  buildDurationModel,
+  predictDuration,
+  scoreCase,
+  DEFAULT_TURNOVER_MINUTES
+};
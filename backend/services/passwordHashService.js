@@ -0,0 +1,208 @@
+/**
+ * Password Hash Service
+ *
+ * Off-event-loop password hashing for authentication:
+ * - Fixed-size worker-thread pool running scrypt / legacy bcrypt
+ * - Parallel verification against password history entries
+ * - needsRehash for transparent upgrade of legacy bcrypt hashes on login
+ * - Bounded queue so a login storm fails fast instead of exhausting memory
+ *
+ * PASSWORD_HASH_WORKERS=0 runs inline (main thread), for environments
+ * where worker threads are unavailable.
+ */
+
+const os = require('os');
+const path = require('path');
+const { Worker } = require('worker_threads');
+const passwordHash = require('../utils/passwordHash');
+const { createContextLogger } = require('../utils/structuredLogger');
+
+const log = createContextLogger('PasswordHash');
+
+// ============================================
+// CONSTANTS
+// ============================================
+
+const WORKER_PATH = path.join(__dirname, 'workers', 'passwordHashWorker.js');
+const DEFAULT_POOL_SIZE = Math.max(1, Math.min(4, os.cpus().length - 1));
+const MAX_QUEUE = 1000;
+
+function configuredPoolSize() {
+  const value = parseInt(process.env.PASSWORD_HASH_WORKERS, 10);
+  return Number.isFinite(value) && value >= 0 ? value : DEFAULT_POOL_SIZE;
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+class PasswordHashService {
+  constructor({ size = configuredPoolSize(), maxQueue = MAX_QUEUE } = {}) {
+    this.size = size;
+    this.maxQueue = maxQueue;
+    this.workers = [];
+    this.idle = [];
+    this.queue = [];
+    this.inFlight = new Map(); // worker -> task
+    this.nextId = 1;
+    this.stats = { completed: 0, failed: 0, rejected: 0, workerRestarts: 0 };
+  }
+
+  /**
+   * Hash a password with the current algorithm
+   * @param {String} password - Plain text password
+   * @returns {Promise<String>}
+   */
+  hash(password) {
+    return this._run({ op: 'hash', password: String(password) });
+  }
+
+  /**
+   * Verify a password against a stored hash (scrypt or legacy bcrypt)
+   * @returns {Promise<Boolean>}
+   */
+  verify(password, hash) {
+    if (!hash) return Promise.resolve(false);
+    return this._run({ op: 'verify', password: String(password), hash });
+  }
+
+  /**
+   * Verify against several hashes at once (password history); the
+   * comparisons are spread over the pool instead of run one by one
+   * @returns {Promise<Boolean>} - true when any hash matches
+   */
+  async verifyAny(password, hashes) {
+    const candidates = (hashes || []).filter(Boolean);
+    if (candidates.length === 0) return false;
+    const results = await Promise.all(candidates.map(hash => this.verify(password, hash)));
+    return results.some(Boolean);
+  }
+
+  needsRehash(hash) {
+    return passwordHash.needsRehash(hash);
+  }
+
+  _run(task) {
+    if (this.size === 0) {
+      return new Promise((resolve, reject) => {
+        setImmediate(() => {
+          try {
+            resolve(this._runInline(task));
+          } catch (error) {
+            reject(error);
+          }
+        });
+      });
+    }
+
+    if (this.queue.length >= this.maxQueue) {
+      this.stats.rejected++;
+      return Promise.reject(new Error('Password hashing queue is full'));
+    }
+
+    return new Promise((resolve, reject) => {
+      this.queue.push({ ...task, id: this.nextId++, resolve, reject });
+      this._drain();
+    });
+  }
+
+  _runInline({ op, password, hash }) {
+    const result = op === 'hash'
+      ? passwordHash.hashPasswordSync(password)
+      : passwordHash.verifyPasswordSync(password, hash);
+    this.stats.completed++;
+    return result;
+  }
+
+  _drain() {
+    while (this.queue.length > 0) {
+      const worker = this.idle.pop() || this._spawn();
+      if (!worker) return;
+
+      const task = this.queue.shift();
+      this.inFlight.set(worker, task);
+      worker.postMessage({ id: task.id, op: task.op, password: task.password, hash: task.hash });
+    }
+  }
+
+  _spawn() {
+    if (this.workers.length >= this.size) return null;
+
+    const worker = new Worker(WORKER_PATH);
+    worker.unref(); // Never keep the process alive on its own
+
+    worker.on('message', ({ id, result, error }) => {
+      const task = this.inFlight.get(worker);
+      this.inFlight.delete(worker);
+      this.idle.push(worker);
+
+      if (task && task.id === id) {
+        if (error) {
+          this.stats.failed++;
+          task.reject(new Error(error));
+        } else {
+          this.stats.completed++;
+          task.resolve(result);
+        }
+      }
+      this._drain();
+    });
+
+    worker.on('error', (error) => {
+      log.error('Password hash worker crashed', { error: error.message });
+      this._replace(worker, error);
+    });
+
+    worker.on('exit', (code) => {
+      if (this.workers.includes(worker)) {
+        this._replace(worker, new Error(`Password hash worker exited with code ${code}`));
+      }
+    });
+
+    this.workers.push(worker);
+    return worker;
+  }
+
+  _replace(worker, error) {
+    this.workers = this.workers.filter(w => w !== worker);
+    this.idle = this.idle.filter(w => w !== worker);
+
+    const task = this.inFlight.get(worker);
+    this.inFlight.delete(worker);
+    if (task) {
+      this.stats.failed++;
+      task.reject(error);
+    }
+
+    this.stats.workerRestarts++;
+    this._drain();
+  }
+
+  getStatus() {
+    return {
+      mode: this.size === 0 ? 'inline' : 'workers',
+      poolSize: this.size,
+      workers: this.workers.length,
+      busy: this.inFlight.size,
+      queued: this.queue.length,
+      ...this.stats
+    };
+  }
+
+  async shutdown() {
+    const workers = this.workers;
+    this.workers = [];
+    this.idle = [];
+
+    for (const task of [...this.queue, ...this.inFlight.values()]) {
+      task.reject(new Error('Password hash service shut down'));
+    }
+    this.queue = [];
+    this.inFlight.clear();
+
+    await Promise.all(workers.map(worker => worker.terminate()));
+  }
+}
+
+module.exports = new PasswordHashService();
+module.exports.PasswordHashService = PasswordHashService;
@@ -0,0 +1,968 @@
+/**
+ * Patient Flow Service
+ * Routes checked-in ophthalmology patients across examination stations
+ * (autorefraction, tonometry, visual field, OCT, then the doctor) so free
+ * stations pick up the patient who shortens the day the most, instead of
+ * each department queue calling its own next patient.
+ *
+ * - Each visit carries the stations it still needs (Appointment.flow);
+ *   pre-tests in any order, the doctor last
+ * - Station durations predicted from the clinic's completed stations
+ * - Station availability from room occupancy (Room.status / currentAppointment)
+ * - Next assignments chosen by rollout: each candidate patient–station pair
+ *   is played forward with a greedy policy and the one with the lowest
+ *   remaining visit time plus doctor idle time wins
+ * - Assigned rooms are reserved and the assignment pushed to station screens
+ *   (queue_update, type flow_assignment); unclaimed reservations lapse
+ * - Replay of a historical day under the linear queues or the router
+ *
+ * The simulator (createState / run / recommend / replayDay) is pure and works
+ * on plain objects with times in minutes; the async wrappers load rooms and
+ * appointments and persist assignments.
+ *
+ * Configuration (environment):
+ * - PATIENT_FLOW_ENABLED: set to false to stop dispatching on check-in / station completion
+ * - PATIENT_FLOW_ASSIGNMENT_TIMEOUT_MINUTES: reservation kept for a called patient (default 5)
+ * - PATIENT_FLOW_TRANSFER_MINUTES: walk between stations (default 1)
+ * - PATIENT_FLOW_HISTORY_DAYS: station durations history (default 30)
+ */
+
+const { getTodayRange, getDayRange } = require('../utils/dateUtils');
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('PatientFlow');
+
+const DOCTOR = 'doctor';
+
+// Pre-test stations come from room features, the doctor from consulting rooms
+const STATIONS = {
+  autorefraction: { label: 'Autoréfractomètre', features: ['autorefractor'], defaultMinutes: 5 },
+  tonometry: { label: 'Tonométrie', features: ['tonometer'], defaultMinutes: 5 },
+  visual_field: { label: 'Champ visuel', features: ['perimeter'], defaultMinutes: 15 },
+  oct: { label: 'OCT', features: ['oct'], defaultMinutes: 10 },
+  [DOCTOR]: { label: 'Consultation', roomTypes: ['consultation', 'ophthalmology'], defaultMinutes: 15 }
+};
+
+// Stations a visit needs when none were set on the appointment
+const DEFAULT_ROUTES = {
+  ophthalmology: ['autorefraction', 'tonometry', DOCTOR],
+  consultation: ['autorefraction', 'tonometry', DOCTOR],
+  'routine-checkup': ['autorefraction', 'tonometry', DOCTOR],
+  'follow-up': ['tonometry', DOCTOR],
+  refraction: ['autorefraction', DOCTOR],
+  imaging: ['oct']
+};
+
+// Same order as callNext
+const PRIORITY_RANK = {
+  emergency: 6,
+  urgent: 5,
+  vip: 4,
+  pregnant: 3,
+  elderly: 2,
+  high: 1,
+  normal: 0
+};
+
+// A doctor minute lost delays every patient behind
+const DOCTOR_IDLE_WEIGHT = 3;
+// Candidate pairs played forward per free station
+const ROLLOUT_PER_STATION = 3;
+const MAX_SIMULATION_STEPS = 100000;
+
+// Duration model
+const MIN_HISTORY_SAMPLES = 5;
+const MIN_PLAUSIBLE_MINUTES = 1;
+const MAX_PLAUSIBLE_MINUTES = 120;
+const MODEL_CACHE_MS = 10 * 60 * 1000;
+
+const INACTIVE_ROOM_STATUSES = ['cleaning', 'maintenance', 'closed'];
+
+// ============================================
+// CONFIGURATION
+// ============================================
+
+function loadSettings(env = process.env) {
+  return {
+    enabled: env.PATIENT_FLOW_ENABLED !== 'false',
+    assignmentTimeoutMinutes: parseInt(env.PATIENT_FLOW_ASSIGNMENT_TIMEOUT_MINUTES, 10) || 5,
+    transferMinutes: parseFloat(env.PATIENT_FLOW_TRANSFER_MINUTES) >= 0 ? parseFloat(env.PATIENT_FLOW_TRANSFER_MINUTES) : 1,
+    historyDays: parseInt(env.PATIENT_FLOW_HISTORY_DAYS, 10) || 30
+  };
+}
+
+const settings = loadSettings();
+
+// ============================================
+// HELPERS
+// ============================================
+
+const idOf = (value) => (value && value._id ? String(value._id) : value ? String(value) : null);
+const toMinutes = (date) => new Date(date).getTime() / 60000;
+const toDate = (minutes) => new Date(Math.round(minutes * 60000));
+
+function median(values) {
+  const sorted = [...values].sort((a, b) => a - b);
+  const middle = Math.floor(sorted.length / 2);
+  return sorted.length % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+}
+
+/**
+ * Stations a room can serve (one patient at a time whatever the station)
+ * @param {Object} room - Room (type, features, assignedProviders)
+ * @returns {Array} Station keys
+ */
+function roomServes(room) {
+  const hasDoctor = (room.assignedProviders?.length > 0) || Boolean(room.currentProvider);
+  if (STATIONS[DOCTOR].roomTypes.includes(room.type) && hasDoctor) return [DOCTOR];
+
+  const features = room.features || [];
+  return Object.entries(STATIONS)
+    .filter(([, station]) => station.features?.some(feature => features.includes(feature)))
+    .map(([key]) => key);
+}
+
+function defaultRoute(appointmentType) {
+  return DEFAULT_ROUTES[appointmentType] || null;
+}
+
+// ============================================
+// DURATION MODEL
+// ============================================
+
+/**
+ * Median duration per station from completed stations
+ * @param {Array} samples - [{ station, minutes }]
+ * @returns {Map} station -> { count, median }
+ */
+function buildDurationModel(samples = []) {
+  const byStation = new Map();
+  for (const sample of samples) {
+    const minutes = Number(sample.minutes);
+    if (!STATIONS[sample.station] || !Number.isFinite(minutes) ||
+        minutes < MIN_PLAUSIBLE_MINUTES || minutes > MAX_PLAUSIBLE_MINUTES) {
+      continue;
+    }
+    if (!byStation.has(sample.station)) byStation.set(sample.station, []);
+    byStation.get(sample.station).push(minutes);
+  }
+
+  const model = new Map();
+  for (const [station, values] of byStation) {
+    model.set(station, { count: values.length, median: median(values) });
+  }
+  return model;
+}
+
+/**
+ * Expected minutes at a station
+ * @returns {Object} { minutes, source }
+ */
+function predictStationMinutes(model, station) {
+  const history = model?.get(station);
+  if (history && history.count >= MIN_HISTORY_SAMPLES) {
+    return { minutes: history.median, source: 'history' };
+  }
+  return { minutes: STATIONS[station].defaultMinutes, source: 'default' };
+}
+
+// ============================================
+// SIMULATOR
+// ============================================
+
+/**
+ * Build a simulation state. Times are in minutes.
+ * @param {Object} input
+ * @param {Number} input.now
+ * @param {Array} input.stations - [{ id, serves: [station], providerId, freeAt }]
+ * @param {Array} input.visits - [{ id, priority, arrivedAt, providerId, readyAt, remaining: [{ station, minutes }] }]
+ * @param {Boolean} input.ordered - Stations in route order (linear department queues)
+ * @returns {Object} State
+ */
+function createState({ now, stations, visits, ordered = false, transferMinutes = settings.transferMinutes }) {
+  const served = new Set(stations.flatMap(station => station.serves));
+  const doctorProviders = new Set(stations
+    .filter(station => station.serves.includes(DOCTOR) && station.providerId)
+    .map(station => String(station.providerId)));
+  const anyDoctor = stations.some(station => station.serves.includes(DOCTOR) && !station.providerId);
+
+  const unroutable = [];
+  const state = {
+    now,
+    ordered,
+    transferMinutes,
+    doctorIdle: 0,
+    assignments: [],
+    unroutable,
+    stations: stations.map(station => ({
+      id: String(station.id),
+      serves: station.serves,
+      providerId: station.providerId ? String(station.providerId) : null,
+      freeAt: station.freeAt ?? now
+    })),
+    visits: visits.map(visit => {
+      const remaining = [];
+      for (const entry of visit.remaining) {
+        if (served.has(entry.station)) remaining.push({ ...entry });
+        else unroutable.push({ visitId: String(visit.id), station: entry.station });
+      }
+      // A doctor with no room today: any doctor will do
+      const providerId = visit.providerId && (doctorProviders.has(String(visit.providerId)) || !anyDoctor)
+        ? String(visit.providerId)
+        : null;
+      const readyAt = visit.readyAt ?? visit.arrivedAt;
+      return {
+        id: String(visit.id),
+        priority: visit.priority || 'normal',
+        arrivedAt: visit.arrivedAt,
+        providerId,
+        readyAt,
+        remaining,
+        finishedAt: remaining.length === 0 ? readyAt : null
+      };
+    })
+  };
+  state.visitsById = new Map(state.visits.map(visit => [visit.id, visit]));
+  return state;
+}
+
+/**
+ * Copy of a state for a rollout; the router does not know who arrives later
+ */
+function cloneState(state, presentOnly = false) {
+  const clone = {
+    ...state,
+    assignments: [],
+    stations: state.stations.map(station => ({ ...station })),
+    visits: state.visits
+      .filter(visit => !presentOnly || visit.arrivedAt <= state.now)
+      .map(visit => ({ ...visit, remaining: visit.remaining.map(entry => ({ ...entry })) }))
+  };
+  clone.visitsById = new Map(clone.visits.map(visit => [visit.id, visit]));
+  return clone;
+}
+
+function providerMatches(station, visit) {
+  return !station.serves.includes(DOCTOR) || !visit.providerId || !station.providerId || station.providerId === visit.providerId;
+}
+
+const needsDoctor = (visit) => visit.remaining.some(entry => entry.station === DOCTOR);
+
+/**
+ * Entry of `visit` that `station` can take now, if any
+ */
+function eligibleEntry(state, station, visit) {
+  if (station.freeAt > state.now || visit.finishedAt !== null ||
+      visit.arrivedAt > state.now || visit.readyAt > state.now) {
+    return null;
+  }
+
+  if (state.ordered) {
+    const next = visit.remaining[0];
+    return next && station.serves.includes(next.station) && providerMatches(station, visit) ? next : null;
+  }
+
+  const preTests = visit.remaining.filter(entry => entry.station !== DOCTOR);
+  if (preTests.length > 0) {
+    return preTests.find(entry => station.serves.includes(entry.station)) || null;
+  }
+  return station.serves.includes(DOCTOR) && providerMatches(station, visit) ? visit.remaining[0] : null;
+}
+
+/**
+ * Queue order: priority, then time in the clinic
+ */
+function greedyScore(state, visit) {
+  return (PRIORITY_RANK[visit.priority] || 0) * 1000 + (state.now - visit.arrivedAt);
+}
+
+function candidatePairs(state) {
+  const pairs = [];
+  for (const station of state.stations) {
+    if (station.freeAt > state.now) continue;
+    for (const visit of state.visits) {
+      const entry = eligibleEntry(state, station, visit);
+      if (entry) pairs.push({ station, visit, entry, score: greedyScore(state, visit) });
+    }
+  }
+  return pairs.sort((a, b) => b.score - a.score);
+}
+
+function assign(state, station, visit, entry) {
+  visit.remaining.splice(visit.remaining.indexOf(entry), 1);
+  const end = state.now + entry.minutes;
+  station.freeAt = end;
+  if (visit.remaining.length === 0) {
+    visit.finishedAt = end;
+    visit.readyAt = end;
+  } else {
+    visit.readyAt = end + state.transferMinutes;
+  }
+  state.assignments.push({ stationId: station.id, visitId: visit.id, station: entry.station, start: state.now, end });
+}
+
+/**
+ * Move the clock to the next event, counting doctor time lost while a
+ * patient who still needs that doctor is elsewhere
+ * @returns {Boolean} false when nothing is left to happen
+ */
+function advance(state) {
+  let next = Infinity;
+  for (const station of state.stations) {
+    if (station.freeAt > state.now) next = Math.min(next, station.freeAt);
+  }
+  for (const visit of state.visits) {
+    if (visit.finishedAt !== null) continue;
+    if (visit.arrivedAt > state.now) next = Math.min(next, visit.arrivedAt);
+    else if (visit.readyAt > state.now) next = Math.min(next, visit.readyAt);
+  }
+  if (next === Infinity) return false;
+
+  const elapsed = next - state.now;
+  for (const station of state.stations) {
+    if (!station.serves.includes(DOCTOR) || station.freeAt > state.now) continue;
+    const starved = state.visits.some(visit => visit.finishedAt === null && visit.arrivedAt <= state.now &&
+      needsDoctor(visit) && providerMatches(station, visit));
+    if (starved) state.doctorIdle += elapsed;
+  }
+  state.now = next;
+  return true;
+}
+
+/**
+ * Base policy: best queue position first
+ */
+function greedyPick(state) {
+  return candidatePairs(state)[0] || null;
+}
+
+/**
+ * Router policy: play the best few pairs of each free station forward with
+ * the greedy policy and keep the one that ends the day soonest
+ */
+function routerPick(state) {
+  const pairs = candidatePairs(state);
+  if (pairs.length <= 1) return pairs[0] || null;
+
+  const perStation = new Map();
+  const shortlist = pairs.filter(pair => {
+    const count = perStation.get(pair.station.id) || 0;
+    perStation.set(pair.station.id, count + 1);
+    return count < ROLLOUT_PER_STATION;
+  });
+
+  let best = null;
+  for (const pair of shortlist) {
+    const trial = cloneState(state, true);
+    const station = trial.stations.find(candidate => candidate.id === pair.station.id);
+    const visit = trial.visitsById.get(pair.visit.id);
+    assign(trial, station, visit, visit.remaining[pair.visit.remaining.indexOf(pair.entry)]);
+    run(trial, greedyPick);
+
+    const cost = objective(trial);
+    if (!best || cost < best.cost - 1e-9) best = { pair, cost };
+  }
+  return best.pair;
+}
+
+function objective(state) {
+  let visitMinutes = 0;
+  for (const visit of state.visits) {
+    visitMinutes += (visit.finishedAt ?? state.now) - visit.arrivedAt;
+  }
+  return visitMinutes + DOCTOR_IDLE_WEIGHT * state.doctorIdle;
+}
+
+/**
+ * Simulate until every visit is done
+ * @param {Object} state - From createState (mutated)
+ * @param {Function} pick - greedyPick or routerPick
+ */
+function run(state, pick) {
+  for (let step = 0; step < MAX_SIMULATION_STEPS; step++) {
+    let pair;
+    while ((pair = pick(state))) assign(state, pair.station, pair.visit, pair.entry);
+    if (state.visits.every(visit => visit.finishedAt !== null)) break;
+    if (!advance(state)) break;
+  }
+  return state;
+}
+
+/**
+ * Day metrics of a simulated state
+ */
+function summarize(state) {
+  const durations = state.visits
+    .filter(visit => visit.finishedAt !== null)
+    .map(visit => visit.finishedAt - visit.arrivedAt)
+    .sort((a, b) => a - b);
+  const total = durations.reduce((sum, minutes) => sum + minutes, 0);
+
+  return {
+    visits: durations.length,
+    unfinished: state.visits.length - durations.length,
+    meanVisitMinutes: durations.length ? Math.round((total / durations.length) * 10) / 10 : 0,
+    p90VisitMinutes: durations.length ? Math.round(durations[Math.min(durations.length - 1, Math.floor(durations.length * 0.9))]) : 0,
+    doctorIdleMinutes: Math.round(state.doctorIdle),
+    lastFinish: Math.max(...state.visits.map(visit => visit.finishedAt ?? state.now))
+  };
+}
+
+/**
+ * Assignments for the stations free right now
+ * @param {Object} input - createState input (unordered)
+ * @returns {Object} { assignments: [{ stationId, visitId, station, minutes }], forecast, unroutable }
+ */
+function recommend(input) {
+  const state = createState({ ...input, ordered: false });
+  const assignments = [];
+
+  let pair;
+  while ((pair = routerPick(state))) {
+    assignments.push({
+      stationId: pair.station.id,
+      visitId: pair.visit.id,
+      station: pair.entry.station,
+      minutes: pair.entry.minutes
+    });
+    assign(state, pair.station, pair.visit, pair.entry);
+  }
+
+  run(state, greedyPick);
+  return { assignments, forecast: summarize(state), unroutable: state.unroutable };
+}
+
+/**
+ * Replay a day with its actual arrivals and station durations
+ * @param {Object} day - { stations: [{ id, serves, providerId }], visits: [{ id, priority, arrivedAt, providerId, remaining: [{ station, minutes }] }] }
+ * @param {String} policy - 'linear' (department queues, route order) or 'router'
+ * @returns {Object} summarize() metrics and the assignments made
+ */
+function replayDay(day, policy = 'router') {
+  const start = Math.min(...day.visits.map(visit => visit.arrivedAt));
+  const state = createState({
+    now: start,
+    stations: day.stations.map(station => ({ ...station, freeAt: start })),
+    visits: day.visits,
+    ordered: policy === 'linear',
+    transferMinutes: day.transferMinutes ?? settings.transferMinutes
+  });
+
+  run(state, policy === 'router' ? routerPick : greedyPick);
+  return { policy, ...summarize(state), assignments: state.assignments };
+}
+
+// ============================================
+// DATA ACCESS (MongoDB)
+// ============================================
+
+// Required lazily so the simulator can be loaded without the models
+const models = () => ({
+  Appointment: require('../models/Appointment'),
+  Room: require('../models/Room')
+});
+
+const modelCache = new Map();
+
+async function loadDurationModel(clinicId) {
+  const key = idOf(clinicId) || 'all';
+  const cached = modelCache.get(key);
+  if (cached && Date.now() - cached.loadedAt < MODEL_CACHE_MS) return cached.model;
+
+  const since = new Date(Date.now() - settings.historyDays * 24 * 60 * 60 * 1000);
+  const appointments = await models().Appointment.find({
+    ...(clinicId && { clinic: clinicId }),
+    'flow.stations.completedAt': { $gte: since }
+  }).select('flow.stations').lean();
+
+  const samples = [];
+  for (const appointment of appointments) {
+    for (const entry of appointment.flow.stations) {
+      if (entry.status === 'done' && entry.startedAt && entry.completedAt) {
+        samples.push({ station: entry.station, minutes: (entry.completedAt - entry.startedAt) / 60000 });
+      }
+    }
+  }
+
+  const model = buildDurationModel(samples);
+  modelCache.set(key, { model, loadedAt: Date.now() });
+  return model;
+}
+
+function flowStations(appointment) {
+  if (appointment.flow?.stations?.length) return appointment.flow.stations;
+  return (defaultRoute(appointment.type) || []).map(station => ({ station, status: 'pending' }));
+}
+
+/**
+ * Current stations and visits of a clinic as simulator input
+ */
+async function loadFlowState(clinicId, now = new Date()) {
+  const { Appointment, Room } = models();
+  const { start, end } = getTodayRange();
+
+  const [rooms, appointments, durationModel] = await Promise.all([
+    Room.find({ clinic: clinicId, isActive: true, isDeleted: { $ne: true } })
+      .select('roomNumber name type features status currentAppointment currentProvider assignedProviders occupiedAt')
+      .lean(),
+    Appointment.find({
+      clinic: clinicId,
+      date: { $gte: start, $lte: end },
+      department: 'ophthalmology',
+      status: { $in: ['checked-in', 'in-progress'] }
+    })
+      .select('patient provider type priority queueNumber checkInTime status flow')
+      .populate('patient', 'firstName lastName patientId')
+      .lean(),
+    loadDurationModel(clinicId)
+  ]);
+
+  const nowMinutes = toMinutes(now);
+  const transfer = settings.transferMinutes;
+  const minutesFor = (station) => predictStationMinutes(durationModel, station).minutes;
+  const appointmentsById = new Map(appointments.map(appointment => [idOf(appointment), appointment]));
+
+  const visits = [];
+  for (const appointment of appointments) {
+    // Called straight to the doctor (callNext): outside the station flow
+    if (appointment.status === 'in-progress' && !appointment.flow?.stations?.length) continue;
+
+    const stations = flowStations(appointment);
+    const remaining = stations
+      .filter(entry => entry.status === 'pending')
+      .map(entry => ({ station: entry.station, minutes: minutesFor(entry.station) }));
+    if (remaining.length === 0) continue;
+
+    // At a station, or walking to an assigned one
+    let readyAt = nowMinutes;
+    const active = stations.find(entry => entry.status === 'in_progress' || entry.status === 'assigned');
+    if (active) {
+      const startedAt = active.startedAt ? toMinutes(active.startedAt) : toMinutes(active.assignedAt || now) + transfer;
+      readyAt = Math.max(startedAt + minutesFor(active.station) + transfer, nowMinutes + 1);
+    }
+
+    visits.push({
+      id: idOf(appointment),
+      priority: appointment.priority,
+      arrivedAt: appointment.checkInTime ? toMinutes(appointment.checkInTime) : nowMinutes,
+      providerId: idOf(appointment.provider),
+      readyAt,
+      remaining
+    });
+  }
+
+  const stations = [];
+  for (const room of rooms) {
+    const serves = roomServes(room);
+    if (serves.length === 0 || INACTIVE_ROOM_STATUSES.includes(room.status)) continue;
+
+    let freeAt = nowMinutes;
+    if (room.status === 'occupied' || room.status === 'reserved') {
+      const occupant = appointmentsById.get(idOf(room.currentAppointment));
+      const active = occupant && flowStations(occupant).find(entry => entry.status === 'in_progress' || entry.status === 'assigned');
+      const since = room.occupiedAt ? toMinutes(room.occupiedAt) : nowMinutes;
+      const expected = since + minutesFor(active?.station || serves[0]) + (room.status === 'reserved' ? transfer : 0);
+      freeAt = Math.max(expected, nowMinutes + 1);
+    }
+
+    stations.push({
+      id: idOf(room),
+      serves,
+      providerId: serves.includes(DOCTOR)
+        ? idOf(room.currentProvider) || (room.assignedProviders?.length === 1 ? idOf(room.assignedProviders[0]) : null)
+        : null,
+      freeAt
+    });
+  }
+
+  return {
+    input: { now: nowMinutes, stations, visits },
+    rooms: new Map(rooms.map(room => [idOf(room), room])),
+    appointments: appointmentsById
+  };
+}
+
+function describeAssignment(assignment, flowState) {
+  const room = flowState.rooms.get(assignment.stationId);
+  const appointment = flowState.appointments.get(assignment.visitId);
+  return {
+    appointmentId: assignment.visitId,
+    queueNumber: appointment?.queueNumber,
+    patient: appointment?.patient && {
+      _id: appointment.patient._id,
+      firstName: appointment.patient.firstName,
+      lastName: appointment.patient.lastName,
+      patientId: appointment.patient.patientId
+    },
+    roomId: assignment.stationId,
+    room: room?.roomNumber,
+    roomName: room?.name,
+    station: assignment.station,
+    estimatedMinutes: Math.round(assignment.minutes)
+  };
+}
+
+/**
+ * Stations, waiting patients and the assignments the router would make now
+ * (nothing reserved)
+ */
+async function getFlowOverview(clinicId, now = new Date()) {
+  const flowState = await loadFlowState(clinicId, now);
+  const { assignments, forecast, unroutable } = recommend(flowState.input);
+
+  return {
+    stations: flowState.input.stations.map(station => {
+      const room = flowState.rooms.get(station.id);
+      return {
+        roomId: station.id,
+        room: room.roomNumber,
+        name: room.name,
+        serves: station.serves,
+        status: room.status,
+        freeAt: toDate(station.freeAt)
+      };
+    }),
+    waiting: flowState.input.visits.map(visit => ({
+      appointmentId: visit.id,
+      queueNumber: flowState.appointments.get(visit.id)?.queueNumber,
+      remaining: visit.remaining.map(entry => entry.station),
+      readyAt: toDate(visit.readyAt)
+    })),
+    recommendations: assignments.map(assignment => describeAssignment(assignment, flowState)),
+    forecast: { ...forecast, lastFinish: forecast.visits ? toDate(forecast.lastFinish) : null },
+    unroutable
+  };
+}
+
+/**
+ * Put back patients who never reached the room reserved for them
+ */
+async function releaseExpiredAssignments(clinicId, now = new Date()) {
+  const { Appointment, Room } = models();
+  const cutoff = new Date(now.getTime() - settings.assignmentTimeoutMinutes * 60 * 1000);
+
+  const { start, end } = getTodayRange();
+  const expired = await Appointment.find({
+    clinic: clinicId,
+    date: { $gte: start, $lte: end },
+    'flow.assignedRoom': { $ne: null },
+    'flow.assignedAt': { $lt: cutoff }
+  }).select('flow.assignedRoom').lean();
+
+  for (const appointment of expired) {
+    await releaseAssignment(appointment._id, appointment.flow.assignedRoom, { Appointment, Room });
+  }
+  if (expired.length > 0) log.info('Flow assignments expired', { clinicId: idOf(clinicId), count: expired.length });
+  return expired.length;
+}
+
+async function releaseAssignment(appointmentId, roomId, { Appointment, Room } = models()) {
+  await Appointment.updateOne(
+    { _id: appointmentId, 'flow.assignedRoom': roomId },
+    {
+      $set: { 'flow.stations.$[entry].status': 'pending', 'flow.assignedRoom': null },
+      $unset: { 'flow.stations.$[entry].room': 1, 'flow.stations.$[entry].assignedAt': 1, 'flow.assignedAt': 1 }
+    },
+    { arrayFilters: [{ 'entry.status': 'assigned' }] }
+  );
+  await Room.updateOne(
+    { _id: roomId, status: 'reserved', currentAppointment: appointmentId },
+    { $set: { status: 'available', currentPatient: null, currentAppointment: null } }
+  );
+}
+
+/**
+ * Conditional update marking one pending station assigned. Only that entry is
+ * written: stations the doctor adds or completes meanwhile are kept, and an
+ * entry no longer pending (or removed) makes the update miss.
+ * @returns {Array} updateOne arguments [filter, update, options]
+ */
+function assignmentUpdate(appointment, station, roomId, now) {
+  const assignment = { 'flow.assignedRoom': roomId, 'flow.assignedAt': now };
+
+  if (!appointment.flow?.stations?.length) {
+    // Route not stored yet: write it, unless another request just did
+    let marked = false;
+    const stations = flowStations(appointment).map(entry => {
+      if (!marked && entry.status === 'pending' && entry.station === station) {
+        marked = true;
+        return { ...entry, status: 'assigned', room: roomId, assignedAt: now };
+      }
+      return entry;
+    });
+    return [
+      { _id: appointment._id, 'flow.assignedRoom': null, 'flow.stations.0': { $exists: false } },
+      { $set: { 'flow.stations': stations, ...assignment } }
+    ];
+  }
+
+  return [
+    { _id: appointment._id, 'flow.assignedRoom': null, 'flow.stations': { $elemMatch: { status: 'pending', station } } },
+    { $set: { 'flow.stations.$[entry].status': 'assigned', 'flow.stations.$[entry].room': roomId, 'flow.stations.$[entry].assignedAt': now, ...assignment } },
+    { arrayFilters: [{ 'entry.status': 'pending', 'entry.station': station }] }
+  ];
+}
+
+/**
+ * Reserve the recommended rooms and push the assignments to station screens
+ * @returns {Array} Assignments made
+ */
+async function dispatch(clinicId, now = new Date()) {
+  if (!clinicId) return [];
+  const { Appointment, Room } = models();
+  const websocketService = require('./websocketService');
+
+  await releaseExpiredAssignments(clinicId, now);
+  const flowState = await loadFlowState(clinicId, now);
+  const { assignments } = recommend(flowState.input);
+
+  const dispatched = [];
+  for (const assignment of assignments) {
+    const appointment = flowState.appointments.get(assignment.visitId);
+
+    // Claimed conditionally: a room taken since loading is skipped
+    const room = await Room.findOneAndUpdate(
+      { _id: assignment.stationId, status: 'available' },
+      { $set: { status: 'reserved', currentPatient: idOf(appointment.patient), currentAppointment: appointment._id } },
+      { new: true }
+    );
+    if (!room) continue;
+
+    const updated = await Appointment.updateOne(...assignmentUpdate(appointment, assignment.station, room._id, now));
+    if (updated.modifiedCount === 0) {
+      await Room.updateOne({ _id: room._id, currentAppointment: appointment._id }, { $set: { status: 'available', currentPatient: null, currentAppointment: null } });
+      continue;
+    }
+
+    const described = describeAssignment(assignment, flowState);
+    websocketService.emitQueueUpdate({
+      type: 'flow_assignment',
+      clinicId: idOf(clinicId),
+      ...described,
+      stationLabel: STATIONS[assignment.station].label
+    });
+    dispatched.push(described);
+  }
+
+  if (dispatched.length > 0) {
+    log.info('Flow assignments dispatched', { clinicId: idOf(clinicId), count: dispatched.length });
+  }
+  return dispatched;
+}
+
+/**
+ * Dispatch without failing the caller (check-in, station completion)
+ */
+function dispatchInBackground(clinicId) {
+  if (!settings.enabled || !clinicId) return;
+  dispatch(clinicId).catch(err => log.error('Flow dispatch failed', { clinicId: idOf(clinicId), error: err.message }));
+}
+
+/**
+ * Patient arrived at a station room
+ * @returns {Object} { status: 'started' | 'not-found' | 'room-not-found' | 'room-busy' | 'no-station', ... }
+ */
+async function startStation(appointmentId, roomId, userId, now = new Date()) {
+  const { Appointment, Room } = models();
+  const [appointment, room] = await Promise.all([Appointment.findById(appointmentId), Room.findById(roomId)]);
+  if (!appointment) return { status: 'not-found' };
+  if (!room) return { status: 'room-not-found' };
+  if (['occupied', 'reserved'].includes(room.status) && idOf(room.currentAppointment) !== idOf(appointment)) {
+    return { status: 'room-busy' };
+  }
+
+  if (!appointment.flow?.stations?.length) {
+    appointment.set('flow.stations', flowStations(appointment));
+  }
+  const stations = appointment.flow.stations;
+  const serves = roomServes(room);
+  const preTestsDone = stations.every(entry => entry.station === DOCTOR || ['done', 'skipped'].includes(entry.status));
+  const entry = stations.find(e => e.status === 'assigned' && idOf(e.room) === idOf(room)) ||
+    stations.find(e => e.status === 'pending' && serves.includes(e.station) && (e.station !== DOCTOR || preTestsDone));
+  if (!entry) return { status: 'no-station', serves };
+
+  // Sent somewhere else than the room reserved for them
+  const reserved = appointment.flow.assignedRoom;
+  if (reserved && idOf(reserved) !== idOf(room)) {
+    const previous = stations.find(e => e.status === 'assigned');
+    if (previous) {
+      previous.status = 'pending';
+      previous.room = undefined;
+      previous.assignedAt = undefined;
+    }
+    await Room.updateOne(
+      { _id: reserved, status: 'reserved', currentAppointment: appointment._id },
+      { $set: { status: 'available', currentPatient: null, currentAppointment: null } }
+    );
+  }
+
+  entry.status = 'in_progress';
+  entry.room = room._id;
+  entry.startedAt = now;
+  appointment.flow.assignedRoom = null;
+  appointment.flow.assignedAt = undefined;
+
+  if (entry.station === DOCTOR && appointment.status === 'checked-in') {
+    appointment.status = 'in-progress';
+    appointment.consultationStartTime = now;
+    appointment.calculateWaitingTime?.();
+    appointment.location = appointment.location || {};
+    appointment.location.room = room.roomNumber;
+  }
+
+  await appointment.save();
+  await room.occupy(appointment.patient, appointment._id, entry.station === DOCTOR ? userId : room.currentProvider);
+
+  require('./websocketService').emitQueueUpdate({
+    type: 'flow_station_started',
+    clinicId: idOf(appointment.clinic),
+    appointmentId: idOf(appointment),
+    queueNumber: appointment.queueNumber,
+    roomId: idOf(room),
+    room: room.roomNumber,
+    station: entry.station
+  });
+
+  return { status: 'started', station: entry.station, appointment };
+}
+
+/**
+ * Patient done at their current station: free the room and dispatch the next assignments
+ * @returns {Object} { status: 'completed' | 'not-found' | 'not-at-station', ... }
+ */
+async function completeStation(appointmentId, now = new Date()) {
+  const { Appointment, Room } = models();
+  const appointment = await Appointment.findById(appointmentId);
+  if (!appointment) return { status: 'not-found' };
+
+  const entry = appointment.flow?.stations?.find(e => e.status === 'in_progress');
+  if (!entry) return { status: 'not-at-station' };
+
+  entry.status = 'done';
+  entry.completedAt = now;
+  await appointment.save();
+
+  const room = await Room.findById(entry.room);
+  if (room && idOf(room.currentAppointment) === idOf(appointment)) await room.release();
+
+  const dispatched = settings.enabled ? await dispatch(appointment.clinic, now) : [];
+  return {
+    status: 'completed',
+    station: entry.station,
+    remaining: appointment.flow.stations.filter(e => e.status === 'pending').map(e => e.station),
+    dispatched
+  };
+}
+
+/**
+ * Replace the stations a visit still needs (e.g. the doctor orders a visual field)
+ * @returns {Object} { status: 'updated' | 'not-found' | 'invalid', ... }
+ */
+async function updateStations(appointmentId, requested) {
+  const invalid = (requested || []).filter(station => !STATIONS[station]);
+  if (!Array.isArray(requested) || invalid.length > 0) return { status: 'invalid', invalid };
+
+  const { Appointment } = models();
+  const appointment = await Appointment.findById(appointmentId);
+  if (!appointment) return { status: 'not-found' };
+
+  const current = flowStations(appointment).map(entry => (entry.toObject ? entry.toObject() : entry));
+  const kept = current.filter(entry => entry.status !== 'pending');
+  const active = new Set(kept.filter(entry => entry.status !== 'done' && entry.status !== 'skipped').map(entry => entry.station));
+  const pending = [...new Set(requested)]
+    .filter(station => !active.has(station))
+    .map(station => ({ station, status: 'pending' }));
+
+  appointment.set('flow.stations', [...kept, ...pending]);
+  await appointment.save();
+  dispatchInBackground(appointment.clinic);
+
+  return { status: 'updated', stations: appointment.flow.stations };
+}
+
+/**
+ * Load a past day's actual flow for replay
+ * @returns {Object} replayDay input (visits with at least one completed station)
+ */
+async function loadHistoricalDay(clinicId, date) {
+  const { Appointment, Room } = models();
+  const { start, end } = getDayRange(date);
+
+  const [rooms, appointments] = await Promise.all([
+    Room.find({ clinic: clinicId, isActive: true, isDeleted: { $ne: true } })
+      .select('type features assignedProviders currentProvider')
+      .lean(),
+    Appointment.find({
+      clinic: clinicId,
+      date: { $gte: start, $lte: end },
+      checkInTime: { $exists: true },
+      'flow.stations.status': 'done'
+    }).select('provider priority checkInTime flow.stations').lean()
+  ]);
+
+  const stations = rooms
+    .map(room => ({
+      id: idOf(room),
+      serves: roomServes(room),
+      providerId: room.assignedProviders?.length === 1 ? idOf(room.assignedProviders[0]) : null
+    }))
+    .filter(station => station.serves.length > 0);
+
+  const visits = appointments.map(appointment => ({
+    id: idOf(appointment),
+    priority: appointment.priority,
+    arrivedAt: toMinutes(appointment.checkInTime),
+    providerId: idOf(appointment.provider),
+    // Actual durations, in the order the patient went through them
+    remaining: appointment.flow.stations
+      .filter(entry => entry.status === 'done' && entry.startedAt && entry.completedAt)
+      .sort((a, b) => a.startedAt - b.startedAt)
+      .map(entry => ({ station: entry.station, minutes: Math.max((entry.completedAt - entry.startedAt) / 60000, MIN_PLAUSIBLE_MINUTES) }))
+  })).filter(visit => visit.remaining.length > 0);
+
+  return { stations, visits };
+}
+
+/**
+ * Compare the linear queues and the router on a past day
+ */
+async function replayHistoricalDay(clinicId, date) {
+  const day = await loadHistoricalDay(clinicId, date);
+  if (day.visits.length === 0 || day.stations.length === 0) return null;
+
+  const metrics = ({ assignments, ...summary }) => summary;
+  return {
+    date,
+    visits: day.visits.length,
+    stations: day.stations.length,
+    linear: metrics(replayDay(day, 'linear')),
+    router: metrics(replayDay(day, 'router'))
+  };
+}
+
+module.exports = {
+  getFlowOverview,
+  dispatch,
+  dispatchInBackground,
+  startStation,
+  completeStation,
+  updateStations,
+  releaseExpiredAssignments,
+  replayHistoricalDay,
+  loadDurationModel,
+  // Simulator (exported for tests and what-if replays)
+  createState,
+  run,
+  greedyPick,
+  routerPick,
+  recommend,
+  replayDay,
+  summarize,
+  buildDurationModel,
+  predictStationMinutes,
+  roomServes,
+  defaultRoute,
+  assignmentUpdate,
+  loadSettings,
+  STATIONS,
+  DEFAULT_ROUTES
+};
@@ -0,0 +1,494 @@
+/**
+ * Price Book Service
+ *
+ * Compiles the standard fee schedule, per-clinic prices and convention
+ * (company) fee schedules into one immutable in-memory PriceBook, so an
+ * invoice, a lab panel or an IVT injection is priced with zero queries.
+ *
+ * - Lookups reproduce FeeSchedule.getEffectivePriceForDate, getPriceForClinic
+ *   and ConventionFeeSchedule.getPriceForCompanyAndCode exactly
+ * - Where several documents match, the first in _id order wins (the order
+ *   findOne returns them in on an unsorted query)
+ * - Any FeeSchedule / ConventionFeeSchedule write marks the book dirty; the
+ *   next read compiles a new book and swaps it in with one assignment, so
+ *   readers never see a half-built book
+ * - A background fingerprint check picks up writes made by other processes
+ */
+
+const FeeSchedule = require('../models/FeeSchedule');
+const ConventionFeeSchedule = require('../models/ConventionFeeSchedule');
+const Company = require('../models/Company');
+
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('PriceBook');
+
+// How often a read may trigger the cross-process freshness check
+const FRESHNESS_CHECK_MS = 60 * 1000;
+
+const FEE_FIELDS = 'code name category clinic isTemplate price currency active effectiveFrom effectiveTo minPrice maxPrice';
+
+// ============================================
+// COMPILATION
+// ============================================
+
+const idOf = (value) => (value ? String(value._id || value) : null);
+const timeOf = (value) => (value === null || value === undefined ? null : new Date(value).getTime());
+
+function compileFee(doc) {
+  return Object.freeze({
+    _id: doc._id,
+    code: doc.code,
+    name: doc.name,
+    category: doc.category,
+    clinic: idOf(doc.clinic),
+    isTemplate: !!doc.isTemplate,
+    price: doc.price,
+    currency: doc.currency,
+    active: doc.active !== false,
+    effectiveFrom: doc.effectiveFrom ? new Date(doc.effectiveFrom) : doc.effectiveFrom,
+    effectiveTo: doc.effectiveTo ? new Date(doc.effectiveTo) : doc.effectiveTo,
+    from: timeOf(doc.effectiveFrom),
+    to: timeOf(doc.effectiveTo),
+    minPrice: doc.minPrice,
+    maxPrice: doc.maxPrice
+  });
+}
+
+function compileSchedule(doc) {
+  // Array.find semantics: the first item for a code wins
+  const items = new Map();
+  for (const item of doc.items || []) {
+    if (items.has(item.feeScheduleCode)) continue;
+    items.set(item.feeScheduleCode, Object.freeze({
+      conventionPrice: item.conventionPrice,
+      coveragePercentage: item.coveragePercentage,
+      requiresApproval: item.requiresApproval || false,
+      isCovered: item.isCovered !== false,
+      maxQuantityPerYear: item.maxQuantityPerYear ?? null,
+      maxQuantityPerVisit: item.maxQuantityPerVisit ?? null,
+      notes: item.notes
+    }));
+  }
+
+  // Schema defaults, as a hydrated document would report them
+  const defaults = doc.defaults || {};
+  return Object.freeze({
+    _id: doc._id,
+    company: idOf(doc.company),
+    name: doc.name,
+    currency: doc.currency || 'CDF',
+    from: timeOf(doc.effectiveFrom),
+    to: timeOf(doc.effectiveTo),
+    defaults: Object.freeze({
+      useStandardPrices: defaults.useStandardPrices !== false,
+      discountPercentage: defaults.discountPercentage || 0,
+      coveragePercentage: defaults.coveragePercentage
+    }),
+    items
+  });
+}
+
+const startsBy = (entry, t) => entry.from === null || entry.from <= t;
+const endsAfter = (entry, t) => entry.to === null || entry.to >= t;
+
+class PriceBook {
+  /**
+   * @param {Object} data - { fees, conventions, companies } as lean documents
+   */
+  constructor({ fees = [], conventions = [], companies = [] }, { version = 0, builtAt = new Date() } = {}) {
+    this.version = version;
+    this.builtAt = builtAt;
+
+    const sortedFees = [...fees].sort((a, b) => String(a._id).localeCompare(String(b._id)));
+    this.fees = Object.freeze(sortedFees.map(compileFee));
+
+    const byCode = new Map();
+    const byName = new Map();
+    for (const fee of this.fees) {
+      if (!byCode.has(fee.code)) byCode.set(fee.code, []);
+      byCode.get(fee.code).push(fee);
+      const name = String(fee.name || '').toLowerCase();
+      if (!byName.has(name)) byName.set(name, []);
+      byName.get(name).push(fee);
+    }
+    this.byCode = byCode;
+    this.byName = byName;
+
+    // Active schedules per company, newest effectiveFrom first
+    const schedules = new Map();
+    for (const doc of conventions) {
+      if (doc.isActive === false) continue;
+      const schedule = compileSchedule(doc);
+      if (!schedules.has(schedule.company)) schedules.set(schedule.company, []);
+      schedules.get(schedule.company).push(schedule);
+    }
+    for (const list of schedules.values()) list.sort((a, b) => b.from - a.from);
+    this.schedules = schedules;
+
+    this.parentOf = new Map(companies
+      .filter(c => c.parentConvention)
+      .map(c => [idOf(c._id), idOf(c.parentConvention)]));
+
+    Object.freeze(this);
+  }
+
+  get size() {
+    return { fees: this.fees.length, conventions: [...this.schedules.values()].reduce((n, l) => n + l.length, 0) };
+  }
+
+  _candidates(code) {
+    return this.byCode.get(String(code).toUpperCase()) || [];
+  }
+
+  /**
+   * Same result as FeeSchedule.getEffectivePriceForDate(code, serviceDate)
+   */
+  effectivePrice(code, serviceDate) {
+    const t = new Date(serviceDate).getTime();
+    const candidates = this._candidates(code);
+    const fee = candidates.find(f => f.active && startsBy(f, t) && endsAfter(f, t));
+
+    if (fee) {
+      const now = Date.now();
+      return {
+        found: true,
+        price: fee.price,
+        currency: fee.currency,
+        code: fee.code,
+        name: fee.name,
+        effectiveFrom: fee.effectiveFrom,
+        effectiveTo: fee.effectiveTo,
+        isCurrentlyEffective: fee.active && startsBy(fee, now) && endsAfter(fee, now),
+        minPrice: fee.minPrice,
+        maxPrice: fee.maxPrice
+      };
+    }
+
+    const anyVersion = candidates[0];
+    if (anyVersion) {
+      return {
+        found: false,
+        error: 'Fee schedule exists but is not effective for the specified date',
+        code: code,
+        availableFrom: anyVersion.effectiveFrom,
+        availableTo: anyVersion.effectiveTo
+      };
+    }
+
+    return {
+      found: false,
+      error: 'Fee schedule code not found',
+      code: code
+    };
+  }
+
+  /**
+   * Same result as FeeSchedule.getPriceForClinic(code, clinicId)
+   */
+  clinicPrice(code, clinicId) {
+    const clinic = idOf(clinicId);
+    const fee = this._candidates(code).find(f => f.clinic === clinic && f.active);
+
+    if (!fee) {
+      return { found: false, error: 'Price not configured for this clinic' };
+    }
+
+    return {
+      found: true,
+      price: fee.price,
+      currency: fee.currency,
+      name: fee.name,
+      category: fee.category
+    };
+  }
+
+  /**
+   * Active fee with effectiveFrom <= date and no end or an end after date
+   * (invoice validation filter)
+   */
+  currentFee(code, date = new Date()) {
+    const t = new Date(date).getTime();
+    return this._candidates(code)
+      .find(f => f.active && f.from !== null && f.from <= t && endsAfter(f, t)) || null;
+  }
+
+  /**
+   * Active, not yet ended fee with the latest effectiveFrom, by code or by
+   * exact name (case-insensitive) within a category (lab billing filter)
+   */
+  latestFee({ code, name, category }, date = new Date()) {
+    const t = new Date(date).getTime();
+    let candidates = [];
+    if (code) candidates = this._candidates(code);
+    else if (name) candidates = this.byName.get(String(name).toLowerCase()) || [];
+
+    let best = null;
+    for (const fee of candidates) {
+      if (!fee.active || !endsAfter(fee, t)) continue;
+      if (category && fee.category !== category) continue;
+      if (!best || (fee.from ?? -Infinity) > (best.from ?? -Infinity)) best = fee;
+    }
+    return best;
+  }
+
+  /**
+   * First active, currently effective fee matching a predicate (name searches)
+   */
+  findFee(predicate, date = new Date()) {
+    const t = new Date(date).getTime();
+    return this.fees.find(f => f.active && startsBy(f, t) && endsAfter(f, t) && predicate(f)) || null;
+  }
+
+  /**
+   * Same schedule as ConventionFeeSchedule.getEffectiveForCompany (parent fallback)
+   */
+  scheduleFor(companyId, date = new Date()) {
+    const t = new Date(date).getTime();
+    const pick = (id) => (this.schedules.get(id) || []).find(s => s.from !== null && s.from <= t && endsAfter(s, t));
+
+    const company = idOf(companyId);
+    const own = pick(company);
+    if (own) return { schedule: own, inherited: false };
+
+    const parent = this.parentOf.get(company);
+    const inherited = parent ? pick(parent) : null;
+    return inherited ? { schedule: inherited, inherited: true } : null;
+  }
+
+  /**
+   * Same result as ConventionFeeSchedule#getPriceForCode(code)
+   */
+  schedulePrice(schedule, code) {
+    const upperCode = String(code).toUpperCase();
+    const item = schedule.items.get(upperCode);
+
+    if (item) {
+      return {
+        found: true,
+        isConventionPrice: true,
+        price: item.conventionPrice,
+        currency: schedule.currency,
+        coveragePercentage: item.coveragePercentage,
+        requiresApproval: item.requiresApproval,
+        isCovered: item.isCovered,
+        maxQuantityPerYear: item.maxQuantityPerYear,
+        maxQuantityPerVisit: item.maxQuantityPerVisit,
+        notes: item.notes
+      };
+    }
+
+    if (schedule.defaults.useStandardPrices) {
+      // Any active version of the code, as in the model method (no date filter)
+      const standardFee = this._candidates(upperCode).find(f => f.active);
+
+      if (standardFee) {
+        let price = standardFee.price;
+        if (schedule.defaults.discountPercentage > 0) {
+          price = price * (1 - schedule.defaults.discountPercentage / 100);
+        }
+
+        return {
+          found: true,
+          isConventionPrice: false,
+          isStandardPrice: true,
+          price: Math.round(price),
+          originalPrice: standardFee.price,
+          discountApplied: schedule.defaults.discountPercentage,
+          currency: standardFee.currency,
+          coveragePercentage: schedule.defaults.coveragePercentage,
+          requiresApproval: false,
+          isCovered: true
+        };
+      }
+    }
+
+    return {
+      found: false,
+      error: 'Service code not found in convention or standard fee schedule'
+    };
+  }
+
+  /**
+   * Same result as ConventionFeeSchedule.getPriceForCompanyAndCode(companyId, code, date)
+   */
+  companyPrice(companyId, code, date = new Date()) {
+    const resolved = this.scheduleFor(companyId, date);
+    if (resolved) return this.schedulePrice(resolved.schedule, code);
+
+    const standardFee = this.effectivePrice(code, date);
+    if (standardFee.found) {
+      return {
+        found: true,
+        isConventionPrice: false,
+        isStandardPrice: true,
+        price: standardFee.price,
+        currency: standardFee.currency,
+        requiresApproval: false,
+        isCovered: true
+      };
+    }
+    return standardFee;
+  }
+
+  /**
+   * Price many lines in one call
+   * Convention price when a company is given, else the clinic's own price,
+   * else the standard price effective on the date.
+   * @param {Array} lines - [{ code, quantity }]
+   * @param {Object} context - { company, clinic, date }
+   */
+  priceLines(lines, { company, clinic, date = new Date() } = {}) {
+    return lines.map(line => {
+      const quantity = line.quantity || 1;
+      let result;
+      let source;
+
+      if (company) {
+        result = this.companyPrice(company, line.code, date);
+        source = result.isConventionPrice ? 'convention' : 'standard';
+      } else if (clinic) {
+        result = this.clinicPrice(line.code, clinic);
+        source = 'clinic';
+        if (!result.found) {
+          result = this.effectivePrice(line.code, date);
+          source = 'standard';
+        }
+      } else {
+        result = this.effectivePrice(line.code, date);
+        source = 'standard';
+      }
+
+      return {
+        code: line.code,
+        quantity,
+        ...result,
+        source: result.found ? source : null,
+        total: result.found ? result.price * quantity : null
+      };
+    });
+  }
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+class PriceBookService {
+  constructor() {
+    this.book = null;
+    this.dirty = true;
+    this.building = null;
+    this.version = 0;
+    this.fingerprint = null;
+    this.checkedAt = 0;
+    this.checking = null;
+  }
+
+  /**
+   * Current book, compiled on first use and after any fee schedule change
+   */
+  async getBook() {
+    // A write during a build leaves the book dirty: build again (bounded)
+    for (let attempt = 0; attempt < 3 && (!this.book || this.dirty); attempt++) {
+      await this.rebuild();
+    }
+    if (Date.now() - this.checkedAt > FRESHNESS_CHECK_MS && !this.checking) {
+      this.checking = this._checkFreshness().finally(() => { this.checking = null; });
+    }
+    return this.book;
+  }
+
+  invalidate() {
+    this.dirty = true;
+  }
+
+  rebuild() {
+    if (this.building) return this.building;
+
+    this.building = (async () => {
+      this.dirty = false;
+      const started = Date.now();
+      const [data, fingerprint] = await Promise.all([this._load(), this._fingerprint()]);
+      const book = new PriceBook(data, { version: ++this.version });
+
+      // Atomic swap
+      this.book = book;
+      this.fingerprint = fingerprint;
+      this.checkedAt = Date.now();
+      log.info('Price book compiled', { version: book.version, ...book.size, ms: Date.now() - started });
+      return book;
+    })().catch(error => {
+      this.dirty = true;
+      throw error;
+    }).finally(() => {
+      this.building = null;
+    });
+
+    return this.building;
+  }
+
+  async _load() {
+    const [fees, conventions, companies] = await Promise.all([
+      FeeSchedule.find({}).select(FEE_FIELDS).lean(),
+      ConventionFeeSchedule.find({ isActive: true })
+        .select('company name currency effectiveFrom effectiveTo isActive defaults items')
+        .lean(),
+      Company.find({ parentConvention: { $ne: null } }).select('parentConvention').lean()
+    ]);
+    return { fees, conventions, companies };
+  }
+
+  /**
+   * Cheap change detector for writes made by other processes
+   */
+  async _fingerprint() {
+    const [feeCount, feeLatest, conventionCount, conventionLatest] = await Promise.all([
+      FeeSchedule.estimatedDocumentCount(),
+      FeeSchedule.findOne({}).sort({ updatedAt: -1 }).select('updatedAt').lean(),
+      ConventionFeeSchedule.estimatedDocumentCount(),
+      ConventionFeeSchedule.findOne({}).sort({ updatedAt: -1 }).select('updatedAt').lean()
+    ]);
+    return [feeCount, feeLatest?.updatedAt?.getTime?.(), conventionCount, conventionLatest?.updatedAt?.getTime?.()].join(':');
+  }
+
+  async _checkFreshness() {
+    try {
+      this.checkedAt = Date.now();
+      const fingerprint = await this._fingerprint();
+      if (fingerprint !== this.fingerprint) this.invalidate();
+    } catch (error) {
+      log.warn('Price book freshness check failed', { error: error.message });
+    }
+  }
+
+  // Convenience wrappers (one await, zero queries once compiled)
+
+  async getEffectivePrice(code, date = new Date()) {
+    return (await this.getBook()).effectivePrice(code, date);
+  }
+
+  async getClinicPrice(code, clinicId) {
+    return (await this.getBook()).clinicPrice(code, clinicId);
+  }
+
+  async getCompanyPrice(companyId, code, date = new Date()) {
+    return (await this.getBook()).companyPrice(companyId, code, date);
+  }
+
+  async priceLines(lines, context) {
+    return (await this.getBook()).priceLines(lines, context);
+  }
+
+  getStatus() {
+    return {
+      version: this.book?.version || 0,
+      builtAt: this.book?.builtAt || null,
+      dirty: this.dirty,
+      ...(this.book ? this.book.size : {})
+    };
+  }
+}
+
+module.exports = new PriceBookService();
+module.exports.PriceBookService = PriceBookService;
+module.exports.PriceBook = PriceBook;
@@ -0,0 +1,437 @@
+/**
+ * Read Routing Service
+ *
+ * Sends Mongoose reads to replica set members according to the read class
+ * the route or service declares:
+ * - strong (default): primary, nothing changes
+ * - causal: nearest-caught-up secondary inside a causally consistent session
+ *   advanced to the user's last write, so users always see their own writes
+ *   (the secondary waits for that write before answering)
+ * - analytics: members tagged for reporting (MONGO_ANALYTICS_TAGS), then any
+ *   secondary, never the primary while a secondary is within budget
+ *
+ * Replication lag is sampled from replSetGetStatus/replSetGetConfig. When no
+ * suitable secondary is within the lag budget of its class, or the deployment
+ * is standalone, reads fall back to the primary. Explicit read preferences and
+ * sessions set by the calling code always win.
+ *
+ * Hidden members are invisible to drivers, so the analytics member must be a
+ * priority-0 tagged member (e.g. { workload: 'analytics' }), not a hidden one.
+ *
+ * The write/read hooks are registered globally by install(), which must run
+ * before any model is compiled (top of server.js).
+ */
+
+const { AsyncLocalStorage } = require('async_hooks');
+const mongoose = require('mongoose');
+
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('ReadRouting');
+
+const READ_CLASSES = ['strong', 'causal', 'analytics'];
+
+const SAFE_METHODS = new Set(['GET', 'HEAD']);
+
+const READ_OPS = ['find', 'findOne', 'countDocuments', 'distinct'];
+const WRITE_OPS = [
+  'findOneAndUpdate', 'findOneAndDelete', 'findOneAndReplace',
+  'updateOne', 'updateMany', 'replaceOne', 'deleteOne', 'deleteMany'
+];
+
+// Driver-side staleness guard (the driver rejects values below 90s)
+const MIN_MAX_STALENESS_SECONDS = 90;
+
+// Per-user last-write cluster times kept for causal reads
+const MAX_WATERMARKS = 5000;
+// Past this age a write is assumed replicated everywhere
+const WATERMARK_TTL_MS = 10 * 60 * 1000;
+
+// replSetGetStatus error when the server is not part of a replica set
+const NO_REPLICATION_CODE = 76;
+
+// ============================================
+// CONFIGURATION
+// ============================================
+
+/**
+ * Parse "workload:analytics,dc:kin;workload:reporting" into read preference tag sets
+ */
+function parseTagSets(value) {
+  if (!value) return [];
+  return String(value).split(';').map(set => {
+    const tags = {};
+    for (const pair of set.split(',')) {
+      const [key, ...rest] = pair.split(':');
+      if (key && key.trim() && rest.length) tags[key.trim()] = rest.join(':').trim();
+    }
+    return tags;
+  }).filter(tags => Object.keys(tags).length > 0);
+}
+
+function loadSettings(env = process.env) {
+  return {
+    enabled: env.READ_ROUTING_ENABLED !== 'false',
+    analyticsTags: parseTagSets(env.MONGO_ANALYTICS_TAGS ?? 'workload:analytics'),
+    causalMaxLagMs: (parseFloat(env.READ_ROUTING_CAUSAL_MAX_LAG_SECONDS) || 2) * 1000,
+    analyticsMaxLagMs: (parseFloat(env.READ_ROUTING_ANALYTICS_MAX_LAG_SECONDS) || 60) * 1000,
+    sampleIntervalMs: (parseFloat(env.READ_ROUTING_SAMPLE_SECONDS) || 10) * 1000
+  };
+}
+
+// ============================================
+// REPLICA SET HEALTH (pure)
+// ============================================
+
+function matchesTagSet(memberTags = {}, tagSet) {
+  return Object.entries(tagSet).every(([key, value]) => memberTags[key] === value);
+}
+
+/**
+ * Lag of the readable secondaries from replSetGetStatus (+ optional replSetGetConfig)
+ *
+ * @param {Object} status - replSetGetStatus reply
+ * @param {Object} [config] - replSetGetConfig reply ({ config: { members } }), for tags and hidden flags
+ * @param {Array} analyticsTags - Tag sets identifying analytics members
+ * @returns {Object} { secondaryLagMs, analyticsLagMs, analyticsTagged, secondaries }
+ *   Lags are the smallest among healthy candidates, null when there is none.
+ */
+function evaluateReplicaSet(status, config, analyticsTags = []) {
+  const members = status?.members || [];
+  const primary = members.find(m => m.stateStr === 'PRIMARY' || m.state === 1);
+  const configured = new Map((config?.config?.members || config?.members || []).map(m => [m.host, m]));
+  const primaryOptime = primary ? new Date(primary.optimeDate).getTime() : null;
+
+  const secondaries = members
+    .filter(m => (m.stateStr === 'SECONDARY' || m.state === 2) && m.health !== 0)
+    .map(m => {
+      const memberConfig = configured.get(m.name) || {};
+      return {
+        name: m.name,
+        hidden: Boolean(memberConfig.hidden),
+        tags: memberConfig.tags || {},
+        lagMs: primaryOptime === null ? null : Math.max(0, primaryOptime - new Date(m.optimeDate).getTime())
+      };
+    })
+    .filter(m => !m.hidden && m.lagMs !== null);
+
+  const minLag = candidates => candidates.length ? Math.min(...candidates.map(m => m.lagMs)) : null;
+  const tagged = secondaries.filter(m => analyticsTags.some(tagSet => matchesTagSet(m.tags, tagSet)));
+
+  return {
+    secondaryLagMs: minLag(secondaries),
+    analyticsLagMs: tagged.length ? minLag(tagged) : minLag(secondaries),
+    analyticsTagged: tagged.length > 0,
+    secondaries
+  };
+}
+
+/**
+ * Read preference for a read class given the last replica set sample
+ *
+ * @param {String} readClass - strong | causal | analytics
+ * @param {Object|null} health - evaluateReplicaSet() result, null when not sampled yet
+ * @param {Object} settings - loadSettings() result
+ * @returns {Object|null} { mode, tags, maxStalenessSeconds, readConcern } or null for the primary
+ */
+function chooseRoute(readClass, health, settings) {
+  if (readClass !== 'causal' && readClass !== 'analytics') return null;
+  if (health && health.standalone) return null;
+
+  const maxStalenessSeconds = Math.max(MIN_MAX_STALENESS_SECONDS, Math.ceil(settings.analyticsMaxLagMs / 1000));
+
+  if (readClass === 'causal') {
+    // Lag only delays a causal read, but past the budget the primary answers sooner
+    if (health && (health.secondaryLagMs === null || health.secondaryLagMs > settings.causalMaxLagMs)) return null;
+    return { mode: 'secondaryPreferred', tags: [], maxStalenessSeconds, readConcern: 'majority' };
+  }
+
+  if (health && (health.analyticsLagMs === null || health.analyticsLagMs > settings.analyticsMaxLagMs)) return null;
+  // Tagged members first, then any secondary; the primary only when none is selectable
+  const tags = settings.analyticsTags.length ? [...settings.analyticsTags, {}] : [];
+  return { mode: 'secondaryPreferred', tags, maxStalenessSeconds, readConcern: null };
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+class ReadRoutingService {
+  constructor(settings = loadSettings()) {
+    this.settings = settings;
+    this.enabled = settings.enabled;
+    this.storage = new AsyncLocalStorage();
+    this.watermarks = new Map(); // userId -> { clusterTime, at }
+    this.health = null;
+    this.sampledAt = null;
+    this.sampleError = null;
+    this.timer = null;
+    this.installed = false;
+    this.mongoose = mongoose;
+    this.counters = { causal: 0, analytics: 0, fallbacks: 0, sessions: 0 };
+  }
+
+  /**
+   * Register the read/write hooks on every schema compiled afterwards
+   */
+  install(mongooseInstance = mongoose) {
+    if (this.installed || !this.enabled) return;
+    this.mongoose = mongooseInstance;
+    mongooseInstance.plugin(schema => this.plugin(schema));
+    this.installed = true;
+  }
+
+  plugin(schema) {
+    const routing = this;
+
+    schema.pre(READ_OPS, function() {
+      routing.applyRead(this, this.getOptions());
+    });
+    schema.pre('aggregate', function() {
+      routing.applyRead(this, this.options || {});
+    });
+
+    schema.post(WRITE_OPS, function() {
+      routing.noteWrite();
+    });
+    schema.post('save', function() {
+      routing.noteWrite();
+    });
+    schema.post('insertMany', function() {
+      routing.noteWrite();
+    });
+  }
+
+  // ============================================
+  // READ CLASS CONTEXT
+  // ============================================
+
+  newContext(readClass, { req = null, userId = null } = {}) {
+    return { readClass, req, userId, session: null };
+  }
+
+  /**
+   * App-level middleware: opens the request context used to track the
+   * user's writes. Reads stay strong until a route declares a class.
+   */
+  middleware() {
+    return (req, res, next) => {
+      if (!this.enabled) return next();
+      const context = this.newContext('strong', { req });
+      res.once('close', () => this.endSession(context));
+      this.storage.run(context, next);
+    };
+  }
+
+  /**
+   * Route middleware declaring the read class of the handlers after it.
+   * Only GET/HEAD requests are routed: a mutating handler reading from a
+   * secondary could decide on data other users already changed.
+   * @param {String} readClass - strong | causal | analytics
+   */
+  readClass(readClass) {
+    if (!READ_CLASSES.includes(readClass)) {
+      throw new Error(`Unknown read class: ${readClass}`);
+    }
+    return (req, res, next) => {
+      if (!this.enabled || !SAFE_METHODS.has(req.method)) return next();
+      const context = this.storage.getStore();
+      if (context) {
+        context.readClass = readClass;
+        return next();
+      }
+      const own = this.newContext(readClass, { req });
+      res.once('close', () => this.endSession(own));
+      this.storage.run(own, next);
+    };
+  }
+
+  /**
+   * Run a service function with a read class (reports, scheduled jobs)
+   */
+  async run(readClass, fn, { userId = null } = {}) {
+    if (!this.enabled) return fn();
+    const parent = this.storage.getStore();
+    const context = this.newContext(readClass, {
+      req: parent?.req || null,
+      userId: userId || parent?.userId || null
+    });
+    try {
+      return await this.storage.run(context, fn);
+    } finally {
+      this.endSession(context);
+    }
+  }
+
+  /**
+   * Wrap an async function so every call runs with a read class
+   */
+  wrap(readClass, fn) {
+    const routing = this;
+    return function routedRead(...args) {
+      return routing.run(readClass, () => fn.apply(this, args));
+    };
+  }
+
+  currentClass() {
+    return this.storage.getStore()?.readClass || 'strong';
+  }
+
+  // ============================================
+  // QUERY ROUTING
+  // ============================================
+
+  /**
+   * Apply the current read class to a Query or Aggregate before it executes
+   */
+  applyRead(target, options) {
+    const context = this.storage.getStore();
+    if (!context || context.readClass === 'strong') return;
+    // Explicit choices of the calling code (and transactions) win
+    if (options.readPreference || options.session) return;
+
+    const route = chooseRoute(context.readClass, this.health, this.settings);
+    if (!route) {
+      this.counters.fallbacks++;
+      return;
+    }
+
+    const { ReadPreference } = this.mongoose.mongo;
+    target.read(new ReadPreference(route.mode, route.tags, { maxStalenessSeconds: route.maxStalenessSeconds }));
+
+    if (context.readClass === 'causal') {
+      const session = this.sessionFor(context);
+      if (session) target.session(session);
+      if (route.readConcern && typeof target.readConcern === 'function') target.readConcern(route.readConcern);
+    }
+    this.counters[context.readClass]++;
+  }
+
+  /**
+   * Causally consistent session of a context, advanced past the user's last write
+   */
+  sessionFor(context) {
+    if (context.session) return context.session;
+
+    const client = this.mongoose.connection?.getClient?.();
+    if (!client || typeof client.startSession !== 'function') return null;
+
+    const session = client.startSession({ causalConsistency: true });
+    const watermark = this.watermarkFor(this.userOf(context));
+    if (watermark) {
+      session.advanceClusterTime(watermark.clusterTime);
+      session.advanceOperationTime(watermark.clusterTime.clusterTime);
+    }
+    context.session = session;
+    this.counters.sessions++;
+    return session;
+  }
+
+  endSession(context) {
+    if (!context.session) return;
+    const session = context.session;
+    context.session = null;
+    session.endSession().catch(() => {});
+  }
+
+  // ============================================
+  // WRITE WATERMARKS
+  // ============================================
+
+  userOf(context) {
+    const id = context?.userId || context?.req?.user?._id || context?.req?.user?.id;
+    return id ? String(id) : null;
+  }
+
+  /**
+   * Remember the cluster time after a user's write. The client's cluster time
+   * is at least the write's operation time, so a read waiting for it sees the write.
+   */
+  noteWrite() {
+    const userId = this.userOf(this.storage.getStore());
+    if (!userId) return;
+    const clusterTime = this.mongoose.connection?.getClient?.()?.topology?.clusterTime;
+    if (!clusterTime) return;
+
+    this.watermarks.delete(userId);
+    if (this.watermarks.size >= MAX_WATERMARKS) {
+      this.watermarks.delete(this.watermarks.keys().next().value);
+    }
+    this.watermarks.set(userId, { clusterTime, at: Date.now() });
+  }
+
+  watermarkFor(userId) {
+    if (!userId) return null;
+    const watermark = this.watermarks.get(userId);
+    if (!watermark) return null;
+    if (Date.now() - watermark.at > WATERMARK_TTL_MS) {
+      this.watermarks.delete(userId);
+      return null;
+    }
+    return watermark;
+  }
+
+  // ============================================
+  // LAG MONITOR
+  // ============================================
+
+  /**
+   * Start sampling replication lag (after the connection is open)
+   */
+  start(connection = mongoose.connection) {
+    if (!this.enabled || this.timer) return;
+    this.connection = connection;
+    this.sample().catch(() => {});
+    this.timer = setInterval(() => this.sample().catch(() => {}), this.settings.sampleIntervalMs);
+    this.timer.unref();
+  }
+
+  stop() {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+  }
+
+  async sample() {
+    const admin = this.connection.db.admin();
+    try {
+      const status = await admin.command({ replSetGetStatus: 1 });
+      const config = await admin.command({ replSetGetConfig: 1 }).catch(() => null);
+      this.health = evaluateReplicaSet(status, config, this.settings.analyticsTags);
+      this.sampleError = null;
+    } catch (error) {
+      if (error.code === NO_REPLICATION_CODE) {
+        this.health = { standalone: true, secondaryLagMs: null, analyticsLagMs: null, secondaries: [] };
+      } else if (this.sampleError !== error.message) {
+        // Without a sample the driver's maxStalenessSeconds is the only guard
+        log.warn('Replication lag sampling failed', { error: error.message });
+        this.health = null;
+      }
+      this.sampleError = error.message;
+    }
+    this.sampledAt = new Date();
+    return this.health;
+  }
+
+  getStatus() {
+    return {
+      enabled: this.enabled,
+      installed: this.installed,
+      sampledAt: this.sampledAt,
+      sampleError: this.sampleError,
+      replicaSet: this.health,
+      routes: {
+        causal: chooseRoute('causal', this.health, this.settings)?.mode || 'primary',
+        analytics: chooseRoute('analytics', this.health, this.settings)?.mode || 'primary'
+      },
+      counters: { ...this.counters },
+      trackedUsers: this.watermarks.size
+    };
+  }
+}
+
+module.exports = new ReadRoutingService();
+module.exports.ReadRoutingService = ReadRoutingService;
+module.exports.parseTagSets = parseTagSets;
+module.exports.loadSettings = loadSettings;
+module.exports.evaluateReplicaSet = evaluateReplicaSet;
+module.exports.chooseRoute = chooseRoute;
+module.exports.READ_CLASSES = READ_CLASSES;
@@ -0,0 +1,352 @@
+/**
+ * Slot Hold Service
+ *
+ * Short-TTL reservations of appointment slots, so portal bookings confirm
+ * instantly instead of waiting for staff:
+ * - Picking a slot on the portal takes a hold: one SlotHold document per
+ *   grid cell the slot covers, inserted under a unique key. Of several
+ *   patients (or a patient and reception) racing for the same time, exactly
+ *   one gets it; an expired hold is taken over with a conditional update.
+ * - Once the cells are held, the provider's appointments are checked; a slot
+ *   that is already booked is released and reported taken.
+ * - Submitting converts the hold: its cells are extended only if they are
+ *   still held by the same patient, the appointment is created confirmed and
+ *   the cells are released (the appointment now blocks the slot).
+ * - Staff bookings lock the cells of the appointment while they check and
+ *   save, so reception cannot book over a slot a patient is holding.
+ * - A patient keeps one hold at a time: a new pick releases the previous one.
+ *
+ * Persistence goes through a store (MongoDB by default); tests inject one.
+ *
+ * Configuration (environment):
+ * - SLOT_HOLD_TTL_MINUTES: how long a portal hold lasts (default 5)
+ * - SLOT_HOLD_GRID_MINUTES: cell size, the portal slot length (default 30)
+ * - SLOT_HOLD_LOCK_SECONDS: staff booking lock and conversion window (default 30)
+ */
+
+const crypto = require('crypto');
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('SlotHolds');
+
+// Appointment statuses that no longer occupy their slot
+const FREE_STATUSES = ['cancelled', 'no_show'];
+
+// ============================================
+// CONFIGURATION
+// ============================================
+
+function loadSettings(env = process.env) {
+  return {
+    ttlMs: (parseInt(env.SLOT_HOLD_TTL_MINUTES, 10) || 5) * 60 * 1000,
+    gridMinutes: parseInt(env.SLOT_HOLD_GRID_MINUTES, 10) || 30,
+    lockMs: (parseInt(env.SLOT_HOLD_LOCK_SECONDS, 10) || 30) * 1000
+  };
+}
+
+// ============================================
+// PURE HELPERS (exported for tests)
+// ============================================
+
+const idOf = (value) => (value && value._id ? String(value._id) : value ? String(value) : null);
+
+/**
+ * Minutes since midnight of 'HH:MM' (or 'H:MM'), null if unparseable
+ */
+function toMinutes(time) {
+  const [hours, minutes] = String(time || '').split(':');
+  const h = parseInt(hours, 10);
+  if (Number.isNaN(h)) return null;
+  return h * 60 + (parseInt(minutes, 10) || 0);
+}
+
+function toTime(minutes) {
+  return `${String(Math.floor(minutes / 60)).padStart(2, '0')}:${String(minutes % 60).padStart(2, '0')}`;
+}
+
+/**
+ * Local calendar day of a date: { key: 'YYYY-MM-DD', start, end }
+ */
+function dayOf(date) {
+  const start = new Date(date);
+  start.setHours(0, 0, 0, 0);
+  const end = new Date(start);
+  end.setDate(end.getDate() + 1);
+  const key = `${start.getFullYear()}-${String(start.getMonth() + 1).padStart(2, '0')}-${String(start.getDate()).padStart(2, '0')}`;
+  return { key, start, end };
+}
+
+/**
+ * Grid cells covered by a slot. Two slots of a provider that overlap in time
+ * always share a cell, which is what makes the unique key exclusive.
+ * @param {Object} slot - { provider, date, startTime, endTime }
+ * @param {number} gridMinutes
+ * @returns {Array<Object>} [{ key, cellTime }]
+ */
+function cellsFor(slot, gridMinutes) {
+  const start = toMinutes(slot.startTime);
+  if (!slot.provider || !slot.date || start === null) return [];
+  let end = toMinutes(slot.endTime);
+  if (end === null || end <= start) end = start + gridMinutes;
+
+  const day = dayOf(slot.date).key;
+  const cells = [];
+  for (let minutes = Math.floor(start / gridMinutes) * gridMinutes; minutes < end; minutes += gridMinutes) {
+    const cellTime = toTime(minutes);
+    cells.push({ key: `${idOf(slot.provider)}:${day}:${cellTime}`, cellTime });
+  }
+  return cells;
+}
+
+/**
+ * Whether a slot overlaps one of the provider's appointments of that day
+ * @param {Array<Object>} appointments - { startTime, endTime }
+ * @param {Object} slot - { startTime, endTime }
+ */
+function overlapsAppointment(appointments, slot) {
+  const start = toMinutes(slot.startTime);
+  const end = toMinutes(slot.endTime) || start + 1;
+  return appointments.some(appointment => {
+    const otherStart = toMinutes(appointment.startTime);
+    const otherEnd = toMinutes(appointment.endTime) || otherStart + 1;
+    return otherStart < end && start < otherEnd;
+  });
+}
+
+// ============================================
+// MONGODB STORE
+// ============================================
+
+function createMongoStore() {
+  // Lazy: keeps the service loadable without a database (unit tests)
+  const SlotHold = require('../models/SlotHold');
+  const Appointment = require('../models/Appointment');
+
+  return {
+    async claimCell(cell, now) {
+      try {
+        await SlotHold.create(cell);
+        return true;
+      } catch (error) {
+        if (error.code !== 11000) throw error;
+      }
+      // Taken: only an expired cell, or one this holder already has, can be claimed
+      const result = await SlotHold.updateOne(
+        { key: cell.key, $or: [{ expiresAt: { $lte: now } }, { holder: cell.holder }] },
+        { $set: cell }
+      );
+      return result.modifiedCount === 1;
+    },
+
+    async findHold(holdId) {
+      return SlotHold.find({ holdId }).lean();
+    },
+
+    async extendHold(holdId, holder, now, expiresAt) {
+      const result = await SlotHold.updateMany(
+        { holdId, holder, expiresAt: { $gt: now } },
+        { $set: { expiresAt } }
+      );
+      return result.modifiedCount;
+    },
+
+    async releaseHold(holdId, holder) {
+      const result = await SlotHold.deleteMany({ holdId, holder });
+      return result.deletedCount;
+    },
+
+    async releaseOtherHolds(holder, holdId) {
+      await SlotHold.deleteMany({ holder, holdId: { $ne: holdId }, purpose: 'hold' });
+    },
+
+    async findActiveCells(provider, day, now) {
+      return SlotHold.find({ provider, date: { $gte: day.start, $lt: day.end }, expiresAt: { $gt: now } })
+        .select('cellTime holder')
+        .lean();
+    },
+
+    async findAppointments(provider, day) {
+      return Appointment.find({
+        provider,
+        date: { $gte: day.start, $lt: day.end },
+        status: { $nin: FREE_STATUSES }
+      }).select('startTime endTime').lean();
+    },
+
+    async createAppointment(data) {
+      const appointment = new Appointment(data);
+      await appointment.save();
+      return appointment;
+    }
+  };
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+class SlotHolds {
+  /**
+   * @param {Object} settings - From loadSettings()
+   * @param {Object} [deps] - { store, now } (defaults: MongoDB, Date)
+   */
+  constructor(settings = loadSettings(), deps = {}) {
+    this.settings = settings;
+    this.storeOverride = deps.store || null;
+    this.now = deps.now || (() => new Date());
+    this.counters = { held: 0, taken: 0, booked: 0, expired: 0 };
+  }
+
+  get store() {
+    if (!this.storeOverride) this.storeOverride = createMongoStore();
+    return this.storeOverride;
+  }
+
+  /**
+   * Take every cell of a slot, or none
+   * @returns {Promise<Object>} { status: 'held', hold } | { status: 'taken' | 'invalid' }
+   */
+  async claim(slot, holder, { purpose, ttlMs, patient }) {
+    const cells = cellsFor(slot, this.settings.gridMinutes);
+    if (cells.length === 0) return { status: 'invalid' };
+
+    const now = this.now();
+    const hold = {
+      holdId: crypto.randomUUID(),
+      provider: idOf(slot.provider),
+      date: dayOf(slot.date).start,
+      startTime: slot.startTime,
+      endTime: slot.endTime || toTime(toMinutes(slot.startTime) + this.settings.gridMinutes),
+      expiresAt: new Date(now.getTime() + ttlMs)
+    };
+
+    for (const cell of cells) {
+      const claimed = await this.store.claimCell({ ...hold, ...cell, holder, purpose, patient: idOf(patient) }, now);
+      if (!claimed) {
+        await this.store.releaseHold(hold.holdId, holder);
+        return { status: 'taken' };
+      }
+    }
+    return { status: 'held', hold };
+  }
+
+  /**
+   * Hold a slot for a portal patient
+   * @param {Object} slot - { provider, date, startTime, endTime }
+   * @param {string} patientId
+   * @returns {Promise<Object>} { status: 'held', hold } | { status: 'taken' | 'invalid' }
+   */
+  async hold(slot, patientId) {
+    const holder = `patient:${patientId}`;
+    const result = await this.claim(slot, holder, { purpose: 'hold', ttlMs: this.settings.ttlMs, patient: patientId });
+    if (result.status !== 'held') {
+      if (result.status === 'taken') this.counters.taken++;
+      return result;
+    }
+
+    const appointments = await this.store.findAppointments(result.hold.provider, dayOf(slot.date));
+    if (overlapsAppointment(appointments, result.hold)) {
+      await this.store.releaseHold(result.hold.holdId, holder);
+      this.counters.taken++;
+      return { status: 'taken' };
+    }
+
+    await this.store.releaseOtherHolds(holder, result.hold.holdId);
+    this.counters.held++;
+    return result;
+  }
+
+  /**
+   * Release a patient's hold (slot deselected, page left)
+   * @returns {Promise<boolean>} Whether the patient still had it
+   */
+  async release(holdId, patientId) {
+    return (await this.store.releaseHold(holdId, `patient:${patientId}`)) > 0;
+  }
+
+  /**
+   * Book a held slot as a confirmed appointment
+   * @param {string} holdId
+   * @param {string} patientId
+   * @param {Object} details - Appointment fields (type, reason, department, createdBy...)
+   * @returns {Promise<Object>} { status: 'booked', appointment } | { status: 'expired' | 'taken' }
+   */
+  async convert(holdId, patientId, details) {
+    const holder = `patient:${patientId}`;
+    const cells = (await this.store.findHold(holdId)).filter(cell => cell.holder === holder);
+    if (cells.length === 0) {
+      this.counters.expired++;
+      return { status: 'expired' };
+    }
+
+    try {
+      // Still ours and not expired: keep it for the time of the save
+      const now = this.now();
+      const extended = await this.store.extendHold(holdId, holder, now, new Date(now.getTime() + this.settings.lockMs));
+      if (extended !== cells.length) {
+        this.counters.expired++;
+        return { status: 'expired' };
+      }
+
+      const [{ provider, date, startTime, endTime }] = cells;
+      // Booking paths that do not lock (recurring series, imports) are still caught here
+      if (overlapsAppointment(await this.store.findAppointments(provider, dayOf(date)), { startTime, endTime })) {
+        this.counters.taken++;
+        return { status: 'taken' };
+      }
+
+      const appointment = await this.store.createAppointment({
+        ...details,
+        patient: patientId,
+        provider,
+        date,
+        startTime,
+        endTime,
+        duration: toMinutes(endTime) - toMinutes(startTime),
+        status: 'confirmed',
+        source: 'web',
+        confirmation: { required: false, confirmed: true, confirmedAt: now, confirmedBy: 'patient' }
+      });
+      this.counters.booked++;
+      log.info('Portal slot booked', { provider: idOf(provider), date: dayOf(date).key, startTime });
+      return { status: 'booked', appointment };
+    } finally {
+      await this.store.releaseHold(holdId, holder);
+    }
+  }
+
+  /**
+   * Lock the cells of a staff booking while it is checked and saved
+   * @returns {Promise<Object>} { status: 'held', hold } | { status: 'taken' | 'invalid' }
+   */
+  async lock(slot, userId) {
+    return this.claim(slot, `staff:${userId}`, { purpose: 'booking', ttlMs: this.settings.lockMs });
+  }
+
+  async unlock(lock, userId) {
+    if (lock && lock.hold) await this.store.releaseHold(lock.hold.holdId, `staff:${userId}`);
+  }
+
+  /**
+   * Cell start times of a provider's day held by someone else
+   * @returns {Promise<Set<string>>}
+   */
+  async heldTimes(provider, date, patientId) {
+    const holder = patientId ? `patient:${patientId}` : null;
+    const cells = await this.store.findActiveCells(provider, dayOf(date), this.now());
+    return new Set(cells.filter(cell => cell.holder !== holder).map(cell => cell.cellTime));
+  }
+
+  getStatus() {
+    return { settings: this.settings, counters: { ...this.counters } };
+  }
+}
+
+const slotHolds = new SlotHolds();
+
+module.exports = slotHolds;
+module.exports.SlotHolds = SlotHolds;
+module.exports.loadSettings = loadSettings;
+module.exports.toMinutes = toMinutes;
+module.exports.toTime = toTime;
+module.exports.cellsFor = cellsFor;
+module.exports.overlapsAppointment = overlapsAppointment;
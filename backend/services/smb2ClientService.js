@@ -11,6 +11,7 @@ const fs = require('fs').promises;
 const os = require('os');
 const EventEmitter = require('events');
 
+const memoryWatchdog = require('./memoryWatchdog');
 const { createContextLogger } = require('../utils/structuredLogger');
 const log = createContextLogger('Smb2Client');
 
@@ -726,4 +727,6 @@ class SMB2ClientService extends EventEmitter {
 
 // Export singleton instance
 const instance = new SMB2ClientService();
+memoryWatchdog.register('smb2:fileCache', () => instance.fileCache.size);
+memoryWatchdog.register('smb2:connections', () => instance.connections.size);
 module.exports = instance;
@@ -0,0 +1,1034 @@
+/**
+ * SMPP Service
+ * Direct SMS channel to an operator SMSC over SMPP v3.4, for clinics that
+ * contract with local operators. Bulk campaigns (reminders, recalls,
+ * closure notices) run at the account's negotiated rate instead of one
+ * HTTP call at a time.
+ *
+ * Features:
+ * - Persistent transceiver binds (SMPP_BINDS), enquire_link keep-alive,
+ *   automatic rebind with backoff
+ * - Windowed asynchronous submit_sm: up to SMPP_WINDOW unanswered PDUs per
+ *   bind, responses correlated by sequence number
+ * - Token bucket shared by all binds at SMPP_THROUGHPUT messages/second;
+ *   ESME_RTHROTTLED / ESME_RMSGQFUL pause the bucket and the message is resubmitted
+ * - Delivery receipts (deliver_sm) correlated to submitted message ids and
+ *   persisted in batches (SmsMessage), including operators that return hex
+ *   ids in submit_sm_resp and decimal ids in receipts (SMPP_RECEIPT_ID_FORMAT,
+ *   learned from the first unambiguous receipt by default)
+ * - ASCII / Latin-1 / UCS-2 data coding; long texts go in message_payload
+ *
+ * When no bind is up, sends fail fast with `retryable: true` so callers
+ * fall back to the HTTP provider. A submit_sm that was written but never
+ * answered (response timeout, bind dropped) may have been accepted by the
+ * SMSC: it is reported `status: 'unknown'`, not retried, so patients do not
+ * get the same SMS twice.
+ *
+ * Configuration (environment):
+ * - SMPP_HOST / SMPP_PORT: operator SMSC (channel disabled without host)
+ * - SMPP_SYSTEM_ID / SMPP_PASSWORD / SMPP_SYSTEM_TYPE: bind credentials
+ * - SMPP_SOURCE_ADDR: sender id (alphanumeric, short code or number)
+ * - SMPP_BINDS, SMPP_WINDOW, SMPP_THROUGHPUT: from the operator contract
+ * - SMPP_RECEIPT_ID_FORMAT: same | decimal | hex | auto (see receiptKey)
+ */
+
+const net = require('net');
+const EventEmitter = require('events');
+
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('Smpp');
+
+// ============================================
+// PROTOCOL CONSTANTS
+// ============================================
+
+const COMMAND = {
+  GENERIC_NACK: 0x80000000,
+  BIND_TRANSCEIVER: 0x00000009,
+  BIND_TRANSCEIVER_RESP: 0x80000009,
+  SUBMIT_SM: 0x00000004,
+  SUBMIT_SM_RESP: 0x80000004,
+  DELIVER_SM: 0x00000005,
+  DELIVER_SM_RESP: 0x80000005,
+  UNBIND: 0x00000006,
+  UNBIND_RESP: 0x80000006,
+  ENQUIRE_LINK: 0x00000015,
+  ENQUIRE_LINK_RESP: 0x80000015
+};
+
+const STATUS = {
+  ESME_ROK: 0x00,
+  ESME_RINVMSGLEN: 0x01,
+  ESME_RINVCMDID: 0x03,
+  ESME_RINVBNDSTS: 0x04,
+  ESME_RSYSERR: 0x08,
+  ESME_RBINDFAIL: 0x0d,
+  ESME_RINVPASWD: 0x0e,
+  ESME_RINVSYSID: 0x0f,
+  ESME_RMSGQFUL: 0x14,
+  ESME_RINVDSTADR: 0x0b,
+  ESME_RTHROTTLED: 0x58
+};
+
+// SMSC is busy, not the message: resubmit after a pause
+const THROTTLE_STATUSES = new Set([STATUS.ESME_RTHROTTLED, STATUS.ESME_RMSGQFUL]);
+
+const TLV = {
+  RECEIPTED_MESSAGE_ID: 0x001e,
+  MESSAGE_PAYLOAD: 0x0424,
+  MESSAGE_STATE: 0x0427
+};
+
+const DATA_CODING = {
+  DEFAULT: 0x00,
+  LATIN1: 0x03,
+  UCS2: 0x08
+};
+
+const HEADER_LENGTH = 16;
+const MAX_PDU_LENGTH = 64 * 1024;
+const MAX_SHORT_MESSAGE = 140;
+const INTERFACE_VERSION = 0x34;
+// How receipts quote submitted ids; 'auto' learns it from the first receipt
+// that matches a pending submission under exactly one of them
+const RECEIPT_ID_FORMATS = ['same', 'decimal', 'hex', 'auto'];
+const MAX_UNCORRELATED_RECEIPTS = 1000;
+
+// esm_class bit set on deliver_sm carrying a delivery receipt
+const ESM_DELIVERY_RECEIPT = 0x04;
+
+// message_state TLV / receipt stat → SmsMessage status
+const RECEIPT_STATES = {
+  1: 'enroute',
+  2: 'delivered',
+  3: 'expired',
+  4: 'deleted',
+  5: 'undelivered',
+  6: 'accepted',
+  7: 'unknown',
+  8: 'rejected',
+  ENROUTE: 'enroute',
+  DELIVRD: 'delivered',
+  EXPIRED: 'expired',
+  DELETED: 'deleted',
+  UNDELIV: 'undelivered',
+  ACCEPTD: 'accepted',
+  UNKNOWN: 'unknown',
+  REJECTD: 'rejected'
+};
+
+// ============================================
+// CONFIGURATION
+// ============================================
+
+function loadSettings(env = process.env) {
+  return {
+    enabled: Boolean(env.SMPP_HOST),
+    host: env.SMPP_HOST,
+    port: parseInt(env.SMPP_PORT, 10) || 2775,
+    systemId: env.SMPP_SYSTEM_ID || '',
+    password: env.SMPP_PASSWORD || '',
+    systemType: env.SMPP_SYSTEM_TYPE || '',
+    sourceAddr: env.SMPP_SOURCE_ADDR || 'CareVision',
+    binds: parseInt(env.SMPP_BINDS, 10) || 2,
+    // Unanswered submit_sm per bind
+    window: parseInt(env.SMPP_WINDOW, 10) || 10,
+    // Messages per second across all binds (negotiated with the operator)
+    throughput: parseInt(env.SMPP_THROUGHPUT, 10) || 100,
+    enquireLinkMs: (parseInt(env.SMPP_ENQUIRE_LINK_SECONDS, 10) || 30) * 1000,
+    responseTimeoutMs: parseInt(env.SMPP_RESPONSE_TIMEOUT_MS, 10) || 10000,
+    throttleBackoffMs: parseInt(env.SMPP_THROTTLE_BACKOFF_MS, 10) || 1000,
+    // Transport failures (bind lost, timeout) before giving the message back
+    maxSubmitAttempts: 3,
+    // Throttled answers are not the message's fault: resubmit longer
+    maxThrottleRetries: 10,
+    reconnectMinMs: 1000,
+    reconnectMaxMs: 30000,
+    // Receipts are correlated in memory this long after submission
+    receiptTtlMs: (parseInt(env.SMPP_RECEIPT_TTL_HOURS, 10) || 48) * 60 * 60 * 1000,
+    receiptIdFormat: RECEIPT_ID_FORMATS.includes(env.SMPP_RECEIPT_ID_FORMAT) ? env.SMPP_RECEIPT_ID_FORMAT : 'auto',
+    flushIntervalMs: 500,
+    flushBatchSize: 500
+  };
+}
+
+// ============================================
+// PDU CODEC (exported for tests)
+// ============================================
+
+function cString(value, max) {
+  const bytes = Buffer.from(String(value ?? ''), 'latin1');
+  return Buffer.concat([max ? bytes.subarray(0, max - 1) : bytes, Buffer.alloc(1)]);
+}
+
+const octet = (value) => Buffer.from([value & 0xff]);
+
+function tlv(tag, value) {
+  const header = Buffer.alloc(4);
+  header.writeUInt16BE(tag, 0);
+  header.writeUInt16BE(value.length, 2);
+  return Buffer.concat([header, value]);
+}
+
+/**
+ * Frame a PDU
+ * @param {number} commandId
+ * @param {number} sequence
+ * @param {Buffer} [body]
+ * @param {number} [status]
+ * @returns {Buffer}
+ */
+function encodePdu(commandId, sequence, body = Buffer.alloc(0), status = 0) {
+  const header = Buffer.alloc(HEADER_LENGTH);
+  header.writeUInt32BE(HEADER_LENGTH + body.length, 0);
+  header.writeUInt32BE(commandId >>> 0, 4);
+  header.writeUInt32BE(status >>> 0, 8);
+  header.writeUInt32BE(sequence >>> 0, 12);
+  return Buffer.concat([header, body]);
+}
+
+function bindBody({ systemId, password, systemType }) {
+  return Buffer.concat([
+    cString(systemId, 16),
+    cString(password, 9),
+    cString(systemType, 13),
+    octet(INTERFACE_VERSION),
+    octet(0), // addr_ton
+    octet(0), // addr_npi
+    cString('', 41) // address_range
+  ]);
+}
+
+/**
+ * TON/NPI of an address: alphanumeric sender, international number or short code
+ */
+function addressOf(value) {
+  const address = String(value || '').trim();
+  if (/[a-z]/i.test(address)) return { ton: 5, npi: 0, addr: address.slice(0, 11) };
+  const digits = address.replace(/\D/g, '');
+  if (address.startsWith('+') || digits.length > 8) return { ton: 1, npi: 1, addr: digits };
+  return { ton: 3, npi: 0, addr: digits };
+}
+
+/**
+ * Smallest data coding that represents the text
+ * @returns {Object} { dataCoding, bytes }
+ */
+function encodeText(text) {
+  const value = String(text ?? '');
+  // eslint-disable-next-line no-control-regex
+  if (/^[\x00-\x7f]*$/.test(value)) return { dataCoding: DATA_CODING.DEFAULT, bytes: Buffer.from(value, 'latin1') };
+  // eslint-disable-next-line no-control-regex
+  if (/^[\x00-\xff]*$/.test(value)) return { dataCoding: DATA_CODING.LATIN1, bytes: Buffer.from(value, 'latin1') };
+  return { dataCoding: DATA_CODING.UCS2, bytes: Buffer.from(value, 'utf16le').swap16() };
+}
+
+function decodeText(bytes, dataCoding) {
+  if (dataCoding === DATA_CODING.UCS2) return Buffer.from(bytes).swap16().toString('utf16le');
+  return bytes.toString('latin1');
+}
+
+/**
+ * submit_sm body with a delivery receipt requested. Texts longer than one
+ * short_message go in message_payload (the SMSC segments them).
+ */
+function submitSmBody({ source, destination, text }) {
+  const from = addressOf(source);
+  const to = addressOf(destination);
+  const { dataCoding, bytes } = encodeText(text);
+  const inPayload = bytes.length > MAX_SHORT_MESSAGE;
+
+  return Buffer.concat([
+    cString('', 6), // service_type
+    octet(from.ton), octet(from.npi), cString(from.addr, 21),
+    octet(to.ton), octet(to.npi), cString(to.addr, 21),
+    octet(0), // esm_class
+    octet(0), // protocol_id
+    octet(0), // priority_flag
+    cString('', 17), // schedule_delivery_time
+    cString('', 17), // validity_period
+    octet(1), // registered_delivery: final receipt
+    octet(0), // replace_if_present_flag
+    octet(dataCoding),
+    octet(0), // sm_default_msg_id
+    octet(inPayload ? 0 : bytes.length),
+    inPayload ? Buffer.alloc(0) : bytes,
+    inPayload ? tlv(TLV.MESSAGE_PAYLOAD, bytes) : Buffer.alloc(0)
+  ]);
+}
+
+class BodyReader {
+  constructor(buffer) {
+    this.buffer = buffer;
+    this.offset = 0;
+  }
+
+  cString() {
+    const end = this.buffer.indexOf(0, this.offset);
+    if (end === -1) {
+      const value = this.buffer.toString('latin1', this.offset);
+      this.offset = this.buffer.length;
+      return value;
+    }
+    const value = this.buffer.toString('latin1', this.offset, end);
+    this.offset = end + 1;
+    return value;
+  }
+
+  octet() {
+    return this.offset < this.buffer.length ? this.buffer[this.offset++] : 0;
+  }
+
+  bytes(length) {
+    const value = this.buffer.subarray(this.offset, this.offset + length);
+    this.offset += length;
+    return value;
+  }
+
+  tlvs() {
+    const values = {};
+    while (this.offset + 4 <= this.buffer.length) {
+      const tag = this.buffer.readUInt16BE(this.offset);
+      const length = this.buffer.readUInt16BE(this.offset + 2);
+      values[tag] = this.buffer.subarray(this.offset + 4, this.offset + 4 + length);
+      this.offset += 4 + length;
+    }
+    return values;
+  }
+}
+
+/**
+ * submit_sm / deliver_sm body
+ */
+function decodeShortMessage(body) {
+  const reader = new BodyReader(body);
+  const message = { serviceType: reader.cString() };
+  message.sourceTon = reader.octet();
+  message.sourceNpi = reader.octet();
+  message.source = reader.cString();
+  message.destinationTon = reader.octet();
+  message.destinationNpi = reader.octet();
+  message.destination = reader.cString();
+  message.esmClass = reader.octet();
+  reader.octet(); // protocol_id
+  reader.octet(); // priority_flag
+  reader.cString(); // schedule_delivery_time
+  reader.cString(); // validity_period
+  message.registeredDelivery = reader.octet();
+  reader.octet(); // replace_if_present_flag
+  message.dataCoding = reader.octet();
+  reader.octet(); // sm_default_msg_id
+  const length = reader.octet();
+  const bytes = reader.bytes(length);
+  message.tlvs = reader.tlvs();
+  const payload = message.tlvs[TLV.MESSAGE_PAYLOAD];
+  message.text = decodeText(payload && length === 0 ? payload : bytes, message.dataCoding);
+  return message;
+}
+
+/**
+ * Parse one complete PDU
+ * @param {Buffer} buffer
+ * @returns {Object} { commandId, status, sequence, body }
+ */
+function decodePdu(buffer) {
+  return {
+    length: buffer.readUInt32BE(0),
+    commandId: buffer.readUInt32BE(4),
+    status: buffer.readUInt32BE(8),
+    sequence: buffer.readUInt32BE(12),
+    body: buffer.subarray(HEADER_LENGTH)
+  };
+}
+
+/**
+ * Delivery receipt carried by a deliver_sm, or null for a mobile-originated message
+ * @returns {Object|null} { messageId, status, stat, error, doneAt }
+ */
+function parseReceipt(message) {
+  if (!(message.esmClass & ESM_DELIVERY_RECEIPT)) return null;
+
+  const text = message.text || '';
+  const field = (name) => (text.match(new RegExp(`${name}:\\s*(\\S+)`, 'i')) || [])[1];
+  const receiptedId = message.tlvs[TLV.RECEIPTED_MESSAGE_ID];
+  const state = message.tlvs[TLV.MESSAGE_STATE];
+  const stat = field('stat');
+  const done = text.match(/done date:\s*(\d{10,12})/i);
+
+  return {
+    messageId: receiptedId ? receiptedId.toString('latin1').replace(/\0+$/, '') : field('id'),
+    status: (state && RECEIPT_STATES[state[0]]) || RECEIPT_STATES[String(stat).toUpperCase()] || 'unknown',
+    stat: stat || null,
+    error: field('err') || null,
+    doneAt: done ? receiptDate(done[1]) : null
+  };
+}
+
+// YYMMDDhhmm[ss] in SMSC local time
+function receiptDate(value) {
+  const [yy, mm, dd, hh, mi, ss = '00'] = value.match(/\d\d/g);
+  return new Date(2000 + Number(yy), Number(mm) - 1, Number(dd), Number(hh), Number(mi), Number(ss));
+}
+
+// Ids are compared in this form: some SMSCs vary the case of hex ids
+function messageIdKey(messageId) {
+  return String(messageId || '').trim().toLowerCase();
+}
+
+/**
+ * Submitted id a receipt refers to, per how the SMSC quotes ids in receipts:
+ * 'same' as in submit_sm_resp, 'decimal' (hex ids quoted in decimal) or
+ * 'hex' (decimal ids quoted in hex). null if the id cannot be in that form.
+ */
+function receiptKey(receiptId, format) {
+  const id = messageIdKey(receiptId);
+  if (!id) return null;
+  if (format === 'decimal') return /^[0-9]+$/.test(id) ? BigInt(id).toString(16) : null;
+  if (format === 'hex') return /^[0-9a-f]+$/.test(id) && id.length <= 16 ? BigInt(`0x${id}`).toString(10) : null;
+  return id;
+}
+
+// ============================================
+// THROUGHPUT
+// ============================================
+
+/**
+ * Token bucket: take() resolves when a message may be submitted. Tokens
+ * accumulate up to a tenth of a second of traffic, so waiting senders are
+ * released in small bursts rather than on a 1 ms timer each.
+ */
+class TokenBucket {
+  constructor(ratePerSecond) {
+    this.rate = Math.max(1, ratePerSecond);
+    this.capacity = Math.max(1, Math.ceil(this.rate / 10));
+    this.tokens = this.capacity;
+    this.refilledAt = Date.now();
+    this.pausedUntil = 0;
+    this.waiters = [];
+    this.timer = null;
+  }
+
+  take() {
+    return new Promise(resolve => {
+      this.waiters.push(resolve);
+      this.drain();
+    });
+  }
+
+  /**
+   * The SMSC said slow down: no submissions for `ms`
+   */
+  pause(ms) {
+    this.pausedUntil = Math.max(this.pausedUntil, Date.now() + ms);
+    this.tokens = 0;
+    this.drain();
+  }
+
+  drain() {
+    const now = Date.now();
+    if (now >= this.pausedUntil) {
+      this.tokens = Math.min(this.capacity, this.tokens + ((now - this.refilledAt) * this.rate) / 1000);
+      while (this.waiters.length > 0 && this.tokens >= 1) {
+        this.tokens--;
+        this.waiters.shift()();
+      }
+    }
+    this.refilledAt = now;
+
+    if (this.waiters.length > 0 && !this.timer) {
+      const wait = now < this.pausedUntil
+        ? this.pausedUntil - now
+        : Math.ceil(((1 - this.tokens) * 1000) / this.rate);
+      this.timer = setTimeout(() => {
+        this.timer = null;
+        this.drain();
+      }, Math.max(1, wait));
+    }
+  }
+
+  clear() {
+    clearTimeout(this.timer);
+    this.timer = null;
+  }
+}
+
+// ============================================
+// SESSION (one bind)
+// ============================================
+
+class SmppSession extends EventEmitter {
+  constructor(settings, index) {
+    super();
+    this.settings = settings;
+    this.index = index;
+    this.state = 'closed';
+    this.socket = null;
+    this.buffer = Buffer.alloc(0);
+    this.sequence = 0;
+    this.pending = new Map();
+    // Unanswered submit_sm on this bind
+    this.inFlight = 0;
+    this.reconnectDelay = settings.reconnectMinMs;
+    this.reconnectTimer = null;
+    // When a working bind was lost (senders wait for the rebind a while)
+    this.lostAt = 0;
+    this.enquireTimer = null;
+    this.stopping = false;
+  }
+
+  get bound() {
+    // The socket is destroyed a tick before 'close' reaches onClose()
+    return this.state === 'bound' && Boolean(this.socket) && !this.socket.destroyed;
+  }
+
+  get freeWindow() {
+    return this.bound ? this.settings.window - this.inFlight : 0;
+  }
+
+  connect() {
+    if (this.socket || this.stopping) return;
+    this.state = 'connecting';
+    const socket = net.connect({ host: this.settings.host, port: this.settings.port });
+    this.socket = socket;
+    socket.setNoDelay(true);
+    socket.setKeepAlive(true, 60000);
+
+    socket.on('connect', () => this.bind());
+    socket.on('data', chunk => this.onData(chunk));
+    socket.on('error', error => log.warn('SMPP socket error', { bind: this.index, error: error.message }));
+    socket.on('close', () => this.onClose());
+  }
+
+  async bind() {
+    this.state = 'binding';
+    try {
+      const response = await this.request(COMMAND.BIND_TRANSCEIVER, bindBody(this.settings));
+      if (response.status !== STATUS.ESME_ROK) {
+        log.error('SMPP bind rejected', { bind: this.index, status: `0x${response.status.toString(16)}` });
+        this.socket?.destroy();
+        return;
+      }
+      this.state = 'bound';
+      this.lostAt = 0;
+      this.reconnectDelay = this.settings.reconnectMinMs;
+      this.enquireTimer = setInterval(() => {
+        this.request(COMMAND.ENQUIRE_LINK).catch(() => this.socket?.destroy());
+      }, this.settings.enquireLinkMs);
+      this.enquireTimer.unref?.();
+      log.info('SMPP bound', { bind: this.index, smsc: new BodyReader(response.body).cString() });
+      this.emit('bound', this);
+    } catch (error) {
+      log.warn('SMPP bind failed', { bind: this.index, error: error.message });
+      this.socket?.destroy();
+    }
+  }
+
+  onData(chunk) {
+    this.buffer = this.buffer.length ? Buffer.concat([this.buffer, chunk]) : chunk;
+    while (this.buffer.length >= 4) {
+      const length = this.buffer.readUInt32BE(0);
+      if (length < HEADER_LENGTH || length > MAX_PDU_LENGTH) {
+        log.error('SMPP framing error, dropping bind', { bind: this.index, length });
+        this.socket?.destroy();
+        return;
+      }
+      if (this.buffer.length < length) return;
+      const pdu = decodePdu(this.buffer.subarray(0, length));
+      this.buffer = this.buffer.subarray(length);
+      this.onPdu(pdu);
+    }
+  }
+
+  onPdu(pdu) {
+    if (pdu.commandId & 0x80000000) {
+      const waiter = this.pending.get(pdu.sequence);
+      if (!waiter) return;
+      this.pending.delete(pdu.sequence);
+      clearTimeout(waiter.timer);
+      waiter.resolve(pdu);
+      return;
+    }
+
+    switch (pdu.commandId) {
+      case COMMAND.DELIVER_SM: {
+        this.write(COMMAND.DELIVER_SM_RESP, pdu.sequence, cString(''));
+        let message;
+        try {
+          message = decodeShortMessage(pdu.body);
+        } catch (error) {
+          log.warn('Unreadable deliver_sm', { bind: this.index, error: error.message });
+          return;
+        }
+        const receipt = parseReceipt(message);
+        if (receipt) this.emit('receipt', receipt);
+        else this.emit('inbound', { from: message.source, to: message.destination, text: message.text });
+        return;
+      }
+      case COMMAND.ENQUIRE_LINK:
+        this.write(COMMAND.ENQUIRE_LINK_RESP, pdu.sequence);
+        return;
+      case COMMAND.UNBIND:
+        this.write(COMMAND.UNBIND_RESP, pdu.sequence);
+        this.socket?.end();
+        return;
+      default:
+        this.write(COMMAND.GENERIC_NACK, pdu.sequence, undefined, STATUS.ESME_RINVCMDID);
+    }
+  }
+
+  write(commandId, sequence, body, status) {
+    if (this.socket && !this.socket.destroyed) this.socket.write(encodePdu(commandId, sequence, body, status));
+  }
+
+  nextSequence() {
+    this.sequence = this.sequence >= 0x7fffffff ? 1 : this.sequence + 1;
+    return this.sequence;
+  }
+
+  /**
+   * Send a request PDU and resolve with its response PDU
+   */
+  request(commandId, body) {
+    return new Promise((resolve, reject) => {
+      if (!this.socket || this.socket.destroyed) {
+        reject(new Error('SMPP bind is not connected'));
+        return;
+      }
+      const sequence = this.nextSequence();
+      const timer = setTimeout(() => {
+        this.pending.delete(sequence);
+        reject(Object.assign(new Error('SMPP response timeout'), { written: true }));
+      }, this.settings.responseTimeoutMs);
+      this.pending.set(sequence, { resolve, reject, timer });
+      this.write(commandId, sequence, body);
+    });
+  }
+
+  onClose() {
+    const wasBound = this.state === 'bound';
+    clearInterval(this.enquireTimer);
+    this.socket = null;
+    this.buffer = Buffer.alloc(0);
+    this.state = 'closed';
+    for (const waiter of this.pending.values()) {
+      clearTimeout(waiter.timer);
+      waiter.reject(Object.assign(new Error('SMPP bind closed'), { written: true }));
+    }
+    this.pending.clear();
+    if (wasBound) {
+      this.lostAt = Date.now();
+      log.warn('SMPP bind lost', { bind: this.index });
+    }
+    this.emit('closed', this);
+
+    if (!this.stopping) {
+      this.reconnectTimer = setTimeout(() => {
+        this.reconnectTimer = null;
+        this.connect();
+      }, this.reconnectDelay);
+      this.reconnectTimer.unref?.();
+      this.reconnectDelay = Math.min(this.reconnectDelay * 2, this.settings.reconnectMaxMs);
+    }
+  }
+
+  async close() {
+    this.stopping = true;
+    clearTimeout(this.reconnectTimer);
+    if (!this.socket) return;
+    if (this.bound) {
+      this.state = 'unbinding';
+      await Promise.race([
+        this.request(COMMAND.UNBIND).catch(() => {}),
+        new Promise(resolve => setTimeout(resolve, 1000))
+      ]);
+    }
+    const socket = this.socket;
+    if (socket) {
+      await new Promise(resolve => {
+        socket.once('close', resolve);
+        socket.end();
+        setTimeout(() => socket.destroy(), 1000).unref?.();
+      });
+    }
+  }
+}
+
+// ============================================
+// DEFAULT STORE (MongoDB)
+// ============================================
+
+/**
+ * Persists submissions and receipts. Writes are upserts keyed by message
+ * id, so a receipt that overtakes its submission record still lands.
+ */
+function createMongoStore() {
+  // Lazy: keeps the channel loadable without a database (unit tests)
+  const SmsMessage = require('../models/SmsMessage');
+
+  return {
+    async write(records) {
+      const operations = records.map(record => (record.type === 'submitted'
+        ? {
+          updateOne: {
+            filter: { messageId: record.messageId },
+            update: {
+              $setOnInsert: { status: 'submitted' },
+              $set: {
+                provider: 'smpp',
+                to: record.to,
+                campaign: record.campaign,
+                reference: record.reference,
+                submittedAt: record.at
+              }
+            },
+            upsert: true
+          }
+        }
+        : {
+          updateOne: {
+            filter: { messageId: record.messageId },
+            update: { $set: { status: record.status, stat: record.stat, errorCode: record.error, doneAt: record.doneAt || record.at } },
+            upsert: true
+          }
+        }));
+      await SmsMessage.bulkWrite(operations, { ordered: true });
+    }
+  };
+}
+
+// ============================================
+// CHANNEL
+// ============================================
+
+class SmppService extends EventEmitter {
+  /**
+   * @param {Object} settings - From loadSettings()
+   * @param {Object} [deps] - { store } (default: SmsMessage collection)
+   */
+  constructor(settings = loadSettings(), deps = {}) {
+    super();
+    this.settings = settings;
+    this.storeOverride = deps.store || null;
+    this.sessions = [];
+    this.bucket = new TokenBucket(settings.throughput);
+    // Senders waiting for a free window slot on any bind
+    this.windowWaiters = [];
+    // Submitted message id key → { at }, for receipt correlation
+    this.submitted = new Map();
+    this.writes = [];
+    this.flushTimer = null;
+    this.started = false;
+    this.counters = { submitted: 0, failed: 0, throttled: 0, resubmitted: 0, unknown: 0, receipts: 0, unmatchedReceipts: 0 };
+    this.receiptCounts = {};
+    this.receiptIdFormat = settings.receiptIdFormat === 'auto' ? null : (settings.receiptIdFormat || null);
+    // Receipts received before the id form was learned that it would decide
+    this.uncorrelated = [];
+  }
+
+  get store() {
+    if (!this.storeOverride) this.storeOverride = createMongoStore();
+    return this.storeOverride;
+  }
+
+  /**
+   * Open the binds (no-op without SMPP_HOST)
+   */
+  start() {
+    if (!this.settings.enabled || this.started) return;
+    this.started = true;
+    for (let i = 0; i < this.settings.binds; i++) {
+      const session = new SmppSession(this.settings, i);
+      session.on('bound', () => this.releaseWindowWaiters());
+      session.on('closed', () => this.releaseWindowWaiters());
+      // A receipt can arrive in the same read as its submit_sm_resp: let the
+      // submission be recorded first
+      session.on('receipt', receipt => setImmediate(() => this.onReceipt(receipt)));
+      session.on('inbound', message => this.emit('inbound', message));
+      this.sessions.push(session);
+      session.connect();
+    }
+    this.flushTimer = setInterval(() => this.flush(), this.settings.flushIntervalMs);
+    this.flushTimer.unref?.();
+    log.info('SMPP channel starting', {
+      smsc: `${this.settings.host}:${this.settings.port}`,
+      binds: this.settings.binds,
+      window: this.settings.window,
+      throughput: this.settings.throughput
+    });
+  }
+
+  async stop() {
+    if (!this.started) return;
+    this.started = false;
+    clearInterval(this.flushTimer);
+    this.bucket.clear();
+    await Promise.all(this.sessions.map(session => session.close()));
+    this.sessions = [];
+    this.releaseWindowWaiters();
+    await this.flush();
+  }
+
+  isBound() {
+    return this.sessions.some(session => session.bound);
+  }
+
+  /**
+   * Wait until a bound session has a free window slot and take it
+   * @returns {Promise<SmppSession>}
+   */
+  acquireWindow() {
+    const session = this.freestSession();
+    if (session) {
+      session.inFlight++;
+      return Promise.resolve(session);
+    }
+    if (!this.started || !this.bindsAvailable()) {
+      return Promise.reject(new Error('No SMPP bind available'));
+    }
+    return new Promise((resolve, reject) => {
+      const waiter = { resolve, reject };
+      waiter.timer = setTimeout(() => {
+        this.windowWaiters.splice(this.windowWaiters.indexOf(waiter), 1);
+        reject(new Error('No SMPP bind available'));
+      }, this.settings.responseTimeoutMs);
+      this.windowWaiters.push(waiter);
+    });
+  }
+
+  releaseWindow(session) {
+    session.inFlight = Math.max(0, session.inFlight - 1);
+    this.releaseWindowWaiters();
+  }
+
+  releaseWindowWaiters() {
+    while (this.windowWaiters.length > 0) {
+      const session = this.freestSession();
+      if (!session) break;
+      const waiter = this.windowWaiters.shift();
+      clearTimeout(waiter.timer);
+      session.inFlight++;
+      waiter.resolve(session);
+    }
+    // Nothing is bound or coming back: fail fast so callers can fall back
+    if (this.windowWaiters.length > 0 && !this.bindsAvailable()) {
+      const waiters = this.windowWaiters.splice(0);
+      for (const waiter of waiters) {
+        clearTimeout(waiter.timer);
+        waiter.reject(new Error('No SMPP bind available'));
+      }
+    }
+  }
+
+  // Some bind is up, on its way up, or just dropped and rebinding
+  bindsAvailable() {
+    const now = Date.now();
+    return this.sessions.some(session => session.state !== 'closed' ||
+      (session.lostAt && now - session.lostAt < this.settings.reconnectMaxMs));
+  }
+
+  freestSession() {
+    let best = null;
+    for (const session of this.sessions) {
+      if (session.freeWindow > 0 && (!best || session.freeWindow > best.freeWindow)) best = session;
+    }
+    return best;
+  }
+
+  /**
+   * Submit one message at the negotiated rate
+   * @param {string} to - Destination (international format)
+   * @param {string} text
+   * @param {Object} [options] - { campaign, reference }
+   * @returns {Promise<Object>} { success, provider, messageId } or { success: false, error, code?, status?, retryable }
+   */
+  async send(to, text, options = {}) {
+    if (!this.settings.enabled) return { success: false, error: 'SMPP channel not configured', retryable: true };
+
+    const body = submitSmBody({ source: this.settings.sourceAddr, destination: to, text });
+    let lastError = 'SMPP submit failed';
+    let failures = 0;
+    let throttled = 0;
+
+    while (failures < this.settings.maxSubmitAttempts && throttled <= this.settings.maxThrottleRetries) {
+      if (failures + throttled > 0) this.counters.resubmitted++;
+      await this.bucket.take();
+
+      let session;
+      try {
+        session = await this.acquireWindow();
+      } catch (error) {
+        this.counters.failed++;
+        return { success: false, error: error.message, retryable: true };
+      }
+
+      let response;
+      try {
+        response = await session.request(COMMAND.SUBMIT_SM, body);
+      } catch (error) {
+        // Written but unanswered: the SMSC may have it, resubmitting could duplicate
+        if (error.written) {
+          this.counters.unknown++;
+          return { success: false, provider: 'smpp', error: error.message, status: 'unknown', retryable: false };
+        }
+        // Never left this process: resubmit on another bind
+        lastError = error.message;
+        failures++;
+        continue;
+      } finally {
+        this.releaseWindow(session);
+      }
+
+      if (response.status === STATUS.ESME_ROK) {
+        const messageId = new BodyReader(response.body).cString();
+        this.recordSubmitted(messageId, to, options);
+        return { success: true, provider: 'smpp', messageId, to };
+      }
+      if (THROTTLE_STATUSES.has(response.status)) {
+        this.counters.throttled++;
+        throttled++;
+        this.bucket.pause(this.settings.throttleBackoffMs);
+        lastError = `SMSC throttled (0x${response.status.toString(16)})`;
+        continue;
+      }
+
+      this.counters.failed++;
+      return {
+        success: false,
+        provider: 'smpp',
+        error: `SMSC rejected message (0x${response.status.toString(16)})`,
+        code: response.status,
+        retryable: false
+      };
+    }
+
+    this.counters.failed++;
+    return { success: false, provider: 'smpp', error: lastError, retryable: true };
+  }
+
+  /**
+   * Submit many messages, pipelined across binds and windows
+   * @param {Array<{to: string, text: string, reference?: string}>} messages
+   * @param {Object} [options] - { campaign }
+   * @returns {Promise<Array>} Results in input order
+   */
+  sendBulk(messages, options = {}) {
+    return Promise.all(messages.map(message =>
+      this.send(message.to, message.text, { ...options, reference: message.reference })
+        .catch(error => ({ success: false, error: error.message, retryable: true }))));
+  }
+
+  recordSubmitted(messageId, to, options) {
+    this.counters.submitted++;
+    const at = new Date();
+    this.submitted.set(messageIdKey(messageId), { messageId, at });
+    this.queueWrite({ type: 'submitted', messageId: messageIdKey(messageId), to, campaign: options.campaign, reference: options.reference, at });
+    if (this.submitted.size % 1000 === 0) this.pruneSubmitted();
+  }
+
+  onReceipt(receipt) {
+    if (!receipt.messageId) return;
+    this.counters.receipts++;
+    this.receiptCounts[receipt.status] = (this.receiptCounts[receipt.status] || 0) + 1;
+    this.correlateReceipt(receipt);
+  }
+
+  correlateReceipt(receipt) {
+    let key;
+    if (this.receiptIdFormat) {
+      key = receiptKey(receipt.messageId, this.receiptIdFormat);
+    } else {
+      key = this.learnReceiptIdFormat(receipt.messageId);
+      if (key === undefined) {
+        // Could name another message under another id form: held until the form is known
+        if (this.uncorrelated.length < MAX_UNCORRELATED_RECEIPTS) this.uncorrelated.push(receipt);
+        else this.counters.unmatchedReceipts++;
+        return;
+      }
+    }
+
+    const submission = key && this.submitted.get(key);
+    if (!submission) this.counters.unmatchedReceipts++;
+    else this.submitted.delete(key);
+    if (!key) return;
+
+    const record = { ...receipt, messageId: submission ? submission.messageId : key, at: new Date() };
+    // Persisted under the submitted id, even once the in-memory entry is gone
+    this.queueWrite({ type: 'receipt', ...record, messageId: key });
+    this.emit('receipt', record);
+  }
+
+  /**
+   * Key of a receipt while the SMSC's id form is unknown: a pending
+   * submission reachable under a single key, null for none, undefined when
+   * several forms match different submissions. The form is kept once a
+   * receipt matches under exactly one of them; held receipts are then replayed.
+   */
+  learnReceiptIdFormat(receiptId) {
+    const matches = ['same', 'decimal', 'hex']
+      .map(format => ({ format, key: receiptKey(receiptId, format) }))
+      .filter(match => match.key && this.submitted.has(match.key));
+    const keys = new Set(matches.map(match => match.key));
+    if (keys.size === 0) return null;
+    if (keys.size > 1) return undefined;
+
+    if (matches.length === 1) {
+      this.receiptIdFormat = matches[0].format;
+      log.info('SMSC receipt id format learned', { format: this.receiptIdFormat });
+      const held = this.uncorrelated.splice(0);
+      setImmediate(() => held.forEach(receipt => this.correlateReceipt(receipt)));
+    }
+    return matches[0].key;
+  }
+
+  pruneSubmitted() {
+    const cutoff = Date.now() - this.settings.receiptTtlMs;
+    for (const [key, entry] of this.submitted) {
+      if (entry.at.getTime() >= cutoff) break;
+      this.submitted.delete(key);
+    }
+  }
+
+  queueWrite(record) {
+    this.writes.push(record);
+    if (this.writes.length >= this.settings.flushBatchSize) this.flush();
+  }
+
+  async flush() {
+    if (this.writes.length === 0) return;
+    const records = this.writes.splice(0);
+    try {
+      await this.store.write(records);
+    } catch (error) {
+      log.error('Could not persist SMS delivery records', { count: records.length, error: error.message });
+    }
+  }
+
+  getStatus() {
+    return {
+      enabled: this.settings.enabled,
+      binds: this.sessions.map(session => ({ index: session.index, state: session.state, inFlight: session.inFlight })),
+      throughput: this.settings.throughput,
+      window: this.settings.window,
+      awaitingReceipt: this.submitted.size,
+      receiptIdFormat: this.receiptIdFormat || 'auto',
+      counters: { ...this.counters },
+      receipts: { ...this.receiptCounts }
+    };
+  }
+}
+
+const smppService = new SmppService();
+
+module.exports = smppService;
+module.exports.SmppService = SmppService;
+module.exports.TokenBucket = TokenBucket;
+module.exports.loadSettings = loadSettings;
+module.exports.COMMAND = COMMAND;
+module.exports.STATUS = STATUS;
+module.exports.encodePdu = encodePdu;
+module.exports.decodePdu = decodePdu;
+module.exports.submitSmBody = submitSmBody;
+module.exports.decodeShortMessage = decodeShortMessage;
+module.exports.encodeText = encodeText;
+module.exports.parseReceipt = parseReceipt;
+module.exports.receiptKey = receiptKey;
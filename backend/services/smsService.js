@@ -1,4 +1,5 @@
 const twilio = require('twilio');
+const smppService = require('./smppService');
 
 const { createContextLogger } = require('../utils/structuredLogger');
 const log = createContextLogger('Sms');
@@ -198,12 +199,30 @@ class SMSService {
   }
 
   // Send bulk SMS (for announcements)
+  // Over the operator SMPP bind when it is up (pipelined at the negotiated
+  // rate, delivery receipts recorded); Twilio for whatever it could not take
   async sendBulkSMS(phoneNumbers, message) {
-    if (!this.initialized) return [];
-
     const results = [];
+    let remaining = phoneNumbers;
+
+    if (smppService.isBound()) {
+      const smppResults = await smppService.sendBulk(phoneNumbers.map(phoneNumber => ({
+        to: this.formatPhoneNumber(phoneNumber),
+        text: message
+      })));
+      remaining = [];
+      smppResults.forEach((result, index) => {
+        if (!result.success && result.retryable && this.initialized) {
+          remaining.push(phoneNumbers[index]);
+        } else {
+          results.push({ phoneNumber: phoneNumbers[index], ...result });
+        }
+      });
+    }
+
+    if (!this.initialized) return results;
 
-    for (const phoneNumber of phoneNumbers) {
+    for (const phoneNumber of remaining) {
       const result = await this.sendSMS(phoneNumber, message);
       results.push({
         phoneNumber,
@@ -0,0 +1,661 @@
+/**
+ * Stocktake Service
+ *
+ * High-rate barcode counting for stream-mode stock reconciliations:
+ * - Snapshot of system quantities (per item and lot) taken when counting starts
+ * - Scans appended to StocktakeCount with insertMany; nothing rewrites the
+ *   reconciliation document while counting
+ * - Idempotent on the handheld's scanId, so offline devices can re-send
+ *   their queue after reconnecting
+ * - Live variance per item and lot from in-memory tallies
+ * - Adjustments applied with one version-guarded Inventory.bulkWrite
+ *
+ * Sessions are per process (the API runs as a single PM2 fork instance) and
+ * are rebuilt from the count stream on first access after a restart.
+ */
+
+const mongoose = require('mongoose');
+const StockReconciliation = require('../models/StockReconciliation');
+const StocktakeCount = require('../models/StocktakeCount');
+const { Inventory } = require('../models/Inventory');
+const { ErrorResponse } = require('../middleware/errorHandler');
+const { createContextLogger } = require('../utils/structuredLogger');
+
+const log = createContextLogger('Stocktake');
+
+// ============================================
+// CONSTANTS
+// ============================================
+
+const DEPARTMENT_TYPES = {
+  pharmacy: ['pharmacy'],
+  optical: ['frame', 'contact_lens', 'optical_lens'],
+  laboratory: ['reagent', 'lab_consumable'],
+  surgery: ['surgical_supply'],
+  all: null
+};
+
+const INSERT_BATCH_SIZE = 1000;
+const MAX_SCANS_PER_REQUEST = 5000;
+const APPLY_BATCH_SIZE = 500;
+const APPLY_MAX_ATTEMPTS = 3;
+const SESSION_IDLE_MS = 4 * 60 * 60 * 1000;
+const NO_LOT = '';
+
+const COUNTING_STATUSES = ['in_progress'];
+const APPLICABLE_STATUSES = ['in_progress', 'pending_review', 'reviewed'];
+
+const normalizeCode = code => String(code || '').trim().toUpperCase();
+
+// Lots are only reconciled for items actually counted lot by lot
+const countedByLot = tally => [...tally.lots.keys()].some(lot => lot !== NO_LOT);
+
+// ============================================
+// PURE HELPERS
+// ============================================
+
+/**
+ * Fold count rows into per-item tallies
+ * @param {Array} rows - [{ item, lotNumber, quantity, scans?, countedBy | counters[], location | locations[] }]
+ * @param {Map} [tallies] - Existing tallies to add to
+ * @returns {Map} - itemId -> { total, lots: Map(lot -> qty), counters: Set, locations: Set, scans }
+ */
+function tallyCounts(rows, tallies = new Map()) {
+  for (const row of rows) {
+    const key = String(row.item);
+    let tally = tallies.get(key);
+    if (!tally) {
+      tally = { total: 0, lots: new Map(), counters: new Set(), locations: new Set(), scans: 0 };
+      tallies.set(key, tally);
+    }
+    const lot = row.lotNumber || NO_LOT;
+    tally.total += row.quantity;
+    tally.lots.set(lot, (tally.lots.get(lot) || 0) + row.quantity);
+    tally.scans += row.scans ?? 1;
+    for (const counter of row.counters || [row.countedBy]) if (counter) tally.counters.add(String(counter));
+    for (const location of row.locations || [row.location]) if (location) tally.locations.add(location);
+  }
+  return tallies;
+}
+
+/**
+ * Variance lines and summary for a count against its snapshot
+ * @param {Map} snapshot - itemId -> { systemQuantity, lots: Map, name, sku, unit, costPrice, inventoryType }
+ * @param {Map} tallies - From tallyCounts
+ * @param {Object} options - { includeMatching }
+ */
+function computeVariance(snapshot, tallies, { includeMatching = false } = {}) {
+  const lines = [];
+  const summary = {
+    itemsInScope: snapshot.size,
+    itemsCounted: 0,
+    itemsWithVariance: 0,
+    uncounted: 0,
+    totalOverage: 0,
+    totalShortage: 0,
+    overageValue: 0,
+    shortageValue: 0
+  };
+
+  for (const [itemId, item] of snapshot) {
+    const tally = tallies.get(itemId);
+    if (!tally) {
+      summary.uncounted++;
+      continue;
+    }
+
+    summary.itemsCounted++;
+    const variance = tally.total - item.systemQuantity;
+    const value = variance * (item.costPrice || 0);
+    if (variance > 0) {
+      summary.totalOverage += variance;
+      summary.overageValue += value;
+    } else if (variance < 0) {
+      summary.totalShortage -= variance;
+      summary.shortageValue -= value;
+    }
+
+    const lotKeys = countedByLot(tally) ? new Set([...item.lots.keys(), ...tally.lots.keys()]) : new Set();
+    const lots = [...lotKeys].filter(lot => lot !== NO_LOT).map(lot => {
+      const system = item.lots.get(lot) || 0;
+      const counted = tally.lots.get(lot) || 0;
+      return { lotNumber: lot, systemQuantity: system, countedQuantity: counted, variance: counted - system };
+    });
+    const lotVariance = lots.some(l => l.variance !== 0);
+
+    if (variance !== 0 || lotVariance) summary.itemsWithVariance++;
+    if (variance === 0 && !lotVariance && !includeMatching) continue;
+
+    lines.push({
+      item: itemId,
+      name: item.name,
+      sku: item.sku,
+      unit: item.unit,
+      inventoryType: item.inventoryType,
+      systemQuantity: item.systemQuantity,
+      countedQuantity: tally.total,
+      variance,
+      varianceValue: value,
+      lots,
+      scans: tally.scans,
+      counters: tally.counters.size,
+      locations: [...tally.locations]
+    });
+  }
+
+  summary.netVarianceValue = summary.overageValue - summary.shortageValue;
+  summary.accuracyRate = summary.itemsCounted > 0
+    ? Number((((summary.itemsCounted - summary.itemsWithVariance) / summary.itemsCounted) * 100).toFixed(1))
+    : 100;
+
+  return { lines, summary };
+}
+
+/**
+ * Inventory bulkWrite operations for the counted deltas. Deltas are relative
+ * to the snapshot and applied to the current stock, so dispensing and
+ * receiving that happened during the count are kept.
+ * @param {Map} snapshot - As for computeVariance
+ * @param {Map} tallies - From tallyCounts
+ * @param {Array} current - Lean inventory docs (inventory, batches, version, discontinued)
+ * @param {Object} context - { userId, reference, zeroUncounted, now }
+ * @returns {Array} - [{ itemId, delta, previousQuantity, newQuantity, op }]
+ */
+function planAdjustments(snapshot, tallies, current, { userId, reference, zeroUncounted = false, now = new Date() }) {
+  const plans = [];
+
+  for (const doc of current) {
+    const itemId = String(doc._id);
+    const item = snapshot.get(itemId);
+    if (!item) continue;
+    const tally = tallies.get(itemId) ||
+      (zeroUncounted ? { total: 0, lots: new Map([...item.lots.keys()].map(lot => [lot, 0])) } : null);
+    if (!tally) continue;
+
+    const delta = tally.total - item.systemQuantity;
+    const previousQuantity = doc.inventory?.currentStock || 0;
+    const newQuantity = Math.max(0, previousQuantity + delta);
+
+    const $set = {};
+    const $push = {};
+    const arrayFilters = [];
+    const newBatches = [];
+    const batches = doc.batches || [];
+
+    const lotKeys = countedByLot(tally) ? new Set([...item.lots.keys(), ...tally.lots.keys()]) : new Set();
+    for (const lot of lotKeys) {
+      if (lot === NO_LOT) continue;
+      const lotDelta = (tally.lots.get(lot) || 0) - (item.lots.get(lot) || 0);
+      if (lotDelta === 0) continue;
+
+      const batchIndex = batches.findIndex(b => b.lotNumber === lot && !b.isDeleted);
+      if (batchIndex >= 0) {
+        const name = `l${arrayFilters.length}`;
+        $set[`batches.$[${name}].quantity`] = Math.max(0, (batches[batchIndex].quantity || 0) + lotDelta);
+        arrayFilters.push({ [`${name}._id`]: batches[batchIndex]._id });
+      } else if (lotDelta > 0) {
+        newBatches.push({
+          _id: new mongoose.Types.ObjectId(),
+          lotNumber: lot,
+          quantity: lotDelta,
+          receivedDate: now,
+          notes: `Found during stocktake ${reference}`
+        });
+      }
+    }
+
+    if (delta === 0 && arrayFilters.length === 0 && newBatches.length === 0) continue;
+
+    const inventory = { ...doc.inventory, currentStock: newQuantity };
+    $set['inventory.currentStock'] = newQuantity;
+    $set['inventory.available'] = Math.max(0, newQuantity - (doc.inventory?.reserved || 0));
+    $set['inventory.status'] = Inventory.computeInventoryStatus(inventory, doc.discontinued);
+    $set.updatedBy = userId;
+
+    $push.transactions = {
+      _id: new mongoose.Types.ObjectId(),
+      type: 'adjusted',
+      quantity: newQuantity - previousQuantity,
+      previousQuantity,
+      newQuantity,
+      reason: 'stocktake',
+      reference,
+      referenceType: 'stock_reconciliation',
+      performedBy: userId,
+      performedAt: now
+    };
+    if (newBatches.length) $push.batches = { $each: newBatches };
+
+    const updateOne = {
+      // Version guard: an item touched since it was read is re-planned
+      filter: { _id: doc._id, version: doc.version ?? null },
+      update: { $set, $push, $inc: { version: 1 } }
+    };
+    if (arrayFilters.length) updateOne.arrayFilters = arrayFilters;
+
+    plans.push({ itemId, delta, previousQuantity, newQuantity, op: { updateOne } });
+  }
+
+  return plans;
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+class StocktakeService {
+  constructor() {
+    this.sessions = new Map(); // reconciliationId -> Promise<session>
+  }
+
+  /**
+   * Freeze system quantities for the reconciliation's scope and open a session
+   * @param {Object} reconciliation - StockReconciliation document (in_progress)
+   */
+  async takeSnapshot(reconciliation) {
+    const types = DEPARTMENT_TYPES[reconciliation.department];
+    const query = { clinic: reconciliation.clinic, active: { $ne: false } };
+    if (types) query.inventoryType = { $in: types };
+
+    const items = await Inventory.find(query)
+      .select('inventoryType inventory.currentStock batches.lotNumber batches.quantity batches.isDeleted')
+      .lean();
+
+    const countSnapshot = {
+      takenAt: new Date(),
+      items: items.map(doc => ({
+        item: doc._id,
+        inventoryType: doc.inventoryType,
+        systemQuantity: doc.inventory?.currentStock || 0,
+        lots: (doc.batches || [])
+          .filter(b => !b.isDeleted && b.lotNumber)
+          .map(b => ({ lotNumber: b.lotNumber, quantity: b.quantity || 0 }))
+      }))
+    };
+
+    await StockReconciliation.updateOne({ _id: reconciliation._id }, { $set: { countSnapshot } });
+    this.sessions.delete(String(reconciliation._id));
+
+    log.info('Stocktake snapshot taken', {
+      reconciliation: reconciliation.reconciliationNumber,
+      items: countSnapshot.items.length
+    });
+    return countSnapshot;
+  }
+
+  /**
+   * In-memory session for a reconciliation, built once and shared by all requests
+   */
+  getSession(reconciliationId) {
+    const key = String(reconciliationId);
+    this._evictIdle();
+
+    let pending = this.sessions.get(key);
+    if (!pending) {
+      pending = this._buildSession(key).catch((error) => {
+        this.sessions.delete(key);
+        throw error;
+      });
+      this.sessions.set(key, pending);
+    }
+    return pending.then((session) => {
+      session.lastAccess = Date.now();
+      return session;
+    });
+  }
+
+  async _buildSession(reconciliationId) {
+    const reconciliation = await StockReconciliation.findById(reconciliationId)
+      .select('+countSnapshot reconciliationNumber clinic department status countMode history.action history.performedAt')
+      .lean();
+    if (!reconciliation) {
+      throw new ErrorResponse('Reconciliation not found', 404);
+    }
+    if (reconciliation.countMode !== 'stream' || !reconciliation.countSnapshot) {
+      throw new ErrorResponse('Reconciliation is not a started stream-mode count', 400);
+    }
+
+    const snapshotItems = reconciliation.countSnapshot.items || [];
+    const catalog = await Inventory.find({ _id: { $in: snapshotItems.map(i => i.item) } })
+      .select('name sku barcode inventory.unit pricing.costPrice')
+      .lean();
+    const catalogById = new Map(catalog.map(doc => [String(doc._id), doc]));
+
+    const snapshot = new Map();
+    const codes = new Map();
+    for (const entry of snapshotItems) {
+      const itemId = String(entry.item);
+      const doc = catalogById.get(itemId) || {};
+      snapshot.set(itemId, {
+        systemQuantity: entry.systemQuantity || 0,
+        lots: new Map((entry.lots || []).map(l => [l.lotNumber, l.quantity || 0])),
+        inventoryType: entry.inventoryType,
+        name: doc.name,
+        sku: doc.sku,
+        unit: doc.inventory?.unit || 'unit',
+        costPrice: doc.pricing?.costPrice || 0
+      });
+      if (doc.barcode) codes.set(normalizeCode(doc.barcode), itemId);
+      if (doc.sku && !codes.has(normalizeCode(doc.sku))) codes.set(normalizeCode(doc.sku), itemId);
+    }
+
+    // Once submitted, only scans received before submission count, so the
+    // adjustments applied match the items reviewed
+    const submitted = (reconciliation.history || []).find(h => h.action === 'submitted_for_review');
+    const until = COUNTING_STATUSES.includes(reconciliation.status) ? null : submitted?.performedAt;
+    const tallies = tallyCounts(await this._aggregateCounts(reconciliation._id, until));
+
+    return {
+      id: reconciliationId,
+      reconciliationNumber: reconciliation.reconciliationNumber,
+      status: reconciliation.status,
+      snapshotAt: reconciliation.countSnapshot.takenAt,
+      snapshot,
+      codes,
+      tallies,
+      devices: new Map(), // deviceId -> { scans, lastSeen }
+      stats: { accepted: 0, duplicates: 0, rejected: 0 },
+      lastAccess: Date.now()
+    };
+  }
+
+  async _aggregateCounts(reconciliationId, until = null) {
+    const match = { reconciliation: new mongoose.Types.ObjectId(String(reconciliationId)) };
+    if (until) match.receivedAt = { $lte: new Date(until) };
+
+    const rows = await StocktakeCount.aggregate([
+      { $match: match },
+      {
+        $group: {
+          _id: { item: '$inventoryItem', lotNumber: '$lotNumber' },
+          quantity: { $sum: '$quantity' },
+          scans: { $sum: 1 },
+          counters: { $addToSet: '$countedBy' },
+          locations: { $addToSet: '$location' }
+        }
+      }
+    ]);
+
+    return rows.map(row => ({
+      item: row._id.item,
+      lotNumber: row._id.lotNumber,
+      quantity: row.quantity,
+      scans: row.scans,
+      counters: row.counters,
+      locations: row.locations
+    }));
+  }
+
+  _evictIdle() {
+    const cutoff = Date.now() - SESSION_IDLE_MS;
+    for (const [key, pending] of this.sessions) {
+      pending.then((session) => {
+        if (session.lastAccess < cutoff && this.sessions.get(key) === pending) this.sessions.delete(key);
+      }, () => {});
+    }
+  }
+
+  closeSession(reconciliationId) {
+    this.sessions.delete(String(reconciliationId));
+  }
+
+  /**
+   * Append scans from one or more counters / handhelds
+   * @param {ObjectId} reconciliationId
+   * @param {Array} scans - [{ barcode | itemId, quantity=1, lotNumber, location, scanId, scannedAt }]
+   * @param {Object} context - { userId, deviceId }
+   * @returns {Promise<Object>} - { accepted, duplicates, rejected: [{ index, scanId, reason }] }
+   */
+  async recordScans(reconciliationId, scans, { userId, deviceId } = {}) {
+    if (!Array.isArray(scans) || scans.length === 0) {
+      throw new ErrorResponse('At least one scan is required', 400);
+    }
+    if (scans.length > MAX_SCANS_PER_REQUEST) {
+      throw new ErrorResponse(`At most ${MAX_SCANS_PER_REQUEST} scans per request`, 400);
+    }
+
+    // Status from the database, not the session: the count may have been
+    // submitted by another request (or process) since the session was built
+    const current = await StockReconciliation.findById(reconciliationId).select('status').lean();
+    if (!current) {
+      throw new ErrorResponse('Reconciliation not found', 404);
+    }
+    if (!COUNTING_STATUSES.includes(current.status)) {
+      this.closeSession(reconciliationId);
+      throw new ErrorResponse(`Cannot record counts while reconciliation is ${current.status}`, 409);
+    }
+
+    const session = await this.getSession(reconciliationId);
+
+    const reconciliation = new mongoose.Types.ObjectId(String(reconciliationId));
+    const receivedAt = new Date();
+    const rejected = [];
+    const docs = [];
+
+    scans.forEach((scan, index) => {
+      const itemId = scan.itemId
+        ? String(scan.itemId)
+        : session.codes.get(normalizeCode(scan.barcode));
+      const quantity = scan.quantity === undefined ? 1 : Number(scan.quantity);
+
+      let reason = null;
+      if (!itemId || !session.snapshot.has(itemId)) reason = 'unknown_item';
+      else if (!Number.isFinite(quantity) || quantity === 0) reason = 'invalid_quantity';
+      else if (!scan.scanId) reason = 'missing_scan_id';
+
+      if (reason) {
+        rejected.push({ index, scanId: scan.scanId, barcode: scan.barcode, reason });
+        return;
+      }
+
+      docs.push({
+        index,
+        doc: {
+          _id: new mongoose.Types.ObjectId(),
+          reconciliation,
+          inventoryItem: new mongoose.Types.ObjectId(itemId),
+          barcode: scan.barcode,
+          lotNumber: scan.lotNumber || undefined,
+          location: scan.location,
+          quantity,
+          countedBy: scan.countedBy || userId,
+          deviceId: scan.deviceId || deviceId,
+          scanId: String(scan.scanId),
+          scannedAt: scan.scannedAt ? new Date(scan.scannedAt) : receivedAt,
+          receivedAt
+        }
+      });
+    });
+
+    const inserted = [];
+    let duplicates = 0;
+    for (let start = 0; start < docs.length; start += INSERT_BATCH_SIZE) {
+      const batch = docs.slice(start, start + INSERT_BATCH_SIZE);
+      try {
+        await StocktakeCount.insertMany(batch.map(d => d.doc), { ordered: false, lean: true });
+        inserted.push(...batch);
+      } catch (error) {
+        if (!error.writeErrors) throw error;
+        const failed = new Map(error.writeErrors.map(e => [e.index, e]));
+        batch.forEach((entry, position) => {
+          const writeError = failed.get(position);
+          if (!writeError) inserted.push(entry);
+          else if (writeError.code === 11000 || writeError.err?.code === 11000) duplicates++;
+          else rejected.push({ index: entry.index, scanId: entry.doc.scanId, reason: writeError.errmsg || 'write_failed' });
+        });
+      }
+    }
+
+    tallyCounts(inserted.map(({ doc }) => ({
+      item: doc.inventoryItem,
+      lotNumber: doc.lotNumber,
+      quantity: doc.quantity,
+      countedBy: doc.countedBy,
+      location: doc.location
+    })), session.tallies);
+
+    const device = doc => doc.deviceId || String(doc.countedBy);
+    for (const { doc } of inserted) {
+      const entry = session.devices.get(device(doc)) || { scans: 0, lastSeen: null };
+      entry.scans++;
+      entry.lastSeen = receivedAt;
+      session.devices.set(device(doc), entry);
+    }
+
+    session.stats.accepted += inserted.length;
+    session.stats.duplicates += duplicates;
+    session.stats.rejected += rejected.length;
+
+    return { accepted: inserted.length, duplicates, rejected };
+  }
+
+  /**
+   * Live variance from the in-memory tallies
+   * @param {Object} options - { includeMatching, refresh }
+   */
+  async getLiveVariance(reconciliationId, { includeMatching = false, refresh = false } = {}) {
+    if (refresh) this.closeSession(reconciliationId);
+    const session = await this.getSession(reconciliationId);
+    const { lines, summary } = computeVariance(session.snapshot, session.tallies, { includeMatching });
+
+    return {
+      reconciliationNumber: session.reconciliationNumber,
+      snapshotAt: session.snapshotAt,
+      summary,
+      lines,
+      devices: [...session.devices].map(([deviceId, d]) => ({ deviceId, ...d })),
+      stream: { ...session.stats }
+    };
+  }
+
+  /**
+   * Write the counted result into the reconciliation's items array (once,
+   * on submit) so the existing variance report and review screens apply
+   * @param {Object} reconciliation - StockReconciliation document
+   */
+  async materializeItems(reconciliation) {
+    this.closeSession(reconciliation._id);
+    const session = await this.getSession(reconciliation._id);
+    const { lines } = computeVariance(session.snapshot, session.tallies, { includeMatching: true });
+
+    reconciliation.items = lines.map(line => ({
+      inventoryType: line.inventoryType,
+      inventoryItemId: line.item,
+      itemName: line.name || line.sku || String(line.item),
+      itemCode: line.sku,
+      location: line.locations.join(', ') || undefined,
+      unit: line.unit,
+      systemQuantity: line.systemQuantity,
+      countedQuantity: line.countedQuantity,
+      varianceValue: line.varianceValue,
+      countedAt: new Date()
+    }));
+    return reconciliation;
+  }
+
+  /**
+   * Apply the counted deltas to inventory in bulk; optimistic on the
+   * inventory version, re-planning items changed concurrently
+   * @param {ObjectId} reconciliationId
+   * @param {Object} options - { userId, notes, zeroUncounted }
+   */
+  async applyAdjustments(reconciliationId, { userId, notes, zeroUncounted = false } = {}) {
+    const reconciliation = await StockReconciliation.findById(reconciliationId);
+    if (!reconciliation) {
+      throw new ErrorResponse('Reconciliation not found', 404);
+    }
+    if (!APPLICABLE_STATUSES.includes(reconciliation.status)) {
+      throw new ErrorResponse(`Cannot apply adjustments while reconciliation is ${reconciliation.status}`, 409);
+    }
+
+    // Authoritative tallies straight from the stream, not the live cache
+    this.closeSession(reconciliationId);
+    const session = await this.getSession(reconciliationId);
+
+    const targetIds = zeroUncounted ? [...session.snapshot.keys()] : [...session.tallies.keys()];
+    let remaining = targetIds;
+    const applied = [];
+
+    for (let attempt = 1; attempt <= APPLY_MAX_ATTEMPTS && remaining.length > 0; attempt++) {
+      const current = await Inventory.find({ _id: { $in: remaining } })
+        .select('inventory batches._id batches.lotNumber batches.quantity batches.isDeleted version discontinued')
+        .lean();
+      const plans = planAdjustments(session.snapshot, session.tallies, current, {
+        userId,
+        reference: reconciliation.reconciliationNumber,
+        zeroUncounted
+      });
+
+      const conflicted = [];
+      for (let start = 0; start < plans.length; start += APPLY_BATCH_SIZE) {
+        const batch = plans.slice(start, start + APPLY_BATCH_SIZE);
+        const result = await Inventory.bulkWrite(batch.map(p => p.op), { ordered: false });
+
+        let written = null;
+        if (result.matchedCount < batch.length) {
+          // Identify the writes that landed by their pushed transaction id
+          const transactionIds = batch.map(p => p.op.updateOne.update.$push.transactions._id);
+          const landed = await Inventory.find({
+            _id: { $in: batch.map(p => p.itemId) },
+            'transactions._id': { $in: transactionIds }
+          }).select('_id').lean();
+          written = new Set(landed.map(doc => String(doc._id)));
+        }
+
+        for (const plan of batch) {
+          if (!written || written.has(plan.itemId)) applied.push(plan);
+          else conflicted.push(plan.itemId);
+        }
+      }
+      remaining = conflicted;
+    }
+
+    if (remaining.length > 0) {
+      log.warn('Stocktake adjustments skipped after concurrent updates', {
+        reconciliation: reconciliation.reconciliationNumber,
+        items: remaining.length
+      });
+    }
+
+    const appliedIds = new Set(applied.map(p => p.itemId));
+    const now = new Date();
+    for (const item of reconciliation.items) {
+      if (appliedIds.has(String(item.inventoryItemId)) && !item.adjustmentMade) {
+        item.adjustmentMade = true;
+        item.adjustedBy = userId;
+        item.adjustedAt = now;
+        item.adjustmentNotes = notes;
+      }
+    }
+    reconciliation.status = 'adjusted';
+    reconciliation.addHistory('adjustments_applied', userId, {
+      adjustmentCount: applied.length,
+      skipped: remaining.length,
+      mode: 'stream'
+    });
+    await reconciliation.save();
+    this.closeSession(reconciliationId);
+
+    log.info('Stocktake adjustments applied', {
+      reconciliation: reconciliation.reconciliationNumber,
+      adjusted: applied.length,
+      skipped: remaining.length
+    });
+
+    return {
+      reconciliation,
+      adjusted: applied.map(({ itemId, delta, previousQuantity, newQuantity }) => ({ itemId, delta, previousQuantity, newQuantity })),
+      skipped: remaining
+    };
+  }
+
+  getStatus() {
+    return { sessions: this.sessions.size };
+  }
+}
+
+module.exports = new StocktakeService();
+module.exports.StocktakeService = StocktakeService;
+module.exports.tallyCounts = tallyCounts;
+module.exports.computeVariance = computeVariance;
+module.exports.planAdjustments = planAdjustments;
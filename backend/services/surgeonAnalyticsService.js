@@ -6,6 +6,7 @@
 const SurgeryCase = require('../models/SurgeryCase');
 const SurgicalSafetyChecklist = require('../models/SurgicalSafetyChecklist');
 const User = require('../models/User');
+const readRouting = require('./readRoutingService');
 
 const { createContextLogger } = require('../utils/structuredLogger');
 const log = createContextLogger('SurgeonAnalytics');
@@ -527,10 +528,11 @@ async function getSurgeonComparisonReport(surgeonIds, startDate, endDate) {
   }
 }
 
+// Reports span months of cases: read them from analytics members
 module.exports = {
-  getSurgeonPerformanceReport,
-  getSurgeonBenchmarks,
-  getSurgeonComparisonReport,
+  getSurgeonPerformanceReport: readRouting.wrap('analytics', getSurgeonPerformanceReport),
+  getSurgeonBenchmarks: readRouting.wrap('analytics', getSurgeonBenchmarks),
+  getSurgeonComparisonReport: readRouting.wrap('analytics', getSurgeonComparisonReport),
   calculateVolumeMetrics,
   calculateOutcomeMetrics,
   calculateEfficiencyMetrics,
@@ -0,0 +1,566 @@
+/**
+ * Transfer Execution Service
+ *
+ * Set-based stock movements for inventory transfers:
+ * - Every line's source (and destination) items and batches resolved with
+ *   one query per collection instead of a findById per line
+ * - Quantities and lots validated in memory before anything is written
+ * - Decrements, increments and batch moves written with one bulkWrite on the
+ *   inventories collection, saved with the transfer in one short transaction
+ * - Version-guarded updates: an item moved concurrently makes the transaction
+ *   retry on fresh reads instead of overwriting the other movement
+ *
+ * All inventory types are discriminators of the same collection, so one
+ * bulkWrite covers pharmacy, optical and laboratory lines alike.
+ */
+
+const mongoose = require('mongoose');
+const { Inventory } = require('../models/Inventory');
+const { ErrorResponse } = require('../middleware/errorHandler');
+const { withTransactionRetry } = require('../utils/transactions');
+const { createContextLogger } = require('../utils/structuredLogger');
+
+const log = createContextLogger('TransferExecution');
+
+// ============================================
+// CONSTANTS
+// ============================================
+
+// Transfer line type -> Inventory discriminator key
+const INVENTORY_TYPE_KEYS = {
+  pharmacy: 'pharmacy',
+  frame: 'frame',
+  contactLens: 'contact_lens',
+  labConsumable: 'lab_consumable',
+  reagent: 'reagent'
+};
+
+const SHIPPABLE_ITEM_STATUSES = ['approved'];
+const RECEIVED_ITEM_STATUSES = ['received', 'partial'];
+
+// Fields not carried over when a destination clinic gets its first stock
+const NOT_COPIED_FIELDS = [
+  '_id', '__v', 'createdAt', 'updatedAt', 'transactions', 'batches', 'alerts',
+  'usage', 'reorder', 'version', 'createdBy', 'updatedBy', 'barcode'
+];
+
+const WRITE_CONFLICT = 112;
+
+const idOf = value => String(value?._id ?? value);
+
+const isUsableBatch = batch =>
+  !batch.isDeleted && (batch.status || 'available') === 'available' && (batch.quantity || 0) > 0;
+
+// First expiry first; undated lots last
+const byExpiry = (a, b) =>
+  (a.expirationDate ? new Date(a.expirationDate).getTime() : Infinity) -
+  (b.expirationDate ? new Date(b.expirationDate).getTime() : Infinity);
+
+function conflictError(expected, matched) {
+  const error = new Error(`WriteConflict: ${expected - matched} transfer item(s) changed concurrently`);
+  error.code = WRITE_CONFLICT;
+  return error;
+}
+
+// ============================================
+// PURE HELPERS
+// ============================================
+
+/**
+ * Transfer lines to ship, in transfer order
+ * @returns {Array} [{ lineId, itemId, inventoryType, quantity, lotNumber, productName }]
+ */
+function shipmentLines(transfer) {
+  return transfer.items
+    .filter(item => SHIPPABLE_ITEM_STATUSES.includes(item.status))
+    .map(item => ({
+      lineId: idOf(item),
+      itemId: idOf(item.inventoryId),
+      inventoryType: item.inventoryType,
+      quantity: item.approvedQuantity ?? item.requestedQuantity,
+      lotNumber: item.lotNumber || null,
+      productName: item.productName
+    }))
+    .filter(line => line.quantity > 0);
+}
+
+/**
+ * Validate and plan the source decrements of a shipment
+ *
+ * Lines naming a lot draw from that lot; others draw first-expiry-first
+ * from available batches, with any remainder taken from untracked stock.
+ *
+ * @param {Array} lines - From shipmentLines()
+ * @param {Map} sources - itemId -> lean Inventory document
+ * @param {Object} context - { userId, reference, destinationName, now }
+ * @returns {Object} { ops, allocations: Map(lineId -> [{ lotNumber, expirationDate, quantity }]), shortages }
+ */
+function planShipment(lines, sources, { userId, reference, destinationName, now = new Date() }) {
+  const shortages = [];
+  const allocations = new Map();
+  const working = new Map(); // itemId -> { doc, stock, batches, touched:Set, transactions }
+
+  for (const line of lines) {
+    const doc = sources.get(line.itemId);
+    if (!doc || doc.inventoryType !== INVENTORY_TYPE_KEYS[line.inventoryType]) {
+      shortages.push({ lineId: line.lineId, productName: line.productName, reason: 'not_found' });
+      continue;
+    }
+
+    if (!working.has(line.itemId)) {
+      working.set(line.itemId, {
+        doc,
+        stock: doc.inventory?.currentStock || 0,
+        batches: (doc.batches || []).map((batch, index) => ({ ...batch, index })),
+        touched: new Set(),
+        transactions: []
+      });
+    }
+    const state = working.get(line.itemId);
+
+    const available = state.stock - (doc.inventory?.reserved || 0);
+    if (available < line.quantity) {
+      shortages.push({
+        lineId: line.lineId,
+        productName: line.productName,
+        reason: 'insufficient_stock',
+        requested: line.quantity,
+        available: Math.max(0, available)
+      });
+      continue;
+    }
+
+    const drawn = [];
+    if (line.lotNumber) {
+      const batch = state.batches.find(b => b.lotNumber === line.lotNumber && isUsableBatch(b));
+      if (!batch || batch.quantity < line.quantity) {
+        shortages.push({
+          lineId: line.lineId,
+          productName: line.productName,
+          reason: 'insufficient_lot',
+          lotNumber: line.lotNumber,
+          requested: line.quantity,
+          available: batch?.quantity || 0
+        });
+        continue;
+      }
+      drawn.push({ batch, quantity: line.quantity });
+    } else {
+      let remaining = line.quantity;
+      for (const batch of state.batches.filter(isUsableBatch).sort(byExpiry)) {
+        if (remaining === 0) break;
+        const quantity = Math.min(remaining, batch.quantity);
+        drawn.push({ batch, quantity });
+        remaining -= quantity;
+      }
+    }
+
+    for (const { batch, quantity } of drawn) {
+      batch.quantity -= quantity;
+      state.touched.add(batch.index);
+    }
+    allocations.set(line.lineId, drawn.map(({ batch, quantity }) => ({
+      lotNumber: batch.lotNumber,
+      expirationDate: batch.expirationDate,
+      quantity
+    })));
+
+    const previousQuantity = state.stock;
+    state.stock -= line.quantity;
+    state.transactions.push({
+      _id: new mongoose.Types.ObjectId(),
+      type: 'transferred',
+      quantity: -line.quantity,
+      previousQuantity,
+      newQuantity: state.stock,
+      lotNumber: drawn.length === 1 ? drawn[0].batch.lotNumber : undefined,
+      reason: 'transfer_out',
+      reference,
+      referenceType: 'transfer',
+      performedBy: userId,
+      performedAt: now,
+      notes: `Shipped to ${destinationName || 'destination clinic'}`
+    });
+  }
+
+  const ops = [];
+  for (const state of working.values()) {
+    if (state.transactions.length === 0) continue;
+    const { doc } = state;
+
+    const $set = {
+      'inventory.currentStock': state.stock,
+      'inventory.available': Math.max(0, state.stock - (doc.inventory?.reserved || 0)),
+      'inventory.status': Inventory.computeInventoryStatus({ ...doc.inventory, currentStock: state.stock }, doc.discontinued),
+      updatedBy: userId
+    };
+    const arrayFilters = [];
+    for (const index of state.touched) {
+      const batch = state.batches[index];
+      const name = `b${arrayFilters.length}`;
+      $set[`batches.$[${name}].quantity`] = batch.quantity;
+      arrayFilters.push({ [`${name}._id`]: batch._id });
+    }
+
+    const updateOne = {
+      filter: { _id: doc._id, version: doc.version ?? null },
+      update: { $set, $push: { transactions: { $each: state.transactions } }, $inc: { version: 1 } }
+    };
+    if (arrayFilters.length) updateOne.arrayFilters = arrayFilters;
+    ops.push({ updateOne });
+  }
+
+  return { ops, allocations, shortages };
+}
+
+/**
+ * Transfer lines received by the last markReceived(), with their lots
+ */
+function receiptLines(transfer, receivedLineIds) {
+  return transfer.items
+    .filter(item => receivedLineIds.has(idOf(item)) && RECEIVED_ITEM_STATUSES.includes(item.status))
+    .map(item => ({
+      lineId: idOf(item),
+      itemId: idOf(item.inventoryId),
+      quantity: item.receivedQuantity || 0,
+      batches: item.shippedBatches?.length
+        ? item.shippedBatches.map(b => ({ lotNumber: b.lotNumber, expirationDate: b.expirationDate, quantity: b.quantity }))
+        : (item.lotNumber ? [{ lotNumber: item.lotNumber, expirationDate: item.expirationDate, quantity: Infinity }] : [])
+    }))
+    .filter(line => line.quantity > 0);
+}
+
+/**
+ * Key used to find the same product at the destination clinic
+ * (SKU is unique per clinic; pharmacy items also match on the drug)
+ */
+function destinationKeys(doc) {
+  const keys = [`sku:${doc.sku}`];
+  if (doc.inventoryType === 'pharmacy' && doc.medication) keys.push(`drug:${idOf(doc.medication)}`);
+  return keys;
+}
+
+/**
+ * Plan the destination increments of a receipt
+ *
+ * Received quantities are spread over the lots shipped for the line, in
+ * shipping order; products new to the clinic are inserted from the source.
+ *
+ * @param {Array} lines - From receiptLines()
+ * @param {Map} sources - itemId -> lean source Inventory document
+ * @param {Array} destinations - Lean Inventory documents at the destination clinic
+ * @param {Object} context - { userId, reference, sourceName, destinationClinic, now }
+ * @returns {Object} { ops, missing: [lineId] }
+ */
+function planReceipt(lines, sources, destinations, { userId, reference, sourceName, destinationClinic, now = new Date() }) {
+  const byKey = new Map();
+  for (const doc of destinations) {
+    for (const key of destinationKeys(doc)) {
+      if (!byKey.has(key)) byKey.set(key, doc);
+    }
+  }
+
+  const missing = [];
+  const working = new Map(); // destination key -> { doc, isNew, stock, batches, pushed, touched, transactions }
+
+  for (const line of lines) {
+    const source = sources.get(line.itemId);
+    if (!source) {
+      missing.push(line.lineId);
+      continue;
+    }
+
+    const existing = destinationKeys(source).map(key => byKey.get(key)).find(Boolean);
+    const key = existing ? `id:${idOf(existing)}` : `new:${source.inventoryType}:${source.sku}`;
+
+    if (!working.has(key)) {
+      const doc = existing || source;
+      working.set(key, {
+        doc,
+        isNew: !existing,
+        stock: existing ? (existing.inventory?.currentStock || 0) : 0,
+        batches: existing ? (existing.batches || []).map((batch, index) => ({ ...batch, index })) : [],
+        pushed: [],
+        touched: new Set(),
+        transactions: []
+      });
+    }
+    const state = working.get(key);
+
+    // Spread the received quantity over the shipped lots
+    let remaining = line.quantity;
+    let lastLot;
+    for (const lot of line.batches) {
+      if (remaining === 0) break;
+      const quantity = Math.min(remaining, lot.quantity);
+      remaining -= quantity;
+      lastLot = lot.lotNumber;
+
+      const batch = state.batches.find(b => b.lotNumber === lot.lotNumber && !b.isDeleted);
+      if (batch) {
+        batch.quantity = (batch.quantity || 0) + quantity;
+        state.touched.add(batch.index);
+        continue;
+      }
+      const pushed = state.pushed.find(b => b.lotNumber === lot.lotNumber);
+      if (pushed) {
+        pushed.quantity += quantity;
+      } else {
+        state.pushed.push({
+          _id: new mongoose.Types.ObjectId(),
+          lotNumber: lot.lotNumber,
+          quantity,
+          expirationDate: lot.expirationDate,
+          receivedDate: now,
+          notes: `Transfer ${reference}`
+        });
+      }
+    }
+
+    const previousQuantity = state.stock;
+    state.stock += line.quantity;
+    state.transactions.push({
+      _id: new mongoose.Types.ObjectId(),
+      type: 'transferred',
+      quantity: line.quantity,
+      previousQuantity,
+      newQuantity: state.stock,
+      lotNumber: line.batches.length === 1 ? lastLot : undefined,
+      reason: 'transfer_in',
+      reference,
+      referenceType: 'transfer',
+      performedBy: userId,
+      performedAt: now,
+      notes: `Received from ${sourceName || 'source clinic'}`
+    });
+  }
+
+  const ops = [];
+  for (const state of working.values()) {
+    const { doc } = state;
+
+    if (state.isNew) {
+      const document = { ...doc };
+      for (const field of NOT_COPIED_FIELDS) delete document[field];
+      const inventory = {
+        unit: doc.inventory?.unit,
+        minimumStock: doc.inventory?.minimumStock || 0,
+        reorderPoint: doc.inventory?.reorderPoint || 0,
+        maximumStock: doc.inventory?.maximumStock,
+        currentStock: state.stock,
+        reserved: 0,
+        available: state.stock
+      };
+      inventory.status = Inventory.computeInventoryStatus(inventory, doc.discontinued);
+
+      ops.push({
+        insertOne: {
+          document: {
+            ...document,
+            clinic: destinationClinic,
+            isDepot: false,
+            inventory,
+            batches: state.pushed,
+            transactions: state.transactions,
+            createdBy: userId,
+            version: 0
+          }
+        }
+      });
+      continue;
+    }
+
+    const $set = {
+      'inventory.currentStock': state.stock,
+      'inventory.available': Math.max(0, state.stock - (doc.inventory?.reserved || 0)),
+      'inventory.status': Inventory.computeInventoryStatus({ ...doc.inventory, currentStock: state.stock }, doc.discontinued),
+      updatedBy: userId
+    };
+    const arrayFilters = [];
+    for (const index of state.touched) {
+      const batch = state.batches[index];
+      const name = `b${arrayFilters.length}`;
+      $set[`batches.$[${name}].quantity`] = batch.quantity;
+      arrayFilters.push({ [`${name}._id`]: batch._id });
+    }
+
+    const $push = { transactions: { $each: state.transactions } };
+    if (state.pushed.length) $push.batches = { $each: state.pushed };
+
+    const updateOne = {
+      filter: { _id: doc._id, version: doc.version ?? null },
+      update: { $set, $push, $inc: { version: 1 } }
+    };
+    if (arrayFilters.length) updateOne.arrayFilters = arrayFilters;
+    ops.push({ updateOne });
+  }
+
+  return { ops, missing };
+}
+
+// ============================================
+// SERVICE
+// ============================================
+
+class TransferExecutionService {
+  /**
+   * Load inventory items by id in one query
+   * @param {Array} ids - Inventory ids
+   * @param {ClientSession|null} [session]
+   * @returns {Promise<Map>} id -> lean document
+   */
+  async loadItems(ids, session = null) {
+    const unique = [...new Set(ids.map(idOf))];
+    if (unique.length === 0) return new Map();
+
+    const docs = await Inventory.find({ _id: { $in: unique } })
+      .select('-transactions -alerts')
+      .session(session)
+      .lean();
+    return new Map(docs.map(doc => [idOf(doc), doc]));
+  }
+
+  /**
+   * Resolve the inventory items of new transfer lines
+   * @param {Array} items - Request lines [{ inventoryType, inventoryId }]
+   * @returns {Promise<Map>} inventoryId -> lean document of the matching type
+   */
+  async resolveLines(items) {
+    const docs = await this.loadItems(items.map(item => item.inventoryId));
+    const resolved = new Map();
+    for (const item of items) {
+      const doc = docs.get(idOf(item.inventoryId));
+      if (doc && doc.inventoryType === INVENTORY_TYPE_KEYS[item.inventoryType]) {
+        resolved.set(idOf(item.inventoryId), doc);
+      }
+    }
+    return resolved;
+  }
+
+  /**
+   * Run one execution attempt per transaction; the transfer is restored
+   * after a failed attempt so a retry (or the caller) sees it unchanged
+   */
+  async inTransaction(transfer, operation) {
+    const original = transfer.toObject();
+    return withTransactionRetry(async (session) => {
+      try {
+        return await operation(session);
+      } catch (error) {
+        transfer.overwrite(original);
+        throw error;
+      }
+    });
+  }
+
+  async writeOps(ops, session) {
+    if (ops.length === 0) return;
+    const expected = ops.filter(op => op.updateOne).length;
+    const result = await Inventory.bulkWrite(ops, { ordered: true, session });
+    if (result.matchedCount < expected) {
+      throw conflictError(expected, result.matchedCount);
+    }
+  }
+
+  /**
+   * Ship a transfer: deduct every approved line from source stock
+   *
+   * @param {Object} transfer - InventoryTransfer document (approved)
+   * @param {ObjectId} userId
+   * @param {Object} shippingInfo - { method, trackingNumber, carrier, expectedDelivery, notes }
+   * @throws {ErrorResponse} 409 with error.shortages when stock does not cover the lines
+   */
+  async ship(transfer, userId, shippingInfo = {}) {
+    const lines = shipmentLines(transfer);
+    const started = Date.now();
+    let planned;
+
+    await this.inTransaction(transfer, async (session) => {
+      const sources = await this.loadItems(lines.map(line => line.itemId), session);
+      planned = planShipment(lines, sources, {
+        userId,
+        reference: transfer.transferNumber,
+        destinationName: transfer.destination?.name
+      });
+
+      if (planned.shortages.length > 0) {
+        const error = new ErrorResponse('Insufficient stock to ship this transfer', 409);
+        error.shortages = planned.shortages;
+        throw error;
+      }
+
+      await this.writeOps(planned.ops, session);
+      transfer.markShipped(userId, shippingInfo, planned.allocations);
+      await transfer.save({ session });
+    });
+
+    log.info('Transfer shipped', {
+      transferNumber: transfer.transferNumber,
+      lines: lines.length,
+      items: planned.ops.length,
+      durationMs: Date.now() - started
+    });
+    return transfer;
+  }
+
+  /**
+   * Receive a transfer: add received quantities (and lots) at the destination
+   *
+   * @param {Object} transfer - InventoryTransfer document (in-transit)
+   * @param {ObjectId} userId
+   * @param {Array} receivedItems - [{ itemId, quantity, notes }]
+   */
+  async receive(transfer, userId, receivedItems = []) {
+    const started = Date.now();
+    const receivedLineIds = new Set(
+      transfer.items.filter(item => item.status === 'shipped').map(idOf)
+    );
+    let planned;
+
+    await this.inTransaction(transfer, async (session) => {
+      transfer.markReceived(userId, receivedItems);
+      const lines = receiptLines(transfer, receivedLineIds);
+
+      const sources = await this.loadItems(lines.map(line => line.itemId), session);
+      const products = [...sources.values()];
+      const destinations = products.length === 0 ? [] : await Inventory.find({
+        clinic: transfer.destination.clinic,
+        $or: [
+          { sku: { $in: products.map(doc => doc.sku) } },
+          { medication: { $in: products.map(doc => doc.medication).filter(Boolean) } }
+        ]
+      }).select('-transactions -alerts').session(session).lean();
+
+      planned = planReceipt(lines, sources, destinations, {
+        userId,
+        reference: transfer.transferNumber,
+        sourceName: transfer.source?.name,
+        destinationClinic: transfer.destination.clinic
+      });
+
+      await this.writeOps(planned.ops, session);
+      await transfer.save({ session });
+    });
+
+    if (planned.missing.length > 0) {
+      log.warn('Received transfer lines without a source item', {
+        transferNumber: transfer.transferNumber,
+        lines: planned.missing
+      });
+    }
+    log.info('Transfer received', {
+      transferNumber: transfer.transferNumber,
+      lines: receivedLineIds.size,
+      items: planned.ops.length,
+      durationMs: Date.now() - started
+    });
+    return transfer;
+  }
+}
+
+module.exports = new TransferExecutionService();
+module.exports.TransferExecutionService = TransferExecutionService;
+module.exports.shipmentLines = shipmentLines;
+module.exports.planShipment = planShipment;
+module.exports.receiptLines = receiptLines;
+module.exports.planReceipt = planReceipt;
@@ -3,6 +3,7 @@ const Visit = require('../models/Visit');
 const Appointment = require('../models/Appointment');
 const Alert = require('../models/Alert');
 const websocketService = require('./websocketService');
+const dbCostTracer = require('./dbCostTracer');
 
 const { createContextLogger } = require('../utils/structuredLogger');
 const log = createContextLogger('VisitCleanupScheduler');
@@ -42,24 +43,24 @@ class VisitCleanupScheduler {
     log.info('Starting visit cleanup scheduler...');
 
     // Job 1: Detect stuck visits (every 30 minutes)
-    const detectionJob = cron.schedule('*/30 * * * *', async () => {
+    const detectionJob = cron.schedule('*/30 * * * *', dbCostTracer.wrapJob('job:visit-stuck-detection', async () => {
       await this.detectStuckVisits();
-    });
+    }));
 
     // Job 2: Auto-fix signed but not completed visits (every 15 minutes)
-    const autoFixJob = cron.schedule('*/15 * * * *', async () => {
+    const autoFixJob = cron.schedule('*/15 * * * *', dbCostTracer.wrapJob('job:visit-autofix', async () => {
       await this.autoFixSignedVisits();
-    });
+    }));
 
     // Job 3: End-of-day cleanup (daily at 11 PM)
-    const endOfDayJob = cron.schedule('0 23 * * *', async () => {
+    const endOfDayJob = cron.schedule('0 23 * * *', dbCostTracer.wrapJob('job:visit-end-of-day', async () => {
       await this.endOfDayCleanup();
-    });
+    }));
 
     // Job 4: Sync appointment-visit status (every hour)
-    const syncJob = cron.schedule('0 * * * *', async () => {
+    const syncJob = cron.schedule('0 * * * *', dbCostTracer.wrapJob('job:visit-appointment-sync', async () => {
       await this.syncAppointmentVisitStatus();
-    });
+    }));
 
     this.jobs = [detectionJob, autoFixJob, endOfDayJob, syncJob];
     this.isRunning = true;
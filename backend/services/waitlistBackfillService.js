@@ -0,0 +1,640 @@
+/**
+ * Waitlist Backfill Service
+ *
+ * Refills slots freed by cancellations and reschedules from the waiting
+ * list, without staff effort (no-shows are recorded once the slot has
+ * started, always inside the minimum lead time, so they are not offered):
+ * - Matching: same clinic and department, provider (requested or flexible),
+ *   preferred weekday and time band, earliest/latest dates
+ * - Ranking: priority, then exact provider request, explicit day/time
+ *   preference, then longest waiting
+ * - Offers go out in waves (a few candidates at a time) with a short
+ *   acceptance window; when a wave expires or everyone declines, the next
+ *   ranked candidates get the offer
+ * - The first acceptance books the slot: the freed appointment's backfill
+ *   state is claimed with a conditional update, so concurrent acceptances
+ *   (or an acceptance racing the wave expiry) book it exactly once. The
+ *   other open offers are superseded and those patients stay on the list.
+ *
+ * Persistence goes through a store (MongoDB by default), notifications
+ * through a sink (SMS/email + staff WebSocket by default); tests inject both.
+ * Wave timers are in memory: after a restart, open offers can still be
+ * accepted until they expire, but no further waves are sent.
+ */
+
+const { createContextLogger } = require('../utils/structuredLogger');
+const log = createContextLogger('WaitlistBackfill');
+
+const PRIORITY_WEIGHT = {
+  urgent: 3,
+  high: 2,
+  normal: 1
+};
+
+// Events that free a slot for someone else
+const FREED_REASONS = ['cancelled', 'rescheduled'];
+
+// ============================================
+// CONFIGURATION
+// ============================================
+
+function loadSettings(env = process.env) {
+  return {
+    enabled: env.WAITLIST_BACKFILL_ENABLED !== 'false',
+    // Candidates offered the slot at once
+    waveSize: parseInt(env.WAITLIST_BACKFILL_WAVE_SIZE, 10) || 3,
+    maxWaves: parseInt(env.WAITLIST_BACKFILL_MAX_WAVES, 10) || 3,
+    offerWindowMs: (parseInt(env.WAITLIST_BACKFILL_OFFER_WINDOW_MINUTES, 10) || 15) * 60 * 1000,
+    // Slots starting sooner than this are not offered (patient could not make it)
+    minLeadMs: (parseInt(env.WAITLIST_BACKFILL_MIN_LEAD_MINUTES, 10) || 60) * 60 * 1000,
+    candidateLimit: parseInt(env.WAITLIST_BACKFILL_CANDIDATE_LIMIT, 10) || 200
+  };
+}
+
+// ============================================
+// PURE HELPERS (exported for tests)
+// ============================================
+
+const idOf = (value) => (value && value._id ? String(value._id) : value ? String(value) : null);
+
+/**
+ * Time band of a 'HH:MM' start time, as used in waiting-list preferences
+ */
+function timeBand(startTime) {
+  const hour = parseInt(String(startTime).split(':')[0], 10);
+  if (hour < 12) return 'morning';
+  if (hour < 17) return 'afternoon';
+  return 'evening';
+}
+
+/**
+ * Local start date-time of a slot (date at midnight + startTime)
+ */
+function slotStart(slot) {
+  const start = new Date(slot.date);
+  const [hours, minutes] = String(slot.startTime || '0:0').split(':');
+  start.setHours(parseInt(hours, 10) || 0, parseInt(minutes, 10) || 0, 0, 0);
+  return start;
+}
+
+/**
+ * Slot freed by an appointment
+ * @param {Object} appointment - Appointment (document or lean)
+ * @param {Object} [previous] - { date, startTime, endTime } before a reschedule
+ * @returns {Object} slot
+ */
+function slotFromAppointment(appointment, previous = {}) {
+  const date = new Date(previous.date || appointment.date);
+  const startTime = previous.startTime || appointment.startTime;
+  const sourceAppointment = idOf(appointment);
+  return {
+    key: `${sourceAppointment}:${date.toISOString().slice(0, 10)}:${startTime}`,
+    sourceAppointment,
+    clinic: idOf(appointment.clinic),
+    department: appointment.department,
+    provider: idOf(appointment.provider),
+    type: appointment.type,
+    date,
+    startTime,
+    endTime: previous.endTime || appointment.endTime,
+    duration: appointment.duration
+  };
+}
+
+/**
+ * Whether a waiting-list entry can take a slot
+ * @param {Object} entry - WaitingList entry (lean)
+ * @param {Object} slot - From slotFromAppointment()
+ * @param {Date} now
+ * @returns {boolean}
+ */
+function matchesSlot(entry, slot, now = new Date()) {
+  if (entry.status !== 'waiting' || entry.isDeleted) return false;
+  if (idOf(entry.clinic) !== slot.clinic || entry.department !== slot.department) return false;
+  if (entry.expiresAt && new Date(entry.expiresAt) <= now) return false;
+
+  const requested = idOf(entry.requestedProvider);
+  const preferences = entry.preferences || {};
+  if (requested && requested !== slot.provider && preferences.flexibleProvider === false) return false;
+
+  const start = slotStart(slot);
+  const days = preferences.preferredDays || [];
+  if (days.length > 0 && !days.includes(start.getDay())) return false;
+  const bands = preferences.preferredTimeSlots || [];
+  if (bands.length > 0 && !bands.includes(timeBand(slot.startTime))) return false;
+
+  if (preferences.earliestDate && start < new Date(preferences.earliestDate)) return false;
+  if (preferences.latestDate && start > new Date(preferences.latestDate)) return false;
+
+  return true;
+}
+
+/**
+ * Matching entries, best candidates first
+ * @param {Array} entries
+ * @param {Object} slot
+ * @param {Date} now
+ * @returns {Array}
+ */
+function rankCandidates(entries, slot, now = new Date()) {
+  const start = slotStart(slot);
+  const band = timeBand(slot.startTime);
+  const keyed = entries
+    .filter(entry => matchesSlot(entry, slot, now))
+    .map(entry => {
+      const preferences = entry.preferences || {};
+      return {
+        entry,
+        priority: PRIORITY_WEIGHT[entry.priority] || 1,
+        providerMatch: idOf(entry.requestedProvider) === slot.provider ? 1 : 0,
+        // Asked for exactly this day/band: more likely to accept quickly
+        preferenceMatch: ((preferences.preferredDays || []).includes(start.getDay()) ? 1 : 0) +
+          ((preferences.preferredTimeSlots || []).includes(band) ? 1 : 0),
+        waitingSince: new Date(entry.createdAt || now).getTime(),
+        position: entry.position || 0
+      };
+    });
+
+  keyed.sort((a, b) =>
+    b.priority - a.priority ||
+    b.providerMatch - a.providerMatch ||
+    b.preferenceMatch - a.preferenceMatch ||
+    a.waitingSince - b.waitingSince ||
+    a.position - b.position);
+
+  return keyed.map(item => item.entry);
+}
+
+/**
+ * Channel an offer is sent on, from the entry's contact preferences
+ */
+function offerChannel(entry) {
+  const contact = entry.contactPreferences || {};
+  const patient = entry.patient || {};
+  if (contact.sms && patient.phoneNumber) return 'sms';
+  if (contact.email !== false && patient.email) return 'email';
+  return 'phone';
+}
+
+// ============================================
+// DEFAULT STORE (MongoDB)
+// ============================================
+
+/**
+ * Store contract used by the engine. Every state change is a conditional
+ * update so concurrent callers cannot both succeed.
+ */
+function createMongoStore() {
+  // Lazy: keeps the engine loadable without a database (unit tests)
+  const mongoose = require('mongoose');
+  const Appointment = require('../models/Appointment');
+  const WaitingList = require('../models/WaitingList');
+
+  return {
+    async startBackfill(slot) {
+      const result = await Appointment.updateOne(
+        { _id: slot.sourceAppointment, 'backfill.status': { $ne: 'offering' }, 'backfill.slotKey': { $ne: slot.key } },
+        { $set: { backfill: { status: 'offering', slotKey: slot.key, startedAt: new Date() } } }
+      );
+      return result.modifiedCount === 1;
+    },
+
+    async finishBackfill(slot, status) {
+      await Appointment.updateOne(
+        { _id: slot.sourceAppointment, 'backfill.status': 'offering', 'backfill.slotKey': slot.key },
+        { $set: { 'backfill.status': status } }
+      );
+    },
+
+    async findCandidates(slot, limit) {
+      return WaitingList.find({
+        clinic: slot.clinic,
+        department: slot.department,
+        status: 'waiting',
+        isDeleted: { $ne: true },
+        'notifications.slotKey': { $ne: slot.key }
+      })
+        .sort({ createdAt: 1 })
+        .limit(limit)
+        .populate('patient', 'firstName lastName phoneNumber email')
+        .lean();
+    },
+
+    async createOffer(entry, slot, { wave, channel, expiresAt }) {
+      const offer = {
+        _id: new mongoose.Types.ObjectId(),
+        type: channel,
+        sentAt: new Date(),
+        slotOffered: { date: slot.date, startTime: slot.startTime, endTime: slot.endTime, provider: slot.provider },
+        response: 'pending',
+        expiresAt,
+        wave,
+        slotKey: slot.key,
+        sourceAppointment: slot.sourceAppointment
+      };
+      const result = await WaitingList.updateOne(
+        { _id: entry._id, status: 'waiting' },
+        { $set: { status: 'notified' }, $push: { notifications: offer } }
+      );
+      return result.modifiedCount === 1 ? offer : null;
+    },
+
+    async getOffer(entryId, offerId) {
+      const entry = await WaitingList.findOne({ _id: entryId, 'notifications._id': offerId })
+        .populate('patient', 'firstName lastName phoneNumber email')
+        .lean();
+      if (!entry) return null;
+      const offer = entry.notifications.find(notification => String(notification._id) === String(offerId));
+      return { entry, offer };
+    },
+
+    async setOfferResponse(entryId, offerId, from, response, entryStatus) {
+      const result = await WaitingList.updateOne(
+        { _id: entryId, notifications: { $elemMatch: { _id: offerId, response: from } } },
+        { $set: { 'notifications.$.response': response, 'notifications.$.respondedAt': new Date(), status: entryStatus } }
+      );
+      return result.modifiedCount === 1;
+    },
+
+    async pendingOffers(slot) {
+      const entries = await WaitingList.find({
+        notifications: { $elemMatch: { slotKey: slot.key, response: 'pending' } }
+      }).select('notifications patient contactPreferences')
+        .populate('patient', 'firstName lastName phoneNumber email')
+        .lean();
+      return entries.flatMap(entry => entry.notifications
+        .filter(offer => offer.slotKey === slot.key && offer.response === 'pending')
+        .map(offer => ({ entry, offer })));
+    },
+
+    async claimSlot(slot, entryId) {
+      const result = await Appointment.updateOne(
+        { _id: slot.sourceAppointment, 'backfill.status': 'offering', 'backfill.slotKey': slot.key },
+        { $set: { 'backfill.status': 'filled', 'backfill.filledBy': entryId, 'backfill.filledAt': new Date() } }
+      );
+      return result.modifiedCount === 1;
+    },
+
+    async releaseSlot(slot, entryId) {
+      await Appointment.updateOne(
+        { _id: slot.sourceAppointment, 'backfill.status': 'filled', 'backfill.filledBy': entryId },
+        { $set: { 'backfill.status': 'offering' }, $unset: { 'backfill.filledBy': 1, 'backfill.filledAt': 1 } }
+      );
+    },
+
+    async bookAppointment(slot, entry) {
+      const appointment = new Appointment({
+        patient: idOf(entry.patient),
+        provider: slot.provider,
+        clinic: slot.clinic,
+        date: slot.date,
+        startTime: slot.startTime,
+        endTime: slot.endTime,
+        duration: slot.duration,
+        type: entry.appointmentType || slot.type,
+        department: slot.department,
+        priority: entry.priority,
+        reason: entry.reason,
+        source: 'waitlist',
+        confirmation: { required: false, confirmed: true, confirmedAt: new Date(), confirmedBy: 'patient' },
+        createdBy: entry.createdBy
+      });
+      if (await appointment.hasConflict()) {
+        throw new Error('Slot is no longer free for this provider');
+      }
+      await appointment.save();
+      return appointment;
+    },
+
+    async markScheduled(entryId, slot, appointment) {
+      await WaitingList.updateOne({ _id: entryId }, { $set: { scheduledAppointment: appointment._id } });
+      await Appointment.updateOne(
+        { _id: slot.sourceAppointment, 'backfill.slotKey': slot.key },
+        { $set: { 'backfill.replacementAppointment': appointment._id } }
+      );
+    },
+
+    async expireStaleOffers(now) {
+      const result = await WaitingList.updateMany(
+        { status: 'notified', notifications: { $elemMatch: { response: 'pending', expiresAt: { $lte: now } } } },
+        { $set: { 'notifications.$[offer].response': 'expired', status: 'waiting' } },
+        { arrayFilters: [{ 'offer.response': 'pending', 'offer.expiresAt': { $lte: now } }] }
+      );
+      return result.modifiedCount;
+    }
+  };
+}
+
+// ============================================
+// DEFAULT NOTIFICATION SINK
+// ============================================
+
+const formatDay = (date) => new Date(date).toLocaleDateString('fr-FR', { weekday: 'long', day: 'numeric', month: 'long' });
+const formatTime = (date) => new Date(date).toLocaleTimeString('fr-FR', { hour: '2-digit', minute: '2-digit' });
+
+/**
+ * Patient message per event, staff WebSocket update for the clinic
+ * @param {Object} event - { type: offer|confirmed|superseded, entry, slot, offer?, appointment? }
+ */
+async function deliverNotification(event) {
+  const notificationFacade = require('./notificationFacade');
+  const websocketService = require('./websocketService');
+  const { type, entry, slot, offer } = event;
+  const patient = entry.patient || {};
+  const when = `${formatDay(slot.date)} à ${slot.startTime}`;
+
+  let message;
+  if (type === 'offer') {
+    message = `Bonjour ${patient.firstName || ''}, un rendez-vous s'est libéré le ${when}. ` +
+      `Appelez la clinique avant ${formatTime(offer.expiresAt)} pour le réserver. - Clinique Ophtalmologique`;
+  } else if (type === 'confirmed') {
+    message = `Bonjour ${patient.firstName || ''}, votre RDV du ${when} est confirmé. ` +
+      'Merci de vous présenter 15 min à l\'avance. - Clinique Ophtalmologique';
+  } else {
+    message = `Bonjour ${patient.firstName || ''}, le créneau du ${when} a été attribué. ` +
+      'Vous restez sur notre liste d\'attente. - Clinique Ophtalmologique';
+  }
+
+  const channel = offer?.type || offerChannel(entry);
+  if (channel === 'sms' || (type !== 'offer' && patient.phoneNumber)) {
+    if (patient.phoneNumber) await notificationFacade.sendSMS(patient.phoneNumber, message);
+  } else if (channel === 'email' && patient.email) {
+    await notificationFacade.sendEmailDirect({ to: patient.email, subject: 'Rendez-vous disponible', text: message });
+  }
+
+  // Staff see offers (and call patients who have no SMS/email) and bookings live
+  websocketService.emitAppointmentUpdate({
+    type: `waitlist_${type}`,
+    clinicId: slot.clinic,
+    appointmentId: event.appointment?._id || slot.sourceAppointment,
+    waitingListId: entry._id,
+    channel,
+    slot: { date: slot.date, startTime: slot.startTime, provider: slot.provider },
+    expiresAt: offer?.expiresAt
+  });
+}
+
+// ============================================
+// ENGINE
+// ============================================
+
+class WaitlistBackfill {
+  /**
+   * @param {Object} settings - From loadSettings()
+   * @param {Object} [deps] - { store, notify, now } (defaults: MongoDB, SMS/email/WebSocket, Date)
+   */
+  constructor(settings = loadSettings(), deps = {}) {
+    this.settings = settings;
+    this.storeOverride = deps.store || null;
+    this.notify = deps.notify || deliverNotification;
+    this.now = deps.now || (() => new Date());
+    // Backfills with wave timers in this process, by slot key
+    this.active = new Map();
+    this.counters = { slots: 0, offers: 0, booked: 0, exhausted: 0, taken: 0 };
+  }
+
+  get store() {
+    if (!this.storeOverride) this.storeOverride = createMongoStore();
+    return this.storeOverride;
+  }
+
+  /**
+   * Put offers left open by a previous process back on the list
+   */
+  async start() {
+    if (!this.settings.enabled) return;
+    try {
+      const expired = await this.store.expireStaleOffers(this.now());
+      log.info('Waitlist backfill started', { expiredOffers: expired });
+    } catch (error) {
+      log.warn('Could not expire stale waitlist offers', { error: error.message });
+    }
+  }
+
+  stop() {
+    for (const state of this.active.values()) clearTimeout(state.timer);
+    this.active.clear();
+  }
+
+  /**
+   * An appointment's slot became free. Never throws (called after the
+   * cancellation has been saved).
+   * @param {Object} appointment
+   * @param {string} reason - cancelled | rescheduled
+   * @param {Object} [previous] - Date/times before a reschedule
+   * @returns {Promise<Object>} { started, reason? }
+   */
+  async slotFreed(appointment, reason, previous) {
+    if (!this.settings.enabled || !FREED_REASONS.includes(reason)) return { started: false, reason: 'disabled' };
+
+    try {
+      const slot = slotFromAppointment(appointment, previous);
+      if (!slot.provider || !slot.clinic || !slot.startTime) return { started: false, reason: 'incomplete' };
+      if (slotStart(slot) - this.now() < this.settings.minLeadMs) return { started: false, reason: 'too-soon' };
+      if (!(await this.store.startBackfill(slot))) return { started: false, reason: 'already-running' };
+
+      this.counters.slots++;
+      this.active.set(slot.key, { slot, wave: 0, offered: new Set(), timer: null, booking: 0, closePending: false });
+      log.info('Backfilling freed slot', { slot: slot.key, reason, department: slot.department });
+      await this.sendWave(slot.key);
+      return { started: true, slot };
+    } catch (error) {
+      log.error('Waitlist backfill failed', { appointmentId: idOf(appointment), error: error.message });
+      return { started: false, reason: 'error' };
+    }
+  }
+
+  /**
+   * Offer the slot to the next ranked candidates
+   */
+  async sendWave(slotKey) {
+    const state = this.active.get(slotKey);
+    if (!state) return;
+    const { slot } = state;
+
+    if (state.wave >= this.settings.maxWaves) return this.finish(slotKey, 'exhausted');
+
+    const entries = await this.store.findCandidates(slot, this.settings.candidateLimit);
+    const ranked = rankCandidates(entries.filter(entry => !state.offered.has(idOf(entry))), slot, this.now());
+    if (ranked.length === 0) return this.finish(slotKey, 'exhausted');
+
+    state.wave++;
+    const expiresAt = new Date(Math.min(this.now().getTime() + this.settings.offerWindowMs, slotStart(slot).getTime()));
+    let sent = 0;
+    for (const entry of ranked) {
+      if (sent >= this.settings.waveSize) break;
+      state.offered.add(idOf(entry));
+      const channel = offerChannel(entry);
+      const offer = await this.store.createOffer(entry, slot, { wave: state.wave, channel, expiresAt });
+      if (!offer) continue; // Taken by another slot's offer meanwhile
+      sent++;
+      this.counters.offers++;
+      await this.safeNotify({ type: 'offer', entry, slot, offer });
+    }
+
+    if (sent === 0) return this.sendWave(slotKey);
+
+    log.info('Waitlist offer wave sent', { slot: slotKey, wave: state.wave, offers: sent });
+    state.timer = setTimeout(() => {
+      this.closeWave(slotKey).catch(error => log.error('Closing waitlist wave failed', { slot: slotKey, error: error.message }));
+    }, Math.max(0, expiresAt - this.now()));
+    state.timer.unref?.();
+  }
+
+  /**
+   * Expire the open offers of the current wave, then offer to the next one
+   */
+  async closeWave(slotKey) {
+    const state = this.active.get(slotKey);
+    if (!state) return;
+    clearTimeout(state.timer);
+    // An acceptance is being booked: decide once it succeeds or fails
+    if (state.booking > 0) {
+      state.closePending = true;
+      return;
+    }
+
+    for (const { entry, offer } of await this.store.pendingOffers(state.slot)) {
+      await this.store.setOfferResponse(entry._id, offer._id, 'pending', 'expired', 'waiting');
+    }
+    if (this.active.has(slotKey)) await this.sendWave(slotKey);
+  }
+
+  async finish(slotKey, status) {
+    const state = this.active.get(slotKey);
+    if (!state) return;
+    clearTimeout(state.timer);
+    this.active.delete(slotKey);
+    if (status === 'exhausted') {
+      this.counters.exhausted++;
+      await this.store.finishBackfill(state.slot, status);
+      log.info('No waiting-list patient took the slot', { slot: slotKey, waves: state.wave });
+    }
+  }
+
+  /**
+   * Patient's answer to an offer (recorded by staff or a patient channel)
+   * @param {string} entryId - WaitingList entry
+   * @param {string} offerId - Notification id of the offer
+   * @param {boolean} accept
+   * @returns {Promise<Object>} { status: booked|declined|taken|expired|unavailable|already-responded|not-found, appointment? }
+   */
+  async respond(entryId, offerId, accept) {
+    const found = await this.store.getOffer(entryId, offerId);
+    if (!found || !found.offer) return { status: 'not-found' };
+    const { entry, offer } = found;
+    if (offer.response !== 'pending') return { status: 'already-responded', response: offer.response };
+
+    const slot = this.active.get(offer.slotKey)?.slot || {
+      key: offer.slotKey,
+      sourceAppointment: idOf(offer.sourceAppointment),
+      clinic: idOf(entry.clinic),
+      department: entry.department,
+      provider: idOf(offer.slotOffered.provider),
+      date: offer.slotOffered.date,
+      startTime: offer.slotOffered.startTime,
+      endTime: offer.slotOffered.endTime
+    };
+
+    if (new Date(offer.expiresAt) <= this.now()) {
+      await this.store.setOfferResponse(entryId, offerId, 'pending', 'expired', 'waiting');
+      return { status: 'expired' };
+    }
+
+    if (!accept) {
+      if (!(await this.store.setOfferResponse(entryId, offerId, 'pending', 'declined', 'waiting'))) {
+        return { status: 'already-responded' };
+      }
+      await this.advanceIfWaveAnswered(slot.key);
+      return { status: 'declined' };
+    }
+
+    // Lock this offer first so the wave expiry cannot expire it mid-booking
+    const state = this.active.get(slot.key);
+    if (state) state.booking++;
+    let appointment;
+    try {
+      if (!(await this.store.setOfferResponse(entryId, offerId, 'pending', 'accepted', 'notified'))) {
+        return { status: 'expired' };
+      }
+
+      if (!(await this.store.claimSlot(slot, entryId))) {
+        await this.store.setOfferResponse(entryId, offerId, 'accepted', 'superseded', 'waiting');
+        this.counters.taken++;
+        return { status: 'taken' };
+      }
+
+      try {
+        appointment = await this.store.bookAppointment(slot, entry);
+      } catch (error) {
+        log.warn('Booking from waiting list failed', { slot: slot.key, error: error.message });
+        await this.store.releaseSlot(slot, entryId);
+        await this.store.setOfferResponse(entryId, offerId, 'accepted', 'expired', 'waiting');
+        return { status: 'unavailable' };
+      }
+    } finally {
+      if (state) {
+        state.booking--;
+        // The wave ran out while this acceptance was in flight and it did not book
+        if (!appointment && state.booking === 0 && state.closePending && this.active.has(slot.key)) {
+          state.closePending = false;
+          await this.closeWave(slot.key);
+        }
+      }
+    }
+
+    await this.store.setOfferResponse(entryId, offerId, 'accepted', 'accepted', 'scheduled');
+    await this.store.markScheduled(entryId, slot, appointment);
+    this.counters.booked++;
+    log.info('Freed slot booked from waiting list', { slot: slot.key, waitingListId: String(entryId) });
+
+    // Everyone else with an open offer for this slot stays on the list
+    for (const other of await this.store.pendingOffers(slot)) {
+      if (await this.store.setOfferResponse(other.entry._id, other.offer._id, 'pending', 'superseded', 'waiting')) {
+        await this.safeNotify({ type: 'superseded', entry: other.entry, slot, offer: other.offer });
+      }
+    }
+    await this.finish(slot.key, 'filled');
+    await this.safeNotify({ type: 'confirmed', entry, slot, offer, appointment });
+
+    return { status: 'booked', appointment };
+  }
+
+  /**
+   * Everyone in the wave declined: don't wait for the window to run out
+   */
+  async advanceIfWaveAnswered(slotKey) {
+    const state = this.active.get(slotKey);
+    if (!state) return;
+    const pending = await this.store.pendingOffers(state.slot);
+    if (pending.length === 0) await this.closeWave(slotKey);
+  }
+
+  async safeNotify(event) {
+    try {
+      await this.notify(event);
+    } catch (error) {
+      log.warn('Waitlist notification failed', { type: event.type, error: error.message });
+    }
+  }
+
+  getStatus() {
+    return {
+      enabled: this.settings.enabled,
+      activeSlots: this.active.size,
+      counters: { ...this.counters }
+    };
+  }
+}
+
+const waitlistBackfill = new WaitlistBackfill();
+
+module.exports = waitlistBackfill;
+module.exports.WaitlistBackfill = WaitlistBackfill;
+module.exports.loadSettings = loadSettings;
+module.exports.timeBand = timeBand;
+module.exports.slotStart = slotStart;
+module.exports.slotFromAppointment = slotFromAppointment;
+module.exports.matchesSlot = matchesSlot;
+module.exports.rankCandidates = rankCandidates;
+module.exports.offerChannel = offerChannel;
@@ -2,6 +2,7 @@ const socketIO = require('socket.io');
 const jwt = require('jsonwebtoken');
 const User = require('../models/User');
 const CONSTANTS = require('../config/constants');
+const memoryWatchdog = require('./memoryWatchdog');
 
 const { createContextLogger } = require('../utils/structuredLogger');
 const log = createContextLogger('Websocket');
@@ -1174,4 +1175,16 @@ class WebSocketService {
   }
 }
 
-module.exports = new WebSocketService();
+const websocketService = new WebSocketService();
+
+// Replay buffers: one entry per room/user, sized by buffered messages
+const bufferedMessages = buffers => {
+  let entries = 0;
+  for (const messages of buffers.values()) entries += messages.length;
+  return { entries, keys: buffers.size };
+};
+memoryWatchdog.register('websocket:roomBuffers', () => bufferedMessages(websocketService.messageBuffer));
+memoryWatchdog.register('websocket:userBuffers', () => bufferedMessages(websocketService.userMessageBuffer));
+memoryWatchdog.register('websocket:userLastSeen', () => websocketService.userLastSeen.size);
+
+module.exports = websocketService;
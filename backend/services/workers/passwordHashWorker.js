@@ -0,0 +1,29 @@
+/**
+ * Password Hash Worker
+ *
+ * Runs password hashing and verification on a worker thread so the
+ * main event loop keeps serving requests during login bursts.
+ *
+ * Message protocol:
+ *   in:  { id, op: 'hash' | 'verify', password, hash }
+ *   out: { id, result } | { id, error }
+ */
+
+const { parentPort } = require('worker_threads');
+const { hashPasswordSync, verifyPasswordSync } = require('../../utils/passwordHash');
+
+parentPort.on('message', ({ id, op, password, hash }) => {
+  try {
+    let result;
+    if (op === 'hash') {
+      result = hashPasswordSync(password);
+    } else if (op === 'verify') {
+      result = verifyPasswordSync(password, hash);
+    } else {
+      throw new Error(`Unknown password hash operation: ${op}`);
+    }
+    parentPort.postMessage({ id, result });
+  } catch (error) {
+    parentPort.postMessage({ id, error: error.message });
+  }
+});
@@ -0,0 +1,38 @@
+/**
+ * Recorded query workload for the index advisor tests.
+ *
+ * Shapes taken from visit list screens: clinic worklist sorted by date,
+ * free-text name search, deep offset pagination and a status lookup.
+ */
+
+const clinicA = '64b000000000000000000001';
+const clinicB = '64b000000000000000000002';
+
+const workload = [
+  // Worklist: equality on clinic + status, newest first
+  ...Array.from({ length: 20 }, (_, i) => ({
+    filter: { clinic: i % 2 ? clinicA : clinicB, status: 'in-progress' },
+    sort: { visitDate: -1 },
+    limit: 20
+  })),
+  // Name search with a case-insensitive contains-regex
+  ...Array.from({ length: 5 }, () => ({
+    filter: { patientName: { $regex: 'dupont', $options: 'i' } }
+  })),
+  // Offset pagination deep into the clinic list
+  { filter: { clinic: clinicA }, sort: { visitDate: -1 }, skip: 1500, limit: 50 },
+  // Served exactly by { clinic: 1, status: 1 }
+  ...Array.from({ length: 5 }, () => ({ filter: { clinic: clinicA, status: 'completed' } }))
+];
+
+// Documents so every query has something to scan
+const documents = Array.from({ length: 200 }, (_, i) => ({
+  visitNumber: `V${String(i).padStart(5, '0')}`,
+  clinic: i % 2 ? clinicA : clinicB,
+  status: ['in-progress', 'completed', 'cancelled'][i % 3],
+  visitDate: new Date(Date.UTC(2026, 0, 1 + (i % 300))),
+  patientName: i % 10 === 0 ? `DUPONT ${i}` : `PATIENT ${i}`,
+  legacyCode: `L${i}`
+}));
+
+module.exports = { workload, documents, clinicA, clinicB };
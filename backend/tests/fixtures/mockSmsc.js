@@ -0,0 +1,222 @@
+const net = require('net');
+
+/**
+ * Mock SMSC (SMPP v3.4)
+ *
+ * Operator simulator for SMPP channel tests and local development:
+ * - bind_transceiver with system id / password check
+ * - submit_sm answered with a hex message id after `responseDelayMs`,
+ *   ESME_RTHROTTLED above `maxPerSecond`, ESME_RINVDSTADR for `rejected`
+ * - Delivery receipt (deliver_sm) after `receiptDelayMs`: UNDELIV for
+ *   numbers in `undeliverable`, DELIVRD otherwise; the id is quoted in
+ *   decimal when `decimalReceiptIds` (as some operators do)
+ * - Records, per bind, the most submit_sm it held unanswered at once
+ *
+ * Run standalone: node tests/fixtures/mockSmsc.js [port]
+ * (then SMPP_HOST=127.0.0.1 SMPP_PORT=<port> SMPP_SYSTEM_ID=medflow SMPP_PASSWORD=secret)
+ */
+
+const BIND_TRANSCEIVER = 0x00000009;
+const SUBMIT_SM = 0x00000004;
+const DELIVER_SM = 0x00000005;
+const UNBIND = 0x00000006;
+const ENQUIRE_LINK = 0x00000015;
+const RESP = 0x80000000;
+const GENERIC_NACK = 0x80000000;
+
+const ESME_RINVPASWD = 0x0e;
+const ESME_RINVDSTADR = 0x0b;
+const ESME_RTHROTTLED = 0x58;
+
+function pdu(commandId, status, sequence, body = Buffer.alloc(0)) {
+  const header = Buffer.alloc(16);
+  header.writeUInt32BE(16 + body.length, 0);
+  header.writeUInt32BE(commandId >>> 0, 4);
+  header.writeUInt32BE(status, 8);
+  header.writeUInt32BE(sequence, 12);
+  return Buffer.concat([header, body]);
+}
+
+const cString = (value) => Buffer.concat([Buffer.from(value, 'latin1'), Buffer.alloc(1)]);
+
+function readSubmit(body) {
+  let offset = 0;
+  const str = () => {
+    const end = body.indexOf(0, offset);
+    const value = body.toString('latin1', offset, end);
+    offset = end + 1;
+    return value;
+  };
+  str(); // service_type
+  offset += 2;
+  const source = str();
+  offset += 2;
+  const destination = str();
+  const esmClass = body[offset];
+  offset += 3;
+  str();
+  str();
+  const registeredDelivery = body[offset];
+  const dataCoding = body[offset + 2];
+  const length = body[offset + 4];
+  offset += 5;
+  let message = body.subarray(offset, offset + length);
+  offset += length;
+  // message_payload TLV
+  while (offset + 4 <= body.length) {
+    const tag = body.readUInt16BE(offset);
+    const tagLength = body.readUInt16BE(offset + 2);
+    if (tag === 0x0424) message = body.subarray(offset + 4, offset + 4 + tagLength);
+    offset += 4 + tagLength;
+  }
+  return { source, destination, esmClass, registeredDelivery, dataCoding, message };
+}
+
+function createMockSmsc(options = {}) {
+  const {
+    systemId = 'medflow',
+    password = 'secret',
+    responseDelayMs = 0,
+    receiptDelayMs = 5,
+    maxPerSecond = Infinity,
+    undeliverable = [],
+    rejected = [],
+    decimalReceiptIds = false
+  } = options;
+
+  const smsc = {
+    server: null,
+    port: null,
+    binds: 0,
+    sockets: new Set(),
+    messages: [],
+    throttled: 0,
+    maxUnanswered: 0,
+    receiptsSent: 0
+  };
+
+  let nextId = 0x1f000;
+  let windowStart = Date.now();
+  let windowCount = 0;
+
+  function deliverReceipt(socket, state, messageId, destination, stat) {
+    const id = decimalReceiptIds ? BigInt(`0x${messageId}`).toString(10) : messageId;
+    const text = `id:${id} sub:001 dlvr:${stat === 'DELIVRD' ? '001' : '000'} submit date:2610180815 done date:2610180816 stat:${stat} err:${stat === 'DELIVRD' ? '000' : '001'} text:`;
+    const body = Buffer.concat([
+      cString(''),
+      Buffer.from([1, 1]), cString(destination),
+      Buffer.from([5, 0]), cString('CareVision'),
+      Buffer.from([0x04, 0, 0]), cString(''), cString(''),
+      Buffer.from([0, 0, 0, 0, text.length]), Buffer.from(text, 'latin1')
+    ]);
+    state.sequence++;
+    smsc.receiptsSent++;
+    if (!socket.destroyed) socket.write(pdu(DELIVER_SM, 0, state.sequence, body));
+  }
+
+  function onPdu(socket, state, commandId, sequence, body) {
+    switch (commandId) {
+      case BIND_TRANSCEIVER: {
+        const end = body.indexOf(0);
+        const id = body.toString('latin1', 0, end);
+        const pass = body.toString('latin1', end + 1, body.indexOf(0, end + 1));
+        if (id !== systemId || pass !== password) {
+          socket.write(pdu(BIND_TRANSCEIVER | RESP, ESME_RINVPASWD, sequence));
+          return;
+        }
+        smsc.binds++;
+        state.bound = true;
+        socket.write(pdu(BIND_TRANSCEIVER | RESP, 0, sequence, cString('MOCKSMSC')));
+        return;
+      }
+      case SUBMIT_SM: {
+        const submit = readSubmit(body);
+        const now = Date.now();
+        if (now - windowStart >= 1000) {
+          windowStart = now;
+          windowCount = 0;
+        }
+        state.unanswered++;
+        smsc.maxUnanswered = Math.max(smsc.maxUnanswered, state.unanswered);
+
+        const respond = () => {
+          state.unanswered--;
+          if (socket.destroyed) return;
+          if (++windowCount > maxPerSecond) {
+            smsc.throttled++;
+            socket.write(pdu(SUBMIT_SM | RESP, ESME_RTHROTTLED, sequence));
+            return;
+          }
+          if (rejected.includes(submit.destination)) {
+            socket.write(pdu(SUBMIT_SM | RESP, ESME_RINVDSTADR, sequence));
+            return;
+          }
+          const messageId = (nextId++).toString(16);
+          smsc.messages.push({ ...submit, messageId });
+          socket.write(pdu(SUBMIT_SM | RESP, 0, sequence, cString(messageId)));
+          if (submit.registeredDelivery & 1) {
+            const stat = undeliverable.includes(submit.destination) ? 'UNDELIV' : 'DELIVRD';
+            setTimeout(() => deliverReceipt(socket, state, messageId, submit.destination, stat), receiptDelayMs);
+          }
+        };
+        if (responseDelayMs > 0) setTimeout(respond, responseDelayMs);
+        else respond();
+        return;
+      }
+      case ENQUIRE_LINK:
+        socket.write(pdu(ENQUIRE_LINK | RESP, 0, sequence));
+        return;
+      case UNBIND:
+        socket.write(pdu(UNBIND | RESP, 0, sequence));
+        socket.end();
+        return;
+      default:
+        // Responses from the ESME (deliver_sm_resp...) need no answer
+        if (!(commandId & RESP)) socket.write(pdu(GENERIC_NACK, 0x03, sequence));
+    }
+  }
+
+  smsc.server = net.createServer(socket => {
+    smsc.sockets.add(socket);
+    const state = { bound: false, unanswered: 0, sequence: 0 };
+    let buffer = Buffer.alloc(0);
+
+    socket.on('data', chunk => {
+      buffer = Buffer.concat([buffer, chunk]);
+      while (buffer.length >= 16 && buffer.length >= buffer.readUInt32BE(0)) {
+        const length = buffer.readUInt32BE(0);
+        onPdu(socket, state, buffer.readUInt32BE(4), buffer.readUInt32BE(12), buffer.subarray(16, length));
+        buffer = buffer.subarray(length);
+      }
+    });
+    socket.on('error', () => {});
+    socket.on('close', () => smsc.sockets.delete(socket));
+  });
+
+  smsc.listen = (port = 0) => new Promise(resolve => {
+    smsc.server.listen(port, '127.0.0.1', () => {
+      smsc.port = smsc.server.address().port;
+      resolve(smsc);
+    });
+  });
+
+  // Simulate the operator dropping every bind
+  smsc.dropConnections = () => {
+    for (const socket of smsc.sockets) socket.destroy();
+  };
+
+  smsc.close = () => new Promise(resolve => {
+    smsc.dropConnections();
+    smsc.server.close(resolve);
+  });
+
+  return smsc;
+}
+
+module.exports = { createMockSmsc };
+
+if (require.main === module) {
+  createMockSmsc({ receiptDelayMs: 2000 }).listen(parseInt(process.argv[2], 10) || 2775).then(smsc => {
+    console.log(`Mock SMSC listening on 127.0.0.1:${smsc.port} (system id medflow / password secret)`);
+  });
+}
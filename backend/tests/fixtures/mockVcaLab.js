@@ -0,0 +1,75 @@
+const net = require('net');
+
+/**
+ * Mock VCA Lens Lab
+ *
+ * Minimal TCP lab host for lab link tests:
+ * - ACKs every framed order record (or NAKs jobs listed in `nakJobs`)
+ * - Answers REQ=STS with the queued status records, then REQ=END
+ */
+
+const FS = '\x1c';
+const GS = '\x1d';
+const ACK = '\x06';
+const NAK = '\x15';
+
+function createMockVcaLab({ nakJobs = [] } = {}) {
+  const lab = {
+    orders: [],
+    sessions: 0,
+    statusQueue: [],
+    nakJobs: new Set(nakJobs),
+    server: null,
+    port: null
+  };
+
+  lab.queueStatus = (fields) => {
+    lab.statusQueue.push(Object.entries(fields).map(([label, value]) => `${label}=${value}`));
+  };
+
+  lab.server = net.createServer(socket => {
+    lab.sessions++;
+    let buffer = '';
+    socket.setEncoding('latin1');
+
+    socket.on('data', chunk => {
+      buffer += chunk;
+      let start = buffer.indexOf(FS);
+      let end = buffer.indexOf(GS, start);
+      while (start !== -1 && end !== -1) {
+        const text = buffer.slice(start + 1, end);
+        buffer = buffer.slice(end + 1);
+
+        if (/^REQ=STS/m.test(text)) {
+          const records = lab.statusQueue.splice(0);
+          records.forEach(lines => socket.write(`${FS}${lines.join('\r\n')}\r\n${GS}`, 'latin1'));
+          socket.write(`${FS}REQ=END\r\n${GS}`, 'latin1');
+        } else {
+          const job = (text.match(/^JOB=(.*)$/m) || [])[1]?.trim();
+          if (lab.nakJobs.has(job)) {
+            socket.write(NAK, 'latin1');
+          } else {
+            lab.orders.push({ job, text });
+            socket.write(ACK, 'latin1');
+          }
+        }
+
+        start = buffer.indexOf(FS);
+        end = buffer.indexOf(GS, start);
+      }
+    });
+  });
+
+  lab.listen = () => new Promise(resolve => {
+    lab.server.listen(0, '127.0.0.1', () => {
+      lab.port = lab.server.address().port;
+      resolve(lab);
+    });
+  });
+
+  lab.close = () => new Promise(resolve => lab.server.close(resolve));
+
+  return lab;
+}
+
+module.exports = { createMockVcaLab };
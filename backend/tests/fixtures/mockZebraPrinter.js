@@ -0,0 +1,99 @@
+const net = require('net');
+
+/**
+ * Mock Zebra Printer (raw TCP 9100)
+ *
+ * Network printer simulator for label spooler tests and local development:
+ * - Answers ~HS with the three host status strings built from its state
+ *   (`paperOut`, `paused`, `headUp`, `ribbonOut`), or stays silent when
+ *   `answerStatus` is false
+ * - Collects every ^XA...^XZ format received, with its ^PQ quantity
+ * - Counts connections; `listen(port)` can be called again after `close()`
+ *   to bring an "offline" printer back on the same port
+ *
+ * Run standalone: node tests/fixtures/mockZebraPrinter.js [port]
+ * (then LABEL_PRINTERS=lab=127.0.0.1:<port>)
+ */
+
+function hostStatus(state) {
+  const flag = (value) => (value ? '1' : '0');
+  const strings = [
+    `030,${flag(state.paperOut)},${flag(state.paused)},1218,000,0,0,0,000,0,0,0`,
+    `000,0,${flag(state.headUp)},${flag(state.ribbonOut)},0,2,4,0,00000000,1,000`,
+    '1234,0'
+  ];
+  return strings.map(value => `\x02${value}\x03\r\n`).join('');
+}
+
+function createMockZebraPrinter(options = {}) {
+  const printer = {
+    server: null,
+    port: null,
+    paperOut: false,
+    paused: false,
+    headUp: false,
+    ribbonOut: false,
+    answerStatus: true,
+    ...options,
+    connections: 0,
+    statusQueries: 0,
+    jobs: [],
+    formats: [],
+    sockets: new Set()
+  };
+
+  // Labels that came out: ^PQ copies of each format
+  printer.labelsPrinted = () => printer.formats.reduce((sum, format) => sum + format.copies, 0);
+
+  function onSocket(socket) {
+    printer.connections++;
+    printer.sockets.add(socket);
+    let received = '';
+
+    socket.on('data', chunk => {
+      received += chunk.toString('latin1');
+      if (received.includes('~HS')) {
+        received = received.replace('~HS', '');
+        printer.statusQueries++;
+        if (printer.answerStatus) socket.write(hostStatus(printer));
+      }
+    });
+    socket.on('end', () => {
+      const formats = received.match(/\^XA[\s\S]*?\^XZ/g) || [];
+      if (formats.length > 0) printer.jobs.push(received);
+      for (const zpl of formats) {
+        const quantity = zpl.match(/\^PQ(\d+)/);
+        printer.formats.push({ zpl, copies: quantity ? parseInt(quantity[1], 10) : 1 });
+      }
+      socket.end();
+    });
+    socket.on('error', () => {});
+    socket.on('close', () => printer.sockets.delete(socket));
+  }
+
+  printer.listen = (port = printer.port || 0) => new Promise((resolve, reject) => {
+    printer.server = net.createServer(onSocket);
+    printer.server.once('error', reject);
+    printer.server.listen(port, '127.0.0.1', () => {
+      printer.port = printer.server.address().port;
+      resolve(printer);
+    });
+  });
+
+  printer.close = () => new Promise(resolve => {
+    for (const socket of printer.sockets) socket.destroy();
+    if (!printer.server || !printer.server.listening) return resolve();
+    printer.server.close(() => resolve());
+  });
+
+  return printer;
+}
+
+module.exports = { createMockZebraPrinter, hostStatus };
+
+if (require.main === module) {
+  createMockZebraPrinter().listen(parseInt(process.argv[2], 10) || 9100).then(printer => {
+    console.log(`Mock Zebra printer listening on 127.0.0.1:${printer.port}`);
+    setInterval(() => console.log(`${printer.formats.length} formats, ${printer.labelsPrinted()} labels`), 10000);
+  });
+}
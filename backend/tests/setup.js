@@ -34,7 +34,9 @@ beforeAll(async () => {
   mongoServer = await MongoMemoryServer.create();
   const mongoUri = mongoServer.getUri();
 
-  await mongoose.connect(mongoUri);
+  // Command monitoring lets tests assert database cost budgets (services/dbCostTracer)
+  await mongoose.connect(mongoUri, { monitorCommands: true });
+  require('../services/dbCostTracer').attach(mongoose.connection);
 
   console.log('✅ Test database connected');
 });
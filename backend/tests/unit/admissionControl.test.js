@@ -0,0 +1,213 @@
+/**
+ * Admission Control Tests
+ *
+ * - Request classes from /api paths and methods
+ * - Pressure levels and per-class admission decisions
+ * - Queueing, draining, 503 + Retry-After when shed or timed out
+ * - Load test: critical p99 latency during a reporting flood
+ */
+
+const EventEmitter = require('events');
+const {
+  AdmissionController,
+  loadSettings,
+  classifyRequest,
+  pressureLevel,
+  admissionDecision
+} = require('../../middleware/admissionControl');
+
+const settings = loadSettings({});
+
+function fakeReq(path, method = 'GET') {
+  const req = new EventEmitter();
+  return Object.assign(req, { method, path });
+}
+
+// Response double: emits 'finish' once a body is sent, like http.ServerResponse
+function fakeRes() {
+  const res = new EventEmitter();
+  return Object.assign(res, {
+    statusCode: 200,
+    headers: {},
+    headersSent: false,
+    writableEnded: false,
+    set(name, value) { this.headers[name] = value; return this; },
+    status(code) { this.statusCode = code; return this; },
+    json(body) {
+      this.body = body;
+      this.headersSent = true;
+      this.writableEnded = true;
+      this.emit('finish');
+      return this;
+    }
+  });
+}
+
+const tick = () => new Promise(resolve => setImmediate(resolve));
+
+const busy = (ms) => {
+  const until = Date.now() + ms;
+  while (Date.now() < until) { /* synchronous report work */ }
+};
+
+/**
+ * Send one request through the controller; resolves with status and latency
+ * measured from when the request was due (a blocked loop delays arrival too)
+ */
+function dispatch(controller, path, handler, dueAt = performance.now()) {
+  const req = fakeReq(path);
+  const res = fakeRes();
+  return new Promise(resolve => {
+    res.once('finish', () => resolve({
+      status: res.statusCode,
+      retryAfter: res.headers['Retry-After'],
+      latencyMs: performance.now() - dueAt
+    }));
+    controller.middleware()(req, res, () => handler(req, res));
+  });
+}
+
+const p99 = (values) => {
+  const sorted = [...values].sort((a, b) => a - b);
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * 0.99))];
+};
+
+describe('Admission control', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('classifyRequest', () => {
+    test('should classify clinical, interactive and reporting routes', () => {
+      expect(classifyRequest('GET', '/queue')).toBe('critical');
+      expect(classifyRequest('POST', '/queue/next')).toBe('critical');
+      expect(classifyRequest('PUT', '/appointments/64f0/check-in')).toBe('critical');
+      expect(classifyRequest('POST', '/device-data/topcon/import')).toBe('critical');
+      expect(classifyRequest('POST', '/lab-results')).toBe('critical');
+
+      expect(classifyRequest('GET', '/patients/64f0')).toBe('interactive');
+      expect(classifyRequest('POST', '/auth/login')).toBe('interactive');
+      // Writing a surgery report is clinical work, not reporting
+      expect(classifyRequest('POST', '/surgery/report/64f0')).toBe('interactive');
+
+      expect(classifyRequest('GET', '/queue/analytics')).toBe('background');
+      expect(classifyRequest('GET', '/billing/reports/revenue')).toBe('background');
+      expect(classifyRequest('HEAD', '/patients/export')).toBe('background');
+      expect(classifyRequest('GET', '/companies/aging-report/pdf')).toBe('background');
+      expect(classifyRequest('POST', '/document-generation/batch')).toBe('background');
+    });
+  });
+
+  describe('admission policy', () => {
+    test('should derive pressure from event-loop delay and in-flight work', () => {
+      expect(pressureLevel(10, 5, settings)).toBe('normal');
+      expect(pressureLevel(80, 5, settings)).toBe('elevated');
+      expect(pressureLevel(250, 5, settings)).toBe('overloaded');
+      expect(pressureLevel(10, 500, settings)).toBe('overloaded');
+    });
+
+    test('should protect critical traffic and shed background work first', () => {
+      const idle = { critical: 0, interactive: 0, background: 0 };
+      const busyLoad = { critical: 50, interactive: 40, background: 1 };
+
+      expect(admissionDecision('critical', 'overloaded', busyLoad, settings)).toBe('admit');
+      expect(admissionDecision('interactive', 'elevated', busyLoad, settings)).toBe('admit');
+      expect(admissionDecision('interactive', 'overloaded', busyLoad, settings)).toBe('wait');
+      expect(admissionDecision('interactive', 'overloaded', idle, settings)).toBe('admit');
+
+      expect(admissionDecision('background', 'normal', busyLoad, settings)).toBe('admit');
+      expect(admissionDecision('background', 'elevated', busyLoad, settings)).toBe('wait');
+      expect(admissionDecision('background', 'overloaded', idle, settings)).toBe('shed');
+    });
+  });
+
+  describe('AdmissionController', () => {
+    test('should queue background work and admit it as slots free up', async () => {
+      const controller = new AdmissionController({ ...settings, backgroundConcurrency: 1, queueLimit: 1 });
+      const finishers = [];
+      const report = (req, res) => finishers.push(() => res.status(200).json({ success: true }));
+
+      const first = dispatch(controller, '/billing/reports/revenue', report);
+      const second = dispatch(controller, '/billing/reports/aging', report);
+      const third = dispatch(controller, '/billing/reports/aging/trend', report);
+
+      // One running, one waiting, one over the queue limit
+      expect(controller.getStatus().inFlight.background).toBe(1);
+      expect(controller.getStatus().waiting.background).toBe(1);
+      await expect(third).resolves.toMatchObject({ status: 503, retryAfter: '30' });
+
+      finishers.shift()();
+      await expect(first).resolves.toMatchObject({ status: 200 });
+      expect(controller.getStatus().inFlight.background).toBe(1);
+
+      finishers.shift()();
+      await expect(second).resolves.toMatchObject({ status: 200 });
+      expect(controller.getStatus().inFlight.background).toBe(0);
+      expect(controller.getStatus().counters.shed.background).toBe(1);
+    });
+
+    test('should shed waiting requests after the queue timeout and when overloaded', async () => {
+      const controller = new AdmissionController({ ...settings, backgroundConcurrency: 1, queueTimeoutMs: 20 });
+      let finishRunning;
+      dispatch(controller, '/patients/export', (req, res) => { finishRunning = () => res.json({}); });
+
+      const waiting = await dispatch(controller, '/patients/export', () => {});
+      expect(waiting).toMatchObject({ status: 503, retryAfter: '30' });
+      expect(controller.getStatus().counters.timedOut.background).toBe(1);
+      finishRunning();
+
+      controller.lagMs = 400;
+      const report = await dispatch(controller, '/dashboard/stats', () => {});
+      const queueCall = await dispatch(controller, '/queue/next', (req, res) => res.json({ success: true }));
+      expect(report.status).toBe(503);
+      expect(queueCall.status).toBe(200);
+      expect(controller.getStatus().level).toBe('overloaded');
+    });
+  });
+
+  describe('reporting flood load test', () => {
+    // 80 reports of ~15ms synchronous work each, while 30 queue calls arrive every 10ms
+    async function criticalLatencies(controller) {
+      const reportHandler = async (req, res) => {
+        await tick();
+        busy(15);
+        res.status(200).json({ success: true });
+      };
+      const queueHandler = async (req, res) => {
+        await tick();
+        res.status(200).json({ success: true });
+      };
+
+      const reports = Array.from({ length: 80 }, () =>
+        dispatch(controller, '/billing/reports/revenue', reportHandler));
+
+      // Calls that fell due while the loop was blocked all arrive on the next turn
+      const calls = [];
+      const start = performance.now();
+      const nextDue = () => start + (calls.length + 1) * 10;
+      while (calls.length < 30) {
+        await new Promise(resolve => setTimeout(resolve, Math.max(0, nextDue() - performance.now())));
+        while (calls.length < 30 && nextDue() <= performance.now()) {
+          calls.push(dispatch(controller, '/queue/next', queueHandler, nextDue()));
+        }
+      }
+
+      const results = await Promise.all(calls);
+      await Promise.all(reports);
+      expect(results.every(result => result.status === 200)).toBe(true);
+      return results.map(result => result.latencyMs);
+    }
+
+    test('should hold critical p99 latency while a reporting flood runs', async () => {
+      const unprotected = await criticalLatencies(new AdmissionController({ ...settings, enabled: false }));
+
+      const controller = new AdmissionController({ ...settings, sampleIntervalMs: 50, queueTimeoutMs: 5000 });
+      controller.start();
+      const protectedLatencies = await criticalLatencies(controller);
+      controller.stop();
+
+      expect(p99(protectedLatencies)).toBeLessThan(p99(unprotected) / 4);
+      expect(p99(protectedLatencies)).toBeLessThan(150);
+    });
+  });
+});
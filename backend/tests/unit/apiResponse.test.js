@@ -18,6 +18,7 @@ const {
   serverError,
   attachToResponse
 } = require('../../utils/apiResponse');
+const { compileSerializer } = require('../../utils/jsonSerializer');
 
 // Mock Express response object
 const createMockResponse = () => {
@@ -31,6 +32,13 @@ const createMockResponse = () => {
     json: jest.fn(function(data) {
       this.data = data;
       return this;
+    }),
+    set: jest.fn(function() {
+      return this;
+    }),
+    send: jest.fn(function(body) {
+      this.body = body;
+      return this;
     })
   };
   return res;
@@ -158,6 +166,28 @@ describe('API Response Utility', () => {
       expect(res.data.pagination.pages).toBe(0);
       expect(res.data.pagination.hasMore).toBe(false);
     });
+
+    test('should send through a compiled serializer when given', () => {
+      const res = createMockResponse();
+      const serializer = compileSerializer({
+        type: 'object',
+        properties: {
+          success: { type: 'boolean' },
+          data: { type: 'array', items: { type: 'object', properties: { name: { type: 'string' } } } },
+          pagination: { type: 'object', additionalProperties: true }
+        }
+      });
+
+      paginated(res, [{ name: 'Timolol', transactions: [] }], { page: 1, limit: 20, total: 1, serializer });
+
+      expect(res.json).not.toHaveBeenCalled();
+      expect(res.set).toHaveBeenCalledWith('Content-Type', 'application/json; charset=utf-8');
+      expect(JSON.parse(res.body)).toEqual({
+        success: true,
+        data: [{ name: 'Timolol' }],
+        pagination: { page: 1, limit: 20, total: 1, pages: 1, hasMore: false }
+      });
+    });
   });
 
   describe('error()', () => {
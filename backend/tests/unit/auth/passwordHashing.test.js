@@ -0,0 +1,146 @@
+/**
+ * Password Hashing Tests
+ *
+ * Tests for off-event-loop password hashing:
+ * - scrypt hash format, verification and rehash detection
+ * - Worker pool hashing, parallel history checks, bounded queue
+ * - Legacy bcrypt hashes upgraded on successful login
+ * - Event-loop latency holding flat during a 100-login burst
+ */
+
+const { monitorEventLoopDelay } = require('perf_hooks');
+const bcrypt = require('bcryptjs');
+const User = require('../../../models/User');
+const { PasswordHashService } = require('../../../services/passwordHashService');
+const {
+  hashPasswordSync,
+  verifyPasswordSync,
+  needsRehash,
+  parseHash
+} = require('../../../utils/passwordHash');
+const { createTestUser } = require('../../fixtures/generators');
+
+const PASSWORD = 'Shift$Change2026';
+
+// p99 event-loop delay (ms) while `work` runs
+async function eventLoopP99(work) {
+  const histogram = monitorEventLoopDelay({ resolution: 10 });
+  histogram.enable();
+  await work();
+  histogram.disable();
+  return histogram.percentile(99) / 1e6;
+}
+
+describe('Password Hashing', () => {
+  describe('passwordHash utility', () => {
+    test('should produce salted scrypt hashes that verify', () => {
+      const first = hashPasswordSync(PASSWORD);
+      const second = hashPasswordSync(PASSWORD);
+
+      expect(first).toMatch(/^\$scrypt\$ln=14,r=8,p=1\$/);
+      expect(first).not.toBe(second);
+      expect(verifyPasswordSync(PASSWORD, first)).toBe(true);
+      expect(verifyPasswordSync('wrong', first)).toBe(false);
+      expect(verifyPasswordSync(PASSWORD, 'not-a-hash')).toBe(false);
+    });
+
+    test('should flag legacy and outdated hashes for rehash', () => {
+      const legacy = bcrypt.hashSync(PASSWORD, 4);
+      expect(parseHash(legacy)).toEqual({ algorithm: 'bcrypt', cost: 4 });
+      expect(verifyPasswordSync(PASSWORD, legacy)).toBe(true);
+      expect(needsRehash(legacy)).toBe(true);
+
+      expect(needsRehash(hashPasswordSync(PASSWORD, { ln: 10, r: 8, p: 1 }))).toBe(true);
+      expect(needsRehash(hashPasswordSync(PASSWORD))).toBe(false);
+    });
+  });
+
+  describe('worker pool', () => {
+    let service;
+
+    beforeEach(() => {
+      service = new PasswordHashService({ size: 2 });
+    });
+
+    afterEach(async () => {
+      await service.shutdown();
+    });
+
+    test('should hash and verify on worker threads', async () => {
+      const hash = await service.hash(PASSWORD);
+
+      expect(await service.verify(PASSWORD, hash)).toBe(true);
+      expect(await service.verify('wrong', hash)).toBe(false);
+      expect(await service.verify(PASSWORD, null)).toBe(false);
+      expect(service.getStatus()).toMatchObject({ mode: 'workers', workers: 1, queued: 0, completed: 3 });
+    });
+
+    test('should check the whole password history in parallel', async () => {
+      const history = await Promise.all(['Old#Pass1', 'Old#Pass2', PASSWORD].map(p => service.hash(p)));
+
+      expect(await service.verifyAny(PASSWORD, history)).toBe(true);
+      expect(await service.verifyAny('Never#Used1', history)).toBe(false);
+      expect(await service.verifyAny(PASSWORD, [])).toBe(false);
+    });
+
+    test('should reject work beyond the queue bound', async () => {
+      const bounded = new PasswordHashService({ size: 1, maxQueue: 1 });
+      const results = await Promise.allSettled([1, 2, 3].map(() => bounded.hash(PASSWORD)));
+      await bounded.shutdown();
+
+      expect(results.map(r => r.status)).toEqual(['fulfilled', 'fulfilled', 'rejected']);
+      expect(results[2].reason.message).toMatch(/queue is full/);
+    });
+  });
+
+  describe('User model', () => {
+    test('should upgrade a legacy bcrypt hash on successful login', async () => {
+      const user = await User.create(createTestUser({ password: PASSWORD }));
+      const legacy = bcrypt.hashSync(PASSWORD, 10);
+      await User.collection.updateOne({ _id: user._id }, { $set: { password: legacy } });
+
+      const stored = await User.findById(user._id).select('+password');
+      expect(await stored.matchPassword('wrong')).toBe(false);
+      expect(stored.$locals.passwordRehash).toBeUndefined();
+
+      expect(await stored.matchPassword(PASSWORD)).toBe(true);
+      expect(await stored.$locals.passwordRehash).toBe(true);
+
+      const upgraded = await User.findById(user._id).select('+password');
+      expect(upgraded.password).toMatch(/^\$scrypt\$/);
+      expect(await upgraded.matchPassword(PASSWORD)).toBe(true);
+      expect(upgraded.$locals.passwordRehash).toBeUndefined();
+    });
+
+    test('should reject any password from the history', async () => {
+      const user = await User.create(createTestUser({ password: PASSWORD }));
+      user.password = 'Next$Password2026';
+      await user.save();
+
+      const stored = await User.findById(user._id).select('+password +passwordHistory');
+      expect(await stored.isPasswordUsedBefore(PASSWORD)).toBe(true);
+      expect(await stored.isPasswordUsedBefore('Brand$New2026')).toBe(false);
+    });
+  });
+
+  describe('login burst benchmark', () => {
+    test('should keep event-loop p99 flat during 100 concurrent logins', async () => {
+      const hash = bcrypt.hashSync(PASSWORD, 10);
+      const logins = Array.from({ length: 100 }, (_, i) => (i % 10 === 0 ? 'wrong' : PASSWORD));
+
+      // Baseline: bcryptjs on the main event loop
+      const inlineP99 = await eventLoopP99(() => Promise.all(logins.map(p => bcrypt.compare(p, hash))));
+
+      const service = new PasswordHashService({ size: 2 });
+      let matches;
+      const pooledP99 = await eventLoopP99(async () => {
+        matches = await Promise.all(logins.map(p => service.verify(p, hash)));
+      });
+      await service.shutdown();
+
+      expect(matches.filter(Boolean)).toHaveLength(90);
+      expect(pooledP99).toBeLessThan(50);
+      expect(pooledP99).toBeLessThan(inlineP99 / 2);
+    });
+  });
+});
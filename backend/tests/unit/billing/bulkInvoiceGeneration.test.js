@@ -0,0 +1,220 @@
+/**
+ * Bulk Invoice Generation Tests
+ *
+ * Tests for set-based invoice generation:
+ * - Line building and summary totals
+ * - Same per-invoice output as the record-by-record path
+ * - Dedupe, missing sources, in-request duplicates
+ * - Fixed number of round trips regardless of batch size
+ */
+
+const mongoose = require('mongoose');
+const Invoice = require('../../../models/Invoice');
+const Patient = require('../../../models/Patient');
+const Visit = require('../../../models/Visit');
+const Appointment = require('../../../models/Appointment');
+const priceBookService = require('../../../services/priceBookService');
+const {
+  generateInvoices,
+  generateSequential,
+  buildVisitItems,
+  buildAppointmentItems,
+  computeSummary
+} = require('../../../services/bulkInvoiceService');
+const { createTestPatient } = require('../../fixtures/generators');
+
+const userId = new mongoose.Types.ObjectId();
+const providerId = new mongoose.Types.ObjectId();
+const clinicId = new mongoose.Types.ObjectId();
+
+function act(overrides = {}) {
+  return {
+    actId: new mongoose.Types.ObjectId().toString(),
+    actType: 'examination',
+    actCode: 'OCT',
+    actName: 'OCT maculaire',
+    provider: providerId,
+    price: 25000,
+    status: 'completed',
+    ...overrides
+  };
+}
+
+async function seed(patientCount, visitsPerPatient = 2) {
+  const patients = await Patient.create(
+    Array.from({ length: patientCount }, () => createTestPatient())
+  );
+
+  const visits = patients.flatMap((patient, p) => Array.from({ length: visitsPerPatient }, (_, v) => ({
+    _id: new mongoose.Types.ObjectId(),
+    visitId: `VIS-BULK-${p}-${v}`,
+    patient: patient._id,
+    clinic: clinicId,
+    visitDate: new Date(),
+    status: 'completed',
+    clinicalActs: [
+      act(),
+      act({ actType: 'consultation', actCode: 'CONS', actName: 'Consultation', price: 10000 }),
+      act({ status: 'planned', price: 99999 })
+    ]
+  })));
+  await Visit.collection.insertMany(visits);
+
+  const appointments = patients.map((patient, p) => ({
+    _id: new mongoose.Types.ObjectId(),
+    appointmentId: `APT-BULK-${p}`,
+    patient: patient._id,
+    provider: providerId,
+    clinic: clinicId,
+    date: new Date(),
+    type: 'follow-up',
+    billing: { status: 'pending', services: [], totalAmount: 8000 }
+  }));
+  await Appointment.collection.insertMany(appointments);
+
+  return {
+    patients,
+    visitIds: visits.map(v => v._id.toString()),
+    appointmentIds: appointments.map(a => a._id.toString())
+  };
+}
+
+// Everything except generated identifiers and timestamps
+async function snapshot(results) {
+  const invoices = await Invoice.find({ _id: { $in: results.success.map(r => r.invoice) } }).lean();
+  const byId = new Map(invoices.map(inv => [String(inv._id), inv]));
+
+  return results.success.map(r => {
+    const inv = byId.get(String(r.invoice));
+    return JSON.parse(JSON.stringify({
+      id: r.id,
+      type: r.type,
+      patient: inv.patient,
+      visit: inv.visit,
+      appointment: inv.appointment,
+      clinic: inv.clinic,
+      status: inv.status,
+      dateIssued: inv.dateIssued,
+      dueDate: inv.dueDate,
+      createdBy: inv.createdBy,
+      summary: inv.summary,
+      items: inv.items.map(({ itemId, _id, ...item }) => item)
+    }));
+  });
+}
+
+async function patientState(patients) {
+  const docs = await Patient.find({ _id: { $in: patients.map(p => p._id) } })
+    .select('invoices accountBalance').lean();
+  return docs.map(p => ({
+    invoices: p.invoices.length,
+    totalBilled: p.accountBalance?.totalBilled,
+    outstanding: p.accountBalance?.outstanding
+  }));
+}
+
+async function resetGenerated(patients) {
+  await Invoice.deleteMany({});
+  await Patient.updateMany({ _id: { $in: patients.map(p => p._id) } }, { $set: { invoices: [] }, $unset: { accountBalance: '' } });
+  await Visit.collection.updateMany({}, { $unset: { billing: '' } });
+  await Appointment.collection.updateMany({}, { $unset: { 'billing.invoice': '' } });
+}
+
+describe('Bulk Invoice Generation', () => {
+  describe('line building', () => {
+    test('should bill completed acts only and fall back to the effective fee', () => {
+      const book = { currentFee: code => (code === 'ECHO' ? { price: 30000 } : null) };
+      const items = buildVisitItems({
+        visitDate: new Date(),
+        clinicalActs: [act(), act({ actCode: 'ECHO', price: 0 }), act({ status: 'planned' })]
+      }, book);
+
+      expect(items.map(i => [i.code, i.category, i.unitPrice, i.total])).toEqual([
+        ['OCT', 'examination', 25000, 25000],
+        ['ECHO', 'examination', 30000, 30000]
+      ]);
+      expect(computeSummary(items)).toEqual({
+        subtotal: 55000, discountTotal: 0, taxTotal: 0, total: 55000, amountPaid: 0, amountDue: 55000
+      });
+    });
+
+    test('should bill appointment services or a single consultation line', () => {
+      const withServices = buildAppointmentItems({ type: 'consultation', billing: { services: [{ quantity: 2, price: 4000 }] } }, null);
+      expect(withServices.map(i => i.total)).toEqual([8000]);
+
+      const book = { currentFee: () => ({ price: 12000 }) };
+      expect(buildAppointmentItems({ type: 'follow-up', billing: {} }, book)[0]).toMatchObject({
+        code: 'CONSULT', category: 'consultation', unitPrice: 12000, total: 12000
+      });
+    });
+  });
+
+  describe('set-based vs record-by-record', () => {
+    beforeEach(async () => {
+      priceBookService.invalidate();
+    });
+
+    test('should produce the same invoices, balances and results', async () => {
+      const { patients, visitIds, appointmentIds } = await seed(5);
+
+      const sequential = await generateSequential({ visitIds, appointmentIds }, userId);
+      // Post-save balance updates run in setImmediate; settle them explicitly
+      await Promise.all(patients.map(p => Patient.updatePatientBalance(p._id)));
+      const expectedInvoices = await snapshot(sequential);
+      const expectedPatients = await patientState(patients);
+
+      await resetGenerated(patients);
+
+      const bulk = await generateInvoices({ visitIds, appointmentIds }, userId);
+      expect(await snapshot(bulk)).toEqual(expectedInvoices);
+      expect(await patientState(patients)).toEqual(expectedPatients);
+
+      expect(bulk.success).toHaveLength(15);
+      expect(bulk.failed).toEqual(sequential.failed);
+      expect(bulk.skipped).toEqual(sequential.skipped);
+
+      const ids = bulk.success.map(r => r.invoiceId);
+      expect(new Set(ids).size).toBe(ids.length);
+      ids.forEach(id => expect(id).toMatch(/^INV\d{6}\d{6}$/));
+
+      const visit = await Visit.findById(visitIds[0]).lean();
+      expect(String(visit.billing.invoice)).toBe(String(bulk.success[0].invoice));
+      expect(visit.billing.totalCharges).toBe(35000);
+    });
+
+    test('should skip existing and repeated IDs and report missing sources', async () => {
+      const { visitIds } = await seed(2, 1);
+      const first = await generateInvoices({ visitIds: [visitIds[0]] }, userId);
+
+      const missing = new mongoose.Types.ObjectId().toString();
+      const results = await generateInvoices({ visitIds: [visitIds[0], visitIds[1], visitIds[1], missing] }, userId);
+
+      expect(results.success.map(r => r.id)).toEqual([visitIds[1]]);
+      expect(results.skipped).toEqual([
+        { id: visitIds[0], type: 'visit', reason: 'Invoice already exists', invoiceId: first.success[0].invoiceId },
+        { id: visitIds[1], type: 'visit', reason: 'Invoice already exists', invoiceId: results.success[0].invoiceId }
+      ]);
+      expect(results.failed).toEqual([{ id: missing, type: 'visit', error: 'Visit not found' }]);
+      expect(await Invoice.countDocuments({})).toBe(2);
+    });
+
+    test('should use a fixed number of round trips regardless of batch size', async () => {
+      const countOps = async (ids) => {
+        let ops = 0;
+        mongoose.set('debug', () => { ops++; });
+        await generateInvoices({ visitIds: ids }, userId);
+        mongoose.set('debug', false);
+        return ops;
+      };
+
+      const { visitIds } = await seed(20, 2);
+      await priceBookService.getBook();
+
+      const small = await countOps(visitIds.slice(0, 4));
+      const large = await countOps(visitIds.slice(4));
+
+      expect(large).toBe(small);
+      expect(large).toBeLessThanOrEqual(10);
+    });
+  });
+});
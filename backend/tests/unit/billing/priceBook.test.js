@@ -0,0 +1,169 @@
+/**
+ * Price Book Tests
+ *
+ * Tests for the compiled in-memory price book:
+ * - Effective-dated standard prices, clinic prices, convention prices
+ * - Parent convention fallback and standard-price discounts
+ * - Same answers as the FeeSchedule / ConventionFeeSchedule model statics
+ * - Rebuild after fee / convention writes, zero queries per invoice
+ */
+
+const mongoose = require('mongoose');
+const { PriceBook } = require('../../../services/priceBookService');
+
+const oid = (n) => `64a0000000000000000000${String(n).padStart(2, '0')}`;
+const clinicA = oid(90);
+const company = oid(80);
+const subsidiary = oid(81);
+
+const fees = [
+  { _id: oid(1), code: 'CONS', name: 'Consultation', category: 'consultation', clinic: null, isTemplate: true, price: 10000, currency: 'CDF', active: true, effectiveFrom: new Date('2025-01-01'), effectiveTo: new Date('2025-12-31T23:59:59.999Z') },
+  { _id: oid(2), code: 'CONS', name: 'Consultation', category: 'consultation', clinic: clinicA, price: 12000, currency: 'CDF', active: true, effectiveFrom: new Date('2026-01-01') },
+  { _id: oid(3), code: 'NFS', name: 'Numération formule sanguine', category: 'laboratory', clinic: null, price: 8000, currency: 'CDF', active: true, effectiveFrom: new Date('2024-01-01') },
+  { _id: oid(4), code: 'NFS', name: 'Numération formule sanguine', category: 'laboratory', clinic: null, price: 9000, currency: 'CDF', active: true, effectiveFrom: new Date('2026-06-01') },
+  { _id: oid(5), code: 'OLD', name: 'Retired act', category: 'other', clinic: null, price: 500, currency: 'CDF', active: false, effectiveFrom: new Date('2020-01-01') }
+];
+
+const conventions = [
+  {
+    _id: oid(50),
+    company,
+    name: 'Grille 2026',
+    currency: 'CDF',
+    isActive: true,
+    effectiveFrom: new Date('2026-01-01'),
+    defaults: { useStandardPrices: true, discountPercentage: 10 },
+    items: [{ feeScheduleCode: 'CONS', conventionPrice: 7000, coveragePercentage: 80 }]
+  }
+];
+
+describe('Price Book', () => {
+  const book = new PriceBook({ fees, conventions, companies: [{ _id: subsidiary, parentConvention: company }] });
+
+  describe('effectivePrice', () => {
+    test('should pick the version effective on the service date', () => {
+      expect(book.effectivePrice('cons', new Date('2025-06-01')).price).toBe(10000);
+      expect(book.effectivePrice('CONS', new Date('2026-03-01')).price).toBe(12000);
+      expect(book.effectivePrice('NFS', new Date('2026-03-01')).price).toBe(8000);
+    });
+
+    test('should report codes with no effective version', () => {
+      const result = book.effectivePrice('OLD', new Date('2026-03-01'));
+      expect(result.found).toBe(false);
+      expect(result.error).toMatch(/not effective/);
+      expect(book.effectivePrice('NOPE', new Date()).error).toBe('Fee schedule code not found');
+    });
+  });
+
+  describe('clinicPrice / latestFee / currentFee', () => {
+    test('should resolve clinic prices and lab prices by code or name', () => {
+      expect(book.clinicPrice('CONS', clinicA)).toMatchObject({ found: true, price: 12000 });
+      expect(book.clinicPrice('NFS', clinicA).found).toBe(false);
+
+      expect(book.latestFee({ code: 'NFS' }, new Date('2026-03-01')).price).toBe(9000);
+      expect(book.latestFee({ name: 'numération FORMULE sanguine', category: 'laboratory' }).price).toBe(9000);
+      expect(book.currentFee('NFS', new Date('2026-03-01')).price).toBe(8000);
+    });
+  });
+
+  describe('companyPrice', () => {
+    const date = new Date('2026-03-01');
+
+    test('should use convention items, then discounted standard prices', () => {
+      expect(book.companyPrice(company, 'CONS', date)).toMatchObject({
+        found: true, isConventionPrice: true, price: 7000, coveragePercentage: 80, isCovered: true, requiresApproval: false
+      });
+      expect(book.companyPrice(company, 'NFS', date)).toMatchObject({
+        found: true, isStandardPrice: true, price: 7200, originalPrice: 8000, discountApplied: 10
+      });
+    });
+
+    test('should inherit the parent convention and fall back to standard prices', () => {
+      expect(book.companyPrice(subsidiary, 'CONS', date).price).toBe(7000);
+      expect(book.companyPrice(oid(99), 'CONS', date)).toEqual({
+        found: true, isConventionPrice: false, isStandardPrice: true, price: 12000,
+        currency: 'CDF', requiresApproval: false, isCovered: true
+      });
+    });
+  });
+
+  describe('priceLines', () => {
+    test('should price a whole invoice in one call', () => {
+      const lines = book.priceLines(
+        [{ code: 'CONS', quantity: 2 }, { code: 'NFS' }, { code: 'NOPE' }],
+        { clinic: clinicA, date: new Date('2026-03-01') }
+      );
+      expect(lines.map(l => [l.code, l.source, l.total])).toEqual([
+        ['CONS', 'clinic', 24000],
+        ['NFS', 'standard', 8000],
+        ['NOPE', null, null]
+      ]);
+    });
+  });
+
+  describe('equivalence with model statics', () => {
+    let FeeSchedule;
+    let ConventionFeeSchedule;
+    let priceBookService;
+
+    beforeAll(() => {
+      FeeSchedule = require('../../../models/FeeSchedule');
+      ConventionFeeSchedule = require('../../../models/ConventionFeeSchedule');
+      priceBookService = require('../../../services/priceBookService');
+    });
+
+    // One document per (code, clinic): the schema's unique index
+    const dbFees = fees.map(f => (f._id === oid(4) ? { ...f, clinic: oid(91) } : f));
+
+    beforeEach(async () => {
+      await FeeSchedule.insertMany(dbFees);
+      await ConventionFeeSchedule.create({ ...conventions[0], createdBy: new mongoose.Types.ObjectId() });
+      priceBookService.invalidate();
+    });
+
+    test('should return the same answers as the per-code queries', async () => {
+      const compiled = await priceBookService.getBook();
+      const dates = [new Date('2025-06-01'), new Date('2026-03-01'), new Date('2026-07-01')];
+
+      for (const code of ['CONS', 'NFS', 'OLD', 'NOPE']) {
+        for (const date of dates) {
+          const expected = await FeeSchedule.getEffectivePriceForDate(code, date);
+          expect(compiled.effectivePrice(code, date)).toEqual(expected);
+
+          expect(compiled.companyPrice(company, code, date))
+            .toEqual(await ConventionFeeSchedule.getPriceForCompanyAndCode(company, code, date));
+        }
+        expect(compiled.clinicPrice(code, clinicA)).toEqual(await FeeSchedule.getPriceForClinic(code, clinicA));
+      }
+    });
+
+    test('should price a 30-line invoice without any query', async () => {
+      const compiled = await priceBookService.getBook();
+      let queries = 0;
+      mongoose.set('debug', () => { queries++; });
+
+      const lines = compiled.priceLines(
+        Array.from({ length: 30 }, (_, i) => ({ code: ['CONS', 'NFS', 'OLD'][i % 3] })),
+        { company, date: new Date('2026-03-01') }
+      );
+
+      mongoose.set('debug', false);
+      expect(lines).toHaveLength(30);
+      expect(queries).toBe(0);
+    });
+
+    test('should compile a new book after fee and convention writes', async () => {
+      const before = await priceBookService.getBook();
+
+      await FeeSchedule.findOneAndUpdate({ _id: oid(2) }, { price: 15000 });
+      const afterUpdate = await priceBookService.getBook();
+      expect(afterUpdate).not.toBe(before);
+      expect(afterUpdate.clinicPrice('CONS', clinicA).price).toBe(15000);
+      expect(before.clinicPrice('CONS', clinicA).price).toBe(12000);
+
+      await ConventionFeeSchedule.bulkImportPrices(company, [{ code: 'NFS', price: 6000 }], new mongoose.Types.ObjectId());
+      const afterImport = await priceBookService.getBook();
+      expect(afterImport.companyPrice(company, 'NFS', new Date()).price).toBe(6000);
+    });
+  });
+});
@@ -0,0 +1,204 @@
+/**
+ * Conditional GET Tests
+ *
+ * - Version tokens and weak If-None-Match comparison
+ * - ETags bound to the requesting user, clinic and URL
+ * - 304 before the controller runs; fall-through when there is no version
+ * - Populated documents versioned by id
+ * - Throughput benchmark: unchanged vs changed version of the same resource
+ */
+
+const {
+  conditionalGet,
+  versionToken,
+  buildETag,
+  matchesETag,
+  referencedVersion
+} = require('../../middleware/conditionalGet');
+const User = require('../../models/User');
+const { createTestUser } = require('../fixtures/generators');
+
+const UPDATED_AT = new Date('2026-10-18T09:00:00Z');
+
+const fakeReq = (headers = {}, overrides = {}) => ({
+  method: 'GET',
+  originalUrl: '/api/patients/64f0c0ffee',
+  headers,
+  user: { _id: 'u1' },
+  clinicId: 'c1',
+  ...overrides
+});
+
+// Response double with the header/status surface Express provides
+function fakeRes() {
+  const headers = {};
+  return {
+    headers,
+    statusCode: 200,
+    ended: false,
+    set(name, value) { headers[name.toLowerCase()] = value; return this; },
+    get(name) { return headers[name.toLowerCase()]; },
+    removeHeader(name) { delete headers[name.toLowerCase()]; },
+    status(code) { this.statusCode = code; return this; },
+    writeHead(code) { this.statusCode = code; return this; },
+    end() { this.ended = true; return this; },
+    json(body) { this.writeHead(this.statusCode); this.body = body; return this.end(); }
+  };
+}
+
+// Runs middleware then controller; resolves with the response
+const handle = async (middleware, req, controller) => {
+  const res = fakeRes();
+  let nextCalled = false;
+  await middleware(req, res, () => { nextCalled = true; });
+  if (nextCalled) await controller(req, res);
+  return res;
+};
+
+describe('Conditional GET', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('helpers', () => {
+    test('should flatten versions into tokens', () => {
+      expect(versionToken([UPDATED_AT, 3])).toBe(`${UPDATED_AT.getTime()}:3`);
+      expect(versionToken([[12, 1760778000000], null])).toBe('12:1760778000000:-');
+      expect(versionToken(42)).toBe('42');
+      expect(versionToken(null)).toBeNull();
+      expect(versionToken(undefined)).toBeNull();
+    });
+
+    test('should bind the ETag to user, clinic and URL', () => {
+      const etag = buildETag('patient', '1:2', fakeReq());
+
+      expect(etag).toMatch(/^W\/"patient-[A-Za-z0-9_-]+"$/);
+      expect(buildETag('patient', '1:2', fakeReq())).toBe(etag);
+      expect(buildETag('patient', '1:3', fakeReq())).not.toBe(etag);
+      expect(buildETag('patient', '1:2', fakeReq({}, { user: { _id: 'u2' } }))).not.toBe(etag);
+      expect(buildETag('patient', '1:2', fakeReq({}, { clinicId: 'c2' }))).not.toBe(etag);
+      expect(buildETag('patient', '1:2', fakeReq({}, { originalUrl: '/api/patients/other' }))).not.toBe(etag);
+    });
+
+    test('should compare If-None-Match weakly across a tag list', () => {
+      const etag = 'W/"patient-abc"';
+
+      expect(matchesETag('W/"patient-abc"', etag)).toBe(true);
+      expect(matchesETag('"patient-abc"', etag)).toBe(true);
+      expect(matchesETag('"x", W/"patient-abc"', etag)).toBe(true);
+      expect(matchesETag('*', etag)).toBe(true);
+      expect(matchesETag('W/"patient-abd"', etag)).toBe(false);
+      expect(matchesETag(undefined, etag)).toBe(false);
+    });
+  });
+
+  describe('version sources', () => {
+    test('should change when a populated document changes', async () => {
+      const [author, editor] = await User.create([createTestUser(), createTestUser()]);
+      const before = await referencedVersion(User, [author._id, editor._id, null, author._id]);
+      expect(before[0]).toBe(2);
+
+      await new Promise(resolve => setTimeout(resolve, 5));
+      await User.updateOne({ _id: editor._id }, { $set: { lastName: 'Renamed' } });
+
+      expect(await referencedVersion(User, [author._id, editor._id])).not.toEqual(before);
+      expect(await referencedVersion(User, [undefined])).toEqual([0, 0]);
+    });
+  });
+
+  describe('middleware', () => {
+    let version;
+    let controllerRuns;
+    const middleware = conditionalGet(async () => version, { name: 'patient' });
+    const controller = async (req, res) => {
+      controllerRuns++;
+      res.status(200).json({ success: true });
+    };
+
+    beforeEach(() => {
+      version = [UPDATED_AT, 0];
+      controllerRuns = 0;
+    });
+
+    test('should answer 304 without running the controller while the version is unchanged', async () => {
+      const first = await handle(middleware, fakeReq(), controller);
+      expect(first.statusCode).toBe(200);
+      expect(first.get('Cache-Control')).toBe('private, no-cache');
+      const etag = first.get('ETag');
+
+      const repeat = await handle(middleware, fakeReq({ 'if-none-match': etag }), controller);
+      expect(repeat.statusCode).toBe(304);
+      expect(repeat.ended).toBe(true);
+      expect(controllerRuns).toBe(1);
+
+      version = [new Date(UPDATED_AT.getTime() + 1000), 1];
+      const changed = await handle(middleware, fakeReq({ 'if-none-match': etag }), controller);
+      expect(changed.statusCode).toBe(200);
+      expect(changed.get('ETag')).not.toBe(etag);
+      expect(controllerRuns).toBe(2);
+    });
+
+    test('should fall through without a version or on lookup errors', async () => {
+      version = null;
+      const missing = await handle(middleware, fakeReq({ 'if-none-match': '*' }), controller);
+      expect(missing.statusCode).toBe(200);
+      expect(missing.get('ETag')).toBeUndefined();
+
+      const failing = conditionalGet(async () => { throw new Error('db down'); }, { name: 'patient' });
+      const res = await handle(failing, fakeReq({ 'if-none-match': '*' }), controller);
+      expect(res.statusCode).toBe(200);
+
+      const post = await handle(middleware, fakeReq({ 'if-none-match': '*' }, { method: 'POST' }), controller);
+      expect(post.statusCode).toBe(200);
+      expect(controllerRuns).toBe(3);
+    });
+
+    test('should not tag error responses', async () => {
+      const denied = await handle(middleware, fakeReq(), async (req, res) => {
+        res.status(403).json({ success: false });
+      });
+
+      expect(denied.statusCode).toBe(403);
+      expect(denied.get('ETag')).toBeUndefined();
+    });
+  });
+
+  describe('revalidation benchmark', () => {
+    test('should serve unchanged resources far faster than changed ones', async () => {
+      const REQUESTS = 200;
+      let version = 1;
+      // Cheap version lookup: one indexed round trip
+      const middleware = conditionalGet(async () => {
+        await new Promise(resolve => setImmediate(resolve));
+        return version;
+      }, { name: 'chart' });
+      // Heavy path: several queries, then building and serializing a large chart
+      const controller = async (req, res) => {
+        for (let i = 0; i < 4; i++) await new Promise(resolve => setImmediate(resolve));
+        const visits = Array.from({ length: 2000 }, (_, i) => ({
+          _id: `v${i}`,
+          visitDate: new Date(UPDATED_AT.getTime() - i * 86400000).toISOString(),
+          diagnoses: [{ code: 'H40.1', label: 'Glaucome primitif a angle ouvert' }],
+          notes: 'Acuite visuelle stable, tension oculaire controlee'.repeat(2)
+        }));
+        res.status(200).json(JSON.parse(JSON.stringify({ patient: { _id: 'p1' }, visits })));
+      };
+
+      const etag = (await handle(middleware, fakeReq(), controller)).get('ETag');
+
+      const throughput = async (bumpVersion) => {
+        const started = process.hrtime.bigint();
+        for (let i = 0; i < REQUESTS; i++) {
+          if (bumpVersion) version++;
+          await handle(middleware, fakeReq({ 'if-none-match': etag }), controller);
+        }
+        return REQUESTS / (Number(process.hrtime.bigint() - started) / 1e9);
+      };
+
+      const unchanged = await throughput(false);
+      const changed = await throughput(true);
+
+      expect(unchanged).toBeGreaterThan(changed * 5);
+    });
+  });
+});
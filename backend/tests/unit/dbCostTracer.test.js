@@ -0,0 +1,211 @@
+/**
+ * Database Cost Tracer Tests
+ *
+ * - Command keys and documents read from driver replies
+ * - Commands attributed to the request or job that issued them, across awaits
+ * - Per-route aggregation and budget assertions, bytes measured on a sample
+ * - Budgets of real Appointment/Visit saves through their hooks
+ */
+
+const EventEmitter = require('events');
+const mongoose = require('mongoose');
+const Appointment = require('../../models/Appointment');
+const Patient = require('../../models/Patient');
+const Visit = require('../../models/Visit');
+const { createTestPatient } = require('../fixtures/generators');
+const dbCostTracer = require('../../services/dbCostTracer');
+const {
+  DbCostTracer,
+  commandKey,
+  replyDocuments,
+  budgetViolations,
+  newCost
+} = require('../../services/dbCostTracer');
+
+// Client double emitting command monitoring events like the driver
+function fakeClient() {
+  const client = new EventEmitter();
+  client.options = { monitorCommands: true };
+  let requestId = 0;
+  client.command = async (commandName, command, reply = { ok: 1 }) => {
+    const id = ++requestId;
+    client.emit('commandStarted', { requestId: id, commandName, command: { [commandName]: command.collection, ...command } });
+    await new Promise(resolve => setImmediate(resolve));
+    client.emit('commandSucceeded', { requestId: id, commandName, reply, duration: 2 });
+    return reply;
+  };
+  return client;
+}
+
+// The command fan-out of one appointment save (pre/post save hooks)
+async function saveAppointment(client) {
+  await client.command('findAndModify', { collection: 'counters' }, { value: { sequence: 7 }, lastErrorObject: { n: 1 } });
+  await client.command('insert', { collection: 'appointments', documents: [{ patient: 'p1' }] }, { n: 1 });
+  await client.command('findAndModify', { collection: 'patients' }, { value: { _id: 'p1' }, lastErrorObject: { n: 1 } });
+}
+
+describe('Database Cost Tracer', () => {
+  describe('command accounting', () => {
+    test('should key commands by collection and read reply documents', () => {
+      expect(commandKey('find', { find: 'patients' })).toBe('patients.find');
+      expect(commandKey('getMore', { getMore: 42, collection: 'visits' })).toBe('visits.getMore');
+      expect(commandKey('commitTransaction', { commitTransaction: 1 })).toBe('commitTransaction');
+
+      expect(replyDocuments('find', { cursor: { firstBatch: [{}, {}, {}] } })).toEqual({ returned: 3, written: 0 });
+      expect(replyDocuments('update', { n: 4, nModified: 3, upserted: [{ index: 0 }] })).toEqual({ returned: 0, written: 4 });
+      expect(replyDocuments('findAndModify', { value: null, lastErrorObject: { n: 0 } })).toEqual({ returned: 0, written: 0 });
+      expect(replyDocuments('distinct', { values: ['a', 'b'] })).toEqual({ returned: 2, written: 0 });
+    });
+
+    test('should list budget violations', () => {
+      const cost = { ...newCost(), commands: 12, writes: 2 };
+
+      expect(budgetViolations(cost, { commands: 10, writes: 5 })).toEqual([{ metric: 'commands', limit: 10, actual: 12 }]);
+      expect(budgetViolations(cost, {})).toEqual([]);
+    });
+  });
+
+  describe('attribution', () => {
+    let tracer;
+    let client;
+
+    beforeEach(() => {
+      tracer = new DbCostTracer();
+      tracer.enabled = true;
+      client = fakeClient();
+      tracer.attach({ getClient: () => client });
+    });
+
+    test('should attribute hook commands to the operation that started them', async () => {
+      const [first, second] = await Promise.all([
+        tracer.trace('appointment.create', () => saveAppointment(client)),
+        tracer.trace('patient.read', () => client.command('find', { collection: 'patients' }, { cursor: { firstBatch: [{}] } }))
+      ]);
+
+      expect(first.cost.commands).toBe(3);
+      expect(first.cost.writes).toBe(3);
+      expect(first.cost.docsWritten).toBe(3);
+      expect(first.cost.byCommand).toEqual({
+        'counters.findAndModify': 1,
+        'appointments.insert': 1,
+        'patients.findAndModify': 1
+      });
+      expect(first.cost.bytesOut).toBeGreaterThan(0);
+      expect(second.cost.byCommand).toEqual({ 'patients.find': 1 });
+      expect(second.cost.docsReturned).toBe(1);
+
+      // Commands outside any operation are not recorded
+      await client.command('find', { collection: 'patients' });
+      expect(tracer.pending.size).toBe(0);
+    });
+
+    test('should roll job steps up into the job and aggregate per route', async () => {
+      const job = tracer.wrapJob('job:reminders', async () => {
+        await client.command('find', { collection: 'appointments' }, { cursor: { firstBatch: [{}, {}] } });
+        await tracer.run('job:reminders:send', () => client.command('update', { collection: 'appointments' }, { n: 2, nModified: 2 }));
+      });
+
+      await job();
+      await job();
+
+      const report = tracer.getReport();
+      const reminders = report.operations.find(op => op.name === 'job:reminders');
+      expect(reminders.count).toBe(2);
+      expect(reminders.perOperation).toMatchObject({ commands: 2, writes: 1, docsReturned: 2, docsWritten: 2 });
+      expect(reminders.commandsPerOperation).toEqual({ 'appointments.find': 1, 'appointments.update': 1 });
+      expect(report.operations.find(op => op.name === 'job:reminders:send').perOperation.commands).toBe(1);
+    });
+
+    test('should name request traces after the matched route', async () => {
+      const req = { method: 'PUT', originalUrl: '/api/appointments/64f0/cancel?x=1', baseUrl: '/api/appointments', route: { path: '/:id/cancel' } };
+      const res = new EventEmitter();
+      res.statusCode = 200;
+
+      const { traces } = await tracer.capture(() => new Promise(resolve => {
+        tracer.middleware()(req, res, async () => {
+          await saveAppointment(client);
+          res.emit('finish');
+          resolve();
+        });
+      }));
+
+      expect(traces.map(t => t.name)).toEqual(['PUT /api/appointments/:id/cancel']);
+      expect(traces[0].cost.commands).toBe(3);
+    });
+
+    test('should report budget overruns with the command breakdown', async () => {
+      const { cost } = await tracer.trace('appointment.create', () => saveAppointment(client));
+
+      expect(() => tracer.assertBudget(cost, { commands: 3, writes: 3 })).not.toThrow();
+      expect(() => tracer.assertBudget(cost, { writes: 2 }, 'POST /api/appointments'))
+        .toThrow('POST /api/appointments over database budget (writes 3 > 2): counters.findAndModify x1');
+    });
+
+    test('should only measure bytes on sampled operations', async () => {
+      tracer.bytesSampleRate = 0;
+
+      await tracer.run('job:reminders', () => saveAppointment(client));
+      const { cost } = await tracer.trace('appointment.create', () => saveAppointment(client));
+
+      const job = tracer.getReport().operations.find(op => op.name === 'job:reminders');
+      expect(job.perOperation.commands).toBe(3);
+      expect(job.perOperation.bytesOut).toBeNull();
+      expect(job.perOperation.bytesIn).toBeNull();
+      // Explicit traces always measure
+      expect(cost.bytesOut).toBeGreaterThan(0);
+      expect(cost.bytesIn).toBeGreaterThan(0);
+    });
+  });
+
+  describe('model hooks on the database', () => {
+    // tests/setup.js connects with monitorCommands and attaches the shared tracer
+    beforeAll(async () => {
+      // Index builds are not part of a save
+      await Promise.all([Appointment.init(), Patient.init(), Visit.init()]);
+    });
+
+    test('should keep an appointment save within its budget', async () => {
+      const patient = await Patient.create(createTestPatient());
+
+      const { cost } = await dbCostTracer.trace('appointment.create', () => Appointment.create({
+        patient: patient._id,
+        provider: new mongoose.Types.ObjectId(),
+        date: new Date(),
+        startTime: '10:00',
+        endTime: '10:30',
+        type: 'consultation',
+        department: 'ophthalmology',
+        reason: 'Control'
+      }));
+
+      // Appointment id counter, the insert, Patient.appointments
+      expect(cost.byCommand).toEqual({
+        'counters.findAndModify': 1,
+        'appointments.insert': 1,
+        'patients.findAndModify': 1
+      });
+      expect(() => dbCostTracer.assertBudget(cost, { commands: 3, writes: 3 }, 'appointment.create')).not.toThrow();
+      expect(cost.bytesIn).toBeGreaterThan(0);
+    });
+
+    test('should keep a completed visit save within its budget', async () => {
+      const patient = await Patient.create(createTestPatient());
+
+      const { cost } = await dbCostTracer.trace('visit.create', () => Visit.create({
+        patient: patient._id,
+        primaryProvider: new mongoose.Types.ObjectId(),
+        visitDate: new Date(Date.now() - 60 * 60 * 1000),
+        status: 'completed'
+      }));
+
+      // Visit id counter, the insert, Patient.lastVisit
+      expect(cost.byCommand).toEqual({
+        'counters.findAndModify': 1,
+        'visits.insert': 1,
+        'patients.findAndModify': 1
+      });
+      expect(() => dbCostTracer.assertBudget(cost, { commands: 3, writes: 3 }, 'visit.create')).not.toThrow();
+      expect((await Patient.findById(patient._id).lean()).lastVisit).toEqual(expect.anything());
+    });
+  });
+});
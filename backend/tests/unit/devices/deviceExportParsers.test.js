@@ -0,0 +1,163 @@
+/**
+ * Device Export Parser Tests
+ *
+ * Tests for the declarative export mappings in services/deviceParsers:
+ * - Golden corpus: every sample in fixtures/deviceExports parses to its .json
+ * - Streaming in small chunks gives the same result as parsing in memory
+ * - Typed field descriptions (units, laterality paths)
+ * - Device to mapping resolution
+ * - A new model added purely as data (fixed-width spec)
+ * - XML edge cases and bulk CSV throughput
+ */
+
+const fs = require('fs');
+const path = require('path');
+const { Readable } = require('stream');
+const deviceParsers = require('../../../services/deviceParsers');
+const { compileFormat } = require('../../../services/deviceParsers/formatCompiler');
+
+const CORPUS = path.join(__dirname, '../../fixtures/deviceExports');
+
+function corpusSamples() {
+  const samples = [];
+  for (const format of fs.readdirSync(CORPUS)) {
+    for (const file of fs.readdirSync(path.join(CORPUS, format))) {
+      if (file.endsWith('.json')) continue;
+      samples.push({ format, file, fileFormat: path.extname(file).slice(1) });
+    }
+  }
+  return samples;
+}
+
+// Dates and NaN compare the way they were stored in the golden files
+const normalize = value => JSON.parse(JSON.stringify(value));
+
+function chunked(content, size) {
+  const buffer = Buffer.from(content, 'utf-8');
+  const chunks = [];
+  for (let i = 0; i < buffer.length; i += size) chunks.push(buffer.subarray(i, i + size));
+  return Readable.from(chunks);
+}
+
+describe('Device export parsers', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  const samples = corpusSamples();
+
+  describe('golden corpus', () => {
+    test('should cover every registered format with samples', () => {
+      const covered = new Set(samples.map(s => s.format));
+      expect(covered.size).toBeGreaterThanOrEqual(10);
+      for (const format of covered) {
+        expect(deviceParsers.listFormats()).toContain(format);
+      }
+    });
+
+    for (const { format, file, fileFormat } of samples) {
+      test(`should parse ${format}/${file} to its golden output`, () => {
+        const content = fs.readFileSync(path.join(CORPUS, format, file));
+        const expected = JSON.parse(fs.readFileSync(path.join(CORPUS, format, `${file}.json`), 'utf-8'));
+
+        expect(normalize(deviceParsers.parseExport(content, { format, fileFormat }))).toEqual(expected);
+      });
+
+      test(`should stream ${format}/${file} in small chunks`, async () => {
+        const content = fs.readFileSync(path.join(CORPUS, format, file), 'utf-8');
+        const streamed = await deviceParsers.parseExportStream(chunked(content, 7), { format, fileFormat });
+
+        expect(normalize(streamed)).toEqual(normalize(deviceParsers.parseExport(content, { format, fileFormat })));
+      });
+    }
+  });
+
+  describe('registry', () => {
+    test('should describe typed fields with units and laterality', () => {
+      const { files } = deviceParsers.describeFormat('tonometer');
+      const iop = files.csv.find(f => f.path === 'OD.iop');
+
+      expect(iop).toMatchObject({ type: 'number', unit: 'mmHg' });
+      expect(files.csv.map(f => f.path)).toContain('OS.iop');
+      expect(deviceParsers.describeFormat('unknown-device')).toBeNull();
+    });
+
+    test('should resolve a mapping from manufacturer and model', () => {
+      expect(deviceParsers.resolveFormat({ manufacturer: 'NIDEK', model: 'ARK-1' })).toBe('nidek-ark');
+      expect(deviceParsers.resolveFormat({ manufacturer: 'Nidek Co.', model: 'RS-3000' })).toBe('nidek');
+      expect(deviceParsers.resolveFormat({ manufacturer: 'Acme', model: 'X1' })).toBeNull();
+    });
+
+    test('should reject file types without a mapping', () => {
+      expect(deviceParsers.supports('oct', 'xml')).toBe(false);
+      expect(() => deviceParsers.parseExport('<a/>', { format: 'oct', fileFormat: 'xml' }))
+        .toThrow('No xml mapping for device export format: oct');
+    });
+  });
+
+  describe('compiled mappings', () => {
+    test('should support a new model described only as data', () => {
+      const extractor = compileFormat({
+        kind: 'fixedWidth',
+        skipLines: 1,
+        columns: { EYE: [0, 2], IOP: [3, 8], CCT: [9, 13] },
+        record: {
+          eye: { from: 'EYE', type: 'laterality' },
+          iop: { from: 'IOP', type: 'number', unit: 'mmHg' },
+          cct: { from: 'CCT', type: 'int', unit: 'um', optional: true }
+        }
+      }, 'test.fixedWidth');
+
+      const records = extractor.parse('EY IOP   CCT\nOD 15.5  540\nOS 17.0\n');
+
+      expect(records).toEqual([
+        { eye: 'OD', iop: 15.5, cct: 540 },
+        { eye: 'OS', iop: 17 }
+      ]);
+      expect(extractor.fields.find(f => f.path === 'iop')).toMatchObject({ type: 'number', unit: 'mmHg' });
+    });
+
+    test('should handle namespaces, CDATA, entities, attributes and comments in XML', () => {
+      const extractor = compileFormat({
+        kind: 'xml',
+        record: {
+          id: { from: ['Patient/ID'], type: 'string' },
+          note: { from: 'Note', type: 'string' },
+          unit: { from: 'unit', type: 'string' },
+          values: { from: 'Value', type: 'number', many: true }
+        }
+      }, 'test.xml');
+
+      const record = extractor.parse([
+        '<?xml version="1.0"?>',
+        '<ns:Export xmlns:ns="urn:test">',
+        '  <Device><ID>DEV-1</ID></Device>',
+        '  <ns:Patient><ns:ID>P&amp;1</ns:ID></ns:Patient>',
+        '  <!-- <Note>ignored</Note> -->',
+        '  <Note><![CDATA[a < b]]> &lt;ok&gt;</Note>',
+        '  <Readings unit="mmHg"><Value>1.5</Value><Value>2</Value></Readings>',
+        '</ns:Export>'
+      ].join('\n'));
+
+      expect(record).toEqual({ id: 'P&1', note: 'a < b <ok>', unit: 'mmHg', values: [1.5, 2] });
+    });
+
+    test('should parse a bulk CSV back-import quickly', async () => {
+      const rows = ['Date,Time,Method,OD IOP,OD Reading 1,OD Reading 2,OS IOP,OS Reading 1,OS Reading 2'];
+      for (let i = 0; i < 20000; i++) {
+        rows.push(`2024-03-18T09:00:00Z,09:${String(i % 60).padStart(2, '0')},NCT,${14 + (i % 6)},15,16,17,16,18`);
+      }
+      const content = rows.join('\n');
+
+      const started = Date.now();
+      let count = 0;
+      for await (const record of deviceParsers.exportRecords(chunked(content, 64 * 1024), { format: 'tonometer', fileFormat: 'csv' })) {
+        if (record.OD.iop > 0 && record.OS.readings.length === 2) count++;
+      }
+      const elapsedMs = Date.now() - started;
+
+      expect(count).toBe(20000);
+      expect(elapsedMs).toBeLessThan(2000);
+    });
+  });
+});
@@ -0,0 +1,144 @@
+/**
+ * Document Template Engine Tests
+ *
+ * Tests for compiled document templates:
+ * - Rendering matches the former per-key regex substitution
+ * - Compiled templates are cached per version and declare their data sources
+ * - Auto-filled data built from a preloaded patient/visit/doctor context
+ * - A day's letters rendered from one context load
+ */
+
+const mongoose = require('mongoose');
+const {
+  DocumentTemplateEngine,
+  compileTemplate
+} = require('../../../services/documentTemplateEngine');
+
+const oid = () => new mongoose.Types.ObjectId();
+
+// The substitution the controller used before templates were compiled
+function legacyFill(content, data) {
+  let filled = content;
+  Object.keys(data).forEach(key => {
+    filled = filled.replace(new RegExp(`{{${key}}}`, 'g'), data[key] || '');
+  });
+  return filled.replace(/{{.*?}}/g, '___________');
+}
+
+const LETTER = [
+  'Kinshasa, le {{consultationDate}}',
+  '',
+  'Cher confrère,',
+  "J'ai examiné {{patientTitle}} {{patientName}}, âgé(e) de {{patientAge}} ans,",
+  'le {{visitDate}}. AV OD {{vaOD}} / OG {{vaOG}}, PIO {{iopOD}}/{{iopOG}} mmHg.',
+  'Diagnostic : {{diagnosis}}. {{unknownField}}',
+  '',
+  '{{doctorName}}'
+].join('\n');
+
+describe('Document template engine', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('compileTemplate', () => {
+    test('should render like the per-key regex substitution', () => {
+      const cases = [
+        { content: LETTER, data: { patientName: 'Jean Mukendi', patientAge: 0, vaOD: '0.8', consultationDate: '18/10/2026' } },
+        { content: '{{a}}{{a}} {{b}}', data: { a: 'x', b: '' } },
+        { content: 'no placeholders', data: { a: 'x' } },
+        { content: '{{ spaced }} {{}} {{a}', data: { a: 'x' } }
+      ];
+
+      for (const { content, data } of cases) {
+        expect(compileTemplate(content).render(data)).toBe(legacyFill(content, data));
+      }
+    });
+
+    test('should declare fields and the data sources they need', () => {
+      const { fields, sources } = compileTemplate(LETTER);
+
+      expect(fields).toContain('unknownField');
+      expect(fields.filter(f => f === 'patientName')).toHaveLength(1);
+      expect([...sources].sort()).toEqual(['patient', 'refraction', 'user', 'visit']);
+      expect([...compileTemplate('Patient: {{patientName}}').sources]).toEqual(['patient']);
+    });
+  });
+
+  describe('DocumentTemplateEngine', () => {
+    test('should reuse a compiled template until its version changes', () => {
+      const engine = new DocumentTemplateEngine();
+      const template = { _id: oid(), version: 1, updatedAt: new Date('2026-10-01'), content: 'A {{patientName}}' };
+
+      const first = engine.getCompiled(template);
+      expect(engine.getCompiled({ ...template })).toBe(first);
+
+      const edited = { ...template, version: 2, content: 'B {{patientName}}' };
+      expect(engine.render(edited, { patientName: 'X' })).toBe('B X');
+      expect(engine.getCompiled(edited)).not.toBe(first);
+    });
+
+    test('should build auto-filled data from a loaded context', () => {
+      const engine = new DocumentTemplateEngine();
+      const patientId = oid();
+      const visitId = oid();
+      const context = {
+        patients: new Map([[String(patientId), {
+          _id: patientId, firstName: 'Marie', lastName: 'Kabila', gender: 'female', dateOfBirth: new Date('1970-03-05'), phoneNumber: '+243'
+        }]]),
+        visits: new Map([[String(visitId), {
+          _id: visitId,
+          patient: patientId,
+          visitDate: new Date('2026-10-18T09:00:00'),
+          diagnoses: [{ diagnosis: 'Glaucome' }],
+          vitalSigns: { iop: { right: 21, left: 19 } },
+          examinations: { refraction: { visualAcuity: { withoutCorrection: { right: { decimal: 0.6 } } } } }
+        }]]),
+        user: { firstName: 'Paul', lastName: 'Ilunga', gender: 'male', specialization: 'Ophtalmologie' }
+      };
+
+      const data = engine.buildData(context, { visitId }, { note: 'RDV dans 3 mois', patientName: 'ignored' });
+
+      expect(data).toMatchObject({
+        patientName: 'Marie Kabila',
+        patientTitle: 'Madame',
+        dateOfBirth: '05/03/1970',
+        visitDate: '18/10/2026',
+        consultationDate: '18/10/2026',
+        diagnosis: 'Glaucome',
+        vaOD: 0.6,
+        vaOG: '0',
+        iopOD: 21,
+        doctorName: 'Mr Paul Ilunga',
+        note: 'RDV dans 3 mois'
+      });
+    });
+
+    test("should render a day's letters from one context", () => {
+      const engine = new DocumentTemplateEngine();
+      const templates = Array.from({ length: 5 }, (_, i) => ({
+        _id: oid(), version: 1, content: `${i}: ${LETTER.repeat(20)}`
+      }));
+      const context = { patients: new Map(), visits: new Map(), user: { firstName: 'Paul', lastName: 'Ilunga' } };
+      for (let i = 0; i < 200; i++) {
+        const patientId = oid();
+        const visitId = oid();
+        context.patients.set(String(patientId), { firstName: `P${i}`, lastName: 'Test', gender: 'male' });
+        context.visits.set(String(visitId), { _id: visitId, patient: patientId, visitDate: new Date() });
+      }
+
+      const started = Date.now();
+      let rendered = 0;
+      for (const visitId of context.visits.keys()) {
+        const data = engine.buildData(context, { visitId });
+        for (const template of templates) {
+          const content = engine.render(template, data);
+          if (content.includes(data.patientName)) rendered++;
+        }
+      }
+
+      expect(rendered).toBe(1000);
+      expect(Date.now() - started).toBeLessThan(1000);
+    });
+  });
+});
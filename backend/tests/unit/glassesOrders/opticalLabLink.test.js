@@ -0,0 +1,280 @@
+/**
+ * Optical Lab Link Tests
+ *
+ * Tests for the VCA lens-lab link:
+ * - Order record encoding (Rx, frame boxing, tracer radii)
+ * - Batched TCP session against a mock lab (ACK/NAK, status request)
+ * - File drop session
+ * - Bulk status / job-completion planning
+ * - Polling: updates lost to a concurrent order change are replanned, and
+ *   records stay with the lab until applied
+ */
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const {
+  buildOrderRecord,
+  parseRecord,
+  parseStream,
+  parseStatusMessage,
+  planStatusUpdates,
+  mirrorRadii,
+  OpticalLabLinkService,
+  VcaTcpSession,
+  VcaFileSession
+} = require('../../../services/opticalLabLinkService');
+const GlassesOrder = require('../../../models/GlassesOrder');
+const { createMockVcaLab } = require('../../fixtures/mockVcaLab');
+
+const makeOrder = (orderNumber, overrides = {}) => ({
+  _id: `id-${orderNumber}`,
+  orderNumber,
+  priority: 'normal',
+  patient: { firstName: 'Marie', lastName: 'Kabila' },
+  prescriptionData: {
+    od: { sphere: -2.25, cylinder: -0.5, axis: 180, add: 2 },
+    os: { sphere: -2, cylinder: -0.75, axis: 5, add: 2 },
+    pd: { binocular: 63 }
+  },
+  glasses: {
+    lensType: 'progressive',
+    lensMaterial: 'polycarbonate',
+    coatings: ['anti-reflective'],
+    frame: {
+      brand: 'Ray-Ban',
+      model: 'RB5154',
+      material: 'metal',
+      tracing: { hbox: 51, vbox: 35, dbl: 21, radii: [2550, 2500, 2400, 2500] }
+    }
+  },
+  ...overrides
+});
+
+describe('Optical Lab Link', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('buildOrderRecord', () => {
+    test('should encode prescription, lens and frame data as VCA labels', () => {
+      const record = parseRecord(buildOrderRecord(makeOrder('GO-1')).join('\r\n'));
+
+      expect(record.JOB[0]).toEqual(['GO-1']);
+      expect(record.SPH[0]).toEqual(['-2.25', '-2.00']);
+      expect(record.AX[0]).toEqual(['180', '5']);
+      expect(record.IPD[0]).toEqual(['31.5', '31.5']);
+      expect(record.LTYP[0]).toEqual(['PR', 'PR']);
+      expect(record.LIND[0]).toEqual(['1.59', '1.59']);
+      expect(record.FTYP[0]).toEqual(['2']);
+      expect(record.HBOX[0]).toEqual(['51.00', '51.00']);
+      expect(record.DBL[0]).toEqual(['21.00']);
+    });
+
+    test('should emit tracer radii for both eyes with the left eye mirrored', () => {
+      const record = parseRecord(buildOrderRecord(makeOrder('GO-1')).join('\r\n'));
+
+      expect(record.TRCFMT).toEqual([['1', '4', 'E', 'R', 'F'], ['1', '4', 'E', 'L', 'F']]);
+      expect(record.R[0]).toEqual(['2550', '2500', '2400', '2500']);
+      expect(record.R[1]).toEqual(mirrorRadii([2550, 2500, 2400, 2500]).map(String));
+    });
+  });
+
+  describe('parseStream', () => {
+    test('should split ACK/NAK tokens and framed records and keep partial data', () => {
+      const { tokens, rest } = parseStream('\x06\x15\x1cJOB=1\r\nSTATUS=ACK\r\n\x1d\x1cJOB=2');
+      expect(tokens.map(t => t.type)).toEqual(['ack', 'nak', 'record']);
+      expect(rest).toBe('\x1cJOB=2');
+    });
+  });
+
+  describe('TCP session with mock lab', () => {
+    let lab;
+
+    beforeEach(async () => {
+      lab = await createMockVcaLab({ nakJobs: ['GO-BAD'] }).listen();
+    });
+
+    afterEach(async () => {
+      await lab.close();
+    });
+
+    test('should transmit a whole batch in a single session', async () => {
+      const orders = Array.from({ length: 200 }, (_, i) => makeOrder(`GO-${i}`));
+      const session = await VcaTcpSession.connect({ host: '127.0.0.1', port: lab.port, timeoutMs: 5000 });
+
+      const results = await session.sendOrders(orders.map(order => ({
+        job: order.orderNumber,
+        lines: buildOrderRecord(order)
+      })));
+      await session.close();
+
+      expect(lab.sessions).toBe(1);
+      expect(lab.orders).toHaveLength(200);
+      expect(results.every(r => r.accepted)).toBe(true);
+    });
+
+    test('should report jobs the lab keeps rejecting', async () => {
+      const session = await VcaTcpSession.connect({ host: '127.0.0.1', port: lab.port, timeoutMs: 5000 });
+
+      const results = await session.sendOrders([
+        { job: 'GO-1', lines: buildOrderRecord(makeOrder('GO-1')) },
+        { job: 'GO-BAD', lines: buildOrderRecord(makeOrder('GO-BAD')) },
+        { job: 'GO-2', lines: buildOrderRecord(makeOrder('GO-2')) }
+      ]);
+      await session.close();
+
+      expect(results).toEqual([
+        { job: 'GO-1', accepted: true },
+        { job: 'GO-BAD', accepted: false },
+        { job: 'GO-2', accepted: true }
+      ]);
+    });
+
+    test('should fetch queued status records', async () => {
+      lab.queueStatus({ JOB: 'GO-1', STATUS: 'PROD', _LABJOB: 'L-991' });
+      lab.queueStatus({ JOB: 'GO-1', STATUS: 'COMPL', TRACK: 'TRK-1', DATE: '2026-10-12T10:00:00Z' });
+
+      const session = await VcaTcpSession.connect({ host: '127.0.0.1', port: lab.port, timeoutMs: 5000 });
+      const records = await session.fetchStatus();
+      await session.close();
+
+      const messages = records.map(parseStatusMessage);
+      expect(messages.map(m => m.labStatus)).toEqual(['in-production', 'shipped']);
+      expect(messages[0].labOrderNumber).toBe('L-991');
+      expect(messages[1].completed).toBe(true);
+      expect(messages[1].trackingNumber).toBe('TRK-1');
+    });
+  });
+
+  describe('File drop session', () => {
+    test('should write one batch file and consume lab status files', async () => {
+      const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'vca-'));
+      const session = new VcaFileSession(dir);
+
+      await session.sendOrders([
+        { job: 'GO-1', lines: buildOrderRecord(makeOrder('GO-1')) },
+        { job: 'GO-2', lines: buildOrderRecord(makeOrder('GO-2')) }
+      ], 'VCA-TEST');
+
+      const written = fs.readFileSync(path.join(dir, 'outbox', 'VCA-TEST.vca'), 'latin1');
+      expect(parseStream(written).tokens).toHaveLength(2);
+
+      fs.mkdirSync(path.join(dir, 'inbox'), { recursive: true });
+      fs.writeFileSync(path.join(dir, 'inbox', 'status1.vca'), '\x1cJOB=GO-1\r\nSTATUS=ACK\r\n\x1d');
+
+      const records = await session.fetchStatus();
+      expect(records).toHaveLength(1);
+      // Left in the inbox until the updates are applied
+      expect(fs.existsSync(path.join(dir, 'inbox', 'status1.vca'))).toBe(true);
+      expect(await session.fetchStatus()).toHaveLength(1);
+
+      await session.acknowledgeStatus();
+      expect(fs.existsSync(path.join(dir, 'inbox', 'processed', 'status1.vca'))).toBe(true);
+      expect(await session.fetchStatus()).toHaveLength(0);
+
+      fs.rmSync(dir, { recursive: true, force: true });
+    });
+  });
+
+  describe('planStatusUpdates', () => {
+    const exportedAt = new Date('2026-10-10T10:00:00Z');
+    const now = new Date('2026-10-12T12:00:00Z');
+    const orders = [
+      { _id: 'a', orderNumber: 'GO-1', status: 'sent-to-lab', externalLab: { exportedAt, labStatus: 'pending' } },
+      { _id: 'b', orderNumber: 'GO-2', status: 'in-production', externalLab: { exportedAt, labStatus: 'in-production' } }
+    ];
+
+    test('should fold several messages into one update per order', () => {
+      const messages = [
+        { job: 'GO-1', code: 'PROD', labStatus: 'in-production', completed: false },
+        { job: 'GO-1', code: 'COMPL', labStatus: 'shipped', completed: true, at: new Date('2026-10-12T10:00:00Z') },
+        { job: 'GO-9', code: 'ACK', labStatus: 'acknowledged', completed: false }
+      ];
+
+      const plan = planStatusUpdates(orders, messages, now);
+
+      expect(plan.operations).toHaveLength(1);
+      expect(plan.unmatched).toEqual(['GO-9']);
+      const { filter, update } = plan.operations[0].updateOne;
+      expect(filter).toEqual({ _id: 'a', status: 'sent-to-lab' });
+      expect(update.$set.status).toBe('in-production');
+      expect(update.$set['externalLab.labStatus']).toBe('shipped');
+      expect(update.$set['externalLab.turnaroundHours']).toBe(48);
+      expect(update.$push['externalLab.statusHistory'].$each).toHaveLength(2);
+    });
+
+    test('should ignore re-delivered status messages', () => {
+      const plan = planStatusUpdates(orders, [
+        { job: 'GO-2', code: 'PROD', labStatus: 'in-production', completed: false }
+      ], now);
+
+      expect(plan.operations).toHaveLength(0);
+      expect(plan.ignored).toBe(1);
+    });
+  });
+
+  describe('status poll', () => {
+    const exportedAt = new Date('2026-10-10T10:00:00Z');
+    const statusRecords = [
+      parseRecord('JOB=GO-1\r\nSTATUS=PROD'),
+      parseRecord('JOB=GO-2\r\nSTATUS=COMPL')
+    ];
+    const fakeSession = () => ({
+      fetchStatus: async () => statusRecords,
+      acknowledgeStatus: jest.fn()
+    });
+
+    beforeEach(async () => {
+      await GlassesOrder.collection.insertMany(['GO-1', 'GO-2'].map(orderNumber => ({
+        orderNumber,
+        status: 'sent-to-lab',
+        externalLab: { exported: true, exportedAt, labStatus: 'pending', statusHistory: [] }
+      })));
+    });
+
+    // Staff change GO-1 between the poll's read and its write
+    const changeStatusBeforeWrite = (times) => {
+      const bulkWrite = GlassesOrder.bulkWrite.bind(GlassesOrder);
+      let changes = 0;
+      return jest.spyOn(GlassesOrder, 'bulkWrite').mockImplementation(async (operations, options) => {
+        if (changes++ < times) {
+          const order = await GlassesOrder.collection.findOne({ orderNumber: 'GO-1' });
+          await GlassesOrder.collection.updateOne({ _id: order._id }, {
+            $set: { status: order.status === 'sent-to-lab' ? 'in-production' : 'sent-to-lab' }
+          });
+        }
+        return bulkWrite(operations, options);
+      });
+    };
+
+    test('should replan an update lost to a concurrent change and then acknowledge', async () => {
+      changeStatusBeforeWrite(1);
+      const session = fakeSession();
+
+      const summary = await new OpticalLabLinkService()._poll(session);
+
+      expect(summary).toMatchObject({ updated: 2, notApplied: [] });
+      expect(session.acknowledgeStatus).toHaveBeenCalledTimes(1);
+      const first = await GlassesOrder.collection.findOne({ orderNumber: 'GO-1' });
+      expect(first.externalLab.labStatus).toBe('in-production');
+      expect(first.externalLab.statusHistory).toHaveLength(1);
+      const second = await GlassesOrder.collection.findOne({ orderNumber: 'GO-2' });
+      expect(second.externalLab.labStatus).toBe('shipped');
+      expect(second.externalLab.statusHistory).toHaveLength(1);
+    });
+
+    test('should leave the records with the lab when an update keeps missing', async () => {
+      changeStatusBeforeWrite(Infinity);
+      const session = fakeSession();
+
+      const summary = await new OpticalLabLinkService()._poll(session);
+
+      expect(summary.notApplied).toEqual(['GO-1']);
+      expect(session.acknowledgeStatus).not.toHaveBeenCalled();
+      const first = await GlassesOrder.collection.findOne({ orderNumber: 'GO-1' });
+      expect(first.externalLab.labStatus).toBe('pending');
+    });
+  });
+});
@@ -0,0 +1,193 @@
+/**
+ * Index Advisor Tests
+ *
+ * - Query shape normalization (no values, ESR classification)
+ * - Index coverage, redundant and unused index detection
+ * - Replay of a recorded workload against the test mongod
+ */
+
+const mongoose = require('mongoose');
+
+const {
+  IndexAdvisorService,
+  describeQuery,
+  describePipeline,
+  recommendIndex,
+  indexCoverage,
+  bestCoverage,
+  findRedundantIndexes,
+  findUnusedIndexes
+} = require('../../services/indexAdvisorService');
+const { workload, documents } = require('../fixtures/indexAdvisorWorkload');
+
+describe('Index Advisor', () => {
+  describe('describeQuery', () => {
+    test('should classify fields without keeping values', () => {
+      const shape = describeQuery({
+        filter: {
+          clinic: new mongoose.Types.ObjectId(),
+          status: { $in: ['a', 'b'] },
+          visitDate: { $gte: new Date(), $lt: new Date() },
+          lastName: /^DUP/,
+          firstName: { $regex: 'jean', $options: 'i' }
+        },
+        sort: '-visitDate',
+        projection: 'firstName lastName',
+        skip: 40
+      });
+
+      expect(shape.eq).toEqual(['clinic', 'status']);
+      expect(shape.range).toEqual(['visitDate']);
+      expect(shape.regex).toEqual([
+        { field: 'firstName', anchored: false },
+        { field: 'lastName', anchored: true }
+      ]);
+      expect(shape.sort).toEqual([['visitDate', -1]]);
+      expect(shape.projection).toEqual(['firstName', 'lastName']);
+      expect(shape.skip).toBe(40);
+      expect(JSON.stringify(shape)).not.toMatch(/jean|DUP/);
+    });
+
+    test('should describe $and, $or branches and the leading $match of a pipeline', () => {
+      const shape = describeQuery({
+        filter: { $and: [{ clinic: 'x' }, { $or: [{ phone: '1' }, { email: '2' }] }] }
+      });
+      expect(shape.eq).toEqual(['clinic']);
+      expect(shape.or[0].map(b => b.eq)).toEqual([['phone'], ['email']]);
+
+      const agg = describePipeline([{ $match: { clinic: 'x', createdAt: { $gte: 1 } } }, { $sort: { createdAt: -1 } }]);
+      expect(agg.eq).toEqual(['clinic']);
+      expect(agg.sort).toEqual([['createdAt', -1]]);
+    });
+  });
+
+  describe('recommendIndex / indexCoverage', () => {
+    const shape = describeQuery({
+      filter: { clinic: 'x', status: 'y', visitDate: { $gte: 1 } },
+      sort: { createdAt: -1 }
+    });
+
+    test('should order keys equality, sort, range', () => {
+      expect(recommendIndex(shape)).toEqual([['clinic', 1], ['status', 1], ['createdAt', -1], ['visitDate', 1]]);
+    });
+
+    test('should grade existing indexes', () => {
+      expect(indexCoverage(shape, { status: 1, clinic: 1, createdAt: 1, visitDate: 1 })).toBe('full');
+      expect(indexCoverage(shape, { clinic: 1, status: 1 })).toBe('partial');
+      expect(indexCoverage(shape, { clinic: 1, status: 1, createdAt: -1, visitDate: -1 })).toBe('full');
+      expect(indexCoverage(shape, { patient: 1 })).toBe('none');
+    });
+
+    test('should require an index per $or branch', () => {
+      const orShape = describeQuery({ filter: { $or: [{ phone: '1' }, { email: '2' }] } });
+      expect(bestCoverage(orShape, [{ key: { phone: 1 } }])).toBe('none');
+      expect(bestCoverage(orShape, [{ key: { phone: 1 } }, { key: { email: 1 } }])).toBe('full');
+    });
+  });
+
+  describe('findRedundantIndexes', () => {
+    test('should report prefixes and duplicates but keep unique, TTL and partial indexes', () => {
+      const redundant = findRedundantIndexes([
+        { name: '_id_', key: { _id: 1 } },
+        { name: 'clinic_1', key: { clinic: 1 } },
+        { name: 'clinic_1_status_1', key: { clinic: 1, status: 1 } },
+        { name: 'clinic_-1_status_-1', key: { clinic: -1, status: -1 } },
+        { name: 'visitNumber_1', key: { visitNumber: 1 }, unique: true },
+        { name: 'visitNumber_1_clinic_1', key: { visitNumber: 1, clinic: 1 } },
+        { name: 'createdAt_1', key: { createdAt: 1 }, expireAfterSeconds: 3600 },
+        { name: 'createdAt_1_clinic_1', key: { createdAt: 1, clinic: 1 } }
+      ]);
+
+      expect(redundant.map(r => [r.index, r.reason])).toEqual([
+        ['clinic_1', 'prefix of clinic_1_status_1'],
+        ['clinic_1_status_1', 'duplicates clinic_-1_status_-1']
+      ]);
+    });
+  });
+
+  describe('findUnusedIndexes', () => {
+    const indexes = [
+      { name: '_id_', key: { _id: 1 } },
+      { name: 'a_1', key: { a: 1 } },
+      { name: 'b_1', key: { b: 1 }, unique: true },
+      { name: 'c_1', key: { c: 1 } }
+    ];
+    const since = new Date('2026-10-01T00:00:00Z');
+    const stats = [
+      { name: '_id_', accesses: { ops: 0, since } },
+      { name: 'a_1', accesses: { ops: 0, since } },
+      { name: 'b_1', accesses: { ops: 0, since } },
+      { name: 'c_1', accesses: { ops: 12, since } }
+    ];
+
+    test('should only report non-constraint indexes with zero accesses', () => {
+      const unused = findUnusedIndexes(indexes, stats, { now: new Date('2026-10-15T00:00:00Z') });
+      expect(unused.map(u => u.index)).toEqual(['a_1']);
+    });
+
+    test('should wait for enough observation time', () => {
+      expect(findUnusedIndexes(indexes, stats, { now: new Date('2026-10-02T00:00:00Z') })).toEqual([]);
+    });
+  });
+
+  describe('workload replay against mongod', () => {
+    let advisor;
+    let Visit;
+
+    beforeAll(async () => {
+      advisor = new IndexAdvisorService();
+      const schema = new mongoose.Schema({
+        visitNumber: { type: String, unique: true },
+        clinic: mongoose.Schema.ObjectId,
+        status: String,
+        visitDate: Date,
+        patientName: String,
+        legacyCode: String
+      });
+      schema.index({ clinic: 1 });
+      schema.index({ clinic: 1, status: 1 });
+      schema.index({ legacyCode: 1 });
+      schema.plugin(s => advisor.plugin(s));
+
+      Visit = mongoose.model('AdvisorReplayVisit', schema);
+      await Visit.syncIndexes();
+    });
+
+    test('should turn the recorded workload into concrete advice', async () => {
+      await Visit.insertMany(documents);
+
+      for (const { filter, sort, skip, limit } of workload) {
+        let query = Visit.find(filter);
+        if (sort) query = query.sort(sort);
+        if (skip) query = query.skip(skip);
+        if (limit) query = query.limit(limit);
+        await query.lean();
+      }
+
+      const report = await advisor.getReport({
+        collections: [Visit.collection.collectionName],
+        slowMs: 0,
+        minObservationMs: 0
+      });
+
+      const worklist = report.missing.find(m => m.shape.includes('eq:clinic,status') && m.shape.includes('sort:visitDate:-1'));
+      expect(worklist.coverage).toBe('partial');
+      expect(worklist.recommendedIndex).toEqual({ clinic: 1, status: 1, visitDate: -1 });
+      expect(worklist.count).toBe(20);
+
+      const search = report.missing.find(m => m.shape.includes('patientName~'));
+      expect(search.notes[0]).toMatch(/Unanchored/);
+
+      const paging = report.missing.find(m => m.notes.some(n => n.includes('skip()')));
+      expect(paging).toBeDefined();
+
+      expect(report.missing.some(m => m.shape.includes('eq:clinic,status') && m.shape.includes('sort: '))).toBe(false);
+
+      expect(report.redundant.map(r => r.index)).toContain('clinic_1');
+      expect(report.unused.map(u => u.index)).toContain('legacyCode_1');
+      expect(report.unused.map(u => u.index)).not.toContain('visitNumber_1');
+      expect(report.unused.map(u => u.index)).not.toContain('clinic_1_status_1');
+      expect(report.totals.queries).toBe(workload.length);
+    });
+  });
+});
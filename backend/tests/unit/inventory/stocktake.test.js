@@ -0,0 +1,245 @@
+/**
+ * Stocktake Tests
+ *
+ * Tests for stream-mode barcode stock counts:
+ * - Tallies and live variance per item and lot
+ * - Adjustments relative to the snapshot, keeping movements during the count
+ * - Idempotent re-sync from offline handhelds
+ * - Counting closed on submission, even with the session cached
+ * - Ten scanners counting in parallel, then one bulk adjustment
+ */
+
+const mongoose = require('mongoose');
+const StockReconciliation = require('../../../models/StockReconciliation');
+const StocktakeCount = require('../../../models/StocktakeCount');
+const { Inventory, PharmacyInventory } = require('../../../models/Inventory');
+const User = require('../../../models/User');
+const {
+  StocktakeService,
+  tallyCounts,
+  computeVariance,
+  planAdjustments
+} = require('../../../services/stocktakeService');
+const { createTestUser } = require('../../fixtures/generators');
+
+const oid = () => new mongoose.Types.ObjectId();
+
+function snapshotOf(entries) {
+  return new Map(entries.map(e => [String(e.id), {
+    systemQuantity: e.system,
+    lots: new Map(Object.entries(e.lots || {})),
+    name: e.name,
+    unit: 'unit',
+    costPrice: e.cost || 0,
+    inventoryType: 'pharmacy'
+  }]));
+}
+
+describe('Stocktake', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('variance helpers', () => {
+    const drops = oid();
+    const frames = oid();
+    const snapshot = snapshotOf([
+      { id: drops, name: 'Timolol 0.5%', system: 10, cost: 2, lots: { A1: 6, B2: 4 } },
+      { id: frames, name: 'Frame RB-3025', system: 3, cost: 40 }
+    ]);
+
+    test('should report variance per item and lot', () => {
+      const tallies = tallyCounts([
+        { item: drops, lotNumber: 'A1', quantity: 6, countedBy: 'u1', location: 'Aisle 1' },
+        { item: drops, lotNumber: 'B2', quantity: 3, countedBy: 'u2', location: 'Aisle 2' },
+        { item: frames, quantity: 2, countedBy: 'u1' },
+        { item: frames, quantity: 1, countedBy: 'u2' }
+      ]);
+
+      const { lines, summary } = computeVariance(snapshot, tallies);
+
+      expect(lines).toHaveLength(1);
+      expect(lines[0]).toMatchObject({ name: 'Timolol 0.5%', countedQuantity: 9, variance: -1, varianceValue: -2, counters: 2 });
+      expect(lines[0].lots).toEqual([
+        { lotNumber: 'A1', systemQuantity: 6, countedQuantity: 6, variance: 0 },
+        { lotNumber: 'B2', systemQuantity: 4, countedQuantity: 3, variance: -1 }
+      ]);
+      expect(summary).toMatchObject({ itemsCounted: 2, itemsWithVariance: 1, totalShortage: 1, accuracyRate: 50 });
+    });
+
+    test('should not touch lots of an item counted without lot numbers', () => {
+      const tallies = tallyCounts([{ item: drops, quantity: 10 }]);
+      const current = [{ _id: drops, inventory: { currentStock: 10 }, batches: [{ _id: oid(), lotNumber: 'A1', quantity: 6 }], version: 3 }];
+
+      expect(computeVariance(snapshot, tallies).lines).toHaveLength(0);
+      expect(planAdjustments(snapshot, tallies, current, { userId: oid(), reference: 'REC-1' })).toHaveLength(0);
+    });
+
+    test('should apply deltas to current stock so movements during the count are kept', () => {
+      const lotA = oid();
+      const tallies = tallyCounts([
+        { item: drops, lotNumber: 'A1', quantity: 5 },
+        { item: drops, lotNumber: 'C3', quantity: 2 }
+      ]);
+      // Two units of A1 were dispensed after the snapshot
+      const current = [{
+        _id: drops,
+        inventory: { currentStock: 8, reserved: 1, reorderPoint: 2 },
+        batches: [{ _id: lotA, lotNumber: 'A1', quantity: 4 }, { _id: oid(), lotNumber: 'B2', quantity: 4 }],
+        version: 7
+      }];
+
+      const [plan] = planAdjustments(snapshot, tallies, current, { userId: oid(), reference: 'REC-1' });
+
+      // counted 7 vs snapshot 10 -> -3 applied to the current 8
+      expect(plan).toMatchObject({ delta: -3, previousQuantity: 8, newQuantity: 5 });
+      const { filter, update, arrayFilters } = plan.op.updateOne;
+      expect(filter.version).toBe(7);
+      expect(update.$set['inventory.available']).toBe(4);
+      expect(update.$set['inventory.status']).toBe('in_stock');
+      // A1: 4 + (5 - 6); B2: 4 + (0 - 4); C3 found
+      expect(Object.values(update.$set).slice(0, 2)).toEqual([3, 0]);
+      expect(arrayFilters).toHaveLength(2);
+      expect(update.$push.batches.$each[0]).toMatchObject({ lotNumber: 'C3', quantity: 2 });
+      expect(update.$push.transactions).toMatchObject({ type: 'adjusted', quantity: -3, reference: 'REC-1' });
+    });
+  });
+
+  describe('count stream', () => {
+    let user;
+    let clinic;
+    let service;
+
+    beforeEach(async () => {
+      user = await User.create(createTestUser({ role: 'pharmacist' }));
+      clinic = oid();
+      service = new StocktakeService();
+    });
+
+    async function startCount(itemCount) {
+      const items = await PharmacyInventory.insertMany(Array.from({ length: itemCount }, (_, i) => ({
+        clinic,
+        name: `Item ${i}`,
+        sku: `SKU-${i}`,
+        barcode: `BC${String(i).padStart(6, '0')}`,
+        inventory: { currentStock: 20, available: 20, maximumStock: 1000 },
+        batches: [{ lotNumber: `LOT-${i}`, quantity: 20 }],
+        pricing: { costPrice: 1.5 }
+      })));
+
+      const reconciliation = await StockReconciliation.create({
+        reconciliationNumber: `REC-TEST-${Date.now()}`,
+        clinic,
+        department: 'pharmacy',
+        reconciliationType: 'full',
+        countMode: 'stream',
+        initiatedBy: user._id
+      });
+      await reconciliation.start(user._id);
+      await service.takeSnapshot(reconciliation);
+      return { items, reconciliation };
+    }
+
+    test('should ignore scans re-sent by an offline handheld', async () => {
+      const { reconciliation } = await startCount(2);
+      const queue = [
+        { barcode: 'BC000000', scanId: 'hh1-1', lotNumber: 'LOT-0' },
+        { barcode: 'bc000001', scanId: 'hh1-2', quantity: 3 },
+        { barcode: 'UNKNOWN', scanId: 'hh1-3' }
+      ];
+
+      const first = await service.recordScans(reconciliation._id, queue, { userId: user._id, deviceId: 'hh1' });
+      const resend = await service.recordScans(reconciliation._id, queue, { userId: user._id, deviceId: 'hh1' });
+
+      expect(first).toMatchObject({ accepted: 2, duplicates: 0 });
+      expect(first.rejected).toEqual([{ index: 2, scanId: 'hh1-3', barcode: 'UNKNOWN', reason: 'unknown_item' }]);
+      expect(resend).toMatchObject({ accepted: 0, duplicates: 2 });
+      expect(await StocktakeCount.countDocuments({ reconciliation: reconciliation._id })).toBe(2);
+    });
+
+    test('should refuse scans once the count is submitted, and review what is applied', async () => {
+      const { items, reconciliation } = await startCount(1);
+      await service.recordScans(reconciliation._id, [{ barcode: 'BC000000', scanId: 'hh1-1', quantity: 5 }], { userId: user._id });
+
+      // Submitted by another request: this service still has the session cached
+      const submitted = await StockReconciliation.findById(reconciliation._id);
+      await submitted.submitForReview(user._id);
+      await new StocktakeService().materializeItems(submitted);
+      await submitted.save();
+
+      await expect(service.recordScans(reconciliation._id, [{ barcode: 'BC000000', scanId: 'hh1-2', quantity: 7 }], { userId: user._id }))
+        .rejects.toThrow('pending_review');
+      expect(submitted.items[0].countedQuantity).toBe(5);
+
+      await service.applyAdjustments(reconciliation._id, { userId: user._id });
+      expect((await Inventory.findById(items[0]._id).lean()).inventory.currentStock).toBe(5);
+    });
+
+    test('should keep reconciliations without a count mode on the legacy path', async () => {
+      const legacy = await StockReconciliation.create({
+        reconciliationNumber: `REC-LEGACY-${Date.now()}`,
+        clinic,
+        department: 'pharmacy',
+        reconciliationType: 'full',
+        initiatedBy: user._id
+      });
+
+      expect((await StockReconciliation.findById(legacy._id)).countMode).toBeUndefined();
+    });
+
+    test('should count with ten scanners in parallel and apply in one bulk write', async () => {
+      const ITEMS = 50;
+      const SCANNERS = 10;
+      const UPLOADS = 20;
+      const SCANS_PER_UPLOAD = 25;
+      const { items, reconciliation } = await startCount(ITEMS);
+
+      // Each scanner walks its own aisle: scanner s counts items where i % 10 === s
+      const scanner = async (s) => {
+        const own = items.filter((_, i) => i % SCANNERS === s);
+        let sequence = 0;
+        for (let upload = 0; upload < UPLOADS; upload++) {
+          const scans = Array.from({ length: SCANS_PER_UPLOAD }, () => {
+            const item = own[sequence % own.length];
+            sequence++;
+            return { barcode: item.barcode, lotNumber: item.batches[0].lotNumber, location: `Aisle ${s}`, scanId: `hh${s}-${sequence}` };
+          });
+          const result = await service.recordScans(reconciliation._id, scans, { userId: user._id, deviceId: `hh${s}` });
+          expect(result.accepted).toBe(SCANS_PER_UPLOAD);
+        }
+      };
+
+      const started = Date.now();
+      await Promise.all(Array.from({ length: SCANNERS }, (_, s) => scanner(s)));
+      const elapsedMs = Date.now() - started;
+
+      const totalScans = SCANNERS * UPLOADS * SCANS_PER_UPLOAD;
+      expect(await StocktakeCount.countDocuments({ reconciliation: reconciliation._id })).toBe(totalScans);
+
+      // 5000 scans over 50 items -> 100 each, against 20 on the shelf record
+      const live = await service.getLiveVariance(reconciliation._id);
+      expect(live.summary).toMatchObject({ itemsInScope: ITEMS, itemsCounted: ITEMS, totalOverage: ITEMS * 80 });
+      expect(live.devices).toHaveLength(SCANNERS);
+      expect(live.stream.accepted).toBe(totalScans);
+
+      // Rebuilt from the stream after a restart, the variance is identical
+      const rebuilt = await new StocktakeService().getLiveVariance(reconciliation._id);
+      expect(rebuilt.summary).toEqual(live.summary);
+
+      const applied = await service.applyAdjustments(reconciliation._id, { userId: user._id });
+      expect(applied.adjusted).toHaveLength(ITEMS);
+      expect(applied.skipped).toEqual([]);
+
+      const after = await Inventory.findById(items[0]._id).lean();
+      expect(after.inventory.currentStock).toBe(100);
+      expect(after.batches[0].quantity).toBe(100);
+      expect(after.transactions.pop()).toMatchObject({ type: 'adjusted', quantity: 80, reason: 'stocktake' });
+
+      const stored = await StockReconciliation.findById(reconciliation._id);
+      expect(stored.status).toBe('adjusted');
+
+      // Throughput well above a single handheld's scan rate
+      expect(totalScans / (elapsedMs / 1000)).toBeGreaterThan(500);
+    });
+  });
+});
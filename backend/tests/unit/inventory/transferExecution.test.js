@@ -0,0 +1,250 @@
+/**
+ * Transfer Execution Tests
+ *
+ * Tests for set-based inventory transfer stock movements:
+ * - Shipment validation (stock, reserved quantities, named lots) before writing
+ * - First-expiry-first lot allocation and one version-guarded op per item
+ * - Receipt into existing destination items, lot merges and new products
+ * - A depot replenishment with hundreds of lines shipped and received
+ */
+
+const mongoose = require('mongoose');
+const InventoryTransfer = require('../../../models/InventoryTransfer');
+const { Inventory, PharmacyInventory } = require('../../../models/Inventory');
+const User = require('../../../models/User');
+const {
+  TransferExecutionService,
+  planShipment,
+  planReceipt
+} = require('../../../services/transferExecutionService');
+const { createTestUser } = require('../../fixtures/generators');
+
+const oid = () => new mongoose.Types.ObjectId();
+
+function pharmacyItem({ stock, reserved = 0, batches = [], version = 4, ...rest }) {
+  return {
+    _id: oid(),
+    inventoryType: 'pharmacy',
+    clinic: oid(),
+    sku: `SKU-${Math.random().toString(36).slice(2, 8)}`,
+    name: 'Timolol 0.5%',
+    inventory: { currentStock: stock, reserved, minimumStock: 2, maximumStock: 500 },
+    batches: batches.map(b => ({ _id: oid(), status: 'available', ...b })),
+    version,
+    ...rest
+  };
+}
+
+const line = (item, quantity, extra = {}) => ({
+  lineId: String(oid()),
+  itemId: String(item._id),
+  inventoryType: 'pharmacy',
+  quantity,
+  productName: item.name,
+  ...extra
+});
+
+const context = { userId: oid(), reference: 'TRF-2026-0001', destinationName: 'Clinique Nord' };
+
+describe('Transfer execution', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('planShipment', () => {
+    test('should allocate first-expiry-first across lines of the same item', () => {
+      const item = pharmacyItem({
+        stock: 30,
+        batches: [
+          { lotNumber: 'LATE', quantity: 10, expirationDate: new Date('2027-06-01') },
+          { lotNumber: 'SOON', quantity: 8, expirationDate: new Date('2026-12-01') },
+          { lotNumber: 'UNDATED', quantity: 12 }
+        ]
+      });
+      const first = line(item, 5);
+      const second = line(item, 10);
+
+      const { ops, allocations, shortages } = planShipment([first, second], new Map([[String(item._id), item]]), context);
+
+      expect(shortages).toEqual([]);
+      expect(allocations.get(first.lineId)).toEqual([
+        { lotNumber: 'SOON', expirationDate: new Date('2026-12-01'), quantity: 5 }
+      ]);
+      expect(allocations.get(second.lineId).map(a => [a.lotNumber, a.quantity])).toEqual([['SOON', 3], ['LATE', 7]]);
+
+      expect(ops).toHaveLength(1);
+      const { filter, update, arrayFilters } = ops[0].updateOne;
+      expect(filter).toEqual({ _id: item._id, version: 4 });
+      expect(update.$set['inventory.currentStock']).toBe(15);
+      expect(update.$set['inventory.status']).toBe('in_stock');
+      expect(Object.values(update.$set).slice(4)).toEqual([0, 3]);
+      expect(arrayFilters).toHaveLength(2);
+      expect(update.$push.transactions.$each.map(t => [t.quantity, t.newQuantity])).toEqual([[-5, 25], [-10, 15]]);
+      expect(update.$inc).toEqual({ version: 1 });
+    });
+
+    test('should report every shortage without planning writes for them', () => {
+      const reserved = pharmacyItem({ stock: 10, reserved: 6 });
+      const lotted = pharmacyItem({ stock: 50, batches: [{ lotNumber: 'A1', quantity: 4 }] });
+      const lines = [
+        line(reserved, 5),
+        line(lotted, 5, { lotNumber: 'A1' }),
+        line(lotted, 1, { lotNumber: 'ZZ' }),
+        line({ _id: oid(), name: 'Missing' }, 1),
+        line(lotted, 1, { inventoryType: 'frame' })
+      ];
+      const sources = new Map([[String(reserved._id), reserved], [String(lotted._id), lotted]]);
+
+      const { shortages } = planShipment(lines, sources, context);
+
+      expect(shortages.map(s => s.reason)).toEqual([
+        'insufficient_stock', 'insufficient_lot', 'insufficient_lot', 'not_found', 'not_found'
+      ]);
+      expect(shortages[0]).toMatchObject({ requested: 5, available: 4 });
+      expect(shortages[1]).toMatchObject({ lotNumber: 'A1', available: 4 });
+    });
+  });
+
+  describe('planReceipt', () => {
+    const receiptContext = { userId: oid(), reference: 'TRF-2026-0001', sourceName: 'Dépôt Central', destinationClinic: oid() };
+
+    test('should add to the matching destination item and merge lots', () => {
+      const source = pharmacyItem({ stock: 100 });
+      const destination = pharmacyItem({
+        stock: 3,
+        sku: source.sku,
+        version: 9,
+        batches: [{ lotNumber: 'A1', quantity: 3 }]
+      });
+      const received = {
+        lineId: 'l1',
+        itemId: String(source._id),
+        quantity: 8,
+        batches: [{ lotNumber: 'A1', quantity: 5 }, { lotNumber: 'B2', quantity: 5, expirationDate: new Date('2027-01-01') }]
+      };
+
+      const { ops, missing } = planReceipt([received], new Map([[String(source._id), source]]), [destination], receiptContext);
+
+      expect(missing).toEqual([]);
+      expect(ops).toHaveLength(1);
+      const { filter, update } = ops[0].updateOne;
+      expect(filter).toEqual({ _id: destination._id, version: 9 });
+      expect(update.$set['inventory.currentStock']).toBe(11);
+      expect(update.$set['batches.$[b0].quantity']).toBe(8);
+      // Partial receipt: 8 received of 10 shipped, B2 gets the remaining 3
+      expect(update.$push.batches.$each).toHaveLength(1);
+      expect(update.$push.batches.$each[0]).toMatchObject({ lotNumber: 'B2', quantity: 3 });
+      expect(update.$push.transactions.$each[0]).toMatchObject({ type: 'transferred', quantity: 8, previousQuantity: 3, newQuantity: 11 });
+    });
+
+    test('should insert a product new to the destination clinic', () => {
+      const source = pharmacyItem({ stock: 40, reserved: 5, batches: [{ lotNumber: 'A1', quantity: 40 }] });
+      const received = { lineId: 'l1', itemId: String(source._id), quantity: 6, batches: [{ lotNumber: 'A1', quantity: 6 }] };
+
+      const { ops } = planReceipt([received], new Map([[String(source._id), source]]), [], receiptContext);
+
+      const { document } = ops[0].insertOne;
+      expect(document._id).toBeUndefined();
+      expect(document).toMatchObject({ sku: source.sku, inventoryType: 'pharmacy', clinic: receiptContext.destinationClinic, version: 0 });
+      expect(document.inventory).toMatchObject({ currentStock: 6, reserved: 0, available: 6, status: 'in_stock' });
+      expect(document.batches.map(b => [b.lotNumber, b.quantity])).toEqual([['A1', 6]]);
+    });
+  });
+
+  describe('execution', () => {
+    let user;
+    let service;
+
+    beforeEach(async () => {
+      user = await User.create(createTestUser({ role: 'depot_manager' }));
+      service = new TransferExecutionService();
+    });
+
+    test('should ship and receive a depot replenishment of hundreds of lines', async () => {
+      const LINES = 300;
+      const depot = oid();
+      const clinic = oid();
+
+      const sources = await PharmacyInventory.insertMany(Array.from({ length: LINES }, (_, i) => ({
+        clinic: depot,
+        isDepot: true,
+        sku: `DEP-${i}`,
+        name: `Drug ${i}`,
+        inventory: { currentStock: 50, available: 50, maximumStock: 1000 },
+        batches: [{ lotNumber: `LOT-${i}`, quantity: 50, expirationDate: new Date('2027-01-01') }]
+      })));
+      // Half of the products already stocked at the clinic
+      await PharmacyInventory.insertMany(sources.slice(0, LINES / 2).map(source => ({
+        clinic,
+        sku: source.sku,
+        name: source.name,
+        inventory: { currentStock: 2, available: 2, maximumStock: 1000 }
+      })));
+
+      const transfer = await InventoryTransfer.create({
+        transferNumber: `TRF-TEST-${Date.now()}`,
+        type: 'depot-to-clinic',
+        source: { isDepot: true, name: 'Dépôt Central' },
+        destination: { clinic, name: 'Clinique Nord' },
+        items: sources.map(source => ({
+          inventoryType: 'pharmacy',
+          inventoryId: source._id,
+          inventoryModel: 'PharmacyInventory',
+          productName: source.name,
+          requestedQuantity: 20,
+          approvedQuantity: 20,
+          status: 'approved'
+        })),
+        status: 'approved',
+        requestedBy: user._id
+      });
+
+      const started = Date.now();
+      await service.ship(transfer, user._id, { method: 'internal-courier' });
+      const shipMs = Date.now() - started;
+
+      expect(transfer.status).toBe('in-transit');
+      expect(transfer.items[0].shippedBatches[0]).toMatchObject({ lotNumber: 'LOT-0', quantity: 20 });
+      const shipped = await Inventory.findById(sources[0]._id).lean();
+      expect(shipped.inventory.currentStock).toBe(30);
+      expect(shipped.batches[0].quantity).toBe(30);
+      expect(shipped.version).toBe(1);
+
+      await service.receive(transfer, user._id, transfer.items.map(item => ({ itemId: item._id, quantity: 20 })));
+
+      expect(transfer.status).toBe('completed');
+      const atClinic = await Inventory.find({ clinic }).lean();
+      expect(atClinic).toHaveLength(LINES);
+      const existing = atClinic.find(doc => doc.sku === 'DEP-0');
+      const created = atClinic.find(doc => doc.sku === `DEP-${LINES - 1}`);
+      expect(existing.inventory.currentStock).toBe(22);
+      expect(created.inventory.currentStock).toBe(20);
+      expect(created.batches[0]).toMatchObject({ lotNumber: `LOT-${LINES - 1}`, quantity: 20 });
+
+      expect(shipMs).toBeLessThan(2000);
+    });
+
+    test('should leave stock and transfer untouched when a line is short', async () => {
+      const [source] = await PharmacyInventory.insertMany([{
+        clinic: oid(),
+        sku: 'SHORT-1',
+        name: 'Short drug',
+        inventory: { currentStock: 5, available: 5 }
+      }]);
+      const transfer = await InventoryTransfer.create({
+        transferNumber: `TRF-SHORT-${Date.now()}`,
+        type: 'depot-to-clinic',
+        source: { isDepot: true },
+        destination: { clinic: oid() },
+        items: [{ inventoryType: 'pharmacy', inventoryId: source._id, productName: 'Short drug', requestedQuantity: 9, approvedQuantity: 9, status: 'approved' }],
+        status: 'approved',
+        requestedBy: user._id
+      });
+
+      await expect(service.ship(transfer, user._id)).rejects.toThrow('Insufficient stock to ship this transfer');
+
+      expect(transfer.status).toBe('approved');
+      expect((await Inventory.findById(source._id).lean()).inventory.currentStock).toBe(5);
+    });
+  });
+});
@@ -0,0 +1,265 @@
+/**
+ * Label Print Spooler Tests
+ *
+ * - ZPL: ^PQ copies, command characters kept out of field data, one tube
+ *   label per specimen type of a lab order
+ * - ~HS host status parsing and printer list configuration
+ * - Batch jobs on one connection against a mock network printer
+ * - Per-printer queues: a printer out of paper does not hold another
+ * - Offline printer: job held, retried, released when the printer returns
+ * - Expiry and cancellation of held jobs
+ * - Benchmark: 200 shelf labels after a stock receipt as one job
+ */
+
+const net = require('net');
+const {
+  LabelPrintSpooler,
+  loadSettings,
+  parsePrinters,
+  parseHostStatus
+} = require('../../services/labelPrintSpooler');
+const {
+  generateZPL,
+  generateBatchZPL,
+  generateShelfLabel,
+  generateLabOrderTubeLabels
+} = require('../../services/labelPrintingService');
+const { createMockZebraPrinter, hostStatus } = require('../fixtures/mockZebraPrinter');
+
+const wait = (ms) => new Promise(resolve => setTimeout(resolve, ms));
+
+async function until(condition, timeoutMs = 3000) {
+  const started = Date.now();
+  while (!condition()) {
+    if (Date.now() - started > timeoutMs) throw new Error('Timed out waiting for condition');
+    await wait(5);
+  }
+}
+
+function freePort() {
+  return new Promise(resolve => {
+    const server = net.createServer().listen(0, '127.0.0.1', () => {
+      const { port } = server.address();
+      server.close(() => resolve(port));
+    });
+  });
+}
+
+function spooler(printers, overrides = {}) {
+  return new LabelPrintSpooler({
+    ...loadSettings({}),
+    printers: Object.entries(printers).map(([name, port]) => ({ name, host: '127.0.0.1', port })),
+    timeoutMs: 1000,
+    statusTimeoutMs: 200,
+    retryMinMs: 20,
+    retryMaxMs: 100,
+    ...overrides
+  });
+}
+
+const patient = { firstName: 'Marie', lastName: 'Kabila', dateOfBirth: new Date('1980-04-12'), patientId: 'PAT-000123' };
+
+const labOrder = {
+  orderId: 'LAB-20261018-0042',
+  specimen: { barcode: 'SPC-88412', collectedAt: new Date('2026-10-18T08:15:00') },
+  tests: [
+    { testCode: 'GLY', testName: 'Glycémie', specimen: 'Sérum' },
+    { testCode: 'CREA', testName: 'Créatinine', specimen: 'Sérum' },
+    { testCode: 'NFS', testName: 'Numération', specimen: 'Sang EDTA' },
+    { testCode: 'HBA1C', testName: 'HbA1c', specimen: 'Sang EDTA' },
+    { testCode: 'ECBU', testName: 'ECBU', specimen: 'Urine' },
+    { testCode: 'TSH', testName: 'TSH', specimen: 'Sérum', status: 'cancelled' }
+  ]
+};
+
+const shelfItems = (count) => Array.from({ length: count }, (_, i) => ({
+  name: `Monture ${i}`,
+  sku: `FR-${String(i).padStart(5, '0')}`,
+  location: `A${i % 12}`
+}));
+
+describe('Label print spooler', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('ZPL', () => {
+    test('should print copies with ^PQ instead of repeating the format', () => {
+      const zpl = generateZPL({ templateId: 'specimen', data: { patientName: 'Kabila, Marie', barcode: 'SPC-1' }, copies: 3 });
+
+      expect(zpl.match(/\^XA/g)).toHaveLength(1);
+      expect(zpl).toContain('^PQ3');
+      expect(generateZPL({ templateId: 'specimen', data: {}, copies: 1 })).not.toContain('^PQ');
+    });
+
+    test('should keep ZPL command characters out of field data', () => {
+      const zpl = generateZPL({ templateId: 'inventory_shelf', data: { itemName: 'Verre ^XZ~JA', sku: 'X1' }, copies: 1 });
+
+      expect(zpl.match(/\^XZ/g)).toHaveLength(1);
+      expect(zpl).not.toContain('~JA');
+    });
+
+    test('should make one tube label per specimen type of a lab order', () => {
+      const labels = generateLabOrderTubeLabels(labOrder, patient);
+
+      expect(labels).toHaveLength(3);
+      expect(labels.map(label => label.data.specimenType)).toEqual(['Sérum - GLY, CREA', 'Sang EDTA - NFS, HBA1C', 'Urine - ECBU']);
+      expect(labels.every(label => label.data.barcode === 'SPC-88412')).toBe(true);
+      expect(labels[0].data.mrn).toBe('PAT-000123');
+      expect(generateBatchZPL(labels).match(/\^XA/g)).toHaveLength(3);
+    });
+  });
+
+  describe('configuration and status', () => {
+    test('should parse the printer list', () => {
+      expect(parsePrinters('lab=10.0.0.21, stock=10.0.0.22:6101')).toEqual([
+        { name: 'lab', host: '10.0.0.21', port: 9100 },
+        { name: 'stock', host: '10.0.0.22', port: 6101 }
+      ]);
+      expect(parsePrinters('10.0.0.30')).toEqual([{ name: 'default', host: '10.0.0.30', port: 9100 }]);
+      expect(parsePrinters(undefined)).toEqual([]);
+    });
+
+    test('should parse ~HS host status', () => {
+      expect(parseHostStatus(hostStatus({}))).toMatchObject({ ready: true, problems: [] });
+      expect(parseHostStatus(hostStatus({ paperOut: true, headUp: true }))).toMatchObject({
+        ready: false,
+        paperOut: true,
+        headUp: true,
+        problems: ['paperOut', 'headUp']
+      });
+      expect(parseHostStatus('\x02030,0,0')).toBeNull();
+    });
+
+    test('should route jobs by kind, then default', () => {
+      const service = spooler({ lab: 1, stock: 2 });
+      expect(service.resolvePrinter(undefined, 'stock').name).toBe('stock');
+      expect(service.resolvePrinter('pharmacy', 'prescription').name).toBe('lab');
+      expect(spooler({}).resolvePrinter('lab')).toBeNull();
+    });
+  });
+
+  describe('against mock printers', () => {
+    let printers = [];
+    let service;
+
+    afterEach(async () => {
+      if (service) service.stop();
+      await Promise.all(printers.map(printer => printer.close()));
+      printers = [];
+      service = null;
+    });
+
+    async function printer(options) {
+      const mock = await createMockZebraPrinter(options).listen();
+      printers.push(mock);
+      return mock;
+    }
+
+    test('should print a lab order as one job on one connection', async () => {
+      const lab = await printer();
+      service = spooler({ lab: lab.port });
+
+      const job = service.submit(generateLabOrderTubeLabels(labOrder, patient), { kind: 'lab', reference: labOrder.orderId });
+      await until(() => service.getJob(job.id).status === 'printed' && lab.formats.length === 3);
+
+      expect(lab.connections).toBe(1);
+      expect(lab.statusQueries).toBe(1);
+      expect(lab.formats).toHaveLength(3);
+      expect(service.getJob(job.id)).toMatchObject({ labelCount: 3, attempts: 1, reference: labOrder.orderId });
+      expect(service.getJob(job.id).zpl).toBeUndefined();
+    });
+
+    test('should not let a printer out of paper hold another printer', async () => {
+      const lab = await printer({ paperOut: true });
+      const stock = await printer();
+      service = spooler({ lab: lab.port, stock: stock.port }, { retryMinMs: 1000 });
+
+      const held = service.submit(generateLabOrderTubeLabels(labOrder, patient), { kind: 'lab' });
+      const shelf = service.submit(shelfItems(5).map(generateShelfLabel), { kind: 'stock' });
+      await until(() => service.getJob(shelf.id).status === 'printed' && stock.formats.length === 5);
+      await until(() => service.getJob(held.id).status === 'queued' && service.getJob(held.id).attempts === 1);
+
+      expect(stock.formats).toHaveLength(5);
+      expect(lab.formats).toHaveLength(0);
+      expect(service.getJob(held.id)).toMatchObject({ status: 'queued', lastError: 'Printer not ready: paperOut' });
+      expect(service.getStatus().printers[0].state).toBe('not_ready');
+
+      lab.paperOut = false;
+      await service.pollStatus();
+      await until(() => service.getJob(held.id).status === 'printed' && lab.formats.length === 3);
+      expect(lab.formats).toHaveLength(3);
+    });
+
+    test('should hold jobs for an offline printer and print when it returns', async () => {
+      const port = await freePort();
+      service = spooler({ lab: port }, { retryMinMs: 1000, retryMaxMs: 1000 });
+
+      const first = service.submit(generateLabOrderTubeLabels(labOrder, patient), { kind: 'lab' });
+      const second = service.submit([generateShelfLabel(shelfItems(1)[0])], { kind: 'lab' });
+      await until(() => service.getStatus().printers[0].state === 'offline');
+      expect(service.getJob(first.id).status).toBe('queued');
+
+      const lab = await createMockZebraPrinter().listen(port);
+      printers.push(lab);
+      // The status poll releases the queue before the backoff ends
+      await service.pollStatus();
+      await until(() => service.getJob(second.id).status === 'printed' && lab.formats.length === 4, 500);
+
+      expect(service.getJob(first.id).status).toBe('printed');
+      // In submission order
+      expect(lab.formats.map(format => format.zpl.includes('FR-00000'))).toEqual([false, false, false, true]);
+    });
+
+    test('should print anyway when the printer does not answer ~HS', async () => {
+      const lab = await printer({ answerStatus: false });
+      service = spooler({ lab: lab.port });
+
+      const job = service.submit([generateShelfLabel(shelfItems(1)[0])]);
+      await until(() => service.getJob(job.id).status === 'printed' && lab.formats.length === 1);
+
+      expect(lab.formats).toHaveLength(1);
+    });
+
+    test('should fail jobs that stay held past their TTL', async () => {
+      const port = await freePort();
+      service = spooler({ lab: port }, { jobTtlMs: 80 });
+
+      const job = service.submit([generateShelfLabel(shelfItems(1)[0])]);
+      await until(() => service.getJob(job.id).status === 'failed');
+
+      expect(service.getJob(job.id).lastError).toMatch(/ECONNREFUSED/);
+      expect(service.getStatus().printers[0].queued).toBe(0);
+      expect(service.getStatus().counters).toMatchObject({ failed: 1, printed: 0 });
+    });
+
+    test('should cancel a held job but not a finished one', async () => {
+      const port = await freePort();
+      service = spooler({ lab: port }, { retryMinMs: 1000 });
+
+      const job = service.submit([generateShelfLabel(shelfItems(1)[0])]);
+      await until(() => service.getJob(job.id).attempts === 1 && service.getJob(job.id).status === 'queued');
+
+      expect(service.cancel(job.id)).toEqual({ cancelled: true });
+      expect(service.getJob(job.id).status).toBe('cancelled');
+      expect(service.cancel(job.id)).toEqual({ cancelled: false, reason: 'cancelled' });
+      expect(service.cancel('missing')).toEqual({ cancelled: false, reason: 'not-found' });
+      expect(service.getStatus().printers[0].queued).toBe(0);
+    });
+
+    test('should print 200 shelf labels as one job in well under a second', async () => {
+      const stock = await printer();
+      service = spooler({ stock: stock.port });
+
+      const started = Date.now();
+      const job = service.submit(shelfItems(200).map(generateShelfLabel), { kind: 'stock', reference: 'PO-2026-0107' });
+      await until(() => service.getJob(job.id).status === 'printed' && stock.labelsPrinted() === 200);
+      const elapsed = Date.now() - started;
+
+      expect(stock.connections).toBe(1);
+      expect(stock.labelsPrinted()).toBe(200);
+      // Browser print dialog: one label per click
+      expect(elapsed).toBeLessThan(1000);
+    });
+  });
+});
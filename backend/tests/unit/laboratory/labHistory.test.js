@@ -0,0 +1,151 @@
+/**
+ * Lab History Tests
+ *
+ * Tests for the per-analyte result history:
+ * - History documents built from results (backfill)
+ * - Panel delta checks, rate of change and unit changes
+ * - Cumulative report layout
+ */
+
+const {
+  analyteKey,
+  buildHistoryDocuments,
+  evaluateComponent,
+  evaluatePanel,
+  buildCumulativeReport
+} = require('../../../services/labHistoryService');
+
+const day = (n) => new Date(Date.UTC(2026, 9, n, 8));
+
+const makeResult = (id, at, values, overrides = {}) => ({
+  _id: `r${id}`,
+  resultId: `RES2026${String(id).padStart(6, '0')}`,
+  status: 'final',
+  performedAt: at,
+  test: { testCode: 'BMP', testName: 'Basic Metabolic Panel', category: 'chemistry' },
+  results: Object.entries(values).map(([parameter, value]) => ({
+    parameter,
+    value: String(value),
+    numericValue: typeof value === 'number' ? value : undefined,
+    unit: parameter === 'Glucose' ? 'mg/dL' : 'mmol/L',
+    referenceRange: { low: 1, high: 10 }
+  })),
+  ...overrides
+});
+
+describe('Lab History', () => {
+  const results = [
+    makeResult(1, day(1), { Glucose: 90, Potassium: 4.0 }),
+    makeResult(2, day(5), { Glucose: 95, Potassium: 4.2 }),
+    makeResult(3, day(9), { Glucose: 100, Potassium: 4.1 }),
+    makeResult(4, day(9), { Glucose: 500 }, { status: 'preliminary' })
+  ];
+  const histories = buildHistoryDocuments('p1', results);
+  const byKey = new Map(histories.map(h => [h.analyteKey, h]));
+
+  describe('buildHistoryDocuments', () => {
+    test('should build one sorted series per analyte from reportable results only', () => {
+      expect(histories).toHaveLength(2);
+      const glucose = byKey.get(analyteKey('BMP', 'Glucose'));
+      expect(glucose.points.map(p => p.value)).toEqual([90, 95, 100]);
+      expect(glucose.componentIndex).toBe(0);
+      expect(glucose.lastAt).toEqual(day(9));
+    });
+
+    test('should group test codes regardless of case and whitespace', () => {
+      const mixed = buildHistoryDocuments('p1', [
+        makeResult(1, day(1), { Glucose: 90 }, { test: { testCode: ' bmp', testName: 'Basic Metabolic Panel' } }),
+        makeResult(2, day(5), { Glucose: 95 }, { test: { testCode: 'BMP ', testName: 'Basic Metabolic Panel' } })
+      ]);
+
+      expect(mixed).toHaveLength(1);
+      expect(mixed[0].testCode).toBe('BMP');
+      expect(mixed[0].points.map(p => p.value)).toEqual([90, 95]);
+    });
+  });
+
+  describe('evaluatePanel', () => {
+    test('should evaluate every component against its own history', () => {
+      const current = makeResult(5, day(12), { Glucose: 300, Potassium: 4.3 });
+      const panel = evaluatePanel(current, byKey);
+
+      const glucose = panel.components.find(c => c.parameter === 'Glucose');
+      expect(glucose.previousValue).toBe(100);
+      expect(glucose.previousResultId).toBe('RES2026000003');
+      expect(glucose.change).toBe(200);
+      expect(glucose.deltaFlag).toBe(true);
+
+      const potassium = panel.components.find(c => c.parameter === 'Potassium');
+      expect(potassium.deltaFlag).toBeUndefined();
+      expect(panel.deltaFlags).toEqual(['Glucose']);
+      expect(panel.requiresReview).toBe(true);
+    });
+
+    test('should not delta-flag against a previous value outside the window', () => {
+      const current = makeResult(6, day(30), { Glucose: 300 });
+      const [glucose] = evaluatePanel(current, byKey).components;
+
+      expect(glucose.hasPrevious).toBe(true);
+      expect(glucose.isSignificant).toBe(true);
+      expect(glucose.deltaFlag).toBeUndefined();
+    });
+
+    test('should ignore the result itself when re-evaluating a saved result', () => {
+      const [glucose] = evaluatePanel(results[2], byKey).components;
+      expect(glucose.previousValue).toBe(95);
+    });
+
+    test('should flag a sustained rate of change below the delta limit', () => {
+      const creeping = buildHistoryDocuments('p1', [
+        makeResult(1, day(1), { Glucose: 100 }),
+        makeResult(2, day(8), { Glucose: 120 }),
+        makeResult(3, day(15), { Glucose: 140 })
+      ]);
+      const current = makeResult(4, day(22), { Glucose: 160 });
+      const [glucose] = evaluatePanel(current, new Map(creeping.map(h => [h.analyteKey, h]))).components;
+
+      expect(glucose.deltaFlag).toBeUndefined();
+      expect(glucose.rateFlag).toBe(true);
+      expect(glucose.ratePerDay).toBeCloseTo(20 / 7, 3);
+    });
+  });
+
+  describe('evaluateComponent', () => {
+    test('should not compare values reported in different units', () => {
+      const evaluation = evaluateComponent({
+        parameter: 'Glucose', testCode: 'BMP', value: 5.5, unit: 'mmol/L', at: day(10)
+      }, byKey.get(analyteKey('BMP', 'Glucose')));
+
+      expect(evaluation.hasPrevious).toBe(false);
+      expect(evaluation.flags).toEqual(['UNIT_CHANGED']);
+    });
+  });
+
+  describe('buildCumulativeReport', () => {
+    test('should lay out one column per result and one row per analyte', () => {
+      const [report] = buildCumulativeReport(histories);
+
+      expect(report.testCode).toBe('BMP');
+      expect(report.columns.map(c => c.resultId)).toEqual([
+        'RES2026000001', 'RES2026000002', 'RES2026000003'
+      ]);
+      expect(report.rows.map(r => r.parameter)).toEqual(['Glucose', 'Potassium']);
+      expect(report.rows[1].cells.map(c => c.value)).toEqual([4.0, 4.2, 4.1]);
+    });
+
+    test('should merge histories stored under differently cased test codes', () => {
+      const legacy = histories.map(h => ({ ...h, testCode: h.parameter === 'Potassium' ? 'bmp ' : h.testCode }));
+      const reports = buildCumulativeReport(legacy);
+
+      expect(reports).toHaveLength(1);
+      expect(reports[0].testCode).toBe('BMP');
+      expect(reports[0].rows).toHaveLength(2);
+    });
+
+    test('should restrict columns to the date range', () => {
+      const [report] = buildCumulativeReport(histories, { from: day(4), to: day(6) });
+      expect(report.columns).toHaveLength(1);
+      expect(report.rows[0].cells).toEqual([{ value: 95, flag: undefined }]);
+    });
+  });
+});
@@ -0,0 +1,147 @@
+/**
+ * Memory Watchdog Tests
+ *
+ * - Growth trend vs spikes, profile/restart thresholds, restart only on a
+ *   held or growing excess
+ * - Sampling heap profile of a synthetic leak names the leaking function
+ * - Report with registered cache sizes, then a drained restart
+ */
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const {
+  MemoryWatchdog,
+  loadSettings,
+  growthRate,
+  isSustainedGrowth,
+  assessMemory,
+  summarizeProfile
+} = require('../../services/memoryWatchdog');
+
+const MB = 1024 * 1024;
+
+const series = (values) => values.map((mb, i) => ({ at: i * 15000, rss: mb * MB }));
+
+// Retained allocations that grow with every call, like an unbounded cache
+const leaked = [];
+function leakVisitSummaries(count) {
+  for (let i = 0; i < count; i++) {
+    leaked.push({ visitId: `visit-${leaked.length}`, notes: 'x'.repeat(64), findings: new Array(32).fill(i) });
+  }
+}
+
+describe('Memory watchdog', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  const settings = { ...loadSettings({}), windowSize: 6 };
+
+  describe('trend assessment', () => {
+    test('should measure growth and tell trends from spikes', () => {
+      // +4MB every 15s = 16MB/min
+      expect(Math.round(growthRate(series([300, 304, 308, 312])) / MB)).toBe(16);
+
+      expect(isSustainedGrowth(series([380, 384, 383, 390, 396, 401]), 6)).toBe(true);
+      expect(isSustainedGrowth(series([380, 420, 381, 379, 382, 380]), 6)).toBe(false);
+      expect(isSustainedGrowth(series([380, 384, 388]), 6)).toBe(false);
+    });
+
+    test('should profile on sustained growth and restart near the limit', () => {
+      expect(assessMemory(series([200, 210, 220, 230, 240, 250]), settings)).toBe('ok');
+      expect(assessMemory(series([380, 384, 388, 392, 396, 400]), settings)).toBe('profile');
+      // High but flat: nothing to investigate
+      expect(assessMemory(series([400, 400, 400, 400, 400, 400]), settings)).toBe('ok');
+      expect(assessMemory([], settings)).toBe('ok');
+    });
+
+    test('should restart only when the restart fraction holds or is reached by growth', () => {
+      // One spike (upload, export) past the limit
+      expect(assessMemory(series([455]), settings)).toBe('ok');
+      expect(assessMemory(series([300, 300, 300, 300, 455]), settings)).toBe('ok');
+      expect(assessMemory(series([300, 455, 300, 455, 300, 455]), settings)).toBe('ok');
+      // Stays past it
+      expect(assessMemory(series([300, 455, 452, 457]), settings)).toBe('restart');
+      // Climbs into it
+      expect(assessMemory(series([400, 410, 420, 430, 440, 455]), settings)).toBe('restart');
+    });
+  });
+
+  describe('allocation profiling', () => {
+    let dumpDir;
+
+    beforeEach(() => {
+      dumpDir = fs.mkdtempSync(path.join(os.tmpdir(), 'medflow-memory-'));
+      leaked.length = 0;
+    });
+
+    afterEach(() => {
+      fs.rmSync(dumpDir, { recursive: true, force: true });
+    });
+
+    test('should name the leaking function in the captured profile', async () => {
+      const watchdog = new MemoryWatchdog({ ...settings, dumpDir });
+      const leak = setInterval(() => leakVisitSummaries(2000), 5);
+
+      const profile = await watchdog.captureProfile(300);
+      clearInterval(leak);
+
+      const sites = summarizeProfile(profile);
+      expect(sites.length).toBeGreaterThan(0);
+      expect(sites.slice(0, 5).map(site => site.functionName)).toContain('leakVisitSummaries');
+      const leakSite = sites.find(site => site.functionName === 'leakVisitSummaries');
+      expect(leakSite.url).toMatch(/memoryWatchdog\.test\.js$/);
+      expect(leakSite.bytes).toBeGreaterThan(MB);
+    });
+
+    test('should report cache sizes and top allocations, then restart once', async () => {
+      let rss = 300 * MB;
+      const watchdog = new MemoryWatchdog(
+        { ...settings, dumpDir, heapSnapshot: false, restartProfileMs: 300, restartSamples: 2 },
+        { readMemory: () => ({ rss, heapUsed: rss * 0.7, heapTotal: rss * 0.8, external: 20 * MB, arrayBuffers: 5 * MB }) }
+      );
+      const fileCache = new Map([['dev1:a.xml', {}], ['dev1:b.xml', {}]]);
+      watchdog.register('smb2:fileCache', () => fileCache.size);
+      watchdog.register('websocket:roomBuffers', () => ({ entries: 340, keys: 4 }));
+      watchdog.register('broken', () => { throw new Error('not ready'); });
+
+      let restarts = 0;
+      watchdog.onRestart = async () => { restarts++; };
+
+      // Steady, then past the restart fraction for two samples while something leaks
+      // (no growth trend: the restart comes from the held excess)
+      for (let i = 0; i < 5; i++) {
+        expect(await watchdog.sample()).toBe('ok');
+      }
+
+      rss = 455 * MB;
+      expect(await watchdog.sample()).toBe('ok');
+      const leak = setInterval(() => leakVisitSummaries(2000), 5);
+      rss = 460 * MB;
+      const action = await watchdog.sample();
+      clearInterval(leak);
+
+      expect(action).toBe('restart');
+      expect(restarts).toBe(1);
+      expect(await watchdog.sample()).toBe('busy');
+      expect(restarts).toBe(1);
+
+      const report = watchdog.lastReport;
+      expect(report.reason).toBe('restart-threshold');
+      expect(report.sizes).toEqual({
+        'smb2:fileCache': { entries: 2 },
+        'websocket:roomBuffers': { entries: 340, keys: 4 },
+        broken: { error: 'not ready' }
+      });
+      expect(report.memory[report.memory.length - 1].rssMB).toBe(460);
+      expect(report.topAllocations.map(site => site.functionName)).toContain('leakVisitSummaries');
+
+      const files = fs.readdirSync(dumpDir);
+      expect(files.some(file => file.endsWith('.heapprofile'))).toBe(true);
+      expect(files.some(file => file.endsWith('.json'))).toBe(true);
+      const written = JSON.parse(fs.readFileSync(report.files.profile, 'utf8'));
+      expect(written.head).toBeDefined();
+    });
+  });
+});
@@ -0,0 +1,408 @@
+/**
+ * Patient Flow Router Tests
+ *
+ * Tests for the simulator in patientFlowService:
+ * - Stations served by a room, station durations from history
+ * - Live recommendations: one patient per free station, doctor last,
+ *   doctor of the appointment respected
+ * - Rollout: a free station feeds an idle doctor before the longest waiter
+ * - Replay of historical days: router vs the linear department queues
+ * - Dispatch writes only the assigned station entry
+ * - On the database: concurrent dispatches, lapsed reservations, station
+ *   start/completion and station edits racing a dispatch
+ */
+
+const mongoose = require('mongoose');
+const Appointment = require('../../models/Appointment');
+const Room = require('../../models/Room');
+const {
+  dispatch,
+  startStation,
+  completeStation,
+  updateStations,
+  releaseExpiredAssignments,
+  createState,
+  run,
+  greedyPick,
+  recommend,
+  replayDay,
+  summarize,
+  buildDurationModel,
+  predictStationMinutes,
+  roomServes,
+  assignmentUpdate
+} = require('../../services/patientFlowService');
+
+// Deterministic days: same arrivals and durations on every run
+function random(seed) {
+  let state = seed;
+  return () => {
+    state = (state * 1664525 + 1013904223) % 4294967296;
+    return state / 4294967296;
+  };
+}
+
+const STATIONS = [
+  { id: 'autoref', serves: ['autorefraction'] },
+  { id: 'tono', serves: ['tonometry'] },
+  { id: 'oct', serves: ['oct'] },
+  { id: 'perimeter', serves: ['visual_field'] },
+  { id: 'room1', serves: ['doctor'], providerId: 'dr1' },
+  { id: 'room2', serves: ['doctor'], providerId: 'dr2' }
+];
+
+const DURATIONS = {
+  autorefraction: [3, 7],
+  tonometry: [3, 6],
+  oct: [8, 14],
+  visual_field: [12, 20],
+  doctor: [8, 14]
+};
+
+/**
+ * A clinic morning as recorded: arrivals from 08:00, each patient's
+ * stations in the order they went through them and how long each took
+ */
+function historicalDay(seed, patients = 45) {
+  const next = random(seed);
+  const between = (min, max) => min + next() * (max - min);
+
+  let arrival = 8 * 60;
+  const visits = [];
+  for (let i = 0; i < patients; i++) {
+    arrival += between(2, 6);
+    const pick = next();
+    const route = pick < 0.55 ? ['autorefraction', 'tonometry', 'doctor']
+      : pick < 0.75 ? ['autorefraction', 'tonometry', 'oct', 'doctor']
+        : pick < 0.9 ? ['tonometry', 'visual_field', 'doctor']
+          : ['autorefraction', 'doctor'];
+    visits.push({
+      id: `v${i}`,
+      priority: next() < 0.08 ? 'urgent' : 'normal',
+      arrivedAt: arrival,
+      providerId: next() < 0.5 ? 'dr1' : 'dr2',
+      remaining: route.map(station => ({ station, minutes: Math.round(between(...DURATIONS[station])) }))
+    });
+  }
+  return { stations: STATIONS, visits, transferMinutes: 1 };
+}
+
+describe('Patient flow router', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('stations and durations', () => {
+    test('should map rooms to the stations they serve', () => {
+      expect(roomServes({ type: 'examination', features: ['autorefractor', 'tonometer'] })).toEqual(['autorefraction', 'tonometry']);
+      expect(roomServes({ type: 'imaging', features: ['oct', 'exam_chair'] })).toEqual(['oct']);
+      // The doctor's own slit lamp room is a consultation, not a pre-test station
+      expect(roomServes({ type: 'ophthalmology', features: ['slit_lamp', 'tonometer'], assignedProviders: ['dr1'] })).toEqual(['doctor']);
+      expect(roomServes({ type: 'waiting', features: [] })).toEqual([]);
+    });
+
+    test('should predict station time from history, with defaults until enough samples', () => {
+      const model = buildDurationModel([
+        ...[6, 7, 8, 9, 10].map(minutes => ({ station: 'oct', minutes })),
+        { station: 'oct', minutes: 400 }, // left running, ignored
+        { station: 'tonometry', minutes: 3 }
+      ]);
+
+      expect(predictStationMinutes(model, 'oct')).toEqual({ minutes: 8, source: 'history' });
+      expect(predictStationMinutes(model, 'tonometry')).toEqual({ minutes: 5, source: 'default' });
+    });
+  });
+
+  describe('recommend', () => {
+    test('should give each free station one patient, and the doctor only patients done with pre-tests', () => {
+      const { assignments } = recommend({
+        now: 0,
+        stations: [
+          { id: 'autoref', serves: ['autorefraction'] },
+          { id: 'tono', serves: ['tonometry'] },
+          { id: 'room1', serves: ['doctor'] }
+        ],
+        visits: [
+          { id: 'a', arrivedAt: -20, remaining: [{ station: 'autorefraction', minutes: 5 }, { station: 'doctor', minutes: 12 }] },
+          { id: 'b', arrivedAt: -15, remaining: [{ station: 'tonometry', minutes: 5 }, { station: 'doctor', minutes: 12 }] },
+          { id: 'c', arrivedAt: -10, remaining: [{ station: 'doctor', minutes: 12 }] }
+        ]
+      });
+
+      expect(assignments.map(a => `${a.stationId}:${a.visitId}`).sort()).toEqual(['autoref:a', 'room1:c', 'tono:b']);
+    });
+
+    test('should keep a patient for the doctor of their appointment', () => {
+      const { assignments } = recommend({
+        now: 0,
+        stations: [
+          { id: 'room1', serves: ['doctor'], providerId: 'dr1' },
+          { id: 'room2', serves: ['doctor'], providerId: 'dr2', freeAt: 30 }
+        ],
+        visits: [
+          { id: 'early', arrivedAt: -40, providerId: 'dr2', remaining: [{ station: 'doctor', minutes: 10 }] },
+          { id: 'late', arrivedAt: -5, providerId: 'dr1', remaining: [{ station: 'doctor', minutes: 10 }] }
+        ]
+      });
+
+      expect(assignments).toEqual([{ stationId: 'room1', visitId: 'late', station: 'doctor', minutes: 10 }]);
+    });
+
+    test('should send the patient who feeds an idle doctor before the longest waiter', () => {
+      const input = {
+        now: 0,
+        stations: [
+          { id: 'tono', serves: ['tonometry'] },
+          { id: 'perimeter', serves: ['visual_field'], freeAt: 20 },
+          { id: 'room1', serves: ['doctor'] }
+        ],
+        visits: [
+          { id: 'long', arrivedAt: -10, remaining: [{ station: 'tonometry', minutes: 5 }, { station: 'visual_field', minutes: 15 }, { station: 'doctor', minutes: 15 }] },
+          { id: 'short', arrivedAt: -8, remaining: [{ station: 'tonometry', minutes: 5 }, { station: 'doctor', minutes: 15 }] }
+        ]
+      };
+
+      // The queue order calls the longest waiter...
+      const queue = run(createState(input), greedyPick);
+      expect(queue.assignments[0].visitId).toBe('long');
+
+      // ...the router sends the patient who can see the doctor next
+      const { assignments, forecast } = recommend(input);
+      expect(assignments).toEqual([{ stationId: 'tono', visitId: 'short', station: 'tonometry', minutes: 5 }]);
+      expect(forecast.meanVisitMinutes).toBeLessThan(summarize(queue).meanVisitMinutes);
+    });
+
+    test('should report stations no room can serve and route the rest', () => {
+      const { assignments, unroutable } = recommend({
+        now: 0,
+        stations: [{ id: 'room1', serves: ['doctor'] }],
+        visits: [{ id: 'a', arrivedAt: 0, remaining: [{ station: 'oct', minutes: 10 }, { station: 'doctor', minutes: 10 }] }]
+      });
+
+      expect(unroutable).toEqual([{ visitId: 'a', station: 'oct' }]);
+      expect(assignments[0]).toMatchObject({ visitId: 'a', station: 'doctor' });
+    });
+  });
+
+  describe('dispatch', () => {
+    test('should mark only the assigned station, leaving concurrent station edits intact', () => {
+      const now = new Date();
+      const appointment = {
+        _id: 'apt1',
+        type: 'consultation',
+        flow: { stations: [{ station: 'tonometry', status: 'pending' }, { station: 'doctor', status: 'pending' }] }
+      };
+
+      const [filter, update, options] = assignmentUpdate(appointment, 'tonometry', 'room1', now);
+
+      expect(filter['flow.stations']).toEqual({ $elemMatch: { status: 'pending', station: 'tonometry' } });
+      expect(filter['flow.assignedRoom']).toBeNull();
+      expect(update.$set['flow.stations']).toBeUndefined();
+      expect(update.$set['flow.stations.$[entry].status']).toBe('assigned');
+      expect(options.arrayFilters).toEqual([{ 'entry.status': 'pending', 'entry.station': 'tonometry' }]);
+    });
+
+    test('should store a derived route only if none was stored meanwhile', () => {
+      const [filter, update] = assignmentUpdate({ _id: 'apt1', type: 'consultation' }, 'doctor', 'room1', new Date());
+
+      expect(filter['flow.stations.0']).toEqual({ $exists: false });
+      expect(update.$set['flow.stations'].filter(entry => entry.status === 'assigned')).toHaveLength(1);
+    });
+  });
+
+  describe('on the database', () => {
+    let clinic;
+
+    // One tonometry room, no consulting room: only tonometry gets dispatched
+    async function tonometryRoom() {
+      return Room.create({ clinic, roomNumber: 'T1', name: 'Tonométrie', type: 'examination', features: ['tonometer'] });
+    }
+
+    async function checkedIn(minutesAgo, overrides = {}) {
+      return Appointment.create({
+        patient: new mongoose.Types.ObjectId(),
+        provider: new mongoose.Types.ObjectId(),
+        clinic,
+        date: new Date(),
+        startTime: '08:00',
+        endTime: '08:30',
+        type: 'follow-up',
+        department: 'ophthalmology',
+        reason: 'Contrôle',
+        status: 'checked-in',
+        checkInTime: new Date(Date.now() - minutesAgo * 60 * 1000),
+        ...overrides
+      });
+    }
+
+    beforeEach(() => {
+      // Own clinic per test: the duration model is cached per clinic
+      clinic = new mongoose.Types.ObjectId();
+    });
+
+    test('should reserve a room for one patient when two dispatches race', async () => {
+      const room = await tonometryRoom();
+      await checkedIn(20);
+      await checkedIn(10);
+
+      const results = await Promise.all([dispatch(clinic), dispatch(clinic)]);
+
+      expect(results.flat()).toHaveLength(1);
+      const assigned = await Appointment.find({ clinic, 'flow.assignedRoom': room._id }).lean();
+      expect(assigned).toHaveLength(1);
+      expect(assigned[0].flow.stations.filter(entry => entry.status === 'assigned')).toHaveLength(1);
+      const reserved = await Room.findById(room._id).lean();
+      expect(reserved.status).toBe('reserved');
+      expect(String(reserved.currentAppointment)).toBe(String(assigned[0]._id));
+    });
+
+    test('should put back a patient who never reached the reserved room', async () => {
+      const room = await tonometryRoom();
+      const appointment = await checkedIn(20);
+
+      const [assignment] = await dispatch(clinic, new Date(Date.now() - 10 * 60 * 1000));
+      expect(assignment).toMatchObject({ appointmentId: String(appointment._id), station: 'tonometry' });
+
+      expect(await releaseExpiredAssignments(clinic)).toBe(1);
+
+      const released = await Appointment.findById(appointment._id).lean();
+      expect(released.flow.assignedRoom).toBeNull();
+      expect(released.flow.stations.map(entry => entry.status)).toEqual(['pending', 'pending']);
+      expect((await Room.findById(room._id).lean()).status).toBe('available');
+      expect(await releaseExpiredAssignments(clinic)).toBe(0);
+    });
+
+    test('should free the room at completion and dispatch the next patient to it', async () => {
+      const room = await tonometryRoom();
+      const first = await checkedIn(20);
+      const second = await checkedIn(10);
+
+      const [assignment] = await dispatch(clinic);
+      expect(assignment.appointmentId).toBe(String(first._id));
+
+      // Someone else cannot take the reserved room
+      expect((await startStation(second._id, room._id)).status).toBe('room-busy');
+      expect((await startStation(first._id, room._id)).status).toBe('started');
+      expect((await Room.findById(room._id).lean()).status).toBe('occupied');
+
+      const completed = await completeStation(first._id);
+
+      expect(completed).toMatchObject({ status: 'completed', station: 'tonometry', remaining: ['doctor'] });
+      expect(completed.dispatched.map(next => next.appointmentId)).toEqual([String(second._id)]);
+      const done = await Appointment.findById(first._id).lean();
+      expect(done.flow.stations.map(entry => entry.status)).toEqual(['done', 'pending']);
+      const reserved = await Room.findById(room._id).lean();
+      expect(reserved.status).toBe('reserved');
+      expect(String(reserved.currentAppointment)).toBe(String(second._id));
+    });
+
+    test('should drop the assignment when the doctor removes the station mid-dispatch', async () => {
+      const room = await tonometryRoom();
+      const appointment = await checkedIn(20, {
+        flow: { stations: [{ station: 'tonometry', status: 'pending' }, { station: 'doctor', status: 'pending' }] }
+      });
+
+      // Room reserved, then the station list changes before the assignment is written
+      const updateOne = Appointment.updateOne.bind(Appointment);
+      jest.spyOn(Appointment, 'updateOne').mockImplementationOnce(async (...args) => {
+        await updateStations(appointment._id, ['doctor']);
+        return updateOne(...args);
+      });
+
+      expect(await dispatch(clinic)).toEqual([]);
+
+      const after = await Appointment.findById(appointment._id).lean();
+      expect(after.flow.stations).toEqual([{ station: 'doctor', status: 'pending' }]);
+      expect(after.flow.assignedRoom).toBeNull();
+      const released = await Room.findById(room._id).lean();
+      expect(released.status).toBe('available');
+      expect(released.currentAppointment).toBeNull();
+    });
+
+    test('should keep a station the doctor adds mid-dispatch', async () => {
+      const room = await tonometryRoom();
+      const appointment = await checkedIn(20, {
+        flow: { stations: [{ station: 'tonometry', status: 'pending' }, { station: 'doctor', status: 'pending' }] }
+      });
+
+      const updateOne = Appointment.updateOne.bind(Appointment);
+      jest.spyOn(Appointment, 'updateOne').mockImplementationOnce(async (...args) => {
+        await updateStations(appointment._id, ['tonometry', 'visual_field', 'doctor']);
+        return updateOne(...args);
+      });
+
+      expect(await dispatch(clinic)).toHaveLength(1);
+
+      const after = await Appointment.findById(appointment._id).lean();
+      expect(after.flow.stations.map(entry => `${entry.station}:${entry.status}`))
+        .toEqual(['tonometry:assigned', 'visual_field:pending', 'doctor:pending']);
+      expect(String(after.flow.assignedRoom)).toBe(String(room._id));
+    });
+  });
+
+  describe('historical day replay', () => {
+    const days = [1, 2, 3, 4, 5].map(seed => historicalDay(seed));
+
+    test('should shorten visits and doctor idle time against the linear queues', () => {
+      let linearTotal = 0;
+      let routerTotal = 0;
+
+      for (const day of days) {
+        const linear = replayDay(day, 'linear');
+        const router = replayDay(day, 'router');
+
+        expect(linear.unfinished).toBe(0);
+        expect(router.unfinished).toBe(0);
+        expect(router.meanVisitMinutes).toBeLessThan(linear.meanVisitMinutes);
+        expect(router.doctorIdleMinutes).toBeLessThanOrEqual(linear.doctorIdleMinutes);
+
+        linearTotal += linear.meanVisitMinutes;
+        routerTotal += router.meanVisitMinutes;
+      }
+
+      // Same rooms, same patients: at least 5% shorter visits on average
+      expect(routerTotal).toBeLessThan(linearTotal * 0.95);
+    });
+
+    test('should never double-book a station or a patient, and keep the doctor last', () => {
+      for (const day of days) {
+        const { assignments } = replayDay(day, 'router');
+
+        for (const key of ['stationId', 'visitId']) {
+          const byOwner = new Map();
+          for (const assignment of assignments) {
+            if (!byOwner.has(assignment[key])) byOwner.set(assignment[key], []);
+            byOwner.get(assignment[key]).push(assignment);
+          }
+          for (const list of byOwner.values()) {
+            list.sort((a, b) => a.start - b.start);
+            for (let i = 1; i < list.length; i++) expect(list[i].start).toBeGreaterThanOrEqual(list[i - 1].end);
+          }
+        }
+
+        const visits = new Map(day.visits.map(visit => [visit.id, visit]));
+        for (const [visitId, visit] of visits) {
+          const own = assignments.filter(a => a.visitId === visitId);
+          const doctor = own.find(a => a.station === 'doctor');
+          expect(own).toHaveLength(visit.remaining.length);
+          expect(own.every(a => a.station === 'doctor' || a.end <= doctor.start)).toBe(true);
+          expect(assignments.find(a => a.visitId === visitId && a.station === 'doctor').stationId)
+            .toBe(visit.providerId === 'dr1' ? 'room1' : 'room2');
+        }
+      }
+    });
+
+    test('should recommend for a full waiting room within a screen refresh', () => {
+      const day = historicalDay(7, 60);
+      const started = Date.now();
+      const { assignments } = recommend({
+        now: 8 * 60 + 30,
+        stations: STATIONS,
+        visits: day.visits.map(visit => ({ ...visit, arrivedAt: Math.min(visit.arrivedAt, 8 * 60 + 30) }))
+      });
+
+      expect(assignments).toHaveLength(4); // pre-test rooms; no one is ready for the doctor yet
+      expect(Date.now() - started).toBeLessThan(500);
+    });
+  });
+});
@@ -0,0 +1,204 @@
+/**
+ * Document Signing Tests
+ *
+ * Tests for batch signing and offline QR verification:
+ * - Merkle inclusion proofs for every leaf across batch sizes
+ * - One Ed25519 signature covering a whole signing session
+ * - Tamper detection (claims, proof, root, signature, key, revocation)
+ * - Prescriptions signed in one batch and verified from stored state
+ * - HSM emulator key store keeping private keys out of MongoDB
+ */
+
+const crypto = require('crypto');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const Prescription = require('../../../models/Prescription');
+const Patient = require('../../../models/Patient');
+const User = require('../../../models/User');
+const SigningKey = require('../../../models/SigningKey');
+const SignatureBatch = require('../../../models/SignatureBatch');
+const {
+  DocumentSigningService,
+  HsmEmulatorKeyStore
+} = require('../../../services/documentSigningService');
+const sig = require('../../../utils/documentSignature');
+const { createTestPatient, createTestUser, createTestPrescription } = require('../../fixtures/generators');
+
+// Sign a batch of claim objects the way the service does, without a database
+function signClaims(claimsList, { keyId = 'k1', batchId = 'b1', signedAt = '2026-01-15T09:00:00.000Z' } = {}) {
+  const { publicKey, privateKey } = crypto.generateKeyPairSync('ed25519');
+  const digests = claimsList.map(sig.documentDigest);
+  const levels = sig.buildMerkleTree(digests);
+  const root = sig.merkleRoot(levels);
+  const signature = crypto.sign(null, sig.batchMessage({ keyId, batchId, signedAt, root }), privateKey);
+
+  return {
+    trusted: { [keyId]: { publicKey: sig.toB64url(sig.rawPublicKey(publicKey)) } },
+    payloads: claimsList.map((claims, index) => sig.encodeQrPayload({
+      claims, keyId, batchId, signedAt, root, signature, proof: sig.inclusionProof(levels, index)
+    }))
+  };
+}
+
+const rxClaims = i => ({ k: 'rx', id: `RX-${i}`, p: `patient-${i}`, m: [['Timolol 0.5%', null, 'drops', 1, 'drop', 2, 'day']] });
+
+// Re-encode a payload after editing its decoded body
+function tamper(payload, edit) {
+  const body = sig.decodeQrPayload(payload);
+  edit(body);
+  return sig.QR_PREFIX + sig.toB64url(Buffer.from(JSON.stringify(body)));
+}
+
+describe('Document Signing', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('documentSignature utility', () => {
+    test('should canonicalize independent of key order', () => {
+      expect(sig.canonicalize({ b: 1, a: [2, { d: undefined, c: 3 }] }))
+        .toBe(sig.canonicalize({ a: [2, { c: 3 }], b: 1 }));
+      expect(sig.canonicalize({ at: new Date('2026-01-01T00:00:00Z') })).toBe('{"at":"2026-01-01T00:00:00.000Z"}');
+    });
+
+    test('should prove every leaf for odd and even batch sizes', () => {
+      for (const size of [1, 2, 3, 7, 8, 33]) {
+        const digests = Array.from({ length: size }, (_, i) => sig.documentDigest(rxClaims(i)));
+        const levels = sig.buildMerkleTree(digests);
+        const root = sig.merkleRoot(levels);
+
+        digests.forEach((digest, index) => {
+          const proof = sig.inclusionProof(levels, index);
+          expect(proof.length).toBeLessThanOrEqual(Math.ceil(Math.log2(size)));
+          expect(sig.rootFromProof(digest, proof).equals(root)).toBe(true);
+        });
+      }
+    });
+
+    test('should verify every QR of a session signed once, offline', () => {
+      const { trusted, payloads } = signClaims(Array.from({ length: 25 }, (_, i) => rxClaims(i)));
+
+      const results = payloads.map(p => sig.verifyQrPayload(p, trusted));
+      expect(results.every(r => r.valid)).toBe(true);
+      expect(results[3].claims.id).toBe('RX-3');
+      expect(new Set(payloads.map(p => sig.decodeQrPayload(p).s)).size).toBe(1);
+    });
+
+    test('should detect tampering', () => {
+      const { trusted, payloads } = signClaims([rxClaims(1), rxClaims(2), rxClaims(3)]);
+      const [payload, other] = payloads;
+      const verify = p => sig.verifyQrPayload(p, trusted).reason;
+
+      expect(verify(tamper(payload, b => { b.c.m[0][0] = 'Timolol 5%'; }))).toBe('not-in-batch');
+      expect(verify(tamper(payload, b => { b.p = sig.decodeQrPayload(other).p; }))).toBe('not-in-batch');
+      expect(verify(tamper(payload, b => { b.t = '2026-01-16T09:00:00.000Z'; }))).toBe('bad-signature');
+      expect(verify(tamper(payload, b => { b.b = 'b2'; }))).toBe('bad-signature');
+
+      const forged = signClaims([{ ...rxClaims(1), m: [['Oxycodone']] }]);
+      expect(verify(forged.payloads[0])).toBe('bad-signature');
+      expect(verify('MF1:not-base64-json')).toBe('malformed');
+      expect(sig.verifyQrPayload(payload, {}).reason).toBe('unknown-key');
+    });
+
+    test('should reject signatures made at or after key revocation', () => {
+      const { trusted, payloads } = signClaims([rxClaims(1)]);
+      const revokedAfter = { k1: { ...trusted.k1, revokedAt: '2026-02-01T00:00:00.000Z' } };
+      const revokedBefore = { k1: { ...trusted.k1, revokedAt: '2026-01-01T00:00:00.000Z' } };
+
+      expect(sig.verifyQrPayload(payloads[0], revokedAfter).valid).toBe(true);
+      expect(sig.verifyQrPayload(payloads[0], revokedBefore).reason).toBe('key-revoked');
+    });
+
+    test('should verify a scanned QR in well under a millisecond', () => {
+      const { trusted, payloads } = signClaims(Array.from({ length: 64 }, (_, i) => rxClaims(i)));
+      sig.verifyQrPayload(payloads[0], trusted); // warm key cache
+
+      const start = process.hrtime.bigint();
+      for (const payload of payloads) sig.verifyQrPayload(payload, trusted);
+      const perVerifyMs = Number(process.hrtime.bigint() - start) / 1e6 / payloads.length;
+
+      expect(perVerifyMs).toBeLessThan(1);
+    });
+  });
+
+  describe('DocumentSigningService', () => {
+    let prescriber;
+    let patient;
+    let service;
+
+    beforeEach(async () => {
+      prescriber = await User.create(createTestUser({ role: 'doctor' }));
+      patient = await Patient.create(createTestPatient());
+      service = new DocumentSigningService();
+    });
+
+    const createPrescriptions = count => Prescription.create(Array.from({ length: count }, (_, i) =>
+      createTestPrescription(patient._id, prescriber._id, {
+        medications: [{ name: `Drug ${i}`, strength: '0.5%', form: 'drops', quantity: 1 }]
+      })
+    ));
+
+    test('should sign a session of prescriptions with one signature', async () => {
+      const prescriptions = await createPrescriptions(5);
+
+      const { batch } = await service.signPrescriptions(prescriber._id, prescriptions);
+
+      expect(await SignatureBatch.countDocuments()).toBe(1);
+      expect(await SigningKey.countDocuments({ owner: prescriber._id })).toBe(1);
+
+      const stored = await Prescription.find({ _id: { $in: prescriptions.map(p => p._id) } });
+      expect(stored.every(p => p.signature.prescriber.signed)).toBe(true);
+      expect(new Set(stored.map(p => p.signature.prescriber.digital.signature)).size).toBe(1);
+      expect(stored[0].signature.prescriber.digital.batch).toBe(batch.batchId);
+
+      const trust = await service.getTrustList();
+      for (const rx of stored) {
+        const result = service.verifyQr(service.qrPayloadFor('prescription', rx), trust.keys);
+        expect(result).toMatchObject({ valid: true, claims: { id: rx.prescriptionId } });
+      }
+    });
+
+    test('should report edits made after signing', async () => {
+      const [prescription] = await createPrescriptions(1);
+      await service.signPrescriptions(prescriber._id, [prescription]);
+
+      const stored = await Prescription.findById(prescription._id);
+      expect(await service.verifyStoredSignature('prescription', stored)).toEqual({
+        signed: true, valid: true, reason: undefined
+      });
+
+      stored.medications[0].quantity = 10;
+      expect(await service.verifyStoredSignature('prescription', stored)).toMatchObject({
+        valid: false, reason: 'not-in-batch'
+      });
+    });
+
+    test('should stop verifying documents signed after a key revocation', async () => {
+      const [prescription] = await createPrescriptions(1);
+      const { batch } = await service.signPrescriptions(prescriber._id, [prescription]);
+
+      await service.revokeKey(batch.keyId, 'compromised', new Date(batch.signedAt.getTime() - 1000));
+
+      const stored = await Prescription.findById(prescription._id);
+      expect(await service.verifyStoredSignature('prescription', stored)).toMatchObject({
+        valid: false, reason: 'key-revoked'
+      });
+    });
+
+    test('should keep HSM emulator private keys out of the database', async () => {
+      const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'medflow-hsm-'));
+      const hsmService = new DocumentSigningService(new HsmEmulatorKeyStore(dir));
+      const prescriptions = await createPrescriptions(2);
+
+      const { batch } = await hsmService.signPrescriptions(prescriber._id, prescriptions);
+
+      const key = await SigningKey.findOne({ keyId: batch.keyId }).select('+encryptedPrivateKey');
+      expect(key.storage).toBe('hsm');
+      expect(key.encryptedPrivateKey).toBeUndefined();
+      expect(fs.statSync(path.join(dir, `${batch.keyId}.pem`)).mode & 0o777).toBe(0o600);
+
+      fs.rmSync(dir, { recursive: true, force: true });
+    });
+  });
+});
@@ -0,0 +1,345 @@
+/**
+ * Read Routing Tests
+ *
+ * - Replication lag and analytics members from replSetGetStatus/replSetGetConfig
+ * - Route per read class, with lag-aware fallback to the primary
+ * - Read class scoping for routes and services, explicit choices win
+ * - Causal sessions advanced past the user's last write
+ * - On a replica set: causal reads reach a secondary waiting for the user's
+ *   write, or fall back to the primary
+ */
+
+const mongoose = require('mongoose');
+const { MongoMemoryReplSet } = require('mongodb-memory-server');
+const {
+  ReadRoutingService,
+  parseTagSets,
+  loadSettings,
+  evaluateReplicaSet,
+  chooseRoute
+} = require('../../services/readRoutingService');
+
+const at = seconds => new Date(Date.UTC(2026, 9, 18, 9, 0, seconds));
+
+const STATUS = {
+  members: [
+    { name: 'db1:27017', stateStr: 'PRIMARY', health: 1, optimeDate: at(30) },
+    { name: 'db2:27017', stateStr: 'SECONDARY', health: 1, optimeDate: at(29) },
+    { name: 'db3:27017', stateStr: 'SECONDARY', health: 1, optimeDate: at(10) },
+    { name: 'db4:27017', stateStr: 'SECONDARY', health: 1, optimeDate: at(30) },
+    { name: 'db5:27017', stateStr: 'SECONDARY', health: 0, optimeDate: at(30) }
+  ]
+};
+const CONFIG = {
+  config: {
+    members: [
+      { host: 'db1:27017' },
+      { host: 'db2:27017' },
+      { host: 'db3:27017', priority: 0, tags: { workload: 'analytics' } },
+      { host: 'db4:27017', priority: 0, hidden: true }
+    ]
+  }
+};
+
+const settings = loadSettings({});
+
+// Minimal Query/Aggregate double recording what routing applied
+function fakeQuery(options = {}) {
+  return {
+    options,
+    applied: {},
+    read(pref) { this.applied.readPreference = pref; return this; },
+    session(session) { this.applied.session = session; return this; },
+    readConcern(level) { this.applied.readConcern = level; return this; }
+  };
+}
+
+function fakeMongoose(clusterTime) {
+  const sessions = [];
+  return {
+    sessions,
+    mongo: {
+      ReadPreference: class {
+        constructor(mode, tags, options) {
+          Object.assign(this, { mode, tags }, options);
+        }
+      }
+    },
+    connection: {
+      getClient: () => ({
+        topology: { clusterTime },
+        startSession(options) {
+          const session = {
+            options,
+            advanced: [],
+            advanceClusterTime(time) { this.advanced.push(['cluster', time]); },
+            advanceOperationTime(time) { this.advanced.push(['operation', time]); },
+            ended: false,
+            endSession() { this.ended = true; return Promise.resolve(); }
+          };
+          sessions.push(session);
+          return session;
+        }
+      })
+    }
+  };
+}
+
+// Runs the middleware chain; resolves once the handler has run
+const handle = (middlewares, req, res, handler) => new Promise((resolve, reject) => {
+  const next = (i) => () => {
+    try {
+      if (i === middlewares.length) return resolve(handler());
+      middlewares[i](req, res, next(i + 1));
+    } catch (error) {
+      reject(error);
+    }
+  };
+  next(0)();
+});
+
+const fakeRes = () => {
+  const listeners = [];
+  return { listeners, once: (event, listener) => listeners.push(listener) };
+};
+
+describe('Read routing', () => {
+  describe('configuration', () => {
+    test('should parse analytics tag sets', () => {
+      expect(parseTagSets('workload:analytics,dc:kin;workload:reporting')).toEqual([
+        { workload: 'analytics', dc: 'kin' },
+        { workload: 'reporting' }
+      ]);
+      expect(parseTagSets('')).toEqual([]);
+      expect(settings.analyticsTags).toEqual([{ workload: 'analytics' }]);
+      expect(loadSettings({ READ_ROUTING_ENABLED: 'false' }).enabled).toBe(false);
+    });
+  });
+
+  describe('evaluateReplicaSet', () => {
+    test('should measure lag of readable secondaries and find analytics members', () => {
+      const health = evaluateReplicaSet(STATUS, CONFIG, settings.analyticsTags);
+
+      // Hidden and unhealthy members cannot serve reads
+      expect(health.secondaries.map(m => m.name)).toEqual(['db2:27017', 'db3:27017']);
+      expect(health.secondaryLagMs).toBe(1000);
+      expect(health.analyticsTagged).toBe(true);
+      expect(health.analyticsLagMs).toBe(20000);
+    });
+
+    test('should use any secondary for analytics when none is tagged', () => {
+      const health = evaluateReplicaSet(STATUS, null, settings.analyticsTags);
+
+      expect(health.analyticsTagged).toBe(false);
+      expect(health.analyticsLagMs).toBe(0);
+    });
+  });
+
+  describe('chooseRoute', () => {
+    test('should route each class and fall back to the primary past its lag budget', () => {
+      const health = evaluateReplicaSet(STATUS, CONFIG, settings.analyticsTags);
+
+      expect(chooseRoute('strong', health, settings)).toBeNull();
+      expect(chooseRoute('causal', health, settings)).toMatchObject({ mode: 'secondaryPreferred', readConcern: 'majority' });
+      expect(chooseRoute('analytics', health, settings)).toMatchObject({
+        mode: 'secondaryPreferred',
+        tags: [{ workload: 'analytics' }, {}],
+        maxStalenessSeconds: 90
+      });
+
+      expect(chooseRoute('causal', { ...health, secondaryLagMs: 5000 }, settings)).toBeNull();
+      expect(chooseRoute('analytics', { ...health, analyticsLagMs: 120000 }, settings)).toBeNull();
+      expect(chooseRoute('analytics', { standalone: true }, settings)).toBeNull();
+      // Not sampled yet: the driver's staleness bound applies
+      expect(chooseRoute('analytics', null, settings)).not.toBeNull();
+    });
+  });
+
+  describe('ReadRoutingService', () => {
+    let routing;
+    let mongooseDouble;
+    const clusterTime = { clusterTime: { t: 1760778000, i: 4 }, signature: {} };
+
+    beforeEach(() => {
+      routing = new ReadRoutingService(loadSettings({}));
+      mongooseDouble = fakeMongoose(clusterTime);
+      routing.mongoose = mongooseDouble;
+      routing.health = evaluateReplicaSet(STATUS, CONFIG, routing.settings.analyticsTags);
+    });
+
+    test('should leave reads outside a declared class on the primary', () => {
+      const query = fakeQuery();
+      routing.applyRead(query, query.options);
+
+      expect(query.applied).toEqual({});
+    });
+
+    test('should route analytics reads of a wrapped service without a session', async () => {
+      const query = fakeQuery();
+      const report = routing.wrap('analytics', async (id) => {
+        routing.applyRead(query, query.options);
+        return { id, readClass: routing.currentClass() };
+      });
+
+      await expect(report('s1')).resolves.toEqual({ id: 's1', readClass: 'analytics' });
+      expect(query.applied.readPreference.mode).toBe('secondaryPreferred');
+      expect(query.applied.readPreference.tags).toEqual([{ workload: 'analytics' }, {}]);
+      expect(query.applied.session).toBeUndefined();
+      expect(routing.currentClass()).toBe('strong');
+    });
+
+    test('should keep explicit read preferences and sessions', async () => {
+      const explicit = fakeQuery({ readPreference: 'primary' });
+      const inTransaction = fakeQuery({ session: {} });
+
+      await routing.run('analytics', async () => {
+        routing.applyRead(explicit, explicit.options);
+        routing.applyRead(inTransaction, inTransaction.options);
+      });
+
+      expect(explicit.applied).toEqual({});
+      expect(inTransaction.applied).toEqual({});
+    });
+
+    test("should advance causal sessions past the user's last write", async () => {
+      const req = { method: 'GET', user: { _id: 'u1' } };
+      const res = fakeRes();
+      const first = fakeQuery();
+      const second = fakeQuery();
+
+      // An earlier request of the same user wrote
+      await handle([routing.middleware()], req, fakeRes(), () => routing.noteWrite());
+
+      await handle([routing.middleware(), routing.readClass('causal')], req, res, () => {
+        routing.applyRead(first, first.options);
+        routing.applyRead(second, second.options);
+      });
+
+      expect(mongooseDouble.sessions).toHaveLength(1);
+      const [session] = mongooseDouble.sessions;
+      expect(session.options).toEqual({ causalConsistency: true });
+      expect(session.advanced).toEqual([['cluster', clusterTime], ['operation', clusterTime.clusterTime]]);
+      expect(first.applied.session).toBe(session);
+      expect(second.applied.session).toBe(session);
+      expect(first.applied.readConcern).toBe('majority');
+
+      // The session ends with the response
+      res.listeners.forEach(listener => listener());
+      expect(session.ended).toBe(true);
+    });
+
+    test('should not route mutating requests', async () => {
+      const req = { method: 'POST', user: { _id: 'u1' } };
+      const query = fakeQuery();
+
+      const readClass = await handle([routing.middleware(), routing.readClass('causal')], req, fakeRes(), () => {
+        routing.applyRead(query, query.options);
+        return routing.currentClass();
+      });
+
+      expect(query.applied).toEqual({});
+      expect(readClass).toBe('strong');
+    });
+    test('should fall back to the primary when secondaries lag', async () => {
+      routing.health = { ...routing.health, secondaryLagMs: 30000, analyticsLagMs: 300000 };
+      const query = fakeQuery();
+
+      await routing.run('analytics', async () => routing.applyRead(query, query.options));
+
+      expect(query.applied).toEqual({});
+      expect(routing.getStatus().counters.fallbacks).toBe(1);
+      expect(routing.getStatus().routes).toEqual({ causal: 'primary', analytics: 'primary' });
+    });
+  });
+
+  describe('on a replica set', () => {
+    let replSet;
+    let instance;
+    let routing;
+    let Note;
+    let primary;
+    const commands = [];
+    const req = { method: 'GET', user: { _id: 'u1' } };
+
+    // Own Mongoose instance: the hooks must be installed before the model is compiled
+    beforeAll(async () => {
+      jest.useRealTimers();
+      replSet = await MongoMemoryReplSet.create({ replSet: { count: 3 } });
+      instance = new mongoose.Mongoose();
+      routing = new ReadRoutingService(loadSettings({}));
+      routing.install(instance);
+      Note = instance.model('RoutingNote', new instance.Schema({ owner: String, text: String }));
+      await instance.connect(replSet.getUri(), { monitorCommands: true });
+      instance.connection.getClient().on('commandStarted', event => commands.push(event));
+
+      routing.start(instance.connection);
+      routing.stop();
+      // Secondaries finish their initial sync after the primary is elected
+      for (let attempt = 0; attempt < 60; attempt++) {
+        const health = await routing.sample();
+        if (health && health.secondaries.length === 2) break;
+        await new Promise(resolve => setTimeout(resolve, 500));
+      }
+      const status = await instance.connection.db.admin().command({ replSetGetStatus: 1 });
+      primary = status.members.find(member => member.stateStr === 'PRIMARY').name;
+    }, 120000);
+
+    afterAll(async () => {
+      await instance.disconnect();
+      await replSet.stop();
+    });
+
+    const write = (text) => handle([routing.middleware()], req, fakeRes(), () => Note.create({ owner: 'u1', text }));
+
+    async function causalRead(text) {
+      const res = fakeRes();
+      commands.length = 0;
+      const found = await handle([routing.middleware(), routing.readClass('causal')], req, res, () =>
+        Note.findOne({ owner: 'u1', text }).lean());
+      res.listeners.forEach(listener => listener());
+      const find = commands.find(event => event.commandName === 'find' && event.command.find === Note.collection.name);
+      return { found, find };
+    }
+
+    test("should read the user's own writes from a secondary waiting for them", async () => {
+      expect(routing.getStatus().routes.causal).toBe('secondaryPreferred');
+
+      for (let round = 0; round < 20; round++) {
+        await write(`note-${round}`);
+        const watermark = routing.watermarks.get('u1').clusterTime.clusterTime;
+
+        const { found, find } = await causalRead(`note-${round}`);
+
+        expect(found).toMatchObject({ text: `note-${round}` });
+        expect(find.address).not.toBe(primary);
+        // The secondary answers only once it has applied the write
+        expect(find.command.readConcern.level).toBe('majority');
+        expect(find.command.readConcern.afterClusterTime.compare(watermark)).toBeGreaterThanOrEqual(0);
+      }
+    });
+
+    test('should read from the primary when the secondaries lag', async () => {
+      const sampled = routing.health;
+      routing.health = { ...sampled, secondaryLagMs: routing.settings.causalMaxLagMs + 1000 };
+      try {
+        await write('lagging');
+        const { found, find } = await causalRead('lagging');
+
+        expect(found).toMatchObject({ text: 'lagging' });
+        expect(find.address).toBe(primary);
+        expect(find.command.readConcern).toBeUndefined();
+      } finally {
+        routing.health = sampled;
+      }
+    });
+
+    test('should keep causal reads on the primary of a standalone server', async () => {
+      const standalone = new ReadRoutingService(loadSettings({}));
+      standalone.start(mongoose.connection);
+      standalone.stop();
+
+      expect(await standalone.sample()).toMatchObject({ standalone: true });
+      expect(standalone.getStatus().routes).toEqual({ causal: 'primary', analytics: 'primary' });
+    });
+  });
+});
@@ -0,0 +1,377 @@
+/**
+ * Portal Slot Hold Tests
+ *
+ * - Grid cells of a slot: overlapping slots of a provider share a cell
+ * - Many portal users competing for the same slots: one booking per slot,
+ *   never two overlapping appointments (check-then-create double-books)
+ * - Portal holds against staff bookings racing for the same time
+ * - Expiry: an expired hold is taken over and can no longer be converted
+ * - Slot already booked, one hold per patient, release, available slots
+ * - The same race and takeover on MongoDB: unique index on the cell key,
+ *   duplicate-key insert, conditional takeover
+ */
+
+const mongoose = require('mongoose');
+const SlotHold = require('../../models/SlotHold');
+const Appointment = require('../../models/Appointment');
+const {
+  SlotHolds,
+  loadSettings,
+  cellsFor,
+  overlapsAppointment
+} = require('../../services/slotHoldService');
+
+const PROVIDER = 'provider-1';
+
+const tick = () => new Promise(resolve => setImmediate(resolve));
+
+// Deterministic interleaving of the simulated users
+function random(seed) {
+  let state = seed;
+  return () => {
+    state = (state * 1664525 + 1013904223) % 4294967296;
+    return state / 4294967296;
+  };
+}
+
+function tomorrow() {
+  const date = new Date();
+  date.setDate(date.getDate() + 1);
+  date.setHours(0, 0, 0, 0);
+  return date;
+}
+
+const portalSlot = (startTime, provider = PROVIDER) => {
+  const [hours, minutes] = startTime.split(':').map(Number);
+  const end = hours * 60 + minutes + 30;
+  return {
+    provider,
+    date: tomorrow(),
+    startTime,
+    endTime: `${String(Math.floor(end / 60)).padStart(2, '0')}:${String(end % 60).padStart(2, '0')}`
+  };
+};
+
+/**
+ * In-memory store with the same semantics as the MongoDB one: a unique key
+ * per cell, insert then conditional takeover. Every call yields first (and
+ * between the two steps of a claim), so concurrent callers interleave.
+ */
+function memoryStore(jitter = () => 0) {
+  const cells = new Map();
+  const appointments = [];
+  const pause = async () => {
+    await tick();
+    for (let i = Math.floor(jitter() * 3); i > 0; i--) await tick();
+  };
+
+  return {
+    cells,
+    appointments,
+    async claimCell(cell, now) {
+      await pause();
+      if (!cells.has(cell.key)) {
+        cells.set(cell.key, { ...cell });
+        return true;
+      }
+      await pause();
+      const current = cells.get(cell.key);
+      if (current && current.expiresAt > now && current.holder !== cell.holder) return false;
+      cells.set(cell.key, { ...cell });
+      return true;
+    },
+    async findHold(holdId) {
+      await pause();
+      return [...cells.values()].filter(cell => cell.holdId === holdId).map(cell => ({ ...cell }));
+    },
+    async extendHold(holdId, holder, now, expiresAt) {
+      await pause();
+      let extended = 0;
+      for (const cell of cells.values()) {
+        if (cell.holdId === holdId && cell.holder === holder && cell.expiresAt > now) {
+          cell.expiresAt = expiresAt;
+          extended++;
+        }
+      }
+      return extended;
+    },
+    async releaseHold(holdId, holder) {
+      await pause();
+      let released = 0;
+      for (const [key, cell] of cells) {
+        if (cell.holdId === holdId && cell.holder === holder) {
+          cells.delete(key);
+          released++;
+        }
+      }
+      return released;
+    },
+    async releaseOtherHolds(holder, holdId) {
+      await pause();
+      for (const [key, cell] of cells) {
+        if (cell.holder === holder && cell.holdId !== holdId && cell.purpose === 'hold') cells.delete(key);
+      }
+    },
+    async findActiveCells(provider, day, now) {
+      await pause();
+      return [...cells.values()].filter(cell => cell.provider === provider && cell.expiresAt > now);
+    },
+    async findAppointments(provider) {
+      await pause();
+      return appointments.filter(appointment => appointment.provider === provider);
+    },
+    async createAppointment(data) {
+      await pause();
+      const appointment = { _id: `apt-${appointments.length + 1}`, ...data };
+      appointments.push(appointment);
+      return appointment;
+    }
+  };
+}
+
+function service(store, overrides = {}, deps = {}) {
+  return new SlotHolds({ ...loadSettings({}), ...overrides }, { store, ...deps });
+}
+
+// Reception: lock the cells, check the provider's day, save, unlock
+async function staffBooking(holds, store, slot, userId) {
+  const lock = await holds.lock(slot, userId);
+  if (lock.status !== 'held') return lock;
+  try {
+    if (overlapsAppointment(await store.findAppointments(slot.provider), slot)) return { status: 'taken' };
+    return { status: 'booked', appointment: await store.createAppointment({ ...slot, source: 'phone' }) };
+  } finally {
+    await holds.unlock(lock, userId);
+  }
+}
+
+// 200 portal users, each trying up to three of the slots still shown to them
+function portalRace(holds, { times, next, patient, provider = PROVIDER }) {
+  const users = Array.from({ length: 200 }, (_, i) => async () => {
+    const outcome = { held: 0, taken: 0, booked: null };
+    for (let attempt = 0; attempt < 3 && !outcome.booked; attempt++) {
+      const slot = portalSlot(times[Math.floor(next() * times.length)], provider);
+      const hold = await holds.hold(slot, patient(i));
+      if (hold.status !== 'held') {
+        outcome.taken++;
+        continue;
+      }
+      outcome.held++;
+      await tick();
+      const result = await holds.convert(hold.hold.holdId, patient(i), { type: 'consultation', department: 'general', reason: 'Contrôle' });
+      if (result.status === 'booked') outcome.booked = result.appointment;
+    }
+    return outcome;
+  });
+  return Promise.all(users.map(user => user()));
+}
+
+function expectNoOverlap(appointments) {
+  for (let i = 0; i < appointments.length; i++) {
+    expect(overlapsAppointment(appointments.slice(i + 1).filter(other => other.provider === appointments[i].provider), appointments[i])).toBe(false);
+  }
+}
+
+describe('Portal slot holds', () => {
+  describe('grid cells', () => {
+    test('should cover every cell a slot overlaps, on the provider and day', () => {
+      const date = tomorrow();
+      const day = `${date.getFullYear()}-${String(date.getMonth() + 1).padStart(2, '0')}-${String(date.getDate()).padStart(2, '0')}`;
+
+      expect(cellsFor(portalSlot('09:00'), 30)).toEqual([{ key: `${PROVIDER}:${day}:09:00`, cellTime: '09:00' }]);
+      // A staff booking off the grid shares a cell with both portal slots it overlaps
+      expect(cellsFor({ ...portalSlot('09:15'), endTime: '09:45' }, 30).map(cell => cell.cellTime)).toEqual(['09:00', '09:30']);
+      expect(cellsFor({ provider: PROVIDER, date, startTime: '9:00' }, 30).map(cell => cell.cellTime)).toEqual(['09:00']);
+      expect(cellsFor({ date, startTime: '09:00' }, 30)).toEqual([]);
+    });
+  });
+
+  describe('competing portal users', () => {
+    test('should book each slot exactly once when many users pick the same slots', async () => {
+      const next = random(42);
+      const store = memoryStore(next);
+      const holds = service(store);
+      const times = ['09:00', '09:30', '10:00', '10:30', '11:00', '11:30', '14:00', '14:30', '15:00', '15:30'];
+
+      const outcomes = await portalRace(holds, { times, next, patient: i => `patient-${i}` });
+      const booked = outcomes.filter(outcome => outcome.booked).map(outcome => outcome.booked);
+
+      expect(booked).toHaveLength(times.length);
+      expect(store.appointments).toHaveLength(times.length);
+      expect(new Set(booked.map(appointment => appointment.startTime)).size).toBe(times.length);
+      expectNoOverlap(store.appointments);
+      // Every hold that was granted was for a free slot and led to its booking
+      expect(outcomes.reduce((sum, outcome) => sum + outcome.held, 0)).toBe(times.length);
+      expect(booked.every(appointment => appointment.status === 'confirmed' && appointment.confirmation.confirmed)).toBe(true);
+      expect(store.cells.size).toBe(0);
+      expect(holds.getStatus().counters).toMatchObject({ booked: times.length, held: times.length });
+    });
+
+    test('should double-book the same race without holds (check, then create)', async () => {
+      const store = memoryStore();
+      const slot = portalSlot('09:00');
+
+      await Promise.all(Array.from({ length: 20 }, async (_, i) => {
+        if (!overlapsAppointment(await store.findAppointments(PROVIDER), slot)) {
+          await store.createAppointment({ ...slot, patient: `patient-${i}` });
+        }
+      }));
+
+      expect(store.appointments.length).toBeGreaterThan(1);
+    });
+
+    test('should keep portal users and reception off each other\'s slot', async () => {
+      const next = random(7);
+      const store = memoryStore(next);
+      const holds = service(store);
+      const slot = portalSlot('10:00');
+      // Reception books 10:15-10:45 by phone: overlaps the 10:00 and 10:30 portal slots
+      const phoneSlot = { ...slot, startTime: '10:15', endTime: '10:45' };
+
+      const portal = Array.from({ length: 30 }, (_, i) => async () => {
+        const hold = await holds.hold(next() < 0.5 ? slot : portalSlot('10:30'), `patient-${i}`);
+        if (hold.status !== 'held') return hold;
+        return holds.convert(hold.hold.holdId, `patient-${i}`, { type: 'consultation' });
+      });
+      const staff = Array.from({ length: 5 }, (_, i) => () => staffBooking(holds, store, phoneSlot, `staff-${i}`));
+
+      const results = await Promise.all([...portal, ...staff].map(user => user()));
+
+      expect(results.filter(result => result.status === 'booked').length).toBeGreaterThanOrEqual(1);
+      expectNoOverlap(store.appointments);
+      expect(store.cells.size).toBe(0);
+    });
+
+    test('should refuse reception a slot a patient is holding', async () => {
+      const store = memoryStore();
+      const holds = service(store);
+
+      const hold = await holds.hold(portalSlot('11:00'), 'patient-1');
+      expect(await staffBooking(holds, store, { ...portalSlot('11:00'), startTime: '11:15', endTime: '11:30' }, 'staff-1')).toEqual({ status: 'taken' });
+      expect((await staffBooking(holds, store, portalSlot('11:30'), 'staff-1')).status).toBe('booked');
+
+      expect((await holds.convert(hold.hold.holdId, 'patient-1', {})).status).toBe('booked');
+      expectNoOverlap(store.appointments);
+    });
+  });
+
+  describe('expiry and release', () => {
+    test('should let another patient take an expired hold and refuse the late conversion', async () => {
+      let now = new Date();
+      const store = memoryStore();
+      const holds = service(store, { ttlMs: 5 * 60 * 1000 }, { now: () => now });
+
+      const first = await holds.hold(portalSlot('09:00'), 'patient-1');
+      expect((await holds.hold(portalSlot('09:00'), 'patient-2')).status).toBe('taken');
+
+      now = new Date(now.getTime() + 6 * 60 * 1000);
+      const second = await holds.hold(portalSlot('09:00'), 'patient-2');
+      expect(second.status).toBe('held');
+
+      expect(await holds.convert(first.hold.holdId, 'patient-1', {})).toEqual({ status: 'expired' });
+      expect((await holds.convert(second.hold.holdId, 'patient-2', {})).status).toBe('booked');
+      expect(store.appointments).toHaveLength(1);
+      expect(store.appointments[0].patient).toBe('patient-2');
+    });
+
+    test('should not convert a hold that expired without being taken over', async () => {
+      let now = new Date();
+      const store = memoryStore();
+      const holds = service(store, {}, { now: () => now });
+
+      const hold = await holds.hold(portalSlot('09:00'), 'patient-1');
+      now = new Date(now.getTime() + holds.settings.ttlMs + 1);
+
+      expect(await holds.convert(hold.hold.holdId, 'patient-1', {})).toEqual({ status: 'expired' });
+      expect(store.appointments).toHaveLength(0);
+      expect(store.cells.size).toBe(0);
+    });
+
+    test('should report a booked slot as taken without keeping a hold', async () => {
+      const store = memoryStore();
+      const holds = service(store);
+      await store.createAppointment({ ...portalSlot('09:00'), startTime: '08:45', endTime: '09:15', status: 'scheduled' });
+
+      expect(await holds.hold(portalSlot('09:00'), 'patient-1')).toEqual({ status: 'taken' });
+      expect(store.cells.size).toBe(0);
+    });
+
+    test('should keep one hold per patient and hide other patients\' holds from the slot list', async () => {
+      const store = memoryStore();
+      const holds = service(store);
+      const date = tomorrow();
+
+      const first = await holds.hold(portalSlot('09:00'), 'patient-1');
+      await holds.hold(portalSlot('10:00'), 'patient-1');
+      await holds.hold(portalSlot('11:00'), 'patient-2');
+
+      expect([...(await holds.heldTimes(PROVIDER, date, 'patient-1'))]).toEqual(['11:00']);
+      expect([...(await holds.heldTimes(PROVIDER, date, 'patient-3'))].sort()).toEqual(['10:00', '11:00']);
+      expect(await holds.convert(first.hold.holdId, 'patient-1', {})).toEqual({ status: 'expired' });
+
+      // Released on leaving the page: free for the next patient
+      const third = await holds.hold(portalSlot('09:30'), 'patient-3');
+      expect(await holds.release(third.hold.holdId, 'patient-2')).toBe(false);
+      expect(await holds.release(third.hold.holdId, 'patient-3')).toBe(true);
+      expect((await holds.hold(portalSlot('09:30'), 'patient-4')).status).toBe('held');
+    });
+  });
+
+  describe('MongoDB store', () => {
+    const TIMES = ['09:00', '09:30', '10:00', '10:30', '11:00', '11:30', '14:00', '14:30', '15:00', '15:30'];
+
+    // Default store: SlotHold and Appointment on the test database
+    const mongoService = (deps = {}) => new SlotHolds({ ...loadSettings({}) }, deps);
+
+    beforeAll(async () => {
+      // The race relies on the unique index: build it before any insert
+      await SlotHold.init();
+    });
+
+    test('should keep a unique index on the cell key', async () => {
+      const indexes = await SlotHold.collection.indexes();
+
+      expect(indexes.find(index => index.key.key === 1)).toMatchObject({ unique: true });
+    });
+
+    test('should book each slot exactly once when many users race on the database', async () => {
+      const provider = new mongoose.Types.ObjectId();
+      const patients = Array.from({ length: 200 }, () => new mongoose.Types.ObjectId());
+      const holds = mongoService();
+
+      const outcomes = await portalRace(holds, { times: TIMES, next: random(42), patient: i => patients[i], provider });
+      const appointments = await Appointment.find({ provider }).lean();
+
+      expect(outcomes.filter(outcome => outcome.booked)).toHaveLength(TIMES.length);
+      expect(appointments).toHaveLength(TIMES.length);
+      expect(new Set(appointments.map(appointment => appointment.startTime)).size).toBe(TIMES.length);
+      expectNoOverlap(appointments);
+      expect(outcomes.reduce((sum, outcome) => sum + outcome.held, 0)).toBe(TIMES.length);
+      expect(await SlotHold.countDocuments({ provider })).toBe(0);
+    });
+
+    test('should take over only an expired cell', async () => {
+      let now = new Date();
+      const provider = new mongoose.Types.ObjectId();
+      const [first, second] = [new mongoose.Types.ObjectId(), new mongoose.Types.ObjectId()];
+      const holds = mongoService({ now: () => now });
+      const slot = portalSlot('09:00', provider);
+
+      const held = await holds.hold(slot, first);
+      // Duplicate key, then the conditional takeover refuses a live hold
+      expect(await holds.hold(slot, second)).toEqual({ status: 'taken' });
+      expect(await SlotHold.countDocuments({ provider })).toBe(1);
+
+      now = new Date(now.getTime() + holds.settings.ttlMs + 1);
+      const takenOver = await holds.hold(slot, second);
+      expect(takenOver.status).toBe('held');
+
+      const details = { type: 'consultation', department: 'general', reason: 'Contrôle' };
+      expect(await holds.convert(held.hold.holdId, first, details)).toEqual({ status: 'expired' });
+      expect((await holds.convert(takenOver.hold.holdId, second, details)).status).toBe('booked');
+      const appointments = await Appointment.find({ provider }).lean();
+      expect(appointments).toHaveLength(1);
+      expect(appointments[0].patient.toString()).toBe(second.toString());
+    });
+  });
+});
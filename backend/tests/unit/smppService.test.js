@@ -0,0 +1,279 @@
+/**
+ * SMPP Channel Tests
+ *
+ * - PDU codec: submit_sm layout, data coding, message_payload, receipts
+ * - Message id correlation across hex/decimal receipt ids, one id form per SMSC
+ * - Windowed submits against a mock SMSC: window bound, receipts persisted
+ * - Throttling: negotiated rate held, ESME_RTHROTTLED resubmitted
+ * - Submits unanswered when the bind drops reported unknown, never sent twice
+ * - Rebind after the operator drops the connection; fail fast when unbound
+ * - Benchmark: bulk throughput vs the sequential 100 ms loop
+ */
+
+const {
+  SmppService,
+  TokenBucket,
+  loadSettings,
+  COMMAND,
+  encodePdu,
+  decodePdu,
+  submitSmBody,
+  decodeShortMessage,
+  encodeText,
+  parseReceipt,
+  receiptKey
+} = require('../../services/smppService');
+const { createMockSmsc } = require('../fixtures/mockSmsc');
+
+const wait = (ms) => new Promise(resolve => setTimeout(resolve, ms));
+
+async function until(condition, timeoutMs = 3000) {
+  const started = Date.now();
+  while (!condition()) {
+    if (Date.now() - started > timeoutMs) throw new Error('Timed out waiting for condition');
+    await wait(5);
+  }
+}
+
+function memoryStore() {
+  const records = new Map();
+  return {
+    records,
+    async write(batch) {
+      for (const record of batch) {
+        const current = records.get(record.messageId) || { status: 'submitted' };
+        if (record.type === 'submitted') records.set(record.messageId, { ...record, status: current.status });
+        else records.set(record.messageId, { ...current, status: record.status, error: record.error });
+      }
+    }
+  };
+}
+
+function channel(smsc, overrides = {}) {
+  const settings = {
+    ...loadSettings({ SMPP_HOST: '127.0.0.1', SMPP_SYSTEM_ID: 'medflow', SMPP_PASSWORD: 'secret' }),
+    port: smsc.port,
+    binds: 2,
+    window: 5,
+    throughput: 2000,
+    throttleBackoffMs: 50,
+    responseTimeoutMs: 1000,
+    reconnectMinMs: 20,
+    flushIntervalMs: 20,
+    ...overrides
+  };
+  const store = memoryStore();
+  return { service: new SmppService(settings, { store }), store };
+}
+
+const numbers = (count) => Array.from({ length: count }, (_, i) => `+24381${String(i).padStart(7, '0')}`);
+
+describe('SMPP channel', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  describe('PDU codec', () => {
+    test('should encode submit_sm with international destination and receipt request', () => {
+      const body = submitSmBody({ source: 'CareVision', destination: '+243 81 234 5678', text: 'Rappel RDV demain 09:00' });
+      const pdu = decodePdu(encodePdu(COMMAND.SUBMIT_SM, 7, body));
+      const message = decodeShortMessage(pdu.body);
+
+      expect(pdu.commandId).toBe(COMMAND.SUBMIT_SM);
+      expect(pdu.sequence).toBe(7);
+      expect(pdu.length).toBe(16 + body.length);
+      expect(message.source).toBe('CareVision');
+      expect(message.sourceTon).toBe(5);
+      expect(message.destination).toBe('243812345678');
+      expect(message.destinationTon).toBe(1);
+      expect(message.registeredDelivery).toBe(1);
+      expect(message.text).toBe('Rappel RDV demain 09:00');
+    });
+
+    test('should pick the smallest data coding and use message_payload for long texts', () => {
+      expect(encodeText('RDV 09:00').dataCoding).toBe(0);
+      expect(encodeText('Votre RDV est confirmé').dataCoding).toBe(3);
+      expect(encodeText('Ordonnance prête ✓').dataCoding).toBe(8);
+
+      const text = `Fermeture exceptionnelle de la clinique — ${'très '.repeat(40)}`;
+      const message = decodeShortMessage(submitSmBody({ source: '12345', destination: '+243810000000', text }));
+      expect(message.dataCoding).toBe(8);
+      expect(message.sourceTon).toBe(3);
+      expect(message.text).toBe(text);
+    });
+
+    test('should parse receipts from text and TLVs', () => {
+      const fromText = parseReceipt({
+        esmClass: 0x04,
+        tlvs: {},
+        text: 'id:1f0a2 sub:001 dlvr:000 submit date:2610180815 done date:2610180816 stat:UNDELIV err:001 text:'
+      });
+      expect(fromText.messageId).toBe('1f0a2');
+      expect(fromText.status).toBe('undelivered');
+      expect(fromText.error).toBe('001');
+      expect(fromText.doneAt.getMinutes()).toBe(16);
+
+      const fromTlv = parseReceipt({ esmClass: 0x04, tlvs: { 0x001e: Buffer.from('abc\0'), 0x0427: Buffer.from([2]) }, text: '' });
+      expect(fromTlv).toEqual({ messageId: 'abc', status: 'delivered', stat: null, error: null, doneAt: null });
+
+      // Mobile-originated message, not a receipt
+      expect(parseReceipt({ esmClass: 0, tlvs: {}, text: 'STOP' })).toBeNull();
+    });
+
+    test('should map a receipt id to the submitted id per SMSC id form', () => {
+      expect(receiptKey('126976', 'decimal')).toBe('1f000');
+      expect(receiptKey('1F000', 'hex')).toBe('126976');
+      expect(receiptKey('1F000', 'same')).toBe('1f000');
+      expect(receiptKey('1f000', 'decimal')).toBeNull();
+      expect(receiptKey('msg-42', 'hex')).toBeNull();
+    });
+  });
+
+  describe('receipt correlation', () => {
+    test('should never credit a receipt to another message under another id form', async () => {
+      const store = memoryStore();
+      const service = new SmppService({ ...loadSettings({}), receiptIdFormat: 'auto' }, { store });
+      // Decimal ids: '16' reads as 16, as hex 0x16 = 22, or as decimal 16 = 0x10
+      for (const id of ['10', '16', '22', '31']) service.recordSubmitted(id, '+243810000001', {});
+
+      service.onReceipt({ messageId: '16', status: 'delivered' });
+      expect(service.getStatus().receiptIdFormat).toBe('auto');
+      expect(service.submitted.size).toBe(4);
+
+      // Only '31' itself is pending under any reading: the SMSC quotes ids as is
+      service.onReceipt({ messageId: '31', status: 'delivered' });
+      expect(service.getStatus().receiptIdFormat).toBe('same');
+      await new Promise(resolve => setImmediate(resolve));
+      expect([...service.submitted.keys()].sort()).toEqual(['10', '22']);
+
+      // Duplicate receipt after the entry is gone: still only message 16
+      service.onReceipt({ messageId: '16', status: 'undelivered' });
+      await service.flush();
+
+      expect(store.records.get('16').status).toBe('undelivered');
+      expect(store.records.get('10').status).toBe('submitted');
+      expect(store.records.get('22').status).toBe('submitted');
+      expect(service.submitted.has('10') && service.submitted.has('22')).toBe(true);
+    });
+  });
+
+  describe('token bucket', () => {
+    test('should hold the configured rate', async () => {
+      const bucket = new TokenBucket(200);
+      const started = Date.now();
+      await Promise.all(Array.from({ length: 100 }, () => bucket.take()));
+      const elapsed = Date.now() - started;
+
+      // 20-token burst, then 80 at 200/s
+      expect(elapsed).toBeGreaterThanOrEqual(380);
+      expect(elapsed).toBeLessThan(1000);
+    });
+  });
+
+  describe('against a mock SMSC', () => {
+    let smsc;
+    let service;
+
+    afterEach(async () => {
+      if (service) await service.stop();
+      if (smsc) await smsc.close();
+      service = null;
+      smsc = null;
+    });
+
+    test('should pipeline submits within the window and persist receipts', async () => {
+      smsc = await createMockSmsc({ responseDelayMs: 5, undeliverable: ['243810000003'], decimalReceiptIds: true }).listen();
+      const context = channel(smsc);
+      service = context.service;
+      service.start();
+      await until(() => service.sessions.every(session => session.bound));
+
+      const results = await service.sendBulk(numbers(60).map(to => ({ to, text: 'Rappel: RDV demain à 09:00' })), { campaign: 'reminders' });
+
+      expect(results.every(result => result.success)).toBe(true);
+      expect(new Set(results.map(result => result.messageId)).size).toBe(60);
+      expect(smsc.messages).toHaveLength(60);
+      expect(smsc.messages[0].dataCoding).toBe(3);
+      // Window is per bind; the SMSC never held more than that unanswered
+      expect(smsc.maxUnanswered).toBeLessThanOrEqual(5);
+      expect(smsc.maxUnanswered).toBeGreaterThan(1);
+
+      await until(() => service.getStatus().counters.receipts === 60);
+      await service.flush();
+
+      const undelivered = results[3].messageId;
+      expect(context.store.records.get(undelivered).status).toBe('undelivered');
+      expect(context.store.records.get(results[0].messageId)).toMatchObject({ status: 'delivered', campaign: 'reminders', to: numbers(1)[0] });
+      expect(service.getStatus().counters.unmatchedReceipts).toBe(0);
+      expect(service.getStatus().receipts).toEqual({ delivered: 59, undelivered: 1 });
+    });
+
+    test('should resubmit throttled messages and report rejected destinations', async () => {
+      smsc = await createMockSmsc({ maxPerSecond: 40, rejected: ['243810000001'] }).listen();
+      ({ service } = channel(smsc, { throughput: 1000, throttleBackoffMs: 200 }));
+      service.start();
+      await until(() => service.isBound());
+
+      const results = await service.sendBulk(numbers(50).map(to => ({ to, text: 'Fermeture le 24/10' })));
+
+      expect(results[1]).toMatchObject({ success: false, retryable: false });
+      expect(results.filter(result => result.success)).toHaveLength(49);
+      expect(smsc.throttled).toBeGreaterThan(0);
+      expect(service.getStatus().counters.throttled).toBe(smsc.throttled);
+    });
+
+    test('should rebind after the operator drops the connection', async () => {
+      smsc = await createMockSmsc({ responseDelayMs: 2 }).listen();
+      ({ service } = channel(smsc, { binds: 1 }));
+      service.start();
+      await until(() => service.isBound());
+
+      const sending = service.sendBulk(numbers(40).map(to => ({ to, text: 'Rappel' })));
+      await wait(10);
+      smsc.dropConnections();
+      const results = await sending;
+
+      // Unanswered at the drop: unknown, never resubmitted; the rest go out on the new bind
+      const unknown = results.filter(result => result.status === 'unknown');
+      expect(results.every(result => result.success || result.status === 'unknown')).toBe(true);
+      expect(unknown.every(result => result.retryable === false)).toBe(true);
+      expect(results.filter(result => result.success).length).toBeGreaterThan(0);
+      expect(service.getStatus().counters.unknown).toBe(unknown.length);
+      expect(smsc.binds).toBeGreaterThanOrEqual(2);
+
+      const destinations = smsc.messages.map(message => message.destination);
+      expect(new Set(destinations).size).toBe(destinations.length);
+    });
+
+    test('should fail fast for fallback when the bind is refused', async () => {
+      smsc = await createMockSmsc().listen();
+      ({ service } = channel(smsc, { password: 'wrong', binds: 1 }));
+      service.start();
+      await until(() => service.sessions[0].state === 'closed');
+
+      const started = Date.now();
+      const result = await service.send('+243810000000', 'Test');
+
+      expect(result).toMatchObject({ success: false, retryable: true });
+      expect(Date.now() - started).toBeLessThan(500);
+      expect(service.isBound()).toBe(false);
+    });
+
+    test('should send a bulk campaign much faster than the sequential 100 ms loop', async () => {
+      smsc = await createMockSmsc({ responseDelayMs: 2 }).listen();
+      ({ service } = channel(smsc, { binds: 2, window: 10, throughput: 1000 }));
+      service.start();
+      await until(() => service.sessions.every(session => session.bound));
+
+      const started = Date.now();
+      const results = await service.sendBulk(numbers(1000).map(to => ({ to, text: 'Rappel de vaccination' })));
+      const perSecond = 1000 / ((Date.now() - started) / 1000);
+
+      expect(results.every(result => result.success)).toBe(true);
+      // sendBulkSMS over HTTP: under 10 messages/second
+      expect(perSecond).toBeGreaterThan(300);
+      // ...and never above the negotiated rate (plus one burst)
+      expect(perSecond).toBeLessThan(1150);
+    });
+  });
+});
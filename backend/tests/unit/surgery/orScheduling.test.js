@@ -0,0 +1,285 @@
+/**
+ * OR Scheduling Optimizer Tests
+ *
+ * Tests for the pure planner in orSchedulingService:
+ * - Duration prediction from history
+ * - Priority / overdue ordering
+ * - Room, surgeon and equipment constraints, turnover
+ * - Gap backfill after a cancellation
+ *
+ * And on the database:
+ * - Applying a plan: turnover in the clash check, one apply per case
+ * - Backfill gap ends a turnover before the next case
+ */
+
+const mongoose = require('mongoose');
+const SurgeryCase = require('../../../models/SurgeryCase');
+const Room = require('../../../models/Room');
+const {
+  buildSchedule,
+  fillGap,
+  buildDurationModel,
+  predictDuration,
+  applySchedule,
+  proposeBackfill
+} = require('../../../services/orSchedulingService');
+
+// Monday, so the default weekday horizon starts on the same day
+const MONDAY = new Date(2026, 10, 2);
+const NOW = new Date(2026, 9, 30, 10, 0);
+
+const daysAgo = days => new Date(NOW.getTime() - days * 24 * 60 * 60 * 1000);
+
+const makeCase = (id, overrides = {}) => ({
+  _id: id,
+  priority: 'routine',
+  paymentDate: daysAgo(1),
+  surgeryType: { _id: 'phaco', duration: 30, requiredEquipment: [] },
+  ...overrides
+});
+
+const overlaps = (a, b) => a.scheduledDate < b.scheduledEndTime && a.scheduledEndTime > b.scheduledDate;
+
+describe('OR Scheduling Optimizer', () => {
+  describe('predictDuration', () => {
+    const model = buildDurationModel([
+      ...[40, 42, 44, 46].map(minutes => ({ surgeon: 'dr1', surgeryType: 'phaco', minutes })),
+      ...[25, 26, 27].map(minutes => ({ surgeon: 'dr2', surgeryType: 'phaco', minutes })),
+      { surgeon: 'dr1', surgeryType: 'phaco', minutes: 2000 } // implausible, ignored
+    ]);
+
+    test('should use surgeon + procedure history when enough samples exist', () => {
+      const result = predictDuration(model, makeCase('c1', { surgeon: 'dr1' }));
+      expect(result.source).toBe('surgeon_history');
+      expect(result.minutes).toBe(45);
+    });
+
+    test('should fall back to procedure history for surgeons without history', () => {
+      const result = predictDuration(model, makeCase('c1', { surgeon: 'dr3' }));
+      expect(result.source).toBe('procedure_history');
+    });
+
+    test('should fall back to the clinical act duration without history', () => {
+      const result = predictDuration(model, makeCase('c1', {
+        surgeryType: { _id: 'vitrectomy', duration: 90 }
+      }));
+      expect(result).toEqual({ minutes: 90, source: 'clinical_act' });
+    });
+  });
+
+  describe('buildSchedule', () => {
+    test('should never double-book a room or surgeon', () => {
+      const cases = Array.from({ length: 30 }, (_, i) =>
+        makeCase(`c${i}`, { surgeon: i % 2 ? 'dr1' : 'dr2', paymentDate: daysAgo(i) }));
+      const rooms = [{ _id: 'or1' }, { _id: 'or2' }];
+
+      const plan = buildSchedule({ cases, rooms, startDate: MONDAY, days: 3, options: { now: NOW } });
+
+      expect(plan.assignments.length).toBe(30);
+      for (const a of plan.assignments) {
+        for (const b of plan.assignments) {
+          if (a === b || !overlaps(a, b)) continue;
+          expect(a.roomId).not.toBe(b.roomId);
+          expect(a.surgeonId).not.toBe(b.surgeonId);
+        }
+      }
+    });
+
+    test('should schedule urgent and overdue cases before routine ones', () => {
+      const cases = [
+        makeCase('recent', { paymentDate: daysAgo(2) }),
+        makeCase('overdue', { paymentDate: daysAgo(45) }),
+        makeCase('urgent', { priority: 'urgent', paymentDate: daysAgo(1) })
+      ];
+      const plan = buildSchedule({ cases, rooms: [{ _id: 'or1' }], startDate: MONDAY, days: 1, options: { now: NOW } });
+
+      const order = [...plan.assignments]
+        .sort((a, b) => a.scheduledDate - b.scheduledDate)
+        .map(a => a.caseId);
+      expect(order).toEqual(['urgent', 'overdue', 'recent']);
+      expect(plan.assignments.find(a => a.caseId === 'overdue').overdue).toBe(true);
+    });
+
+    test('should only use rooms that have the required equipment', () => {
+      const cases = [makeCase('laser', { surgeryType: { _id: 'slt', duration: 20, requiredEquipment: ['laser'] } })];
+      const rooms = [
+        { _id: 'or1' },
+        { _id: 'or2', equipment: [{ name: 'Laser', status: 'working' }] }
+      ];
+      const plan = buildSchedule({ cases, rooms, startDate: MONDAY, days: 1, options: { now: NOW } });
+      expect(plan.assignments[0].roomId).toBe('or2');
+
+      const broken = buildSchedule({
+        cases,
+        rooms: [{ _id: 'or2', equipment: [{ name: 'Laser', status: 'broken' }] }],
+        startDate: MONDAY,
+        days: 1,
+        options: { now: NOW }
+      });
+      expect(broken.unscheduled[0].reason).toBe('no_room_with_equipment');
+    });
+
+    test('should respect surgeon availability and existing bookings', () => {
+      const availabilityBySurgeon = new Map([['dr1', {
+        getWorkingHoursForDate: () => ({
+          isWorkingDay: true,
+          shifts: [{ startTime: '13:00', endTime: '17:00' }],
+          breaks: []
+        })
+      }]]);
+      const bookings = [{
+        operatingRoom: 'or1',
+        surgeon: 'dr9',
+        scheduledDate: new Date(2026, 10, 2, 13, 0),
+        scheduledEndTime: new Date(2026, 10, 2, 14, 0)
+      }];
+
+      const plan = buildSchedule({
+        cases: [makeCase('c1', { surgeon: 'dr1' })],
+        rooms: [{ _id: 'or1' }],
+        bookings,
+        availabilityBySurgeon,
+        startDate: MONDAY,
+        days: 1,
+        options: { now: NOW, turnoverMinutes: 15 }
+      });
+
+      // After the 13:00-14:00 booking plus turnover
+      expect(plan.assignments[0].scheduledDate).toEqual(new Date(2026, 10, 2, 14, 15));
+    });
+
+    test('should leave turnover before a booking that runs past closing time', () => {
+      const bookings = [{
+        operatingRoom: 'or1',
+        surgeon: 'dr9',
+        scheduledDate: new Date(2026, 10, 2, 9, 0),
+        scheduledEndTime: new Date(2026, 10, 2, 10, 0)
+      }];
+      const rooms = [{ _id: 'or1', operatingHours: { monday: { open: '08:00', close: '09:00' } } }];
+      const options = { now: NOW, turnoverMinutes: 15 };
+
+      const tooLong = buildSchedule({
+        cases: [makeCase('c1', { surgeryType: { _id: 'phaco', duration: 60 } })],
+        rooms, bookings, startDate: MONDAY, days: 1, options
+      });
+      expect(tooLong.unscheduled[0].reason).toBe('no_capacity_in_horizon');
+
+      const fits = buildSchedule({
+        cases: [makeCase('c2', { surgeryType: { _id: 'phaco', duration: 45 } })],
+        rooms, bookings, startDate: MONDAY, days: 1, options
+      });
+      expect(fits.assignments[0].scheduledEndTime).toEqual(new Date(2026, 10, 2, 8, 45));
+    });
+
+    test('should report utilization per room and day', () => {
+      const cases = Array.from({ length: 4 }, (_, i) =>
+        makeCase(`c${i}`, { surgeryType: { _id: 'phaco', duration: 120 } }));
+      const plan = buildSchedule({
+        cases,
+        rooms: [{ _id: 'or1' }],
+        startDate: MONDAY,
+        days: 1,
+        options: { now: NOW, turnoverMinutes: 0 }
+      });
+
+      expect(plan.assignments).toHaveLength(4);
+      expect(plan.utilization.byRoomDay[0].bookedMinutes).toBe(480);
+      expect(plan.utilization.overall).toBeCloseTo(88.9, 1);
+    });
+  });
+
+  describe('fillGap', () => {
+    test('should fill only the freed window with the best-ranked fitting cases', () => {
+      const cases = [
+        makeCase('tooLong', { surgeryType: { _id: 'vit', duration: 120 }, paymentDate: daysAgo(60) }),
+        makeCase('fits1', { paymentDate: daysAgo(20) }),
+        makeCase('fits2', { paymentDate: daysAgo(10) })
+      ];
+
+      const result = fillGap({
+        room: { _id: 'or1' },
+        gapStart: new Date(2026, 10, 2, 9, 0),
+        gapEnd: new Date(2026, 10, 2, 10, 30),
+        cases,
+        options: { now: NOW, turnoverMinutes: 15 }
+      });
+
+      expect(result.assignments.map(a => a.caseId)).toEqual(['fits1', 'fits2']);
+      for (const a of result.assignments) {
+        expect(a.scheduledDate >= new Date(2026, 10, 2, 9, 0)).toBe(true);
+        expect(a.scheduledEndTime <= new Date(2026, 10, 2, 10, 30)).toBe(true);
+      }
+    });
+  });
+
+  describe('on the database', () => {
+    // A Monday after NOW; rooms without hours are open 08:00-17:00
+    const DAY = new Date(2026, 10, 9);
+    const at = (hours, minutes = 0) => new Date(2026, 10, 9, hours, minutes);
+    const clinic = new mongoose.Types.ObjectId();
+
+    const createRoom = (roomNumber) => Room.create({ clinic, roomNumber, name: `Bloc ${roomNumber}`, type: 'surgery' });
+    const createCase = (overrides = {}) => SurgeryCase.create({
+      patient: new mongoose.Types.ObjectId(),
+      invoice: new mongoose.Types.ObjectId(),
+      clinic,
+      paymentDate: daysAgo(5),
+      status: 'awaiting_scheduling',
+      ...overrides
+    });
+    const assignment = (surgeryCase, room, start, end) => ({
+      caseId: String(surgeryCase._id),
+      roomId: String(room._id),
+      scheduledDate: start,
+      scheduledEndTime: end
+    });
+
+    test('should refuse a slot inside the turnover of a booked case', async () => {
+      const room = await createRoom('B1');
+      await createCase({ status: 'scheduled', operatingRoom: room._id, scheduledDate: at(9), scheduledEndTime: at(10) });
+      const [early, onTime] = await Promise.all([createCase(), createCase()]);
+
+      const result = await applySchedule([
+        assignment(early, room, at(10, 5), at(10, 35)),
+        assignment(onTime, room, at(10, 15), at(10, 45))
+      ], new mongoose.Types.ObjectId(), { turnoverMinutes: 15 });
+
+      expect(result.rejected).toEqual([{ caseId: String(early._id), reason: 'slot_conflict' }]);
+      expect(result.scheduled.map(s => s.caseId)).toEqual([String(onTime._id)]);
+      expect((await SurgeryCase.findById(early._id).lean()).status).toBe('awaiting_scheduling');
+    });
+
+    test('should schedule a case once when two applies race for it', async () => {
+      const [first, second] = await Promise.all([createRoom('B1'), createRoom('B2')]);
+      const surgeryCase = await createCase();
+
+      const results = await Promise.all([
+        applySchedule([assignment(surgeryCase, first, at(9), at(10))], new mongoose.Types.ObjectId()),
+        applySchedule([assignment(surgeryCase, second, at(11), at(12))], new mongoose.Types.ObjectId())
+      ]);
+
+      expect(results.reduce((sum, result) => sum + result.scheduled.length, 0)).toBe(1);
+      expect(results.flatMap(result => result.rejected)).toEqual([
+        { caseId: String(surgeryCase._id), reason: 'not_awaiting_scheduling' }
+      ]);
+      const saved = await SurgeryCase.findById(surgeryCase._id).lean();
+      expect(saved.status).toBe('scheduled');
+      expect(saved.statusHistory.filter(entry => entry.status === 'scheduled')).toHaveLength(1);
+    });
+
+    test('should end a backfilled case a turnover before the next case', async () => {
+      const room = await createRoom('B1');
+      await createCase({ status: 'scheduled', operatingRoom: room._id, scheduledDate: at(8), scheduledEndTime: at(10) });
+      await createCase({ status: 'scheduled', operatingRoom: room._id, scheduledDate: at(11), scheduledEndTime: at(12) });
+      const cancelled = await createCase({ status: 'cancelled', operatingRoom: room._id, scheduledDate: at(10), scheduledEndTime: at(11) });
+      const short = await createCase({ estimatedDuration: 30 });
+      await createCase({ estimatedDuration: 45, paymentDate: daysAgo(40) });
+
+      const result = await proposeBackfill(cancelled, { now: NOW, turnoverMinutes: 15 });
+
+      expect(result.gap).toMatchObject({ start: at(10, 15), end: at(10, 45) });
+      expect(result.assignments.map(a => a.caseId)).toEqual([String(short._id)]);
+      expect(result.assignments[0].scheduledEndTime).toEqual(at(10, 45));
+    });
+  });
+});
@@ -0,0 +1,148 @@
+/**
+ * Catalog Snapshot Tests
+ *
+ * Tests for versioned reference-data snapshots:
+ * - Per-document diffing
+ * - Journal merging into deltas
+ * - Delta vs full-snapshot fallback
+ */
+
+const {
+  CatalogSnapshotService,
+  _diffCatalog: diffCatalog,
+  _mergeJournal: mergeJournal
+} = require('../../../services/catalogSnapshotService');
+
+const doc = (id, fields = {}) => ({ _id: id, name: `item-${id}`, ...fields });
+
+/**
+ * Service with in-memory catalogs instead of MongoDB
+ */
+function createService(initial) {
+  const service = new CatalogSnapshotService();
+  const data = { ...initial };
+  let sequence = 10;
+
+  service._load = async name => data[name] || [];
+  service._fingerprint = async name => JSON.stringify(data[name] || []);
+  service._nextVersion = async () => ++sequence;
+  service._notify = jest.fn();
+
+  return { service, data };
+}
+
+describe('Catalog Snapshot', () => {
+  describe('diffCatalog', () => {
+    test('should detect added, changed and removed documents', () => {
+      const { items } = diffCatalog(new Map(), [doc('a'), doc('b'), doc('c')]);
+
+      const result = diffCatalog(items, [doc('a'), doc('b', { name: 'renamed' }), doc('d')]);
+
+      expect(result.upserts.sort()).toEqual(['b', 'd']);
+      expect(result.deletes).toEqual(['c']);
+      expect(result.items.size).toBe(3);
+    });
+  });
+
+  describe('mergeJournal', () => {
+    const journal = [
+      { version: 2, changes: { medications: { upserts: ['a'], deletes: [] } } },
+      { version: 3, changes: { medications: { upserts: [], deletes: ['a'] } } },
+      { version: 4, changes: { doses: { upserts: ['x'], deletes: [] } } }
+    ];
+
+    test('should let the latest change win for each id', () => {
+      const merged = mergeJournal(journal, 1, 1);
+      expect([...merged.medications.upserts]).toEqual([]);
+      expect([...merged.medications.deletes]).toEqual(['a']);
+      expect([...merged.doses.upserts]).toEqual(['x']);
+    });
+
+    test('should only include entries newer than the client version', () => {
+      const merged = mergeJournal(journal, 3, 1);
+      expect(Object.keys(merged)).toEqual(['doses']);
+    });
+
+    test('should return null when the client is older than the journal', () => {
+      expect(mergeJournal(journal, 0, 1)).toBeNull();
+    });
+  });
+
+  describe('CatalogSnapshotService', () => {
+    test('should bump the version only when a catalog actually changes', async () => {
+      const { service, data } = createService({ medications: [doc('a'), doc('b')] });
+      await service.ensureReady();
+      const initial = service.version;
+
+      const unchanged = await service.refresh(['medications']);
+      expect(unchanged.version).toBe(initial);
+      expect(service._notify.mock.calls.length).toBe(0);
+
+      data.medications = [doc('a'), doc('b', { name: 'updated' })];
+      const changed = await service.refresh(['medications']);
+      expect(changed.version).toBe(initial + 1);
+      expect(changed.changed).toEqual(['medications']);
+      expect(service._notify.mock.calls.length).toBe(1);
+    });
+
+    test('should return only changed documents in a delta', async () => {
+      const { service, data } = createService({
+        medications: [doc('a'), doc('b')],
+        doses: [doc('d1')]
+      });
+      await service.ensureReady();
+      const clientVersion = service.version;
+
+      data.medications = [doc('a', { name: 'changed' })];
+      await service.refresh(['medications', 'doses']);
+
+      const delta = await service.getDelta(clientVersion);
+      expect(delta.full).toBe(false);
+      expect(delta.version).toBe(clientVersion + 1);
+      expect(delta.changes.medications.upserts.map(d => d._id)).toEqual(['a']);
+      expect(delta.changes.medications.deletes).toEqual(['b']);
+      expect(delta.changes.doses).toBeUndefined();
+    });
+
+    test('should return an empty delta for an up-to-date client', async () => {
+      const { service } = createService({ medications: [doc('a')] });
+      await service.ensureReady();
+
+      const delta = await service.getDelta(service.version);
+      expect(delta).toEqual({ version: service.version, full: false, changes: {} });
+    });
+
+    test('should fall back to a full snapshot for unknown client versions', async () => {
+      const { service } = createService({ medications: [doc('a')] });
+      await service.ensureReady();
+
+      const stale = await service.getDelta(service.version - 5);
+      expect(stale.full).toBe(true);
+      expect(stale.catalogs.medications).toHaveLength(1);
+
+      const ahead = await service.getDelta(service.version + 1);
+      expect(ahead.full).toBe(true);
+
+      const invalid = await service.getDelta('abc');
+      expect(invalid.full).toBe(true);
+    });
+
+    test('should cache the compressed bundle per version', async () => {
+      const zlib = require('zlib');
+      const { service, data } = createService({ medications: [doc('a')] });
+      await service.ensureReady();
+
+      const first = await service.getCompressedSnapshot();
+      const again = await service.getCompressedSnapshot();
+      expect(again.buffer).toBe(first.buffer);
+
+      data.medications = [doc('a'), doc('b')];
+      await service.refresh(['medications']);
+      const next = await service.getCompressedSnapshot();
+
+      expect(next.version).toBe(first.version + 1);
+      const parsed = JSON.parse(zlib.gunzipSync(next.buffer).toString());
+      expect(parsed.catalogs.medications).toHaveLength(2);
+    });
+  });
+});
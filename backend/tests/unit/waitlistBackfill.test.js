@@ -0,0 +1,429 @@
+/**
+ * Waitlist Backfill Tests
+ *
+ * - Matching on clinic, department, provider, weekday/time band and dates
+ * - Ranking by priority, provider request, preference, then waiting time
+ * - Concurrent acceptances book the slot exactly once; the rest stay waiting
+ * - Acceptance after the window, wave advance on expiry / all declined
+ * - Exhaustion after the last wave, duplicate and too-soon slots
+ * - The same races on the MongoDB store
+ */
+
+const mongoose = require('mongoose');
+const Appointment = require('../../models/Appointment');
+const Patient = require('../../models/Patient');
+const WaitingList = require('../../models/WaitingList');
+const { createTestPatient } = require('../fixtures/generators');
+const {
+  WaitlistBackfill,
+  loadSettings,
+  timeBand,
+  slotFromAppointment,
+  matchesSlot,
+  rankCandidates
+} = require('../../services/waitlistBackfillService');
+
+const CLINIC = 'clinic-1';
+const PROVIDER = 'provider-1';
+
+const tick = () => new Promise(resolve => setImmediate(resolve));
+const wait = (ms) => new Promise(resolve => setTimeout(resolve, ms));
+
+// Tomorrow 10:00 local: well past the minimum lead time
+function tomorrowAt(hours) {
+  const date = new Date();
+  date.setDate(date.getDate() + 1);
+  date.setHours(0, 0, 0, 0);
+  return { date, startTime: `${String(hours).padStart(2, '0')}:00`, endTime: `${String(hours).padStart(2, '0')}:30` };
+}
+
+let sequence = 0;
+function freedAppointment(overrides = {}) {
+  return {
+    _id: `apt-${++sequence}`,
+    clinic: CLINIC,
+    provider: PROVIDER,
+    department: 'ophthalmology',
+    type: 'consultation',
+    duration: 30,
+    ...tomorrowAt(10),
+    ...overrides
+  };
+}
+
+function entry(id, overrides = {}) {
+  return {
+    _id: id,
+    patient: { _id: `patient-${id}`, firstName: id, phoneNumber: '+243810000000' },
+    clinic: CLINIC,
+    department: 'ophthalmology',
+    status: 'waiting',
+    priority: 'normal',
+    contactPreferences: { sms: true },
+    createdAt: new Date('2026-01-01T00:00:00Z'),
+    notifications: [],
+    ...overrides
+  };
+}
+
+/**
+ * In-memory store with the same conditional semantics as the MongoDB one.
+ * Every call yields first, so concurrent callers interleave.
+ */
+function memoryStore(entries) {
+  const backfills = new Map();
+  const booked = [];
+  let offers = 0;
+  const find = (id) => entries.find(e => e._id === id);
+
+  return {
+    entries,
+    backfills,
+    booked,
+    async startBackfill(slot) {
+      await tick();
+      const current = backfills.get(slot.sourceAppointment);
+      if (current && (current.status === 'offering' || current.slotKey === slot.key)) return false;
+      backfills.set(slot.sourceAppointment, { status: 'offering', slotKey: slot.key });
+      return true;
+    },
+    async finishBackfill(slot, status) {
+      await tick();
+      const current = backfills.get(slot.sourceAppointment);
+      if (current && current.status === 'offering' && current.slotKey === slot.key) current.status = status;
+    },
+    async findCandidates(slot, limit) {
+      await tick();
+      return entries
+        .filter(e => e.status === 'waiting' && !e.notifications.some(n => n.slotKey === slot.key))
+        .slice(0, limit);
+    },
+    async createOffer(candidate, slot, { wave, channel, expiresAt }) {
+      await tick();
+      const target = find(candidate._id);
+      if (target.status !== 'waiting') return null;
+      const offer = {
+        _id: `offer-${++offers}`,
+        type: channel,
+        slotOffered: { date: slot.date, startTime: slot.startTime, endTime: slot.endTime, provider: slot.provider },
+        response: 'pending',
+        expiresAt,
+        wave,
+        slotKey: slot.key,
+        sourceAppointment: slot.sourceAppointment
+      };
+      target.status = 'notified';
+      target.notifications.push(offer);
+      return offer;
+    },
+    async getOffer(entryId, offerId) {
+      await tick();
+      const target = find(entryId);
+      const offer = target && target.notifications.find(n => n._id === offerId);
+      return offer ? { entry: target, offer: { ...offer } } : null;
+    },
+    async setOfferResponse(entryId, offerId, from, response, entryStatus) {
+      await tick();
+      const target = find(entryId);
+      const offer = target.notifications.find(n => n._id === offerId && n.response === from);
+      if (!offer) return false;
+      offer.response = response;
+      target.status = entryStatus;
+      return true;
+    },
+    async pendingOffers(slot) {
+      await tick();
+      return entries.flatMap(e => e.notifications
+        .filter(n => n.slotKey === slot.key && n.response === 'pending')
+        .map(offer => ({ entry: e, offer })));
+    },
+    async claimSlot(slot, entryId) {
+      await tick();
+      const current = backfills.get(slot.sourceAppointment);
+      if (!current || current.status !== 'offering' || current.slotKey !== slot.key) return false;
+      Object.assign(current, { status: 'filled', filledBy: entryId });
+      return true;
+    },
+    async releaseSlot(slot, entryId) {
+      await tick();
+      const current = backfills.get(slot.sourceAppointment);
+      if (current && current.filledBy === entryId) Object.assign(current, { status: 'offering', filledBy: null });
+    },
+    async bookAppointment(slot, candidate) {
+      await tick();
+      const appointment = { _id: `booked-${booked.length + 1}`, patient: candidate.patient._id, date: slot.date, startTime: slot.startTime };
+      booked.push(appointment);
+      return appointment;
+    },
+    async markScheduled(entryId, slot, appointment) {
+      await tick();
+      find(entryId).scheduledAppointment = appointment._id;
+    },
+    async expireStaleOffers() {
+      return 0;
+    }
+  };
+}
+
+function engine(entries, overrides = {}) {
+  const store = memoryStore(entries);
+  const sent = [];
+  const backfill = new WaitlistBackfill(
+    { ...loadSettings({}), offerWindowMs: 60 * 1000, minLeadMs: 60 * 60 * 1000, waveSize: 2, maxWaves: 2, ...overrides },
+    { store, notify: async (event) => { sent.push({ type: event.type, entry: event.entry._id }); } }
+  );
+  return { backfill, store, sent };
+}
+
+const offersOf = (store, id) => store.entries.find(e => e._id === id).notifications;
+
+describe('Waitlist backfill', () => {
+  beforeAll(() => {
+    jest.useRealTimers();
+  });
+
+  afterEach(() => {
+    sequence = 0;
+  });
+
+  describe('matching', () => {
+    const slot = slotFromAppointment(freedAppointment());
+
+    test('should map start times to preference bands', () => {
+      expect(timeBand('08:30')).toBe('morning');
+      expect(timeBand('12:00')).toBe('afternoon');
+      expect(timeBand('17:15')).toBe('evening');
+    });
+
+    test('should key the slot on the time it had before a reschedule', () => {
+      const appointment = freedAppointment({ startTime: '15:00' });
+      const moved = slotFromAppointment(appointment, { date: appointment.date, startTime: '09:00', endTime: '09:30' });
+
+      expect(moved.startTime).toBe('09:00');
+      expect(moved.endTime).toBe('09:30');
+      expect(moved.key).toMatch(':09:00');
+    });
+
+    test('should filter on clinic, department, provider and preferences', () => {
+      const weekday = slot.date.getDay();
+
+      expect(matchesSlot(entry('a'), slot)).toBe(true);
+      expect(matchesSlot(entry('a', { clinic: 'clinic-2' }), slot)).toBe(false);
+      expect(matchesSlot(entry('a', { department: 'retina' }), slot)).toBe(false);
+      expect(matchesSlot(entry('a', { status: 'notified' }), slot)).toBe(false);
+      expect(matchesSlot(entry('a', { expiresAt: new Date(Date.now() - 1000) }), slot)).toBe(false);
+      // Provider only binds when the patient is not flexible
+      expect(matchesSlot(entry('a', { requestedProvider: 'provider-2' }), slot)).toBe(true);
+      expect(matchesSlot(entry('a', { requestedProvider: 'provider-2', preferences: { flexibleProvider: false } }), slot)).toBe(false);
+      expect(matchesSlot(entry('a', { preferences: { preferredDays: [(weekday + 1) % 7] } }), slot)).toBe(false);
+      expect(matchesSlot(entry('a', { preferences: { preferredTimeSlots: ['afternoon'] } }), slot)).toBe(false);
+      expect(matchesSlot(entry('a', { preferences: { latestDate: new Date() } }), slot)).toBe(false);
+    });
+
+    test('should rank by priority, provider, preference, then waiting time', () => {
+      const ranked = rankCandidates([
+        entry('recent', { createdAt: new Date('2026-03-01') }),
+        entry('oldest', { createdAt: new Date('2025-12-01') }),
+        entry('morning', { preferences: { preferredTimeSlots: ['morning'] } }),
+        entry('own-doctor', { requestedProvider: PROVIDER, createdAt: new Date('2026-06-01') }),
+        entry('urgent', { priority: 'urgent', createdAt: new Date('2026-09-01') }),
+        entry('other-clinic', { clinic: 'clinic-2', priority: 'urgent' })
+      ], slot);
+
+      expect(ranked.map(e => e._id)).toEqual(['urgent', 'own-doctor', 'morning', 'oldest', 'recent']);
+    });
+  });
+
+  describe('offers', () => {
+    test('should book the slot once when two patients accept concurrently', async () => {
+      const { backfill, store, sent } = engine([entry('a'), entry('b'), entry('c')], { waveSize: 3 });
+      const started = await backfill.slotFreed(freedAppointment(), 'cancelled');
+      expect(started.started).toBe(true);
+
+      const [offerA] = offersOf(store, 'a');
+      const [offerB] = offersOf(store, 'b');
+      const results = await Promise.all([
+        backfill.respond('a', offerA._id, true),
+        backfill.respond('b', offerB._id, true)
+      ]);
+
+      const statuses = results.map(result => result.status).sort();
+      expect(statuses).toEqual(['booked', 'taken']);
+      expect(store.booked).toHaveLength(1);
+
+      const winner = results[0].status === 'booked' ? 'a' : 'b';
+      const loser = winner === 'a' ? 'b' : 'a';
+      expect(store.entries.find(e => e._id === winner).scheduledAppointment).toBe('booked-1');
+      expect(offersOf(store, loser)[0].response).toBe('superseded');
+      // Not-yet-answered offers are withdrawn; those patients stay on the list
+      expect(offersOf(store, 'c')[0].response).toBe('superseded');
+      expect(store.entries.filter(e => e.status === 'waiting').map(e => e._id).sort()).toEqual([loser, 'c'].sort());
+      expect(sent.filter(event => event.type === 'confirmed')).toEqual([{ type: 'confirmed', entry: winner }]);
+      expect(sent.filter(event => event.type === 'superseded')).toEqual([{ type: 'superseded', entry: 'c' }]);
+      expect(backfill.getStatus().activeSlots).toBe(0);
+      expect(backfill.getStatus().counters).toEqual({ slots: 1, offers: 3, booked: 1, exhausted: 0, taken: 1 });
+    });
+
+    test('should refuse an acceptance after the window and offer the next wave', async () => {
+      const { backfill, store } = engine([entry('a'), entry('b'), entry('c'), entry('d')], { offerWindowMs: 100 });
+      await backfill.slotFreed(freedAppointment(), 'cancelled');
+      const [offerA] = offersOf(store, 'a');
+
+      // First wave expired, second still open
+      await wait(140);
+
+      expect(await backfill.respond('a', offerA._id, true)).toEqual({ status: 'already-responded', response: 'expired' });
+      expect(offersOf(store, 'a')[0].response).toBe('expired');
+      expect(store.entries.find(e => e._id === 'a').status).toBe('waiting');
+      // Second wave went to the next ranked candidates only
+      expect(offersOf(store, 'c')[0].wave).toBe(2);
+      expect(offersOf(store, 'd')[0].wave).toBe(2);
+      expect(offersOf(store, 'a')).toHaveLength(1);
+
+      const [offerC] = offersOf(store, 'c');
+      expect((await backfill.respond('c', offerC._id, true)).status).toBe('booked');
+      backfill.stop();
+    });
+
+    test('should treat a late answer on a pending offer as expired', async () => {
+      let clock = Date.now();
+      const store = memoryStore([entry('a')]);
+      const backfill = new WaitlistBackfill(
+        { ...loadSettings({}), offerWindowMs: 60 * 1000, minLeadMs: 0 },
+        { store, notify: async () => {}, now: () => new Date(clock) }
+      );
+      await backfill.slotFreed(freedAppointment(), 'cancelled');
+      const [offer] = offersOf(store, 'a');
+
+      clock += 2 * 60 * 1000;
+
+      expect(await backfill.respond('a', offer._id, true)).toEqual({ status: 'expired' });
+      expect(store.booked).toHaveLength(0);
+      backfill.stop();
+    });
+
+    test('should advance as soon as the whole wave declines and stop after the last wave', async () => {
+      const { backfill, store, sent } = engine([entry('a'), entry('b'), entry('c'), entry('d'), entry('e')], { offerWindowMs: 60 * 1000 });
+      await backfill.slotFreed(freedAppointment(), 'cancelled');
+
+      expect((await backfill.respond('a', offersOf(store, 'a')[0]._id, false)).status).toBe('declined');
+      expect(offersOf(store, 'c')).toHaveLength(0);
+      await backfill.respond('b', offersOf(store, 'b')[0]._id, false);
+      expect(offersOf(store, 'c')[0].wave).toBe(2);
+
+      await backfill.respond('c', offersOf(store, 'c')[0]._id, false);
+      await backfill.respond('d', offersOf(store, 'd')[0]._id, false);
+
+      // maxWaves = 2: 'e' is never offered
+      expect(offersOf(store, 'e')).toHaveLength(0);
+      expect([...store.backfills.values()][0].status).toBe('exhausted');
+      expect(backfill.getStatus().counters.exhausted).toBe(1);
+      expect(sent.filter(event => event.type === 'offer')).toHaveLength(4);
+      expect(store.entries.every(e => e.status === 'waiting')).toBe(true);
+    });
+
+    test('should not backfill the same slot twice or slots starting too soon', async () => {
+      const { backfill } = engine([entry('a')], { offerWindowMs: 60 * 1000 });
+      const appointment = freedAppointment();
+
+      expect((await backfill.slotFreed(appointment, 'cancelled')).started).toBe(true);
+      expect(await backfill.slotFreed(appointment, 'cancelled')).toEqual({ started: false, reason: 'already-running' });
+
+      const soon = new Date();
+      soon.setMinutes(soon.getMinutes() + 10);
+      const lastMinute = freedAppointment({
+        date: new Date(soon.getFullYear(), soon.getMonth(), soon.getDate()),
+        startTime: `${String(soon.getHours()).padStart(2, '0')}:${String(soon.getMinutes()).padStart(2, '0')}`
+      });
+      expect(await backfill.slotFreed(lastMinute, 'cancelled')).toEqual({ started: false, reason: 'too-soon' });
+      expect(await backfill.slotFreed(freedAppointment(), 'completed')).toEqual({ started: false, reason: 'disabled' });
+      // Recorded after the slot started: never worth offering
+      expect(await backfill.slotFreed(freedAppointment(), 'no-show')).toEqual({ started: false, reason: 'disabled' });
+      backfill.stop();
+    });
+  });
+
+  describe('MongoDB store', () => {
+    const clinic = new mongoose.Types.ObjectId();
+    const provider = new mongoose.Types.ObjectId();
+
+    // Default store: Appointment and WaitingList on the test database
+    const mongoEngine = () => new WaitlistBackfill(
+      { ...loadSettings({}), offerWindowMs: 60 * 1000, minLeadMs: 60 * 60 * 1000, waveSize: 3, maxWaves: 2 },
+      { notify: async () => {} }
+    );
+
+    async function cancelledAppointment() {
+      const patient = await Patient.create(createTestPatient());
+      return Appointment.create({
+        patient: patient._id,
+        provider,
+        clinic,
+        department: 'ophthalmology',
+        type: 'consultation',
+        reason: 'Control',
+        status: 'cancelled',
+        ...tomorrowAt(10)
+      });
+    }
+
+    async function waitingEntries(count) {
+      const patients = await Patient.create(Array.from({ length: count }, () => createTestPatient()));
+      return WaitingList.create(patients.map(patient => ({
+        patient: patient._id,
+        clinic,
+        department: 'ophthalmology',
+        appointmentType: 'consultation',
+        reason: 'Earlier slot',
+        contactPreferences: { sms: true }
+      })));
+    }
+
+    test('should book the slot once when every offered patient accepts concurrently', async () => {
+      const source = await cancelledAppointment();
+      await waitingEntries(3);
+      const backfill = mongoEngine();
+
+      expect((await backfill.slotFreed(source.toObject(), 'cancelled')).started).toBe(true);
+      const offered = await WaitingList.find({ clinic }).lean();
+      expect(offered.every(e => e.status === 'notified' && e.notifications.length === 1)).toBe(true);
+
+      const results = await Promise.all(offered.map(e => backfill.respond(e._id, e.notifications[0]._id, true)));
+
+      const booked = results.filter(result => result.status === 'booked');
+      expect(booked).toHaveLength(1);
+      // Losers either lost the claim or were superseded before locking their offer
+      expect(results.filter(result => result.status !== 'booked').every(result => ['taken', 'expired'].includes(result.status))).toBe(true);
+
+      const replacements = await Appointment.find({ provider, source: 'waitlist' }).lean();
+      expect(replacements).toHaveLength(1);
+      const after = await Appointment.findById(source._id).lean();
+      expect(after.backfill.status).toBe('filled');
+      expect(String(after.backfill.replacementAppointment)).toBe(String(replacements[0]._id));
+
+      const entries = await WaitingList.find({ clinic }).lean();
+      expect(entries.filter(e => e.status === 'scheduled')).toHaveLength(1);
+      expect(entries.filter(e => e.status === 'waiting')).toHaveLength(2);
+      expect(entries.flatMap(e => e.notifications).filter(offer => offer.response === 'pending')).toHaveLength(0);
+      backfill.stop();
+    });
+
+    test('should start one backfill when two processes free the same slot', async () => {
+      const source = await cancelledAppointment();
+      await waitingEntries(2);
+      const [first, second] = [mongoEngine(), mongoEngine()];
+
+      const results = await Promise.all([
+        first.slotFreed(source.toObject(), 'cancelled'),
+        second.slotFreed(source.toObject(), 'cancelled')
+      ]);
+
+      expect(results.filter(result => result.started)).toHaveLength(1);
+      expect(results.find(result => !result.started).reason).toBe('already-running');
+      const offers = (await WaitingList.find({ clinic }).lean()).flatMap(e => e.notifications);
+      expect(offers).toHaveLength(2);
+      first.stop();
+      second.stop();
+    });
+  });
+});
@@ -18,6 +18,8 @@
  * }
  */
 
+const { sendSerialized } = require('./jsonSerializer');
+
 /**
  * Send a successful response
  * @param {Response} res - Express response object
@@ -27,6 +29,7 @@
  * @param {any} [options.data] - Response data
  * @param {Object} [options.pagination] - Pagination info
  * @param {Object} [options.meta] - Additional metadata
+ * @param {Function} [options.serializer] - Compiled serializer (utils/responseSchemas) used instead of res.json
  */
 const success = (res, options = {}) => {
   const {
@@ -34,7 +37,8 @@ const success = (res, options = {}) => {
     message = '',
     data = null,
     pagination = null,
-    meta = {}
+    meta = {},
+    serializer = null
   } = options;
 
   const response = {
@@ -48,6 +52,9 @@ const success = (res, options = {}) => {
     }
   };
 
+  if (serializer) {
+    return sendSerialized(res, serializer, response, statusCode);
+  }
   return res.status(statusCode).json(response);
 };
 
@@ -65,7 +72,7 @@ const success = (res, options = {}) => {
  * @param {number} [totalArg] - Total (for legacy calls)
  */
 const paginated = (res, dataOrOptions, optionsOrPage, limitArg, totalArg) => {
-  let data, page, limit, total, message, statusCode, meta;
+  let data, page, limit, total, message, statusCode, meta, serializer;
 
   // Detect calling convention
   if (Array.isArray(dataOrOptions)) {
@@ -74,7 +81,7 @@ const paginated = (res, dataOrOptions, optionsOrPage, limitArg, totalArg) => {
 
     if (typeof optionsOrPage === 'object' && optionsOrPage !== null) {
       // paginated(res, data, { page, limit, total })
-      ({ page = 1, limit = 20, total = 0, message = '', statusCode = 200, meta = {} } = optionsOrPage);
+      ({ page = 1, limit = 20, total = 0, message = '', statusCode = 200, meta = {}, serializer } = optionsOrPage);
     } else {
       // paginated(res, data, page, limit, total) - legacy
       page = optionsOrPage || 1;
@@ -93,7 +100,8 @@ const paginated = (res, dataOrOptions, optionsOrPage, limitArg, totalArg) => {
       total = 0,
       message = '',
       statusCode = 200,
-      meta = {}
+      meta = {},
+      serializer
     } = dataOrOptions);
   } else {
     // Fallback
@@ -117,7 +125,8 @@ const paginated = (res, dataOrOptions, optionsOrPage, limitArg, totalArg) => {
       pages: Math.ceil(total / limit),
       hasMore: page * limit < total
     },
-    meta
+    meta,
+    serializer
   });
 };
 
@@ -0,0 +1,56 @@
+/**
+ * Catalog Change Tracker
+ *
+ * Mongoose plugin that reports writes to reference-data (catalog) collections.
+ * The catalog snapshot service listens for these events to rebuild its versioned
+ * bundle; models don't need to know about the service (no circular requires).
+ *
+ * @example
+ * medicationTemplateSchema.plugin(catalogChangePlugin, { catalog: 'medications' });
+ */
+
+const { EventEmitter } = require('events');
+
+const catalogChanges = new EventEmitter();
+catalogChanges.setMaxListeners(20);
+
+const QUERY_WRITE_OPS = [
+  'updateOne',
+  'updateMany',
+  'findOneAndUpdate',
+  'findOneAndReplace',
+  'findOneAndDelete',
+  'replaceOne',
+  'deleteOne',
+  'deleteMany'
+];
+
+/**
+ * Emit a 'change' event for the catalog
+ * @param {string} catalog - Catalog name (e.g. 'medications')
+ * @param {string} operation - Mongoose operation that triggered the change
+ */
+function notifyCatalogChange(catalog, operation) {
+  catalogChanges.emit('change', { catalog, operation, at: new Date() });
+}
+
+function catalogChangePlugin(schema, options = {}) {
+  const { catalog } = options;
+  if (!catalog) {
+    throw new Error('catalogChangePlugin requires a catalog name');
+  }
+
+  schema.post('save', () => notifyCatalogChange(catalog, 'save'));
+  schema.post('insertMany', () => notifyCatalogChange(catalog, 'insertMany'));
+  schema.post('deleteOne', { document: true, query: false }, () => notifyCatalogChange(catalog, 'deleteOne'));
+
+  QUERY_WRITE_OPS.forEach(op => {
+    schema.post(op, { document: false, query: true }, () => notifyCatalogChange(catalog, op));
+  });
+}
+
+module.exports = {
+  catalogChangePlugin,
+  catalogChanges,
+  notifyCatalogChange
+};
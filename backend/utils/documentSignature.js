@@ -0,0 +1,245 @@
+/**
+ * Document Signature Utility
+ * Merkle batch signing primitives and the offline QR verifier.
+ *
+ * A signing session hashes each document's canonical claims into a leaf,
+ * builds a Merkle tree (RFC 6962 domain separation: 0x00 leaf, 0x01 node)
+ * and signs the root once with Ed25519. Each QR code carries the claims,
+ * the inclusion proof, the root and the batch signature, so a pharmacy or
+ * insurer holding the clinic's public key list can verify it without any
+ * call to the clinic. Depends only on Node's crypto module so it can be
+ * shipped as-is to verifier apps.
+ */
+
+const crypto = require('crypto');
+
+const QR_PREFIX = 'MF1:';
+const DOCUMENT_DOMAIN = 'MFDOC1\n';
+const BATCH_DOMAIN = 'MFBATCH1\n';
+const ALGORITHM = 'Ed25519';
+
+const sha256 = (...parts) => {
+  const hash = crypto.createHash('sha256');
+  for (const part of parts) hash.update(part);
+  return hash.digest();
+};
+
+const toB64url = buf => Buffer.from(buf).toString('base64url');
+const fromB64url = str => Buffer.from(String(str), 'base64url');
+
+// ============================================
+// CANONICAL FORM
+// ============================================
+
+/**
+ * Deterministic JSON: sorted keys, undefined dropped, dates as ISO strings
+ * @param {*} value
+ * @returns {String}
+ */
+function canonicalize(value) {
+  if (value === null || value === undefined) return 'null';
+  if (value instanceof Date) return JSON.stringify(value.toISOString());
+  if (Array.isArray(value)) return `[${value.map(canonicalize).join(',')}]`;
+  if (typeof value === 'object') {
+    const keys = Object.keys(value).filter(k => value[k] !== undefined).sort();
+    return `{${keys.map(k => `${JSON.stringify(k)}:${canonicalize(value[k])}`).join(',')}}`;
+  }
+  if (typeof value === 'number' && !Number.isFinite(value)) return 'null';
+  return JSON.stringify(value);
+}
+
+/**
+ * SHA-256 digest of a document's canonical claims
+ * @param {Object} claims
+ * @returns {Buffer}
+ */
+function documentDigest(claims) {
+  return sha256(DOCUMENT_DOMAIN, canonicalize(claims));
+}
+
+// ============================================
+// MERKLE TREE
+// ============================================
+
+const leafHash = digest => sha256(Buffer.from([0x00]), digest);
+const nodeHash = (left, right) => sha256(Buffer.from([0x01]), left, right);
+
+/**
+ * Build all levels of a Merkle tree; an unpaired node is promoted unchanged
+ * @param {Buffer[]} digests - Document digests, in leaf order
+ * @returns {Buffer[][]} - levels[0] = leaves, last level = [root]
+ */
+function buildMerkleTree(digests) {
+  if (!digests || digests.length === 0) {
+    throw new Error('Cannot build a Merkle tree without documents');
+  }
+
+  const levels = [digests.map(leafHash)];
+  while (levels[levels.length - 1].length > 1) {
+    const level = levels[levels.length - 1];
+    const next = [];
+    for (let i = 0; i < level.length; i += 2) {
+      next.push(i + 1 < level.length ? nodeHash(level[i], level[i + 1]) : level[i]);
+    }
+    levels.push(next);
+  }
+  return levels;
+}
+
+const merkleRoot = levels => levels[levels.length - 1][0];
+
+/**
+ * Sibling path from a leaf to the root, encoded as 'l.<b64url>' / 'r.<b64url>'
+ * (side of the sibling)
+ * @returns {String[]}
+ */
+function inclusionProof(levels, index) {
+  const proof = [];
+  let position = index;
+  for (let depth = 0; depth < levels.length - 1; depth++) {
+    const level = levels[depth];
+    const sibling = position % 2 === 0 ? position + 1 : position - 1;
+    if (sibling < level.length) {
+      proof.push(`${position % 2 === 0 ? 'r' : 'l'}.${toB64url(level[sibling])}`);
+    }
+    position = Math.floor(position / 2);
+  }
+  return proof;
+}
+
+/**
+ * Recompute the root from a document digest and its inclusion proof
+ * @returns {Buffer}
+ */
+function rootFromProof(digest, proof) {
+  return (proof || []).reduce((hash, step) => {
+    const [side, sibling] = String(step).split('.');
+    const siblingHash = fromB64url(sibling);
+    return side === 'l' ? nodeHash(siblingHash, hash) : nodeHash(hash, siblingHash);
+  }, leafHash(digest));
+}
+
+// ============================================
+// SIGNATURES
+// ============================================
+
+/**
+ * Bytes signed for a batch: binds key, batch, time and root together
+ */
+function batchMessage({ keyId, batchId, signedAt, root }) {
+  const rootB64 = Buffer.isBuffer(root) ? toB64url(root) : root;
+  const time = signedAt instanceof Date ? signedAt.toISOString() : signedAt;
+  return Buffer.from(`${BATCH_DOMAIN}${keyId}\n${batchId}\n${time}\n${rootB64}`);
+}
+
+/**
+ * Key identifier: first 16 hex chars of SHA-256 over the raw public key
+ */
+function keyIdFor(rawPublicKey) {
+  return sha256(rawPublicKey).toString('hex').slice(0, 16);
+}
+
+/**
+ * Raw 32-byte Ed25519 public key from a KeyObject
+ */
+function rawPublicKey(publicKey) {
+  return fromB64url(publicKey.export({ format: 'jwk' }).x);
+}
+
+const publicKeyCache = new Map();
+function publicKeyFromRaw(raw) {
+  const x = Buffer.isBuffer(raw) ? toB64url(raw) : String(raw);
+  if (!publicKeyCache.has(x)) {
+    publicKeyCache.set(x, crypto.createPublicKey({ key: { kty: 'OKP', crv: ALGORITHM, x }, format: 'jwk' }));
+  }
+  return publicKeyCache.get(x);
+}
+
+// ============================================
+// QR PAYLOAD
+// ============================================
+
+/**
+ * Compact QR text for one signed document
+ */
+function encodeQrPayload({ claims, keyId, batchId, signedAt, root, signature, proof }) {
+  const body = {
+    c: claims,
+    k: keyId,
+    b: batchId,
+    t: signedAt instanceof Date ? signedAt.toISOString() : signedAt,
+    r: Buffer.isBuffer(root) ? toB64url(root) : root,
+    s: Buffer.isBuffer(signature) ? toB64url(signature) : signature,
+    p: proof
+  };
+  return QR_PREFIX + toB64url(Buffer.from(JSON.stringify(body)));
+}
+
+function decodeQrPayload(text) {
+  if (typeof text !== 'string' || !text.startsWith(QR_PREFIX)) return null;
+  try {
+    const body = JSON.parse(fromB64url(text.slice(QR_PREFIX.length)).toString('utf8'));
+    if (!body || typeof body !== 'object' || !body.c || !body.k || !body.s || !body.r) return null;
+    return body;
+  } catch (err) {
+    return null;
+  }
+}
+
+/**
+ * Verify a scanned QR payload entirely offline
+ * @param {String} text - QR text (MF1:...)
+ * @param {Object|Map} trustedKeys - keyId -> { publicKey (raw b64url), revokedAt? } or raw b64url
+ * @returns {Object} - { valid, reason?, claims, keyId, batchId, signedAt }
+ */
+function verifyQrPayload(text, trustedKeys) {
+  const body = decodeQrPayload(text);
+  if (!body) return { valid: false, reason: 'malformed' };
+
+  const result = { claims: body.c, keyId: body.k, batchId: body.b, signedAt: body.t };
+  const entry = trustedKeys instanceof Map ? trustedKeys.get(body.k) : trustedKeys?.[body.k];
+  if (!entry) return { ...result, valid: false, reason: 'unknown-key' };
+
+  const key = typeof entry === 'string' ? { publicKey: entry } : entry;
+  if (key.revokedAt && new Date(body.t) >= new Date(key.revokedAt)) {
+    return { ...result, valid: false, reason: 'key-revoked' };
+  }
+
+  const root = rootFromProof(documentDigest(body.c), body.p);
+  if (toB64url(root) !== body.r) return { ...result, valid: false, reason: 'not-in-batch' };
+
+  let signatureOk = false;
+  try {
+    signatureOk = crypto.verify(
+      null,
+      batchMessage({ keyId: body.k, batchId: body.b, signedAt: body.t, root }),
+      publicKeyFromRaw(key.publicKey),
+      fromB64url(body.s)
+    );
+  } catch (err) {
+    signatureOk = false;
+  }
+  if (!signatureOk) return { ...result, valid: false, reason: 'bad-signature' };
+
+  return { ...result, valid: true };
+}
+
+module.exports = {
+  ALGORITHM,
+  QR_PREFIX,
+  canonicalize,
+  documentDigest,
+  buildMerkleTree,
+  merkleRoot,
+  inclusionProof,
+  rootFromProof,
+  batchMessage,
+  keyIdFor,
+  rawPublicKey,
+  publicKeyFromRaw,
+  encodeQrPayload,
+  decodeQrPayload,
+  verifyQrPayload,
+  toB64url,
+  fromB64url
+};
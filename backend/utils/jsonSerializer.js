@@ -0,0 +1,212 @@
+/**
+ * Schema-Compiled JSON Serializer
+ *
+ * Compiles a response schema (a JSON Schema subset) into a specialized
+ * serializer, so large list responses skip generic JSON.stringify walking
+ * and toJSON calls. Only declared properties are written: anything the
+ * schema does not list (password hashes, 2FA secrets, staff-only notes,
+ * embedded transaction logs) never leaves the server.
+ *
+ * Supported keywords:
+ * - type: object | array | string | number | integer | boolean, or a list
+ *   such as ['string', 'null'] (null always serializes as null)
+ * - properties: declared keys, written in schema order
+ * - additionalProperties: false (default, strip), true (generic) or a schema
+ * - items: schema of array elements
+ * - a schema without type ({}) is serialized generically
+ *
+ * Values are written exactly as JSON.stringify would for the declared keys:
+ * Dates as ISO strings, ObjectIds as hex, anything not matching the declared
+ * type through the generic path. Object serializers read properties directly,
+ * so they also work on Mongoose documents (virtuals such as `id` included
+ * when declared); additionalProperties needs plain objects (lean queries).
+ *
+ * Generated code only contains JSON-quoted property names from the schema
+ * modules and helper calls, never response data.
+ *
+ * @example
+ * const serialize = compileSerializer({ type: 'object', properties: { name: { type: 'string' } } });
+ * sendSerialized(res, serialize, { name: 'Ada', password: 'x' }); // {"name":"Ada"}
+ */
+
+// Characters that need escaping in a JSON string (and lone surrogates)
+// eslint-disable-next-line no-control-regex
+const STRING_ESCAPE = /[\u0000-\u001f"\\\ud800-\udfff]/;
+
+const compiled = new WeakMap();
+
+// ============================================
+// RUNTIME HELPERS (called by generated code)
+// ============================================
+
+const helpers = {
+  /**
+   * Generic path: same output as JSON.stringify, 'null' for values it skips
+   */
+  generic(value) {
+    const json = JSON.stringify(value);
+    return json === undefined ? 'null' : json;
+  },
+
+  string(value) {
+    if (typeof value === 'string') {
+      return STRING_ESCAPE.test(value) ? JSON.stringify(value) : `"${value}"`;
+    }
+    if (value instanceof Date) {
+      return Number.isNaN(value.getTime()) ? 'null' : `"${value.toISOString()}"`;
+    }
+    if (value !== null && typeof value === 'object' && typeof value.toHexString === 'function') {
+      return `"${value.toHexString()}"`;
+    }
+    return helpers.generic(value);
+  },
+
+  number(value) {
+    if (typeof value === 'number') return Number.isFinite(value) ? String(value) : 'null';
+    return helpers.generic(value);
+  },
+
+  boolean(value) {
+    if (value === true) return 'true';
+    if (value === false) return 'false';
+    return helpers.generic(value);
+  },
+
+  /**
+   * Values an object serializer should not walk: arrays, ObjectIds
+   * (unpopulated refs), Dates and anything with its own toJSON other than
+   * a document
+   */
+  opaque(value) {
+    return value === null || typeof value !== 'object' || Array.isArray(value) || value instanceof Date ||
+      typeof value.toHexString === 'function' || (typeof value.toJSON === 'function' && !value.$__);
+  }
+};
+
+// ============================================
+// COMPILER
+// ============================================
+
+function primaryType(schema) {
+  const types = Array.isArray(schema.type) ? schema.type : [schema.type];
+  return types.find(type => type && type !== 'null');
+}
+
+/**
+ * Expression serializing `x` per schema; nested objects/arrays become
+ * separate functions in `fns`
+ */
+function valueExpression(schema, fns) {
+  switch (primaryType(schema || {})) {
+    case 'object':
+      return `f${compileNode(schema, fns)}(x)`;
+    case 'array':
+      return `f${compileNode(schema, fns)}(x)`;
+    case 'string':
+      return 'h.string(x)';
+    case 'number':
+    case 'integer':
+      return 'h.number(x)';
+    case 'boolean':
+      return 'h.boolean(x)';
+    default:
+      return 'h.generic(x)';
+  }
+}
+
+function compileNode(schema, fns) {
+  const index = fns.length;
+  fns.push(null);
+
+  const lines = [];
+  if (primaryType(schema) === 'array') {
+    const item = valueExpression(schema.items, fns);
+    lines.push(
+      'if (!Array.isArray(v)) return h.generic(v);',
+      "let s = '[';",
+      'for (let i = 0; i < v.length; i++) {',
+      "  if (i !== 0) s += ',';",
+      '  const x = v[i];',
+      `  s += x === undefined || typeof x === 'function' ? 'null' : ${item};`,
+      '}',
+      "return s + ']';"
+    );
+  } else {
+    const properties = schema.properties || {};
+    const keys = Object.keys(properties);
+    lines.push(
+      'if (h.opaque(v)) return h.generic(v);',
+      "let s = '{';",
+      'let x;'
+    );
+    for (const key of keys) {
+      const name = JSON.stringify(JSON.stringify(key) + ':');
+      lines.push(
+        `x = v[${JSON.stringify(key)}];`,
+        "if (x !== undefined && typeof x !== 'function') {",
+        `  s += (s.length > 1 ? ',' : '') + ${name} + ${valueExpression(properties[key], fns)};`,
+        '}'
+      );
+    }
+
+    const additional = schema.additionalProperties;
+    if (additional) {
+      const expression = additional === true ? 'h.generic(x)' : valueExpression(additional, fns);
+      lines.push(
+        `const declared = ${JSON.stringify(Object.fromEntries(keys.map(key => [key, 1])))};`,
+        'for (const key of Object.keys(v)) {',
+        '  if (declared[key] === 1) continue;',
+        '  x = v[key];',
+        "  if (x === undefined || typeof x === 'function' || typeof x === 'symbol') continue;",
+        `  s += (s.length > 1 ? ',' : '') + JSON.stringify(key) + ':' + ${expression};`,
+        '}'
+      );
+    }
+    lines.push("return s + '}';");
+  }
+
+  fns[index] = `function f${index}(v) {\n${lines.join('\n')}\n}`;
+  return index;
+}
+
+/**
+ * Compile a response schema into a serializer (cached per schema object)
+ * @param {Object} schema
+ * @returns {Function} value => JSON string
+ */
+function compileSerializer(schema) {
+  if (compiled.has(schema)) return compiled.get(schema);
+
+  const fns = [];
+  const type = primaryType(schema);
+  let serialize;
+  if (type === 'object' || type === 'array') {
+    compileNode(schema, fns);
+    // eslint-disable-next-line no-new-func
+    serialize = new Function('h', `${fns.join('\n')}\nreturn f0;`)(helpers);
+  } else {
+    // eslint-disable-next-line no-new-func
+    serialize = new Function('h', `return function f0(x) { return ${valueExpression(schema, fns)}; };`)(helpers);
+  }
+
+  compiled.set(schema, serialize);
+  return serialize;
+}
+
+/**
+ * Send a body through a compiled serializer instead of res.json
+ * @param {Response} res - Express response
+ * @param {Function} serialize - From compileSerializer()
+ * @param {any} body
+ * @param {number} [statusCode]
+ */
+function sendSerialized(res, serialize, body, statusCode) {
+  if (statusCode) res.status(statusCode);
+  res.set('Content-Type', 'application/json; charset=utf-8');
+  return res.send(serialize(body));
+}
+
+module.exports = {
+  compileSerializer,
+  sendSerialized
+};
@@ -0,0 +1,120 @@
+/**
+ * Password Hash Utility
+ * Synchronous hash/verify primitives run inside the password hash workers.
+ *
+ * New hashes use scrypt (Node native crypto) in a PHC-style string:
+ *   $scrypt$ln=14,r=8,p=1$<salt>$<hash>
+ * Legacy bcrypt hashes ($2a$ / $2b$ / $2y$) remain verifiable and are
+ * reported by needsRehash so they are upgraded on the next successful login.
+ */
+
+const crypto = require('crypto');
+
+// Interactive-login profile (N=2^14, r=8, p=1): 16 MiB and roughly the CPU
+// cost of bcrypt 10 per hash, so a full worker pool stays well under the
+// PM2 memory limit
+const SCRYPT_PARAMS = { ln: 14, r: 8, p: 1 };
+const KEY_LENGTH = 32;
+const SALT_BYTES = 16;
+const SCRYPT_MAXMEM = 64 * 1024 * 1024;
+
+const BCRYPT_PATTERN = /^\$2[aby]\$(\d{2})\$/;
+const SCRYPT_PATTERN = /^\$scrypt\$ln=(\d+),r=(\d+),p=(\d+)\$([A-Za-z0-9+/]+)\$([A-Za-z0-9+/]+)$/;
+
+// Loaded on first legacy hash only; new installs never need it
+let bcrypt = null;
+function getBcrypt() {
+  if (!bcrypt) bcrypt = require('bcryptjs');
+  return bcrypt;
+}
+
+/**
+ * Identify the algorithm and parameters of a stored hash
+ * @param {String} stored - Stored password hash
+ * @returns {Object|null} - { algorithm, ... } or null when unrecognized
+ */
+function parseHash(stored) {
+  if (typeof stored !== 'string') return null;
+
+  const bcryptMatch = stored.match(BCRYPT_PATTERN);
+  if (bcryptMatch) {
+    return { algorithm: 'bcrypt', cost: parseInt(bcryptMatch[1], 10) };
+  }
+
+  const scryptMatch = stored.match(SCRYPT_PATTERN);
+  if (scryptMatch) {
+    return {
+      algorithm: 'scrypt',
+      params: {
+        ln: parseInt(scryptMatch[1], 10),
+        r: parseInt(scryptMatch[2], 10),
+        p: parseInt(scryptMatch[3], 10)
+      },
+      salt: Buffer.from(scryptMatch[4], 'base64'),
+      hash: Buffer.from(scryptMatch[5], 'base64')
+    };
+  }
+
+  return null;
+}
+
+function scrypt(password, salt, params, keyLength) {
+  return crypto.scryptSync(String(password), salt, keyLength, {
+    N: 2 ** params.ln,
+    r: params.r,
+    p: params.p,
+    maxmem: SCRYPT_MAXMEM
+  });
+}
+
+/**
+ * Hash a password with the current scrypt parameters
+ * @param {String} password - Plain text password
+ * @returns {String} - PHC-style scrypt hash
+ */
+function hashPasswordSync(password, params = SCRYPT_PARAMS) {
+  const salt = crypto.randomBytes(SALT_BYTES);
+  const hash = scrypt(password, salt, params, KEY_LENGTH);
+  const encode = buf => buf.toString('base64').replace(/=+$/, '');
+  return `$scrypt$ln=${params.ln},r=${params.r},p=${params.p}$${encode(salt)}$${encode(hash)}`;
+}
+
+/**
+ * Verify a password against a scrypt or legacy bcrypt hash
+ * @param {String} password - Plain text password
+ * @param {String} stored - Stored password hash
+ * @returns {Boolean}
+ */
+function verifyPasswordSync(password, stored) {
+  const parsed = parseHash(stored);
+  if (!parsed) return false;
+
+  if (parsed.algorithm === 'bcrypt') {
+    return getBcrypt().compareSync(String(password), stored);
+  }
+
+  const candidate = scrypt(password, parsed.salt, parsed.params, parsed.hash.length);
+  return crypto.timingSafeEqual(candidate, parsed.hash);
+}
+
+/**
+ * Whether a stored hash should be replaced with one using the current parameters
+ * @param {String} stored - Stored password hash
+ * @returns {Boolean}
+ */
+function needsRehash(stored, params = SCRYPT_PARAMS) {
+  const parsed = parseHash(stored);
+  if (!parsed || parsed.algorithm !== 'scrypt') return true;
+  return parsed.params.ln !== params.ln ||
+    parsed.params.r !== params.r ||
+    parsed.params.p !== params.p ||
+    parsed.hash.length !== KEY_LENGTH;
+}
+
+module.exports = {
+  SCRYPT_PARAMS,
+  parseHash,
+  hashPasswordSync,
+  verifyPasswordSync,
+  needsRehash
+};
@@ -0,0 +1,414 @@
+/**
+ * Response Schemas for High-Volume List Endpoints
+ *
+ * Each schema is an allowlist compiled once into a serializer (see
+ * jsonSerializer.js). Fields that are not declared are stripped, e.g.:
+ * - users: password history, 2FA secrets/backup codes, reset and
+ *   verification tokens, sessions, lockout counters
+ * - appointments: staff-only internal notes, reminder delivery errors,
+ *   status history, billing and feedback sub-documents
+ * - inventory: embedded transaction log, price and usage histories
+ *
+ * Endpoints without a schema keep res.json. When a list screen needs a new
+ * field, add it here or it will not reach the client.
+ */
+
+const { compileSerializer } = require('./jsonSerializer');
+
+// ============================================
+// FRAGMENTS
+// ============================================
+
+const string = { type: ['string', 'null'] };
+const number = { type: ['number', 'null'] };
+const boolean = { type: ['boolean', 'null'] };
+// ObjectId, or the populated document when a query populates the ref
+const ref = {};
+const date = string;
+const stringList = { type: 'array', items: string };
+const any = {};
+
+const personRef = {
+  type: ['object', 'null'],
+  properties: {
+    _id: string,
+    id: string,
+    firstName: string,
+    lastName: string,
+    fullName: string,
+    patientId: string,
+    phoneNumber: string,
+    specialization: string
+  }
+};
+
+const pagination = {
+  type: 'object',
+  properties: {
+    page: number,
+    limit: number,
+    total: number,
+    pages: number,
+    hasMore: boolean
+  }
+};
+
+/**
+ * Standard apiResponse.success() envelope around a data schema
+ */
+function envelope(data) {
+  return {
+    type: 'object',
+    properties: {
+      success: boolean,
+      message: string,
+      data,
+      pagination,
+      meta: { type: 'object', additionalProperties: true }
+    }
+  };
+}
+
+// ============================================
+// QUEUE
+// ============================================
+
+const queueEntry = {
+  type: 'object',
+  properties: {
+    queueNumber: number,
+    patient: personRef,
+    provider: personRef,
+    appointmentId: string,
+    visitId: string,
+    checkInTime: date,
+    status: string,
+    priority: string,
+    estimatedWaitTime: number,
+    actualWaitTime: number,
+    positionInQueue: number,
+    room: any
+  }
+};
+
+const queueList = envelope({
+  type: 'object',
+  properties: {
+    // Keyed by department
+    queues: { type: 'object', additionalProperties: { type: 'array', items: queueEntry } },
+    stats: { type: 'object', additionalProperties: true },
+    timestamp: date
+  }
+});
+
+// ============================================
+// APPOINTMENTS
+// ============================================
+
+const appointment = {
+  type: 'object',
+  properties: {
+    _id: string,
+    id: string,
+    appointmentId: string,
+    patient: personRef,
+    provider: personRef,
+    requestedProvider: ref,
+    clinic: ref,
+    date,
+    startTime: string,
+    endTime: string,
+    duration: number,
+    type: string,
+    subType: string,
+    department: string,
+    service: ref,
+    status: string,
+    priority: string,
+    reason: string,
+    symptoms: stringList,
+    chiefComplaint: string,
+    notes: string,
+    location: any,
+    queueNumber: number,
+    checkInTime: date,
+    waitingTime: number,
+    consultationStartTime: date,
+    consultationEndTime: date,
+    isRecurring: boolean,
+    recurrence: any,
+    preparation: any,
+    outcome: any,
+    cancellation: {
+      type: 'object',
+      properties: { cancelledAt: date, cancelledBy: ref, reason: string, fee: number }
+    },
+    rescheduled: any,
+    confirmation: {
+      type: 'object',
+      properties: { required: boolean, confirmed: boolean, confirmedAt: date, confirmedBy: string, method: string }
+    },
+    source: string,
+    visit: ref,
+    relatedSurgery: ref,
+    relatedGlassesOrder: ref,
+    isToday: boolean,
+    isPast: boolean,
+    isFuture: boolean,
+    version: number,
+    createdAt: date,
+    updatedAt: date
+  }
+};
+
+const appointmentList = { type: 'array', items: appointment };
+
+// GET /api/appointments (date pages)
+const appointmentPage = {
+  type: 'object',
+  properties: {
+    success: boolean,
+    count: number,
+    total: number,
+    pages: number,
+    currentPage: number,
+    data: appointmentList
+  }
+};
+
+// GET /api/appointments/today
+const appointmentDay = {
+  type: 'object',
+  properties: {
+    success: boolean,
+    stats: { type: 'object', additionalProperties: true },
+    data: appointmentList
+  }
+};
+
+// ============================================
+// PHARMACY INVENTORY
+// ============================================
+
+const pricing = {
+  type: ['object', 'null'],
+  properties: {
+    costPrice: number,
+    sellingPrice: number,
+    wholesalePrice: number,
+    margin: number,
+    currency: string,
+    taxRate: number,
+    lastPriceUpdate: date
+  }
+};
+
+const batch = {
+  type: 'object',
+  properties: {
+    _id: string,
+    lotNumber: string,
+    quantity: number,
+    expirationDate: date,
+    receivedDate: date,
+    cost: number,
+    supplier: ref,
+    supplierName: string,
+    purchaseOrderNumber: string,
+    notes: string,
+    status: string,
+    isDeleted: boolean
+  }
+};
+
+const inventoryItem = {
+  type: 'object',
+  properties: {
+    _id: string,
+    inventoryType: string,
+    clinic: ref,
+    isDepot: boolean,
+    sku: string,
+    barcode: string,
+    name: string,
+    brand: string,
+    manufacturer: string,
+    description: string,
+    category: string,
+    categoryFr: string,
+    subcategory: string,
+    drug: ref,
+    medication: any,
+    genericName: string,
+    dosageForm: string,
+    strength: string,
+    strengthUnit: string,
+    routeOfAdministration: stringList,
+    controlled: boolean,
+    controlledSchedule: string,
+    storageConditions: any,
+    prescriptionRequired: boolean,
+    therapeuticClass: string,
+    pharmacologicalClass: string,
+    interactionWarnings: stringList,
+    contraindications: stringList,
+    inventory: {
+      type: 'object',
+      properties: {
+        currentStock: number,
+        reserved: number,
+        available: number,
+        unit: string,
+        minimumStock: number,
+        reorderPoint: number,
+        maximumStock: number,
+        status: string
+      }
+    },
+    batches: { type: 'array', items: batch },
+    pricing,
+    suppliers: { type: 'array', items: any },
+    reorder: any,
+    usage: {
+      type: 'object',
+      properties: {
+        totalDispensed: number,
+        totalReceived: number,
+        totalAdjusted: number,
+        lastUsedDate: date,
+        lastReceivedDate: date,
+        averageMonthlyUsage: number
+      }
+    },
+    alerts: { type: 'array', items: any },
+    location: any,
+    active: boolean,
+    discontinued: boolean,
+    discontinuedDate: date,
+    discontinuedReason: string,
+    typeData: any,
+    // All-clinics aggregation
+    clinicCount: number,
+    version: number,
+    createdAt: date,
+    updatedAt: date
+  }
+};
+
+const inventoryPage = envelope({ type: 'array', items: inventoryItem });
+
+const medicationSearch = envelope({
+  type: 'array',
+  items: {
+    type: 'object',
+    properties: {
+      drugId: string,
+      brandName: string,
+      genericName: string,
+      category: string,
+      form: string,
+      strength: string,
+      route: any,
+      activeIngredients: any,
+      inventory: {
+        type: ['object', 'null'],
+        properties: {
+          inventoryId: string,
+          currentStock: number,
+          reserved: number,
+          available: number,
+          reorderLevel: number,
+          pricing,
+          status: string
+        }
+      },
+      inStock: boolean
+    }
+  }
+});
+
+// ============================================
+// OFFLINE SYNC
+// ============================================
+
+const syncUser = {
+  type: 'object',
+  properties: {
+    _id: string,
+    id: string,
+    lastModified: date,
+    username: string,
+    email: string,
+    firstName: string,
+    lastName: string,
+    phoneNumber: string,
+    gender: string,
+    role: string,
+    specialization: string,
+    licenseNumber: string,
+    department: string,
+    employeeId: string,
+    clinics: { type: 'array', items: ref },
+    primaryClinic: ref,
+    accessAllClinics: boolean,
+    isActive: boolean,
+    permissions: { type: 'array', items: any },
+    avatar: string,
+    signature: string,
+    languages: stringList,
+    preferences: any,
+    isDeleted: boolean,
+    createdAt: date,
+    updatedAt: date
+  }
+};
+
+// Changed records per entity; entities other than users are lean records passed through as-is
+const syncChanges = {
+  type: 'object',
+  properties: {
+    users: { type: 'array', items: syncUser }
+  },
+  additionalProperties: true
+};
+
+// POST /api/sync/pull
+const syncPull = {
+  type: 'object',
+  properties: {
+    success: boolean,
+    changes: syncChanges,
+    serverTime: date
+  }
+};
+
+// POST /api/sync/bulk
+const syncBulk = {
+  type: 'object',
+  properties: {
+    success: boolean,
+    push: { type: 'object', additionalProperties: true },
+    pull: { type: 'object', properties: { changes: syncChanges } },
+    serverTime: date
+  }
+};
+
+const schemas = {
+  queueList,
+  appointmentPage,
+  appointmentDay,
+  inventoryPage,
+  medicationSearch,
+  syncPull,
+  syncBulk
+};
+
+const serializers = Object.fromEntries(
+  Object.entries(schemas).map(([name, schema]) => [name, compileSerializer(schema)])
+);
+
+module.exports = {
+  schemas,
+  serializers,
+  envelope
+};
@@ -15,10 +15,13 @@ module.exports = {
       instances: 1,
       exec_mode: 'fork',
       watch: false,
+      // The memory watchdog restarts cleanly at 90% of MEMORY_LIMIT_MB after
+      // writing a heap profile report; keep both limits equal
       max_memory_restart: '500M',
       env: {
         NODE_ENV: 'production',
         PORT: 5002,
+        MEMORY_LIMIT_MB: 500,
         FRONTEND_PATH: 'E:\\MedFlow\\frontend\\dist'
       },
       // Log configuration
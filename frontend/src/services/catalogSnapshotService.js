@@ -0,0 +1,181 @@
+/**
+ * Catalog Snapshot Service
+ * Keeps a local IndexedDB copy of the template catalog (reference data)
+ *
+ * Strategy:
+ * - First load: download the full gzip snapshot once
+ * - Afterwards: apply deltas since the stored version
+ * - Server pushes 'catalog:changed' over WebSocket when the version moves
+ * - Template pickers read locally (works offline, no per-keystroke requests)
+ */
+
+import api from './apiConfig';
+import { db } from './database';
+import websocketService from './websocketService';
+
+const META_KEY = 'catalogSnapshot';
+
+class CatalogSnapshotService {
+  constructor() {
+    this.version = null;
+    this.syncPromise = null;
+    this.initPromise = null;
+    this.unsubscribe = null;
+  }
+
+  /**
+   * Load the stored version and subscribe to server change notifications
+   */
+  init() {
+    if (!this.initPromise) {
+      this.initPromise = this._init().catch((error) => {
+        this.initPromise = null;
+        throw error;
+      });
+    }
+    return this.initPromise;
+  }
+
+  async _init() {
+    const meta = await db.catalogMeta.get(META_KEY);
+    this.version = meta?.version ?? null;
+
+    this.unsubscribe = websocketService.on('catalog:changed', (data) => {
+      if (data?.version && data.version !== this.version) {
+        this.sync().catch(err => console.error('[CatalogSnapshot] Sync after change failed:', err));
+      }
+    });
+
+    if (navigator.onLine) {
+      this.sync().catch(err => console.error('[CatalogSnapshot] Initial sync failed:', err));
+    }
+  }
+
+  dispose() {
+    if (this.unsubscribe) {
+      this.unsubscribe();
+      this.unsubscribe = null;
+    }
+    this.initPromise = null;
+  }
+
+  /**
+   * Bring the local copy up to date (concurrent callers share one request)
+   */
+  sync() {
+    if (!this.syncPromise) {
+      this.syncPromise = this._sync().finally(() => {
+        this.syncPromise = null;
+      });
+    }
+    return this.syncPromise;
+  }
+
+  async _sync() {
+    if (this.version === null) {
+      const meta = await db.catalogMeta.get(META_KEY);
+      this.version = meta?.version ?? null;
+    }
+
+    if (this.version === null) {
+      const response = await api.get('/template-catalog/snapshot');
+      await this._applyFull(response.data);
+      return this.version;
+    }
+
+    const response = await api.get('/template-catalog/snapshot/delta', {
+      params: { since: this.version }
+    });
+    const delta = response.data?.data;
+    if (!delta) return this.version;
+
+    if (delta.full) {
+      await this._applyFull(delta);
+    } else if (delta.version !== this.version) {
+      await this._applyDelta(delta);
+    }
+    return this.version;
+  }
+
+  async _applyFull(snapshot) {
+    const rows = [];
+    Object.entries(snapshot.catalogs || {}).forEach(([catalog, items]) => {
+      items.forEach(item => rows.push(this._toRow(catalog, item)));
+    });
+
+    await db.transaction('rw', db.catalogItems, db.catalogMeta, async () => {
+      await db.catalogItems.clear();
+      await db.catalogItems.bulkPut(rows);
+      await db.catalogMeta.put({ key: META_KEY, version: snapshot.version, syncedAt: Date.now() });
+    });
+    this.version = snapshot.version;
+  }
+
+  async _applyDelta(delta) {
+    await db.transaction('rw', db.catalogItems, db.catalogMeta, async () => {
+      for (const [catalog, change] of Object.entries(delta.changes || {})) {
+        if (change.deletes?.length) {
+          await db.catalogItems.bulkDelete(change.deletes.map(id => [catalog, id]));
+        }
+        if (change.upserts?.length) {
+          await db.catalogItems.bulkPut(change.upserts.map(item => this._toRow(catalog, item)));
+        }
+      }
+      await db.catalogMeta.put({ key: META_KEY, version: delta.version, syncedAt: Date.now() });
+    });
+    this.version = delta.version;
+  }
+
+  _toRow(catalog, item) {
+    return { catalog, id: item._id, category: item.category ?? null, data: item };
+  }
+
+  /**
+   * Whether a local snapshot has been downloaded
+   */
+  hasSnapshot() {
+    return this.version !== null;
+  }
+
+  /**
+   * Query a catalog locally with the same semantics as the list endpoints
+   * @param {string} catalog - 'medications', 'examinations', 'pathologies', ...
+   * @param {Object} options - { filters, search, searchFields, limit, sortBy }
+   * @returns {Promise<Object|null>} { success, count, data } or null without a snapshot
+   */
+  async query(catalog, { filters = {}, search, searchFields = ['name'], limit = 100, sortBy = ['category', 'name'] } = {}) {
+    if (!this.hasSnapshot()) return null;
+
+    let items = (await db.catalogItems.where('catalog').equals(catalog).toArray()).map(row => row.data);
+
+    Object.entries(filters).forEach(([field, value]) => {
+      if (value !== undefined && value !== null && value !== '') {
+        items = items.filter(item => String(item[field]) === String(value));
+      }
+    });
+
+    if (search) {
+      const needle = search.toLowerCase();
+      items = items.filter(item => searchFields.some(field => {
+        const value = item[field];
+        if (Array.isArray(value)) return value.some(v => String(v).toLowerCase().includes(needle));
+        return value != null && String(value).toLowerCase().includes(needle);
+      }));
+    }
+
+    items.sort((a, b) => {
+      for (const field of sortBy) {
+        const cmp = String(a[field] ?? '').localeCompare(String(b[field] ?? ''));
+        if (cmp !== 0) return cmp;
+      }
+      return 0;
+    });
+
+    const data = items.slice(0, parseInt(limit, 10));
+    return { success: true, count: data.length, data, source: 'snapshot' };
+  }
+}
+
+const catalogSnapshotService = new CatalogSnapshotService();
+
+export default catalogSnapshotService;
@@ -6,6 +6,9 @@
  * - SHA-256 hash function
  * - 256-bit derived key for AES-256
  *
+ * A second, independent HMAC key is derived from the same credentials (with
+ * a labelled salt) for blind search indexes over encrypted fields.
+ *
  * Key storage:
  * - Keys stored in sessionStorage (cleared on tab close)
  * - Never stored in localStorage (persists too long)
@@ -19,6 +22,7 @@ const PBKDF2_ITERATIONS = 100000;
 const KEY_LENGTH = 256; // bits
 const HASH_ALGORITHM = 'SHA-256';
 const SALT_LENGTH = 16; // bytes
+const INDEX_KEY_LABEL = 'medflow-blind-index';
 
 // Session storage keys
 const KEY_STORAGE_KEY = 'medflow_encryption_key';
@@ -102,6 +106,52 @@ async function deriveKey(userId, sessionToken, salt) {
   return derivedKey;
 }
 
+/**
+ * Derive the HMAC key used for blind index tokens
+ * Same credentials as the encryption key, distinct salt label so neither key
+ * reveals anything about the other.
+ * @param {string} userId
+ * @param {string} sessionToken
+ * @param {Uint8Array} salt
+ * @returns {Promise<CryptoKey>}
+ */
+async function deriveIndexKey(userId, sessionToken, salt) {
+  if (!isCryptoSupported()) {
+    throw new Error('Web Crypto API not supported');
+  }
+
+  const encoder = new TextEncoder();
+  const label = encoder.encode(INDEX_KEY_LABEL);
+  const indexSalt = new Uint8Array(salt.length + label.length);
+  indexSalt.set(salt);
+  indexSalt.set(label, salt.length);
+
+  const baseKey = await crypto.subtle.importKey(
+    'raw',
+    encoder.encode(`${userId}:${sessionToken}`),
+    'PBKDF2',
+    false,
+    ['deriveKey']
+  );
+
+  return crypto.subtle.deriveKey(
+    {
+      name: 'PBKDF2',
+      salt: indexSalt,
+      iterations: PBKDF2_ITERATIONS,
+      hash: HASH_ALGORITHM
+    },
+    baseKey,
+    {
+      name: 'HMAC',
+      hash: HASH_ALGORITHM,
+      length: KEY_LENGTH
+    },
+    false,
+    ['sign']
+  );
+}
+
 /**
  * Export a CryptoKey to a storable format
  * @param {CryptoKey} key
@@ -132,6 +182,7 @@ async function importKey(keyHex) {
 class KeyManager {
   constructor() {
     this.currentKey = null;
+    this.indexKey = null;
     this.userId = null;
     this.initialized = false;
   }
@@ -166,8 +217,11 @@ class KeyManager {
         sessionStorage.setItem(SALT_STORAGE_KEY, bytesToHex(salt));
       }
 
-      // Derive the encryption key
-      this.currentKey = await deriveKey(userId, sessionToken, salt);
+      // Derive the encryption and blind index keys
+      [this.currentKey, this.indexKey] = await Promise.all([
+        deriveKey(userId, sessionToken, salt),
+        deriveIndexKey(userId, sessionToken, salt)
+      ]);
       this.userId = userId;
       this.initialized = true;
 
@@ -196,7 +250,10 @@ class KeyManager {
 
     try {
       const salt = hexToBytes(storedSalt);
-      this.currentKey = await deriveKey(userId, sessionToken, salt);
+      [this.currentKey, this.indexKey] = await Promise.all([
+        deriveKey(userId, sessionToken, salt),
+        deriveIndexKey(userId, sessionToken, salt)
+      ]);
       this.userId = userId;
       this.initialized = true;
 
@@ -220,6 +277,14 @@ class KeyManager {
     return this.currentKey;
   }
 
+  /**
+   * Get the blind index (HMAC) key
+   * @returns {CryptoKey|null}
+   */
+  getIndexKey() {
+    return this.initialized ? this.indexKey : null;
+  }
+
   /**
    * Check if encryption is available
    * @returns {boolean}
@@ -234,6 +299,7 @@ class KeyManager {
    */
   clear() {
     this.currentKey = null;
+    this.indexKey = null;
     this.userId = null;
     this.initialized = false;
 
@@ -261,8 +327,11 @@ class KeyManager {
       const newSalt = generateSalt();
       sessionStorage.setItem(SALT_STORAGE_KEY, bytesToHex(newSalt));
 
-      // Derive new key
-      this.currentKey = await deriveKey(this.userId, sessionToken, newSalt);
+      // Derive new keys
+      [this.currentKey, this.indexKey] = await Promise.all([
+        deriveKey(this.userId, sessionToken, newSalt),
+        deriveIndexKey(this.userId, sessionToken, newSalt)
+      ]);
 
       console.log('[KeyManager] Key rotated successfully');
       return true;
@@ -293,6 +362,7 @@ export default keyManager;
 // Export for testing
 export {
   deriveKey,
+  deriveIndexKey,
   generateSalt,
   bytesToHex,
   hexToBytes,
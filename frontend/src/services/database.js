@@ -9,6 +9,7 @@ import {
   hasSensitiveFields,
   isEncryptionActive
 } from './crypto';
+import { INDEXED_ENTITIES, buildSearchTokens, withSearchTokens } from './offlineSearchIndex';
 
 // Create database instance
 export const db = new Dexie('MedFlowDB');
@@ -328,6 +329,210 @@ db.version(6).stores({
   surgeryCases: 'id, patientId, scheduledDate, status, procedureType, surgeonId, clinicId, lastSync'
 });
 
+// Define database schema - Version 7 (adds template catalog snapshot for offline reference data)
+db.version(7).stores({
+  // User data
+  users: 'id, email, username, role, clinicId, lastSync',
+
+  // Patient data - expanded for offline access
+  patients: 'id, patientId, nationalId, firstName, lastName, phoneNumber, email, lastSync, *allergies',
+
+  // Appointments - includes queue data (queueNumber, checkInTime)
+  appointments: 'id, appointmentId, patientId, providerId, date, status, queueNumber, checkInTime, clinicId, lastSync',
+
+  // Queue view - mirrors appointments for quick queue access
+  queue: 'id, patientId, appointmentId, status, priority, queueNumber, checkInTime, providerId, clinicId, lastSync',
+
+  // Visits - for patient history
+  visits: 'id, visitId, patientId, providerId, date, status, chiefComplaint, clinicId, lastSync',
+
+  // Prescriptions
+  prescriptions: 'id, prescriptionId, patientId, prescriberId, type, status, clinicId, lastSync',
+
+  // Ophthalmology exams
+  ophthalmologyExams: 'id, examId, patientId, examinerId, examType, status, visitId, clinicId, lastSync',
+
+  // Laboratory orders
+  labOrders: 'id, patientId, visitId, status, priority, orderedBy, orderedAt, clinicId, lastSync',
+
+  // Laboratory results
+  labResults: 'id, orderId, patientId, testCode, status, resultedAt, verifiedBy, clinicId, lastSync',
+
+  // Invoices
+  invoices: 'id, invoiceNumber, patientId, visitId, status, dueDate, totalAmount, clinicId, lastSync',
+
+  // Payments
+  payments: 'id, invoiceId, patientId, method, amount, paymentDate, lastSync',
+
+  // Consultation sessions - for multi-step workflow state
+  consultationSessions: 'id, patientId, doctorId, visitId, status, step, lastSync',
+
+  // Devices - for device management and offline access
+  devices: 'id, serialNumber, type, status, clinicId',
+
+  // Sync queue for offline operations - enhanced with nextRetryAt for exponential backoff
+  syncQueue: '++id, timestamp, operation, entity, entityId, data, status, retryCount, lastError, nextRetryAt',
+
+  // Conflict resolution log
+  conflicts: '++id, timestamp, entity, entityId, localData, serverData, resolution, resolvedBy, resolvedAt',
+
+  // Cache metadata
+  cacheMetadata: 'key, timestamp, expiresAt',
+
+  // Settings
+  settings: 'key, value',
+
+  // Notifications
+  notifications: '++id, type, title, message, timestamp, read',
+
+  // Audit log
+  auditLog: '++id, userId, action, entity, entityId, timestamp, details',
+
+  // Images and files
+  files: 'id, patientId, type, name, data, mimeType, size, uploadStatus, lastSync',
+
+  // Multi-clinic offline support stores
+  pharmacyInventory: 'id, medicationName, genericName, category, clinicId, stockLevel, expiryDate, lastSync',
+  orthopticExams: 'id, patientId, visitId, examinerId, status, examDate, clinicId, lastSync',
+  glassesOrders: 'id, patientId, examId, status, orderDate, clinicId, lastSync',
+  frameInventory: 'id, brand, model, sku, category, clinicId, stockLevel, lastSync',
+  contactLensInventory: 'id, brand, type, power, baseCurve, clinicId, stockLevel, lastSync',
+  clinics: 'id, name, type, isHub, syncInterval, lastSync',
+  approvals: 'id, patientId, companyId, actCode, status, expiresAt, clinicId, lastSync',
+  stockReconciliations: 'id, inventoryType, status, clinicId, startedAt, lastSync',
+
+  // Treatment protocols
+  treatmentProtocols: 'id, name, category, diagnosis, createdBy, isSystemWide, clinicId, lastSync',
+
+  // IVT Vials (safety-critical medication tracking)
+  ivtVials: 'id, medication, batchNumber, status, expiryDate, openedAt, clinicId, lastSync',
+
+  // Surgery cases - NEW in version 6
+  surgeryCases: 'id, patientId, scheduledDate, status, procedureType, surgeonId, clinicId, lastSync',
+
+  // Versioned reference-data snapshot (template catalog) - NEW in version 7
+  catalogItems: '[catalog+id], catalog, id, category',
+  catalogMeta: 'key'
+});
+
+// Define database schema - Version 8 (adds offline patient search index)
+db.version(8).stores({
+  // User data
+  users: 'id, email, username, role, clinicId, lastSync',
+
+  // Patient data - expanded for offline access
+  // searchTokens: name prefixes, phonetic keys, phone/ID fragments (blind tokens when encrypted) - NEW in version 8
+  patients: 'id, patientId, nationalId, firstName, lastName, phoneNumber, email, lastSync, *allergies, *searchTokens',
+
+  // Appointments - includes queue data (queueNumber, checkInTime)
+  appointments: 'id, appointmentId, patientId, providerId, date, status, queueNumber, checkInTime, clinicId, lastSync',
+
+  // Queue view - mirrors appointments for quick queue access
+  queue: 'id, patientId, appointmentId, status, priority, queueNumber, checkInTime, providerId, clinicId, lastSync',
+
+  // Visits - for patient history
+  visits: 'id, visitId, patientId, providerId, date, status, chiefComplaint, clinicId, lastSync',
+
+  // Prescriptions
+  prescriptions: 'id, prescriptionId, patientId, prescriberId, type, status, clinicId, lastSync',
+
+  // Ophthalmology exams
+  ophthalmologyExams: 'id, examId, patientId, examinerId, examType, status, visitId, clinicId, lastSync',
+
+  // Laboratory orders
+  labOrders: 'id, patientId, visitId, status, priority, orderedBy, orderedAt, clinicId, lastSync',
+
+  // Laboratory results
+  labResults: 'id, orderId, patientId, testCode, status, resultedAt, verifiedBy, clinicId, lastSync',
+
+  // Invoices
+  invoices: 'id, invoiceNumber, patientId, visitId, status, dueDate, totalAmount, clinicId, lastSync',
+
+  // Payments
+  payments: 'id, invoiceId, patientId, method, amount, paymentDate, lastSync',
+
+  // Consultation sessions - for multi-step workflow state
+  consultationSessions: 'id, patientId, doctorId, visitId, status, step, lastSync',
+
+  // Devices - for device management and offline access
+  devices: 'id, serialNumber, type, status, clinicId',
+
+  // Sync queue for offline operations - enhanced with nextRetryAt for exponential backoff
+  syncQueue: '++id, timestamp, operation, entity, entityId, data, status, retryCount, lastError, nextRetryAt',
+
+  // Conflict resolution log
+  conflicts: '++id, timestamp, entity, entityId, localData, serverData, resolution, resolvedBy, resolvedAt',
+
+  // Cache metadata
+  cacheMetadata: 'key, timestamp, expiresAt',
+
+  // Settings
+  settings: 'key, value',
+
+  // Notifications
+  notifications: '++id, type, title, message, timestamp, read',
+
+  // Audit log
+  auditLog: '++id, userId, action, entity, entityId, timestamp, details',
+
+  // Images and files
+  files: 'id, patientId, type, name, data, mimeType, size, uploadStatus, lastSync',
+
+  // Multi-clinic offline support stores
+  pharmacyInventory: 'id, medicationName, genericName, category, clinicId, stockLevel, expiryDate, lastSync',
+  orthopticExams: 'id, patientId, visitId, examinerId, status, examDate, clinicId, lastSync',
+  glassesOrders: 'id, patientId, examId, status, orderDate, clinicId, lastSync',
+  frameInventory: 'id, brand, model, sku, category, clinicId, stockLevel, lastSync',
+  contactLensInventory: 'id, brand, type, power, baseCurve, clinicId, stockLevel, lastSync',
+  clinics: 'id, name, type, isHub, syncInterval, lastSync',
+  approvals: 'id, patientId, companyId, actCode, status, expiresAt, clinicId, lastSync',
+  stockReconciliations: 'id, inventoryType, status, clinicId, startedAt, lastSync',
+
+  // Treatment protocols
+  treatmentProtocols: 'id, name, category, diagnosis, createdBy, isSystemWide, clinicId, lastSync',
+
+  // IVT Vials (safety-critical medication tracking)
+  ivtVials: 'id, medication, batchNumber, status, expiryDate, openedAt, clinicId, lastSync',
+
+  // Surgery cases - NEW in version 6
+  surgeryCases: 'id, patientId, scheduledDate, status, procedureType, surgeonId, clinicId, lastSync',
+
+  // Versioned reference-data snapshot (template catalog)
+  catalogItems: '[catalog+id], catalog, id, category',
+  catalogMeta: 'key'
+}).upgrade(tx => {
+  // Index patients already cached in clear; encrypted ones are indexed on their next refresh
+  return tx.table('patients').toCollection().modify(patient => {
+    if (!patient._encrypted) {
+      patient.searchTokens = buildSearchTokens('patients', patient);
+    }
+  });
+});
+
+// ============================================
+// SEARCH INDEX HOOKS
+// ============================================
+
+// Plain tokens for every write of a clear record (cache refreshes, sync, queue).
+// Encrypted records carry blind tokens computed before encryption.
+Object.keys(INDEXED_ENTITIES).forEach(entity => {
+  const fields = Object.values(INDEXED_ENTITIES[entity]).flat();
+
+  db[entity].hook('creating', function (primKey, obj) {
+    if (!obj._encrypted && !obj.searchTokens) {
+      obj.searchTokens = buildSearchTokens(entity, obj);
+    }
+  });
+
+  db[entity].hook('updating', function (modifications, primKey, obj) {
+    if ('searchTokens' in modifications) return undefined;
+    if (!fields.some(field => field in modifications)) return undefined;
+    const updated = { ...obj, ...modifications };
+    if (updated._encrypted) return undefined;
+    return { searchTokens: buildSearchTokens(entity, updated) };
+  });
+});
+
 // ============================================
 // QUOTA ERROR HANDLING
 // ============================================
@@ -904,7 +1109,9 @@ class DatabaseService {
     let dataToSave = data;
     if (hasSensitiveFields(entity) && isEncryptionActive()) {
       try {
-        dataToSave = await encryptEntityData(entity, data);
+        // Blind search tokens from the plaintext, stored alongside the ciphertext
+        const [indexed] = await withSearchTokens(entity, [data], { blind: true });
+        dataToSave = await encryptEntityData(entity, indexed);
       } catch (error) {
         console.warn(`[DB] Encryption failed for ${entity}, saving unencrypted:`, error.message);
       }
@@ -991,7 +1198,8 @@ class DatabaseService {
 
     if (hasSensitiveFields(entity) && isEncryptionActive()) {
       try {
-        itemsToSave = await encryptEntityArray(entity, items);
+        const indexed = await withSearchTokens(entity, items, { blind: true });
+        itemsToSave = await encryptEntityArray(entity, indexed);
       } catch (error) {
         console.warn(`[DB] Bulk encryption failed for ${entity}:`, error.message);
       }
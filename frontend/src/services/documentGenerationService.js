@@ -99,6 +99,17 @@ export const bulkGenerateDocuments = async (visitId, data) => {
   }
 };
 
+// Generate the same templates for many visits (e.g. a day's letters)
+export const batchGenerateDocuments = async (data) => {
+  try {
+    const response = await api.post('/document-generation/batch-generate', data);
+    return response.data;
+  } catch (error) {
+    console.error('Error batch generating documents:', error);
+    throw error.response?.data || error;
+  }
+};
+
 export default {
   getTemplates,
   getTemplateById,
@@ -108,5 +119,6 @@ export default {
   generateDocument,
   getVisitDocuments,
   getPatientDocuments,
-  bulkGenerateDocuments
+  bulkGenerateDocuments,
+  batchGenerateDocuments
 };
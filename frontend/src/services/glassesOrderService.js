@@ -334,6 +334,38 @@ const glassesOrderService = {
     return response.data;
   },
 
+  // ============================================
+  // OPTICAL LAB LINK (VCA batch) - ONLINE ONLY
+  // ============================================
+
+  // Transmit all pending orders (or the given ones) to the lab in one session
+  async transmitLabBatch(orderIds) {
+    if (!navigator.onLine) {
+      throw new Error('Lab transmission requires internet connection.');
+    }
+    const response = await api.post('/glasses-orders/lab-link/transmit', { orderIds });
+    return response.data;
+  },
+
+  // Pull lab status / job-completion messages and update orders
+  async pollLabStatus() {
+    if (!navigator.onLine) {
+      throw new Error('Lab status polling requires internet connection.');
+    }
+    const response = await api.post('/glasses-orders/lab-link/poll');
+    return response.data;
+  },
+
+  async getLabLinkStatus() {
+    const response = await api.get('/glasses-orders/lab-link/status');
+    return response.data;
+  },
+
+  async getLabTurnaround(days = 90) {
+    const response = await api.get('/glasses-orders/lab-link/turnaround', { params: { days } });
+    return response.data;
+  },
+
   // ============================================
   // OFFLINE HELPERS
   // ============================================
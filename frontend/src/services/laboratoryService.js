@@ -978,6 +978,38 @@ const laboratoryService = {
     }
   },
 
+  /**
+   * Delta / rate-of-change checks for every component of a result - ONLINE ONLY
+   * @param {string} resultId - Lab result ID
+   * @returns {Promise} Panel delta checks
+   */
+  async getResultDeltaChecks(resultId) {
+    if (!navigator.onLine) {
+      return { success: false, offline: true, message: 'Delta checks require connection' };
+    }
+
+    const response = await api.get(`/laboratory/results/${resultId}/delta-checks`);
+    return response.data;
+  },
+
+  /**
+   * Get cumulative lab report for a patient - WORKS OFFLINE (cached)
+   * @param {string} patientId - Patient ID
+   * @param {Object} params - { testCodes: 'GLU,HBA1C', from, to }
+   * @returns {Promise} Cumulative report grouped by test
+   */
+  async getCumulativeReport(patientId, params = {}) {
+    return offlineWrapper.get(
+      () => api.get(`/laboratory/cumulative/${patientId}`, { params }),
+      'labResults',
+      { type: 'cumulative', patientId, ...params },
+      {
+        transform: (response) => response.data,
+        cacheExpiry: 1800
+      }
+    );
+  },
+
   // ============================================
   // TUBE MANAGEMENT - PARTIAL OFFLINE
   // ============================================
@@ -0,0 +1,285 @@
+/**
+ * Offline Search Index
+ * Token index for searching cached records without scanning the table
+ *
+ * Tokens are computed when a record is cached and stored on it as a Dexie
+ * multiEntry array (searchTokens), so a search is a few index lookups:
+ * - n: normalized name prefixes (accents and case folded)
+ * - p: phonetic keys of whole names (Tshisekedi ~ Tchisekedi, Mukendi ~ Moukendi)
+ * - t: phone number suffixes (last digits, or the number with/without prefix)
+ * - i: patient/national ID prefixes and numeric tails
+ * - e: email prefixes
+ *
+ * Records stored with encrypted fields get blind tokens instead: a keyed
+ * HMAC of each token (key from keyManager), so matching never needs to
+ * decrypt records and the index does not reveal the plaintext.
+ */
+
+import keyManager from './crypto/keyManager';
+
+// ============================================
+// CONSTANTS
+// ============================================
+
+export const SEARCH_TOKENS_FIELD = 'searchTokens';
+
+// Entities with a searchTokens index (see database.js version 8)
+export const INDEXED_ENTITIES = {
+  patients: {
+    names: ['firstName', 'lastName', 'middleName', 'name'],
+    phones: ['phoneNumber', 'alternativePhone'],
+    ids: ['patientId', 'nationalId'],
+    emails: ['email']
+  }
+};
+
+const MIN_PREFIX = 2;
+const MAX_PREFIX = 12;
+const MIN_PHONETIC_LENGTH = 4;
+const MIN_PHONE_FRAGMENT = 4;
+const MIN_ID_FRAGMENT = 3;
+const BLIND_TOKEN_LENGTH = 16; // base64url chars (96 bits)
+const BLIND_PREFIX = 'b:';
+
+// ============================================
+// NORMALIZATION
+// ============================================
+
+/**
+ * Lowercase, strip accents, keep letters/digits as space-separated words
+ * @param {string} text
+ * @returns {string[]}
+ */
+export function normalizeWords(text) {
+  if (text === null || text === undefined) return [];
+  return String(text)
+    .normalize('NFD')
+    .replace(/[\u0300-\u036f]/g, '')
+    .toLowerCase()
+    .replace(/[^a-z0-9]+/g, ' ')
+    .trim()
+    .split(' ')
+    .filter(Boolean);
+}
+
+/**
+ * Phonetic key tuned for French spellings of Congolese and French names
+ * @param {string} word - Normalized word (a-z)
+ * @returns {string} Key, or '' for words too short to be meaningful
+ */
+export function phoneticKey(word) {
+  if (!word || word.length < MIN_PHONETIC_LENGTH || /[^a-z]/.test(word)) return '';
+
+  let w = word
+    .replace(/ph/g, 'f')
+    .replace(/(sch|sh|ch)/g, 'x')
+    .replace(/qu/g, 'k')
+    .replace(/gu(?=[eiy])/g, 'g')
+    .replace(/g(?=[eiy])/g, 'j')
+    .replace(/c(?=[eiy])/g, 's')
+    .replace(/ck|c|q/g, 'k')
+    .replace(/eau|au/g, 'o')
+    .replace(/ai|ei/g, 'e')
+    .replace(/ou/g, 'u')
+    .replace(/y/g, 'i')
+    .replace(/z/g, 's')
+    .replace(/w/g, 'v')
+    .replace(/h/g, '');
+
+  // Silent French endings
+  if (w.length > 3) w = w.replace(/(e|s|t|d|x)+$/, '');
+
+  const first = w[0] || '';
+  const rest = w.slice(1).replace(/[aeiou]/g, '');
+  return (first + rest).replace(/(.)\1+/g, '$1').slice(0, 8);
+}
+
+const digitsOf = value => String(value ?? '').replace(/\D/g, '');
+
+// ============================================
+// TOKENS
+// ============================================
+
+function addPrefixes(tokens, tag, word, min = MIN_PREFIX) {
+  const max = Math.min(word.length, MAX_PREFIX);
+  for (let length = min; length <= max; length++) {
+    tokens.add(`${tag}:${word.slice(0, length)}`);
+  }
+}
+
+function addSuffixes(tokens, tag, value, min) {
+  for (let start = 0; start <= value.length - min; start++) {
+    tokens.add(`${tag}:${value.slice(start)}`);
+  }
+}
+
+/**
+ * Plain search tokens of a record
+ * @param {string} entity - Table name
+ * @param {Object} record - Plaintext record
+ * @returns {string[]}
+ */
+export function buildSearchTokens(entity, record) {
+  const config = INDEXED_ENTITIES[entity];
+  if (!config || !record) return [];
+
+  const tokens = new Set();
+
+  for (const field of config.names) {
+    for (const word of normalizeWords(record[field])) {
+      addPrefixes(tokens, 'n', word);
+      const key = phoneticKey(word);
+      if (key) tokens.add(`p:${key}`);
+    }
+  }
+
+  for (const field of config.phones) {
+    const digits = digitsOf(record[field]).replace(/^0+/, '');
+    if (digits.length >= MIN_PHONE_FRAGMENT) addSuffixes(tokens, 't', digits, MIN_PHONE_FRAGMENT);
+  }
+
+  for (const field of config.ids) {
+    const compact = normalizeWords(record[field]).join('');
+    if (!compact) continue;
+    addPrefixes(tokens, 'i', compact, MIN_ID_FRAGMENT);
+    // Numeric tail, searchable with or without its leading zeros
+    const tail = compact.match(/\d+$/)?.[0] || '';
+    if (tail.length >= MIN_ID_FRAGMENT) addSuffixes(tokens, 'i', tail, MIN_ID_FRAGMENT);
+    const unpadded = tail.replace(/^0+/, '');
+    if (unpadded.length > 0 && unpadded !== tail) tokens.add(`i:${unpadded}`);
+  }
+
+  for (const field of config.emails) {
+    const email = String(record[field] || '').trim().toLowerCase();
+    if (email) addPrefixes(tokens, 'e', email, 3);
+  }
+
+  return [...tokens];
+}
+
+/**
+ * Token groups of a search query: a record matches when it has at least
+ * one token of every group (each typed word must match)
+ * @param {string} query
+ * @returns {string[][]}
+ */
+export function buildQueryGroups(query) {
+  const raw = String(query || '').trim();
+  if (!raw) return [];
+
+  if (raw.includes('@')) {
+    return [[`e:${raw.toLowerCase().slice(0, MAX_PREFIX)}`]];
+  }
+
+  // A phone number typed with spaces or a leading +
+  const phoneDigits = digitsOf(raw).replace(/^0+/, '');
+  if (/^[\d\s+().-]+$/.test(raw) && phoneDigits.length >= MIN_PHONE_FRAGMENT) {
+    const group = [`t:${phoneDigits}`, `i:${phoneDigits.slice(0, MAX_PREFIX)}`];
+    if (digitsOf(raw) !== phoneDigits) group.push(`i:${digitsOf(raw).slice(0, MAX_PREFIX)}`);
+    return [group];
+  }
+
+  // A file number such as PAT-2026-00123
+  const compact = normalizeWords(raw).join('');
+  if (!/\s/.test(raw) && /\d/.test(compact) && /[a-z]/.test(compact)) {
+    return [[`i:${compact.slice(0, MAX_PREFIX)}`]];
+  }
+
+  return normalizeWords(raw).map(word => {
+    const group = [];
+    if (word.length >= MIN_PREFIX) group.push(`n:${word.slice(0, MAX_PREFIX)}`);
+    const key = phoneticKey(word);
+    if (key) group.push(`p:${key}`);
+    if (/\d/.test(word) && word.length >= MIN_ID_FRAGMENT) {
+      group.push(`i:${word.slice(0, MAX_PREFIX)}`);
+      const unpadded = word.replace(/^0+/, '');
+      if (/^\d+$/.test(word) && unpadded && unpadded !== word) group.push(`i:${unpadded}`);
+    }
+    return group;
+  }).filter(group => group.length > 0);
+}
+
+// ============================================
+// BLIND TOKENS
+// ============================================
+
+function toBase64Url(buffer) {
+  const bytes = new Uint8Array(buffer);
+  let binary = '';
+  for (let i = 0; i < bytes.length; i++) binary += String.fromCharCode(bytes[i]);
+  return btoa(binary).replace(/\+/g, '-').replace(/\//g, '_').replace(/=+$/, '');
+}
+
+/**
+ * Keyed blind tokens (HMAC-SHA-256, truncated)
+ * @param {string[]} tokens
+ * @param {CryptoKey} [key] - Defaults to the session's index key
+ * @returns {Promise<string[]>} Empty when no key is available
+ */
+export async function blindTokens(tokens, key = keyManager.getIndexKey()) {
+  if (!key || tokens.length === 0) return [];
+  const encoder = new TextEncoder();
+  const signatures = await Promise.all(
+    tokens.map(token => crypto.subtle.sign('HMAC', key, encoder.encode(token)))
+  );
+  return signatures.map(signature => BLIND_PREFIX + toBase64Url(signature).slice(0, BLIND_TOKEN_LENGTH));
+}
+
+/**
+ * Attach search tokens to records about to be cached
+ * @param {string} entity - Table name
+ * @param {Object[]} records - Plaintext records
+ * @param {Object} options
+ * @param {boolean} options.blind - Records will be stored encrypted: store blind tokens only
+ * @param {CryptoKey} [options.key] - Index key override
+ * @returns {Promise<Object[]>} New record objects with searchTokens set
+ */
+export async function withSearchTokens(entity, records, { blind = false, key } = {}) {
+  if (!INDEXED_ENTITIES[entity]) return records;
+
+  return Promise.all(records.map(async record => {
+    if (!record || typeof record !== 'object') return record;
+    const tokens = buildSearchTokens(entity, record);
+    return {
+      ...record,
+      [SEARCH_TOKENS_FIELD]: blind ? await blindTokens(tokens, key) : tokens
+    };
+  }));
+}
+
+/**
+ * Query token groups including blind variants, so plaintext and encrypted
+ * records are both found
+ * @param {string} query
+ * @param {CryptoKey} [key]
+ * @returns {Promise<string[][]>}
+ */
+export async function searchGroups(query, key = keyManager.getIndexKey()) {
+  const groups = buildQueryGroups(query);
+  if (!key) return groups;
+  return Promise.all(groups.map(async group => [...group, ...await blindTokens(group, key)]));
+}
+
+/**
+ * Run token groups against a Dexie table with a multiEntry searchTokens index
+ * @param {Table} table - Dexie table
+ * @param {string[][]} groups - From searchGroups()
+ * @param {number} limit - Maximum records returned
+ * @returns {Promise<Object[]>}
+ */
+export async function searchTable(table, groups, limit) {
+  if (groups.length === 0) return [];
+
+  let matches = null;
+  for (const group of groups) {
+    const keys = await table.where(SEARCH_TOKENS_FIELD).anyOf(group).primaryKeys();
+    const found = new Set(keys);
+    matches = matches === null
+      ? found
+      : new Set([...matches].filter(primaryKey => found.has(primaryKey)));
+    if (matches.size === 0) return [];
+  }
+
+  const records = await table.bulkGet([...matches].slice(0, limit));
+  return records.filter(Boolean);
+}
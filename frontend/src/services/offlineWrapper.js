@@ -10,6 +10,11 @@
 
 import databaseService, { db } from './database';
 import syncService from './syncService';
+import { INDEXED_ENTITIES, searchGroups, searchTable } from './offlineSearchIndex';
+import { decryptEntityArray, isEncryptionActive } from './crypto';
+
+// Offline search results per query for indexed entities
+const SEARCH_RESULT_LIMIT = 100;
 
 class OfflineWrapper {
   constructor() {
@@ -330,12 +335,26 @@ class OfflineWrapper {
 
   /**
    * Search cached data
+   * Indexed entities (patients) are searched through their token index;
+   * only the matching page is decrypted.
+   * @param {string} entity - Entity type
+   * @param {string} query - Name, phone, ID or email fragment
+   * @param {Object} options
+   * @param {number} options.limit - Maximum results for indexed entities
    */
-  async searchCached(entity, query) {
+  async searchCached(entity, query, { limit = SEARCH_RESULT_LIMIT } = {}) {
     try {
       const table = db[entity];
       if (!table) return [];
 
+      if (INDEXED_ENTITIES[entity]) {
+        const results = await searchTable(table, await searchGroups(query), limit);
+        if (isEncryptionActive() && results.some(item => item._encrypted)) {
+          return await decryptEntityArray(entity, results);
+        }
+        return results;
+      }
+
       const lowerQuery = query.toLowerCase();
 
       return await table.filter(item => {
@@ -2,6 +2,14 @@ import api from './apiConfig';
 import offlineWrapper from './offlineWrapper';
 import { db } from './database';
 
+// Id of one count, generated when it is entered: a count re-sent from the
+// offline queue (or retried after a server error) is recognised server-side
+const newScanId = () => (globalThis.crypto?.randomUUID
+  ? globalThis.crypto.randomUUID()
+  : `${Date.now().toString(36)}-${Math.random().toString(36).slice(2, 12)}`);
+
+const withScanId = (count) => (count.scanId ? count : { ...count, scanId: newScanId() });
+
 const stockReconciliationService = {
   // ============================================
   // READ OPERATIONS - WORKS OFFLINE
@@ -99,7 +107,8 @@ const stockReconciliationService = {
   // ============================================
 
   // Add count for item - WORKS OFFLINE (queued)
-  addCount: async (id, countData) => {
+  addCount: async (id, count) => {
+    const countData = withScanId(count);
     const localData = {
       ...countData,
       reconciliationId: id,
@@ -115,7 +124,8 @@ const stockReconciliationService = {
   },
 
   // Bulk add counts - WORKS OFFLINE (queued)
-  bulkAddCounts: async (id, counts) => {
+  bulkAddCounts: async (id, entries) => {
+    const counts = entries.map(withScanId);
     const localData = {
       reconciliationId: id,
       counts,
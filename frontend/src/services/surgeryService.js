@@ -181,6 +181,33 @@ const surgeryService = {
     return response.data;
   },
 
+  /**
+   * Propose a packed multi-day OR schedule for the awaiting queue - ONLINE ONLY
+   */
+  optimizeSchedule: async (options = {}) => {
+    requireOnline('Optimiser le planning du bloc');
+    const response = await api.post('/surgery/optimizer/plan', options);
+    return response.data;
+  },
+
+  /**
+   * Apply accepted optimizer assignments - ONLINE ONLY (slots are re-validated)
+   */
+  applyOptimizedSchedule: async (assignments) => {
+    requireOnline('Appliquer le planning du bloc');
+    const response = await api.post('/surgery/optimizer/apply', { assignments });
+    return response.data;
+  },
+
+  /**
+   * Get backfill proposals for a cancelled case's OR slot - ONLINE ONLY
+   */
+  getBackfillProposals: async (caseId) => {
+    requireOnline('Combler un créneau libéré');
+    const response = await api.get(`/surgery/${caseId}/backfill`);
+    return response.data;
+  },
+
   // ============================================
   // CHECK-IN WORKFLOW
   // ============================================
@@ -1,4 +1,17 @@
 import api from './apiConfig';
+import catalogSnapshotService from './catalogSnapshotService';
+
+// Read list endpoints from the local catalog snapshot when one has been
+// downloaded; fall back to the API otherwise (first run, IndexedDB errors).
+async function readLocal(catalog, options) {
+  try {
+    await catalogSnapshotService.init();
+    return await catalogSnapshotService.query(catalog, options);
+  } catch (error) {
+    console.warn(`[TemplateCatalog] Local ${catalog} snapshot unavailable:`, error);
+    return null;
+  }
+}
 
 const templateCatalogService = {
   // ===== MEDICATION TEMPLATES =====
@@ -6,6 +19,14 @@ const templateCatalogService = {
   // Get all medication templates
   async getMedicationTemplates(params = {}) {
     try {
+      const local = await readLocal('medications', {
+        filters: { category: params.category },
+        search: params.search,
+        searchFields: ['name', 'searchTerms'],
+        limit: params.limit ?? 100
+      });
+      if (local) return local;
+
       const response = await api.get('/template-catalog/medications', { params });
       return response.data;
     } catch (error) {
@@ -42,6 +63,14 @@ const templateCatalogService = {
 
   async getExaminationTemplates(params = {}) {
     try {
+      const local = await readLocal('examinations', {
+        filters: { category: params.category },
+        search: params.search,
+        searchFields: ['name', 'description'],
+        limit: params.limit ?? 100
+      });
+      if (local) return local;
+
       const response = await api.get('/template-catalog/examinations', { params });
       return response.data;
     } catch (error) {
@@ -64,6 +93,15 @@ const templateCatalogService = {
 
   async getPathologyTemplates(params = {}) {
     try {
+      const local = await readLocal('pathologies', {
+        filters: { category: params.category, subcategory: params.subcategory, type: params.type },
+        search: params.search,
+        searchFields: ['name', 'value'],
+        limit: params.limit ?? 200,
+        sortBy: ['category', 'subcategory', 'type', 'name']
+      });
+      if (local) return local;
+
       const response = await api.get('/template-catalog/pathologies', { params });
       return response.data;
     } catch (error) {
@@ -128,6 +166,14 @@ const templateCatalogService = {
 
   async getClinicalTemplates(params = {}) {
     try {
+      const local = await readLocal('clinical', {
+        filters: { category: params.category },
+        search: params.search,
+        searchFields: ['name', 'value'],
+        limit: params.limit ?? 100
+      });
+      if (local) return local;
+
       const response = await api.get('/template-catalog/clinical', { params });
       return response.data;
     } catch (error) {
@@ -295,6 +295,10 @@ class WebSocketService {
       this.emit('billing_update', data);
     });
 
+    this.socket.on('catalog:changed', (data) => {
+      this.emit('catalog:changed', data);
+    });
+
     this.socket.on('emergency_alert', (data) => {
       try {
         const storeInstance = getStore();
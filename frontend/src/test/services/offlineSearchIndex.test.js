@@ -0,0 +1,171 @@
+/**
+ * Offline Search Index Tests
+ *
+ * Tests for the token index used by offline patient search:
+ * - Name prefixes, phonetic keys, phone and ID fragments
+ * - Query token groups (every typed word must match)
+ * - Blind tokens for encrypted records
+ * - Indexed lookup over a large cached patient table
+ */
+
+import { describe, it, expect } from 'vitest';
+import {
+  normalizeWords,
+  phoneticKey,
+  buildSearchTokens,
+  buildQueryGroups,
+  blindTokens,
+  withSearchTokens,
+  searchGroups,
+  searchTable
+} from '../../services/offlineSearchIndex';
+
+const PATIENT = {
+  id: 'p1',
+  firstName: 'Hélène',
+  lastName: 'Tshisekedi Mbuyi',
+  phoneNumber: '+243 812 345 678',
+  patientId: 'PAT-2026-00123',
+  email: 'helene.t@example.cd'
+};
+
+// In-memory stand-in for a Dexie table with a multiEntry searchTokens index
+function tokenTable(records) {
+  const byId = new Map(records.map(record => [record.id, record]));
+  const index = new Map();
+  for (const record of records) {
+    for (const token of record.searchTokens || []) {
+      if (!index.has(token)) index.set(token, []);
+      index.get(token).push(record.id);
+    }
+  }
+  return {
+    lookups: 0,
+    where(field) {
+      expect(field).toBe('searchTokens');
+      return {
+        anyOf: (tokens) => ({
+          primaryKeys: async () => {
+            this.lookups++;
+            return tokens.flatMap(token => index.get(token) || []);
+          }
+        })
+      };
+    },
+    bulkGet: async (ids) => ids.map(id => byId.get(id))
+  };
+}
+
+const matches = (record, query) => {
+  const tokens = new Set(record.searchTokens);
+  return buildQueryGroups(query).every(group => group.some(token => tokens.has(token)));
+};
+
+describe('Offline Search Index', () => {
+  describe('normalization', () => {
+    it('folds case and accents into words', () => {
+      expect(normalizeWords("  Hélène-Françoise N'Zita ")).toEqual(['helene', 'francoise', 'n', 'zita']);
+      expect(normalizeWords(null)).toEqual([]);
+    });
+
+    it('gives common spelling variants the same phonetic key', () => {
+      expect(phoneticKey('tshisekedi')).toBe(phoneticKey('tchisekedi'));
+      expect(phoneticKey('mukendi')).toBe(phoneticKey('moukendi'));
+      expect(phoneticKey('kabila')).toBe(phoneticKey('cabila'));
+      expect(phoneticKey('philippe')).toBe(phoneticKey('filipe'));
+      expect(phoneticKey('mbuyi')).not.toBe(phoneticKey('mukendi'));
+      expect(phoneticKey('abc')).toBe('');
+    });
+  });
+
+  describe('buildSearchTokens', () => {
+    it('indexes names, phone, ID and email fragments', () => {
+      const tokens = buildSearchTokens('patients', PATIENT);
+
+      expect(tokens).toContain('n:he');
+      expect(tokens).toContain('n:helene');
+      expect(tokens).toContain('n:mbuyi');
+      expect(tokens).toContain(`p:${phoneticKey('tshisekedi')}`);
+      expect(tokens).toContain('t:5678');
+      expect(tokens).toContain('t:812345678');
+      expect(tokens).toContain('t:243812345678');
+      expect(tokens).toContain('i:pat2026');
+      expect(tokens).toContain('i:00123');
+      expect(tokens).toContain('i:123');
+      expect(tokens).toContain('e:helene.t');
+      expect(buildSearchTokens('visits', PATIENT)).toEqual([]);
+    });
+
+    it('matches the ways reception types a search', () => {
+      const record = { searchTokens: buildSearchTokens('patients', PATIENT) };
+
+      expect(matches(record, 'hel')).toBe(true);
+      expect(matches(record, 'HELENE tshi')).toBe(true);
+      expect(matches(record, 'Tchisekedi')).toBe(true);
+      expect(matches(record, '0812 345 678')).toBe(true);
+      expect(matches(record, '5678')).toBe(true);
+      expect(matches(record, '123')).toBe(true);
+      expect(matches(record, 'PAT-2026')).toBe(true);
+      expect(matches(record, 'helene.t@')).toBe(true);
+      expect(matches(record, 'helene kabila')).toBe(false);
+      expect(buildQueryGroups('   ')).toEqual([]);
+    });
+  });
+
+  describe('blind tokens', () => {
+    const hmacKey = (secret) => crypto.subtle.importKey(
+      'raw',
+      new TextEncoder().encode(secret),
+      { name: 'HMAC', hash: 'SHA-256' },
+      false,
+      ['sign']
+    );
+
+    it('stores only keyed tokens for encrypted records', async () => {
+      const key = await hmacKey('session-a');
+      const [indexed] = await withSearchTokens('patients', [PATIENT], { blind: true, key });
+
+      expect(indexed.firstName).toBe('Hélène');
+      expect(indexed.searchTokens.every(token => token.startsWith('b:'))).toBe(true);
+      expect(indexed.searchTokens.some(token => token.includes('helene'))).toBe(false);
+
+      const groups = await searchGroups('tchisekedi', key);
+      const tokens = new Set(indexed.searchTokens);
+      expect(groups.every(group => group.some(token => tokens.has(token)))).toBe(true);
+
+      // Another session key does not match
+      const other = await blindTokens(['n:helene'], await hmacKey('session-b'));
+      expect(tokens.has(other[0])).toBe(false);
+      expect(await blindTokens(['n:helene'], null)).toEqual([]);
+    });
+  });
+
+  describe('searchTable', () => {
+    it('finds patients among tens of thousands with a few index lookups', async () => {
+      const LAST_NAMES = ['Mukendi', 'Kabila', 'Tshisekedi', 'Mbuyi', 'Ilunga', 'Kasongo', 'Lukusa', 'Ngoy'];
+      const records = await withSearchTokens('patients', Array.from({ length: 30000 }, (_, i) => ({
+        id: `p${i}`,
+        firstName: `Prenom${i % 500}`,
+        lastName: LAST_NAMES[i % LAST_NAMES.length],
+        phoneNumber: `+24381${String(i).padStart(7, '0')}`,
+        patientId: `PAT-2026-${String(i).padStart(5, '0')}`
+      })));
+      const table = tokenTable(records);
+
+      const started = performance.now();
+      const byName = await searchTable(table, buildQueryGroups('moukendi prenom42'), 100);
+      const byPhone = await searchTable(table, buildQueryGroups('081 001 2345'), 100);
+      const byId = await searchTable(table, buildQueryGroups('PAT-2026-29999'), 100);
+      const elapsed = performance.now() - started;
+
+      expect(byName.length).toBeGreaterThan(0);
+      expect(byName.every(p => p.lastName === 'Mukendi' && p.firstName.startsWith('Prenom42'))).toBe(true);
+      expect(byPhone.map(p => p.id)).toEqual(['p12345']);
+      expect(byId.map(p => p.id)).toEqual(['p29999']);
+      expect(table.lookups).toBe(4);
+      expect(elapsed).toBeLessThan(200);
+
+      expect(await searchTable(table, buildQueryGroups('inconnu'), 100)).toEqual([]);
+    });
+  });
+});